@@ -2,6 +2,7 @@
 #define CHUNKS_INCLUDED
 
 #include "My/Vec.hpp"
+#include "My/SmallVec.hpp"
 #include "My/BucketArray.hpp"
 #include "My/HashMap.hpp"
 #include <unordered_map>
@@ -20,7 +21,8 @@ typedef IVec2 ChunkCoord;
 struct ChunkData {
     Chunk* chunk; // pointer to chunk tiles. // when this is not null, chunkdata->chunk should never be null
     ChunkCoord position; // chunk position aka floor(tilePosition / CHUNKSIZE), NOT tile position
-    My::Vec<Entity> closeEntities; // entities that are at least partially inside the chunk
+    static constexpr int InlineCloseEntities = 8; // most chunks only have a few, so they don't need an allocation
+    My::SmallVec<Entity, InlineCloseEntities> closeEntities; // entities that are at least partially inside the chunk
 
     ChunkData(Chunk* chunk, IVec2 position);
 
@@ -83,6 +85,8 @@ struct ChunkMap {
 
     InternalChunkMap map;
     ChunkBucketArray chunkList;
+    // called when a tile is changed after its chunk was generated
+    std::function<void(TileCoord)> onTileChanged;
 
     /* Methods */
 
@@ -109,6 +113,12 @@ struct ChunkMap {
     */
     ChunkData* getOrMakeNew(IVec2 position);
 
+    void tileChanged(TileCoord tile) const {
+        if (onTileChanged) {
+            onTileChanged(tile);
+        }
+    }
+
     void iterateChunkdata(std::function<bool(ChunkData*)> callback) const {
         // TODO: move this to My::HashMap
         for (int i = 0; i < map.bucketCount; i++) {
@@ -0,0 +1,208 @@
+#ifndef COMMAND_REGISTRY_INCLUDED
+#define COMMAND_REGISTRY_INCLUDED
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <string.h>
+#include <stdlib.h>
+#include <SDL3/SDL_stdinc.h>
+#include "utils/Log.hpp"
+#include "llvm/ArrayRef.h"
+
+/* Console commands, the arguments they take, and running them from the console or from a script.
+ * None of this touches the game, so parsing and dispatch can be run and checked on their own.
+ */
+
+namespace CommandArgTypes {
+enum CommandArgType {
+    Int,
+    Float,
+    Bool, // 1/0, true/false, yes/no, on/off. Passed on as 1 or 0
+    String,
+    Choice, // one of a list of words, passed on spelled the way the list spells it
+    Text // the rest of the line, spaces and all. Has to be the last argument
+};
+}
+
+using CommandArgType = CommandArgTypes::CommandArgType;
+
+struct CommandArgSpec {
+    std::string name;
+    CommandArgType type;
+    bool optional;
+    std::string defaultValue;
+    bool hasMin;
+    bool hasMax;
+    double min;
+    double max;
+    std::vector<std::string> choices;
+};
+
+/* The arguments a command takes, written like "belts:int[1,]=10000 dir:{up,down,left,right}=right name:string".
+ * Each argument is name:type, then optionally a range in brackets with either end left out,
+ * then optionally =default, which makes it optional. Only optional arguments can come after an optional one.
+ * Types are int, float, bool, string, text and {word,word,...} for a choice of words.
+ */
+struct CommandSchema {
+    std::vector<CommandArgSpec> args;
+    bool defined = false; // commands without one get their arguments as they were typed, unchecked
+
+    // @return false with the error message set if the signature couldn't be parsed
+    static bool parse(const char* signature, CommandSchema* schema, std::string* error);
+
+    std::string usage(const char* commandName) const;
+};
+
+// an argument as typed, quotes taken off
+struct CommandToken {
+    std::string value;
+    int start; // offset in the line the token came from
+};
+
+/* Split arguments on whitespace. "Double quoted" arguments can have spaces, with \" and \\ inside them,
+ * and {braces} keep everything inside them in one argument, for component values.
+ * @return false with the error message set if a quote or brace was never closed
+ */
+bool tokenizeCommandArgs(const char* text, std::vector<CommandToken>* tokens, std::string* error);
+
+// arguments handed to a command, checked and with defaults filled in if the command has a schema
+struct CommandArgs {
+    std::vector<std::string> values;
+    int next = 0;
+
+    int count() const {
+        return (int)values.size();
+    }
+
+    // get the next argument, or an empty string when there are no more
+    std::string get() {
+        if (next >= count()) return {};
+        return values[next++];
+    }
+
+    int getInt() {
+        return atoi(get().c_str());
+    }
+
+    double getFloat() {
+        return strtod(get().c_str(), nullptr);
+    }
+
+    bool getBool() {
+        return get() == "1";
+    }
+};
+
+struct Command {
+    char name[32];
+    std::string description;
+    int nameLength;
+    CommandSchema schema;
+    struct Result {
+        enum Type {
+            Error,
+            Warn,
+            Success,
+            Other,
+            Null
+        } type = Null;
+
+        std::string message;
+
+    };
+    using FunctionType = std::function<Result(CommandArgs args)>;
+    FunctionType function;
+
+    static Command make(const char* name, const FunctionType& function) {
+        Command command;
+        int nameLength = (int)strlen(name);
+        if (nameLength < 32) {
+            memcpy(command.name, name, nameLength+1);
+        } else {
+            LogError("Command name passed was longer than allowed! name: %s. max length: %d", name, 32);
+            command.name[0] = '\0';
+            nameLength = 0;
+        }
+        command.nameLength = nameLength;
+        command.function = function;
+        return command;
+    }
+
+    // give the command a schema from a signature. Logs an error and leaves the arguments unchecked if it doesn't parse
+    void setArgs(const char* signature);
+
+    /* Check the arguments against the schema and fill in the defaults.
+     * @return false with a message saying what's wrong and how to use the command if they don't fit
+     */
+    bool bind(const char* arguments, CommandArgs* args, std::string* error) const;
+
+    Result run(const char* arguments) const;
+};
+
+/* Finds commands by name with one hash and one compare, as a two level perfect hash built once every command
+ * is registered. Names are hashed into buckets of a few names each, then each bucket, biggest first, gets a
+ * displacement that moves all of its names into slots nobody has taken yet. Looking a name up hashes it once,
+ * picks its bucket's displacement and goes straight to its slot. Names are matched ignoring case
+ */
+struct CommandTable {
+    std::vector<Uint32> displacements; // for each bucket, mixed into its names' hashes to find their slots
+    std::vector<int> slots; // index of the command in each slot, -1 for none
+    Uint32 seed = 0;
+    Uint32 bucketMask = 0;
+    Uint32 slotMask = 0;
+    int commandCount = 0; // commands there were when it was built
+
+    static CommandTable build(ArrayRef<Command> commands);
+
+    static Uint32 hash(const char* name, int length, Uint32 seed);
+
+    // @return The index of the command, or -1 if there isn't one with the name
+    int find(ArrayRef<Command> commands, const char* name, int length) const;
+};
+
+/* A list of commands to run on certain ticks, for setting up the same scenario every time.
+ * One command a line, with an optional / in front. Lines starting with # are comments.
+ * "@120 command" runs 120 ticks after the script starts, "+60 command" runs 60 ticks after the command before it,
+ * and a line without either runs on the same tick as the one before it.
+ */
+struct CommandScript {
+    struct Step {
+        Sint64 tick; // since the script started
+        int line;
+        std::string command;
+        std::string arguments;
+    };
+
+    std::vector<Step> steps;
+
+    // @return false with the error message set, saying which line, if the script couldn't be parsed
+    static bool parse(const char* text, CommandScript* script, std::string* error);
+
+    /* Check every step names a command and has arguments that fit it, so a script doesn't fail halfway through
+     * @return false with the error message set for the first step that doesn't
+     */
+    bool check(ArrayRef<Command> commands, const CommandTable& table, std::string* error) const;
+};
+
+struct CommandScriptRunner {
+    CommandScript script;
+    Sint64 startTick = 0;
+    int nextStep = 0;
+    bool running = false;
+
+    void start(CommandScript script, Sint64 tick);
+
+    void stop() {
+        running = false;
+    }
+
+    using ResultCallback = std::function<void(const CommandScript::Step& step, const Command::Result& result)>;
+
+    /* Run every step that's due by this tick. The script stops at the first command that fails.
+     * @return The number of steps run
+     */
+    int update(Sint64 tick, ArrayRef<Command> commands, const CommandTable& table, const ResultCallback& onResult);
+};
+
+#endif
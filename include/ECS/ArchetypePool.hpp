@@ -92,22 +92,67 @@ static Archetype makeArchetype(Signature signature, ComponentInfoRef componentTy
     return archetype;
 }
 
+/* Change versions
+ * Rows of a pool are grouped into blocks, and every block has a change version for each component,
+ * set to the component manager's current version whenever the component is written to in any row of the block.
+ * Systems that only care about entities that changed can skip every block that hasn't changed
+ * since they last looked, without having to add and remove components to keep track.
+ * Rows moving around (entities being added to the pool or swapped into a removed entity's place) count as changes.
+ */
+
+using ChangeVersion = Uint32;
+
 struct ArchetypePool {
+    static constexpr int ChangeBlockShift = 6;
+    static constexpr int ChangeBlockSize = 1 << ChangeBlockShift;
+
     int size;
     int capacity;
     Entity* entities; // contained entities
     char* buffer;
     My::Vec<int> bufferOffsets; // make llvm::SmallVector?
+    // the versions of each component's blocks, one component after the other
+    ChangeVersion* changeVersions;
+    int changeBlockCapacity;
     Archetype archetype;
     
     ArchetypePool(const Archetype& archetype) : archetype(archetype) {
         entities = nullptr;
         buffer = nullptr;
         bufferOffsets = My::Vec<int>::Filled(archetype.numComponents, -1);
+        changeVersions = nullptr;
+        changeBlockCapacity = 0;
         size = 0;
         capacity = 0;
     }
 
+    int numChangeBlocks() const {
+        return (size + ChangeBlockSize - 1) >> ChangeBlockShift;
+    }
+
+    ChangeVersion* getChangeVersions(int bufferIndex) const {
+        return changeVersions + bufferIndex * changeBlockCapacity;
+    }
+
+    void markChanged(int bufferIndex, int index, ChangeVersion version) const {
+        getChangeVersions(bufferIndex)[index >> ChangeBlockShift] = version;
+    }
+
+    // for when every row of the component could've been written to
+    void markAllChanged(int bufferIndex, ChangeVersion version) const {
+        ChangeVersion* versions = getChangeVersions(bufferIndex);
+        int blocks = numChangeBlocks();
+        for (int b = 0; b < blocks; b++) {
+            versions[b] = version;
+        }
+    }
+
+    void markRowChanged(int index, ChangeVersion version) const {
+        for (int i = 0; i < archetype.numComponents; i++) {
+            markChanged(i, index, version);
+        }
+    }
+
     int numBuffers() const {
         return bufferOffsets.size;
     }
@@ -136,7 +181,7 @@ struct ArchetypePool {
     }
 
     // returns index where entity is stored
-    int addNew(Entity entity) {
+    int addNew(Entity entity, ChangeVersion version) {
         if (size + 1 > capacity) {
             int newCapacity = (capacity * 2 > size) ? capacity * 2 : size + 1;
             char* newBuffer = Alloc<char>(newCapacity * archetype.sumSize);
@@ -152,8 +197,24 @@ struct ArchetypePool {
                     offset += newComponentBufferSize;
                 }
 
+                Free(buffer);
                 buffer = newBuffer;
             }
+
+            int newChangeBlockCapacity = (newCapacity + ChangeBlockSize - 1) >> ChangeBlockShift;
+            if (newChangeBlockCapacity > changeBlockCapacity && archetype.numComponents > 0) {
+                ChangeVersion* newChangeVersions = Alloc<ChangeVersion>(newChangeBlockCapacity * archetype.numComponents);
+                for (int i = 0; i < archetype.numComponents; i++) {
+                    ChangeVersion* newVersions = newChangeVersions + i * newChangeBlockCapacity;
+                    if (changeVersions) {
+                        memcpy(newVersions, getChangeVersions(i), changeBlockCapacity * sizeof(ChangeVersion));
+                    }
+                    memset(newVersions + changeBlockCapacity, 0, (newChangeBlockCapacity - changeBlockCapacity) * sizeof(ChangeVersion));
+                }
+                Free(changeVersions);
+                changeVersions = newChangeVersions;
+                changeBlockCapacity = newChangeBlockCapacity;
+            }
             
             Entity* newEntities = Realloc(entities, newCapacity);
             if (newEntities) {
@@ -163,12 +224,13 @@ struct ArchetypePool {
         }
 
         entities[size] = entity;
+        markRowChanged(size, version);
         
         return size++;
     }
 
     // returns entity that had to be moved to adjust
-    Entity remove(int index) {
+    Entity remove(int index, ChangeVersion version) {
         assert(index < size);
 
         // if last entity
@@ -183,6 +245,7 @@ struct ArchetypePool {
             auto componentSize = archetype.sizes[i];
             memcpy(buffer + bufferOffsets[i] + index * componentSize, buffer + bufferOffsets[i] + (size-1) * componentSize, componentSize);
         }
+        markRowChanged(index, version);
 
         size--;
         return entityToMove;
@@ -191,6 +254,7 @@ struct ArchetypePool {
     void destroy() {
         Free(buffer);
         bufferOffsets.destroy();
+        Free(changeVersions);
         Free(entities);
     }
 };
@@ -205,6 +269,9 @@ struct ArchetypalComponentManager {
 
     My::Vec<ArchetypePool> pools;
     My::Vec<Entity> unusedEntities;
+    EntityID highestEntityID = 0; // ids above this haven't been handed out yet
+    // what writes to components are marked with. See advanceChangeVersion
+    ChangeVersion changeVersion = 1;
     My::HashMap<Signature, ArchetypeID, SignatureHash> archetypes;
     ComponentInfoRef componentInfo;
 
@@ -233,9 +300,18 @@ struct ArchetypalComponentManager {
             unusedEntities[i].id = i + 1;
             unusedEntities[i].version = 0;
         }
+        highestEntityID = 1000;
     }
 
     Entity newEntity(Uint32 prototype) {
+        if (unusedEntities.size == 0) {
+            // every id handed out so far is in use, so start on new ones
+            if (highestEntityID >= MaxEntityID) {
+                LogCritical("Ran out of entity ids!");
+                return NullEntity;
+            }
+            unusedEntities.push(Entity(++highestEntityID, 0));
+        }
         Entity entity = unusedEntities.popBack();
         EntityData* data = entityData.insert(entity.id);
         data->version = ++entity.version;
@@ -255,8 +331,15 @@ struct ArchetypalComponentManager {
             return;
         }
 
-        ArchetypePool* pool = &pools[data->archetype];
-        pool->remove(data->poolIndex);
+        if (data->poolIndex != -1) {
+            ArchetypePool* pool = &pools[data->archetype];
+            Entity movedEntity = pool->remove(data->poolIndex, changeVersion);
+            if (!movedEntity.Null()) {
+                EntityData* movedEntityData = entityData.lookup(movedEntity.id);
+                assert(movedEntityData);
+                movedEntityData->poolIndex = data->poolIndex;
+            }
+        }
 
         entityData.remove(entity.id);
         unusedEntities.push(entity);
@@ -314,6 +397,42 @@ struct ArchetypalComponentManager {
         return pool.getComponent(component, data->poolIndex);
     }
 
+    /* Get a component to write to, marking it changed.
+     * Const like getComponent, since only the change version is touched,
+     * so that getting components for writing works through const entity managers the same way
+     */
+    void* writeComponent(Entity entity, ComponentID component) const {
+        if (entity.id == NullEntity.id) {
+            return nullptr;
+        }
+        const EntityData* data = entityData.lookup(entity.id);
+        if (!data) {
+            return nullptr;
+        } else if (entity.version != data->version) {
+            LogError("Entity no longer exists!");
+            return nullptr;
+        }
+
+        if (!data->signature[component]) {
+            // entity does not have component
+            return nullptr;
+        }
+
+        const auto& pool = pools[data->archetype];
+        auto bufferIndex = pool.archetype.getIndex(component);
+        pool.markChanged(bufferIndex, data->poolIndex, changeVersion);
+        return pool.getComponentByIndex(bufferIndex, data->poolIndex);
+    }
+
+    /* Start a new change version, so writes from now on can be told apart from writes before.
+     * Something that wants to know what changed keeps the version it got last time,
+     * and looks at what changed after that version.
+     * @return The version that was current until now. Everything written before this call has it or an older one
+     */
+    ChangeVersion advanceChangeVersion() {
+        return changeVersion++;
+    }
+
     // returns true on success, false on failure
     bool addSignature(Entity entity, Signature components) {
         if (entity.id == NullEntity.id) {
@@ -339,7 +458,7 @@ struct ArchetypalComponentManager {
             return true;
         }
 
-        int newEntityIndex = newArchetype->addNew(entity);
+        int newEntityIndex = newArchetype->addNew(entity, changeVersion);
         
         if (oldArchetypeID > 0) {
             int oldEntityIndex = data->poolIndex;
@@ -354,7 +473,7 @@ struct ArchetypalComponentManager {
                 memcpy(newComponentAddress, oldComponentAddress, componentSize);
             }
 
-            Entity movedEntity = oldArchetype->remove(oldEntityIndex);
+            Entity movedEntity = oldArchetype->remove(oldEntityIndex, changeVersion);
             if (!movedEntity.Null()) {
                 EntityData* movedEntityData = entityData.lookup(movedEntity.id);
                 assert(movedEntityData);
@@ -393,7 +512,7 @@ struct ArchetypalComponentManager {
             return newArchetype->getComponent(component, data->poolIndex);
         }
 
-        int newEntityIndex = newArchetype->addNew(entity);
+        int newEntityIndex = newArchetype->addNew(entity, changeVersion);
         
         if (oldArchetypeID > 0) {
             int oldEntityIndex = data->poolIndex;
@@ -408,7 +527,7 @@ struct ArchetypalComponentManager {
                 memcpy(newComponentAddress, oldComponentAddress, componentSize);
             }
 
-            Entity movedEntity = oldArchetype->remove(oldEntityIndex);
+            Entity movedEntity = oldArchetype->remove(oldEntityIndex, changeVersion);
             if (!movedEntity.Null()) {
                 EntityData* movedEntityData = entityData.lookup(movedEntity.id);
                 assert(movedEntityData);
@@ -451,7 +570,7 @@ struct ArchetypalComponentManager {
         }
 
         ArchetypePool* newArchetype = getArchetypePool(newArchetypeID);
-        int newEntityIndex = newArchetype->addNew(entity);
+        int newEntityIndex = newArchetype->addNew(entity, changeVersion);
 
         auto oldArchetypeID = data->archetype;
         if (oldArchetypeID > 0) {
@@ -467,7 +586,7 @@ struct ArchetypalComponentManager {
                 memcpy(newComponentAddress, oldComponentAddress, componentSize);
             }
 
-            Entity movedEntity = oldArchetype->remove(oldEntityIndex);
+            Entity movedEntity = oldArchetype->remove(oldEntityIndex, changeVersion);
             if (!movedEntity.Null()) {
                 EntityData* movedEntityData = entityData.lookup(movedEntity.id);
                 assert(movedEntityData);
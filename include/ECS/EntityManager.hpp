@@ -7,6 +7,7 @@
 #include "Entity.hpp"
 #include "PrototypeManager.hpp"
 #include "CommandBuffer.hpp"
+#include "utils/common-macros.hpp"
 
 namespace ECS {
 
@@ -130,6 +131,35 @@ public:
         }
     }
 
+    /* Like forEachEntity, but only goes through entities whose component may have changed after the version given.
+     * Changes are tracked in blocks of rows, so unchanged entities that share a block with a changed one are included too.
+     */
+    template<class Query, class Func>
+    void forEachChangedEntity(Query query, ComponentID changed, ChangeVersion since, Func func) const {
+        bool locked = lock();
+
+        for (Uint32 i = 0; i < components.pools.size; i++) {
+            auto& pool = components.pools[i];
+            auto signature = pool.archetype.signature;
+            if (signature[changed] && query(signature)) {
+                const ChangeVersion* versions = pool.getChangeVersions(pool.archetype.getIndex(changed));
+                for (int block = pool.numChangeBlocks()-1; block >= 0; block--) {
+                    if (versions[block] <= since) continue;
+                    int start = block << ArchetypePool::ChangeBlockShift;
+                    // entities could be removed by the callback, shrinking the pool
+                    for (int e = MIN(start + ArchetypePool::ChangeBlockSize, pool.size)-1; e >= start; e--) {
+                        Entity entity = pool.entities[e];
+                        func(entity);
+                    }
+                }
+            }
+        }
+
+        if (locked) {
+            unlock();
+        }
+    }
+
     // template<class C, class Func>
     // void forEachComponent(Func func) const {
     //     for (Uint32 i = 0; i < components.pools.size; i++) {
@@ -190,9 +220,14 @@ protected:
         return prototype ? prototype->get<C>() : nullptr;
     }
 
+    // getting a component that isn't const marks it changed, since it could be written to
     template<class C>
     C* getRegularComponent(Entity entity) const {
-        return (C*)components.getComponent(entity, C::ID);
+        if constexpr (std::is_const_v<C>) {
+            return (C*)components.getComponent(entity, C::ID);
+        } else {
+            return (C*)components.writeComponent(entity, C::ID);
+        }
     }
 public:
 
@@ -206,8 +241,9 @@ public:
     }
 
     // does not work for prototype components maybe TODO?
+    // marks the component changed, as there's no telling if it's going to be written to
     void* getComponent(Entity entity, ComponentID component) const {
-        return components.getComponent(entity, component);
+        return components.writeComponent(entity, component);
     }
 
     template<class C>
@@ -0,0 +1,40 @@
+#ifndef ECS_NAME_INDEX_INCLUDED
+#define ECS_NAME_INDEX_INCLUDED
+
+#include "My/HashMap.hpp"
+#include "My/SmallVec.hpp"
+#include "Entity.hpp"
+#include "utils/StringInterner.hpp"
+
+namespace ECS {
+
+/*
+ * Entities by their interned name, so finding an entity by name is a hash lookup instead of comparing every name.
+ * More than one entity can have the same name. Whoever owns the names has to add and remove
+ * entities here as their names change, and when they're destroyed.
+ */
+struct NameIndex {
+    // most names only belong to one entity
+    using Entities = My::SmallVec<Entity, 1>;
+
+    My::HashMap<Uint32, Entities> byName;
+
+    static NameIndex init();
+
+    void add(InternedString name, Entity entity);
+
+    // @return False if the entity didn't have the name
+    bool remove(InternedString name, Entity entity);
+
+    // @return The entity that's had the name the longest, or null if nothing has it
+    Entity find(InternedString name) const;
+
+    // the entities with the name
+    ArrayRef<Entity> findAll(InternedString name) const;
+
+    void destroy();
+};
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef GUI_CONSOLE_LOG_INCLUDED
+#define GUI_CONSOLE_LOG_INCLUDED
+
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_pixels.h>
+#include <string>
+#include "utils/Log.hpp"
+
+namespace GUI {
+
+/* The console's log, kept in a ring buffer of a fixed number of lines and a fixed amount of text.
+ * Once either one fills up the oldest lines are overwritten, so a long session costs the same as a short one.
+ * Lines are stored formatted the way they're drawn, copy count and all, and keep their height once they've been
+ * measured, so drawing the console only ever touches the lines that fit on screen.
+ *
+ * The lines shown can be narrowed down by category, lowest priority and text. The lines that pass the filter are
+ * kept in an index that's built once when the filter changes and added to as lines come in, so scrolling through a
+ * filtered log costs the same as scrolling through the whole thing.
+ * Scrolling counts lines from the newest one. When scrolled up, new lines coming in don't move the view.
+ */
+struct ConsoleLog {
+    using Seq = Uint64; // every line pushed gets the next one, so they never wrap around
+
+    static constexpr int MaxCategories = 8;
+    static constexpr int MaxSearchLength = 63;
+
+    struct Line {
+        Seq seq;
+        Uint32 textStart; // where the text starts in the text buffer
+        Uint32 textLength; // not counting the null terminator
+        Uint32 prefixLength; // length of the "(2) " copy count in front of the text
+        int copyNumber;
+        float height; // 0 until it's been measured
+        SDL_Color color;
+        Uint8 category;
+        Uint8 priority;
+        bool playerEntered;
+    };
+
+    struct Filter {
+        Uint32 categories; // bit for each category shown
+        int minPriority;
+        char search[MaxSearchLength + 1]; // only lines containing this are shown. Empty for any line
+
+        static Filter All() {
+            return Filter{~0u, 0, {'\0'}};
+        }
+    };
+
+    Line* lines; // line with seq s is at lines[s % lineCapacity]
+    int lineCapacity;
+    Seq firstSeq; // oldest line still kept
+    Seq endSeq; // one past the newest line
+
+    char* text; // the text of every line, null terminated
+    Uint32 textCapacity;
+    Uint32 textHead; // where the next line's text goes
+
+    Filter filter;
+    // seqs of the lines that pass the filter, oldest first. Same layout as the lines
+    Seq* view;
+    Uint64 viewFirst;
+    Uint64 viewEnd;
+
+    int scroll; // lines passing the filter skipped from the newest one
+
+    int counts[MaxCategories][LogPriorities::NumPriorities]; // lines kept of each category and priority
+
+    static ConsoleLog init(int lineCapacity, Uint32 textCapacity);
+
+    /* Add a line. The same text, color and category as the newest line just counts up its copy number.
+     * Text longer than a quarter of the text buffer is cut off
+     */
+    void push(const char* text, SDL_Color color, int category, LogPriority priority, bool playerEntered);
+
+    // lines kept, filtered or not
+    int size() const {
+        return (int)(endSeq - firstSeq);
+    }
+
+    // kept line by index, 0 being the oldest. Ignores the filter
+    Line& line(int index) const {
+        return lines[(firstSeq + index) % lineCapacity];
+    }
+
+    // the text as drawn, with the copy count in front
+    const char* lineText(const Line& line) const {
+        return &text[line.textStart];
+    }
+
+    // the text as it was pushed
+    const char* rawText(const Line& line) const {
+        return &text[line.textStart + line.prefixLength];
+    }
+
+    bool passes(const Line& line) const;
+
+    // show only lines that pass the filter. Goes through every kept line once and scrolls back to the newest line
+    void setFilter(const Filter& filter);
+
+    // lines passing the filter
+    int viewSize() const {
+        return (int)(viewEnd - viewFirst);
+    }
+
+    // line passing the filter by index, 0 being the oldest
+    Line& viewLine(int index) const {
+        return lines[view[(viewFirst + index) % lineCapacity] % lineCapacity];
+    }
+
+    // kept lines of any of the categories with at least the priority, not counting the text search
+    int count(Uint32 categories, int minPriority) const;
+
+    void scrollBy(int lines);
+
+    void scrollToNewest() {
+        scroll = 0;
+    }
+
+    /* How many lines from the scroll position, going up, fit in the height. Lines that haven't been measured yet count
+     * as the estimated height. At least one line is shown when there are any, however tall it is
+     */
+    int visibleLines(float viewHeight, float spacing, float estimatedHeight) const;
+
+    /* The text of filtered lines [first, first + count), oldest first, each on its own line.
+     * The range is clamped to the lines there are
+     */
+    std::string copyLines(int first, int count) const;
+
+    // throw away every line, keeping the filter
+    void clear();
+
+    void destroy();
+
+private:
+    char* allocText(Uint32 size);
+    void popOldest();
+    void popNewest();
+    void addLine(const char* text, Uint32 textLength, int copyNumber, SDL_Color color, int category, LogPriority priority, bool playerEntered);
+};
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include "elements.hpp"
 #include "update.hpp"
 #include "GUI/ecs-gui.hpp"
+#include "GUI/layout.hpp"
+#include "GUI/ConsoleLog.hpp"
 #include "systems/basic.hpp"
 
 struct GuiRenderer;
@@ -32,15 +34,12 @@ struct Console {
         {255, 0, 0, 255}
     };
 
-    struct LogMessage {
-        std::string text;
-        SDL_Color color;
-        MessageType type;
-        bool playerEntered = false;
-        int copyNumber = 0;
-    };
+    static constexpr int LogLineCapacity = 4096;
+    static constexpr Uint32 LogTextCapacity = 512 * 1024;
+    static constexpr int ScrollPageLines = 8;
 
-    std::vector<LogMessage> log;
+    // categories are message types
+    ConsoleLog log;
 
     std::string activeMessage;
     int recallIndex = -1; // going through the log, to retype and old message, this index is for seeing what message its on. -1 means not using the log history currently
@@ -63,35 +62,19 @@ struct Console {
         if (activeMessage.empty()) return;
         newMessage(activeMessage.c_str(), type);
         activeMessage.clear();
+        log.scrollToNewest();
 
         selectedCharIndex = 0;
         recallIndex = -1;
     }
 
-    void newMessage(const char* text, MessageType type) {
+    void init() {
+        log = ConsoleLog::init(LogLineCapacity, LogTextCapacity);
+    }
+
+    void newMessage(const char* text, MessageType type, LogPriority priority = LogPriority::Info) {
         bool playerEntered = type == MessageType::Default || type == MessageType::Command;
-        LogMessage message = {
-            .text = text,
-            .color = typeColors[(int)type],
-            .type = type,
-            .playerEntered = playerEntered
-        };
-        if (log.size() > 0) {
-        LogMessage& lastMessage = log.back();
-            if (lastMessage.text == message.text
-                && lastMessage.color.r == message.color.r
-                && lastMessage.color.g == message.color.g
-                && lastMessage.color.b == message.color.b
-                && lastMessage.color.a == message.color.a
-                && lastMessage.playerEntered == message.playerEntered)
-            {
-                lastMessage.copyNumber += 1;
-            } else {
-               log.push_back(message); 
-            }
-        } else {
-            log.push_back(message);
-        }
+        log.push(text, typeColors[(int)type], (int)type, priority, playerEntered);
 
         timeLastMessageSent = Metadata->seconds();
     }
@@ -105,21 +88,21 @@ struct Console {
 
     int playerMessageCount() const {
         int count = 0;
-        for (auto& message : log) {
-            count += message.playerEntered;
+        for (int i = 0; i < log.size(); i++) {
+            count += log.line(i).playerEntered;
         }
         return count;
     }
 
     // will clamp indices below or above the limit to an empty message or oldest message, respectively
     void recallPastMessage() { 
-        if (recallIndex >= (int)log.size() - 1) return;
-        int relativeIndex = (int)log.size() - recallIndex - 2; // reverse
-        relativeIndex = std::clamp(relativeIndex, 0, (int)log.size() - 1);
+        if (recallIndex >= log.size() - 1) return;
+        int relativeIndex = log.size() - recallIndex - 2; // reverse
+        relativeIndex = std::clamp(relativeIndex, 0, log.size() - 1);
         for (int i = relativeIndex; i < log.size(); i++) {
-            LogMessage newMessage = log[i];
-            if (newMessage.type == MessageType::Default) {
-                activeMessage = newMessage.text;
+            const ConsoleLog::Line& line = log.line(i);
+            if (line.category == (int)MessageType::Default) {
+                activeMessage = log.rawText(line);
                 recallIndex += i - relativeIndex + 1;
                 break;
             }
@@ -133,12 +116,12 @@ struct Console {
     // will clamp indices below or above the limit to an empty message or oldest message, respectively
     void recallBackMessage() {
         if (recallIndex <= 0) return; // already on that index, don't need to do anything
-        int relativeIndex = (int)log.size() - recallIndex; // reverse
-        relativeIndex = std::clamp(relativeIndex, 0, (int)log.size() - 1);
+        int relativeIndex = log.size() - recallIndex; // reverse
+        relativeIndex = std::clamp(relativeIndex, 0, log.size() - 1);
         for (int i = relativeIndex; i >= 0; i--) {
-            LogMessage newMessage = log[i];
-            if (newMessage.type == MessageType::Default) {
-                activeMessage = newMessage.text;
+            const ConsoleLog::Line& line = log.line(i);
+            if (line.category == (int)MessageType::Default) {
+                activeMessage = log.rawText(line);
                 recallIndex += i - relativeIndex - 1;
                 break;
             }
@@ -220,13 +203,19 @@ struct Console {
         case SDLK_RIGHT:
             moveCursor(MIN(selectedCharIndex + 1, activeMessage.size()));
             break;
+        case SDLK_PAGEUP:
+            log.scrollBy(ScrollPageLines);
+            break;
+        case SDLK_PAGEDOWN:
+            log.scrollBy(-ScrollPageLines);
+            break;
         } // end keycode switch
 
         return command;
     }
 
     void destroy() {
-        
+        log.destroy();
     }
 };
 
@@ -247,49 +236,20 @@ struct Gui {
 
     GuiManager manager;
 
-    struct MySystems {
-        Systems::RenderBackgroundSystem* renderBackgroundSys;
-        Systems::SizeConstraintSystem* sizeConstraintSystem;
-        Systems::RenderTexturesSystem* textureSys;
-
-        void init(Systems::SystemManager& manager, GuiRenderer& renderer) {
-            auto* treeTraversal = new Systems::IBarrier(manager);
-            auto* startRendering = new Systems::IBarrier(manager);
-            auto* elementsComplete = new Systems::IBarrier(manager);
-
-            renderBackgroundSys = new Systems::RenderBackgroundSystem(manager, &renderer);
-            sizeConstraintSystem = new Systems::SizeConstraintSystem(manager);
-            textureSys = new Systems::RenderTexturesSystem(manager, &renderer);
-
-            sizeConstraintSystem->orderAfter(treeTraversal);
-            elementsComplete->orderAfter(sizeConstraintSystem);
-            startRendering->orderAfter(elementsComplete);
-            renderBackgroundSys->orderAfter(startRendering);
-            textureSys->orderAfter(renderBackgroundSys);
-        }
-
-        void update(GuiRenderer& renderer) {
-           
-        }
-
-        void destroy() {
-            delete sizeConstraintSystem;
-            delete renderBackgroundSys;
-            delete textureSys;
-        }
-    } systems;
+    GuiLayout layout; // kept from frame to frame, only redone where something changed
 
     Gui() {}
 
     void init(GuiRenderer& renderer) {
         using namespace GUI::EC;
         constexpr static auto componentInfoArray = ECS::getComponentInfoList<GUI_COMPONENTS_LIST>();
+        console.init();
         manager = GUI::GuiManager(ArrayRef(componentInfoArray), GUI::ElementTypes::Count);
         manager.systemManager.entityManager = &manager;
         makeGuiPrototypes(manager);
         initGui(manager);
 
-        systems.init(manager.systemManager, renderer);
+        layout = GuiLayout::init();
     }
 
     void renderElements(GuiRenderer& renderer, const PlayerControls& playerControls);
@@ -303,20 +263,20 @@ struct Gui {
 
         // my hotbar
         for (int i = 0; i < player.numHotbarSlots; i++) {
-            char slotName[64];
-            snprintf(slotName, 64, "hotbar-slot-%d", i);
-            Element slot = manager.getNamedElement(slotName);
+            Element slot = manager.getNamedElement(hotbarSlotName(i));
 
             ItemStack stack = inventory->get(i);
 
-            auto textureEc = manager.getComponent<EC::SimpleTexture>(slot);
+            auto textureEc = manager.getComponent<const EC::SimpleTexture>(slot);
             auto textEc = manager.getComponent<EC::Text>(slot);
 
             auto* displayIec = itemManager.getComponent<ITC::Display>(stack.item);
             ItemQuantity stackSize = items::getStackSize(stack.item, itemManager);
 
-            if (textureEc) {
-                textureEc->texture = displayIec ? displayIec->inventoryIcon : TextureIDs::Null;
+            // only written when it changes, so the slot isn't repainted every frame
+            TextureID icon = displayIec ? displayIec->inventoryIcon : TextureIDs::Null;
+            if (textureEc && textureEc->texture != icon) {
+                manager.getComponent<EC::SimpleTexture>(slot)->texture = icon;
             }
 
             if (textEc) {
@@ -369,8 +329,8 @@ struct Gui {
     void destroy() {
         area.destroy();
         console.destroy();
+        layout.destroy();
         manager.destroy();
-        systems.destroy();
     }
 };
 
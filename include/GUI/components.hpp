@@ -6,6 +6,7 @@
 #include "rendering/text.hpp"
 #include "actions.hpp"
 #include "ECS/componentMacros.hpp"
+#include "utils/StringInterner.hpp"
 
 namespace GUI {
 
@@ -62,10 +63,9 @@ BEGIN_COMPONENT(Button)
     bool pressed = false; // if the button is down
 END_COMPONENT(Button)
 
-#define GUI_ELEMENT_MAX_NAME_SIZE 64
-
+// GuiManager keeps an index of these, so only add them with addName
 BEGIN_COMPONENT(Name)
-    char name[GUI_ELEMENT_MAX_NAME_SIZE];
+    InternedString name;
 END_COMPONENT(Name)
 
 BEGIN_COMPONENT(MaxSize)
@@ -5,6 +5,7 @@
 #include "components.hpp"
 #include "prototypes.hpp"
 #include "ECS/system.hpp"
+#include "ECS/NameIndex.hpp"
 
 namespace GUI {
 
@@ -22,6 +23,12 @@ struct GuiTreeNode {
     int childCount = 0;
     int capacity = 0;
 
+    // for the retained layout, see GuiLayout
+    bool childrenDirty = false; // the children have to be laid out again
+    bool descendantsDirty = false; // something further down has to be laid out again
+    Box childrenBox = {{0,0},{0,0}}; // the box the children were last laid out in
+    int childrenLevel = -1; // and the level they started at
+
     GuiTreeNode() {}
 
     GuiTreeNode(Element e, ElementID parent) : e(e), parent(parent) {}
@@ -48,10 +55,33 @@ struct GuiManager : ECS::EntityManager {
 
     ECS::System::SystemManager systemManager;
 
+    ECS::NameIndex names; // elements by their name
+
     GuiTreeNode* getTreeNode(ElementID elementID) const {
         return treeMap.lookup(elementID);
     }
 
+    // the element and its siblings have to be laid out again, like after one of them changed size
+    void relayout(ElementID element) {
+        GuiTreeNode* node = treeMap.lookup(element);
+        if (node) {
+            relayoutChildren(node->parent);
+        }
+    }
+
+    // the children of the element have to be laid out again
+    void relayoutChildren(ElementID element) {
+        GuiTreeNode* node = treeMap.lookup(element);
+        if (!node) return;
+        node->childrenDirty = true;
+        // mark the way down to it, stopping where it's already marked
+        GuiTreeNode* parent = treeMap.lookup(node->parent);
+        while (parent && !parent->descendantsDirty) {
+            parent->descendantsDirty = true;
+            parent = treeMap.lookup(parent->parent);
+        }
+    }
+
     void destroyTree(GuiTreeNode* node) {
         for (int c = 0; c < node->childCount; c++) {
             destroyTreeElement(node->children[c]);
@@ -70,7 +100,7 @@ struct GuiManager : ECS::EntityManager {
     GuiManager() {}
 
     GuiManager(ECS::ComponentInfoRef componentInfo, int numPrototypes)
-     : ECS::EntityManager(componentInfo, numPrototypes), treeMap(32) {
+     : ECS::EntityManager(componentInfo, numPrototypes), treeMap(32), names(ECS::NameIndex::init()) {
         ECS::System::setupSystems(systemManager);
 
         screen = ECS::EntityManager::newEntity(ElementTypes::Normal);
@@ -86,6 +116,7 @@ struct GuiManager : ECS::EntityManager {
         GuiTreeNode* oldParent = treeMap.lookup(node->parent);
         // when parent is null, we don't need to remove element from parent
         if (oldParent) {
+            relayoutChildren(node->parent);
             for (int c = 0; c < oldParent->childCount; c++) {
                 if (oldParent->children[c] == element.id) {
                     if (c != oldParent->childCount-1)
@@ -132,14 +163,18 @@ struct GuiManager : ECS::EntityManager {
                         break;
                     }
                 }
+                relayoutChildren(oldParent->e.id);
                 // swap parent
                 childNode->parent = parent.id;
             }
         } else {
             treeMap.insert(child.id, GuiTreeNode(child, parent.id));
+            // inserting can move the nodes around
+            parentNode = treeMap.lookup(parent.id);
         }
 
         addChildNode(parentNode, child.id);
+        relayoutChildren(parent.id);
     }
 
     Element newElement(ECS::PrototypeID prototype, Element parent = NullElement) {
@@ -164,6 +199,7 @@ private:
         GuiTreeNode* node = treeMap.lookup(elementID);
         if (node && !entityHas<EC::Hidden>(node->e)) {
             addComponent<EC::Hidden>(node->e, {});
+            relayout(elementID);
             for (int i = 0; i < node->childCount; i++) {
                 hideElement(node->children[i]);
             }
@@ -183,6 +219,7 @@ private:
         GuiTreeNode* node = treeMap.lookup(elementID);
         if (node && entityHas<EC::Hidden>(node->e)) {
             removeComponent<EC::Hidden>(node->e);
+            relayout(elementID);
             for (int i = 0; i < node->childCount; i++) {
                 unhideElement(node->children[i]);
             }
@@ -190,31 +227,35 @@ private:
     }
 public:
 
-    bool addName(Element element, const char* name) {
+    // give the element a name to find it by, replacing the name it had
+    bool addName(Element element, InternedString name) {
         if (!name) {
             LogError("No name given to add");
             return false;
         }
-        if (strlen(name) > GUI_ELEMENT_MAX_NAME_SIZE) {
-            LogWarn("Element name too long! Name will be truncated. Name: \"%s\"", name);
+        if (entityHas<EC::Name>(element)) {
+            names.remove(getComponent<EC::Name>(element)->name, element);
+        }
+        if (!addComponent<EC::Name>(element, EC::Name{name})) {
+            return false;
         }
-        EC::Name nameEc;
-        strncpy(nameEc.name, name, GUI_ELEMENT_MAX_NAME_SIZE);
-        return addComponent<EC::Name>(element, nameEc);
+        names.add(name, element);
+        return true;
     }
 
-    Element getNamedElement(const char* name) {
-        Element namedElement = NullElement;
-        forEachEntity<EC::Name>([&](Element e){
-            auto* nameEc = getComponent<EC::Name>(e);
-            if (My::streq(nameEc->name, name)) {
-                namedElement = e;
-            }
-        });
-        return namedElement;
+    bool addName(Element element, const char* name) {
+        return addName(element, intern(name));
     }
 
-    Element getNamedElement(std::string name) {
+    Element getNamedElement(InternedString name) const {
+        return names.find(name);
+    }
+
+    Element getNamedElement(const char* name) const {
+        return names.find(findInterned(name));
+    }
+
+    Element getNamedElement(std::string name) const {
         return getNamedElement(name.c_str());
     }
 
@@ -224,6 +265,8 @@ public:
         ECS::EntityManager::destroy();
 
         ECS::System::cleanupSystems(systemManager);
+
+        names.destroy();
     }
 };
 
@@ -10,6 +10,20 @@
 
 namespace GUI {
 
+constexpr int MaxHotbarSlots = 64;
+
+// the name of a hotbar slot element, interned once so the hotbar doesn't format and hash its slot names every frame
+inline InternedString hotbarSlotName(int slot) {
+    assert(slot >= 0 && slot < MaxHotbarSlots && "hotbar slot out of range");
+    static InternedString names[MaxHotbarSlots] = {};
+    if (!names[slot]) {
+        char name[32];
+        snprintf(name, sizeof(name), "hotbar-slot-%d", slot);
+        names[slot] = intern(name);
+    }
+    return names[slot];
+}
+
 inline Element boxElement(GuiManager& gui, Box box, SDL_Color backgroundColor) {
     auto e = gui.newElement(ElementTypes::Normal, gui.screen);
     gui.addComponent(e, EC::ViewBox{box});
@@ -0,0 +1,105 @@
+#ifndef GUI_LAYOUT_INCLUDED
+#define GUI_LAYOUT_INCLUDED
+
+#include "My/Vec.hpp"
+#include "ECS/ArchetypePool.hpp"
+#include "rendering/renderers.hpp"
+#include "rendering/textures.hpp"
+#include "utils/vectors_and_rects.hpp"
+#include "llvm/ArrayRef.h"
+
+struct GuiRenderer;
+
+namespace GUI {
+
+struct GuiManager;
+
+// the parts of an element, in the order they're drawn on a level
+namespace QuadLayers {
+    enum QuadLayer {
+        Backgrounds,
+        Borders,
+        Textures,
+        Count
+    };
+}
+
+using QuadLayers::QuadLayer;
+
+/* The gui's layout and quads, kept from frame to frame instead of worked out again every frame.
+ * Changing a ViewBox, SizeConstraint, AlignmentConstraint or StackConstraint, or moving elements around in the tree,
+ * marks just that part of the tree dirty, and only those parts get laid out again.
+ * Each element's quads live in a range of their level's quads, and only get made again when the element
+ * moves, changes how it looks or is hovered over. Every frame the quads are copied to the renderer as they are.
+ * Nothing in here touches opengl, so it can be run and checked without a window.
+ */
+struct GuiLayout {
+    using Quad = QuadRenderer::Quad;
+
+    struct QuadRange {
+        int level; // -1 when the element has none of these quads
+        int start;
+        int count;
+    };
+
+    struct ElementQuads {
+        QuadRange ranges[QuadLayers::Count];
+        bool queued; // waiting to be repainted
+    };
+
+    struct LayerQuads {
+        My::Vec<Quad> quads;
+        My::Vec<ECS::EntityID> owners; // the element each quad belongs to, the null id for quads nobody uses anymore
+        int unused;
+    };
+
+    struct Level {
+        LayerQuads layers[QuadLayers::Count];
+    };
+
+    My::Vec<ElementQuads> elements; // by element id
+    My::Vec<Level> levels;
+    My::Vec<ECS::Entity> repaintQueue;
+    // component changes up to this version have already been looked at
+    ECS::ChangeVersion version;
+
+    // how much work the last update did
+    int elementsLaidOut;
+    int elementsRepainted;
+
+    static GuiLayout init();
+
+    // make the element's quads again on the next update
+    void repaint(ECS::Entity element);
+
+    // hover over a different element, repainting the old and new one
+    void setHovered(GuiManager& gui, ECS::Entity element);
+
+    // lay out the parts of the tree that changed since last time, queueing the elements that moved to be repainted
+    void relayout(GuiManager& gui, Box screen);
+
+    /* Make the quads of the elements waiting to be repainted.
+     * @param atlas The atlas the texture coordinates come from. Texture quads are left out without one
+     */
+    void repaintQueued(const GuiManager& gui, const TextureAtlas* atlas);
+
+    // relayout and repaint together
+    void update(GuiManager& gui, Box screen, const TextureAtlas* atlas);
+
+    // copy the quads to the renderer's level buffers. Levels the renderer doesn't have aren't drawn
+    void buffer(GuiRenderer& renderer) const;
+
+    ArrayRef<Quad> quads(int level, QuadLayer layer) const;
+
+    void destroy();
+
+private:
+    void setQuads(ECS::EntityID element, QuadLayer layer, int level, const Quad* quads, int count);
+    void freeQuads(ECS::EntityID element, QuadLayer layer);
+    void paint(const GuiManager& gui, ECS::Entity element, const TextureAtlas* atlas);
+    void compact(LayerQuads& layer, QuadLayer layerIndex);
+};
+
+}
+
+#endif
@@ -153,11 +153,9 @@ inline Element buildHotbar(GuiManager& gui) {
 
     float offset = borderSize;
     
-    EC::Name name;
     for (int s = 0; s < numSlots; s++) {
         auto slot = gui.newElement(ElementTypes::Normal, bar);
-        snprintf(name.name, 64, "hotbar-slot-%d", s);
-        gui.addComponent(slot, name);
+        gui.addName(slot, hotbarSlotName(s));
         gui.addComponent(slot, EC::Numbered{s});
 
         Box hotbarSlot = {
@@ -237,8 +235,8 @@ inline std::vector<GameAction> update(GuiManager& gui, const PlayerControls& pla
     gui.forEachEntity([&](auto signature){
         return signature[EC::ViewBox::ID] && signature[EC::Hover::ID];
     }, [&](Element e){
-        auto* viewbox = gui.getComponent<EC::ViewBox>(e);
-        auto* hover = gui.getComponent<EC::Hover>(e);
+        auto* viewbox = gui.getComponent<const EC::ViewBox>(e);
+        auto* hover = gui.getComponent<const EC::Hover>(e);
         Box box = viewbox->absolute;
 
         bool mouseOnButton = pointInRect(mousePos, box.rect());
@@ -16,11 +16,10 @@
 #include "Camera.hpp"
 #include "rendering/rendering.hpp"
 #include "ECS/system.hpp"
+#include "CommandRegistry.hpp"
 
 struct Game;
 
-void rotateEntity(const EntityWorld& ecs, Entity entity, bool counterClockwise);
-
 void setDefaultKeyBindings(Game& ctx, PlayerControls* controls);
 
 struct CameraEntityFocus {
@@ -61,6 +60,7 @@ struct Game {
     MetadataTracker metadata;
     RenderContext* renderContext;
     GameEntitySystems systems;
+    CommandScriptRunner script; // commands from runScript, run at the start of the ticks they're due
     Mode mode;
 
     Game(SDLContext sdlContext):
@@ -9,6 +9,10 @@
 #include "Chunks.hpp"
 #include "world/EntityWorld.hpp"
 #include "world/functions.hpp"
+#include "world/TransportLines.hpp"
+#include "world/Inserters.hpp"
+#include "world/Pathfinding.hpp"
+#include "physics/physics.hpp"
 #include "Player.hpp"
 
 struct GameState {
@@ -16,6 +20,12 @@ struct GameState {
     EntityWorld ecs;
     Player player;
     ItemManager itemManager;
+    World::TransportLines transportLines;
+    World::Inserters inserters;
+    World::Pathfinding pathfinding;
+    Physics::Space physics;
+    // the change version dynamic entities' chunk positions were last updated at
+    ECS::ChangeVersion dynamicPositionsVersion;
 
     void init(const TextureManager* textureManager);
     void destroy();
@@ -28,16 +38,6 @@ llvm::SmallVector<IVec2> raytraceDDA(Vec2 start, Vec2 end);
 
 void worldLineAlgorithm(Vec2 start, Vec2 end, const std::function<int(IVec2)>& callback);
 
-inline void updateEntityViewBox(const GameState* state, Entity entity, World::EC::ViewBox viewbox) {
-    assert(state->ecs.EntityExists(entity));
-
-    llvm::BitVector entityViewBoxModifiedFlags(MAX_ENTITIES);
-
-    auto& flags = entityViewBoxModifiedFlags;
-
-    flags[entity.id] = 1;
-}
-
 void forEachChunkContainingBounds(const ChunkMap* chunkmap, Boxf bounds, const std::function<void(ChunkData*)>& callback);
 
 constexpr Vec2 EntityMaxPos = {(float)INT_MAX, (float)INT_MAX};
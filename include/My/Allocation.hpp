@@ -6,19 +6,20 @@
 
 MY_CLASS_START
 
+// plain malloc, without the out of memory handling, but still tracked
 struct SystemAllocator : IAllocator<SystemAllocator> {
     using size_type = size_t;
 
     void* allocate(size_t size) const {
-        return malloc(size);
+        return Mem::_malloc(size);
     }
 
     void deallocate(void* ptr) const {
-        free(ptr);
+        Mem::_free(ptr);
     }
 
     void* reallocate(void* ptr, size_t size) const {
-        return realloc(ptr, size);
+        return Mem::_realloc(ptr, size);
     }
 };
 
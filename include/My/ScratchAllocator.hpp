@@ -0,0 +1,125 @@
+#ifndef MY_SCRATCH_ALLOCATOR_INCLUDED
+#define MY_SCRATCH_ALLOCATOR_INCLUDED
+
+#include "MyInternals.hpp"
+#include "Allocation.hpp"
+#include "Vec.hpp"
+
+MY_CLASS_START
+
+/*
+ * Scratch memory that only lasts until the end of the frame or tick it was allocated in.
+ * Allocating just bumps an offset into a block, freeing does nothing, and everything allocated
+ * in a frame (or tick) is thrown away at once when the next one starts, by bumping a global counter.
+ * Every thread has its own arenas, which notice the counter changed and reset themselves the next time they're used,
+ * so job threads can use scratch memory without locking.
+ *
+ * An arena starts with one block and chains on more when it runs out. When it's reset, the extra blocks are freed
+ * and the first one is regrown to fit everything, so once the game gets going an arena never allocates again
+ * and resetting is just setting the offset back to zero.
+ *
+ * With DEBUG on, memory is filled with garbage when it's reset and poisoned for AddressSanitizer,
+ * and reallocating or freeing memory from an earlier frame or tick asserts.
+ */
+
+namespace ScratchLifetimes {
+enum ScratchLifetime {
+    Frame,
+    Tick,
+    Count
+};
+}
+
+using ScratchLifetime = ScratchLifetimes::ScratchLifetime;
+
+struct ScratchArena {
+    static constexpr size_t Alignment = 16;
+    static constexpr size_t StartBlockSize = 64 * 1024;
+
+    struct Block {
+        Block* next; // the block that was filled before this one
+        size_t size; // usable bytes after the header
+    };
+
+    // before every allocation, so it can be reallocated and checked
+    struct alignas(Alignment) AllocationHeader {
+        Uint32 size;
+        Uint32 epoch; // the frame or tick it was allocated in
+    };
+
+    Block* block; // the block being allocated from
+    size_t offset; // bytes used in the block
+    ScratchLifetime lifetime;
+    Uint32 epoch; // the frame or tick the arena was last reset for
+    Uint32 blockAllocations; // heap allocations for blocks, since the start
+
+    static ScratchArena init(ScratchLifetime lifetime);
+
+    // start over for a new frame or tick. Everything allocated so far is gone after this
+    void reset(Uint32 newEpoch);
+
+    void* allocate(size_t size);
+
+    // grow or shrink an allocation, in place if it was the last one made
+    void* reallocate(void* ptr, size_t size);
+
+    // doesn't free anything, only checks the memory is still alive
+    void deallocate(void* ptr) const;
+
+    // whether memory from this arena was allocated before the last reset
+    bool expired(const void* ptr) const;
+
+    void destroy();
+};
+
+/* Start a new frame or tick, throwing away the scratch memory of the last one on every thread.
+ * Jobs using scratch memory from the last frame or tick need to be done before this is called
+ */
+void newScratchFrame();
+void newScratchTick();
+
+// the frame or tick scratch memory is being allocated for now
+Uint32 scratchEpoch(ScratchLifetime lifetime);
+
+// this thread's arena for the lifetime, reset if there's been a new frame or tick since it was last used
+ScratchArena& scratchArena(ScratchLifetime lifetime);
+
+template<ScratchLifetime Lifetime>
+struct ScratchAllocator : IAllocator< ScratchAllocator<Lifetime> > {
+    using size_type = size_t;
+
+    void* allocate(size_t size) const {
+        return scratchArena(Lifetime).allocate(size);
+    }
+
+    void deallocate(void* ptr) const {
+        scratchArena(Lifetime).deallocate(ptr);
+    }
+
+    void* reallocate(void* ptr, size_t size) const {
+        return scratchArena(Lifetime).reallocate(ptr, size);
+    }
+};
+
+using FrameAllocator = ScratchAllocator<ScratchLifetimes::Frame>;
+using TickAllocator = ScratchAllocator<ScratchLifetimes::Tick>;
+
+// vectors that don't need to be destroyed, but can't be kept past the end of the frame or tick
+template<typename T>
+using FrameVec = Vec<T, FrameAllocator>;
+template<typename T>
+using TickVec = Vec<T, TickAllocator>;
+
+template<typename T>
+T* FrameAlloc(size_t count) {
+    return (T*)scratchArena(ScratchLifetimes::Frame).allocate(count * sizeof(T));
+}
+
+template<typename T>
+T* TickAlloc(size_t count) {
+    return (T*)scratchArena(ScratchLifetimes::Tick).allocate(count * sizeof(T));
+}
+
+MY_CLASS_END
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef MY_SMALL_VEC_INCLUDED
+#define MY_SMALL_VEC_INCLUDED
+
+#include <assert.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include "MyInternals.hpp"
+#include "std.hpp"
+#include "../constants.hpp"
+#include "Allocation.hpp"
+#include "llvm/ArrayRef.h"
+
+MY_CLASS_START
+
+namespace Vector {
+
+/* Growth policies, for how big to make a vector when it runs out of room.
+ * grow() gets the current capacity and the capacity that's needed, and returns the new capacity, at least the needed one
+ */
+
+// the default. Fewest reallocations, but up to half the memory can go unused
+struct DoubleGrowth {
+    static int grow(int capacity, int needed) {
+        int doubled = capacity * 2;
+        return MAX(doubled, needed);
+    }
+};
+
+// less memory wasted on big vectors, for a few more reallocations
+struct HalfGrowth {
+    static int grow(int capacity, int needed) {
+        int grown = capacity + capacity / 2;
+        return MAX(grown, needed);
+    }
+};
+
+// only ever as big as it needs to be, for vectors that are filled once or grow in big known steps
+struct ExactGrowth {
+    static int grow(int capacity, int needed) {
+        (void)capacity;
+        return needed;
+    }
+};
+
+/* The elements of a small vector, in the inline buffer until there are more than N of them and on the heap after that.
+ * There's no pointer to the buffer, so the vector can be moved around with memcpy like a Vec can
+ * (a HashMap can keep them in its values), and for trivially copyable types this is trivially copyable too.
+ */
+template<typename T, int N, class AllocatorT>
+struct SmallVecData {
+    static_assert(N > 0, "small vec needs room for at least one element inline, use a Vec otherwise");
+    static constexpr bool Trivial = std::is_trivially_copyable<T>::value;
+
+    int size;
+    int capacity; // N while the elements are inline, always more once they're on the heap
+
+    union {
+        T* heap;
+        alignas(T) unsigned char buffer[N * sizeof(T)];
+    };
+
+    using Allocator = AllocatorT;
+    static Allocator allocator;
+
+    SmallVecData() : size(0), capacity(N) {}
+
+    bool isInline() const {
+        return capacity == N;
+    }
+
+    T* data() {
+        return isInline() ? (T*)buffer : heap;
+    }
+
+    const T* data() const {
+        return isInline() ? (const T*)buffer : heap;
+    }
+
+    // move count elements to uninitialized memory, leaving the old memory uninitialized
+    static void relocate(T* dst, T* src, int count) {
+        if constexpr (Trivial) {
+            memcpy(dst, src, (size_t)count * sizeof(T));
+        } else {
+            for (int i = 0; i < count; i++) {
+                new (&dst[i]) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    static void destroyElements(T* elements, int count) {
+        if constexpr (!Trivial) {
+            for (int i = 0; i < count; i++) {
+                elements[i].~T();
+            }
+        }
+    }
+
+    // destroy every element and free the heap memory, going back to empty and inline
+    void release() {
+        destroyElements(data(), size);
+        if (!isInline()) {
+            allocator.Free(heap);
+        }
+        size = 0;
+        capacity = N;
+    }
+
+    // take other's elements, leaving it empty. This has to be empty before
+    void take(SmallVecData& other) {
+        if (other.isInline()) {
+            relocate((T*)buffer, (T*)other.buffer, other.size);
+        } else {
+            heap = other.heap;
+        }
+        size = other.size;
+        capacity = other.capacity;
+        other.size = 0;
+        other.capacity = N;
+    }
+};
+
+template<typename T, int N, class AllocatorT>
+typename SmallVecData<T, N, AllocatorT>::Allocator SmallVecData<T, N, AllocatorT>::allocator = SmallVecData<T, N, AllocatorT>::Allocator();
+
+// for types that need their constructors and destructors called. Moving only, and cleans up after itself
+template<typename T, int N, class AllocatorT>
+struct SmallVecOwner : SmallVecData<T, N, AllocatorT> {
+    SmallVecOwner() = default;
+
+    SmallVecOwner(SmallVecOwner&& other) {
+        this->take(other);
+    }
+
+    SmallVecOwner& operator=(SmallVecOwner&& other) {
+        if (this != &other) {
+            this->release();
+            this->take(other);
+        }
+        return *this;
+    }
+
+    SmallVecOwner(const SmallVecOwner&) = delete;
+    SmallVecOwner& operator=(const SmallVecOwner&) = delete;
+
+    ~SmallVecOwner() {
+        this->release();
+    }
+};
+
+/* A vector that keeps its first N elements inline and only allocates once it has more than that,
+ * for the many short lists the game has, like the entities close to a chunk.
+ * Has most of Vec's api, with a few differences:
+ * - The elements are at data() instead of data. While they're inline there's no pointer to them,
+ *   because a pointer into the vector itself would be left pointing at the old place whenever it's moved with memcpy.
+ * - clear() empties it but keeps the memory for filling it again, where Vec's frees it. destroy() frees it.
+ * - Growing goes through the GrowthT policy (DoubleGrowth, HalfGrowth or ExactGrowth).
+ *
+ * For trivially copyable types it's plain data like Vec: copying it is a shallow copy once it's on the heap,
+ * and destroy() has to be called when done with it.
+ * Other types (std::string, anything with a destructor) are moved with their move constructors,
+ * and the vector is move only and destroys its elements itself, like a std::vector.
+ */
+template<typename T, int N, class AllocatorT = DefaultAllocator, class GrowthT = DoubleGrowth>
+struct SmallVec : std::conditional_t<std::is_trivially_copyable<T>::value, SmallVecData<T, N, AllocatorT>, SmallVecOwner<T, N, AllocatorT>> {
+    using Type = T;
+    using Growth = GrowthT;
+    static constexpr int InlineCapacity = N;
+
+private:
+    using Self = SmallVec<T, N, AllocatorT, GrowthT>;
+    using Data = SmallVecData<T, N, AllocatorT>;
+    using Data::Trivial;
+    using Data::relocate;
+    using Data::destroyElements;
+public:
+    using Data::size;
+    using Data::capacity;
+    using Data::allocator;
+    using Data::data;
+    using Data::isInline;
+
+    // starts empty, with the inline buffer
+    SmallVec() = default;
+
+    static Self Empty() {
+        return Self();
+    }
+
+    static Self WithCapacity(int capacity) {
+        Self self;
+        self.reserve(capacity);
+        return self;
+    }
+
+    static Self From(ArrayRef<T> elements) {
+        Self self;
+        self.push(elements);
+        return self;
+    }
+
+    inline T* get(int index) {
+        if (index < size && index > -1) {
+            return &data()[index];
+        }
+        return nullptr;
+    }
+
+    inline T& operator[](int index) {
+#ifdef BOUNDS_CHECKS
+        assert(index < size    && "vector index out of bounds");
+        assert(index > -1      && "vector index out of bounds");
+#endif
+        return data()[index];
+    }
+
+    inline const T& operator[](int index) const {
+#ifdef BOUNDS_CHECKS
+        assert(index < size    && "vector index out of bounds");
+        assert(index > -1      && "vector index out of bounds");
+#endif
+        return data()[index];
+    }
+
+    // construct an element at the back from the arguments
+    template<typename... Args>
+    T& emplace(Args&&... args) {
+        if (size == capacity) {
+            // the arguments could be elements of this vector, so make the element before they move
+            T value(std::forward<Args>(args)...);
+            grow(size + 1);
+            return *new (&data()[size++]) T(std::move(value));
+        }
+        return *new (&data()[size++]) T(std::forward<Args>(args)...);
+    }
+
+    void push(const T& val) {
+        emplace(val);
+    }
+
+    void push(T&& val) {
+        emplace(std::move(val));
+    }
+
+    void push(const T* elements, int count) {
+        assert(count >= 0 && "can't push less than 0 elements!");
+        // the elements could be this vector's own, which move when it grows
+        const T* old = data();
+        if (elements >= old && elements < old + size) {
+            ptrdiff_t offset = elements - old;
+            reserve(size + count);
+            elements = data() + offset;
+        } else {
+            reserve(size + count);
+        }
+        T* end = data() + size;
+        if constexpr (Trivial) {
+            memcpy(end, elements, (size_t)count * sizeof(T));
+        } else {
+            for (int i = 0; i < count; i++) {
+                new (&end[i]) T(elements[i]);
+            }
+        }
+        size += count;
+    }
+
+    void push(ArrayRef<T> elements) {
+        push(elements.data(), (int)elements.size());
+    }
+
+    void pop() {
+        assert(size > 0 && "can't pop element of empty vector");
+        destroyElements(&data()[--size], 1);
+    }
+
+    T popBack() {
+        assert(size > 0 && "can't pop back element of empty vector");
+        T* last = &data()[--size];
+        T value = std::move(*last);
+        destroyElements(last, 1);
+        return value;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    // reserve atleast capacity
+    // \returns the new capacity of the vec
+    int reserve(int capacity) {
+        assert(capacity >= 0 && "cannot have negative capacity");
+        if (this->capacity < capacity) {
+            grow(capacity);
+        }
+        return this->capacity;
+    }
+
+    // resize the vector. New elements of trivial types are left uninitialized like with Vec, other types are default constructed
+    void resize(int size) {
+        assert(size >= 0 && "cannot have negative size");
+        if (size < this->size) {
+            destroyElements(&data()[size], this->size - size);
+        } else {
+            reserve(size);
+            if constexpr (!Trivial) {
+                for (int i = this->size; i < size; i++) {
+                    new (&data()[i]) T();
+                }
+            }
+        }
+        this->size = size;
+    }
+
+    void resize(int size, const T& value) {
+        assert(size >= 0 && "cannot have negative size");
+        if (size < this->size) {
+            destroyElements(&data()[size], this->size - size);
+            this->size = size;
+            return;
+        }
+        // value could be one of the elements, so copy it before growing
+        T copy = value;
+        reserve(size);
+        for (int i = this->size; i < size; i++) {
+            new (&data()[i]) T(copy);
+        }
+        this->size = size;
+    }
+
+    /* Reserve space for \p size elements at the back and increase the vector's size by that amount, leaving the elements in those spaces unitialized.
+     * Like a push but without initialization, so only for trivial types.
+     * \return The address of the elements required.
+     */
+    T* require(int size) {
+        static_assert(Trivial, "can't leave complex types uninitialized");
+        reserve(this->size + size);
+        this->size += size;
+        return &data()[this->size - size];
+    }
+
+    // destroy every element, keeping the memory they were in (unlike Vec::clear)
+    void clear() {
+        destroyElements(data(), size);
+        size = 0;
+    }
+
+    // destroy every element and free the heap memory, leaving it empty, inline and still usable
+    void destroy() {
+        this->release();
+    }
+
+    T& back() {
+       assert(size > 0 && "can't get element of empty vector");
+       return data()[size-1];
+    }
+
+    T& front() {
+       assert(size > 0 && "can't get element of empty vector");
+       return data()[0];
+    }
+
+    void remove(int index) {
+        assert(index < size && "vector index out of bounds");
+        assert(index > -1    && "vector index out of bounds");
+
+        T* elements = data();
+        if constexpr (Trivial) {
+            memmove(&elements[index], &elements[index+1], (size_t)(size - index - 1) * sizeof(T));
+        } else {
+            for (int i = index; i < size-1; i++) {
+                elements[i] = std::move(elements[i+1]);
+            }
+            elements[size-1].~T();
+        }
+        size--;
+    }
+
+    ArrayRef<T> ref() const {
+        return ArrayRef<T>(data(), (size_t)size);
+    }
+
+    using iterator = T*; // no iterator bs, just pointer
+
+    inline T* begin() { return data(); }
+    inline T* end() { return data() + size; }
+    inline const T* begin() const { return data(); }
+    inline const T* end() const { return data() + size; }
+
+private:
+    // move the elements to a heap allocation with room for at least needed elements
+    void grow(int needed) {
+        int newCapacity = GrowthT::grow(capacity, needed);
+        assert(newCapacity > N && "growing should always leave the inline buffer");
+        if (isInline()) {
+            T* newData = allocator.template Alloc<T>((size_t)newCapacity);
+            relocate(newData, (T*)this->buffer, size);
+            this->heap = newData;
+        } else if constexpr (Trivial) {
+            this->heap = allocator.template Realloc<T>(this->heap, (size_t)newCapacity);
+        } else {
+            T* newData = allocator.template Alloc<T>((size_t)newCapacity);
+            relocate(newData, this->heap, size);
+            allocator.Free(this->heap);
+            this->heap = newData;
+        }
+        capacity = newCapacity;
+    }
+};
+
+}
+
+using Vector::SmallVec;
+using Vector::DoubleGrowth;
+using Vector::HalfGrowth;
+using Vector::ExactGrowth;
+
+MY_CLASS_END
+
+#endif
@@ -232,6 +232,12 @@ public:
     }
 };
 
+/* A sparse set with values stored densely, in the order they were inserted (until removals swap the last one in).
+ * The sparse side, which maps keys to where their values are, is split into 4 KiB pages that are only allocated once
+ * a key in the page is inserted. Pages without any keys all point to the same page of zeroes, so lookups never have to check
+ * whether a page exists, and a set with a few keys spread over a big range of them only pays for the pages it uses.
+ * Sparse slots hold the dense index plus one, so that zero means the key isn't in the set.
+ */
 template<typename Key, typename Value, typename Index, Key MaxKeyValue>
 struct DenseSparseSet {
     static_assert(std::is_integral<Key>::value, "Key must be usable as index!");
@@ -239,13 +245,22 @@ struct DenseSparseSet {
     using Self = DenseSparseSet<Key, Value, Index, MaxKeyValue>;
 protected:
     using SizeT = int32_t;
-    static constexpr size_t MaximumCapacity = std::numeric_limits<Index>::max();
-    static constexpr Index NullIndex = std::numeric_limits<Index>::max();
+    // one less than the index type can hold, since slots are offset by one
+    static constexpr size_t MaximumCapacity = std::numeric_limits<Index>::max() - 1;
+
+    static constexpr size_t PageBytes = 4096;
+    static constexpr size_t KeysPerPage = PageBytes / sizeof(Index);
+    static constexpr size_t PageShift = ceilLog2(KeysPerPage);
+    static constexpr size_t PageMask = KeysPerPage - 1;
+    static constexpr SizeT MaxPages = (SizeT)(((size_t)MaxKeyValue >> PageShift) + 1);
+
+    alignas(64) static inline const Index ZeroPage[KeysPerPage] = {};
 
     SizeT size; // number of elements in the map
     SizeT capacity; // number of elements allocated for in the map
 
-    Index* set; // a set connecting keys to values | Index by key to get the index of the element corresponding to that key
+    Index** pages; // the sparse set connecting keys to values, by page | Index by key to get one more than the index of the value for the key
+    SizeT pageCount; // number of pages there are pointers for. Keys past them aren't in the set
     Value* values; // a byte buffer for values
     Key* keys; // keys corresponding to each value
 
@@ -253,10 +268,50 @@ protected:
         assert(key >= 0 && key <= MaxKeyValue && "DenseSparseSet key out of bounds!");
     }
 
-    void emptySet() {
-        for (Key key = 0; key <= MaxKeyValue; key++) {
-            set[key] = NullIndex;
+    static Index* zeroPage() {
+        return const_cast<Index*>(ZeroPage);
+    }
+
+    Index getSlot(Key key) const {
+        size_t page = (size_t)key >> PageShift;
+        if (page >= (size_t)pageCount) return 0;
+        return pages[page][(size_t)key & PageMask];
+    }
+
+    // get the slot for a key to set it, allocating its page if it doesn't have one
+    Index* writeSlot(Key key) {
+        SizeT page = (SizeT)((size_t)key >> PageShift);
+        if (UNLIKELY(page >= pageCount)) {
+            reallocatePages(MIN(MAX(page+1, pageCount*2), MaxPages));
+        }
+        if (UNLIKELY(pages[page] == zeroPage())) {
+            pages[page] = Alloc<Index>(KeysPerPage);
+            memset(pages[page], 0, PageBytes);
         }
+        return &pages[page][(size_t)key & PageMask];
+    }
+
+    void reallocatePages(SizeT newPageCount) {
+        pages = Realloc(pages, (size_t)newPageCount);
+        for (SizeT i = pageCount; i < newPageCount; i++) {
+            pages[i] = zeroPage();
+        }
+        pageCount = newPageCount;
+    }
+
+    void reserve(SizeT newSize) {
+        assert((size_t)newSize <= MaximumCapacity && "Too many elements for index type!");
+        if (UNLIKELY(newSize > capacity)) {
+            reallocate(MAX(newSize, capacity*2));
+        }
+    }
+
+    // put the key at the dense index given, without moving any values
+    void setKey(Key key, SizeT index) {
+        Index* slot = writeSlot(key);
+        assert(*slot == 0 && "Attempted to insert key already present in sparse set");
+        *slot = (Index)(index + 1);
+        keys[index] = key;
     }
 public:
     DenseSparseSet() = default;
@@ -265,11 +320,10 @@ public:
         Self self;
         self.size = 0;
         self.capacity = 0;
-        self.set = nullptr;
+        self.pages = nullptr;
+        self.pageCount = 0;
         self.values = nullptr;
         self.keys = nullptr;
-        self.set = Alloc<Index>(MaxKeyValue+1);
-        self.emptySet();
         return self;
     }
 
@@ -278,50 +332,37 @@ public:
     }
 
     DenseSparseSet(SizeT startCapacity)
-    : size(0), capacity(startCapacity) {
+    : size(0), capacity(startCapacity), pages(nullptr), pageCount(0) {
         assert(capacity >= 0  && "Capacity can't be negative!");
         values = Alloc<Value>(startCapacity);
-        set    = Alloc<Index>(MaxKeyValue+1);
         keys   = Alloc<Key>(startCapacity);
-        emptySet();
     }
 
     Value* lookup(Key key) const {
         assertValidKey(key);
 
-        auto index = set[key];
-        if (index != NullIndex)
-            return &values[index];
+        auto slot = getSlot(key);
+        if (slot != 0)
+            return &values[slot - 1];
         else 
             return nullptr;
     }
 
     void insert(Key key, const Value& value) {
         assertValidKey(key);
-        if (UNLIKELY(size + 1 > capacity)) {
-            reallocate(MAX(size+1, capacity*2));
-        }
+        reserve(size + 1);
 
-        const auto index = (Index)size;
-        keys[index] = key;
-        assert(set[key] == NullIndex && "Attempted to insert key already present in sparse set");
-        set[key] = index;
-        memcpy(&values[index], &value, sizeof(Value));
+        setKey(key, size);
+        memcpy(&values[size], &value, sizeof(Value));
         size++;
     }
 
     Value* insert(Key key) {
         assertValidKey(key);
-        if (UNLIKELY(size + 1 > capacity)) {
-            reallocate(MAX(size+1, capacity*2));
-        }
+        reserve(size + 1);
 
-        const auto index = (Index)size;
-        keys[index] = key;
-        assert(set[key] == NullIndex && "Attempted to insert key already present in sparse set");
-        set[key] = index;
-        size++;
-        return &values[index];
+        setKey(key, size);
+        return &values[size++];
     }
 
     // returns the beginning of the range of values for the keys
@@ -329,58 +370,59 @@ public:
         for (auto key : newKeys) {
             assertValidKey(key);
         }
+        reserve(size + (SizeT)newKeys.size());
 
-        if (UNLIKELY(size + newKeys.size() > capacity)) {
-            reallocate(MAX(size+newKeys.size(), capacity*2));
-        }
-
-        const auto startIndex = (Index)size;
-        Value* newValues = &values[startIndex];
-        memcpy(&keys[startIndex], newKeys.data(), newKeys.size() * sizeof(Key));
-        for (SizeT i = 0; i < newKeys.size(); i++) {
-            assert(set[newKeys[i]] == NullIndex && "Attempted to insert key already present in sparse set");
-            set[newKeys[i]] = startIndex + i;
+        const SizeT startIndex = size;
+        for (SizeT i = 0; i < (SizeT)newKeys.size(); i++) {
+            setKey(newKeys[i], startIndex + i);
         }
-        size += newKeys.size();
-        return newValues;
+        size += (SizeT)newKeys.size();
+        return &values[startIndex];
     }
 
-    void insertRange(Key keyBegin, Key keyEnd) {
-        assertValidKey(keyBegin);
-        assertValidKey(keyEnd);
-    
-        SizeT count = (SizeT)IABS(keyEnd - keyBegin);
-
-        if (UNLIKELY(size + count > capacity)) {
-            reallocate(MAX(size+count, capacity*2));
+    // insert every key from keyBegin up to but not including keyEnd
+    // returns the beginning of the range of values for the keys
+    Value* insertRange(Key keyBegin, Key keyEnd) {
+        assert(keyBegin <= keyEnd && "Range of keys is backwards!");
+        SizeT count = (SizeT)(keyEnd - keyBegin);
+        if (count > 0) {
+            assertValidKey(keyBegin);
+            assertValidKey(keyEnd - 1);
         }
+        reserve(size + count);
 
-        const auto startIndex = (Index)size;
-        memcpy(keys + startIndex, keys, count * sizeof(Key));
+        const SizeT startIndex = size;
         for (SizeT i = 0; i < count; i++) {
-            assert(set[keyBegin + i] == NullIndex && "Attempted to insert key already present in sparse set");
-            set[keyBegin + i] = startIndex + i;
+            setKey((Key)(keyBegin + i), startIndex + i);
         }
         size += count;
+        return &values[startIndex];
     }
 
     void remove(Key key) {
         assertValidKey(key);
 
-        const auto indexOfRemoved = set[key];
-        const auto topIndex = (Index)size-1;
+        const auto slot = getSlot(key);
+        assert(slot != 0 && "Attempted to remove key not present in sparse set");
+        const SizeT indexOfRemoved = slot - 1;
+        const SizeT topIndex = size-1;
         const auto topKey = keys[topIndex];
         // move key, value, and index over
         keys[indexOfRemoved] = topKey;
         memcpy(&values[indexOfRemoved], &values[topIndex], sizeof(Value));
-        set[topKey] = NullIndex;
-        assert(set[key] != NullIndex && "Attempted to remove key not present in sparse set");
-        set[key] = indexOfRemoved; // mark removed key as gone
+        *writeSlot(topKey) = (Index)(indexOfRemoved + 1);
+        *writeSlot(key) = 0; // mark removed key as gone. Done last in case the removed key was on top
         size--;
     }
 
+    void removeList(ArrayRef<Key> removedKeys) {
+        for (auto key : removedKeys) {
+            remove(key);
+        }
+    }
+
     bool contains(Key key) const {
-        return key >= 0 && key <= MaxKeyValue && set[key] != NullIndex;
+        return key >= 0 && key <= MaxKeyValue && getSlot(key) != 0;
     }
 
     void reallocate(SizeT newCapacity) {
@@ -397,9 +439,34 @@ public:
         return size;
     }
 
+    // keys in the same order as their values
+    ArrayRef<Key> getKeys() const {
+        return ArrayRef<Key>(keys, (size_t)size);
+    }
+
+    Value* getValues() const {
+        return values;
+    }
+
+    // bytes used to map keys to values, not counting the values and keys themselves
+    size_t sparseBytes() const {
+        size_t bytes = pageCount * sizeof(Index*);
+        for (SizeT i = 0; i < pageCount; i++) {
+            if (pages[i] != zeroPage()) {
+                bytes += PageBytes;
+            }
+        }
+        return bytes;
+    }
+
     void destroy() {
+        for (SizeT i = 0; i < pageCount; i++) {
+            if (pages[i] != zeroPage()) {
+                Free(pages[i]);
+            }
+        }
+        Free(pages);
         Free(values);
-        Free(set);
         Free(keys);
     }
 };
@@ -354,18 +354,6 @@ typename Vec<T, AllocatorT>::Allocator Vec<T, AllocatorT>::allocator = Vec<T, Al
 
 static_assert(sizeof(Generic::Vec) == sizeof(Vec<int>), "GenericVec must have same binary layout as normal vec");
 
-template<typename T, int N = 0>
-struct SmallVector {
-    T* data;
-    int size;
-    int capacity;
-    char buffer[N * sizeof(T)];
-
-    T& operator[](int index) {
-        return data[index];
-    }
-};
-
 /*
 template<typename T1, typename T2, size_t BufferSize>
 struct SmallVectorPair {
@@ -3,6 +3,7 @@
 
 #include <SDL3/SDL.h>
 #include "Tiles.hpp"
+#include "Chunks.hpp"
 #include "rendering/textures.hpp"
 #include "world/entities/entities.hpp"
 #include "world/entities/methods.hpp"
@@ -125,7 +126,7 @@ struct Player {
         if (!ecs->EntityHas<World::EC::Inventory>(entity)) return;
 
         selectedHotbarSlot = index;
-        auto* slot = &inventory()->get(index);
+        ItemStack* slot = inventory()->slotPointer(index);
         if (!slot->empty()) { 
             if (heldItemStack.type != ItemHold::Value) {
                 heldItemStack = ItemHold(ItemHold::Inventory, ItemHold::DataType(slot));
@@ -158,7 +159,8 @@ struct Player {
         return false;
     }
 
-    bool tryPlaceItemStack(ItemStack* stack, Tile* targetTile, ItemManager& itemManager) {
+    bool tryPlaceItemStack(ItemStack* stack, ChunkMap& chunkmap, TileCoord position, ItemManager& itemManager) {
+        Tile* targetTile = getTileAtPosition(chunkmap, position);
         if (!stack || !targetTile) return false;
         if (canPlaceItemStack(*stack, itemManager)) {
             auto placeable = itemManager.getComponent<ITC::Placeable>(stack->item);
@@ -167,17 +169,21 @@ struct Player {
                 // place it
                 targetTile->type = newTileType;
                 stack->reduceQuantity(1);
+                chunkmap.tileChanged(position);
                 return true;
             }
         }
         return false;
     }
 
-    bool tryMineTile(Tile* tile) {
+    bool tryMineTile(ChunkMap& chunkmap, TileCoord position) {
+        Tile* tile = getTileAtPosition(chunkmap, position);
+        if (!tile) return false;
         if (TileTypeData[tile->type].flags & TileTypes::Mineable) {
             // add tile to inventory
             inventory()->addItemStack(ItemStack(TileTypeData[tile->type].mineable.item));
             tile->type = TileTypes::Space;
+            chunkmap.tileChanged(position);
             return true;
         }
         return false;
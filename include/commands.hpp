@@ -6,44 +6,11 @@
 #include <functional>
 #include "utils/Log.hpp"
 #include "llvm/ArrayRef.h"
+#include "CommandRegistry.hpp"
+#include "My/String.hpp"
 
 struct Game;
 
-struct Command {
-    char name[32];
-    std::string description;
-    int nameLength;
-    struct Result {
-        enum Type {
-            Error,
-            Warn,
-            Success,
-            Other,
-            Null
-        } type = Null;
-
-        std::string message;
-
-    };
-    using FunctionType = std::function<Result(const char* arguments)>;
-    FunctionType function;
-
-    static Command make(const char* name, const FunctionType& function) {
-        Command command;
-        int nameLength = (int)strlen(name);
-        if (nameLength < 32) {
-            memcpy(command.name, name, nameLength+1);
-        } else {
-            LogError("Command name passed was longer than allowed! name: %s. max length: %d", name, 32);
-            command.name[0] = '\0';
-            nameLength = 0;
-        }
-        command.nameLength = nameLength;
-        command.function = function;
-        return command;
-    }
-};
-
 struct CommandInput {
     std::string name;
     std::string arguments;
@@ -54,19 +21,25 @@ struct CommandInput {
 };
 
 extern std::vector<Command> gCommands;
+extern CommandTable gCommandTable; // built by setCommands
 
 void setCommands(Game* game);
 
 inline Command::Result executeCommand(Command* command, const char* arguments) {
-    return command->function(arguments);
+    return command->run(arguments);
 }
 
 CommandInput processMessage(std::string message, ArrayRef<Command> possibleCommands);
 
-// returns null if a command can't be found with that name
-inline Command* getCommand(std::string name) {
+// returns null if a command can't be found with that name. Names are matched ignoring case
+inline Command* getCommand(const std::string& name) {
+    if (gCommandTable.commandCount == (int)gCommands.size()) {
+        int index = gCommandTable.find(gCommands, name.c_str(), (int)name.size());
+        return index >= 0 ? &gCommands[index] : nullptr;
+    }
+    // still registering commands
     for (auto& command : gCommands) {
-        if (command.name == name) {
+        if (My::streq_case(command.name, name.c_str(), command.nameLength, (int)name.size())) {
             return &command;
         }
     }
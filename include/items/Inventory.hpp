@@ -3,6 +3,7 @@
 
 #include "Item.hpp"
 #include "manager.hpp"
+#include "My/HashMap.hpp"
 
 struct Header {
     int size;
@@ -28,6 +29,45 @@ struct SizedInventory {
     }
 };
 
+/*
+* Which slots of an inventory hold each item type, and how many of each type there are,
+* so big inventories don't have to look through every slot to find or count items.
+* Each type gets a bitmask of the slots holding it, and there's one more for the empty slots.
+*/
+struct InventoryIndex {
+    struct TypeSlots {
+        ItemType type;
+        ItemQuantity count; // total of every stack of the type, not counting infinite stacks
+        int infiniteStacks;
+    };
+
+    int words; // Uint64s per slot mask
+    My::Vec<TypeSlots> types;
+    My::HashMap<ItemType, int> typeIndices;
+    My::Vec<Uint64> typeMasks; // words for each type, in the same order as types
+    My::Vec<Uint64> emptyMask;
+
+    static InventoryIndex* make(const ItemStack* items, int size);
+
+    void destroy();
+
+    const TypeSlots* find(ItemType type) const {
+        const int* i = typeIndices.lookup(type);
+        return i ? &types[*i] : nullptr;
+    }
+
+    const Uint64* slotsOf(ItemType type) const {
+        const int* i = typeIndices.lookup(type);
+        return i ? &typeMasks[*i * words] : nullptr;
+    }
+
+    // a slot went from one stack to another
+    void update(int slot, const ItemStack& before, const ItemStack& after);
+
+private:
+    int typeIndex(ItemType type);
+};
+
 /*
 * An inventory storing a number of item stacks
 */
@@ -39,7 +79,11 @@ struct Inventory {
     //Uint16 endIndex = 0; // the index one past the index of the last non-empty item slot
     ItemManager* manager = NULL;
     int refCount = 0;
+    // only for big inventories. When there is one, slots have to be changed with setSlot or the other methods
+    InventoryIndex* index = NULL;
     constexpr static int InfiniteSize = -1;
+    // inventories at least this big get an index
+    constexpr static int IndexMinSize = 64;
 
     Inventory() = default;
     
@@ -49,6 +93,9 @@ struct Inventory {
         for (int i = 0; i < size; i++) {
             items[i] = ItemStack::None();
         }
+        if (size >= IndexMinSize) {
+            enableIndex();
+        }
     }
 
     void addRef() {
@@ -62,32 +109,58 @@ struct Inventory {
     }
 
     void destroy() {
+        disableIndex();
         manager->inventoryAllocator.deallocate(items, size);
         size = 0;
         items = NULL;
     }
 
-    ItemType& type(int slot) const {
+    // keep track of which slots hold what, from now on
+    void enableIndex();
+
+    void disableIndex() {
+        if (index) {
+            index->destroy();
+            Free(index);
+            index = NULL;
+        }
+    }
+
+    // change a slot, keeping the index up to date
+    void setSlot(int slot, ItemStack stack) {
+        assert(slot >= 0 && slot < this->size && "inventory item index out of bounds!");
+        ItemStack& current = items[slot];
+        if (index) {
+            index->update(slot, current, stack);
+        }
+        current = stack;
+    }
+
+    ItemType type(int slot) const {
         return items[slot].item.type;
     }
 
-    ItemQuantity& quantity(int slot) const {
+    ItemQuantity quantity(int slot) const {
         return items[slot].quantity;
     }
 
-    Entity& entity(int slot) const {
+    Entity entity(int slot) const {
         return items[slot].item;
     }
 
-    inline ItemStack& get(Sint32 itemIndex) {
+    // read only, so every change goes through setSlot and the index can't miss it
+    inline const ItemStack& get(Sint32 itemIndex) const {
         assert(itemIndex >= 0 && itemIndex < this->size && "inventory item index out of bounds!");
         return items[itemIndex];
     }
 
-    inline const ItemStack& get(Sint32 itemIndex) const {
-        //assert(itemIndex >= this->startIndex && itemIndex < this->endIndex && "inventory item index out of bounds! The start and end indices may be incorrect.");
-        assert(itemIndex < size && itemIndex >= 0);
-        return items[itemIndex];
+    /* For holding on to a slot and changing it in place, like the player holding a stack from their hotbar.
+     * An index can't see changes made that way, so only inventories without one can hand out their slots
+     */
+    ItemStack* slotPointer(int slot) {
+        assert(!index && "Slots of indexed inventories have to be changed with setSlot");
+        assert(slot >= 0 && slot < this->size && "inventory item index out of bounds!");
+        return &items[slot];
     }
 
     bool empty() const {
@@ -99,6 +172,13 @@ struct Inventory {
         return size == InfiniteSize;
     }
 
+    // let anything watching the inventory know items were put in (added) or taken out, making room
+    void changed(bool added) const {
+        if (manager && manager->onInventoryChanged) {
+            manager->onInventoryChanged(items, added);
+        }
+    }
+
     /*
     * Get the first available item stack in the inventory, skipping empty item stacks,
     * and remove it from the inventory.
@@ -123,10 +203,6 @@ struct Inventory {
     */
     ItemQuantity itemCount(ItemType type);
 
-    inline ItemStack& operator[](Uint32 index) {
-        return get(index);
-    }
-
     inline const ItemStack& operator[](Uint32 index) const {
         return get(index);
     }
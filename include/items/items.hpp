@@ -14,7 +14,7 @@ inline ItemStack makeGrenadeStack(ItemManager& manager, ItemQuantity quantity =
     auto grenade = manager.newItem(ItemTypes::Grenade);
     manager.addComponent<ITC::Wetness>(grenade, {10});
     manager.addComponent(grenade, ITC::Durability{10});
-    ItemStack stack(grenade, quantity);
+    ItemStack stack(manager.intern(grenade), quantity);
     return stack;
 }
 
@@ -23,7 +23,7 @@ namespace Items {
         auto i = manager.newItem(ItemTypes::SandGun);
         manager.addComponent<ITC::Durability>(i, {100});
         manager.addComponent<ITC::Display>(i, ITC::Display{TextureIDs::Tiles::Sand});
-        return i;
+        return manager.intern(i);
     }
 }
 
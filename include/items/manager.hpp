@@ -7,43 +7,117 @@
 
 namespace items {
 
-// TODO: Improve efficiency by using a custom allocation method
+/*
+ * Inventories come in a handful of sizes and get made and destroyed all the time, so instead of going to malloc
+ * for each one, slots are handed out in blocks from big slabs. Blocks come in size classes of powers of two slots,
+ * and freed blocks go on a free list for their class to be used again.
+ * Anything bigger than the biggest class just uses malloc.
+ */
 struct InventoryAllocator {
     using SizeT = Sint32;
 
-    //ItemStack* stackBuffer;
+    static constexpr int MinClassShift = 3; // smallest class is 8 slots
+    static constexpr int NumSizeClasses = 8; // biggest class is 1024 slots
+    static constexpr size_t SlabSize = 64 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // first bytes of every slab
+    struct SlabHeader {
+        SlabHeader* next;
+        size_t size;
+    };
+
+    FreeBlock* freeLists[NumSizeClasses] = {nullptr};
+    SlabHeader* slabs = nullptr;
+    int blocksInUse = 0;
+    int slabCount = 0;
 
     InventoryAllocator() = default;
 
-    InventoryAllocator(SizeT bufferSize) {
+    ItemStack* allocate(SizeT size);
 
-    }
+    void deallocate(ItemStack* stacks, SizeT size);
 
-    ItemStack* allocate(SizeT size) {
-        return Alloc<ItemStack>(size);
-    }
+    // free every slab. Anything still allocated from them is gone
+    void destroy();
 
-    void deallocate(ItemStack* stacks, SizeT size) {
-        Free(stacks);
-        (void)size;
+    static int sizeClass(SizeT size) {
+        int sizeClass = 0;
+        while ((1 << (sizeClass + MinClassShift)) < size) {
+            sizeClass++;
+        }
+        return sizeClass;
     }
 };
 
+struct ItemReferences {
+    Uint64 contentHash;
+    Sint32 refCount;
+    bool interned;
+    Item nextSameHash; // the next interned item whose contents hash the same, or none
+};
+
+/*
+ * Items are stored canonically. Once an item is made it gets interned, and if an item with the same type
+ * and the same component values already exists, the new one is deleted and the existing one is used instead.
+ * So every copy of an item shares one entity, its handle (the entity) is the same for all of them,
+ * and telling if two items are the same is just comparing handles.
+ * Items are reference counted and deleted once nothing references them.
+ * Whatever holds an item holds one reference to it, no matter how many of the item it holds: a slot, an inserter's hand,
+ * a belt, or an item stack on the ground. Inventories take their own references for the slots they fill,
+ * so whoever handed them the stack still holds theirs and has to release it when they're done with it.
+ * Changing a shared item would change every copy of it, so unshare it first to get a copy of your own to change,
+ * then intern it again when done.
+ */
 struct ItemManager : ECS::EntityManager {
     InventoryAllocator inventoryAllocator;
+    // called whenever the contents of an inventory change, with the inventory's items to tell which one it was.
+    // added is true when items were put in, and false when they were taken out
+    std::function<void(const ItemStack* inventoryItems, bool added)> onInventoryChanged;
+
+    My::HashMap<Uint64, Item> canonicalItems; // hash of the contents to the first interned item with that hash
+    My::Vec<ItemReferences> references; // indexed by item entity id
 
     ItemManager() {}
 
     ItemManager(ECS::ComponentInfoRef componentInfo, int numPrototypes)
      : ECS::EntityManager(componentInfo, numPrototypes),
        inventoryAllocator() {
-
+        canonicalItems = My::HashMap<Uint64, Item>::WithBuckets(64);
+        references = My::Vec<ItemReferences>::Empty();
     }
 
-    Item newItem(ItemType type) {
-        Entity entity = this->newEntity(type);
-        return Item(type, entity);
+    // make a new item with one reference, that isn't interned yet so its components can be set
+    Item newItem(ItemType type);
+
+    // get the canonical item with the same contents as this one, deleting this one if there already was one
+    Item intern(Item item);
+
+    void retain(Item item);
+
+    // delete the item once there are no more references to it
+    void release(Item item);
+
+    // get an item that can be changed without changing any other copies of it. Uses up one reference to the item
+    Item unshare(Item item);
+
+    Sint32 refCount(Item item) const;
+
+    // free every item and inventory slab along with the entities
+    void destroy() {
+        canonicalItems.destroy();
+        references.destroy();
+        inventoryAllocator.destroy();
+        ECS::EntityManager::destroy();
     }
+
+private:
+    ItemReferences* getReferences(Item item);
+    // take an interned item out of the canonical items, so it can be changed or deleted
+    void removeCanonical(Item item);
 };
 
 using PrototypeManager = ECS::PrototypeManager;
@@ -51,8 +125,7 @@ using PrototypeManager = ECS::PrototypeManager;
 using ItemPrototype = ECS::Prototype;
 
 inline void freeItem(Item item, ItemManager& manager) {
-    // TODO:
-    LogInfo("Item should be freed.");
+    manager.release(item);
 }
 
 void destroyItem(Item* item, ItemManager& manager);
@@ -66,10 +139,9 @@ inline ItemQuantity getStackSize(Item item, const ItemManager& manager) {
     return stackSizeComponent ? stackSizeComponent->quantity : 0;
 }
 
+// items are interned, so the same items always have the same handle
 inline bool isSame(const Item& lhs, const Item& rhs) {
-    return (lhs.type == rhs.type)
-        && (lhs.id == rhs.id)
-        && (lhs.version == rhs.version);
+    return (lhs.id == rhs.id) && (lhs.version == rhs.version);
 }
 
 /* Combine the two item stacks into one
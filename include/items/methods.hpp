@@ -16,16 +16,12 @@ int getFirstItemOfType(Inventory& inventory, ItemType type) {
 }
 
 void moveItemStack(Inventory* dst, int dstSlot, Inventory* src, int srcSlot) {
-    auto& srcStack = src->get(srcSlot);
-    auto& dstStack = dst->get(dstSlot);
+    const ItemStack srcStack = src->get(srcSlot);
 
-    assert(dstStack.empty() && "slot must be empty to be moved to");
+    assert(dst->get(dstSlot).empty() && "slot must be empty to be moved to");
 
-    dstStack = srcStack;
-    srcStack = ItemStack::None();
-
-    src->size--;
-    dst->size++;
+    dst->setSlot(dstSlot, srcStack);
+    src->setSlot(srcSlot, ItemStack::None());
 }
 
 }
\ No newline at end of file
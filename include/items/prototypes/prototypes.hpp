@@ -24,7 +24,7 @@ struct Tile : public ItemPrototype {
         m.addComponent<ITC::Placeable>(i, {tile});
         m.addComponent<ITC::Display>(i, ITC::Display{TileTypeData[tile].background});
         
-        return i;
+        return m.intern(i);
     }
 };
 
@@ -42,7 +42,7 @@ struct Grenade : public items::ItemPrototype {
     static Item make(ItemManager& manager) {
         Item i = manager.newItem(ItemTypes::Grenade);
         manager.addComponent<ITC::Display>(i, {TextureIDs::Grenade});
-        return i;
+        return manager.intern(i);
     }
 };
 
@@ -61,7 +61,7 @@ struct SandGun : ItemPrototype {
     static Item make(ItemManager& manager) {
         auto i = manager.newItem(ItemTypes::SandGun);
         manager.addComponent<ITC::Display>(i, {TextureIDs::Tiles::Sand});
-        return i;
+        return manager.intern(i);
     }
 
     static bool onUse(Game* g);
@@ -2,11 +2,109 @@
 #define MEMORY2_INCLUDED
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <functional>
 #include <cassert>
 
+/* Allocation tracking
+ * With MEMORY_TRACKING set to 1 (like with -DMEMORY_TRACKING=1), every allocation going through the Mem:: wrappers,
+ * and so every My::IAllocator and everything using Alloc, Realloc and Free, is kept track of with its size,
+ * the subsystem it was made for and where it was made, for memory stats and a leak report at the end.
+ * With it off, none of the tracking code is compiled in at all.
+ */
+#ifndef MEMORY_TRACKING
+#define MEMORY_TRACKING 0
+#endif
+
+#define MEMORY_TAG_LIST(TAG) \
+    TAG(General) \
+    TAG(Entities) \
+    TAG(World) \
+    TAG(Physics) \
+    TAG(Rendering) \
+    TAG(Gui)
+
 namespace Mem {
 
+namespace MemoryTags {
+    #define MEMORY_TAG_ENUM(name) name,
+    enum MemoryTag {
+        MEMORY_TAG_LIST(MEMORY_TAG_ENUM)
+        Count
+    };
+    #undef MEMORY_TAG_ENUM
+
+    #define MEMORY_TAG_NAME(name) #name,
+    constexpr const char* Names[] = {
+        MEMORY_TAG_LIST(MEMORY_TAG_NAME)
+    };
+    #undef MEMORY_TAG_NAME
+}
+
+using MemoryTag = MemoryTags::MemoryTag;
+
+struct MemoryTagStats {
+    size_t liveBytes;
+    size_t peakBytes;
+    size_t liveAllocations;
+    size_t allocations; // since the start, counting reallocations
+    size_t allocatedBytes; // since the start
+};
+
+struct MemoryStats {
+    MemoryTagStats tags[MemoryTags::Count];
+    MemoryTagStats total;
+    size_t lastFrameAllocations; // allocations made in the last whole frame
+    double allocationsPerSecond; // over the last second or so
+    double bytesPerSecond;
+};
+
+/* All of these do nothing (and the stats are all zero) when MEMORY_TRACKING is off */
+
+// whether allocations are being tracked, same as MEMORY_TRACKING
+bool trackingAllocations();
+MemoryStats memoryStats();
+// number of allocations since the start, for counting the allocations made doing something
+size_t allocationCount();
+// start counting the allocations in a new frame
+void newFrame();
+/* Write every allocation still alive, grouped by where it was made, biggest first
+ * @param maxSites the most places to list
+ */
+void leakReport(FILE* out, int maxSites = 32);
+
+#if MEMORY_TRACKING
+/* Record allocations and frees. The wrappers call these, so they're only needed for memory that doesn't go through them.
+ * The place an allocation was made is found from the stack unless a file and line are given
+ */
+void trackAlloc(void* ptr, size_t size, const char* file = nullptr, int line = 0);
+void trackFree(void* ptr);
+// give an allocation that's already tracked a file and line instead of a place found from the stack
+void trackSite(void* ptr, const char* file, int line);
+
+// the subsystem allocations on this thread are tagged with
+MemoryTag currentMemoryTag();
+// @return The tag that was set before
+MemoryTag setMemoryTag(MemoryTag tag);
+
+// Tag allocations on this thread with a subsystem until the scope ends
+struct MemoryTagScope {
+    MemoryTag previous;
+
+    MemoryTagScope(MemoryTag tag) : previous(setMemoryTag(tag)) {}
+    ~MemoryTagScope() {
+        setMemoryTag(previous);
+    }
+};
+
+#define MEMORY_TAG_CONCAT2(a, b) a##b
+#define MEMORY_TAG_CONCAT(a, b) MEMORY_TAG_CONCAT2(a, b)
+// Tag every allocation on this thread until the end of the scope with a tag from MEMORY_TAG_LIST
+#define MEMORY_TAG(tag) Mem::MemoryTagScope MEMORY_TAG_CONCAT(memoryTagScope, __LINE__)(Mem::MemoryTags::tag)
+#else
+#define MEMORY_TAG(tag) do {} while(0)
+#endif
+
 /* Wrappers */
 
 void* _malloc(size_t size);
@@ -52,8 +150,8 @@ void* safe_realloc(void* oldMem, size_t size);
 
 /* Debug versions */
 
-void* debug_malloc(void *malloc_func(size_t), size_t size, const char* file, int line);
-void debug_free(void free_func(void*), void* ptr, const char* file, int line) noexcept;
+void* debug_malloc(size_t size, const char* file, int line);
+void debug_free(void* ptr, const char* file, int line) noexcept;
 
 } // namespace Mem
 
@@ -72,7 +170,9 @@ inline void init(std::function<void()> _needMemoryCallback, std::function<void()
 }
 
 inline void quit() {
-    // nothing yet
+#if MEMORY_TRACKING
+    leakReport(stderr);
+#endif
 }
 
 /*
@@ -95,6 +195,9 @@ inline void* aligned_malloc(size_t size, size_t alignment, bool nonnull = false)
     int code = posix_memalign(&memory, alignment, size);
     (void)code;
     // TODO: something with error code
+#if MEMORY_TRACKING
+    if (code == 0) trackAlloc(memory, size);
+#endif
     return memory;
 }
 
@@ -1,6 +1,130 @@
 #ifndef PHYSICS_PHYSICS_INCLUDED
 #define PHYSICS_PHYSICS_INCLUDED
 
-int physics_test();
+#include <functional>
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "ECS/Entity.hpp"
+#include "utils/vectors_and_rects.hpp"
 
-#endif
\ No newline at end of file
+namespace Physics {
+
+/*
+ * 2D collision between bodies, and between bodies and solid tiles.
+ * Bodies are boxes or circles. Moving bodies are put in a uniform grid every step, by sorting them by the cells they cover,
+ * so only bodies sharing a cell get tested against each other.
+ * Static bodies, like trees and buildings, go in a grid of their own once, when they're added, and stay there until they're removed.
+ * Overlapping bodies are bounced off each other with impulses along the contact normal,
+ * then pushed apart so they don't stay inside each other.
+ * Everything happens in the order of the bodies and the grid, never the order of a hash map or a pointer,
+ * so the same bodies moved the same way always end up in the same place.
+ */
+
+using BodyID = int;
+constexpr BodyID NullBody = -1;
+
+enum class Shape : Uint8 {
+    Box,
+    Circle
+};
+
+struct Body {
+    Vec2 position; // the center
+    Vec2 velocity; // distance moved each step
+    Vec2 halfSize; // for circles, both are the radius
+    float inverseMass; // 0 for static bodies
+    float restitution; // how much of the speed into a contact bounces back
+    Entity entity;
+    Uint32 lastQuery; // the static query the body was last found by, so bodies in more than one cell are only tested once
+    Shape shape;
+    bool isStatic;
+    bool tileCollision; // whether the body is stopped by solid tiles
+    bool alive;
+
+    Vec2 min() const {
+        return position - halfSize;
+    }
+
+    Vec2 max() const {
+        return position + halfSize;
+    }
+};
+
+struct Contact {
+    BodyID a;
+    BodyID b; // NullBody for a tile
+    Vec2 normal; // from a to b
+    float depth;
+    Vec2 offset; // b's position minus a's when the contact was found
+    Vec2 tile; // center of the tile for tile contacts
+};
+
+struct StaticCellNode {
+    BodyID body;
+    int next; // -1 at the end of the cell
+};
+
+struct SpaceStats {
+    int bodies;
+    int staticBodies;
+    int pairsTested; // pairs that got to the narrowphase
+    int contacts;
+    int tileContacts;
+};
+
+struct Space {
+    static constexpr float CellSize = 2.0f;
+    static constexpr int VelocityIterations = 4;
+    static constexpr int PositionIterations = 4;
+    // how much of the overlap is pushed out each position iteration
+    static constexpr float CorrectionPercent = 0.8f;
+    // overlap that's allowed so resting bodies don't jitter
+    static constexpr float CorrectionSlop = 0.005f;
+
+    My::Vec<Body> bodies;
+    My::Vec<BodyID> freeBodies;
+    My::HashMap<Uint32, BodyID> byEntity; // entity id to body
+    // cell to the first static body node in it, or -1 when it's empty
+    My::HashMap<IVec2, int, IVec2Hash> staticCells;
+    My::Vec<StaticCellNode> staticNodes;
+    My::Vec<int> freeStaticNodes;
+    Uint32 queryCount;
+    SpaceStats stats;
+
+    // whether a tile stops bodies
+    std::function<bool(IVec2 tile)> solidTile;
+
+    My::Vec<Uint64> cellEntries; // moving bodies by cell, cell in the top 32 bits and body in the bottom
+    My::Vec<Uint64> sortScratch;
+    My::Vec<Contact> contacts;
+
+    static Space init();
+
+    void destroy();
+
+    BodyID addBody(Shape shape, Vec2 position, Vec2 halfSize, bool isStatic, Entity entity = NullEntity);
+
+    void removeBody(BodyID body);
+
+    // get the body of the entity, or null if it doesn't have one
+    Body* bodyOf(Entity entity);
+
+    // static bodies have to be moved through this so they stay in the right cells
+    void moveStatic(BodyID body, Vec2 position);
+
+    // move every body by its velocity, then resolve the collisions
+    void step();
+
+private:
+    void linkStatic(BodyID body);
+    void unlinkStatic(BodyID body);
+    void findContacts();
+    void findStaticContacts(BodyID body);
+    void findTileContacts(BodyID body);
+    void solveVelocities();
+    void solvePositions();
+};
+
+}
+
+#endif
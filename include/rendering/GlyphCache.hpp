@@ -0,0 +1,134 @@
+#ifndef RENDERING_GLYPH_CACHE_INCLUDED
+#define RENDERING_GLYPH_CACHE_INCLUDED
+
+#include <glm/vec2.hpp>
+#include "../sdl_gl.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "TexturePacker.hpp"
+
+// a texture will be bound on the current active texture unit
+inline GLuint loadFontAtlasTexture(Texture atlas, GLint minFilter, GLint magFilter) {
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RED,
+        atlas.size.x,
+        atlas.size.y,
+        0,
+        GL_RED,
+        GL_UNSIGNED_BYTE,
+        atlas.buffer
+    );
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+    return textureID;
+}
+
+using Codepoint = Uint32;
+
+constexpr Codepoint ReplacementCodepoint = 0xFFFD;
+constexpr Codepoint InvalidCodepoint = 0xFFFFFFFF;
+
+// Decode one utf-8 encoded codepoint from text. Returns the number of bytes it took up, which is always at least 1 when length > 0.
+// Invalid or cut off sequences decode to ReplacementCodepoint and only take up a single byte.
+int decodeUTF8(const char* text, int length, Codepoint* codepointOut);
+
+// length in bytes of the utf-8 sequence that starts with this byte. 1 for invalid lead bytes
+inline int utf8SequenceLength(char leadByte) {
+    unsigned char c = (unsigned char)leadByte;
+    if (c < 0x80) return 1;
+    if ((c & 0xE0) == 0xC0) return 2;
+    if ((c & 0xF0) == 0xE0) return 3;
+    if ((c & 0xF8) == 0xF0) return 4;
+    return 1;
+}
+
+inline bool isUTF8Continuation(char byte) {
+    return ((unsigned char)byte & 0xC0) == 0x80;
+}
+
+struct Glyph {
+    glm::vec<2, uint16_t> position; // in the atlas, in pixels
+    glm::vec<2, uint16_t> size;
+    glm::vec<2,  int16_t> bearing;
+                uint16_t  advance;
+    Uint32 lastUsedFrame;
+};
+
+/*
+ * Glyphs of a font, rasterized with freetype the first time they're used and packed into a single atlas page.
+ * Looking up a glyph that's already been rasterized is a single hash lookup.
+ * The atlas only grows in the middle of a frame so glyph positions stay put; once it gets too big, glyphs that
+ * haven't been used in a while are evicted and the rest are repacked at the start of the next frame (see compact).
+ */
+struct GlyphCache {
+    FT_Face face = nullptr;
+    bool usingSDFs = false;
+
+    My::Vec<Glyph> glyphs;
+    My::Vec<int> freeGlyphs;
+    My::HashMap<Codepoint, int> glyphIndices; // codepoint -> index into glyphs
+    My::Vec<Codepoint> glyphCodepoints; // reverse of glyphIndices. InvalidCodepoint for free glyph slots
+
+    TexturePackingAtlas packer;
+
+    GLuint texture = 0;
+    glm::ivec2 textureSize = {0, 0}; // size of the texture on the gpu, can lag behind the packer until uploaded
+    int dirtyMinRow = INT_MAX; // rows of the atlas that changed since the last upload
+    int dirtyMaxRow = -1;
+
+    bool needsCompaction = false;
+
+    struct Stats {
+        int rasterized;
+        int evicted;
+        int compactions;
+    } stats = {0, 0, 0};
+
+    // glyphs not used for this many frames can be evicted when compacting
+    static constexpr Uint32 ColdGlyphFrames = 300;
+    // when the atlas goes over this size (in pixels, on both axes) it will be compacted next frame
+    static constexpr int MaxAtlasSize = 2048;
+    static constexpr int StartAtlasSize = 256;
+    static constexpr int GlyphPadding = 1; // empty pixels between glyphs, so they don't bleed into each other when filtering
+
+    static GlyphCache init(FT_Face face, bool usingSDFs);
+
+    // get the glyph for the codepoint, rasterizing it if it isn't cached yet.
+    // Codepoints missing from the font get the font's missing glyph (usually a box)
+    Glyph get(Codepoint codepoint);
+
+    // upload changed parts of the atlas to the texture on the given unit. Needs to be called before drawing with the texture
+    void upload(TextureUnit unit, GLint minFilter, GLint magFilter);
+
+    // evict cold glyphs and repack the rest if the atlas got too big. Moves glyphs around, so
+    // this returns true when any glyph positions changed and layouts using them need to be redone
+    bool compact();
+
+    int glyphCount() const {
+        return glyphIndices.size;
+    }
+
+    glm::ivec2 atlasSize() const {
+        return packer.atlas.size;
+    }
+
+    void destroy();
+
+private:
+    int rasterize(Codepoint codepoint);
+    void markDirty(int minRow, int maxRow);
+};
+
+#endif
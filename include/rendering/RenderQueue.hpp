@@ -0,0 +1,105 @@
+#ifndef RENDERING_RENDER_QUEUE_INCLUDED
+#define RENDERING_RENDER_QUEUE_INCLUDED
+
+#include "gl.hpp"
+#include "My/Vec.hpp"
+#include "shaders.hpp"
+#include "stats.hpp"
+
+struct RenderContext;
+
+/*
+ * 64 bit key that draw submissions are sorted by. Most significant first:
+ * [63..56] layer   - pass / layer ordering, always respected
+ * [55..48] shader  - ShaderID, so commands using the same shader end up next to each other
+ * [47..32] texture - texture unit or other texture identifier
+ * [31..0]  depth   - float depth converted to sort the same way as an unsigned integer
+ */
+using RenderSortKey = Uint64;
+
+constexpr Uint8 RenderKeyNoShader = 0xFF; // for commands that set up their own shader
+
+inline Uint32 sortableDepth(float depth) {
+    Uint32 bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    // flip all bits of negative floats, and just the sign bit of positive floats
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+inline RenderSortKey makeRenderSortKey(Uint8 layer, Uint8 shader, Uint16 texture, float depth) {
+    return ((RenderSortKey)layer   << 56)
+         | ((RenderSortKey)shader  << 48)
+         | ((RenderSortKey)texture << 32)
+         | (RenderSortKey)sortableDepth(depth);
+}
+
+inline Uint8 renderKeyLayer(RenderSortKey key) {
+    return (Uint8)(key >> 56);
+}
+
+inline Uint8 renderKeyShader(RenderSortKey key) {
+    return (Uint8)(key >> 48);
+}
+
+inline Uint16 renderKeyTexture(RenderSortKey key) {
+    return (Uint16)(key >> 32);
+}
+
+struct RenderCommand {
+    using DrawFunction = void(RenderContext& ren, void* userdata);
+
+    RenderSortKey key;
+    GLuint vao; // bound by the queue before drawing. 0 if the draw function binds its own
+    DrawFunction* draw;
+    void* userdata; // must live until the queue is executed
+};
+
+/*
+ * Draw submissions for a pass. Commands are radix sorted by key when executed,
+ * and shader and vao changes between neighbouring commands are only made when the key actually changes.
+ */
+struct RenderQueue {
+    struct SortEntry {
+        RenderSortKey key;
+        Uint32 command;
+    };
+
+    My::Vec<RenderCommand> commands;
+    // scratch buffers for sorting, kept around so sorting doesn't allocate every frame
+    My::Vec<SortEntry> sorted;
+    My::Vec<SortEntry> sortTemp;
+
+    RenderQueue() {}
+
+    static RenderQueue init(int reserve = 32) {
+        RenderQueue queue;
+        queue.commands = My::Vec<RenderCommand>::WithCapacity(reserve);
+        queue.sorted = My::Vec<SortEntry>::WithCapacity(reserve);
+        queue.sortTemp = My::Vec<SortEntry>::WithCapacity(reserve);
+        return queue;
+    }
+
+    void submit(RenderSortKey key, GLuint vao, RenderCommand::DrawFunction* draw, void* userdata) {
+        commands.push(RenderCommand{key, vao, draw, userdata});
+    }
+
+    // sort the submitted commands by key, the result is in sorted
+    void sort();
+
+    // sort and draw all submitted commands, then clear the queue
+    void execute(RenderContext& ren);
+
+    void clear() {
+        commands.size = 0;
+        sorted.size = 0;
+        sortTemp.size = 0;
+    }
+
+    void destroy() {
+        commands.destroy();
+        sorted.destroy();
+        sortTemp.destroy();
+    }
+};
+
+#endif
@@ -6,9 +6,46 @@
 #include <glm/detail/type_mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "../utils/Log.hpp"
+#include "My/HashMap.hpp"
+#include "stats.hpp"
 
 extern GLuint usedShader;
 
+/*
+ * Remembers uniform locations and the last value uploaded for every uniform set through a Shader,
+ * so setting a uniform to the value it already has (like the same transform every frame) never reaches opengl.
+ * Any uniform set outside of Shader will make the cache stale, so don't call glUniform* directly.
+ */
+struct UniformCache {
+    static constexpr int MaxNameLength = 63; // longer names are looked up every time and never skipped
+
+    struct Slot {
+        GLint location;
+        GLint valueSize; // 0 until a value has been uploaded
+        alignas(16) unsigned char value[sizeof(glm::mat4)];
+        char name[MaxNameLength + 1]; // to tell apart names with the same hash
+    };
+
+    My::HashMap<Uint64, Slot> slots = My::HashMap<Uint64, Slot>::Empty();
+    Slot uncached; // handed out for names too long to keep
+
+    // program in the top 32 bits, hash of the name in the bottom 32.
+    // Names with the same hash go in the next key over, so a key is only a place to start looking
+    static Uint64 key(GLuint program, const char* name);
+
+    // returns the slot for the uniform, looking up the location the first time. Null if the uniform doesn't exist
+    Slot* get(GLuint program, const char* name);
+
+    // forget every uniform of the program. Must be done whenever a program is deleted or relinked
+    void forget(GLuint program);
+
+    void destroy() {
+        slots.destroy();
+    }
+};
+
+extern UniformCache uniformCache;
+
 // read the contents of the file to a buffer that must be freed
 char* readFileContents(FILE* file, size_t* outBytesRead=NULL);
 // wrapper over readFileContents that opens and closes a file 
@@ -38,6 +75,7 @@ struct ShaderProgram {
         glDeleteShader(fragment.id);
         glDeleteShader(geometry.id);
         glDeleteProgram(programID);
+        uniformCache.forget(programID);
     }
 };
 
@@ -54,6 +92,7 @@ struct Shader {
 
     void destroy() {
         glDeleteProgram(id);
+        uniformCache.forget(id);
     }
 
     // activate the shader
@@ -70,6 +109,7 @@ struct Shader {
         if (usedShader != id) {
             glUseProgram(id);
             usedShader = id;
+            renderStats.frame.shaderChanges++;
         }
     }
 
@@ -79,38 +119,51 @@ struct Shader {
 
     GLint getUniformLocation(const char* name) const;
 
+    // Records the new value of the uniform in the uniform cache.
+    // Returns the uniform's slot if the value needs to be uploaded, or null if it can be skipped
+    UniformCache::Slot* updateUniform(const char* name, const void* value, int size) const;
+
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const char* name, bool value) {         
-        glUniform1i(getUniformLocation(name), (GLint)value); 
+    void setBool(const char* name, bool value) {
+        GLint iValue = value;
+        if (auto* slot = updateUniform(name, &iValue, sizeof(iValue)))
+            glUniform1i(slot->location, iValue);
     }
 
     void setInt(const char* name, int value) {
-        glUniform1i(getUniformLocation(name), value); 
+        if (auto* slot = updateUniform(name, &value, sizeof(value)))
+            glUniform1i(slot->location, value);
     }
 
-    void setFloat(const char* name, float value) { 
-        glUniform1f(getUniformLocation(name), value); 
+    void setFloat(const char* name, float value) {
+        if (auto* slot = updateUniform(name, &value, sizeof(value)))
+            glUniform1f(slot->location, value);
     }
 
     void setDouble(const char* name, double value) {
-        glUniform1d(getUniformLocation(name), value);
+        if (auto* slot = updateUniform(name, &value, sizeof(value)))
+            glUniform1d(slot->location, value);
     }
 
     void setVec2(const char* name, glm::vec2 vec2) {
-        glUniform2f(getUniformLocation(name), vec2.x, vec2.y);
+        if (auto* slot = updateUniform(name, &vec2, sizeof(vec2)))
+            glUniform2f(slot->location, vec2.x, vec2.y);
     }
     
     void setVec3(const char* name, glm::vec3 vec3) {
-        glUniform3f(getUniformLocation(name), vec3.x, vec3.y, vec3.z);
+        if (auto* slot = updateUniform(name, &vec3, sizeof(vec3)))
+            glUniform3f(slot->location, vec3.x, vec3.y, vec3.z);
     }
 
     void setVec4(const char* name, glm::vec4 vec4) {
-        glUniform4f(getUniformLocation(name), vec4.x, vec4.y, vec4.z, vec4.w);
+        if (auto* slot = updateUniform(name, &vec4, sizeof(vec4)))
+            glUniform4f(slot->location, vec4.x, vec4.y, vec4.z, vec4.w);
     }
 
     void setMat4(const char* name, const glm::mat4& mat4) {
-        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat4));
+        if (auto* slot = updateUniform(name, &mat4, sizeof(mat4)))
+            glUniformMatrix4fv(slot->location, 1, GL_FALSE, glm::value_ptr(mat4));
     }
 
     // getters
@@ -0,0 +1,106 @@
+#ifndef RENDERING_TEXT_LAYOUT_CACHE_INCLUDED
+#define RENDERING_TEXT_LAYOUT_CACHE_INCLUDED
+
+#include "text.hpp"
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+
+// finished layout of a piece of text, ready to be put in a batch
+struct CachedTextLayout {
+    glm::vec2 size;   // same meaning as in CharacterLayoutData
+    glm::vec2 origin;
+    glm::vec2 offset;
+    My::Vec<GlyphQuad> quads;
+};
+
+/*
+ * Cache of formatted text, so the same string rendered with the same settings every frame
+ * (console log, gui labels, etc.) only goes through formatText once.
+ * Keyed by font, text, formatting settings and scale. Least recently used layouts are evicted once
+ * the memory used goes over the cap, except for layouts used in the last couple frames (batches may still
+ * be pointing to them) and layouts retained through handles.
+ */
+struct TextLayoutCache {
+    struct Key {
+        const Font* font;
+        Uint32 fontGeneration;
+        int textLength;
+        Uint64 textHash;
+        TextFormattingSettings formatting;
+        glm::vec2 scale;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct Entry {
+        Key key;
+        Uint64 hash;
+        char* text; // copy of the text, to tell apart different text with the same hash
+        CachedTextLayout layout;
+        Uint32 lastUsedFrame;
+        Uint32 generation; // 0 when the entry is unused
+        int refCount; // number of handles retaining this entry
+        int prev; // lru list, -1 for none
+        int next;
+        size_t memory;
+    };
+
+    struct Stats {
+        Uint64 hits;
+        Uint64 misses;
+        Uint64 evictions;
+        Uint64 relayouts; // retained layouts laid out again because their font changed
+
+        double hitRate() const {
+            Uint64 total = hits + misses;
+            return total ? (double)hits / (double)total : 0.0;
+        }
+    };
+
+    My::Vec<Entry> entries;
+    My::Vec<int> freeEntries;
+    My::HashMap<Uint64, int> lookupTable;
+    int mostRecent;  // head of the lru list
+    int leastRecent; // tail
+    int entryCount;
+
+    size_t memoryUsed;
+    size_t memoryCap;
+
+    Stats stats;
+
+    static constexpr size_t DefaultMemoryCap = 1024 * 1024;
+
+    static TextLayoutCache init(size_t memoryCap = DefaultMemoryCap);
+
+    static Uint64 hashText(const char* text, int textLength);
+
+    // get the layout for the text, formatting it if it isn't cached.
+    // The layout is only guaranteed to live until the end of the next frame
+    const CachedTextLayout* get(const Font* font, const char* text, int textLength, const TextFormattingSettings& formatting, glm::vec2 scale);
+
+    // get the layout and keep it cached until released
+    TextLayoutHandle retain(const Font* font, const char* text, int textLength, const TextFormattingSettings& formatting, glm::vec2 scale);
+
+    void release(TextLayoutHandle handle);
+
+    // returns null if the handle is invalid. Layouts made with an older version of the font (it was reloaded
+    // or its glyphs were compacted) are laid out again from their text, so the handle stays good
+    const CachedTextLayout* lookup(TextLayoutHandle handle);
+
+    const Font* font(TextLayoutHandle handle) const;
+
+    void destroy();
+
+private:
+    int find(const Key& key, Uint64 hash, const char* text);
+    int insert(const Key& key, Uint64 hash, const char* text);
+    void layOut(int entry); // format the entry's text into its layout, replacing whatever layout it had
+    void touch(int entry);
+    void unlink(int entry);
+    void pushFront(int entry);
+    void freeEntry(int entry);
+    void evict();
+};
+
+#endif
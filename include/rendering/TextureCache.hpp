@@ -0,0 +1,101 @@
+#ifndef RENDERING_TEXTURE_CACHE_INCLUDED
+#define RENDERING_TEXTURE_CACHE_INCLUDED
+
+#include "textures.hpp"
+
+/*
+ * Everything startup does with textures (decoding every png, packing the atlases, filling the texture array)
+ * only depends on the texture metadata and the image files, so the results are saved to a cache file along with
+ * a hash of those inputs. When the hash matches on a later launch the file is mapped into memory and the
+ * pixels are uploaded straight from it, without decoding or packing anything.
+ * The image files are only read to hash them when their sizes or modified times changed since the cache was written.
+ * When it doesn't match, the images are decoded on a few threads at once, and the results of makeTextureAtlas
+ * and makeTextureArray are collected and written out as the new cache when the cache is closed.
+ */
+struct TextureCache {
+    static constexpr Uint32 Version = 2;
+    static constexpr int MaxSections = 8;
+
+    enum SectionKind : Uint32 {
+        AtlasSection = 1,
+        ArraySection = 2
+    };
+
+    // one packed atlas or one texture array
+    struct Section {
+        SectionKind kind;
+        TextureType types; // the types of textures that were included
+        glm::ivec2 size; // size of the atlas, or of each layer in the texture array
+        Uint32 entryCount;
+        Uint32 _pad;
+        Uint64 entriesOffset; // offsets from the start of the file
+        Uint64 pixelsOffset;
+        Uint64 pixelsSize;
+    };
+
+    struct AtlasEntry {
+        TextureID id;
+        TextureAtlas::Space space;
+    };
+
+    struct LayerEntry {
+        TextureID id;
+        glm::ivec2 size;
+        Uint64 pixelsOffset; // from the start of the section's pixels
+    };
+
+    struct Header {
+        char magic[8];
+        Uint32 version;
+        Uint32 sectionCount;
+        Uint64 contentHash; // metadata and the contents of every image file
+        Uint64 stampHash; // metadata and the size and modified time of every image file
+        TextureData textureSizes[TextureIDs::NumTextureSlots];
+        Section sections[MaxSections];
+    };
+
+    const char* path = nullptr;
+    Uint64 contentHash = 0;
+    Uint64 stampHash = 0;
+
+    // the mapped cache file when it was valid, or the cache being built
+    unsigned char* data = nullptr;
+    size_t dataSize = 0;
+    bool mapped = false;
+    My::Vec<unsigned char> buildBuffer;
+
+    // decoded images, indexed by id. Only loaded when the cache needs rebuilding
+    SDL_Surface* images[TextureIDs::NumTextureSlots] = {nullptr};
+
+    // hash the texture metadata and file stamps (or contents, if the stamps changed), and map the cache file if it matches. Otherwise decode all the textures
+    static TextureCache open(TextureManager* textures, const char* assetsPath, const char* cachePath);
+
+    bool valid() const {
+        return mapped;
+    }
+
+    // get a section of the cache file. Null if it's not there, like when the cache wasn't valid
+    const Section* find(SectionKind kind, TextureType types, glm::ivec2 size = {0, 0}) const;
+
+    const void* entries(const Section* section) const {
+        return data + section->entriesOffset;
+    }
+
+    const unsigned char* pixels(const Section* section) const {
+        return data + section->pixelsOffset;
+    }
+
+    // add a section to the cache being built. Does nothing when the cache is valid
+    void add(SectionKind kind, TextureType types, glm::ivec2 size, const void* entries, Uint32 entryCount, size_t entrySize,
+        ArrayRef<Texture> pixels);
+
+    // write the cache file if it was rebuilt, and free everything
+    void close(const TextureManager* textures);
+
+private:
+    Header* header() const {
+        return (Header*)data;
+    }
+};
+
+#endif
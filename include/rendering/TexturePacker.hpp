@@ -4,42 +4,56 @@
 #include <glm/vec2.hpp>
 #include "My/Vec.hpp"
 #include "llvm/ArrayRef.h"
-#include "llvm/BitVector.h"
 #include "rendering/textures.hpp"
 
-// based on this article "https://straypixels.net/texture-packing-for-fonts/" by Edward Lu, modified to be C style
-
-static constexpr int TexturePackingNullNode = -1;
-
-struct TexturePackingNode {
-    glm::ivec2 origin;
-    glm::ivec2 size;
+/*
+ * Skyline bottom-left texture packer.
+ * The skyline is the top edge of everything packed so far, stored as horizontal segments from left to right
+ * that together cover the whole width of the atlas. A texture goes wherever along the skyline its bottom edge
+ * ends up lowest, so packing one texture is linear in the number of segments, with no recursion.
+ * When nothing fits the atlas is doubled in size, which keeps everything already packed where it is.
+ */
 
-    int left;
-    int right;
+struct TexturePackingSegment {
+    int x;
+    int y;
+    int width;
+};
 
-    TexturePackingNode(glm::ivec2 origin, glm::ivec2 size)
-    : origin(origin), size(size), left(TexturePackingNullNode), right(TexturePackingNullNode) {}
+struct TexturePackingStats {
+    int texturesPacked;
+    int texturesFailed;
+    int64_t usedPixels; // area taken up by packed textures, including padding
+    glm::ivec2 atlasSize;
+
+    // fraction of the atlas that's used, 0 - 1
+    float occupancy() const {
+        int64_t atlasPixels = (int64_t)atlasSize.x * atlasSize.y;
+        return atlasPixels > 0 ? (float)((double)usedPixels / (double)atlasPixels) : 0.0f;
+    }
 };
 
 // atlas for packing textures
 struct TexturePackingAtlas {
-    static constexpr int root = 0;
+    static constexpr int MaxSize = 16384;
 
     Texture atlas;
-    My::Vec<TexturePackingNode> nodes;
-    llvm::BitVector nodesEmpty;
+    My::Vec<TexturePackingSegment> skyline;
+    TexturePackingStats stats;
 };
 
 TexturePackingAtlas makeTexturePackingAtlas(int pixelSize, int reserveCapacity = 1, int reserveTextureSize = 64);
 
 Texture doneTexturePackingAtlas(TexturePackingAtlas* atlas);
 
+/* Pack a single texture, growing the atlas if needed. Textures that are already packed never move.
+ * If the texture is unable to be packed for any reason, the origin returned will be {-1, -1}
+ */
 glm::ivec2 packTexture(TexturePackingAtlas* atlas, Texture texture, glm::ivec2 padding = {0, 0});
 
-/* Texture
- * If the texture is unable to be packed for any reason ,the origin out will be {-1, -1}
+/* Pack a whole set of textures at once. They're packed tallest and biggest first, which packs a lot tighter than packing them in any order.
+ * If a texture is unable to be packed for any reason, its origin out will be {-1, -1}
  */
-Texture packTextures(const int numTextures, const Texture* textures, int pixelSize, glm::ivec2* textureOriginsOut, glm::ivec2 padding = {0, 0}, int reserveTextureSize = 128);
+Texture packTextures(const int numTextures, const Texture* textures, int pixelSize, glm::ivec2* textureOriginsOut, glm::ivec2 padding = {0, 0}, int reserveTextureSize = 128, TexturePackingStats* statsOut = nullptr);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,15 +1,17 @@
 #ifndef RENDERING_CONTEXT_INCLUDED
 #define RENDERING_CONTEXT_INCLUDED
 
-#include <unordered_map>
 #include "../sdl_gl.hpp"
 #include "Shader.hpp"
 #include "shaders.hpp"
 #include "text.hpp"
 #include "My/HashMap.hpp"
 #include "My/Vec.hpp"
+#include "utils/StringInterner.hpp"
 #include "renderers.hpp"
 #include "rendering/gui.hpp"
+#include "RenderQueue.hpp"
+#include "TextLayoutCache.hpp"
 
 using ChunkVertexMap = My::HashMap<IVec2, int32_t, IVec2Hash>;
 
@@ -41,37 +43,48 @@ struct RenderBuffer {
     GLuint velocityTexture;
 };
 
+// fonts by their interned name, so getting one is a hash of an integer instead of a string
 struct FontManager {
-    std::unordered_map<std::string, Font*> fonts;
+    My::HashMap<Uint32, Font*> fonts = My::HashMap<Uint32, Font*>::Empty();
     float fontScale = 1.0f;
 
     void add(const char* name, Font* font) {
-        fonts.insert({std::string(name), font});
+        fonts.insert(intern(name).id, font);
+    }
+
+    Font* get(InternedString name) const {
+        Font** font = name ? fonts.lookup(name.id) : nullptr;
+        return font ? *font : nullptr;
     }
 
     Font* get(const char* fontName) {
-        auto it = fonts.find(fontName);
-        if (it != fonts.end()) return it->second;
-        else { 
+        // a name that's never been interned can't be a font's
+        Font* font = get(findInterned(fontName));
+        if (!font) {
             LogError("No font found with name '%s'", fontName);
-            return nullptr;
         }
+        return font;
     }
 
     const Font* get(const char* fontName) const {
-        auto it = fonts.find(fontName);
-        if (it != fonts.end()) return it->second;
-        else return nullptr;
+        return get(findInterned(fontName));
     }
 
-    void destroy() {
-        for (auto font : fonts) {
-            if (font.second) { 
-                font.second->destroy();
-                delete font.second;
+    template<typename Func>
+    void forEach(Func func) const {
+        for (int i = 0; i < fonts.bucketCount; i++) {
+            if (fonts.buckets()[i].state == My::Map::Bucket_Filled && fonts.values()[i]) {
+                func(fonts.values()[i]);
             }
         }
-        // idk if i need to delete fonts map
+    }
+
+    void destroy() {
+        forEach([](Font* font){
+            font->destroy();
+            delete font;
+        });
+        fonts.destroy();
     }
 };
 
@@ -99,9 +112,13 @@ struct RenderContext {
     QuadRenderer worldQuadRenderer;
     TextRenderer worldTextRenderer;
     GuiRenderer worldGuiRenderer;
+    TextLayoutCache textLayouts; // shared by both text renderers
+    TextLayoutHandle worldLabels[2]; // text drawn in the world that never changes
 
     ECS::System::SystemManager* ecsRenderSystems;
 
+    RenderQueue worldQueue;
+
     ChunkModel chunkModel;
     ChunkBuffer chunkBuffer;
 
@@ -113,5 +130,6 @@ struct RenderContext {
 };
 
 void scaleAllFonts(FontManager&, float scale);
+void compactFontGlyphs(FontManager&);
 
 #endif
\ No newline at end of file
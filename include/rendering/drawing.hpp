@@ -32,11 +32,11 @@ namespace Draw {
     inline void coloredPoints(GLsizei count, const ColoredPoint* points) {
         static auto bufferObjects = makePointVertexAttribArray();
 
-        glBindVertexArray(bufferObjects.vao);
+        GL::bindVertexArray(bufferObjects.vao);
         glBindBuffer(GL_ARRAY_BUFFER, bufferObjects.vbo);
         glBufferData(GL_ARRAY_BUFFER, count * sizeof(ColoredPoint), points, GL_STREAM_DRAW);
 
-        glDrawArrays(GL_POINTS, 0, count);
+        GL::drawArrays(GL_POINTS, 0, count);
     }
 
     void thickLines(QuadRenderer& renderer, GLuint numLines, const glm::vec2* points, float z, const SDL_Color* colors, const GLfloat* lineWidths);
@@ -47,6 +47,8 @@ namespace Draw {
 
     int chunkBorders(QuadRenderer& renderer, const Camera& camera, SDL_Color color, float pixelLineWidth, float z);
     void drawFpsCounter(GuiRenderer& renderer, float fps, float tps, RenderOptions options);
+    // draw call and state change counts of the last frame
+    void drawRenderStats(GuiRenderer& renderer, const RenderStats& stats, glm::vec2 pos);
     void drawGui(RenderContext& ren, const Camera& camera, const glm::mat4& screenTransform, GUI::Gui* gui, const GameState* state, const PlayerControls& playerControls);
     inline void drawItemStack(GuiRenderer& renderer, const ItemManager& itemManager, const ItemStack& itemStack, const FRect& destination) {
         auto displayEc = itemManager.getComponent<ITC::Display>(itemStack.item);
@@ -55,6 +57,8 @@ namespace Draw {
             renderer.sprite(icon, destination);
         }
     }
+    // items on belts, in world coordinates. Lines without a belt in the bounds are skipped
+    void drawBeltItems(GuiRenderer& renderer, const World::TransportLines& transportLines, const ItemManager& itemManager, Boxf bounds);
 }
 
 #endif
@@ -131,6 +131,12 @@ struct GuiRenderer {
         return text->render(message, pos, formatSettings, renderSettings, characterPositions);
     }
 
+    // render text retained in the text layout cache
+    TextRenderer::RenderResult renderText(TextLayoutHandle layout, glm::vec2 pos, SDL_Color color, GuiRenderLevel level = UseDefaultLevel) {
+        setTextLevel(level);
+        return text->render(layout, pos, color);
+    }
+
     // texture will only be rendered if it's a gui type texture
     void sprite(TextureID texture, const FRect& rect, GuiRenderLevel level = UseDefaultLevel) {
         auto space = getTextureAtlasSpace(&guiAtlas, texture);
@@ -118,7 +118,7 @@ struct QuadRenderer {
         shader.setInt("tex", texture);
         shader.setMat4("transform", transform);
         
-        glBindVertexArray(model.vao);
+        GL::bindVertexArray(model.vao);
         glBindBuffer(GL_ARRAY_BUFFER, model.vbo);
 
         // buffer all the data now
@@ -127,7 +127,7 @@ struct QuadRenderer {
         int quadsFlushed = 0;
         while (quadsFlushed < buffer->size) {
             int batchSize = MIN(maxQuadsPerBatch, buffer->size);
-            glDrawElements(GL_TRIANGLES, 6 * batchSize, GL_UNSIGNED_INT, (void*)(6UL * quadsFlushed));
+            GL::drawElements(GL_TRIANGLES, 6 * batchSize, GL_UNSIGNED_INT, (void*)(6UL * quadsFlushed));
             quadsFlushed += batchSize;
         }
         buffer->clear();
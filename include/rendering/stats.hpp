@@ -0,0 +1,64 @@
+#ifndef RENDERING_STATS_INCLUDED
+#define RENDERING_STATS_INCLUDED
+
+#include <string.h>
+#include "gl.hpp"
+
+/*
+ * Counters for gl state changes and draw calls made during a frame.
+ * Reset at the start of every frame by render(), the totals from the
+ * previous frame are kept around in lastFrame for displaying.
+ */
+struct RenderStats {
+    struct Counters {
+        int drawCalls;
+        int shaderChanges;
+        int vaoBinds;
+        int textureBinds;
+        int uniformUploads;
+        int uniformsSkipped; // uniform sets that were redundant and never reached opengl
+        int queuedCommands;
+    };
+
+    Counters frame;
+    Counters lastFrame;
+
+    void newFrame() {
+        lastFrame = frame;
+        memset(&frame, 0, sizeof(frame));
+    }
+
+    int stateChanges() const {
+        return lastFrame.shaderChanges + lastFrame.vaoBinds + lastFrame.textureBinds + lastFrame.uniformUploads;
+    }
+};
+
+extern RenderStats renderStats;
+
+namespace GL {
+
+// counted versions of the gl calls made while rendering a frame
+
+inline void drawArrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+    renderStats.frame.drawCalls++;
+}
+
+inline void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    glDrawElements(mode, count, type, indices);
+    renderStats.frame.drawCalls++;
+}
+
+inline void bindVertexArray(GLuint vao) {
+    glBindVertexArray(vao);
+    renderStats.frame.vaoBinds++;
+}
+
+inline void bindTexture(GLenum target, GLuint texture) {
+    glBindTexture(target, texture);
+    renderStats.frame.textureBinds++;
+}
+
+}
+
+#endif
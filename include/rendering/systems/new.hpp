@@ -154,7 +154,17 @@ struct RenderEntitySystem : RenderSystem {
 
     float scale = 1.0f;
 
-    GlModelSOA model;
+    GlVertexFormat vertexFormat;
+    // one model per batch, so every batch can be filled before any of them are drawn
+    std::vector<GlModelSOA> batchModels;
+
+    // a batch of entities waiting in the world queue
+    struct Batch {
+        RenderEntitySystem* system;
+        GLsizei count;
+    };
+    My::Vec<Batch> batches;
+    glm::mat4 transform;
 
     RenderContext& ren;
     const Camera& camera;
@@ -191,7 +201,7 @@ struct RenderEntitySystem : RenderSystem {
     
     RenderEntitySystem(SystemManager& manager, RenderContext& renderContext, const Camera& camera, const EntityWorld& ecs, const ChunkMap& chunkmap)
     : RenderSystem(manager), ren(renderContext), camera(camera), ecs(ecs), chunkmap(chunkmap) {
-        auto vertexFormat = GlMakeVertexFormat(0, {
+        vertexFormat = GlMakeVertexFormat(0, {
             {3, GL_FLOAT, sizeof(GLfloat)}, // pos
             {2, GL_FLOAT, sizeof(GLfloat)}, // size
             {1, GL_FLOAT, sizeof(GLfloat)}, // rotation
@@ -199,7 +209,7 @@ struct RenderEntitySystem : RenderSystem {
             {4, GL_FLOAT, sizeof(GLfloat)} // color
         });
 
-        model = makeModelSOA(verticesPerBatch, nullptr, GL_STREAM_DRAW, vertexFormat);
+        batches = My::Vec<Batch>::WithCapacity(4);
     }
 
     void BeforeExecution() {
@@ -228,7 +238,7 @@ struct RenderEntitySystem : RenderSystem {
         auto rotations = makeTempGroupArray<GLfloat>(rotationGroup);
         GetEntityRotationsJob(&rotationGroup, rotations);
 
-        if (Debug->settings["drawEntityViewBoxes"]) {
+        if (Debug->settings[DebugFlags::drawEntityViewBoxes]) {
             DrawEntityViewBoxJob(&minimalGroup, dimensions, ren.guiRenderer);
         }
     }
@@ -237,20 +247,19 @@ struct RenderEntitySystem : RenderSystem {
 
     }
 
-    void AfterExecution() {
-        auto camTransform = camera.getTransformMatrix();
-
-        auto shader = ren.shaders.use(Shaders::Entity);
-        shader.setMat4("transform", camTransform);
+    static void drawBatch(RenderContext& ren, void* userdata) {
+        auto* batch = (Batch*)userdata;
+        // same transform for every batch, so only the first one uploads it
+        ren.shaders.get(Shaders::Entity).setMat4("transform", batch->system->transform);
+        GL::drawArrays(GL_POINTS, 0, batch->count);
+    }
 
-        glBindVertexArray(model.model.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, model.model.vbo);
-        
-        if (!mapVertexArrays()) {
-            // can't render :(
-            LogError("Failed to map entity vertex arrays!");
-            return;
-        }
+    /* Fill a model for every batch of entities on screen and submit them to the world queue,
+     * to be drawn along with everything else in the world pass
+     */
+    void AfterExecution() {
+        transform = camera.getTransformMatrix();
+        batches.size = 0;
 
         const auto* textureAtlas = &ren.textureAtlas;
         const auto* textureData = ren.textures.data.data;
@@ -281,17 +290,28 @@ struct RenderEntitySystem : RenderSystem {
         int entitiesRendered = 0;
         while (entitiesRendered < entityList.size) {
             int batchSize = MIN(entityList.size - entitiesRendered, entitiesPerBatch);
-            renderBatch(ArrayRef(entityList.data, entityList.size), ArrayRef(textureIndexList.data, textureIndexList.size), ecs, chunkmap, ren);
+            if (batches.size == (int)batchModels.size()) {
+                batchModels.push_back(makeModelSOA(verticesPerBatch, nullptr, GL_STREAM_DRAW, vertexFormat));
+            }
+            auto& model = batchModels[batches.size];
+            GL::bindVertexArray(model.model.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, model.model.vbo);
+            if (!mapVertexArrays()) {
+                // can't render :(
+                LogError("Failed to map entity vertex arrays!");
+                break;
+            }
+            renderBatch(ArrayRef(entityList.data + entitiesRendered, batchSize), ArrayRef(textureIndexList.data + entitiesRendered, batchSize), ecs, chunkmap, ren);
+            // put vertex data into effect
+            unmapVertexArrays();
+            batches.push(Batch{this, batchSize});
             entitiesRendered += batchSize;
         }
 
-        // put vertex data into effect
-        unmapVertexArrays();
-
-        // number of entities wasn't exactly divisible by entitiesPerBatch, so we have some left to do
-        if (entitiesRendered < entityList.size) {
-            // draw a batch of entities
-            glDrawArrays(GL_POINTS, 0, entityList.size - entitiesRendered);
+        // batches is done growing, so pointers to its elements stay good until the queue is executed
+        for (int b = 0; b < batches.size; b++) {
+            auto key = makeRenderSortKey(RenderLayers::Shadows, Shaders::Entity, TextureUnit::MyTextureAtlas, 0.0f);
+            ren.worldQueue.submit(key, batchModels[b].model.vao, drawBatch, &batches[b]);
         }
 
         textureIndexList.destroy();
@@ -320,7 +340,7 @@ struct RenderEntitySystem : RenderSystem {
             buffer.sizes[e] = size;
         }
 
-        if (Debug->settings["drawEntityViewBoxes"]) {
+        if (Debug->settings[DebugFlags::drawEntityViewBoxes]) {
             for (int e = 0; e < batchSize; e++) {
                 Entity entity = entities[e];
                 Vec2 pos = ecs.Get<EC::Position>(entity)->vec2();
@@ -340,7 +360,7 @@ struct RenderEntitySystem : RenderSystem {
             }
         }
 
-        if (Debug->settings["drawEntityCollisionBoxes"]) {
+        if (Debug->settings[DebugFlags::drawEntityCollisionBoxes]) {
             for (int e = 0; e < batchSize; e++) {
                 Entity entity = entities[e];
                 Vec2 pos = ecs.Get<EC::Position>(entity)->vec2();
@@ -361,7 +381,7 @@ struct RenderEntitySystem : RenderSystem {
             }
         }
 
-        if (Debug->settings["drawEntityIDs"]) {
+        if (Debug->settings[DebugFlags::drawEntityIDs]) {
             for (int e = 0; e < batchSize; e++) {
                 Entity entity = entities[e];
                 Vec2 pos = ecs.Get<EC::Position>(entity)->vec2();
@@ -432,9 +452,6 @@ struct RenderEntitySystem : RenderSystem {
 
             buffer.colors[e] = colorShading;
         }
-
-        // draw a batch of entities
-        glDrawArrays(GL_POINTS, 0, batchSize);
     }
 
     void blend(glm::vec4* base, glm::vec4 fg) {
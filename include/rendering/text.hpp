@@ -12,13 +12,11 @@
 #include "Shader.hpp"
 #include "utils.hpp"
 #include "TexturePacker.hpp"
+#include "GlyphCache.hpp"
 #include "My/String.hpp"
 
 #include "global.hpp"
 
-#define ASCII_FIRST_STANDARD_CHAR ' '
-#define ASCII_LAST_STANDARD_CHAR '~'
-
 enum class HoriAlignment : Uint16 {
     Left=0,
     Center=1,
@@ -72,63 +70,24 @@ inline void quitFreetype() {
     FT_Done_FreeType(freetype);
 }
 
-// a texture will be bound on the current active texture unit
-inline GLuint loadFontAtlasTexture(Texture atlas, GLint minFilter, GLint magFilter) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        atlas.size.x,
-        atlas.size.y,
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        atlas.buffer
-    );
-    // set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
-    return textureID;
-}
-
 FT_Face newFontFace(const char* filepath, FT_UInt height);
 
 struct Font {
-    static constexpr char MaxChar = 127;
-
     struct FormattingSettings {
         float tabSpaces = 4.0f; // The width of a tab relative to the size of a space
         float lineSpacing = 1.0f; // space between lines * line height, 1.0 is one font height's distance
     };
 
-    struct AtlasCharacterData {
-        static constexpr char ArraySize = MaxChar;
-        /* Arrays of character atlas data. Index with char value directly like this: positions['a'] */
-        glm::vec<2, uint16_t> positions[ArraySize];
-        glm::vec<2, uint16_t> sizes[ArraySize];
-        glm::vec<2,  int16_t> bearings[ArraySize];
-                    uint16_t   advances[ArraySize];
-    };
-
     FT_Face face = nullptr;
-    AtlasCharacterData* characters = nullptr;
+    // glyphs are rasterized and put on the atlas the first time they're used, so any codepoint the face has is supported
+    GlyphCache* glyphs = nullptr;
 
     FT_UInt _height = 0;
-    GLuint atlasTexture = 0;
-    glm::ivec2 atlasSize = {0, 0};
 
     Shader shader = {};
 
     FormattingSettings formatting;
 
-    // in the case that char is signed, its impossible to have an exclusive range end while also supporting
-    //  chars 0-127, so we use inclusive end range
-    char firstChar=0,lastChar=-1;
     bool usingSDFs = false;
     TextureUnit textureUnit = TextureUnit::Null;
 
@@ -136,8 +95,13 @@ struct Font {
 
     float currentScale = 0.0f;
 
+    // incremented every time the glyphs are reloaded (like when scaling) or moved around on the atlas, so anything
+    // derived from glyph metrics or atlas positions can tell when it's out of date
+    Uint32 generation = 0;
+
     Font() = default;
 
+    // set the pixel height of the font. Nothing is rasterized until it's used
     void load(FT_UInt height, Shader shader, bool useSDFs = false);
 
     bool loaded() const {
@@ -145,11 +109,6 @@ struct Font {
     }
 
     void unload();
-    
-    // get the number of characters supported by this font structure (not the underlying font face, that probably supports a lot more)
-    int numChars() const {
-        return (int)lastChar - (int)firstChar + 1;
-    }
 
     FT_UInt linePixelSpacing() const {
         return formatting.lineSpacing * height();
@@ -170,26 +129,41 @@ struct Font {
         return ascender() - descender();
     }
 
-    glm::ivec2 position(char c) const {
-        assert(c >= 0);
-        return characters->positions[c];
+    Glyph glyph(Codepoint c) const {
+        assert(glyphs);
+        return glyphs->get(c);
     }
 
-    glm::ivec2 size(char c) const {
-        assert(c >= 0);
-        return characters->sizes[c];
+    glm::ivec2 atlasSize() const {
+        return glyphs->atlasSize();
     }
 
-    glm::ivec2 bearing(char c) const {
-        assert(c >= 0);
-        return characters->bearings[c];
+    glm::ivec2 position(Codepoint c) const {
+        return glyph(c).position;
     }
 
-    unsigned int advance(char c) const {
-        assert(c >= 0 && c <= MaxChar);
-        return characters->advances[c];
+    glm::ivec2 size(Codepoint c) const {
+        return glyph(c).size;
     }
 
+    glm::ivec2 bearing(Codepoint c) const {
+        return glyph(c).bearing;
+    }
+
+    unsigned int advance(Codepoint c) const {
+        if (c == '\t') {
+            return glyph(' ').advance * formatting.tabSpaces;
+        }
+        return glyph(c).advance;
+    }
+
+    // get newly rasterized glyphs onto the gpu. Needs to be done before drawing text with this font
+    void uploadGlyphs() const;
+
+    // evict glyphs that haven't been used in a while if the atlas has gotten too big.
+    // Must be done before any text is formatted in a frame, since glyphs get moved
+    void compactGlyphs();
+
     /* Returns a pointer to the set of 4 vectors that make up the character's texture quad on the font atlas
     std::array<TexCoord, 4>* getTexCoords(char c) const {
         return &characterTexCoords[c - firstChar];
@@ -234,7 +208,7 @@ struct Font {
 
 /* FORMATTING */
 
-inline bool isWhitespace(char c) {
+inline bool isWhitespace(Codepoint c) {
     switch (c) {
     case ' ':
     case '\t':
@@ -245,7 +219,7 @@ inline bool isWhitespace(char c) {
     }
 }
 
-Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, char _firstChar, char _lastChar, float scale, Font::FormattingSettings formatting, TextureUnit textureUnit, Shader shader);
+Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, float scale, Font::FormattingSettings formatting, TextureUnit textureUnit, Shader shader);
 
 struct TextFormattingSettings {
     TextAlignment align = TextAlignment::TopLeft;
@@ -273,9 +247,9 @@ struct CharacterLayoutData {
     glm::vec2 size = {0, 0}; // size of the body of output text
     glm::vec2 origin = {0, 0};
     glm::vec2 offset = {0, 0}; // offset to original position
-    llvm::SmallVector<char> characters;
+    llvm::SmallVector<Codepoint> characters;
     llvm::SmallVector<glm::vec2> characterOffsets;
-    llvm::SmallVector<char> whitespaceCharacters;
+    llvm::SmallVector<Codepoint> whitespaceCharacters;
     llvm::SmallVector<glm::vec2> whitespaceCharacterOffsets;
 };
 
@@ -322,28 +296,26 @@ struct TextRenderingSettings {
     */
 };
 
-struct TextRenderLayout {
-    glm::vec2 origin;
-    My::Vec<char> characters;
-    My::Vec<glm::vec2> characterOffsets;
+// a glyph's quad, relative to the origin of the text it's in. Unscaled
+struct GlyphQuad {
+    glm::vec2 min;
+    glm::vec2 max;
+    // in atlas pixels, not normalized, since the atlas can grow between making the quad and drawing it
+    glm::vec2 texMin;
+    glm::vec2 texMax;
 };
 
+// make the glyph quads for all the (non whitespace) characters in the layout
+void buildGlyphQuads(const Font* font, const CharacterLayoutData& layout, GlyphQuad* quadsOut);
+
 struct TextRenderBatch {
     const Font* font;
-    struct CharacterDimensions {
-        glm::vec<2, uint16_t> size;
-        glm::vec<2,  int16_t> bearing;
-    };
-    My::Vec<CharacterDimensions> dimensions;
-    My::Vec<SDL_Color> colors;
-    My::Vec<glm::vec2> scales;
-
-    // all characters use the same color
-    bool uniformColor() const { return colors.size == 1; }
-    // characters use the same scale
-    bool uniformScale() const { return scales.size == 1; }
-
-    TextRenderLayout layout;
+    glm::vec2 origin;
+    // either in frame scratch memory, or owned by the text layout cache, which keeps them alive until the batch is flushed
+    const GlyphQuad* quads;
+    int quadCount;
+    SDL_Color color;
+    glm::vec2 scale;
 };
 
 struct GlyphVertex {
@@ -358,6 +330,18 @@ void renderBatch(const TextRenderBatch* batch, GlyphVertex* verticesOut, int buf
 // maxBatchSize: in number of characters
 void flushTextBatches(MutableArrayRef<TextRenderBatch> buffer, GlModel model, const glm::mat4& transform, int maxBatchSize);
 
+struct TextLayoutCache;
+
+// handle to a text layout retained in a TextLayoutCache
+struct TextLayoutHandle {
+    Uint32 index = 0;
+    Uint32 generation = 0; // 0 is never a valid generation
+
+    operator bool() const {
+        return generation != 0;
+    }
+};
+
 struct TextRenderer {
     using FormattingSettings = TextFormattingSettings;
     using RenderingSettings = TextRenderingSettings;
@@ -365,6 +349,8 @@ struct TextRenderer {
     const Font* defaultFont = nullptr;
 
     My::Vec<TextRenderBatch>* buffer;
+    // optional, text layouts are formatted from scratch every time when null
+    TextLayoutCache* layoutCache = nullptr;
     // index with character index found by subtracting font->firstChar from char,
     // like this: characterTexCoords['a' - font->firstChar]
     using TexCoord = glm::vec2;
@@ -412,6 +398,16 @@ struct TextRenderer {
 
     RenderResult render(const char* text, int textLength, glm::vec2 pos, const TextFormattingSettings& formatSettings, RenderingSettings renderSettings, glm::vec2* outCharPositions = nullptr);
 
+    // render a layout retained in the layout cache. Font, formatting and scale were decided when the layout was retained
+    RenderResult render(TextLayoutHandle layout, glm::vec2 pos, SDL_Color color);
+
+    // lay out text that never changes and keep it in the layout cache until it's released there, for render(TextLayoutHandle).
+    // Null without a layout cache
+    TextLayoutHandle retain(const char* text, const TextFormattingSettings& formatSettings, const RenderingSettings& renderSettings);
+
+    // the render settings' scale, or the default one if it isn't set
+    glm::vec2 renderScale(const RenderingSettings& renderSettings) const;
+
     void flush(const glm::mat4& transform) {
         if (!buffer) return;
         flushTextBatches(MutableArrayRef<TextRenderBatch>(buffer->data, buffer->size), model, transform, maxBatchSize);
@@ -10,6 +10,7 @@
 #include "My/SparseSets.hpp"
 #include "gl.hpp"
 #include "My/String.hpp"
+#include "utils/StringInterner.hpp"
 
 namespace TextureUnits {
     enum TextureUnit : GLubyte {
@@ -61,7 +62,7 @@ inline void freeTexture(Texture texture) {
 }
 
 inline void fillTextureBlack(Texture tex) {
-    memset(tex.buffer, 0, tex.size.x * tex.size.y);
+    memset(tex.buffer, 0, (size_t)tex.size.x * tex.size.y * tex.pixelSize);
 }
 
 inline unsigned char* accessTexture(Texture tx, glm::ivec2 pixel) {
@@ -109,11 +110,13 @@ struct TextureManager {
     My::Vec<TextureMetaData> metadata;
     My::Vec<TextureData> data;
     My::HashMap<TextureID, Animation> animations;
+    My::HashMap<Uint32, TextureID> idsByName; // by interned identifier
 
     TextureManager(int numTextures) {
         metadata = My::Vec<TextureMetaData>::Filled(numTextures, {nullptr, nullptr});
         data = My::Vec<TextureData>::Filled(numTextures, {{0,0}});
         animations = My::HashMap<TextureID, Animation>::WithBuckets(8);
+        idsByName = My::HashMap<Uint32, TextureID>::WithBuckets(numTextures * 2);
     }
 
     void add(TextureID id, const char* stringIdentifier, TextureType type, const char* filename, const Animation* animation = nullptr) {
@@ -121,26 +124,33 @@ struct TextureManager {
         if (animation) {
             animations.insert(id, *animation);
         }
+        InternedString name = intern(stringIdentifier);
+        // the first texture with an identifier keeps it
+        if (name && !idsByName.lookup(name.id)) {
+            idsByName.insert(name.id, id);
+        }
     }
 
     void addAnimation(const Animation* animation) {
         animations.insert(animation->texture, *animation);
     }
 
+    // @return The texture with the identifier, or the null texture if there isn't one
+    TextureID getID(InternedString identifier) const {
+        TextureID* id = identifier ? idsByName.lookup(identifier.id) : nullptr;
+        return id ? *id : 0;
+    }
+
     TextureID getID(const char* identifier) const {
-        for (TextureID id = 0; id < metadata.size; id++) {
-            if (My::streq(metadata[id].identifier, identifier)) {
-                return id;
-            }
-        }
-        // couldn't find texture
-        return 0;
+        // an identifier that's never been interned can't be a texture's
+        return getID(findInterned(identifier));
     }
 
     void destroy() {
         metadata.destroy();
         data.destroy();
         animations.destroy();
+        idsByName.destroy();
     }
 };
 
@@ -227,9 +237,12 @@ struct TextureArray {
     }
 };
 
-GLuint GlLoadTextureArray(glm::ivec2 size, ArrayRef<SDL_Surface*> images, GLenum minFilter, GLenum magFilter);
+struct TextureCache;
+
+GLuint GlLoadTextureArray(glm::ivec2 size, ArrayRef<Texture> layers, GLenum minFilter, GLenum magFilter);
 // @typesIncluded can be one or more types (as a bit mask) of textures that should be included in the texture array
-TextureArray makeTextureArray(glm::ivec2 size, TextureManager* textures, TextureType typesIncluded, const char* assetsPath, TextureUnit target);
+// Images come from the texture cache, or the cached texture array is used if it's there
+TextureArray makeTextureArray(glm::ivec2 size, TextureManager* textures, TextureType typesIncluded, TextureCache* cache, TextureUnit target);
 int updateTextureArray(TextureArray* textureArray, TextureManager* textures, TextureID id, SDL_Surface* surface);
 
 struct TextureAtlas {
@@ -265,8 +278,11 @@ struct TextureAtlas {
     }
 };
 
-GlSizedTexture GlLoadTextureAtlas(ArrayRef<SDL_Surface*> images, GLint minFilter, GLint magFilter, MutableArrayRef<glm::ivec2> texCoordsOut);
-TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesIncluded, const char* assetsPath, GLint minFilter, GLint magFilter, TextureUnit target);
+// pack the images into one texture. Needs to be freed
+Texture packTextureAtlas(ArrayRef<SDL_Surface*> images, MutableArrayRef<glm::ivec2> texCoordsOut);
+GLuint GlLoadTextureAtlas(Texture atlas, GLint minFilter, GLint magFilter);
+// same as makeTextureArray, the cached atlas is used if it's there
+TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesIncluded, TextureCache* cache, GLint minFilter, GLint magFilter, TextureUnit target);
 
 // returns -1 on error
 inline int getTextureArrayDepth(const TextureArray* textureArray, TextureID id) {
@@ -2,39 +2,94 @@
 #define DEBUG_INCLUDED
 
 #include <string>
-#include <unordered_map>
+#include <vector>
+#include <functional>
 #include "../constants.hpp"
 
 namespace GUI {
     struct Console;
 }
 
+/* Debug flags
+ * Every flag is declared once here, with its name, default value and a description.
+ * Flags get an ID from their place in the list, so reading one is just loading a bool from an array,
+ * and setting them by name (like from console commands) goes through the names in the list.
+ */
+
+// name, default value, description
+#define DEBUG_FLAG_LIST(FLAG) \
+    FLAG(drawEntityViewBoxes, false, "Outline the view box of every entity on screen") \
+    FLAG(drawEntityCollisionBoxes, false, "Outline the collision box of every entity on screen") \
+    FLAG(drawEntityIDs, false, "Draw every entity's ID over it") \
+    FLAG(drawChunkBorders, false, "Draw lines between chunks") \
+    FLAG(drawRenderStats, false, "Show draw call and vertex counts in the corner of the screen") \
+    FLAG(warnTickAllocations, false, "Log a warning for every tick that allocates memory, when built with MEMORY_TRACKING")
+
+namespace DebugFlags {
+
+enum DebugFlag : Uint8 {
+    #define DEBUG_FLAG_ID(name, defaultValue, description) name,
+    DEBUG_FLAG_LIST(DEBUG_FLAG_ID)
+    #undef DEBUG_FLAG_ID
+    Count,
+    Null = Count
+};
+
+struct Info {
+    const char* name;
+    bool defaultValue;
+    const char* description;
+};
+
+constexpr Info Infos[Count] = {
+    #define DEBUG_FLAG_INFO(name, defaultValue, description) {#name, defaultValue, description},
+    DEBUG_FLAG_LIST(DEBUG_FLAG_INFO)
+    #undef DEBUG_FLAG_INFO
+};
+
+// @return The flag with the name, or Null if there isn't one
+DebugFlag fromName(const char* name);
+
+}
+
+using DebugFlag = DebugFlags::DebugFlag;
+
 struct DebugSettings {
-    std::unordered_map<std::string, bool> bools;
+    // called with the flag and its new value when a flag is changed
+    using Listener = std::function<void(DebugFlag flag, bool value)>;
 
-    void init() {
+    bool flags[DebugFlags::Count];
+    std::vector<Listener> listeners;
 
-    }
+    // set every flag to its default, without calling listeners
+    void init();
 
-    bool& operator[](const char* str) {
-        return bools[std::string(str)];
+    bool operator[](DebugFlag flag) const {
+        return flags[flag];
     }
 
-    bool operator[](const char* str) const {
-        auto it = bools.find(std::string(str));
-        if (it != bools.end()) return it->second;
-        else return false;
-    }
+    void set(DebugFlag flag, bool value);
 
-    bool& operator[](std::string str) {
-        return bools[str];
+    // @return false if no flag has the name
+    bool set(const char* name, bool value);
+
+    void toggle(DebugFlag flag) {
+        set(flag, !flags[flag]);
     }
 
-    bool operator[](std::string str) const {
-        auto it = bools.find(str);
-        if (it != bools.end()) return it->second;
-        else return false;
+    void addListener(Listener listener) {
+        listeners.push_back(listener);
     }
+
+    /* Write flags that aren't set to their default to a file, a line for each like "name = 1"
+     * @return false if the file couldn't be written to
+     */
+    bool save(const char* filepath) const;
+
+    /* Set flags from a file written by save, ignoring names that aren't flags anymore.
+     * @return false if the file couldn't be read
+     */
+    bool load(const char* filepath);
 };
 
 struct DebugClass {
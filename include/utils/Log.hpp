@@ -33,37 +33,58 @@ enum LogPriority {
 
 using LogPriority = LogPriorities::LogPriority;
 
+/* Logging
+ * Logging functions don't write anything themselves. They copy the format string's arguments into a fixed size record
+ * in a lock-free ring buffer shared by every thread, and a writer thread formats and writes the records later,
+ * so logging costs the calling thread about as much as a few stores.
+ * Call sites (told apart by their format strings) that log more than a few times a second have the rest of their messages
+ * dropped, and the writer reports how many were dropped instead. The same message written out several times in a row
+ * is collapsed into one line saying how many times it repeated.
+ * Everything waiting is written out when the logger is destroyed, when the program exits and when it crashes.
+ */
+
+struct LogQueue;
+
 struct Logger {
-    void logOutputFunction(LogCategory category, LogPriority priority, const char *message) const;
+    static constexpr int MaxCategories = 32;
+
+    // write a message to the console and the log file, and queue it for the debug console. Called by the writer thread
+    void writeMessage(LogCategory category, LogPriority priority, const char *message) const;
 public:
     bool initialized = false;
     LogCategory category = LogCategory::Main; // The log category to use when logging, default is main
     bool useEscapeCodes = false; // Use ansi escape codes for colors and bolding when logging to console
     bool logToConsole = true;
+    bool rateLimit = true; // Drop messages from call sites that log too often
     char logOutputFilepath[512] = {'\0', };
     FILE* outputFile = NULL;
-    std::string lastMessage;
+    LogQueue* queue = NULL; // messages waiting to be written, and the writer thread. Null when messages are written right away
+    LogPriority minimumPriorities[MaxCategories] = {}; // messages of lower priority than this for their category are ignored
 
     static void logOutputFunction(void* logger, int category, SDL_LogPriority priority, const char *message);
 
-    int init(const char* outputFilepath) {
-        initialized = true;
-        if (!outputFilepath)
-            return -1;
-        strncpy(logOutputFilepath, outputFilepath, 512);
-        outputFile = fopen(logOutputFilepath, "w+");
-        if (!outputFile)
-            return -1;
-        return 0;
-    }
+    // start the writer thread and open the log file
+    int init(const char* outputFilepath);
+
+    // write out everything still waiting, stop the writer thread and close the log file
+    void destroy();
 
-    void destroy() {
-        if (outputFile) {
-            fclose(outputFile);
-            outputFile = NULL;
-        }
+    // write out everything waiting right now on this thread, without waiting for the writer thread
+    void flush();
+
+    // set the lowest priority for every category to be logged, for both these functions and SDL's
+    void setPriorities(LogPriority priority);
+
+    void setPriority(LogCategory category, LogPriority priority);
+
+    bool enabled(int category, LogPriority priority) const {
+        LogPriority minimum = (category >= 0 && category < MaxCategories) ? minimumPriorities[category] : LogPriority::Error;
+        return priority >= minimum;
     }
 
+    // give the debug console the messages it should show. Has to be called on the main thread, since the writer can't touch the gui
+    void forwardConsoleMessages();
+
     #define LOG_PRIORITY(priority) {va_list ap;\
         va_start(ap, fmt);\
         SDL_LogMessageV(category, priority, fmt, ap);\
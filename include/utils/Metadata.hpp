@@ -4,6 +4,7 @@
 #include "../constants.hpp"
 #include <SDL3/SDL.h>
 #include "My/Vec.hpp"
+#include "utils/Stats.hpp"
 
 using Tick = int64_t;
 constexpr Tick NullTick = 0;
@@ -19,6 +20,7 @@ struct UpdateMetadata {
 
     static constexpr int storedUpdateTimes = 60;
     My::Vec<double> updateTimeHistory = My::Vec<double>::WithCapacity(storedUpdateTimes); // in miliseconds
+    double updateTimeTotal = 0.0; // sum of the update time history, kept up as times come and go
     double ups = 0.0; // updates per second
     int oldestTrackedUpdate = 0;
 
@@ -32,19 +34,26 @@ struct UpdateMetadata {
                 1000.0/(double)GetPerformanceFrequency());
             if (updateTimeHistory.size < updateTimeHistory.capacity) {
                 updateTimeHistory.push(deltaTime);
+                updateTimeTotal += deltaTime;
             } else {
+                updateTimeTotal += deltaTime - updateTimeHistory[oldestTrackedUpdate];
                 updateTimeHistory[oldestTrackedUpdate] = deltaTime;
                 oldestTrackedUpdate = (oldestTrackedUpdate + 1) % updateTimeHistory.size;
+                if (oldestTrackedUpdate == 0) {
+                    // start the sum over once every time around so rounding errors don't pile up
+                    updateTimeTotal = 0.0;
+                    for (auto dt : updateTimeHistory) {
+                        updateTimeTotal += dt;
+                    }
+                }
             }
         }
 
         /* Calculate updates per second */
-        double totalTime = 0.0;
-        for (auto dt : updateTimeHistory) {
-            totalTime += dt;
+        if (updateTimeHistory.size > 0) {
+            double averageDeltaTime = updateTimeTotal / updateTimeHistory.size;
+            ups = 1000.0 / averageDeltaTime;
         }
-        double averageDeltaTime = totalTime / updateTimeHistory.size;
-        ups = 1000.0 / averageDeltaTime;
 
         timestamp = GetTicks();
 
@@ -58,6 +67,34 @@ struct UpdateMetadata {
 
 
 
+#define TIMING_LIST(TIMING) \
+    TIMING(Frame) /* from the start of one frame to the start of the next */ \
+    TIMING(Tick) /* everything done in a tick */ \
+    TIMING(Events) \
+    TIMING(Systems) \
+    TIMING(PlayerMovement) \
+    TIMING(Physics) \
+    TIMING(ChunkPositions) \
+    TIMING(Gui) \
+    TIMING(Render)
+
+namespace Timings {
+    #define TIMING_ENUM(name) name,
+    enum Timing {
+        TIMING_LIST(TIMING_ENUM)
+        Count
+    };
+    #undef TIMING_ENUM
+
+    #define TIMING_NAME(name) #name,
+    constexpr const char* Names[] = {
+        TIMING_LIST(TIMING_NAME)
+    };
+    #undef TIMING_NAME
+}
+
+using Timing = Timings::Timing;
+
 /*
 * Useful metadata information and utilities
 */
@@ -77,11 +114,17 @@ struct MetadataTracker {
     UpdateMetadata frame;
     UpdateMetadata tick;
 
+    // timings with the last few seconds of updates in their windows
+    static constexpr int TimingWindowSeconds = 4;
+    TimingStats timings[Timings::Count];
+
 public:
     bool vsyncEnabled;
 
     MetadataTracker(Uint32 targetFps, Uint32 targetTps, bool vsync);
 
+    void destroy();
+
     /*
     * Mark the start time of the application, for better tracking of various data (like start time)
     * @return The current time in ticks.
@@ -130,6 +173,19 @@ public:
 
     // Get the start time (when start() was called) of the game in ticks.
     Uint64 getStartTicks() const;
+
+    TimingStats* timing(Timing id) {
+        return &timings[id];
+    }
+
+    const TimingStats* timing(Timing id) const {
+        return &timings[id];
+    }
+
+    /* Write every timing since the start to a file. See dumpTimingStats for the format
+     * @return false if the file couldn't be written
+     */
+    bool dumpTimings(const char* filename) const;
 };
 
 extern const MetadataTracker* Metadata;
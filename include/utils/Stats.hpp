@@ -0,0 +1,121 @@
+#ifndef UTILS_STATS_INCLUDED
+#define UTILS_STATS_INCLUDED
+
+#include <SDL3/SDL_stdinc.h>
+#include <stdio.h>
+
+/*
+ * Histogram of times in nanoseconds, with buckets that get wider as the times get bigger (like HdrHistogram).
+ * Every power of two is split into SubBuckets buckets of the same width, so the bucket a time lands in
+ * is at most 1/SubBuckets of the time wide, and reading a time back from its bucket is off by no more than half that.
+ * Times under SubBuckets nanoseconds get a bucket each. Adding a time is a couple of shifts and an increment.
+ */
+struct TimeHistogram {
+    static constexpr int SubBucketBits = 5;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+    static constexpr int MaxBits = 36; // times from 2^36 ns (about 68 seconds) up all go in the last bucket
+    static constexpr int BucketCount = (MaxBits - SubBucketBits + 1) * SubBuckets;
+    // how far a time read back from a histogram can be from the real one, relative to the real one
+    static constexpr double MaxRelativeError = 1.0 / (2 * SubBuckets);
+
+    Uint32* counts; // by bucket, not owned
+    Uint64 samples;
+    Uint64 max;
+
+    static int bucket(Uint64 ns) {
+        if (ns < (Uint64)SubBuckets) return (int)ns;
+        if (ns >> MaxBits) return BucketCount - 1;
+        int magnitude = 63 - __builtin_clzll(ns) - SubBucketBits; // ns is at least SubBuckets, so this is never negative
+        return (magnitude + 1) * SubBuckets + (int)(ns >> magnitude) - SubBuckets;
+    }
+
+    // the smallest time that goes in the bucket
+    static Uint64 bucketStart(int bucket) {
+        if (bucket < SubBuckets) return (Uint64)bucket;
+        int magnitude = bucket / SubBuckets - 1;
+        return (Uint64)(SubBuckets + bucket % SubBuckets) << magnitude;
+    }
+
+    // the time in the middle of the bucket, which is what the bucket reads back as
+    static Uint64 bucketMiddle(int bucket) {
+        if (bucket < SubBuckets) return (Uint64)bucket;
+        int magnitude = bucket / SubBuckets - 1;
+        return bucketStart(bucket) + (((Uint64)1 << magnitude) >> 1);
+    }
+
+    void add(Uint64 ns) {
+        counts[bucket(ns)]++;
+        samples++;
+        if (ns > max) max = ns;
+    }
+
+    void clear();
+
+    // add every bucket of the other histogram to this one, or take them away with sign -1
+    void merge(const TimeHistogram& other, int sign = 1);
+
+    /* Get the time at or under which the given fraction of the times are, within MaxRelativeError of the real one.
+     * @param fraction 0.5 for the median, 0.99 for the 99th percentile
+     * @return The time in nanoseconds, or 0 if there aren't any
+     */
+    Uint64 percentile(double fraction) const;
+
+    /* Write the histogram with only the buckets that aren't empty to the file
+     * @return false if the file couldn't be written
+     */
+    bool write(FILE* file) const;
+};
+
+/*
+ * Times for one thing the game keeps track of, like a frame or a system's update, for a few different stretches of time:
+ * since the start, and the last windowSamples times or so, for percentiles that follow how the game is doing right now.
+ * The window is made of Slots smaller histograms, and when the newest one fills up the oldest one is taken out of the window,
+ * so the window covers between the last windowSamples - windowSamples/Slots and windowSamples times.
+ */
+struct TimingStats {
+    static constexpr int Slots = 4;
+
+    const char* name;
+    int windowSamples;
+    int currentSlot;
+    TimeHistogram total; // every time since the start
+    TimeHistogram window; // the slots added together
+    TimeHistogram slots[Slots];
+    Uint32* buckets;
+
+    static TimingStats init(const char* name, int windowSamples);
+
+    void record(Uint64 ns);
+
+    // time percentile over the window, in miliseconds
+    double percentile(double fraction) const {
+        return window.percentile(fraction) / 1.0e6;
+    }
+
+    // the longest time over the window, in miliseconds
+    double max() const {
+        return window.max / 1.0e6;
+    }
+
+    void destroy();
+};
+
+// Record the time from when the timing is made to when it's destroyed
+struct ScopedTiming {
+    TimingStats* stats;
+    Uint64 start;
+
+    ScopedTiming(TimingStats* stats);
+    ~ScopedTiming();
+};
+
+/* Write the times since the start for every one of the stats to a file, for comparing against other builds.
+ * The file starts with "FKTS", the version, TimeHistogram::SubBucketBits and TimeHistogram::BucketCount as Uint32s,
+ * and the number of stats. Then each one's name as a Uint8 length and characters, and its histogram as
+ * the sample count and max as Uint64s, the number of buckets that aren't empty as a Uint32,
+ * and the index (Uint16) and count (Uint32) of each of those buckets. Everything is little endian.
+ * @return false if the file couldn't be written
+ */
+bool dumpTimingStats(const char* filename, const TimingStats* stats, int count);
+
+#endif
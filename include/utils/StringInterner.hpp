@@ -0,0 +1,58 @@
+#ifndef UTILS_STRING_INTERNER_INCLUDED
+#define UTILS_STRING_INTERNER_INCLUDED
+
+#include <SDL3/SDL_stdinc.h>
+#include <stddef.h>
+
+/*
+ * Strings stored once for the whole program and referred to by a small id, so names can be kept in components,
+ * compared and hashed as integers instead of char arrays.
+ * The same text always gets the same id, on any thread. Interning takes a lock, but only a shared one
+ * when the string has been interned before, and getting the text back from an id doesn't lock at all.
+ * Interned strings are never freed while the game is running, so the pointers from str() stay good
+ * until freeInternedStrings() at the very end. That leaves only the null string, and ids from before it
+ * aren't interned anymore (asking for their text logs an error and gets "", or asserts in debug builds).
+ */
+struct InternedString {
+    Uint32 id; // 0 is the null string
+
+    // the text, or "" for the null string
+    const char* str() const;
+
+    Uint32 length() const;
+
+    bool null() const {
+        return id == 0;
+    }
+
+    explicit operator bool() const {
+        return id != 0;
+    }
+
+    constexpr bool operator==(InternedString rhs) const {
+        return id == rhs.id;
+    }
+
+    constexpr bool operator!=(InternedString rhs) const {
+        return id != rhs.id;
+    }
+};
+
+constexpr InternedString NullInternedString = {0};
+
+// get the id for the text, adding it if it hasn't been interned yet. Null and empty strings are the null string
+InternedString intern(const char* str);
+InternedString intern(const char* str, size_t length);
+
+/* Get the id for the text only if it's been interned already, without adding it,
+ * for looking things up by a name that might not exist
+ * @return The null string if the text has never been interned
+ */
+InternedString findInterned(const char* str);
+
+int internedStringCount();
+
+// free every interned string, going back to only the null string. Ids from before can't be used after this, so only call it when quitting
+void freeInternedStrings();
+
+#endif
@@ -15,7 +15,12 @@ struct IVec2Hash {
         constexpr size_t hashTypeHalfBits = sizeof(size_t) * 8 / 2;
         static_assert(sizeof(point) == sizeof(size_t), "point fits into hash");
         // y coordinate is most significant 32 bits, x least significant 32 bits
-        return ((size_t)point.y << hashTypeHalfBits) | ((size_t)point.x); 
+        size_t hash = ((size_t)(uint32_t)point.y << hashTypeHalfBits) | ((size_t)(uint32_t)point.x);
+        // hash maps only use the low bits, so mix y into them. Otherwise every point in a column lands in the same bucket
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
     }
 };
 
@@ -0,0 +1,122 @@
+#ifndef WORLD_ENTITY_EVENTS_INCLUDED
+#define WORLD_ENTITY_EVENTS_INCLUDED
+
+#include "My/Vec.hpp"
+#include "ECS/Entity.hpp"
+#include "utils/common-macros.hpp"
+
+namespace World {
+
+/*
+ * Queues of component add and remove events, one queue for each component and kind of event.
+ * Adding a component just appends the entity to the component's queue, and the handlers for it
+ * get the whole queue at once when the entity world is flushed, instead of being called one entity at a time.
+ * Which changes every entity has waiting is kept too, so changes that undo each other before a flush,
+ * like an entity that's created and destroyed in the same tick, never reach the handlers at all.
+ * Removed components and destroyed entities stay around until their events are handled,
+ * so handlers can still read them.
+ */
+
+struct EntityPendingChanges {
+    Uint32 batch; // the flush the changes are waiting for. Changes from earlier batches are out of date
+    ECS::Signature added; // added components that still need their add events
+    ECS::Signature removed; // components waiting to be removed
+    bool destroyed;
+};
+
+struct EntityEvents {
+    My::Vec<Entity> added[ECS::MaxComponentID];
+    My::Vec<Entity> removed[ECS::MaxComponentID];
+    My::Vec<Entity> destroyed;
+    My::Vec<EntityPendingChanges> pending; // by entity id
+    My::Vec<Entity> scratch; // events being handled, so handlers can queue new ones
+    My::Vec<Entity> destroying; // destroyed entities being handled
+    My::Vec<Entity> ready; // the events that are left after dropping the ones that were undone
+    Uint32 batch;
+    bool queued; // whether anything was queued since the last flush
+    bool flushing;
+    int coalesced; // events that were dropped because they were undone before a flush
+
+    static EntityEvents init() {
+        EntityEvents self;
+        for (int i = 0; i < ECS::MaxComponentID; i++) {
+            self.added[i] = My::Vec<Entity>::Empty();
+            self.removed[i] = My::Vec<Entity>::Empty();
+        }
+        self.destroyed = My::Vec<Entity>::Empty();
+        self.pending = My::Vec<EntityPendingChanges>::Empty();
+        self.scratch = My::Vec<Entity>::Empty();
+        self.destroying = My::Vec<Entity>::Empty();
+        self.ready = My::Vec<Entity>::Empty();
+        self.batch = 1;
+        self.queued = false;
+        self.flushing = false;
+        self.coalesced = 0;
+        return self;
+    }
+
+    void destroy() {
+        for (int i = 0; i < ECS::MaxComponentID; i++) {
+            added[i].destroy();
+            removed[i].destroy();
+        }
+        destroyed.destroy();
+        pending.destroy();
+        scratch.destroy();
+        destroying.destroy();
+        ready.destroy();
+    }
+
+    // the changes the entity has waiting for this batch
+    EntityPendingChanges& changes(ECS::EntityID id) {
+        if ((int)id >= pending.size) {
+            EntityPendingChanges none = {0, ECS::Signature(0), ECS::Signature(0), false};
+            pending.resize(MAX((int)id + 1, pending.size * 2), none);
+        }
+        EntityPendingChanges& entityChanges = pending[id];
+        if (entityChanges.batch != batch) {
+            entityChanges = {batch, ECS::Signature(0), ECS::Signature(0), false};
+        }
+        return entityChanges;
+    }
+
+    // @return The changes the entity has waiting, or null if it doesn't have any
+    EntityPendingChanges* lookup(ECS::EntityID id) {
+        if ((int)id >= pending.size || pending[id].batch != batch) return nullptr;
+        return &pending[id];
+    }
+
+    // for when an entity id stops being used or gets used again, so the new entity doesn't get the old one's changes
+    void forget(ECS::EntityID id) {
+        if ((int)id < pending.size) {
+            pending[id].batch = 0;
+        }
+    }
+
+    void queueAdd(Entity entity, ECS::ComponentID component) {
+        added[component].push(entity);
+        queued = true;
+    }
+
+    void queueRemove(Entity entity, ECS::ComponentID component) {
+        removed[component].push(entity);
+        queued = true;
+    }
+
+    void queueDestroy(Entity entity) {
+        destroyed.push(entity);
+        queued = true;
+    }
+
+    // move the queue into the buffer to be handled, leaving the queue empty for new events
+    static void take(My::Vec<Entity>& queue, My::Vec<Entity>& into) {
+        My::Vec<Entity> taken = queue;
+        queue = into;
+        queue.size = 0;
+        into = taken;
+    }
+};
+
+}
+
+#endif
@@ -11,40 +11,51 @@
 #include "components/components.hpp"
 #include "entities/prototypes/prototypes.hpp"
 #include "ECS/system.hpp"
+#include "ECS/NameIndex.hpp"
+#include "world/TimerWheel.hpp"
+#include "world/EntityEvents.hpp"
 
 namespace World {
 
+using TimerCallbackID = Sint16;
+
 struct EntityWorld {
     ECS::EntityManager em;
+    TimerWheel timers;
 protected:
     
     using EventCallback = std::function<void(EntityWorld*, ECS::Entity)>;
-    EventCallback callbacksOnAdd[EC::ComponentIDs::Count];
-    EventCallback callbacksBeforeRemove[EC::ComponentIDs::Count];
-
-    bool deferringEvents = false;
-    struct DeferredEvent {
-        ECS::Entity entity;
-        EventCallback callback;
-    };
-    llvm::SmallVector<DeferredEvent, 3> deferredEvents;
+    // gets every entity with the event since the last flush at once
+    using EventHandler = std::function<void(EntityWorld*, ArrayRef<ECS::Entity>)>;
+    EventHandler handlersOnAdd[EC::ComponentIDs::Count];
+    EventHandler handlersBeforeRemove[EC::ComponentIDs::Count];
+    std::vector<EventCallback> timerCallbacks;
+
+    EntityEvents events;
+    ECS::NameIndex names; // entities by their nametag
 public:
     
     EntityWorld() {
         using namespace EC;
         static constexpr auto infoList = ECS::getComponentInfoList<WORLD_COMPONENT_LIST>();
         em = ECS::EntityManager(ArrayRef(infoList), World::Entities::PrototypeIDs::Count);
+        timers = TimerWheel::init();
+        events = EntityEvents::init();
+        names = ECS::NameIndex::init();
     }
 
     EntityWorld(const EntityWorld& copy) = delete;
 
     /* Destroy the entity world.
-     * Frees memory and destroys members without doing any other work (such as calling event callbacks).
+     * Frees memory and destroys members without doing any other work (such as calling event handlers).
      * It is NOT safe to use an entity world after calling this method on it.
      * Essentially a destructor.
      */
     void destroy() {
         em.destroy();
+        timers.destroy();
+        events.destroy();
+        names.destroy();
     }
 
     Sint32 getComponentSize(ECS::ComponentID id) const {
@@ -56,12 +67,14 @@ public:
      */
     Entity New(ECS::PrototypeID prototype) {
         Entity entity = em.newEntity(prototype);
+        events.forget(entity.id);
         return entity;
     }
 
     /* Destroy an entity, effectively removing all of its components (while triggering relevant events for those components),
-     * rendering it unusable. Attempting to destroy an entity that does not exist will do nothing other than trigger an error.
-     * @return 0 if the destruction was successful, -1 on failure.
+     * rendering it unusable. The entity goes away on the next flush, after the remove events for its components are handled,
+     * so it still exists until then. Destroying it again before then does nothing.
+     * Attempting to destroy an entity that does not exist will do nothing other than trigger an error.
      */
     void Destroy(Entity entity) {
         if (!EntityExists(entity)) {
@@ -69,7 +82,11 @@ public:
             return;
         }
 
-        em.deleteEntity(entity);
+        auto& changes = events.changes(entity.id);
+        if (changes.destroyed) return;
+        changes.destroyed = true;
+        events.queueDestroy(entity);
+        timers.cancelAll(entity);
     }
 
     /* Check whether an entity exists, AKA whether the entity was properly created using New and not yet Destroyed.
@@ -128,9 +145,10 @@ public:
     }
     
     /* Get a component from the entity of the type T.
-     * Completely side-effect free. Will log an error and return null if the entity does not exist or if the entity does not own a component of the type.
+     * Will log an error and return null if the entity does not exist or if the entity does not own a component of the type.
      * Passing a type that has not been initialized with init() will result in an error message and getting null.
      * In order to not be wasteful, types with a size of 0 (AKA flag components) will result in a return value of null.
+     * Unless T is const, the component is marked changed (see ForEachChanged), so get components as const when only reading them.
      * @return A pointer to a component of the type or null on error.
      */
     template<class T>
@@ -139,9 +157,10 @@ public:
     }
 
     /* Get a component from the entity of the type T.
-     * Completely side-effect free. Will log an error and return null if the entity does not exist or if the entity does not own a component of the type.
+     * Will log an error and return null if the entity does not exist or if the entity does not own a component of the type.
      * Passing a type that has not been initialized with init() will result in an error message and getting null.
      * In order to not be wasteful, types with a size of 0 (AKA flag components) will result in a return value of null.
+     * The component is marked changed (see ForEachChanged).
      * @return A pointer to a component of the type or null on error.
      */
     void* Get(Entity entity, ECS::ComponentID component) const {
@@ -157,133 +176,273 @@ public:
         // perhaps add a NULL check here and log an error instead of dereferencing immediately?
         // could hurt performance depending on where it's used
         // decided to add check as otherwise this method is useless, so only use it if a null check is intended.
-        if (component)
+        if (component) {
+            if constexpr (std::is_same<T, EC::Nametag>::value) {
+                renamed(entity, component->name, value.name);
+            }
             *component = value;
+        }
         return component;
     }
 
     /* Add a component of the type to the entity, immediately initializing the value to param startValue.
-     * Triggers the relevant 'onAdd' event directly after adding and setting start value if not currently deferring events,
-     * otherwise it will be added to the back of the deferred events queue to be executed when finished deferring.
-     * @return 0 on success, any other value otherwise. A relevant error message should be logged.
+     * Queues the relevant 'onAdd' event for the next flush, unless the entity already had the component.
+     * @return True on success, false otherwise. A relevant error message should be logged.
      */
     template<class T>
     bool Add(Entity entity, const T& startValue) {
+        constexpr ECS::ComponentID id = ECS::getID<T>();
+        if (readdingComponent(entity, id)) {
+            Set<T>(entity, startValue);
+            return true;
+        }
+        bool hadComponent = em.components.getEntitySignature(entity)[id];
+        if constexpr (std::is_same<T, EC::Nametag>::value) {
+            if (hadComponent) unindexName(entity);
+        }
         if (em.addComponent<T>(entity, startValue)) {
-            
-            auto& onAddT = callbacksOnAdd[ECS::getID<T>()];
-            if (onAddT) {
-                if (deferringEvents) {
-                    deferredEvents.push_back({entity, onAddT});
-                } else {
-                    onAddT(this, entity);
-                }
+            if constexpr (std::is_same<T, EC::Nametag>::value) {
+                names.add(startValue.name, indexedEntity(entity));
+            }
+            if (!hadComponent) {
+                queueAddEvent(entity, id);
             }
             return true;
-            
         }
         return false;
     }
 
     /* Add the component corresponding to the id to the given entity
-     * Triggers the relevant 'onAdd' event directly after adding and setting start value if not currently deferring events,
-     * otherwise it will be added to the back of the deferred events queue to be executed when finished deferring.
-     * @return 0 on success, any other value otherwise. A relevant error message should be logged.
+     * Queues the relevant 'onAdd' event for the next flush, unless the entity already had the component.
+     * @return True on success, false otherwise. A relevant error message should be logged.
      */
     bool Add(Entity entity, ECS::ComponentID id) {
         //LogInfo("Adding %s to entity: %s", em.getComponentName<T>(), entity.DebugStr());
+        if (readdingComponent(entity, id)) return true;
+        bool hadComponent = em.components.getEntitySignature(entity)[id];
         bool ret = em.addComponent(entity, id);
-        if (ret) {
-            auto& onAddT = callbacksOnAdd[id];
-            if (onAddT) {
-                if (deferringEvents) {
-                    deferredEvents.push_back({entity, onAddT});
-                } else {
-                    onAddT(this, entity);
-                }
-            }
+        if (ret && !hadComponent) {
+            queueAddEvent(entity, id);
         }
         return ret;
     }
 
     bool AddSignature(Entity entity, ECS::Signature signature) {
+        ECS::Signature oldSignature = em.components.getEntitySignature(entity);
         if (em.addSignature(entity, signature)) {
-            signature.forEachSet([&](ECS::ComponentID component){
-                auto& onAddT = callbacksOnAdd[component];
-                if (onAddT) {
-                    deferredEvents.push_back({entity, onAddT});
-                }
+            (signature & ~oldSignature).forEachSet([&](ECS::ComponentID component){
+                queueAddEvent(entity, component);
             });
             return true;
         }
         return false;
     }
 
-    /* Add the template argument components to the entity.
-     * Triggers the relevant 'onAdd' events directly after adding all of the components if not currently deferring events.
-     * Keep in mind the components will be left unitialized, meaning you may get either garbage or old component data if read to before being written to.
-     * If deferring events, the events will be added to the back of the deferred events queue to be executed when finished deferring in the order of the template arugments passed.
-     * The events will not be triggered if adding any of the components failed.
-     * @return 0 on success, -1 if adding any one of the components failed. A relevant error message should be logged.
+    /* Remove the component from the entity.
+     * When the component has a 'beforeRemove' handler, it stays on the entity until the handler gets it on the next flush,
+     * otherwise it's removed right away. A component that was added since the last flush is removed right away either way,
+     * and its add event is dropped, since no handler has seen it yet.
      */
-    /*
-    template<class... Components>
-    bool Add(Entity entity) {
-        constexpr auto ids = ECS::getComponentIDs<Components...>();
-        bool ret = em.Add<Components...>(entity);
-        if (ret) {
-            for (size_t i = 0; i < ids.size(); i++) {
-                auto& onAddT = callbacksOnAdd[ids[i]];
-                if (onAddT) {
-                    if (deferringEvents) {
-                        deferredEvents.push_back({entity, onAddT});
-                    } else {
-                        onAddT(this, entity);
-                    }
-                }
-            }
+    template<class T>
+    void Remove(Entity entity) {
+        Remove(entity, ECS::getID<T>());
+    }
+
+    /* Remove the component corresponding to the id from the given entity.
+     * When the component has a 'beforeRemove' handler, it stays on the entity until the handler gets it on the next flush,
+     * otherwise it's removed right away. A component that was added since the last flush is removed right away either way,
+     * and its add event is dropped, since no handler has seen it yet.
+     */
+    void Remove(Entity entity, ECS::ComponentID id) {
+        if (!EntityExists(entity) || !em.getEntitySignature(entity)[id]) {
+            em.removeComponent(entity, id);
+            return;
         }
 
-        return ret;
+        auto& changes = events.changes(entity.id);
+        // the whole entity is going away already
+        if (changes.destroyed) return;
+        if (changes.removed[id]) return;
+
+        if (changes.added[id]) {
+            changes.added.set(id, false);
+            events.coalesced++;
+            removeNow(entity, id);
+        } else if (handlersBeforeRemove[id]) {
+            changes.removed.set(id);
+            events.queueRemove(entity, id);
+        } else {
+            removeNow(entity, id);
+        }
     }
-    */
 
+    /* Register a callback for timers to call when they go off, usually once when setting up.
+     * @return The id to schedule timers with.
+     */
+    TimerCallbackID NewTimerCallback(EventCallback callback) {
+        timerCallbacks.push_back(callback);
+        return (TimerCallbackID)(timerCallbacks.size() - 1);
+    }
+
+    /* Call the callback with the entity at the tick, unless the entity is destroyed first.
+     * Ticks that have already been updated will go off on the next update instead.
+     */
+    TimerID ScheduleCallback(Entity entity, Tick tick, TimerCallbackID callback) {
+        return timers.schedule(tick, entity, TimerAction::Call, callback);
+    }
+
+    // Remove the component from the entity at the tick, unless the entity is destroyed first.
     template<class T>
-    void Remove(Entity entity) {
-        
-        auto& beforeRemoveT = callbacksBeforeRemove[ECS::getID<T>()];
-        if (beforeRemoveT) {
-            if (deferringEvents) {
-                deferredEvents.push_back({entity, beforeRemoveT});
-            } else {
-                beforeRemoveT(this, entity);
+    TimerID ScheduleRemove(Entity entity, Tick tick) {
+        return timers.schedule(tick, entity, TimerAction::RemoveComponent, ECS::getID<T>());
+    }
+
+    // Destroy the entity at the tick, unless it's destroyed first.
+    TimerID ScheduleDestroy(Entity entity, Tick tick) {
+        return timers.schedule(tick, entity, TimerAction::Destroy, 0);
+    }
+
+    // @return False if the timer already went off or was cancelled.
+    bool CancelTimer(TimerID timer) {
+        return timers.cancel(timer);
+    }
+
+    /* Fire every timer due up to and including the tick, in order of tick and then in the order they were scheduled.
+     * Timers scheduled by the timers firing go off too, if they're due by the tick.
+     */
+    void UpdateTimers(Tick tick) {
+        Timer timer;
+        while (timers.next(tick, &timer)) {
+            if (timer.entity.NotNull() && !EntityExists(timer.entity)) {
+                LogError("EntityWorld::UpdateTimers : Timer went off for a dead entity! Entity: %s", timer.entity.DebugStr());
+                continue;
+            }
+
+            switch (timer.action) {
+            case TimerAction::Call:
+                timerCallbacks[timer.argument](this, timer.entity);
+                break;
+            case TimerAction::RemoveComponent:
+                Remove(timer.entity, timer.argument);
+                break;
+            case TimerAction::Destroy:
+                Destroy(timer.entity);
+                break;
             }
         }
-        
-        em.removeComponent<T>(entity);
     }
 
-    void StartDeferringEvents() {
-        deferringEvents = true;
-    }
+    /* Handle every event queued since the last flush, adds first, then removes and destroys,
+     * each handler getting all the entities with its event in one go.
+     * Events queued by the handlers are handled before returning too.
+     * Call once a tick, and wherever something needs to see the changes made so far.
+     */
+    void FlushEvents() {
+        if (events.flushing) return;
+        events.flushing = true;
+
+        while (events.queued) {
+            events.queued = false;
+
+            for (ECS::ComponentID component = 0; component < EC::ComponentIDs::Count; component++) {
+                while (!events.added[component].empty()) {
+                    EntityEvents::take(events.added[component], events.scratch);
+                    events.ready.size = 0;
+                    for (Entity entity : events.scratch) {
+                        if (!EntityExists(entity)) continue;
+                        auto& changes = events.changes(entity.id);
+                        if (!changes.added[component]) continue;
+                        // left marked as added, so the destroy drops the remove event too
+                        if (changes.destroyed) continue;
+                        changes.added.set(component, false);
+                        events.ready.push(entity);
+                    }
+                    if (events.ready.size > 0) {
+                        handlersOnAdd[component](this, ArrayRef<Entity>(events.ready.data, events.ready.size));
+                    }
+                }
+            }
+
+            // components of destroyed entities get removed the same way as components removed by themselves
+            EntityEvents::take(events.destroyed, events.destroying);
+            for (Entity entity : events.destroying) {
+                auto& changes = events.changes(entity.id);
+                em.getEntitySignature(entity).forEachSet([&](ECS::ComponentID component){
+                    if (changes.added[component]) {
+                        // added and destroyed before anything saw it
+                        changes.added.set(component, false);
+                        events.coalesced++;
+                    } else if (handlersBeforeRemove[component] && !changes.removed[component]) {
+                        changes.removed.set(component);
+                        events.queueRemove(entity, component);
+                    }
+                });
+            }
 
-    void StopDeferringEvents() {
-        for (auto& deferredEvent : deferredEvents) {
-            deferredEvent.callback(this, deferredEvent.entity);
+            for (ECS::ComponentID component = 0; component < EC::ComponentIDs::Count; component++) {
+                while (!events.removed[component].empty()) {
+                    EntityEvents::take(events.removed[component], events.scratch);
+                    events.ready.size = 0;
+                    for (Entity entity : events.scratch) {
+                        if (!EntityExists(entity)) continue;
+                        auto& changes = events.changes(entity.id);
+                        if (!changes.removed[component]) continue;
+                        changes.removed.set(component, false);
+                        events.ready.push(entity);
+                    }
+                    if (events.ready.size == 0) continue;
+
+                    handlersBeforeRemove[component](this, ArrayRef<Entity>(events.ready.data, events.ready.size));
+                    for (Entity entity : events.ready) {
+                        // destroyed entities lose all their components at once
+                        if (!events.changes(entity.id).destroyed) {
+                            removeNow(entity, component);
+                        }
+                    }
+                }
+            }
+
+            for (Entity entity : events.destroying) {
+                // the remove handlers might have given it new timers
+                timers.cancelAll(entity);
+                unindexName(entity);
+                em.deleteEntity(entity);
+                events.forget(entity.id);
+            }
+            events.destroying.size = 0;
         }
-        deferredEvents.clear();
 
-        deferringEvents = false;
+        // everything that was waiting is done, so all of the pending changes are out of date now
+        events.batch++;
+        events.flushing = false;
+    }
+
+    // @return The number of events that were dropped for being undone before a flush, since the world was made.
+    int CoalescedEvents() const {
+        return events.coalesced;
     }
 
     template<class T>
-    void SetOnAdd(EventCallback callback) {
-        callbacksOnAdd[ECS::getID<T>()] = callback;
+    void SetOnAdd(EventHandler handler) {
+        handlersOnAdd[ECS::getID<T>()] = handler;
     }
 
     template<class T>
-    void SetBeforeRemove(EventCallback callback) {
-        callbacksBeforeRemove[ECS::getID<T>()] = callback;
+    void SetBeforeRemove(EventHandler handler) {
+        handlersBeforeRemove[ECS::getID<T>()] = handler;
+    }
+
+    /* Find an entity by its nametag. Entities are found until their nametag is actually removed,
+     * so a destroyed entity can still be found until the next flush, like it still exists until then.
+     * @return The entity that's had the name the longest, or null if nothing has it.
+     */
+    Entity FindNamed(InternedString name) const {
+        return names.find(name);
+    }
+
+    // every entity with the nametag
+    ArrayRef<Entity> FindAllNamed(InternedString name) const {
+        return names.findAll(name);
     }
 
     /* Iterate entities filtered using an EntityQuery.
@@ -312,6 +471,24 @@ public:
         em.forEachEntity_EarlyReturn(query, callback);
     }
 
+    /* Iterate entities filtered using an EntityQuery, skipping ones whose component of type T hasn't changed after the version given.
+     * Components are marked changed when gotten without const, when a system with write access to them runs,
+     * and when the entity is added to or moved around in its archetype. Unchanged entities can still come up now and then,
+     * as changes are tracked for groups of entities at once. Otherwise the same as ForEach.
+     * Keep the version from AdvanceChangeVersion() to pass as since the next time.
+     */
+    template<class T>
+    void ForEachChanged(std::function<bool(ECS::Signature)> query, ECS::ChangeVersion since, std::function<void(Entity entity)> callback) const {
+        em.forEachChangedEntity(query, ECS::getID<T>(), since, callback);
+    }
+
+    /* Start a new change version. Changes from now on will be after the version returned.
+     * @return The latest version any changes made up until now have
+     */
+    ECS::ChangeVersion AdvanceChangeVersion() {
+        return em.components.advanceChangeVersion();
+    }
+
     ECS::ComponentID GetComponentIdFromName(const char* name) const {
         for (ECS::ComponentID id = 0; id < EC::ComponentIDs::Count; id++) {
             ;
@@ -375,6 +552,60 @@ public:
 
         return false;
     }
+protected:
+    void queueAddEvent(Entity entity, ECS::ComponentID component) {
+        if (!handlersOnAdd[component]) return;
+        auto& changes = events.changes(entity.id);
+        // nothing needs to know about components of entities that are going away,
+        // but marking it added keeps it from getting a remove event when they go
+        if (changes.destroyed) {
+            changes.added.set(component);
+            return;
+        }
+        if (!changes.added[component]) {
+            changes.added.set(component);
+            events.queueAdd(entity, component);
+        }
+    }
+
+    void removeNow(Entity entity, ECS::ComponentID component) {
+        if (component == EC::Nametag::ID) {
+            unindexName(entity);
+        }
+        em.removeComponent(entity, component);
+    }
+
+    void unindexName(Entity entity) {
+        if (!em.getEntitySignature(entity)[EC::Nametag::ID]) return;
+        auto* nametag = em.getComponent<const EC::Nametag>(entity);
+        if (nametag) {
+            names.remove(nametag->name, indexedEntity(entity));
+        }
+    }
+
+    void renamed(Entity entity, InternedString oldName, InternedString newName) {
+        if (oldName == newName) return;
+        names.remove(oldName, indexedEntity(entity));
+        names.add(newName, indexedEntity(entity));
+    }
+
+    // entities from ForEach have wildcard versions, so the index keeps the real one
+    Entity indexedEntity(Entity entity) const {
+        return Entity(entity.id, GetEntityVersion(entity.id));
+    }
+
+    /* Adding back a component that's waiting to be removed keeps the component,
+     * without telling the handlers it was ever gone.
+     * @return True if the component was waiting to be removed.
+     */
+    bool readdingComponent(Entity entity, ECS::ComponentID component) {
+        if (!EntityExists(entity)) return false;
+        auto* changes = events.lookup(entity.id);
+        if (!changes || changes->destroyed || !changes->removed[component]) return false;
+        changes->removed.set(component, false);
+        events.coalesced++;
+        return true;
+    }
 };
 
 }
@@ -0,0 +1,182 @@
+#ifndef WORLD_INSERTERS_INCLUDED
+#define WORLD_INSERTERS_INCLUDED
+
+#include <functional>
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "items/items.hpp"
+#include "items/Inventory.hpp"
+#include "utils/vectors_and_rects.hpp"
+#include "world/TransportLines.hpp"
+
+namespace World {
+
+/*
+ * Inserter simulation.
+ * Each inserter goes around picking up from its source, swinging to its target, dropping, and swinging back.
+ * Most inserters spend most of their time waiting, either for something to pick up or for room to put it,
+ * so instead of checking their source or target every tick, a blocked inserter goes to sleep on the wait list
+ * of what it's waiting for, and stops being updated.
+ * Inventories have one wait list for items being put in and one for items being taken out, keyed by their items,
+ * so an inserter only wakes up for the change it was waiting on.
+ * Items moving along a belt are too frequent to wake anything on, so an inserter waiting on a belt
+ * works out when the items coming at it get there and sleeps until that tick instead.
+ * It only waits on the belt line itself when nothing on it is moving its way, until items are put on or taken off the line.
+ * Swinging inserters sleep until the swing is over, too.
+ * Only awake inserters are updated, so an idle inserter costs nothing per tick.
+ */
+
+// something an inserter takes from or puts into
+struct InserterEndpoint {
+    enum Kind : Uint8 {
+        None,
+        Container,
+        Belt
+    };
+
+    Kind kind = None;
+    // the container, when it's a container. Its inventory is looked up every time it's used, since the inventory can change or go away
+    Entity container = NullEntity;
+    // neighbours in the list of endpoints using the same container. See Inserters::userNode
+    int prevUser = -1;
+    int nextUser = -1;
+};
+
+enum class InserterState : Uint8 {
+    PickingUp,
+    SwingingToTarget,
+    Dropping,
+    SwingingBack
+};
+
+struct SimulatedInserter {
+    Entity entity;
+    IVec2 tile;
+    IVec2 sourceTile;
+    IVec2 targetTile;
+    InserterEndpoint source;
+    InserterEndpoint target;
+
+    ItemStack hand;
+    int stackSize;
+    int swingTicks; // ticks for each half of a swing
+    Uint64 swingDone; // tick the current swing is over
+    InserterState state;
+
+    // 0 when awake
+    Uint64 waitKey;
+    // neighbours in the wait list
+    int prevWaiter;
+    int nextWaiter;
+    // index in the active list, or -1 when sleeping
+    int activeIndex;
+    bool alive;
+};
+
+struct InserterWaitKeyHash {
+    size_t operator()(Uint64 key) const {
+        // keys are pointers, line ids and ticks, so the low bits on their own are mostly the same
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+};
+
+struct InsertersStats {
+    int inserters;
+    int awake; // inserters updated last tick. The rest were asleep
+};
+
+// items an inserter was holding when it was removed, to be dropped in the world
+struct DroppedInserterStack {
+    Vec2 position;
+    ItemStack stack;
+};
+
+struct Inserters {
+    // what inserters with a missing source or target wait on, until a container or belt gets placed
+    static constexpr Uint64 UnconnectedWaitKey = 1;
+    static constexpr Uint64 BeltWaitKeyBit = 1ULL << 63;
+    static constexpr Uint64 TimedWaitKeyBit = 1ULL << 62;
+    // set on inventory keys when waiting for room instead of items. Item stacks are aligned so the bit is never part of the pointer
+    static constexpr Uint64 RoomWaitKeyBit = 1;
+
+    My::Vec<SimulatedInserter> inserters;
+    My::Vec<int> freeInserters;
+    My::Vec<int> active; // awake inserters
+    // wait key to the first inserter in its wait list, or -1 when nothing is waiting.
+    // Keys are kept when their list empties since the same containers and belts get waited on over and over
+    My::HashMap<Uint64, int, InserterWaitKeyHash> waitLists;
+    // container entity id to the first endpoint using it, so removing a container doesn't have to look through every inserter
+    My::HashMap<Uint32, int> containerUsers;
+    My::HashMap<Uint32, int> byEntity; // entity id to inserter index
+    My::Vec<DroppedInserterStack> dropped;
+    InsertersStats stats;
+    Uint64 tick; // updates so far, for inserters sleeping until a certain tick
+
+    TransportLines* belts;
+    // for the references held by items in hands and on belts. Can be null when nothing needs to be kept alive, like in benchmarks
+    ItemManager* itemManager;
+    // find a container covering the tile
+    std::function<bool(IVec2 tile, Entity* containerOut)> findContainer;
+    // the container's inventory, or null when the container is gone
+    std::function<Inventory*(Entity container)> containerInventory;
+
+    static Inserters init(TransportLines* belts);
+
+    void destroy();
+
+    void add(Entity entity, IVec2 tile, IVec2 sourceTile, IVec2 targetTile, int swingTicks, int stackSize);
+
+    void remove(Entity entity);
+
+    // items were put into (added) or taken out of the inventory with these items, so wake up whatever was waiting for that
+    void inventoryChanged(const ItemStack* inventoryItems, bool added);
+
+    // the container's inventory is going away, so anything using it needs to find a new source or target
+    void inventoryRemoved(Entity container, const Inventory& inventory);
+
+    // a container or belt was placed, which might be what unconnected inserters are waiting for
+    void containersChanged();
+
+    // items were put on or taken off the belt line
+    void beltLineChanged(TransportLineID line);
+
+    // the belt line was taken apart, so everything waiting on it has to look again
+    void beltLineRebuilt(TransportLineID line);
+
+    // wake up every inserter, for when every inserter should be checked (or for comparing against polling)
+    void wakeAll();
+
+    void update();
+
+private:
+    void wake(Uint64 key);
+    void wakeInserter(int index);
+    void sleep(int index, Uint64 key);
+    void unlinkWaiter(int index);
+    void removeActive(int index);
+    // endpoints using containers are linked by inserter index * 2, plus one for targets
+    static int userNode(int index, bool target) {
+        return index * 2 + target;
+    }
+    InserterEndpoint& endpointOf(int node) {
+        return node % 2 ? inserters[node / 2].target : inserters[node / 2].source;
+    }
+    void linkUser(int node);
+    void unlinkUser(int node);
+    bool resolve(int index, bool target);
+    // the inventory of a container endpoint, or null if the container is gone
+    Inventory* inventoryOf(const InserterEndpoint& endpoint) const;
+    // what to sleep on until the endpoint might have something to pick up, or room to drop
+    Uint64 waitKey(IVec2 tile, const InserterEndpoint& endpoint, bool dropping) const;
+    bool pickUp(SimulatedInserter& inserter);
+    bool drop(SimulatedInserter& inserter);
+    // returns false when the inserter went to sleep
+    bool step(int index);
+};
+
+}
+
+#endif
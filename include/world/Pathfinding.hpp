@@ -0,0 +1,133 @@
+#ifndef WORLD_PATHFINDING_INCLUDED
+#define WORLD_PATHFINDING_INCLUDED
+
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "Chunks.hpp"
+#include "utils/vectors_and_rects.hpp"
+
+namespace World {
+
+/*
+ * Pathfinding for entities following a target.
+ * Every chunk keeps a bitmap of which of its tiles are walkable, and a list of portals,
+ * the tiles on its edges where a path can cross into the chunk next to it.
+ * The distances between every pair of portals inside a chunk are worked out once, when the chunk's tiles change,
+ * which makes the portals a much smaller graph than the tiles that paths can be searched through quickly.
+ * Instead of searching a path for each follower, every target gets one flow field: the distance from every tile to the target.
+ * The portal graph is searched once from the target to get the distance of every portal,
+ * and then each chunk's tiles are filled in from its portals, only for chunks that a follower actually asks about.
+ * Followers then just step to whichever neighbouring tile is closest to the target,
+ * so a thousand followers cost one search, not a thousand.
+ */
+
+struct NavChunk {
+    // opposite sides differ only in the lowest bit
+    enum Side : Uint8 {
+        NegX,
+        PosX,
+        NegY,
+        PosY
+    };
+
+    Uint64 walkable[CHUNKSIZE]; // a bit for each tile, by row
+    My::Vec<IVec2> portals; // tiles on the edges of the chunk, inside the chunk
+    My::Vec<Uint8> portalSides; // the side of the chunk each portal crosses over
+    My::Vec<Uint32> portalCosts; // distance between every pair of portals without leaving the chunk, portals.size squared
+    Uint32 version; // changes when the walkability of the chunk changes
+    Uint8 neighbours; // a bit for each side that had a chunk next to it when the portals were made
+    bool exists; // there was a chunk in the chunkmap when the bitmap was made
+    bool portalsBuilt;
+};
+
+// a flow field for one chunk, filled in from the distances of the chunk's portals
+struct FlowFieldChunk {
+    Uint32* costs; // distance to the target from every tile, by row. Unreachable for walls
+    Uint64 seedHash; // hash of the portal distances the costs were made from
+    Uint32 navVersion;
+    Uint32 search; // the field's search the costs are up to date with
+};
+
+struct FlowField {
+    Entity target;
+    IVec2 targetTile;
+    Uint32 graphVersion;
+    bool searched; // portal distances are up to date
+    Uint32 searches;
+    Uint32 lastUsed;
+    // distance from each portal in each chunk to the target, in the same order as the chunk's portals
+    My::HashMap<IVec2, My::Vec<Uint32>, IVec2Hash> portalDistances;
+    My::HashMap<IVec2, FlowFieldChunk, IVec2Hash> chunks;
+};
+
+struct PortalSearchNode {
+    Uint32 distance;
+    IVec2 chunk;
+    int portal;
+};
+
+struct PathfindingStats {
+    int fields;
+    int searches; // portal graph searches for any field
+    int chunkFields; // chunk flow fields filled in
+    int chunkRebuilds; // chunks that had their portals remade
+};
+
+struct Pathfinding {
+    static constexpr Uint32 Unreachable = UINT32_MAX;
+    // paths are only searched through chunks this close to the target's chunk
+    static constexpr int SearchRadius = 8;
+    // edges shorter than this get one portal in the middle, longer ones get one on each end
+    static constexpr int WidePortal = 8;
+    // fields that aren't used for this long are thrown away
+    static constexpr Uint32 UnusedFieldTicks = 300;
+
+    const ChunkMap* chunkmap;
+    My::HashMap<IVec2, NavChunk, IVec2Hash> chunks;
+    My::HashMap<Uint32, FlowField> fields; // by target entity id
+    // changes whenever any chunk's portals have to be remade, so every field has to search again
+    Uint32 graphVersion;
+    Uint32 tick;
+    PathfindingStats stats;
+
+    My::Vec<Uint32> scratchCosts;
+    My::Vec<Uint16> scratchQueue;
+    My::Vec<Uint64> scratchSeeds;
+    My::Vec<PortalSearchNode> open;
+
+    static Pathfinding init(const ChunkMap* chunkmap);
+
+    void destroy();
+
+    // the tile at the position was changed, which might change where things can walk
+    void tileChanged(IVec2 tile);
+
+    /* Get the tile to go to next from the tile to get closer to the target.
+     * Returns false when the target can't be reached from the tile, or it's too far away
+     */
+    bool nextTile(Entity target, IVec2 targetTile, IVec2 from, IVec2* nextOut);
+
+    // get the length of the shortest path from the tile to the target, or Unreachable
+    Uint32 distance(Entity target, IVec2 targetTile, IVec2 from);
+
+    // throw away fields that haven't been used in a while
+    void update();
+
+    bool walkable(IVec2 tile);
+
+private:
+    NavChunk* navChunk(IVec2 chunk);
+    NavChunk* navChunkWithPortals(IVec2 chunk);
+    void buildPortals(IVec2 chunk);
+    // seeds are distance in the top 32 bits and tile index in the bottom, sorted
+    void fillChunk(const NavChunk& nav, const Uint64* seeds, int seedCount, Uint32* costsOut);
+    Uint32* distancesOf(FlowField& field, IVec2 chunk, int portalCount);
+    FlowField* getField(Entity target, IVec2 targetTile);
+    void search(FlowField& field);
+    const Uint32* chunkCosts(FlowField& field, IVec2 chunk);
+    Uint32 cost(FlowField& field, IVec2 tile);
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef WORLD_TIMER_WHEEL_INCLUDED
+#define WORLD_TIMER_WHEEL_INCLUDED
+
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "ECS/Entity.hpp"
+#include "utils/Metadata.hpp"
+
+namespace World {
+
+/*
+ * Timers for things that happen to entities at a later tick, like destroying them or removing a component.
+ * Timers are kept in a hierarchical timer wheel: a ring of slots for each of the next 64 ticks,
+ * then a ring for each of the next 64 blocks of 64 ticks, and so on.
+ * A timer goes in the ring that it's due in, and gets moved down a ring when time gets to its slot,
+ * until it ends up in the slot of the tick it's due.
+ * Every tick only has to look at its own slot, no matter how many timers are waiting, so waiting timers cost nothing.
+ * Timers due the same tick fire in the order they were scheduled.
+ */
+
+enum class TimerAction : Uint8 {
+    Call, // call a callback registered with the entity world
+    RemoveComponent,
+    Destroy
+};
+
+struct TimerID {
+    int index;
+    Uint32 generation;
+};
+
+constexpr TimerID NullTimer = {-1, 0};
+
+struct Timer {
+    Tick tick;
+    Entity entity; // null for timers that aren't for an entity
+    Sint16 argument; // the callback or component, depending on the action
+    TimerAction action;
+    Uint32 generation; // goes up every time the timer is reused, so old timer ids don't cancel new timers
+    // neighbours in its slot
+    int prev;
+    int next;
+    // neighbours in the list of timers for the same entity
+    int prevOfEntity;
+    int nextOfEntity;
+    int slot;
+    bool alive;
+};
+
+struct TimerSlot {
+    int head;
+    int tail;
+};
+
+struct TimerWheel {
+    static constexpr int LevelBits = 6;
+    static constexpr int SlotsPerLevel = 1 << LevelBits;
+    static constexpr int Levels = 4;
+    // timers further away than all of the levels cover wait here until time gets closer
+    static constexpr int OverflowSlot = Levels * SlotsPerLevel;
+
+    My::Vec<Timer> timers;
+    My::Vec<int> freeTimers;
+    TimerSlot slots[OverflowSlot + 1];
+    My::HashMap<Uint32, int> byEntity; // entity id to its first timer
+    Tick now; // the tick being fired, or that was fired last
+    int pending;
+
+    static TimerWheel init(Tick now = 0);
+
+    void destroy();
+
+    /* Schedule a timer to fire at the tick.
+     * Timers for ticks that have already been fired go off the next tick instead
+     */
+    TimerID schedule(Tick tick, Entity entity, TimerAction action, Sint16 argument);
+
+    // @return False if the timer already went off or was cancelled
+    bool cancel(TimerID timer);
+
+    // cancel every timer for the entity
+    int cancelAll(Entity entity);
+
+    bool isPending(TimerID timer) const;
+
+    /* Take the next timer that is due by the tick, moving time forward to when it's due.
+     * Timers can be scheduled and cancelled between calls.
+     * @return False once there are no timers left due by the tick, after moving time up to it
+     */
+    bool next(Tick upTo, Timer* timerOut);
+
+private:
+    void place(int index);
+    void append(int slot, int index);
+    void unlink(int index);
+    void release(int index);
+    void cascade(int slot);
+};
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef WORLD_TRANSPORT_LINES_INCLUDED
+#define WORLD_TRANSPORT_LINES_INCLUDED
+
+#include <functional>
+#include "My/Vec.hpp"
+#include "My/HashMap.hpp"
+#include "items/items.hpp"
+#include "utils/vectors_and_rects.hpp"
+
+namespace World {
+
+/*
+ * Belt simulation.
+ * Every chain of belts that feed straight into each other (turns included) is merged into one transport line,
+ * and the line moves all of its items at once instead of each belt moving its own.
+ * Each line has two lanes. A lane stores its items from front (the end of the line) to back,
+ * and instead of a position, each item stores the gap between it and the item in front of it.
+ * When an item moves, everything behind it moves with it without any of their gaps changing,
+ * so a tick only has to shrink the gap of the frontmost item that isn't blocked (the lane's active item).
+ * Everything in front of that item is compressed and can't move anyway.
+ * That makes moving a lane O(1) per tick no matter how many items are on it, and an idle or fully compressed lane costs nothing.
+ * Placing, removing or turning a belt only takes apart the lines next to it, and makes new lines from their belts.
+ */
+
+using TransportLineID = int;
+constexpr TransportLineID NullTransportLine = -1;
+
+struct BeltItem {
+    Item item;
+    Sint32 gap; // distance to the item in front, or to the end of the line for the front item
+};
+
+struct TransportLane {
+    My::Vec<BeltItem> items; // front to back, starting at first
+    int first;  // items before this have already left the lane. they get cleared out every so often
+    int active; // the frontmost item that can still move. Everything in front of it is compressed
+    Sint32 distanceToBack; // sum of every gap, so the distance from the end of the line to the last item
+
+    int count() const {
+        return items.size - first;
+    }
+};
+
+struct TransportLineOutput {
+    TransportLineID line = NullTransportLine;
+    Sint32 distance; // where items go on the output line, as distance from its end
+    Sint8 lane; // -1 to keep the same lane, otherwise the lane of the output line that everything goes on (side loading)
+};
+
+struct TransportLine {
+    static constexpr int NumLanes = 2;
+
+    TransportLane lanes[NumLanes];
+    My::Vec<IVec2> belts; // tiles of each belt from start to end
+    Sint32 length; // belts.size * TileLength
+    Sint32 speed; // distance moved per tick
+    TransportLineOutput output;
+    // the end feeds straight back into the start. The front and back items of each lane are then next to each other
+    bool loops;
+};
+
+struct TransportBeltNode {
+    Entity entity;
+    IVec2 facing;
+    Sint32 speed;
+    TransportLineID line;
+    int index; // belts from the start of the line
+
+    // only used while rebuilding
+    int feederCount;
+    IVec2 feeder;
+};
+
+struct TransportLinesStats {
+    int lines;
+    int items;
+    int movingLanes; // lanes that had an item move last tick
+    int rebuilds;
+};
+
+// items left on belts that were removed, to be dropped in the world
+struct SpilledBeltItem {
+    Vec2 position;
+    Item item;
+};
+
+struct TransportLines {
+    static constexpr Sint32 TileLength = 256; // distance units per belt
+    static constexpr Sint32 ItemSpacing = TileLength / 4; // minimum distance between items on a lane
+
+    My::Vec<TransportLine> lines; // lines without any belts are free, and get reused by the next new line
+    My::Vec<TransportLineID> freeLines;
+    My::HashMap<IVec2, TransportBeltNode, IVec2Hash> belts;
+    My::Vec<SpilledBeltItem> spilled;
+    TransportLinesStats stats;
+    // belts were added, removed or rotated, so these lines need taking apart and these belts need lines before the next update
+    My::Vec<TransportLineID> brokenLines;
+    My::Vec<IVec2> newBelts;
+
+    /* called when items were put on or taken off a line, which includes going from one line to the next and around a loop.
+     * Items just moving along don't count. ticksUntilItem and ticksUntilRoom say when that would make a difference
+     */
+    std::function<void(TransportLineID)> onLineChanged;
+    // called for each line that was taken apart while rebuilding. Its belts are on other lines now, and its id may be reused
+    std::function<void(TransportLineID)> onLineRebuilt;
+
+    static TransportLines init();
+
+    void destroy();
+
+    // speed in tiles per tick
+    void addBelt(Entity entity, IVec2 tile, IVec2 facing, float speed);
+
+    void removeBelt(IVec2 tile);
+
+    void rotateBelt(IVec2 tile, IVec2 facing);
+
+    /* Put an item on the belt at the tile. Position goes from 0 at the back of the belt to 1 at the front.
+     * Fails if the item would be too close to another item
+     */
+    bool insertItem(IVec2 tile, int lane, float position, Item item);
+
+    // take the frontmost item in the lane that's on the belt at the tile
+    bool takeItem(IVec2 tile, int lane, Item* itemOut);
+
+    /* How many ticks until an item moving along the line could be on the belt at the tile, to be taken off.
+     * 0 if there's one on it already, and -1 if nothing is coming until something is put on or taken off the line
+     */
+    int ticksUntilItem(IVec2 tile) const;
+
+    /* How many ticks until items moving along the lane could have made room to insert an item at the position.
+     * -1 if everything around the position is stopped, so room only comes from something being taken off the line
+     */
+    int ticksUntilRoom(IVec2 tile, int lane, float position) const;
+
+    // move everything forward one tick
+    void update();
+
+    bool needsRebuild() const {
+        return brokenLines.size > 0 || newBelts.size > 0;
+    }
+
+    // make lines again around belts that were added, removed or rotated, keeping every item where it was. Every other line is left alone
+    void rebuild();
+
+    // where in the world an item on the lane is, given its distance from the end of the line
+    Vec2 itemPosition(const TransportLine& line, int lane, Sint32 distance) const;
+};
+
+// facing of a belt with the rotation, in 90 degree steps. 0 degrees faces +y
+IVec2 beltFacing(float degrees);
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include "items/items.hpp"
 #include "ECS/Entity.hpp"
 #include "ECS/componentMacros.hpp"
+#include "utils/StringInterner.hpp"
 
 #define BEGIN_COMPONENT(name) struct name {\
     constexpr static ComponentID ID = ComponentIDs::name;\
@@ -99,16 +100,30 @@ BEGIN_COMPONENT(Health)
     float damageTaken = 0.0f;
     Tick timeDamaged = NullTick;
     int32_t iFrames = 0; // frames of invincibility the entity has. -1 for permanent invincibility
+    Tick iFramesSet = 0; // when iFrames was set, so they can be counted down when needed instead of every tick
 
     #define ENTITY_HIT_COOLDOWN 30 // frames
 
-    void damage(float amount) {
-        if (!iFrames) {
-            health -= amount;
-            damageTaken = amount;
-            timeDamaged = Metadata->getTick();
-            iFrames = ENTITY_HIT_COOLDOWN;
-        }
+    // frames of invincibility the entity has left. -1 for permanent invincibility
+    int32_t iFramesLeft() const {
+        if (iFrames <= 0) return iFrames;
+        Tick passed = Metadata->getTick() - iFramesSet;
+        return passed >= iFrames ? 0 : (int32_t)(iFrames - passed);
+    }
+
+    void setIFrames(int32_t frames) {
+        iFrames = frames;
+        iFramesSet = Metadata->getTick();
+    }
+
+    // @return True if the damage was taken
+    bool damage(float amount) {
+        if (iFramesLeft()) return false;
+        health -= amount;
+        damageTaken = amount;
+        timeDamaged = Metadata->getTick();
+        setIFrames(ENTITY_HIT_COOLDOWN);
+        return true;
     }
 
     Health(float Health) : health(Health) {}
@@ -229,12 +244,13 @@ END_COMPONENT(Explosion)
 
 BEGIN_COMPONENT(Explosive)
     Explosion explosion;
+    int fuse; // ticks until it goes off by itself. 0 for no fuse
 
     struct SerializationData {
         char explosionName[64];
     };
 
-    Explosive(const Explosion& explosion) : explosion(explosion) {
+    Explosive(const Explosion& explosion, int fuse = 0) : explosion(explosion), fuse(fuse) {
 
     }
 END_COMPONENT(Explosive)
@@ -245,17 +261,15 @@ BEGIN_COMPONENT(EntityTypeEC)
     char name[MAX_ENTITY_NAME_LENGTH];
 END_COMPONENT(EntityTypeEC)
 
+// EntityWorld keeps an index of these, so only change names through Add or Set, not through Get
 BEGIN_COMPONENT(Nametag)
-    char name[MAX_ENTITY_NAME_LENGTH];
+    InternedString name;
 
-    void setName(const char* name);
+    Nametag() : name(NullInternedString) {}
 
-    Nametag() {
-        name[0] = '\0';
-    }
-    Nametag(const char* name) {
-        setName(name);
-    }
+    Nametag(InternedString name) : name(name) {}
+
+    Nametag(const char* name) : name(intern(name)) {}
 END_COMPONENT(Nametag)
 
 BEGIN_COMPONENT(Motion)
@@ -332,7 +346,7 @@ BEGIN_COMPONENT(Inserter)
     IVec2 outputTile;
 
     Inserter(int updatesPerMove, int stackSize, int reach, IVec2 input, IVec2 output)
-    : cycleLength(updatesPerMove), stackSize(stackSize), inputTile(input), outputTile(output) {
+    : cycleLength(updatesPerMove), stackSize(stackSize), reach(reach), inputTile(input), outputTile(output) {
         cycle = 0;
     }
 END_COMPONENT(Inserter)
@@ -373,18 +387,17 @@ BEGIN_COMPONENT(ItemStack)
     ItemStack(::ItemStack itemStack) : item(itemStack) {}
 END_COMPONENT(ItemStack)
 
+// a belt. Belts are simulated together as lines by World::TransportLines
 BEGIN_COMPONENT(Transporter)
     IVec2 facing;
-    float speed;
+    float speed; // tiles per tick
 
-    Transporter(float speed) : speed(speed) {}
+    Transporter(float speed, IVec2 facing = {0, 1}) : facing(facing), speed(speed) {}
 END_COMPONENT(Transporter)
 
 BEGIN_COMPONENT(TransportLineEC)
     IVec2 originTile;
-    float cycle; // 0 to 1
     IVec2 endTile;
-    My::Vec<IVec2> belts;
 END_COMPONENT(TransportLineEC)
 
 BEGIN_COMPONENT(Immortal)
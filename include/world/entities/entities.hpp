@@ -14,9 +14,6 @@ using ExplosionCreateFunction = Entity(EntityWorld*, Vec2);
 
 namespace Entities {
 
-    #define MARK_START_ENTITY_CREATION(ecs) {ecs->StartDeferringEvents();}
-    #define MARK_END_ENTITY_CREATION(ecs) {ecs->StopDeferringEvents();}
-
     struct EntityMaker : Entity {
         EntityMaker(EntityWorld* ecs, ECS::PrototypeID prototype = PrototypeIDs::Default)
         : Entity(ecs->New(prototype)) {}
@@ -30,20 +27,14 @@ namespace Entities {
     struct Explosion : EntityMaker {
         Explosion(EntityWorld* ecs, Vec2 position, const EC::Explosion& explosionComponent)
         : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
-
             Add<EC::Point>(ecs, position);
             Add<EC::Explosion>(ecs, explosionComponent);
-
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
     struct Explosive : EntityMaker {
         Explosive(EntityWorld* ecs, Vec2 position, Vec2 size, TextureID texture, const EC::Explosion& explosion, float startRotation = 0.0f)
         : EntityMaker(ecs, PrototypeIDs::Explosive) {
-            MARK_START_ENTITY_CREATION(ecs);
-
             Box box = {{0.0f,0.0f}, size};
             Add<EC::Position>(ecs, position);
             Add<EC::Dynamic>(ecs, position);
@@ -51,8 +42,6 @@ namespace Entities {
             Add<EC::Explosive>(ecs, EC::Explosive(explosion));
             Add<EC::Render>(ecs, EC::Render(texture, RenderLayers::Particles));
             Add<EC::Rotation>(ecs, {startRotation});
-
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
@@ -63,8 +52,6 @@ namespace Entities {
     struct Player : EntityMaker {
         Player(EntityWorld* ecs, Vec2 position, ItemManager& inventoryAllocator)
         : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
-
             Add<EC::Position>(ecs, position);
             Add<EC::Dynamic>(ecs, {position});
             Add<EC::ViewBox>(ecs, {Vec2(0), Vec2(1.0f)});
@@ -80,8 +67,6 @@ namespace Entities {
             Add<EC::Render>(ecs, EC::Render(textures, 2));
             Add<EC::Special>(ecs, {});
             Add<EC::Immortal>(ecs, {});
-
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
@@ -90,14 +75,11 @@ namespace Entities {
     struct ItemStack : EntityMaker {
         //using EntityT<ENTITY_ITEMSTACK_COMPONENTS>::EntityT;
         ItemStack(EntityWorld* ecs, Vec2 position, ::ItemStack item, const ItemManager& itemManager) : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
             Add<EC::Position>(ecs, {position});
             Add<EC::ViewBox>(ecs, {Box{Vec2(0), Vec2(1)}});
             Add<EC::ItemStack>(ecs, {item});
             Add<EC::Grabbable>(ecs, {item});
             Add<EC::Render>(ecs, EC::Render(itemManager.getComponent<ITC::Display>(item.item)->inventoryIcon, RenderLayers::Items));
-            
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
@@ -105,7 +87,6 @@ namespace Entities {
         EC::Render, EC::ViewBox, EC::Transporter, EC::Position
     struct TransportBelt : EntityMaker {
         TransportBelt(EntityWorld* ecs, Vec2 position) : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
             Add<EC::Health>(ecs, {100.0f});
             Add<EC::Position>(ecs, position);
             Add<EC::ViewBox>(ecs, {Box{Vec2(0), Vec2(1)}});
@@ -113,7 +94,6 @@ namespace Entities {
             Add<EC::Rotation>(ecs, {0.0f});
             Add<EC::Rotatable>(ecs, EC::Rotatable(0.0f, 90.0f));
             Add<EC::Transporter>(ecs, {0.15f});
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
@@ -122,19 +102,14 @@ namespace Entities {
     #define ENTITY_TRANSPORT_LINE_COMPONENTS EC::Position
     struct TransportLine : EntityMaker {
         TransportLine(EntityWorld* ecs, Vec2 position) : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
-
             Add<EC::Position>(ecs, position);
             //Add<EC::TransportLineEC(ecs, {});
-            
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 
     struct Tree : EntityMaker {
         //using TreeType::TreeType;
         Tree(EntityWorld* ecs, Vec2 position, Vec2 size) : EntityMaker(ecs) {
-            MARK_START_ENTITY_CREATION(ecs);
             Add(ecs, EC::Health(100.0f));
             Add(ecs, EC::Growth(0.0f));
             Box texBox = Box{Vec2(-0.1), Vec2(1.2)};
@@ -147,7 +122,6 @@ namespace Entities {
             
             Add(ecs, EC::ViewBox(Box{Vec2(-0.5) * size, Vec2(size)}));
             Add(ecs, EC::CollisionBox(Box{Vec2(-0.4) * size, Vec2(0.8) * size}));
-            MARK_END_ENTITY_CREATION(ecs);
         }
     };
 }
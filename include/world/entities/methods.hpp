@@ -19,7 +19,7 @@ void scaleGuy(GameState* state, Entity guy, float scale);
 
 /* 
  * Find an entity with a given name. If multiple entities have the same name,
- * the entity will be chosen randomly
+ * the one that's had it the longest is chosen
  */
 Entity findNamedEntity(const char* name, const EntityWorld* ecs);
 
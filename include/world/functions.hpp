@@ -5,8 +5,15 @@
 
 struct ChunkMap;
 
+namespace Physics {
+    struct Space;
+}
+
 namespace World {
 
+struct TransportLines;
+struct Inserters;
+
 inline float getLayerHeight(int layer) {
     return layer * 0.05f - 0.5f;
 }
@@ -34,7 +41,15 @@ Entity findPlayerFocusedEntity(const EntityWorld& ecs, const ChunkMap& chunkmap,
 
 Box getEntityViewBoxBounds(const EntityWorld* ecs, Entity entity);
 
-void setEventCallbacks(EntityWorld& ecs, ChunkMap& chunkmap);
+void setEventCallbacks(EntityWorld& ecs, ChunkMap& chunkmap, TransportLines& transportLines, Inserters& inserters, Physics::Space& physics);
+
+/* Damage the entity if it has health and isn't invincible.
+ * Entities whose health runs out are destroyed the next time timers are updated, unless they're immortal.
+ */
+void damageEntity(EntityWorld& ecs, Entity entity, float damage);
+
+// turn the entity by its rotation increment. Belts get their lines rebuilt facing the new way
+void rotateEntity(const EntityWorld& ecs, TransportLines& transportLines, Entity entity, bool clockwise);
 
 void forEachEntityInRange(const EntityWorld& ecs, const ChunkMap* chunkmap, Vec2 pos, float radius, const std::function<int(Entity)>& callback);
 
@@ -5,7 +5,7 @@
 ChunkData::ChunkData(Chunk* chunk, IVec2 position) {
     this->chunk = chunk;
     this->position = position;
-    this->closeEntities = My::Vec<Entity>(0);
+    this->closeEntities = My::SmallVec<Entity, InlineCloseEntities>::Empty();
 }
 
 void generateChunk(ChunkData* chunkdata) {
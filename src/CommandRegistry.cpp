@@ -0,0 +1,615 @@
+#include "CommandRegistry.hpp"
+#include "My/String.hpp"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <algorithm>
+
+namespace {
+
+// the slot a name with the hash goes in, once its bucket has the displacement
+Uint32 slotFor(Uint32 hash, Uint32 displacement, Uint32 slotMask) {
+    hash ^= displacement * 0x9E3779B9u;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    return hash & slotMask;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool sameWord(const std::string& a, const std::string& b) {
+    return My::streq_case(a.c_str(), b.c_str(), (int)a.size(), (int)b.size());
+}
+
+std::string trimmed(const std::string& str) {
+    size_t start = 0;
+    size_t end = str.size();
+    while (start < end && isSpace(str[start])) start++;
+    while (end > start && isSpace(str[end - 1])) end--;
+    return str.substr(start, end - start);
+}
+
+const char* typeName(const CommandArgSpec& spec) {
+    switch (spec.type) {
+    case CommandArgTypes::Int: return "int";
+    case CommandArgTypes::Float: return "float";
+    case CommandArgTypes::Bool: return "bool";
+    case CommandArgTypes::String: return "string";
+    case CommandArgTypes::Choice: return "choice";
+    case CommandArgTypes::Text: return "text";
+    }
+    return "?";
+}
+
+bool checkRange(const CommandArgSpec& spec, double value, const std::string& typed, std::string* error) {
+    if (spec.hasMin && value < spec.min) {
+        *error = string_format("%s should be at least %g, got %s.", spec.name.c_str(), spec.min, typed.c_str());
+        return false;
+    }
+    if (spec.hasMax && value > spec.max) {
+        *error = string_format("%s should be at most %g, got %s.", spec.name.c_str(), spec.max, typed.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* Check a typed value fits the argument
+ * @param out The value as it's passed to the command
+ */
+bool checkValue(const CommandArgSpec& spec, const std::string& value, std::string* out, std::string* error) {
+    const char* str = value.c_str();
+    switch (spec.type) {
+    case CommandArgTypes::Int: {
+        char* end;
+        errno = 0;
+        long long number = strtoll(str, &end, 10);
+        if (end == str || *end != '\0') {
+            *error = string_format("%s should be a whole number, got \"%s\".", spec.name.c_str(), str);
+            return false;
+        }
+        if (errno == ERANGE || number > INT32_MAX || number < INT32_MIN) {
+            *error = string_format("%s is too big, got %s.", spec.name.c_str(), str);
+            return false;
+        }
+        if (!checkRange(spec, (double)number, value, error)) return false;
+        *out = value;
+        return true;
+    }
+    case CommandArgTypes::Float: {
+        char* end;
+        double number = strtod(str, &end);
+        if (end == str || *end != '\0' || !isfinite(number)) {
+            *error = string_format("%s should be a number, got \"%s\".", spec.name.c_str(), str);
+            return false;
+        }
+        if (!checkRange(spec, number, value, error)) return false;
+        *out = value;
+        return true;
+    }
+    case CommandArgTypes::Bool: {
+        static const char* const yes[] = {"1", "true", "yes", "on", "y"};
+        static const char* const no[] = {"0", "false", "no", "off", "n"};
+        for (const char* word : yes) {
+            if (sameWord(value, word)) {
+                *out = "1";
+                return true;
+            }
+        }
+        for (const char* word : no) {
+            if (sameWord(value, word)) {
+                *out = "0";
+                return true;
+            }
+        }
+        *error = string_format("%s should be on or off, got \"%s\".", spec.name.c_str(), str);
+        return false;
+    }
+    case CommandArgTypes::Choice: {
+        for (const auto& choice : spec.choices) {
+            if (sameWord(value, choice)) {
+                *out = choice;
+                return true;
+            }
+        }
+        std::string choices;
+        for (size_t i = 0; i < spec.choices.size(); i++) {
+            if (i > 0) choices += ", ";
+            choices += spec.choices[i];
+        }
+        *error = string_format("%s should be one of %s, got \"%s\".", spec.name.c_str(), choices.c_str(), str);
+        return false;
+    }
+    case CommandArgTypes::String:
+    case CommandArgTypes::Text:
+        *out = value;
+        return true;
+    }
+    return false;
+}
+
+bool parseSpec(const std::string& part, CommandArgSpec* spec, std::string* error) {
+    spec->optional = false;
+    spec->hasMin = false;
+    spec->hasMax = false;
+    spec->min = 0.0;
+    spec->max = 0.0;
+
+    size_t colon = part.find(':');
+    if (colon == std::string::npos || colon == 0) {
+        *error = string_format("Argument \"%s\" needs a name and a type, like count:int.", part.c_str());
+        return false;
+    }
+    spec->name = part.substr(0, colon);
+    std::string rest = part.substr(colon + 1);
+
+    size_t equals = rest.find('=');
+    if (equals != std::string::npos) {
+        spec->optional = true;
+        spec->defaultValue = rest.substr(equals + 1);
+        rest = rest.substr(0, equals);
+    }
+
+    size_t bracket = rest.find('[');
+    std::string type = rest.substr(0, bracket);
+    if (bracket != std::string::npos) {
+        if (rest.back() != ']') {
+            *error = string_format("The range of %s isn't closed.", spec->name.c_str());
+            return false;
+        }
+        std::string range = rest.substr(bracket + 1, rest.size() - bracket - 2);
+        size_t comma = range.find(',');
+        if (comma == std::string::npos) {
+            *error = string_format("The range of %s should be [min,max], with either one left out.", spec->name.c_str());
+            return false;
+        }
+        std::string min = range.substr(0, comma);
+        std::string max = range.substr(comma + 1);
+        if (!min.empty()) {
+            spec->hasMin = true;
+            spec->min = strtod(min.c_str(), nullptr);
+        }
+        if (!max.empty()) {
+            spec->hasMax = true;
+            spec->max = strtod(max.c_str(), nullptr);
+        }
+    }
+
+    if (type.size() >= 2 && type.front() == '{' && type.back() == '}') {
+        spec->type = CommandArgTypes::Choice;
+        std::string words = type.substr(1, type.size() - 2);
+        size_t start = 0;
+        while (start <= words.size()) {
+            size_t comma = words.find(',', start);
+            if (comma == std::string::npos) comma = words.size();
+            std::string word = words.substr(start, comma - start);
+            if (word.empty()) {
+                *error = string_format("%s has an empty choice.", spec->name.c_str());
+                return false;
+            }
+            spec->choices.push_back(word);
+            start = comma + 1;
+        }
+    } else if (type == "int") {
+        spec->type = CommandArgTypes::Int;
+    } else if (type == "float") {
+        spec->type = CommandArgTypes::Float;
+    } else if (type == "bool") {
+        spec->type = CommandArgTypes::Bool;
+    } else if (type == "string") {
+        spec->type = CommandArgTypes::String;
+    } else if (type == "text") {
+        spec->type = CommandArgTypes::Text;
+    } else {
+        *error = string_format("%s has an unknown type \"%s\".", spec->name.c_str(), type.c_str());
+        return false;
+    }
+
+    if ((spec->hasMin || spec->hasMax) && spec->type != CommandArgTypes::Int && spec->type != CommandArgTypes::Float) {
+        *error = string_format("%s can't have a range, only numbers can.", spec->name.c_str());
+        return false;
+    }
+
+    if (spec->optional) {
+        std::string defaultError;
+        if (!checkValue(*spec, spec->defaultValue, &spec->defaultValue, &defaultError)) {
+            *error = "Bad default: " + defaultError;
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+bool tokenizeCommandArgs(const char* text, std::vector<CommandToken>* tokens, std::string* error) {
+    tokens->clear();
+    if (!text) return true;
+    int i = 0;
+    for (;;) {
+        while (isSpace(text[i])) i++;
+        if (text[i] == '\0') return true;
+
+        CommandToken token;
+        token.start = i;
+        if (text[i] == '"') {
+            i++;
+            for (;;) {
+                char c = text[i];
+                if (c == '\0') {
+                    *error = string_format("The quote at column %d is never closed.", token.start + 1);
+                    return false;
+                }
+                if (c == '"') {
+                    i++;
+                    break;
+                }
+                if (c == '\\' && (text[i+1] == '"' || text[i+1] == '\\')) {
+                    token.value.push_back(text[i+1]);
+                    i += 2;
+                    continue;
+                }
+                token.value.push_back(c);
+                i++;
+            }
+            if (text[i] != '\0' && !isSpace(text[i])) {
+                *error = string_format("Expected a space after the quote ending at column %d.", i);
+                return false;
+            }
+        } else {
+            int depth = 0;
+            int openedAt = 0;
+            while (text[i] != '\0' && (depth > 0 || !isSpace(text[i]))) {
+                char c = text[i];
+                if (c == '{') {
+                    if (depth == 0) openedAt = i;
+                    depth++;
+                } else if (c == '}') {
+                    if (depth == 0) {
+                        *error = string_format("The } at column %d doesn't close anything.", i + 1);
+                        return false;
+                    }
+                    depth--;
+                }
+                token.value.push_back(c);
+                i++;
+            }
+            if (depth > 0) {
+                *error = string_format("The { at column %d is never closed.", openedAt + 1);
+                return false;
+            }
+        }
+        tokens->push_back(std::move(token));
+    }
+}
+
+bool CommandSchema::parse(const char* signature, CommandSchema* schema, std::string* error) {
+    schema->args.clear();
+    schema->defined = true;
+
+    std::vector<CommandToken> parts;
+    if (!tokenizeCommandArgs(signature, &parts, error)) return false;
+    for (const auto& part : parts) {
+        CommandArgSpec spec;
+        if (!parseSpec(part.value, &spec, error)) return false;
+        if (!schema->args.empty()) {
+            const auto& last = schema->args.back();
+            if (last.type == CommandArgTypes::Text) {
+                *error = string_format("%s takes the rest of the line, so it has to be last.", last.name.c_str());
+                return false;
+            }
+            if (last.optional && !spec.optional) {
+                *error = string_format("%s comes after an optional argument, so it needs a default too.", spec.name.c_str());
+                return false;
+            }
+        }
+        schema->args.push_back(std::move(spec));
+    }
+    return true;
+}
+
+std::string CommandSchema::usage(const char* commandName) const {
+    std::string usage = string_format("Usage: %s", commandName);
+    for (const auto& spec : args) {
+        std::string type = typeName(spec);
+        if (spec.type == CommandArgTypes::Choice) {
+            type = "{";
+            for (size_t i = 0; i < spec.choices.size(); i++) {
+                if (i > 0) type += ",";
+                type += spec.choices[i];
+            }
+            type += "}";
+        }
+        if (spec.optional) {
+            usage += string_format(" [%s:%s=%s]", spec.name.c_str(), type.c_str(), spec.defaultValue.c_str());
+        } else {
+            usage += string_format(" <%s:%s>", spec.name.c_str(), type.c_str());
+        }
+    }
+    return usage;
+}
+
+void Command::setArgs(const char* signature) {
+    std::string error;
+    if (!CommandSchema::parse(signature, &schema, &error)) {
+        LogError("Bad arguments for command %s: %s", name, error.c_str());
+        schema = CommandSchema();
+    }
+}
+
+bool Command::bind(const char* arguments, CommandArgs* args, std::string* error) const {
+    args->values.clear();
+    args->next = 0;
+
+    std::vector<CommandToken> tokens;
+    std::string tokenError;
+    if (!tokenizeCommandArgs(arguments, &tokens, &tokenError)) {
+        *error = string_format("%s: %s", name, tokenError.c_str());
+        return false;
+    }
+
+    if (!schema.defined) {
+        for (auto& token : tokens) {
+            args->values.push_back(std::move(token.value));
+        }
+        return true;
+    }
+
+    int tokensUsed = 0;
+    for (int i = 0; i < (int)schema.args.size(); i++) {
+        const auto& spec = schema.args[i];
+        if (i >= (int)tokens.size()) {
+            if (!spec.optional) {
+                *error = string_format("%s: missing %s.\n%s", name, spec.name.c_str(), schema.usage(name).c_str());
+                return false;
+            }
+            args->values.push_back(spec.defaultValue);
+            continue;
+        }
+        if (spec.type == CommandArgTypes::Text) {
+            args->values.push_back(trimmed(arguments + tokens[i].start));
+            tokensUsed = (int)tokens.size();
+            break;
+        }
+        std::string value;
+        std::string valueError;
+        if (!checkValue(spec, tokens[i].value, &value, &valueError)) {
+            *error = string_format("%s: %s\n%s", name, valueError.c_str(), schema.usage(name).c_str());
+            return false;
+        }
+        args->values.push_back(std::move(value));
+        tokensUsed++;
+    }
+
+    if (tokensUsed < (int)tokens.size()) {
+        *error = string_format("%s: takes at most %d arguments, got %d.\n%s",
+            name, (int)schema.args.size(), (int)tokens.size(), schema.usage(name).c_str());
+        return false;
+    }
+    return true;
+}
+
+Command::Result Command::run(const char* arguments) const {
+    CommandArgs args;
+    std::string error;
+    if (!bind(arguments, &args, &error)) {
+        return Result{Result::Error, error};
+    }
+    return function(std::move(args));
+}
+
+Uint32 CommandTable::hash(const char* name, int length, Uint32 seed) {
+    Uint32 hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (int i = 0; i < length; i++) {
+        hash ^= (Uint32)tolower((unsigned char)name[i]);
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+CommandTable CommandTable::build(ArrayRef<Command> commands) {
+    CommandTable table;
+    table.commandCount = (int)commands.size();
+
+    // a name registered twice would never get a slot of its own. Names that are the same hash the same,
+    // so only names next to each other sorted by hash have to be compared
+    std::vector<std::pair<Uint32, int>> byHash;
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (commands[i].nameLength == 0) continue;
+        byHash.push_back({hash(commands[i].name, commands[i].nameLength, 0), (int)i});
+    }
+    std::sort(byHash.begin(), byHash.end());
+    std::vector<bool> duplicate(commands.size(), false);
+    for (size_t i = 0; i < byHash.size(); i++) {
+        for (size_t j = i + 1; j < byHash.size() && byHash[j].first == byHash[i].first; j++) {
+            const Command& first = commands[byHash[i].second];
+            const Command& second = commands[byHash[j].second];
+            if (!duplicate[byHash[j].second] && My::streq_case(first.name, second.name, first.nameLength, second.nameLength)) {
+                LogError("Command %s was registered twice, only the first one is used.", second.name);
+                duplicate[byHash[j].second] = true;
+            }
+        }
+    }
+    std::vector<int> named;
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (commands[i].nameLength > 0 && !duplicate[i]) named.push_back((int)i);
+    }
+
+    // about four names a bucket, and slots to spare so the last buckets don't have to look long for free ones
+    Uint32 bucketCount = 1;
+    while (bucketCount * 4 < named.size()) bucketCount *= 2;
+    Uint32 slotCount = 4;
+    while (slotCount < named.size() + named.size() / 4) slotCount *= 2;
+    table.bucketMask = bucketCount - 1;
+    table.slotMask = slotCount - 1;
+
+    constexpr Uint32 MaxDisplacement = 1 << 20;
+    std::vector<Uint32> hashes(named.size());
+    std::vector<std::vector<int>> buckets;
+    std::vector<int> order;
+    std::vector<Uint32> taken;
+    // a bucket only fails when two names hash the same, so another seed sorts that out
+    for (Uint32 seed = 1;; seed++) {
+        for (size_t i = 0; i < named.size(); i++) {
+            const Command& command = commands[named[i]];
+            hashes[i] = hash(command.name, command.nameLength, seed);
+        }
+        buckets.assign(bucketCount, {});
+        for (size_t i = 0; i < named.size(); i++) {
+            buckets[hashes[i] & table.bucketMask].push_back((int)i);
+        }
+        order.resize(bucketCount);
+        for (Uint32 b = 0; b < bucketCount; b++) {
+            order[b] = (int)b;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs){
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        table.seed = seed;
+        table.displacements.assign(bucketCount, 0);
+        table.slots.assign(slotCount, -1);
+        bool placed = true;
+        for (int b : order) {
+            const std::vector<int>& bucket = buckets[b];
+            if (bucket.empty()) break;
+            Uint32 displacement = 0;
+            for (; displacement < MaxDisplacement; displacement++) {
+                taken.clear();
+                for (int i : bucket) {
+                    Uint32 slot = slotFor(hashes[i], displacement, table.slotMask);
+                    if (table.slots[slot] != -1 || std::find(taken.begin(), taken.end(), slot) != taken.end()) break;
+                    taken.push_back(slot);
+                }
+                if (taken.size() == bucket.size()) break;
+            }
+            if (displacement == MaxDisplacement) {
+                placed = false;
+                break;
+            }
+            table.displacements[b] = displacement;
+            for (size_t i = 0; i < bucket.size(); i++) {
+                table.slots[taken[i]] = named[bucket[i]];
+            }
+        }
+        if (placed) return table;
+    }
+}
+
+int CommandTable::find(ArrayRef<Command> commands, const char* name, int length) const {
+    if (slots.empty()) return -1;
+    Uint32 nameHash = hash(name, length, seed);
+    int index = slots[slotFor(nameHash, displacements[nameHash & bucketMask], slotMask)];
+    if (index < 0 || index >= (int)commands.size()) return -1;
+    const Command& command = commands[index];
+    if (!My::streq_case(command.name, name, command.nameLength, length)) return -1;
+    return index;
+}
+
+bool CommandScript::parse(const char* text, CommandScript* script, std::string* error) {
+    script->steps.clear();
+    Sint64 tick = 0;
+    int lineNumber = 0;
+    const char* lineStart = text;
+    while (lineStart && *lineStart != '\0') {
+        lineNumber++;
+        const char* lineEnd = strchr(lineStart, '\n');
+        std::string line = lineEnd ? std::string(lineStart, lineEnd - lineStart) : std::string(lineStart);
+        lineStart = lineEnd ? lineEnd + 1 : nullptr;
+
+        line = trimmed(line);
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t commandStart = 0;
+        if (line[0] == '@' || line[0] == '+') {
+            char* end;
+            errno = 0;
+            long long ticks = strtoll(line.c_str() + 1, &end, 10);
+            if (end == line.c_str() + 1 || errno == ERANGE || ticks < 0 || (*end != '\0' && !isSpace(*end))) {
+                *error = string_format("Line %d: \"%c\" should be followed by a number of ticks.", lineNumber, line[0]);
+                return false;
+            }
+            if (line[0] == '@') {
+                if (ticks < tick) {
+                    *error = string_format("Line %d: tick %lld comes before tick %lld of the line before it.", lineNumber, ticks, (long long)tick);
+                    return false;
+                }
+                tick = ticks;
+            } else {
+                tick += ticks;
+            }
+            commandStart = end - line.c_str();
+        }
+
+        std::string command = trimmed(line.substr(commandStart));
+        if (!command.empty() && command[0] == '/') command.erase(0, 1);
+        if (command.empty()) {
+            *error = string_format("Line %d: there's no command to run.", lineNumber);
+            return false;
+        }
+
+        size_t nameEnd = 0;
+        while (nameEnd < command.size() && !isSpace(command[nameEnd])) nameEnd++;
+        CommandScript::Step step;
+        step.tick = tick;
+        step.line = lineNumber;
+        step.command = command.substr(0, nameEnd);
+        step.arguments = trimmed(command.substr(nameEnd));
+        script->steps.push_back(std::move(step));
+    }
+    return true;
+}
+
+bool CommandScript::check(ArrayRef<Command> commands, const CommandTable& table, std::string* error) const {
+    for (const auto& step : steps) {
+        int index = table.find(commands, step.command.c_str(), (int)step.command.size());
+        if (index < 0) {
+            *error = string_format("Line %d: no command named \"%s\".", step.line, step.command.c_str());
+            return false;
+        }
+        CommandArgs args;
+        std::string bindError;
+        if (!commands[index].bind(step.arguments.c_str(), &args, &bindError)) {
+            *error = string_format("Line %d: %s", step.line, bindError.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandScriptRunner::start(CommandScript newScript, Sint64 tick) {
+    script = std::move(newScript);
+    startTick = tick;
+    nextStep = 0;
+    running = !script.steps.empty();
+}
+
+int CommandScriptRunner::update(Sint64 tick, ArrayRef<Command> commands, const CommandTable& table, const ResultCallback& onResult) {
+    int ran = 0;
+    while (running && nextStep < (int)script.steps.size() && startTick + script.steps[nextStep].tick <= tick) {
+        // a command could start another script, replacing this one
+        CommandScript::Step step = script.steps[nextStep++];
+        int index = table.find(commands, step.command.c_str(), (int)step.command.size());
+        Command::Result result;
+        if (index >= 0) {
+            result = commands[index].run(step.arguments.c_str());
+        } else {
+            result = Command::Result{Command::Result::Error, string_format("No command named \"%s\".", step.command.c_str())};
+        }
+        ran++;
+        if (onResult) onResult(step, result);
+        if (result.type == Command::Result::Error) {
+            running = false;
+        }
+    }
+    if (nextStep >= (int)script.steps.size()) {
+        running = false;
+    }
+    return ran;
+}
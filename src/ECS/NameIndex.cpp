@@ -0,0 +1,55 @@
+#include "ECS/NameIndex.hpp"
+
+using namespace ECS;
+
+NameIndex NameIndex::init() {
+    NameIndex self;
+    self.byName = My::HashMap<Uint32, Entities>::WithBuckets(16);
+    return self;
+}
+
+void NameIndex::add(InternedString name, Entity entity) {
+    if (name.null()) return;
+    Entities* entities = byName.lookup(name.id);
+    if (!entities) {
+        entities = byName.insert(name.id, Entities::Empty());
+    }
+    entities->push(entity);
+}
+
+bool NameIndex::remove(InternedString name, Entity entity) {
+    Entities* entities = name ? byName.lookup(name.id) : nullptr;
+    if (!entities) return false;
+    for (int i = 0; i < entities->size; i++) {
+        if ((*entities)[i] == entity) {
+            entities->remove(i);
+            if (entities->empty()) {
+                entities->destroy();
+                byName.remove(name.id);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+Entity NameIndex::find(InternedString name) const {
+    Entities* entities = name ? byName.lookup(name.id) : nullptr;
+    if (!entities) return NullEntity;
+    return (*entities)[0];
+}
+
+ArrayRef<Entity> NameIndex::findAll(InternedString name) const {
+    Entities* entities = name ? byName.lookup(name.id) : nullptr;
+    if (!entities) return ArrayRef<Entity>();
+    return entities->ref();
+}
+
+void NameIndex::destroy() {
+    for (int i = 0; i < byName.bucketCount; i++) {
+        if (byName.buckets()[i].state == My::Map::Bucket_Filled) {
+            byName.values()[i].destroy();
+        }
+    }
+    byName.destroy();
+}
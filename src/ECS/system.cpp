@@ -138,6 +138,10 @@ void ECS::System::executeSystems(SystemManager& sysManager) {
                         } else {
                             char* poolComponentArray = pool->getBuffer(neededComponentIndex);
                             array->data = poolComponentArray - entitiesProcessed * pool->archetype.sizes[neededComponentIndex];
+                            if (!array->readonly) {
+                                // the job could write to any of them
+                                pool->markAllChanged(neededComponentIndex, sysManager.entityManager->components.changeVersion);
+                            }
                             if (array->optionalExecute) {
                                 optionalExecutes.push_back(array->optionalExecute);
                             }
@@ -0,0 +1,232 @@
+#include "GUI/ConsoleLog.hpp"
+#include "My/String.hpp"
+#include "memory.hpp"
+
+#include <string.h>
+#include <stdio.h>
+
+namespace GUI {
+
+namespace {
+
+bool sameColor(SDL_Color lhs, SDL_Color rhs) {
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b && lhs.a == rhs.a;
+}
+
+}
+
+ConsoleLog ConsoleLog::init(int lineCapacity, Uint32 textCapacity) {
+    ConsoleLog log;
+    log.lines = Alloc<Line>(lineCapacity);
+    log.lineCapacity = lineCapacity;
+    log.firstSeq = 0;
+    log.endSeq = 0;
+    log.text = Alloc<char>(textCapacity);
+    log.textCapacity = textCapacity;
+    log.textHead = 0;
+    log.filter = Filter::All();
+    log.view = Alloc<Seq>(lineCapacity);
+    log.viewFirst = 0;
+    log.viewEnd = 0;
+    log.scroll = 0;
+    memset(log.counts, 0, sizeof(log.counts));
+    return log;
+}
+
+char* ConsoleLog::allocText(Uint32 size) {
+    if (textHead + size > textCapacity) {
+        // the lines after the head are older than the ones before it, so they're written over first
+        while (this->size() > 0 && line(0).textStart >= textHead) {
+            popOldest();
+        }
+        textHead = 0;
+    }
+    while (this->size() > 0 && line(0).textStart >= textHead && line(0).textStart < textHead + size) {
+        popOldest();
+    }
+    char* result = &text[textHead];
+    textHead += size;
+    return result;
+}
+
+void ConsoleLog::popOldest() {
+    const Line& oldest = line(0);
+    counts[oldest.category][oldest.priority]--;
+    if (viewSize() > 0 && view[viewFirst % lineCapacity] == oldest.seq) {
+        viewFirst++;
+    }
+    firstSeq++;
+    int maxScroll = viewSize() - 1;
+    if (scroll > maxScroll) {
+        scroll = MAX(maxScroll, 0);
+    }
+}
+
+void ConsoleLog::popNewest() {
+    const Line& newest = line(size() - 1);
+    counts[newest.category][newest.priority]--;
+    if (viewSize() > 0 && view[(viewEnd - 1) % lineCapacity] == newest.seq) {
+        viewEnd--;
+    }
+    // its text was the last thing written
+    textHead = newest.textStart;
+    endSeq--;
+}
+
+void ConsoleLog::addLine(const char* lineText, Uint32 textLength, int copyNumber, SDL_Color color, int category, LogPriority priority, bool playerEntered) {
+    if (size() == lineCapacity) {
+        popOldest();
+    }
+
+    char prefix[16] = {'\0'};
+    Uint32 prefixLength = 0;
+    if (copyNumber > 0) {
+        prefixLength = (Uint32)snprintf(prefix, sizeof(prefix), "(%d) ", copyNumber);
+    }
+    Uint32 maxLength = textCapacity / 4 - prefixLength - 1;
+    if (textLength > maxLength) {
+        textLength = maxLength;
+        // don't cut a character in half
+        while (textLength > 0 && ((Uint8)lineText[textLength] & 0xC0) == 0x80) textLength--;
+    }
+
+    char* dest = allocText(prefixLength + textLength + 1);
+    memcpy(dest, prefix, prefixLength);
+    memcpy(dest + prefixLength, lineText, textLength);
+    dest[prefixLength + textLength] = '\0';
+
+    Line newLine;
+    newLine.seq = endSeq;
+    newLine.textStart = (Uint32)(dest - text);
+    newLine.textLength = prefixLength + textLength;
+    newLine.prefixLength = prefixLength;
+    newLine.copyNumber = copyNumber;
+    newLine.height = 0.0f;
+    newLine.color = color;
+    newLine.category = (Uint8)category;
+    newLine.priority = (Uint8)priority;
+    newLine.playerEntered = playerEntered;
+    lines[endSeq % lineCapacity] = newLine;
+    endSeq++;
+    counts[category][priority]++;
+
+    if (passes(newLine)) {
+        view[viewEnd % lineCapacity] = newLine.seq;
+        viewEnd++;
+        // stay on the same lines when scrolled up
+        if (scroll > 0) scroll++;
+    }
+}
+
+void ConsoleLog::push(const char* lineText, SDL_Color color, int category, LogPriority priority, bool playerEntered) {
+    if (lineCapacity == 0 || !lineText) return;
+    category = MIN(MAX(category, 0), MaxCategories - 1);
+    int clampedPriority = MAX((int)priority, 0);
+    priority = (LogPriority)MIN(clampedPriority, LogPriorities::NumPriorities - 1);
+
+    if (size() > 0) {
+        const Line& newest = line(size() - 1);
+        if (newest.category == category && newest.playerEntered == playerEntered
+            && sameColor(newest.color, color) && strcmp(rawText(newest), lineText) == 0) {
+            // the copy count goes in front, so the line is written again
+            std::string repeated = rawText(newest);
+            int copyNumber = newest.copyNumber + 1;
+            int oldScroll = scroll;
+            popNewest();
+            addLine(repeated.c_str(), (Uint32)repeated.size(), copyNumber, color, category, priority, playerEntered);
+            int maxScroll = viewSize() - 1;
+            scroll = MIN(oldScroll, MAX(maxScroll, 0));
+            return;
+        }
+    }
+
+    addLine(lineText, (Uint32)strlen(lineText), 0, color, category, priority, playerEntered);
+}
+
+bool ConsoleLog::passes(const Line& line) const {
+    if (!(filter.categories & (1u << line.category))) return false;
+    if (line.priority < filter.minPriority) return false;
+    if (filter.search[0] != '\0' && !strstr(rawText(line), filter.search)) return false;
+    return true;
+}
+
+void ConsoleLog::setFilter(const Filter& newFilter) {
+    filter = newFilter;
+    filter.search[MaxSearchLength] = '\0';
+    viewFirst = 0;
+    viewEnd = 0;
+    for (int i = 0; i < size(); i++) {
+        const Line& kept = line(i);
+        if (passes(kept)) {
+            view[viewEnd % lineCapacity] = kept.seq;
+            viewEnd++;
+        }
+    }
+    scroll = 0;
+}
+
+int ConsoleLog::count(Uint32 categories, int minPriority) const {
+    int total = 0;
+    for (int c = 0; c < MaxCategories; c++) {
+        if (!(categories & (1u << c))) continue;
+        for (int p = MAX(minPriority, 0); p < LogPriorities::NumPriorities; p++) {
+            total += counts[c][p];
+        }
+    }
+    return total;
+}
+
+void ConsoleLog::scrollBy(int lines) {
+    int maxScroll = MAX(viewSize() - 1, 0);
+    int newScroll = scroll + lines;
+    scroll = MIN(MAX(newScroll, 0), maxScroll);
+}
+
+int ConsoleLog::visibleLines(float viewHeight, float spacing, float estimatedHeight) const {
+    int available = viewSize() - scroll;
+    int visible = 0;
+    float used = 0.0f;
+    while (visible < available) {
+        const Line& shown = viewLine(available - 1 - visible);
+        float height = shown.height > 0.0f ? shown.height : estimatedHeight;
+        if (visible > 0 && used + height > viewHeight) break;
+        used += height + spacing;
+        visible++;
+    }
+    return visible;
+}
+
+std::string ConsoleLog::copyLines(int first, int count) const {
+    // clamped one at a time, so a huge count can't overflow the end
+    first = MIN(MAX(first, 0), viewSize());
+    count = MIN(MAX(count, 0), viewSize() - first);
+    int end = first + count;
+    std::string result;
+    for (int i = first; i < end; i++) {
+        const Line& copied = viewLine(i);
+        result.append(lineText(copied), copied.textLength);
+        if (i + 1 < end) result.push_back('\n');
+    }
+    return result;
+}
+
+void ConsoleLog::clear() {
+    firstSeq = endSeq;
+    viewFirst = viewEnd;
+    textHead = 0;
+    scroll = 0;
+    memset(counts, 0, sizeof(counts));
+}
+
+void ConsoleLog::destroy() {
+    Free(lines);
+    Free(text);
+    Free(view);
+    lines = nullptr;
+    text = nullptr;
+    view = nullptr;
+    lineCapacity = 0;
+    textCapacity = 0;
+}
+
+}
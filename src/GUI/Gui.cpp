@@ -1,6 +1,7 @@
 #include "GUI/Gui.hpp"
 #include "rendering/gui.hpp"
 #include "rendering/drawing.hpp"
+#include "My/ScratchAllocator.hpp"
 
 /*
 
@@ -22,7 +23,6 @@ namespace GUI {
 
 void Gui::drawConsole(GuiRenderer& renderer) {
     Element consoleElement = manager.getNamedElement("console");
-    auto* consoleView = manager.getComponent<EC::ViewBox>(consoleElement);
 
     float scale = renderer.options.scale;
     bool showLog = console.promptOpen || Metadata->seconds() - console.timeLastMessageSent < CONSOLE_LOG_NEW_MESSAGE_OPEN_DURATION;
@@ -34,7 +34,7 @@ void Gui::drawConsole(GuiRenderer& renderer) {
     }
     
     Element consoleLogElement = manager.getNamedElement("console-log");
-    auto* logViewEc = manager.getComponent<EC::ViewBox>(consoleLogElement);
+    auto* logViewEc = manager.getComponent<const EC::ViewBox>(consoleLogElement);
     if (showLog && logViewEc) {
         manager.unhideElement(consoleElement);
         
@@ -48,17 +48,19 @@ void Gui::drawConsole(GuiRenderer& renderer) {
             .scale = Vec2(0.5f)
         };
         float messageSpacing = logRenderingSettings.font->height() * 0.25f;
+        float lineHeight = logRenderingSettings.font->height() * logRenderingSettings.scale.y;
         Vec2 pos = logViewEc->absolute.min;
-        for (int i = console.log.size()-1; i >= 0; i--) {
-            const Console::LogMessage& message = console.log[i];
-            logRenderingSettings.color = message.color;
-            std::string text;
-            if (message.copyNumber > 0) {
-                text = string_format("(%d) %s", message.copyNumber, message.text.c_str());
-            } else {
-                text = message.text;
-            }
-            auto result = renderer.renderText(text.c_str(), pos, logFormatting, logRenderingSettings, logViewEc->level);
+
+        // only the lines that fit in the log get laid out, however long the log is
+        ConsoleLog& log = console.log;
+        int visible = log.visibleLines(logViewEc->absolute.size.y, messageSpacing, lineHeight);
+        int newest = log.viewSize() - 1 - log.scroll;
+        for (int i = 0; i < visible; i++) {
+            ConsoleLog::Line& line = log.viewLine(newest - i);
+            logRenderingSettings.color = line.color;
+            // same text and settings every frame, so the layout comes straight out of the text layout cache
+            auto result = renderer.renderText(log.lineText(line), pos, logFormatting, logRenderingSettings, logViewEc->level);
+            line.height = result.rect.h;
             pos.y += result.rect.h + messageSpacing;
         }
     } else {
@@ -68,7 +70,7 @@ void Gui::drawConsole(GuiRenderer& renderer) {
     SDL_Color terminalTextColor = {255,255,255,255};
 
     Element consoleTerminal = manager.getNamedElement("console-terminal");
-    EC::ViewBox* terminalViewEc = manager.getComponent<EC::ViewBox>(consoleTerminal);
+    const EC::ViewBox* terminalViewEc = manager.getComponent<const EC::ViewBox>(consoleTerminal);
     const std::string& activeMessage = console.activeMessage;
 
     TextFormattingSettings terminalTextFormatting{
@@ -88,27 +90,39 @@ void Gui::drawConsole(GuiRenderer& renderer) {
     if (showTerminal) {
         manager.unhideElement(consoleTerminal);
 
-        Vec2* characterPositions = Alloc<Vec2>(activeMessage.size());
+        Vec2* characterPositions = My::FrameAlloc<Vec2>(activeMessage.size());
         auto textRect = renderer.renderText(activeMessage.c_str(), terminalViewEc->absolute.min, terminalTextFormatting, terminalTextRenderSettings, terminalViewEc->level, characterPositions).rect;
-        terminalViewEc->box = *rectAsBox(&textRect);
-        if (terminalViewEc->box.size.y < terminalFont->height() * terminalFontScale) {
-            terminalViewEc->box.size.y = terminalFont->height() * terminalFontScale;
+        Box textBox = *rectAsBox(&textRect);
+        if (textBox.size.y < terminalFont->height() * terminalFontScale) {
+            textBox.size.y = terminalFont->height() * terminalFontScale;
+        }
+        // only written when it changes, so the console isn't laid out again every frame
+        if (textBox.min != terminalViewEc->box.min || textBox.size != terminalViewEc->box.size) {
+            manager.getComponent<EC::ViewBox>(consoleTerminal)->box = textBox;
         }
 
         Vec2 selectedCharPos = terminalViewEc->absolute.min;
         int selectedCharIndex = console.selectedCharIndex;
+
+        // last character could take up multiple bytes
+        Codepoint lastChar = 0;
+        if (!activeMessage.empty()) {
+            int lastCharStart = activeMessage.size() - 1;
+            while (lastCharStart > 0 && isUTF8Continuation(activeMessage[lastCharStart])) lastCharStart--;
+            decodeUTF8(&activeMessage[lastCharStart], activeMessage.size() - lastCharStart, &lastChar);
+        }
         
         // in the middle case
         if (selectedCharIndex >= 0 && selectedCharIndex < activeMessage.size()) {
             selectedCharPos = characterPositions[selectedCharIndex];
             if (selectedCharIndex > 0) {
                 selectedCharPos = characterPositions[selectedCharIndex-1];
-                selectedCharPos.x += terminalFont->advance(activeMessage.back()) * terminalFontScale;
+                selectedCharPos.x += terminalFont->advance(lastChar) * terminalFontScale;
             }
         // end case
         } else if (activeMessage.size() > 0 && selectedCharIndex == activeMessage.size()) {
             selectedCharPos = characterPositions[activeMessage.size()-1];
-            selectedCharPos.x += terminalFont->advance(activeMessage.back()) * terminalFontScale;
+            selectedCharPos.x += terminalFont->advance(lastChar) * terminalFontScale;
         }
         // for case where message is empty
         if (activeMessage.size() > 0) {
@@ -160,63 +174,6 @@ void Gui::drawHeldItemStack(GuiRenderer& renderer, const ItemManager& itemManage
     }
 }
 
-void buildFromTree(GuiTreeNode* node, GUI::GuiManager& gui, int level) {
-    Element parent = node->e;
-    if (parent.Null()) return;
-    auto* parentViewEc = gui.getComponent<EC::ViewBox>(parent);
-    if (!parentViewEc) return;
-    
-    Box parentBox = parentViewEc->absolute;
-    auto* fitConstraint = gui.getComponent<EC::StackConstraint>(parent);
-    Box fitBox = parentBox;
-    
-    for (int i = 0; i < node->childCount; i++) {
-        GuiTreeNode* childNode = gui.getTreeNode(node->children[i]);
-        Element e = childNode->e;
-        auto* viewEc = gui.getComponent<EC::ViewBox>(e);
-        if (viewEc && !gui.entityHas<EC::Hidden>(e)) {
-            Box childBox = viewEc->box;
-            
-            // size
-            auto* sizeConstraint = gui.getComponent<EC::SizeConstraint>(e);
-            if (sizeConstraint) {
-                if (sizeConstraint->relativeSize.x != INFINITY) {
-                    childBox.size.x = MIN(sizeConstraint->relativeSize.x * parentBox.size.x, fitBox.size.x);
-                }
-                if (sizeConstraint->relativeSize.y != INFINITY) {
-                    childBox.size.y = MIN(sizeConstraint->relativeSize.y * parentBox.size.y, fitBox.size.y);
-                }
-                childBox.size.x = MIN(childBox.size.x, sizeConstraint->maxSize.x);
-                childBox.size.y = MIN(childBox.size.y, sizeConstraint->maxSize.y);
-
-                childBox.size.x = MAX(childBox.size.x, sizeConstraint->minSize.x);
-                childBox.size.y = MAX(childBox.size.y, sizeConstraint->minSize.y);
-            }
-            childBox.size.x = MIN(childBox.size.x, parentBox.size.x);
-            childBox.size.y = MIN(childBox.size.y, parentBox.size.y);
-            if (fitConstraint)
-                fitBox.size -= childBox.size * Vec2(fitConstraint->horizontal, fitConstraint->vertical);
-
-            auto* alignmentConstraint = gui.getComponent<EC::AlignmentConstraint>(e);
-            Vec2 offset = {0, 0};
-            if (alignmentConstraint && !fitConstraint) {
-                Vec2 margin = parentBox.size - childBox.size;
-                offset.x = (int)alignmentConstraint->alignment.horizontal * 0.5f * margin.x;
-                offset.y = (2 - (int)alignmentConstraint->alignment.vertical) * 0.5f * margin.y;
-                childBox.min = offset;
-            }
-            childBox.min += fitBox.min;
-            if (fitConstraint)
-                fitBox.min += childBox.size * Vec2(fitConstraint->horizontal, fitConstraint->vertical);
-            
-            viewEc->level = level;
-            viewEc->absolute = childBox;
-        }
-
-        buildFromTree(childNode, gui, ++level);
-    }
-}
-
 void Gui::renderElements(GuiRenderer& renderer, const PlayerControls& playerControls) {
     Vec2 mousePos = playerControls.mousePixelPos();
     bool mouseLeftDown = playerControls.mouse.leftButtonDown();
@@ -235,23 +192,9 @@ void Gui::renderElements(GuiRenderer& renderer, const PlayerControls& playerCont
     });
     */
 
+    // only the parts of the tree that changed get laid out again
     auto screenBox = Box{Vec2(0), renderer.options.size};
-    gui.setComponent(gui.screen, EC::ViewBox{screenBox, screenBox});
-
-    int level = 1;
-    buildFromTree(gui.getTreeNode(gui.screen.id), gui, level);
-
-    /*
-    gui.forEachElement<EC::ViewBox, EC::SizeConstraint>([&](Element e){
-        auto* viewbox = gui.getComponent<EC::ViewBox>(e);
-        auto* sizeConstraint = gui.getComponent<EC::SizeConstraint>(e);
-        Element parent = gui.getComponent<EC::ChildOf>(e)->parent;
-        auto* parentBox = gui.getComponent<EC::ViewBox>(parent);
-
-        viewbox->box.size = sizeConstraint->relativeSize * parentBox->box.size;
-    });
-    */
-
+    layout.relayout(gui, screenBox);
 
     int hoveredLevel = -1;
     Element hoveredElement = NullElement;
@@ -259,7 +202,7 @@ void Gui::renderElements(GuiRenderer& renderer, const PlayerControls& playerCont
     gui.forEachEntity([&](auto signature){ 
         return signature[EC::ViewBox::ID] && !signature[EC::Hidden::ID];
     }, [&](Element e){
-        auto* viewbox = gui.getComponent<EC::ViewBox>(e);
+        auto* viewbox = gui.getComponent<const EC::ViewBox>(e);
         if (viewbox->visible) {
             bool mouseOnButton = pointInRect(mousePos, viewbox->absolute.rect());
             if (mouseOnButton) {
@@ -271,25 +214,23 @@ void Gui::renderElements(GuiRenderer& renderer, const PlayerControls& playerCont
         }
     });
 
-    if (hoveredLevel >= 0) {
-        gui.hoveredElement = hoveredElement;
-    } else {
-        gui.hoveredElement = NullElement;
-    }
+    layout.setHovered(gui, hoveredLevel >= 0 ? hoveredElement : NullElement);
 
     executeSystems(gui.systemManager);
 
     /* Elements are rendered based on their level
-     * Parts of elements are rendered according to the order the forEach calls are made here
+     * Backgrounds, then borders, then textures, then text
      */
+    layout.repaintQueued(gui, &renderer.guiAtlas);
+    layout.buffer(renderer);
 
     // text
     gui.forEachEntity<EC::ViewBox, EC::Text>([&](Element e){
         if (gui.entityHas<EC::Hidden>(e)) return;
 
-        auto* view = gui.getComponent<EC::ViewBox>(e);
+        auto* view = gui.getComponent<const EC::ViewBox>(e);
         Box entityBox = view->absolute;
-        auto* textComponent = gui.getComponent<EC::Text>(e);
+        auto* textComponent = gui.getComponent<const EC::Text>(e);
         Vec2 pos;
         switch (textComponent->formatSettings.align.vertical) {
         case VertAlignment::Bottom:
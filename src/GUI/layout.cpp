@@ -0,0 +1,364 @@
+#include "GUI/layout.hpp"
+#include "GUI/Gui.hpp"
+#include "rendering/gui.hpp"
+
+#include <string.h>
+
+namespace GUI {
+
+namespace {
+
+bool sameBox(const Box& lhs, const Box& rhs) {
+    return lhs.min == rhs.min && lhs.size == rhs.size;
+}
+
+QuadRenderer::Quad colorRect(Vec2 min, Vec2 max, SDL_Color color) {
+    return QuadRenderer::Quad{{
+        {glm::vec3{min.x, min.y, 0}, color, QuadRenderer::NullCoord},
+        {glm::vec3{min.x, max.y, 0}, color, QuadRenderer::NullCoord},
+        {glm::vec3{max.x, max.y, 0}, color, QuadRenderer::NullCoord},
+        {glm::vec3{max.x, min.y, 0}, color, QuadRenderer::NullCoord}
+    }};
+}
+
+/* Lay out the children of the node if anything they depend on changed, then go down to whatever further down needs it.
+ * Child i is on level + i, and its own children start on the level after that.
+ * Boxes are only written when they actually change, and those elements get repainted
+ */
+void layoutChildren(GuiLayout& layout, GuiManager& gui, GuiTreeNode* node, int level) {
+    bool relayout = node->childrenDirty;
+    bool descendants = node->descendantsDirty;
+    node->childrenDirty = false;
+    node->descendantsDirty = false;
+
+    Element parent = node->e;
+    if (parent.Null()) return;
+    auto* parentViewEc = gui.getComponent<const EC::ViewBox>(parent);
+    if (!parentViewEc) return;
+
+    Box parentBox = parentViewEc->absolute;
+    if (!sameBox(parentBox, node->childrenBox) || level != node->childrenLevel) {
+        relayout = true;
+        node->childrenBox = parentBox;
+        node->childrenLevel = level;
+    }
+    if (!relayout && !descendants) return;
+
+    auto* fitConstraint = gui.getComponent<const EC::StackConstraint>(parent);
+    Box fitBox = parentBox;
+
+    for (int i = 0; i < node->childCount; i++) {
+        GuiTreeNode* childNode = gui.getTreeNode(node->children[i]);
+        Element e = childNode->e;
+        auto* viewEc = relayout ? gui.getComponent<const EC::ViewBox>(e) : nullptr;
+        if (viewEc && !gui.entityHas<EC::Hidden>(e)) {
+            Box childBox = viewEc->box;
+
+            // size
+            auto* sizeConstraint = gui.getComponent<const EC::SizeConstraint>(e);
+            if (sizeConstraint) {
+                if (sizeConstraint->relativeSize.x != INFINITY) {
+                    childBox.size.x = MIN(sizeConstraint->relativeSize.x * parentBox.size.x, fitBox.size.x);
+                }
+                if (sizeConstraint->relativeSize.y != INFINITY) {
+                    childBox.size.y = MIN(sizeConstraint->relativeSize.y * parentBox.size.y, fitBox.size.y);
+                }
+                childBox.size.x = MIN(childBox.size.x, sizeConstraint->maxSize.x);
+                childBox.size.y = MIN(childBox.size.y, sizeConstraint->maxSize.y);
+
+                childBox.size.x = MAX(childBox.size.x, sizeConstraint->minSize.x);
+                childBox.size.y = MAX(childBox.size.y, sizeConstraint->minSize.y);
+            }
+            childBox.size.x = MIN(childBox.size.x, parentBox.size.x);
+            childBox.size.y = MIN(childBox.size.y, parentBox.size.y);
+            if (fitConstraint)
+                fitBox.size -= childBox.size * Vec2(fitConstraint->horizontal, fitConstraint->vertical);
+
+            auto* alignmentConstraint = gui.getComponent<const EC::AlignmentConstraint>(e);
+            Vec2 offset = {0, 0};
+            if (alignmentConstraint && !fitConstraint) {
+                Vec2 margin = parentBox.size - childBox.size;
+                offset.x = (int)alignmentConstraint->alignment.horizontal * 0.5f * margin.x;
+                offset.y = (2 - (int)alignmentConstraint->alignment.vertical) * 0.5f * margin.y;
+                childBox.min = offset;
+            }
+            childBox.min += fitBox.min;
+            if (fitConstraint)
+                fitBox.min += childBox.size * Vec2(fitConstraint->horizontal, fitConstraint->vertical);
+
+            layout.elementsLaidOut++;
+            if (viewEc->level != level + i || !sameBox(viewEc->absolute, childBox)) {
+                auto* view = gui.getComponent<EC::ViewBox>(e);
+                view->level = level + i;
+                view->absolute = childBox;
+                layout.repaint(e);
+            }
+        }
+
+        if (relayout || childNode->childrenDirty || childNode->descendantsDirty) {
+            layoutChildren(layout, gui, childNode, level + i + 1);
+        }
+    }
+}
+
+}
+
+GuiLayout GuiLayout::init() {
+    GuiLayout self;
+    self.elements = My::Vec<ElementQuads>::Empty();
+    self.levels = My::Vec<Level>::Empty();
+    self.repaintQueue = My::Vec<Element>::Empty();
+    // everything made before the first update counts as changed
+    self.version = 0;
+    self.elementsLaidOut = 0;
+    self.elementsRepainted = 0;
+    return self;
+}
+
+void GuiLayout::repaint(Element element) {
+    if (element.Null()) return;
+    if ((int)element.id >= elements.size) {
+        int oldSize = elements.size;
+        int doubled = oldSize * 2;
+        int needed = (int)element.id + 1;
+        elements.reserve(MAX(doubled, needed));
+        elements.resize(needed);
+        for (int i = oldSize; i < needed; i++) {
+            elements[i] = ElementQuads{{{-1, 0, 0}, {-1, 0, 0}, {-1, 0, 0}}, false};
+        }
+    }
+    ElementQuads& quads = elements[element.id];
+    if (!quads.queued) {
+        quads.queued = true;
+        repaintQueue.push(element);
+    }
+}
+
+void GuiLayout::setHovered(GuiManager& gui, Element element) {
+    if (element == gui.hoveredElement) return;
+    repaint(gui.hoveredElement);
+    repaint(element);
+    gui.hoveredElement = element;
+}
+
+void GuiLayout::relayout(GuiManager& gui, Box screen) {
+    elementsLaidOut = 0;
+
+    auto* screenView = gui.getComponent<const EC::ViewBox>(gui.screen);
+    if (screenView && (!sameBox(screenView->box, screen) || !sameBox(screenView->absolute, screen))) {
+        gui.setComponent(gui.screen, EC::ViewBox{screen, screen});
+    }
+
+    // find out what changed since last time
+    auto anyElement = [](auto signature){ return true; };
+    gui.forEachChangedEntity(anyElement, EC::ViewBox::ID, version, [&](Element e){
+        // moved, resized, hidden or shown
+        gui.relayout(e.id);
+        gui.relayoutChildren(e.id);
+        repaint(e);
+    });
+    for (ComponentID constraint : {EC::SizeConstraint::ID, EC::AlignmentConstraint::ID}) {
+        gui.forEachChangedEntity(anyElement, constraint, version, [&](Element e){
+            gui.relayout(e.id);
+        });
+    }
+    gui.forEachChangedEntity(anyElement, EC::StackConstraint::ID, version, [&](Element e){
+        gui.relayoutChildren(e.id);
+    });
+    for (ComponentID look : {EC::Background::ID, EC::Border::ID, EC::SimpleTexture::ID, EC::Hover::ID}) {
+        gui.forEachChangedEntity(anyElement, look, version, [&](Element e){
+            repaint(e);
+        });
+    }
+
+    GuiTreeNode* screenNode = gui.getTreeNode(gui.screen.id);
+    if (screenNode) {
+        layoutChildren(*this, gui, screenNode, 1);
+    }
+
+    // the boxes written laying out aren't changes to look for next time
+    version = gui.components.advanceChangeVersion();
+}
+
+void GuiLayout::paint(const GuiManager& gui, Element element, const TextureAtlas* atlas) {
+    elementsRepainted++;
+
+    auto* view = gui.entityExists(element) ? gui.getComponent<const EC::ViewBox>(element) : nullptr;
+    if (!view || gui.entityHas<EC::Hidden>(element)) {
+        for (int layer = 0; layer < QuadLayers::Count; layer++) {
+            freeQuads(element.id, (QuadLayer)layer);
+        }
+        return;
+    }
+
+    int level = view->level;
+    Vec2 min = view->absolute.min;
+    Vec2 max = view->absolute.max();
+    Quad quads[4];
+
+    // background, in the hover color while the mouse is over it
+    int count = 0;
+    if (auto* background = gui.getComponent<const EC::Background>(element)) {
+        SDL_Color color = background->color;
+        if (element == gui.hoveredElement) {
+            auto* hover = gui.getComponent<const EC::Hover>(element);
+            if (hover && hover->changeColor) {
+                color = hover->newColor;
+            }
+        }
+        quads[0] = colorRect(min, max, color);
+        count = 1;
+    }
+    setQuads(element.id, QuadLayers::Backgrounds, level, quads, count);
+
+    count = 0;
+    if (auto* border = gui.getComponent<const EC::Border>(element)) {
+        SDL_Color color = border->color;
+        Vec2 strokeIn = border->strokeIn;
+        Vec2 strokeOut = border->strokeOut;
+
+        quads[0] = colorRect({min.x - strokeOut.x, min.y - strokeOut.y}, {max.x -  strokeIn.x, min.y +  strokeIn.y}, color);
+        quads[1] = colorRect({max.x -  strokeIn.x, min.y - strokeOut.y}, {max.x + strokeOut.x, max.y -  strokeIn.y}, color);
+        quads[2] = colorRect({max.x + strokeOut.x, max.y -  strokeIn.y}, {min.x +  strokeIn.x, max.y + strokeOut.y}, color);
+        quads[3] = colorRect({min.x - strokeOut.x, max.y + strokeOut.y}, {min.x +  strokeIn.x, min.y +  strokeIn.y}, color);
+        count = 4;
+    }
+    setQuads(element.id, QuadLayers::Borders, level, quads, count);
+
+    count = 0;
+    auto* texture = gui.getComponent<const EC::SimpleTexture>(element);
+    if (texture && atlas) {
+        TextureAtlas::Space space = getTextureAtlasSpace(atlas, texture->texture);
+        Vec2 texMin = space.min;
+        Vec2 texMax = space.max;
+
+        Vec2 texBoxMin = min + texture->texBox.min;
+        Vec2 texBoxMax = min + texture->texBox.max();
+
+        SDL_Color color = {0,0,0,0};
+
+        quads[0][0] = {glm::vec3{texBoxMin.x, texBoxMin.y, 0}, color, {texMin.x, texMin.y}};
+        quads[0][1] = {glm::vec3{texBoxMin.x, texBoxMax.y, 0}, color, {texMin.x, texMax.y}};
+        quads[0][2] = {glm::vec3{texBoxMax.x, texBoxMax.y, 0}, color, {texMax.x, texMax.y}};
+        quads[0][3] = {glm::vec3{texBoxMax.x, texBoxMin.y, 0}, color, {texMax.x, texMin.y}};
+        count = 1;
+    }
+    setQuads(element.id, QuadLayers::Textures, level, quads, count);
+}
+
+void GuiLayout::repaintQueued(const GuiManager& gui, const TextureAtlas* atlas) {
+    elementsRepainted = 0;
+
+    for (int i = 0; i < repaintQueue.size; i++) {
+        Element element = repaintQueue[i];
+        elements[element.id].queued = false;
+        paint(gui, element, atlas);
+    }
+    repaintQueue.size = 0;
+
+    // elements that moved to other levels leave their old quads behind, so clear those out once there's a lot of them
+    for (int level = 0; level < levels.size; level++) {
+        for (int layer = 0; layer < QuadLayers::Count; layer++) {
+            LayerQuads& buffer = levels[level].layers[layer];
+            if (buffer.unused > 64 && buffer.unused * 2 > buffer.quads.size) {
+                compact(buffer, (QuadLayer)layer);
+            }
+        }
+    }
+}
+
+void GuiLayout::update(GuiManager& gui, Box screen, const TextureAtlas* atlas) {
+    relayout(gui, screen);
+    repaintQueued(gui, atlas);
+}
+
+void GuiLayout::setQuads(ElementID element, QuadLayer layer, int level, const Quad* quads, int count) {
+    QuadRange& range = elements[element].ranges[layer];
+    if (count > 0 && range.level == level && range.count == count) {
+        // same place, so just overwrite them
+        memcpy(&levels[level].layers[layer].quads[range.start], quads, count * sizeof(Quad));
+        return;
+    }
+
+    freeQuads(element, layer);
+    if (count == 0 || level < 0) return;
+
+    while (levels.size <= level) {
+        Level newLevel;
+        for (auto& buffer : newLevel.layers) {
+            buffer = LayerQuads{My::Vec<Quad>::Empty(), My::Vec<ElementID>::Empty(), 0};
+        }
+        levels.push(newLevel);
+    }
+    LayerQuads& buffer = levels[level].layers[layer];
+    range = QuadRange{level, buffer.quads.size, count};
+    buffer.quads.push(quads, count);
+    for (int i = 0; i < count; i++) {
+        buffer.owners.push(element);
+    }
+}
+
+void GuiLayout::freeQuads(ElementID element, QuadLayer layer) {
+    if ((int)element >= elements.size) return;
+    QuadRange& range = elements[element].ranges[layer];
+    if (range.level >= 0) {
+        LayerQuads& buffer = levels[range.level].layers[layer];
+        // zero sized quads draw nothing, so the rest of the quads can stay where they are
+        memset(&buffer.quads[range.start], 0, range.count * sizeof(Quad));
+        for (int i = range.start; i < range.start + range.count; i++) {
+            buffer.owners[i] = NullElement.id;
+        }
+        buffer.unused += range.count;
+    }
+    range = QuadRange{-1, 0, 0};
+}
+
+void GuiLayout::compact(LayerQuads& buffer, QuadLayer layer) {
+    int kept = 0;
+    for (int i = 0; i < buffer.quads.size; i++) {
+        ElementID owner = buffer.owners[i];
+        if (owner == NullElement.id) continue;
+        QuadRange& range = elements[owner].ranges[layer];
+        if (range.start == i) {
+            range.start = kept;
+        }
+        buffer.quads[kept] = buffer.quads[i];
+        buffer.owners[kept] = owner;
+        kept++;
+    }
+    buffer.quads.size = kept;
+    buffer.owners.size = kept;
+    buffer.unused = 0;
+}
+
+void GuiLayout::buffer(GuiRenderer& renderer) const {
+    int levelCount = MIN(levels.size, renderer.levels.size);
+    for (int level = 0; level < levelCount; level++) {
+        for (int layer = 0; layer < QuadLayers::Count; layer++) {
+            const My::Vec<Quad>& quads = levels[level].layers[layer].quads;
+            if (quads.size > 0) {
+                renderer.levels[level].quads.push(quads.data, quads.size);
+            }
+        }
+    }
+}
+
+ArrayRef<GuiLayout::Quad> GuiLayout::quads(int level, QuadLayer layer) const {
+    if (level < 0 || level >= levels.size) return ArrayRef<Quad>();
+    const My::Vec<Quad>& quads = levels[level].layers[layer].quads;
+    return ArrayRef<Quad>(quads.data, (size_t)quads.size);
+}
+
+void GuiLayout::destroy() {
+    for (int level = 0; level < levels.size; level++) {
+        for (auto& buffer : levels[level].layers) {
+            buffer.quads.destroy();
+            buffer.owners.destroy();
+        }
+    }
+    levels.destroy();
+    elements.destroy();
+    repaintQueue.destroy();
+}
+
+}
@@ -4,6 +4,8 @@
 
 #include "utils/Log.hpp"
 #include "utils/Debug.hpp"
+#include "utils/FileSystem.hpp"
+#include "My/ScratchAllocator.hpp"
 #include "utils/random.hpp"
 #include "GUI/Gui.hpp"
 #include "PlayerControls.hpp"
@@ -33,10 +35,10 @@ void setDefaultKeyBindings(Game& ctx, PlayerControls* controls) {
 
     KeyBinding* keyBindings[] = {
         new FunctionKeyBinding('u', [&](){
-            debug.settings["drawEntityViewBoxes"] = !debug.settings["drawEntityViewBoxes"];
+            debug.settings.toggle(DebugFlags::drawEntityViewBoxes);
         }),
         new FunctionKeyBinding('p', [&](){
-            debug.settings["drawEntityCollisionBoxes"] = !debug.settings["drawEntityCollisionBoxes"];
+            debug.settings.toggle(DebugFlags::drawEntityCollisionBoxes);
         })
     };
 
@@ -141,12 +143,15 @@ void runSystem(EntityWorld* ecs) {
 void updateDynamicEntityChunkPositions(EntityWorld& ecs, GameState* state) {
     namespace EC = World::EC;
     
-    ecs.ForEach([](ECS::Signature components){
+    // most dynamic entities are standing still most of the time, so only look at ones that could've moved
+    ECS::ChangeVersion since = state->dynamicPositionsVersion;
+    state->dynamicPositionsVersion = ecs.AdvanceChangeVersion();
+    ecs.ForEachChanged<EC::Dynamic>([](ECS::Signature components){
         return components.hasAll(ECS::getSignature<EC::Position, EC::Dynamic, EC::ViewBox>());
-    }, [&](auto entity){
+    }, since, [&](auto entity){
         //auto* viewbox  = ecs.Get<EC::ViewBox>(entity);
         auto* positionEc = ecs.Get<EC::Position>(entity);
-        auto* dynamicEc = ecs.Get<EC::Dynamic>(entity);
+        auto* dynamicEc = ecs.Get<const EC::Dynamic>(entity);
 
         Vec2 oldPos = positionEc->vec2();
         Vec2 newPos = dynamicEc->pos;
@@ -161,12 +166,49 @@ void updateDynamicEntityChunkPositions(EntityWorld& ecs, GameState* state) {
     });
 }
 
+/* Push entities with collision boxes out of each other and out of walls.
+ * Systems move entities by setting their position directly, so however far a body's entity moved since last tick is taken as its velocity.
+ */
+static void updatePhysics(GameState* state) {
+    EntityWorld& ecs = state->ecs;
+    auto& physics = state->physics;
+
+    namespace EC = World::EC;
+
+    auto query = [](ECS::Signature components){
+        return components[EC::Dynamic::ID] && components[EC::CollisionBox::ID];
+    };
+    ecs.ForEach(query, [&](Entity entity){
+        Physics::Body* body = physics.bodyOf(entity);
+        if (!body) return;
+        Box collision = ecs.Get<const EC::CollisionBox>(entity)->box;
+        Vec2 center = ecs.Get<const EC::Dynamic>(entity)->pos + collision.center();
+        body->velocity = center - body->position;
+        body->halfSize = collision.size / 2.0f;
+    });
+
+    physics.step();
+
+    ecs.ForEach(query, [&](Entity entity){
+        Physics::Body* body = physics.bodyOf(entity);
+        if (!body) return;
+        Box collision = ecs.Get<const EC::CollisionBox>(entity)->box;
+        Vec2 pos = body->position - collision.center();
+        Vec2 oldPos = ecs.Get<const EC::Dynamic>(entity)->pos;
+        // leave entities that didn't move unchanged
+        if (pos.x != oldPos.x || pos.y != oldPos.y) {
+            ecs.Get<EC::Dynamic>(entity)->pos = pos;
+        }
+    });
+}
+
 static void updateSystems(GameState* state) {
     EntityWorld& ecs = state->ecs;
     auto& chunkmap = state->chunkmap;
 
     namespace EC = World::EC;
 
+    state->pathfinding.update();
     ecs.ForEach([](ECS::Signature components){
         return components[EC::Follow::ID] && components[EC::CollisionBox::ID] && components[EC::Dynamic::ID] && components[EC::Position::ID]; 
     }, [&](Entity entity){
@@ -184,19 +226,23 @@ static void updateSystems(GameState* state) {
         Box collision = ecs.Get<EC::CollisionBox>(entity)->box;
         Vec2 center = position->pos + collision.center();;
         Vec2 delta = {target.x - center.x, target.y - center.y};
+        // collision keeps followers from getting on top of what they're following, so they only have to get up against it
+        Vec2 reach = (collision.size + followingCollision.size) / 2.0f + Vec2(followComponent->speed);
 
-        if (delta.x*delta.x + delta.y*delta.y < followComponent->speed * followComponent->speed) {
-            //Vec2 oldPos = position->vec2();
-            position->pos += delta;
-            //entityPositionChanged(&state->chunkmap, &ecs, entity, oldPos);
-
+        if (fabsf(delta.x) < reach.x && fabsf(delta.y) < reach.y) {
             // do something
             // hurt them if they have health
-            if (ecs.EntityHas<EC::Health>(following)) {
-                ecs.Get<EC::Health>(following)->damage(10);
-            }
+            World::damageEntity(ecs, following, 10);
 
         } else {
+            // go around walls instead of straight at the target, when there's a way around.
+            // Heading for the middle of the next tile keeps from clipping the corners of walls
+            IVec2 tile = vecFloori(center);
+            IVec2 nextTile;
+            if (state->pathfinding.nextTile(following, vecFloori(target), tile, &nextTile) && nextTile != tile) {
+                delta = Vec2(nextTile.x + 0.5f, nextTile.y + 0.5f) - center;
+            }
+
             Vec2 unit;
             // normalized vector with x = 0.0 is NaN
             if (delta.x == 0.0f) {
@@ -218,25 +264,8 @@ static void updateSystems(GameState* state) {
         }
     });
 
-    // TODO: ForEach while destroying could cause issues maybe? tried using command buffer but ran into issues with const and stuff.
-    // return command buffer instead of executing automatically if necessary
-    ecs.ForEach([](ECS::Signature components){
-       return components[EC::Health::ID]; 
-    }, [&](Entity entity){
-        auto* health = ecs.Get<EC::Health>(entity); assert(health);
-        // Must do check like this instead of (*health <= 0.0f) to account for NaN values,
-        // which can occur when infinite damage is done to an entity with infinite health
-        // so in that situation the infinite damage wins out, rather than the infinte health
-        if (!(health->health > 0.0f)) {
-            if (!ecs.EntityHas<EC::Immortal>(entity)) {
-                ecs.Destroy(entity);
-            }
-        }
-
-        if (health->iFrames > 0) {
-            health->iFrames--;
-        }
-    });
+    // deaths, fuses, and anything else waiting for this tick
+    ecs.UpdateTimers(Metadata->getTick());
 
     ecs.ForEach([](ECS::Signature components){
         return components[EC::Dynamic::ID] && components[EC::Motion::ID];
@@ -262,33 +291,61 @@ static void updateSystems(GameState* state) {
         //entityPositionChanged(state, entity, oldPos);
     });
 
-    ecs.ForEach([](ECS::Signature components){
-        return components.hasComponents<EC::Fresh, EC::Position>();
-    }, [&](Entity entity){
-        auto fresh = ecs.Get<EC::Fresh>(entity); assert(fresh);
-        if (fresh->components.getComponent<EC::Position>()) {
-            // ec::position just added
-            fresh->components.setComponent<EC::Position>(0);
-        }
-    });
+    auto& transportLines = state->transportLines;
+    transportLines.update();
+    for (const auto& spilled : transportLines.spilled) {
+        World::Entities::ItemStack(&ecs, spilled.position, ItemStack(spilled.item, 1), state->itemManager);
+    }
+    transportLines.spilled.size = 0;
 
-    ecs.ForEach([](ECS::Signature components){
-        return components.hasComponents<EC::Fresh>();
-    }, [&](Entity entity){
-        ecs.Remove<EC::Fresh>(entity);
-    });
+    auto& inserters = state->inserters;
+    inserters.update();
+    for (const auto& dropped : inserters.dropped) {
+        World::Entities::ItemStack(&ecs, dropped.position, dropped.stack, state->itemManager);
+    }
+    inserters.dropped.size = 0;
 }
 
-int tick(GameState* state, PlayerControls* playerControls) {
+int tick(GameState* state, PlayerControls* playerControls, MetadataTracker* metadata) {
+    ScopedTiming tickTiming(metadata->timing(Timings::Tick));
+
     state->player.grenadeThrowCooldown--;
-    updateSystems(state);
+    {
+        // whatever the player did since last tick
+        ScopedTiming timing(metadata->timing(Timings::Events));
+        MEMORY_TAG(Entities);
+        state->ecs.FlushEvents();
+    }
+    {
+        ScopedTiming timing(metadata->timing(Timings::Systems));
+        MEMORY_TAG(World);
+        updateSystems(state);
+    }
+    {
+        // entities made and destroyed by the systems need to be in their chunks and the physics space before anything moves
+        ScopedTiming timing(metadata->timing(Timings::Events));
+        MEMORY_TAG(Entities);
+        state->ecs.FlushEvents();
+    }
     if (Metadata->getTick() % 1 == 0) {
 
     }
 
-    playerControls->doPlayerMovementTick();
-
-    updateDynamicEntityChunkPositions(state->ecs, state);
+    {
+        ScopedTiming timing(metadata->timing(Timings::PlayerMovement));
+        MEMORY_TAG(World);
+        playerControls->doPlayerMovementTick();
+    }
+    {
+        ScopedTiming timing(metadata->timing(Timings::Physics));
+        MEMORY_TAG(Physics);
+        updatePhysics(state);
+    }
+    {
+        ScopedTiming timing(metadata->timing(Timings::ChunkPositions));
+        MEMORY_TAG(World);
+        updateDynamicEntityChunkPositions(state->ecs, state);
+    }
 
     return 0;
 }
@@ -429,6 +486,9 @@ int Game::update() {
 
     bool quit = false;
 
+    // messages logged since last frame, from any thread
+    gLogger.forwardConsoleMessages();
+
     // get user input state for this update
     SDL_PumpEvents();
     MouseState mouse = getMouseState();
@@ -447,6 +507,10 @@ int Game::update() {
     }
 
     auto frame = metadata.newFrame();
+    My::newScratchFrame();
+#if MEMORY_TRACKING
+    Mem::newFrame();
+#endif
     double deltaTime = metadata.frame.deltaTime;
 
     static double remainingTime = 0.0;
@@ -459,7 +523,27 @@ int Game::update() {
 
         if (ticksThisFrame++ < maxTicks) {
             Tick currentTick = metadata.newTick();
-            tick(state, playerControls);
+            My::newScratchTick();
+#if MEMORY_TRACKING
+            size_t allocationsBefore = Mem::allocationCount();
+#endif
+            if (script.running) {
+                script.update(currentTick, gCommands, gCommandTable, [&](const CommandScript::Step& step, const Command::Result& result){
+                    if (result.type == Command::Result::Error) {
+                        gui->console.newMessage(string_format("Script stopped at line %d: %s", step.line, result.message.c_str()).c_str(), GUI::Console::MessageType::Error);
+                    } else if (!result.message.empty()) {
+                        gui->console.newMessage(result.message.c_str(), GUI::Console::MessageType::CommandResult);
+                    }
+                });
+            }
+            tick(state, playerControls, &metadata);
+#if MEMORY_TRACKING
+            // ticks shouldn't need to allocate once the game is going
+            size_t tickAllocations = Mem::allocationCount() - allocationsBefore;
+            if (tickAllocations > 0 && debug->settings[DebugFlags::warnTickAllocations]) {
+                LogWarn("Tick %lld made %zu allocations", (long long)currentTick, tickAllocations);
+            }
+#endif
         }
     }
 
@@ -472,12 +556,21 @@ int Game::update() {
         scale
     };
 
-    std::vector<GameAction> guiActions = gui->updateGuiState(state, *playerControls);
-    for (auto& action : guiActions) {
-        action.function(this);
+    {
+        ScopedTiming timing(metadata.timing(Timings::Gui));
+        MEMORY_TAG(Gui);
+        std::vector<GameAction> guiActions = gui->updateGuiState(state, *playerControls);
+        for (auto& action : guiActions) {
+            action.function(this);
+        }
+        state->ecs.FlushEvents();
     }
 
-    render(*renderContext, options, gui, state, camera, *playerControls, mode, true); 
+    {
+        ScopedTiming timing(metadata.timing(Timings::Render));
+        MEMORY_TAG(Rendering);
+        render(*renderContext, options, gui, state, camera, *playerControls, mode, true); 
+    }
 
     lastUpdateMouseState = mouse;
     lastUpdatePlayerTargetPos = playerControls->mouseWorldPos;
@@ -498,6 +591,7 @@ int Game::init() {
     
 
     this->debug->console = &this->gui->console;
+    this->debug->settings.load(FileSystem.save.get("debug.txt"));
 
     this->renderContext = new RenderContext(sdlCtx.primary.window, sdlCtx.primary.glContext);
     LogInfo("starting render init");  
@@ -562,6 +656,8 @@ void Game::quit() {
 
     double secondsElapsed = metadata.end();
     LogInfo("Time elapsed: %.1f", secondsElapsed);
+    debug->settings.save(FileSystem.save.get("debug.txt"));
+    metadata.dumpTimings(FileSystem.save.get("timings.bin"));
     // GameSave::save()
 }
 
@@ -571,6 +667,7 @@ void Game::destroy() {
     delete this->debug;
     delete this->playerControls;
     delete this->renderContext;
+    metadata.destroy();
 }
 
 int Game::start() {
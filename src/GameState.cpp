@@ -47,9 +47,44 @@ void GameState::init(const TextureManager* textureManager) {
         }
     }
 
+    pathfinding = World::Pathfinding::init(&chunkmap);
+    chunkmap.onTileChanged = [this](TileCoord tile){
+        pathfinding.tileChanged(tile);
+    };
+
     /* Init ECS */
     //ecs = EntityWorld();
-    World::setEventCallbacks(ecs, chunkmap);
+    dynamicPositionsVersion = 0;
+    transportLines = World::TransportLines::init();
+    inserters = World::Inserters::init(&transportLines);
+    transportLines.onLineChanged = [this](World::TransportLineID line){
+        inserters.beltLineChanged(line);
+    };
+    transportLines.onLineRebuilt = [this](World::TransportLineID line){
+        inserters.beltLineRebuilt(line);
+    };
+    inserters.findContainer = [this](IVec2 tile, Entity* containerOut){
+        Vec2 center = Vec2(tile.x + 0.5f, tile.y + 0.5f);
+        bool found = false;
+        World::forEachEntityNearPoint(ecs, &chunkmap, center, [&](Entity entity){
+            if (ecs.EntityHas<World::EC::Inventory>(entity) && World::pointInEntity(center, entity, ecs)) {
+                *containerOut = entity;
+                found = true;
+            }
+            return found;
+        });
+        return found;
+    };
+    inserters.containerInventory = [this](Entity container) -> Inventory* {
+        // the entity's version doesn't match anymore once it's destroyed, even if the id is used again
+        if (!ecs.EntityHas<World::EC::Inventory>(container)) return nullptr;
+        return &ecs.Get<World::EC::Inventory>(container)->inventory;
+    };
+    physics = Physics::Space::init();
+    physics.solidTile = [this](IVec2 tile){
+        return !pathfinding.walkable(tile);
+    };
+    World::setEventCallbacks(ecs, chunkmap, transportLines, inserters, physics);
 
     /* Init Items */
     {
@@ -58,11 +93,22 @@ void GameState::init(const TextureManager* textureManager) {
         itemManager = ItemManager(ArrayRef(itemComponentInfo), ItemTypes::Count);
     }
 
+    itemManager.onInventoryChanged = [this](const ItemStack* inventoryItems, bool added){
+        inserters.inventoryChanged(inventoryItems, added);
+    };
+    inserters.itemManager = &itemManager;
+
     makeItemPrototypes(itemManager);
     loadTileData(itemManager, textureManager);
 
     /* Init Player */
     player = Player(&ecs, Vec2(0, 0), itemManager);
+    // so the player has a body
+    ecs.FlushEvents();
+    // the player has to be able to walk up to water and walls to build on them
+    if (Physics::Body* body = physics.bodyOf(player.entity)) {
+        body->tileCollision = false;
+    }
 
     ItemStack startInventory[] = {
         ItemStack(items::Prototypes::SandGun::make(itemManager)),
@@ -76,12 +122,19 @@ void GameState::init(const TextureManager* textureManager) {
     Inventory* playerInventory = player.inventory();
     for (int i = 0; i < (int)(sizeof(startInventory) / sizeof(ItemStack)); i++) {
         playerInventory->addItemStack(startInventory[i]);
+        // the inventory has its own reference now
+        itemManager.release(startInventory[i].item);
     }
 }
 
 void GameState::destroy() {
+    pathfinding.destroy();
     chunkmap.destroy();
     ecs.destroy();
+    physics.destroy();
+    inserters.destroy();
+    transportLines.destroy();
+    itemManager.destroy();
 }
 
 llvm::SmallVector<IVec2> raytraceDDA(const Vec2 start, const Vec2 end) {
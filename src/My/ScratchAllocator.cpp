@@ -0,0 +1,201 @@
+#include "My/ScratchAllocator.hpp"
+
+#include <atomic>
+#include <string.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define SCRATCH_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SCRATCH_ASAN 1
+#endif
+#endif
+
+#ifdef SCRATCH_ASAN
+#include <sanitizer/asan_interface.h>
+#define SCRATCH_POISON(ptr, size) ASAN_POISON_MEMORY_REGION(ptr, size)
+#define SCRATCH_UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION(ptr, size)
+#else
+#define SCRATCH_POISON(ptr, size) ((void)(ptr), (void)(size))
+#define SCRATCH_UNPOISON(ptr, size) ((void)(ptr), (void)(size))
+#endif
+
+MY_CLASS_START
+
+static_assert(sizeof(ScratchArena::Block) % ScratchArena::Alignment == 0, "block data has to start aligned");
+static_assert(sizeof(ScratchArena::AllocationHeader) == ScratchArena::Alignment, "header has to keep allocations aligned");
+
+static size_t alignScratch(size_t size) {
+    return (size + ScratchArena::Alignment - 1) & ~(ScratchArena::Alignment - 1);
+}
+
+static char* blockData(ScratchArena::Block* block) {
+    return (char*)(block + 1);
+}
+
+static ScratchArena::Block* newBlock(size_t size, ScratchArena::Block* next) {
+    auto* block = (ScratchArena::Block*)Alloc(sizeof(ScratchArena::Block) + size);
+    block->next = next;
+    block->size = size;
+    SCRATCH_POISON(blockData(block), size);
+    return block;
+}
+
+static void freeBlock(ScratchArena::Block* block) {
+    SCRATCH_UNPOISON(blockData(block), block->size);
+    Free(block);
+}
+
+ScratchArena ScratchArena::init(ScratchLifetime lifetime) {
+    ScratchArena self;
+    self.block = nullptr;
+    self.offset = 0;
+    self.lifetime = lifetime;
+    self.epoch = 0;
+    self.blockAllocations = 0;
+    return self;
+}
+
+void ScratchArena::reset(Uint32 newEpoch) {
+    if (block && block->next) {
+        // the last frame didn't fit in one block, so make one big enough for all of it
+        size_t total = 0;
+        for (Block* b = block; b; ) {
+            Block* next = b->next;
+            total += b->size;
+            freeBlock(b);
+            b = next;
+        }
+        block = newBlock(total, nullptr);
+        blockAllocations++;
+    } else if (block) {
+#ifdef DEBUG
+        SCRATCH_UNPOISON(blockData(block), offset);
+        memset(blockData(block), 0xDD, offset);
+#endif
+        SCRATCH_POISON(blockData(block), offset);
+    }
+    offset = 0;
+    epoch = newEpoch;
+}
+
+void* ScratchArena::allocate(size_t size) {
+    assert(size <= UINT32_MAX && "Scratch allocation too large!");
+    size_t needed = sizeof(AllocationHeader) + alignScratch(size);
+    if (!block || offset + needed > block->size) {
+        size_t grownSize = block ? block->size * 2 : StartBlockSize;
+        size_t blockSize = MAX(needed, grownSize);
+        block = newBlock(blockSize, block);
+        blockAllocations++;
+        offset = 0;
+    }
+    char* memory = blockData(block) + offset;
+    SCRATCH_UNPOISON(memory, needed);
+    auto* header = (AllocationHeader*)memory;
+    header->size = (Uint32)size;
+    header->epoch = epoch;
+    offset += needed;
+    return header + 1;
+}
+
+void* ScratchArena::reallocate(void* ptr, size_t size) {
+    if (!ptr) return allocate(size);
+    assert(!expired(ptr) && "Scratch memory used after its frame or tick ended!");
+    auto* header = (AllocationHeader*)ptr - 1;
+    size_t oldSize = alignScratch(header->size);
+    size_t newSize = alignScratch(size);
+    char* end = (char*)ptr + oldSize;
+    // the last allocation can just move the offset
+    if (end == blockData(block) + offset && offset - oldSize + newSize <= block->size) {
+        if (newSize < oldSize) {
+            SCRATCH_POISON((char*)ptr + newSize, oldSize - newSize);
+        } else {
+            SCRATCH_UNPOISON(end, newSize - oldSize);
+        }
+        offset = offset - oldSize + newSize;
+        header->size = (Uint32)size;
+        return ptr;
+    }
+    void* newPtr = allocate(size);
+    memcpy(newPtr, ptr, MIN((size_t)header->size, size));
+    return newPtr;
+}
+
+void ScratchArena::deallocate(void* ptr) const {
+    (void)ptr;
+#ifdef DEBUG
+    assert((!ptr || !expired(ptr)) && "Scratch memory used after its frame or tick ended!");
+#endif
+}
+
+bool ScratchArena::expired(const void* ptr) const {
+    // the allocators always go through scratchArena(), which resets the arena first if it's out of date.
+    // memory past what's been handed out since the reset is poisoned or freed, so only look at the header when it's in use
+    for (const Block* b = block; b; b = b->next) {
+        const char* start = blockData((Block*)b);
+        size_t used = b == block ? offset : b->size;
+        if ((const char*)ptr > start && (const char*)ptr <= start + used) {
+            auto* header = (const AllocationHeader*)ptr - 1;
+            return header->epoch != epoch;
+        }
+    }
+    return true;
+}
+
+void ScratchArena::destroy() {
+    for (Block* b = block; b; ) {
+        Block* next = b->next;
+        freeBlock(b);
+        b = next;
+    }
+    block = nullptr;
+    offset = 0;
+}
+
+static std::atomic<Uint32> scratchEpochs[ScratchLifetimes::Count] = {{1}, {1}};
+
+namespace {
+
+// arenas for one thread, freed when the thread exits
+struct ThreadScratch {
+    ScratchArena arenas[ScratchLifetimes::Count];
+
+    ThreadScratch() {
+        for (int i = 0; i < ScratchLifetimes::Count; i++) {
+            arenas[i] = ScratchArena::init((ScratchLifetime)i);
+        }
+    }
+
+    ~ThreadScratch() {
+        for (auto& arena : arenas) {
+            arena.destroy();
+        }
+    }
+};
+
+thread_local ThreadScratch threadScratch;
+
+}
+
+void newScratchFrame() {
+    scratchEpochs[ScratchLifetimes::Frame]++;
+}
+
+void newScratchTick() {
+    scratchEpochs[ScratchLifetimes::Tick]++;
+}
+
+Uint32 scratchEpoch(ScratchLifetime lifetime) {
+    return scratchEpochs[lifetime].load(std::memory_order_relaxed);
+}
+
+ScratchArena& scratchArena(ScratchLifetime lifetime) {
+    ScratchArena& arena = threadScratch.arenas[lifetime];
+    Uint32 epoch = scratchEpoch(lifetime);
+    if (arena.epoch != epoch) {
+        arena.reset(epoch);
+    }
+    return arena;
+}
+
+MY_CLASS_END
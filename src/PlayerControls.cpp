@@ -122,6 +122,9 @@ std::vector<GameAction> PlayerControls::handleClick(const SDL_MouseButtonEvent&
         if (clickInWorld) {
             if (game->state->player.isHoldingItem()) {
                 game->state->player.releaseHeldItem();
+            } else {
+                // empty handed, so dig up the tile instead
+                game->state->player.tryMineTile(game->state->chunkmap, vecFloori(mouseWorldPos));
             }
         }
     }
@@ -176,6 +179,8 @@ void PlayerControls::clickOnEntity(Entity clickedEntity) {
     if (game->state->ecs.EntityHas<EC::Grabbable, EC::ItemStack>(*selectedEntity)) {
         ItemStack itemGrabbed = game->state->ecs.Get<EC::ItemStack>(*selectedEntity)->item;
         game->state->player.inventory()->addItemStack(itemGrabbed);
+        // the inventory took its own reference, and the stack on the ground is going away
+        game->state->itemManager.release(itemGrabbed.item);
         game->state->ecs.Destroy(*selectedEntity);
     }
 }
@@ -195,10 +200,7 @@ void PlayerControls::playerMouseTargetMoved(const MouseState& mouseState, const
             if (!justGrabbedItem) {
                 if (heldItemStack && game->state->player.canPlaceItemStack(*heldItemStack, game->state->itemManager)) {
                     for (int i = 0; i < line.size(); i++) {
-                        Tile* tile = getTileAtPosition(game->state->chunkmap, line[i]);
-                        if (tile) {
-                            game->state->player.tryPlaceItemStack(heldItemStack, tile, game->state->itemManager);
-                        }
+                        game->state->player.tryPlaceItemStack(heldItemStack, game->state->chunkmap, line[i], game->state->itemManager);
                     }
                 }
             }
@@ -238,6 +240,8 @@ void PlayerControls::handleKeydown(const SDL_KeyboardEvent& event) {
             auto* heldItemStack = &game->state->player.heldItemStack;
             if (heldItemStack && heldItemStack->get()) {
                 ItemStack dropStack = ItemStack(heldItemStack->get()->item, 1);
+                // the stack on the ground holds its own reference
+                game->state->itemManager.retain(dropStack.item);
                 heldItemStack->get()->reduceQuantity(1);
                 World::Entities::ItemStack(&game->state->ecs, mouseWorldPos, dropStack, game->state->itemManager);
             }
@@ -264,21 +268,21 @@ void PlayerControls::handleCommandInput(CommandInput commandInput) {
     if (!commandInput.name.empty()) {
         // command entered
         std::string message;
-        bool foundCommand = false;
-        for (auto& command : gCommands) {
-            if (My::streq_case(command.name, commandInput.name.c_str(), command.nameLength, commandInput.name.size())) {
-                auto result = executeCommand(&command, commandInput.arguments.c_str());
-                message = result.message;
-                foundCommand = true;
+        auto type = GUI::Console::MessageType::CommandResult;
+        Command* command = getCommand(commandInput.name);
+        if (command) {
+            auto result = executeCommand(command, commandInput.arguments.c_str());
+            message = result.message;
+            if (result.type == Command::Result::Error) {
+                type = GUI::Console::MessageType::Error;
             }
-        }
-        if (!foundCommand) {
+        } else {
             char messageBuf[256];
             snprintf(messageBuf, 256, "Invalid command \"%s\"", commandInput.name.c_str());
             message = std::string(messageBuf);
         }
 
-        game->gui->console.newMessage(message.c_str(), GUI::Console::MessageType::CommandResult);
+        game->gui->console.newMessage(message.c_str(), type);
     }
 }
 
@@ -378,8 +382,5 @@ void PlayerControls::movePlayer(Vec2 movement) {
 }
 
 void PlayerControls::placeItem(ItemStack* item, Vec2 at) {
-    Tile* tile = getTileAtPosition(game->state->chunkmap, at);
-    if (tile) {
-        game->state->player.tryPlaceItemStack(item, tile, game->state->itemManager);
-    }
+    game->state->player.tryPlaceItemStack(item, game->state->chunkmap, vecFloori(at), game->state->itemManager);
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "rendering/GlyphCache.hpp"
+#include "utils/Metadata.hpp"
+#include "utils/Log.hpp"
+#include "rendering/stats.hpp"
+#include "My/ScratchAllocator.hpp"
+
+int decodeUTF8(const char* text, int length, Codepoint* codepointOut) {
+    if (length <= 0) {
+        *codepointOut = ReplacementCodepoint;
+        return 0;
+    }
+
+    unsigned char lead = (unsigned char)text[0];
+    int sequenceLength = utf8SequenceLength(text[0]);
+    if (sequenceLength == 1) {
+        *codepointOut = lead < 0x80 ? lead : ReplacementCodepoint;
+        return 1;
+    }
+    if (sequenceLength > length) {
+        *codepointOut = ReplacementCodepoint;
+        return 1;
+    }
+
+    Codepoint codepoint = lead & (0xFF >> (sequenceLength + 1));
+    for (int i = 1; i < sequenceLength; i++) {
+        if (!isUTF8Continuation(text[i])) {
+            *codepointOut = ReplacementCodepoint;
+            return 1;
+        }
+        codepoint = (codepoint << 6) | ((unsigned char)text[i] & 0x3F);
+    }
+
+    // overlong encodings, utf-16 surrogates and anything past the end of unicode aren't valid
+    static constexpr Codepoint minimumCodepoint[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codepoint < minimumCodepoint[sequenceLength] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        *codepointOut = ReplacementCodepoint;
+        return 1;
+    }
+
+    *codepointOut = codepoint;
+    return sequenceLength;
+}
+
+static Uint32 currentFrame() {
+    return Metadata ? Metadata->getFrame() : 0;
+}
+
+GlyphCache GlyphCache::init(FT_Face face, bool usingSDFs) {
+    GlyphCache cache;
+    cache.face = face;
+    cache.usingSDFs = usingSDFs;
+    cache.glyphs = My::Vec<Glyph>::WithCapacity(128);
+    cache.freeGlyphs = My::Vec<int>::Empty();
+    cache.glyphIndices = My::HashMap<Codepoint, int>::WithBuckets(256);
+    cache.glyphCodepoints = My::Vec<Codepoint>::WithCapacity(128);
+    cache.packer = makeTexturePackingAtlas(1, 128, StartAtlasSize);
+    return cache;
+}
+
+void GlyphCache::markDirty(int minRow, int maxRow) {
+    dirtyMinRow = MIN(dirtyMinRow, minRow);
+    dirtyMaxRow = MAX(dirtyMaxRow, maxRow);
+}
+
+int GlyphCache::rasterize(Codepoint codepoint) {
+    Glyph glyph;
+    memset(&glyph, 0, sizeof(glyph));
+
+    // control characters have nothing to draw and take up no space. Tabs are handled by the font
+    if (codepoint >= ' ' && face) {
+        FT_GlyphSlot slot = face->glyph;
+        FT_Error error;
+        if ((error = FT_Load_Char(face, codepoint, FT_LOAD_DEFAULT))) {
+            LogError("Failed to load glyph for codepoint U+%04X. Error: %s", codepoint, FT_Error_String(error));
+        } else {
+            bool rendered = true;
+            if (codepoint != ' ') {
+                auto mode = usingSDFs ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL;
+                if ((error = FT_Render_Glyph(slot, mode))) {
+                    LogError("Failed to render glyph for codepoint U+%04X. Error: %s", codepoint, FT_Error_String(error));
+                    rendered = false;
+                }
+            }
+
+            if (rendered) {
+                assert(slot->advance.x >= 0 && slot->advance.x >> 6 <= UINT16_MAX);
+                glyph.advance = (uint16_t)(slot->advance.x >> 6);
+                glyph.bearing = glm::vec<2,  int16_t>{slot->bitmap_left, slot->bitmap_top};
+                glyph.size    = glm::vec<2, uint16_t>{slot->bitmap.width, slot->bitmap.rows};
+
+                if (slot->bitmap.buffer && glyph.size.x > 0 && glyph.size.y > 0) {
+                    glm::ivec2 sizeBefore = packer.atlas.size;
+                    glm::ivec2 position = packTexture(&packer, Texture{slot->bitmap.buffer, glm::ivec2(glyph.size), 1}, glm::ivec2(GlyphPadding));
+                    if (position.x >= 0) {
+                        glyph.position = glm::vec<2, uint16_t>(position);
+                        markDirty(position.y, position.y + glyph.size.y);
+                    }
+                    if (packer.atlas.size != sizeBefore) {
+                        // the packer grew the atlas. Existing glyphs keep their positions, but the whole thing needs uploading again
+                        markDirty(0, packer.atlas.size.y);
+                        if (packer.atlas.size.x > MaxAtlasSize || packer.atlas.size.y > MaxAtlasSize) {
+                            needsCompaction = true;
+                        }
+                    }
+                }
+                stats.rasterized++;
+            }
+        }
+    }
+
+    glyph.lastUsedFrame = currentFrame();
+
+    int index;
+    if (!freeGlyphs.empty()) {
+        index = freeGlyphs.popBack();
+        glyphs[index] = glyph;
+        glyphCodepoints[index] = codepoint;
+    } else {
+        index = glyphs.size;
+        glyphs.push(glyph);
+        glyphCodepoints.push(codepoint);
+    }
+    glyphIndices.insert(codepoint, index);
+    return index;
+}
+
+Glyph GlyphCache::get(Codepoint codepoint) {
+    int* cachedIndex = glyphIndices.lookup(codepoint);
+    int index = cachedIndex ? *cachedIndex : rasterize(codepoint);
+    Glyph& glyph = glyphs[index];
+    glyph.lastUsedFrame = currentFrame();
+    return glyph;
+}
+
+void GlyphCache::upload(TextureUnit unit, GLint minFilter, GLint magFilter) {
+    const Texture atlas = packer.atlas;
+    bool resized = textureSize != atlas.size;
+    if (texture && !resized && dirtyMaxRow < dirtyMinRow) return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // glyph rows are tightly packed bytes
+
+    if (!texture || resized) {
+        if (texture) {
+            glDeleteTextures(1, &texture);
+        }
+        texture = loadFontAtlasTexture(atlas, minFilter, magFilter);
+        textureSize = atlas.size;
+        renderStats.frame.textureBinds++;
+    } else {
+        // only the rows that changed. Rows are contiguous in the atlas buffer so no row length needs setting
+        int minRow = MAX(dirtyMinRow, 0);
+        int maxRow = MIN(dirtyMaxRow, atlas.size.y);
+        GL::bindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0,
+            0, minRow, atlas.size.x, maxRow - minRow,
+            GL_RED, GL_UNSIGNED_BYTE,
+            atlas.buffer + (size_t)minRow * atlas.size.x);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    dirtyMinRow = INT_MAX;
+    dirtyMaxRow = -1;
+}
+
+bool GlyphCache::compact() {
+    if (!needsCompaction) return false;
+    needsCompaction = false;
+
+    const Uint32 frame = currentFrame();
+    for (int i = 0; i < glyphs.size; i++) {
+        Codepoint codepoint = glyphCodepoints[i];
+        if (codepoint == InvalidCodepoint) continue;
+        if (glyphs[i].lastUsedFrame + ColdGlyphFrames < frame) {
+            glyphIndices.remove(codepoint);
+            glyphCodepoints[i] = InvalidCodepoint;
+            freeGlyphs.push(i);
+            stats.evicted++;
+        }
+    }
+
+    // repack what's left from the old atlas into a new one, no need to rasterize again
+    Texture oldAtlas = doneTexturePackingAtlas(&packer);
+    packer = makeTexturePackingAtlas(1, glyphIndices.size, StartAtlasSize);
+
+    My::FrameVec<unsigned char> scratch = My::FrameVec<unsigned char>::Empty();
+    for (int i = 0; i < glyphs.size; i++) {
+        if (glyphCodepoints[i] == InvalidCodepoint) continue;
+        Glyph& glyph = glyphs[i];
+        if (glyph.size.x == 0 || glyph.size.y == 0) continue;
+
+        scratch.resize(glyph.size.x * glyph.size.y);
+        for (int row = 0; row < glyph.size.y; row++) {
+            const unsigned char* src = oldAtlas.buffer + (size_t)(glyph.position.y + row) * oldAtlas.size.x + glyph.position.x;
+            memcpy(scratch.data + row * glyph.size.x, src, glyph.size.x);
+        }
+        glm::ivec2 position = packTexture(&packer, Texture{scratch.data, glm::ivec2(glyph.size), 1}, glm::ivec2(GlyphPadding));
+        glyph.position = glm::vec<2, uint16_t>(MAX(position.x, 0), MAX(position.y, 0));
+    }
+    freeTexture(oldAtlas);
+
+    markDirty(0, packer.atlas.size.y);
+    stats.compactions++;
+    return true;
+}
+
+void GlyphCache::destroy() {
+    glyphs.destroy();
+    freeGlyphs.destroy();
+    glyphIndices.destroy();
+    glyphCodepoints.destroy();
+    freeTexture(doneTexturePackingAtlas(&packer));
+    if (texture) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
@@ -0,0 +1,80 @@
+#include "rendering/RenderQueue.hpp"
+#include "rendering/context.hpp"
+
+RenderStats renderStats = {};
+
+void RenderQueue::sort() {
+    const int count = commands.size;
+    sorted.resize(count);
+    sortTemp.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        sorted[i] = SortEntry{commands[i].key, (Uint32)i};
+    }
+
+    // least significant digit radix sort, one byte at a time.
+    // Stable, so commands with equal keys keep their submission order
+    SortEntry* src = sorted.data;
+    SortEntry* dst = sortTemp.data;
+    for (int shift = 0; shift < 64; shift += 8) {
+        int counts[256] = {0};
+        for (int i = 0; i < count; i++) {
+            counts[(src[i].key >> shift) & 0xFF]++;
+        }
+
+        // every key has the same byte here (very common for depth and texture bits), nothing would move
+        if (counts[(src[0].key >> shift) & 0xFF] == count) continue;
+
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int bucketCount = counts[b];
+            counts[b] = offset;
+            offset += bucketCount;
+        }
+
+        for (int i = 0; i < count; i++) {
+            dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        SortEntry* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != sorted.data) {
+        memcpy(sorted.data, src, count * sizeof(SortEntry));
+    }
+}
+
+void RenderQueue::execute(RenderContext& ren) {
+    if (commands.empty()) return;
+
+    sort();
+
+    GLuint currentVao = 0;
+    for (int i = 0; i < sorted.size; i++) {
+        const RenderCommand& command = commands[sorted[i].command];
+
+        // Shader::use skips the switch if the shader is already in use,
+        // which also covers draw functions that switched shaders themselves
+        Uint8 shader = renderKeyShader(command.key);
+        if (shader != RenderKeyNoShader) {
+            ren.shaders.use((ShaderID)shader);
+        }
+
+        if (command.vao && command.vao != currentVao) {
+            GL::bindVertexArray(command.vao);
+            currentVao = command.vao;
+        }
+
+        command.draw(ren, command.userdata);
+
+        if (!command.vao) {
+            // draw function was in charge of the vao binding, don't know what's bound anymore
+            currentVao = 0;
+        }
+    }
+
+    renderStats.frame.queuedCommands += commands.size;
+    clear();
+}
@@ -1,6 +1,7 @@
 #include "rendering/Shader.hpp"
 
 GLuint usedShader = 0;
+UniformCache uniformCache;
 
 /*
 char* readFileContents(FILE* file, size_t* outBytesRead) {
@@ -120,6 +121,8 @@ ShaderProgram loadShaderProgram(const char* vertexPath, const char* fragmentPath
     if (program.geometry.id)
         glAttachShader(id, program.geometry.id);
     glLinkProgram(id);
+    // linking resets all uniforms and may move their locations
+    uniformCache.forget(id);
     GLint success;
     char infoLog[1024];
     glGetProgramiv(id, GL_LINK_STATUS, &success);
@@ -151,6 +154,60 @@ int reloadShaderProgram(ShaderProgram* program) {
     }
 }
 
+Uint64 UniformCache::key(GLuint program, const char* name) {
+    // fnv-1a
+    Uint32 hash = 2166136261u;
+    for (const char* c = name; *c; c++) {
+        hash ^= (Uint8)*c;
+        hash *= 16777619u;
+    }
+    return ((Uint64)program << 32) | hash;
+}
+
+UniformCache::Slot* UniformCache::get(GLuint program, const char* name) {
+    size_t nameLength = strlen(name);
+    if (nameLength > MaxNameLength) {
+        uncached.location = glGetUniformLocation(program, name);
+        uncached.valueSize = 0;
+        uncached.name[0] = '\0';
+        if (uncached.location == -1) {
+            LogError("Failed to get uniform location for \"%s\"", name);
+        }
+        return uncached.location != -1 ? &uncached : nullptr;
+    }
+
+    Uint64 slotKey = key(program, name);
+    Slot* slot = slots.lookup(slotKey);
+    // another name of the program with the same hash, keep looking in the next keys
+    while (slot && strcmp(slot->name, name) != 0) {
+        slotKey = (slotKey & 0xFFFFFFFF00000000ull) | (Uint32)(slotKey + 1);
+        slot = slots.lookup(slotKey);
+    }
+    if (!slot) {
+        Slot newSlot;
+        newSlot.location = glGetUniformLocation(program, name);
+        newSlot.valueSize = 0;
+        memcpy(newSlot.name, name, nameLength + 1);
+        if (newSlot.location == -1) {
+            // only logged the first time, the missing location is cached like any other
+            LogError("Failed to get uniform location for \"%s\"", name);
+        }
+        slot = slots.insert(slotKey, newSlot);
+    }
+    return slot->location != -1 ? slot : nullptr;
+}
+
+void UniformCache::forget(GLuint program) {
+    if (slots.size < 1) return;
+    const auto* buckets = slots.buckets();
+    const Uint64* keys = slots.keys();
+    for (int i = 0; i < slots.bucketCount; i++) {
+        if (buckets[i].state == My::Map::Bucket_Filled && (keys[i] >> 32) == program) {
+            slots.remove(keys[i]);
+        }
+    }
+}
+
 GLint Shader::getUniformLocation(const char* name) const {
     if (!this->id) {
         //LogError("Attempted to use uninitialized shader!");
@@ -162,9 +219,29 @@ GLint Shader::getUniformLocation(const char* name) const {
         this->use();
     }
 
-    GLint loc = glGetUniformLocation(id, name);
-    if (loc == -1) {
-        LogError("Failed to get uniform location for \"%s\"", name);
+    auto* slot = uniformCache.get(id, name);
+    return slot ? slot->location : -1;
+}
+
+UniformCache::Slot* Shader::updateUniform(const char* name, const void* value, int size) const {
+    if (!this->id) return nullptr;
+
+    if (this->id != usedShader) {
+        LogError("Attempted to use shader %d before calling shader.use()!. Switching shaders...", this->id);
+        this->use();
+    }
+
+    auto* slot = uniformCache.get(id, name);
+    if (!slot) return nullptr;
+
+    assert(size <= (int)sizeof(slot->value));
+    if (slot->valueSize == size && memcmp(slot->value, value, size) == 0) {
+        renderStats.frame.uniformsSkipped++;
+        return nullptr;
     }
-    return loc;
-}
\ No newline at end of file
+
+    memcpy(slot->value, value, size);
+    slot->valueSize = size;
+    renderStats.frame.uniformUploads++;
+    return slot;
+}
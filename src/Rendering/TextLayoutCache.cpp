@@ -0,0 +1,265 @@
+#include "rendering/TextLayoutCache.hpp"
+#include "utils/Metadata.hpp"
+
+bool TextLayoutCache::Key::operator==(const Key& other) const {
+    return font == other.font
+        && fontGeneration == other.fontGeneration
+        && textLength == other.textLength
+        && textHash == other.textHash
+        && formatting.align.horizontal == other.formatting.align.horizontal
+        && formatting.align.vertical == other.formatting.align.vertical
+        && formatting.maxWidth == other.formatting.maxWidth
+        && formatting.maxHeight == other.formatting.maxHeight
+        && formatting.sizeOffsetScale == other.formatting.sizeOffsetScale
+        && formatting.wrapOnWhitespace == other.formatting.wrapOnWhitespace
+        && scale == other.scale;
+}
+
+static Uint64 hashCombine(Uint64 hash, Uint64 value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+static Uint64 hashFloat(float f) {
+    Uint32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static Uint64 hashKey(const TextLayoutCache::Key& key) {
+    Uint64 hash = key.textHash;
+    hash = hashCombine(hash, (Uint64)(uintptr_t)key.font);
+    hash = hashCombine(hash, key.fontGeneration);
+    hash = hashCombine(hash, (Uint64)key.textLength);
+    hash = hashCombine(hash, ((Uint64)key.formatting.align.horizontal << 16) | (Uint64)key.formatting.align.vertical);
+    hash = hashCombine(hash, hashFloat(key.formatting.maxWidth));
+    hash = hashCombine(hash, hashFloat(key.formatting.maxHeight));
+    hash = hashCombine(hash, hashFloat(key.formatting.sizeOffsetScale));
+    hash = hashCombine(hash, key.formatting.wrapOnWhitespace);
+    hash = hashCombine(hash, hashFloat(key.scale.x));
+    hash = hashCombine(hash, hashFloat(key.scale.y));
+    return hash;
+}
+
+static Uint32 currentFrame() {
+    return Metadata ? Metadata->getFrame() : 0;
+}
+
+TextLayoutCache TextLayoutCache::init(size_t memoryCap) {
+    TextLayoutCache cache;
+    cache.entries = My::Vec<Entry>::WithCapacity(64);
+    cache.freeEntries = My::Vec<int>::WithCapacity(16);
+    cache.lookupTable = My::HashMap<Uint64, int>::WithBuckets(128);
+    cache.mostRecent = -1;
+    cache.leastRecent = -1;
+    cache.entryCount = 0;
+    cache.memoryUsed = 0;
+    cache.memoryCap = memoryCap;
+    cache.stats = {0, 0, 0, 0};
+    return cache;
+}
+
+Uint64 TextLayoutCache::hashText(const char* text, int textLength) {
+    // fnv-1a
+    Uint64 hash = 14695981039346656037ULL;
+    for (int i = 0; i < textLength; i++) {
+        hash ^= (Uint8)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void TextLayoutCache::unlink(int e) {
+    Entry& entry = entries[e];
+    if (entry.prev != -1) entries[entry.prev].next = entry.next;
+    else mostRecent = entry.next;
+    if (entry.next != -1) entries[entry.next].prev = entry.prev;
+    else leastRecent = entry.prev;
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+void TextLayoutCache::pushFront(int e) {
+    Entry& entry = entries[e];
+    entry.prev = -1;
+    entry.next = mostRecent;
+    if (mostRecent != -1) entries[mostRecent].prev = e;
+    mostRecent = e;
+    if (leastRecent == -1) leastRecent = e;
+}
+
+void TextLayoutCache::touch(int e) {
+    entries[e].lastUsedFrame = currentFrame();
+    if (mostRecent == e) return;
+    unlink(e);
+    pushFront(e);
+}
+
+int TextLayoutCache::find(const Key& key, Uint64 hash, const char* text) {
+    int* index = lookupTable.lookup(hash);
+    if (!index) return -1;
+    Entry& entry = entries[*index];
+    if (entry.key == key && memcmp(entry.text, text, key.textLength) == 0) {
+        return *index;
+    }
+    // hash collision with different text. Treat it as a miss
+    return -1;
+}
+
+void TextLayoutCache::layOut(int e) {
+    Entry& entry = entries[e];
+    const Key& key = entry.key;
+    CharacterLayoutData layout = formatText(key.font, entry.text, key.textLength, key.formatting, key.scale);
+
+    entry.layout.quads.destroy();
+    entry.layout.size = layout.size;
+    entry.layout.origin = layout.origin;
+    entry.layout.offset = layout.offset;
+    entry.layout.quads = My::Vec<GlyphQuad>::WithCapacity(layout.characters.size());
+    entry.layout.quads.size = layout.characters.size();
+    buildGlyphQuads(key.font, layout, entry.layout.quads.data);
+
+    memoryUsed -= entry.memory;
+    entry.memory = sizeof(Entry) + key.textLength + entry.layout.quads.size * sizeof(GlyphQuad);
+    memoryUsed += entry.memory;
+}
+
+int TextLayoutCache::insert(const Key& key, Uint64 hash, const char* text) {
+    int e;
+    if (!freeEntries.empty()) {
+        e = freeEntries.popBack();
+    } else {
+        e = entries.size;
+        Entry blank;
+        memset(&blank, 0, sizeof(blank));
+        entries.push(blank);
+    }
+
+    Entry& entry = entries[e];
+    Uint32 generation = entry.generation + 1;
+    if (generation == 0) generation = 1; // 0 is reserved for unused
+
+    entry.key = key;
+    entry.hash = hash;
+    entry.text = Alloc<char>(key.textLength);
+    memcpy(entry.text, text, key.textLength);
+    entry.layout.quads = My::Vec<GlyphQuad>::Empty();
+    entry.memory = 0;
+    layOut(e);
+    entry.lastUsedFrame = currentFrame();
+    entry.generation = generation;
+    entry.refCount = 0;
+    pushFront(e);
+
+    // replaces any colliding entry in the table, that entry will just age out of the lru list
+    lookupTable.update(hash, e);
+
+    entryCount++;
+
+    evict();
+    return e;
+}
+
+void TextLayoutCache::freeEntry(int e) {
+    Entry& entry = entries[e];
+    int* index = lookupTable.lookup(entry.hash);
+    if (index && *index == e) {
+        lookupTable.remove(entry.hash);
+    }
+    unlink(e);
+    Free(entry.text);
+    entry.text = nullptr;
+    entry.layout.quads.destroy();
+    entry.layout.quads = My::Vec<GlyphQuad>::Empty();
+    memoryUsed -= entry.memory;
+    entry.memory = 0;
+    // keep the generation so old handles to this slot stay invalid
+    entry.generation = entry.generation | 0x80000000u;
+    entryCount--;
+    freeEntries.push(e);
+}
+
+void TextLayoutCache::evict() {
+    // batches point into layouts until they're flushed, which can be as late as the next frame
+    Uint32 frame = currentFrame();
+    int e = leastRecent;
+    while (memoryUsed > memoryCap && e != -1) {
+        int prev = entries[e].prev;
+        const Entry& entry = entries[e];
+        if (entry.refCount == 0 && entry.lastUsedFrame + 1 < frame) {
+            freeEntry(e);
+            stats.evictions++;
+        }
+        e = prev;
+    }
+}
+
+const CachedTextLayout* TextLayoutCache::get(const Font* font, const char* text, int textLength, const TextFormattingSettings& formatting, glm::vec2 scale) {
+    if (!font || !text || textLength <= 0) return nullptr;
+
+    Key key = {font, font->generation, textLength, hashText(text, textLength), formatting, scale};
+    Uint64 hash = hashKey(key);
+
+    int e = find(key, hash, text);
+    if (e != -1) {
+        stats.hits++;
+        touch(e);
+    } else {
+        stats.misses++;
+        e = insert(key, hash, text);
+    }
+    return &entries[e].layout;
+}
+
+TextLayoutHandle TextLayoutCache::retain(const Font* font, const char* text, int textLength, const TextFormattingSettings& formatting, glm::vec2 scale) {
+    if (!get(font, text, textLength, formatting, scale)) return {};
+    // get always leaves the entry at the front
+    Entry& entry = entries[mostRecent];
+    entry.refCount++;
+    return TextLayoutHandle{(Uint32)mostRecent, entry.generation};
+}
+
+void TextLayoutCache::release(TextLayoutHandle handle) {
+    if (!handle || handle.index >= (Uint32)entries.size) return;
+    Entry& entry = entries[handle.index];
+    if (entry.generation != handle.generation) return;
+    assert(entry.refCount > 0);
+    entry.refCount--;
+}
+
+const CachedTextLayout* TextLayoutCache::lookup(TextLayoutHandle handle) {
+    if (!handle || handle.index >= (Uint32)entries.size) return nullptr;
+    Entry& entry = entries[handle.index];
+    if (entry.generation != handle.generation) return nullptr;
+    if (entry.key.fontGeneration != entry.key.font->generation) {
+        // the font was reloaded or its glyphs were moved, so lay the text out again under its new key.
+        // Handles to it stay valid, the old quads are only used by batches from frames before the font changed
+        int* index = lookupTable.lookup(entry.hash);
+        if (index && *index == (int)handle.index) {
+            lookupTable.remove(entry.hash);
+        }
+        entry.key.fontGeneration = entry.key.font->generation;
+        entry.hash = hashKey(entry.key);
+        layOut(handle.index);
+        lookupTable.update(entry.hash, handle.index);
+        stats.relayouts++;
+    }
+    touch(handle.index);
+    return &entry.layout;
+}
+
+const Font* TextLayoutCache::font(TextLayoutHandle handle) const {
+    if (!handle || handle.index >= (Uint32)entries.size) return nullptr;
+    const Entry& entry = entries[handle.index];
+    if (entry.generation != handle.generation) return nullptr;
+    return entry.key.font;
+}
+
+void TextLayoutCache::destroy() {
+    for (auto& entry : entries) {
+        Free(entry.text);
+        entry.layout.quads.destroy();
+    }
+    entries.destroy();
+    freeEntries.destroy();
+    lookupTable.destroy();
+}
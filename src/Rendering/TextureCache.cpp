@@ -0,0 +1,316 @@
+#include "rendering/TextureCache.hpp"
+#include <thread>
+#include <atomic>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "utils/Log.hpp"
+
+static constexpr char CacheMagic[8] = {'F','T','R','T','E','X','C','H'};
+
+static Uint64 hashBytes(Uint64 hash, const void* data, size_t size) {
+    // fnv-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static Uint64 hashString(Uint64 hash, const char* str) {
+    if (!str) return hashBytes(hash, "", 1);
+    return hashBytes(hash, str, strlen(str) + 1);
+}
+
+static Uint64 hashTextureMetadata(Uint64 hash, const TextureManager* textures, TextureID id) {
+    const TextureMetaData& metadata = textures->metadata[id];
+    hash = hashString(hash, metadata.identifier);
+    hash = hashString(hash, metadata.filename);
+    hash = hashBytes(hash, &metadata.type, sizeof(metadata.type));
+    if (const Animation* animation = textures->animations.lookup(id)) {
+        hash = hashBytes(hash, animation, sizeof(Animation));
+    }
+    return hash;
+}
+
+// cheap to work out, only needs a stat per file. Changes whenever an image is saved, even if it comes out the same
+static Uint64 hashTextureStamps(const TextureManager* textures, const char* assetsPath) {
+    Uint64 hash = 14695981039346656037ULL;
+    hash = hashBytes(hash, &TextureCache::Version, sizeof(TextureCache::Version));
+    for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
+        hash = hashTextureMetadata(hash, textures, id);
+
+        const char* filename = textures->metadata[id].filename;
+        if (!filename) continue;
+        auto path = My::str_add(assetsPath, filename);
+        SDL_PathInfo info;
+        if (SDL_GetPathInfo(path, &info)) {
+            hash = hashBytes(hash, &info.size, sizeof(info.size));
+            hash = hashBytes(hash, &info.modify_time, sizeof(info.modify_time));
+        }
+    }
+    return hash;
+}
+
+// reads every image file, so only done when the stamps changed or the cache is being rebuilt
+static Uint64 hashTextureContents(const TextureManager* textures, const char* assetsPath) {
+    Uint64 hash = 14695981039346656037ULL;
+    hash = hashBytes(hash, &TextureCache::Version, sizeof(TextureCache::Version));
+    for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
+        hash = hashTextureMetadata(hash, textures, id);
+
+        const char* filename = textures->metadata[id].filename;
+        if (!filename) continue;
+        auto path = My::str_add(assetsPath, filename);
+        size_t fileSize = 0;
+        void* file = SDL_LoadFile(path, &fileSize);
+        if (file) {
+            hash = hashBytes(hash, &fileSize, sizeof(fileSize));
+            hash = hashBytes(hash, file, fileSize);
+            SDL_free(file);
+        }
+    }
+    return hash;
+}
+
+// decode every texture image, spread over a few threads
+static void decodeTextures(TextureManager* textures, const char* assetsPath, SDL_Surface** imagesOut) {
+    std::atomic<int> nextID = {TextureIDs::First};
+    auto worker = [&](){
+        int id;
+        while ((id = nextID.fetch_add(1)) <= TextureIDs::Last) {
+            // each id only touches its own slot in textures->data
+            imagesOut[id] = textures->metadata[id].filename ? loadTexture(id, textures, assetsPath) : nullptr;
+        }
+    };
+
+    int threadCount = MIN((int)std::thread::hardware_concurrency(), (int)TextureIDs::NumTextures) - 1;
+    llvm::SmallVector<std::thread, 8> threads;
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker(); // this thread helps too
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static bool mapCacheFile(const char* path, unsigned char** dataOut, size_t* sizeOut) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(TextureCache::Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping stays valid after closing
+    if (mapping == MAP_FAILED) return false;
+
+    *dataOut = (unsigned char*)mapping;
+    *sizeOut = fileStat.st_size;
+    return true;
+}
+
+static bool inBounds(Uint64 offset, Uint64 size, Uint64 limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+// check every offset and size in the file stays inside it, so a truncated or corrupted cache can't be read past the end
+static bool validCacheFile(const unsigned char* data, size_t size) {
+    const auto* header = (const TextureCache::Header*)data;
+    if (memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0) return false;
+    if (header->version != TextureCache::Version) return false;
+    if (header->sectionCount > TextureCache::MaxSections) return false;
+    for (Uint32 i = 0; i < header->sectionCount; i++) {
+        const auto& section = header->sections[i];
+        if (section.size.x < 0 || section.size.y < 0) return false;
+        if (section.entriesOffset % 16 != 0) return false; // entries are read straight from the mapping
+
+        size_t entrySize;
+        switch (section.kind) {
+        case TextureCache::AtlasSection: entrySize = sizeof(TextureCache::AtlasEntry); break;
+        case TextureCache::ArraySection: entrySize = sizeof(TextureCache::LayerEntry); break;
+        default: return false;
+        }
+        if (!inBounds(section.entriesOffset, (Uint64)section.entryCount * entrySize, size)) return false;
+        if (!inBounds(section.pixelsOffset, section.pixelsSize, size)) return false;
+
+        if (section.kind == TextureCache::AtlasSection) {
+            Uint64 atlasBytes = (Uint64)section.size.x * section.size.y * StandardPixelFormatBytes;
+            if (atlasBytes > section.pixelsSize) return false;
+            const auto* entries = (const TextureCache::AtlasEntry*)(data + section.entriesOffset);
+            for (Uint32 e = 0; e < section.entryCount; e++) {
+                if (entries[e].id >= TextureIDs::NumTextureSlots) return false;
+            }
+        } else {
+            const auto* entries = (const TextureCache::LayerEntry*)(data + section.entriesOffset);
+            for (Uint32 e = 0; e < section.entryCount; e++) {
+                const auto& entry = entries[e];
+                if (entry.id >= TextureIDs::NumTextureSlots) return false;
+                if (entry.size.x < 0 || entry.size.y < 0) return false;
+                Uint64 layerBytes = (Uint64)entry.size.x * entry.size.y * StandardPixelFormatBytes;
+                if (!inBounds(entry.pixelsOffset, layerBytes, section.pixelsSize)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// the images were saved again without changing, so remember the new stamps to skip hashing them next time
+static void updateCacheStamp(const char* path, Uint64 stampHash) {
+    FILE* file = fopen(path, "r+b");
+    if (!file) return;
+    if (fseek(file, offsetof(TextureCache::Header, stampHash), SEEK_SET) == 0) {
+        fwrite(&stampHash, sizeof(stampHash), 1, file);
+    }
+    fclose(file);
+}
+
+TextureCache TextureCache::open(TextureManager* textures, const char* assetsPath, const char* cachePath) {
+    TextureCache cache;
+    cache.path = cachePath;
+    cache.stampHash = hashTextureStamps(textures, assetsPath);
+    cache.buildBuffer = My::Vec<unsigned char>::Empty();
+    bool hashedContents = false;
+
+    unsigned char* mapping;
+    size_t mappingSize;
+    if (cachePath && mapCacheFile(cachePath, &mapping, &mappingSize)) {
+        bool upToDate = false;
+        if (validCacheFile(mapping, mappingSize)) {
+            const auto* header = (const Header*)mapping;
+            upToDate = header->stampHash == cache.stampHash;
+            if (!upToDate) {
+                cache.contentHash = hashTextureContents(textures, assetsPath);
+                hashedContents = true;
+                upToDate = header->contentHash == cache.contentHash;
+                if (upToDate) {
+                    updateCacheStamp(cachePath, cache.stampHash);
+                }
+            }
+        }
+        if (upToDate) {
+            cache.data = mapping;
+            cache.dataSize = mappingSize;
+            cache.mapped = true;
+            // normally set when loading each texture
+            for (TextureID id = 0; id < TextureIDs::NumTextureSlots; id++) {
+                textures->data[id] = cache.header()->textureSizes[id];
+            }
+            return cache;
+        }
+        munmap(mapping, mappingSize);
+        LogInfo("Texture cache is out of date, rebuilding");
+    }
+
+    if (!hashedContents) {
+        cache.contentHash = hashTextureContents(textures, assetsPath);
+    }
+    decodeTextures(textures, assetsPath, cache.images);
+
+    // header goes first, filled in when closing
+    cache.buildBuffer.resize(sizeof(Header));
+    memset(cache.buildBuffer.data, 0, sizeof(Header));
+    cache.data = cache.buildBuffer.data;
+    cache.dataSize = cache.buildBuffer.size;
+    return cache;
+}
+
+const TextureCache::Section* TextureCache::find(SectionKind kind, TextureType types, glm::ivec2 size) const {
+    if (!mapped) return nullptr;
+    const Header* h = header();
+    for (Uint32 i = 0; i < h->sectionCount; i++) {
+        const Section& section = h->sections[i];
+        if (section.kind == kind && section.types == types && (kind != ArraySection || section.size == size)) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+
+static Uint64 appendAligned(My::Vec<unsigned char>& buffer, const void* bytes, size_t size) {
+    // keep everything 16 byte aligned so it can be used straight from the mapping
+    int oldSize = buffer.size;
+    int start = (oldSize + 15) & ~15;
+    buffer.resize(start + size);
+    memset(buffer.data + oldSize, 0, start - oldSize);
+    if (size) memcpy(buffer.data + start, bytes, size);
+    return start;
+}
+
+void TextureCache::add(SectionKind kind, TextureType types, glm::ivec2 size, const void* entryData, Uint32 entryCount, size_t entrySize,
+    ArrayRef<Texture> pixelData) {
+    if (mapped) return;
+    if (header()->sectionCount >= MaxSections) {
+        LogError("Too many texture cache sections!");
+        return;
+    }
+
+    Section section;
+    memset(&section, 0, sizeof(section));
+    section.kind = kind;
+    section.types = types;
+    section.size = size;
+    section.entryCount = entryCount;
+    section.entriesOffset = appendAligned(buildBuffer, entryData, entryCount * entrySize);
+
+    section.pixelsOffset = appendAligned(buildBuffer, nullptr, 0);
+    for (const Texture& texture : pixelData) {
+        size_t bytes = (size_t)texture.size.x * texture.size.y * texture.pixelSize;
+        int start = buildBuffer.size;
+        buildBuffer.resize(start + bytes);
+        memcpy(buildBuffer.data + start, texture.buffer, bytes);
+    }
+    section.pixelsSize = buildBuffer.size - section.pixelsOffset;
+
+    data = buildBuffer.data;
+    dataSize = buildBuffer.size;
+    Header* h = header();
+    h->sections[h->sectionCount++] = section;
+}
+
+void TextureCache::close(const TextureManager* textures) {
+    if (mapped) {
+        munmap(data, dataSize);
+    } else if (path) {
+        Header* h = header();
+        memcpy(h->magic, CacheMagic, sizeof(CacheMagic));
+        h->version = Version;
+        h->contentHash = contentHash;
+        h->stampHash = stampHash;
+        for (TextureID id = 0; id < TextureIDs::NumTextureSlots; id++) {
+            h->textureSizes[id] = textures->data[id];
+        }
+
+        // write to a temporary file first so a half written cache never gets used
+        auto tempPath = My::str_add(path, ".tmp");
+        FILE* file = fopen(tempPath, "wb");
+        if (file) {
+            size_t written = fwrite(buildBuffer.data, 1, buildBuffer.size, file);
+            fclose(file);
+            if (written != (size_t)buildBuffer.size || rename(tempPath, path) != 0) {
+                LogError("Failed to write texture cache to %s", path);
+                remove(tempPath);
+            }
+        } else {
+            LogError("Failed to open %s for writing the texture cache", (const char*)tempPath);
+        }
+    }
+
+    buildBuffer.destroy();
+    for (auto*& image : images) {
+        if (image) {
+            SDL_DestroySurface(image);
+            image = nullptr;
+        }
+    }
+    data = nullptr;
+    dataSize = 0;
+    mapped = false;
+}
@@ -1,157 +1,193 @@
 #include "rendering/TexturePacker.hpp"
+#include <algorithm>
 #include "memory.hpp"
 #include "rendering/textures.hpp"
 
-using Node = TexturePackingNode;
-constexpr auto NullNode = TexturePackingNullNode;
 using Atlas = TexturePackingAtlas;
+using Segment = TexturePackingSegment;
 
 Atlas makeTexturePackingAtlas(int pixelSize, int reserveCapacity, int reserveSize) {
     Atlas atlas;
-    atlas.nodesEmpty.reserve(2 * reserveCapacity);
-    atlas.nodes = My::Vec<Node>::WithCapacity(2 * reserveCapacity);
     atlas.atlas = newUninitTexture(glm::ivec2(reserveSize), pixelSize);
     fillTextureBlack(atlas.atlas);
 
-    atlas.nodes.push(Node({0, 0}, {INT_MAX, INT_MAX}));
-    atlas.nodesEmpty.push_back(true);
+    // the skyline has at most one more segment than there are textures packed
+    atlas.skyline = My::Vec<Segment>::WithCapacity(MIN(reserveCapacity + 1, 1024));
+    atlas.skyline.push(Segment{0, 0, reserveSize});
+
+    atlas.stats = {0, 0, 0, atlas.atlas.size};
     return atlas;
 }
 
 Texture doneTexturePackingAtlas(Atlas* atlas) {
     auto texture = atlas->atlas;
-    atlas->nodes.destroy();
-    atlas->nodesEmpty.clear();
+    atlas->skyline.destroy();
     return texture;
 }
 
-static int packNode(Atlas* atlas, int nodeIndex, glm::ivec2 size) {
-    auto& nodes = atlas->nodes;
-    auto& nodesEmpty = atlas->nodesEmpty;
-    if (!nodesEmpty[nodeIndex]) {
-        // The node is filled, not gonna fit anything else here
-        assert(nodes[nodeIndex].left == NullNode && nodes[nodeIndex].right == NullNode);
-        return NullNode;
-    } else if (nodes[nodeIndex].left != NullNode && nodes[nodeIndex].right != NullNode) {
-        // Non-leaf, try inserting to the left and then to the right
-        int retval = packNode(atlas, nodes[nodeIndex].left, size);
-        if (retval != NullNode) {
-            return retval;
-        }
-        return packNode(atlas, nodes[nodeIndex].right, size);
-    } else {
-        // This is an unfilled leaf - let's see if we can fill it
-        glm::ivec2 realSize = nodes[nodeIndex].size;
+// see if a rect of this size can sit on the skyline starting at the segment. Gets the y it would sit at
+static bool fitSkyline(const Atlas* atlas, int segmentIndex, glm::ivec2 size, int* yOut) {
+    const auto& skyline = atlas->skyline;
+    const glm::ivec2 atlasSize = atlas->atlas.size;
+    int x = skyline[segmentIndex].x;
+    if (x + size.x > atlasSize.x) return false;
+
+    int y = 0;
+    int widthLeft = size.x;
+    int i = segmentIndex;
+    // segments cover the whole atlas width, so this can't go past the last segment
+    while (widthLeft > 0) {
+        y = MAX(y, skyline[i].y);
+        if (y + size.y > atlasSize.y) return false;
+        widthLeft -= skyline[i].width;
+        i++;
+    }
 
-        // If we're along a boundary, calculate the actual size
-        auto origin = nodes[nodeIndex].origin;
-        if (origin.x + nodes[nodeIndex].size.x == INT_MAX) {
-            realSize.x = atlas->atlas.size.x - origin.x;
-        }
-        if (origin.y + nodes[nodeIndex].size.y == INT_MAX) {
-            realSize.y = atlas->atlas.size.y - origin.y;
-        }
+    *yOut = y;
+    return true;
+}
 
-        if (nodes[nodeIndex].size.x == size.x && nodes[nodeIndex].size.y == size.y) {
-            // Perfect size - just pack into this node
-            nodesEmpty[nodeIndex] = false;
-            return nodeIndex;
-        } else {
-            glm::vec2 sizeDiff = size - realSize;
-            
-            if (sizeDiff.x > 0 || sizeDiff.y > 0) {
-                // Not big enough
-                return NullNode;
-            } else {
-                // Large enough - split until we get a perfect fit
-                int left  = nodes.size;
-                int right = nodes.size+1;
-                nodes.require(2);
-                nodesEmpty.resize(nodesEmpty.size() + 2, true);
-
-                // Determine how much space we'll have left if we split each way
-                int remainX = realSize.x - size.x;
-                int remainY = realSize.y - size.y;
-
-                // Split the way that will leave the most room
-                bool verticalSplit = remainX < remainY;
-                if (remainX == 0 && remainY == 0) {
-                    // Edge case - we are are going to hit the border of
-                    // the texture atlas perfectly, split at the border instead
-                    if (nodes[nodeIndex].size.x > nodes[nodeIndex].size.y) {
-                        verticalSplit = false;
-                    } else {
-                        verticalSplit = true;
-                    }
-                }
+static void insertSegment(My::Vec<Segment>& skyline, int index, Segment segment) {
+    skyline.push(segment);
+    memmove(&skyline[index + 1], &skyline[index], (skyline.size - 1 - index) * sizeof(Segment));
+    skyline[index] = segment;
+}
 
-                auto origin = nodes[nodeIndex].origin;
-                auto nodeSize = nodes[nodeIndex].size;
-                if (verticalSplit) {
-                    // Split vertically (left is top)
-                    nodes[left] = Node(origin, glm::ivec2(nodeSize.x, size.y));
-                    nodes[right] = Node(glm::ivec2(origin.x, origin.y + size.y),
-                                            glm::ivec2(nodeSize.x, nodeSize.y - size.y));
-                } else {
-                    // Split horizontally
-                    nodes[left] = Node(origin, glm::ivec2(size.x, nodeSize.y));
-                    nodes[right] = Node(glm::ivec2(origin.x + size.x, origin.y), glm::ivec2(nodeSize.x - size.x, nodeSize.y));
-                }
+// put the rect on the skyline, raising the segments under it
+static void addSkylineLevel(Atlas* atlas, int segmentIndex, glm::ivec2 origin, glm::ivec2 size) {
+    auto& skyline = atlas->skyline;
+    insertSegment(skyline, segmentIndex, Segment{origin.x, origin.y + size.y, size.x});
+
+    // cut the segments that are now underneath the new one
+    int i = segmentIndex + 1;
+    while (i < skyline.size) {
+        const Segment& prev = skyline[i-1];
+        Segment& segment = skyline[i];
+        int overlap = prev.x + prev.width - segment.x;
+        if (overlap <= 0) break;
+
+        segment.x += overlap;
+        segment.width -= overlap;
+        if (segment.width > 0) break;
+        skyline.remove(i);
+    }
 
-                nodes[nodeIndex].left = left;
-                nodes[nodeIndex].right = right;
-                return packNode(atlas, left, size);
-            }
+    // merge neighbours at the same height
+    for (int j = 0; j < skyline.size - 1;) {
+        if (skyline[j].y == skyline[j+1].y) {
+            skyline[j].width += skyline[j+1].width;
+            skyline.remove(j+1);
+        } else {
+            j++;
         }
     }
 }
 
+// double the atlas size, keeping it square
+static bool growAtlas(Atlas* atlas, glm::ivec2 minSize) {
+    glm::ivec2 oldSize = atlas->atlas.size;
+    int newSize = MAX(MAX(oldSize.x*2, minSize.x), MAX(oldSize.y*2, minSize.y));
+    if (newSize > Atlas::MaxSize) return false;
+
+    resizeTexture(&atlas->atlas, glm::ivec2(newSize));
+
+    // the new space on the right starts out empty
+    auto& skyline = atlas->skyline;
+    int addedWidth = newSize - oldSize.x;
+    if (skyline.back().y == 0) {
+        skyline.back().width += addedWidth;
+    } else {
+        skyline.push(Segment{oldSize.x, 0, addedWidth});
+    }
+    atlas->stats.atlasSize = atlas->atlas.size;
+    return true;
+}
+
 glm::ivec2 packTexture(Atlas* atlas, Texture texture, glm::ivec2 padding) {
     if (!texture.buffer || texture.size.x <= 0 || texture.size.y <= 0) {
         return {-1, -1};
     }
 
-    texture.size += padding;
+    const glm::ivec2 paddedSize = texture.size + padding;
+
+    int bestSegment = -1;
+    glm::ivec2 bestOrigin = {-1, -1};
+    while (true) {
+        // bottom-left: lowest bottom edge wins, and on ties the narrowest segment, to waste less space
+        int bestBottom = INT_MAX;
+        int bestWidth = INT_MAX;
+        for (int i = 0; i < atlas->skyline.size; i++) {
+            int y;
+            if (fitSkyline(atlas, i, paddedSize, &y)) {
+                int bottom = y + paddedSize.y;
+                const Segment& segment = atlas->skyline[i];
+                if (bottom < bestBottom || (bottom == bestBottom && segment.width < bestWidth)) {
+                    bestSegment = i;
+                    bestBottom = bottom;
+                    bestWidth = segment.width;
+                    bestOrigin = {segment.x, y};
+                }
+            }
+        }
 
-    int nodeIndex = packNode(atlas, Atlas::root, texture.size);
-    while (nodeIndex == NullNode) {
-        // always keep atlas texture square
-        int newSize = MAX(MAX(atlas->atlas.size.x*2, texture.size.x*2), MAX(atlas->atlas.size.y*2, texture.size.y*2));
-        resizeTexture(&atlas->atlas, glm::ivec2(newSize));
-        nodeIndex = packNode(atlas, Atlas::root, texture.size);
-    }
+        if (bestSegment != -1) break;
 
-    Node* node = &atlas->nodes[nodeIndex];
+        if (!growAtlas(atlas, paddedSize)) {
+            atlas->stats.texturesFailed++;
+            return {-1, -1};
+        }
+    }
 
-    assert(texture.size.x == node->size.x);
-    assert(texture.size.y == node->size.y);
+    addSkylineLevel(atlas, bestSegment, bestOrigin, paddedSize);
 
     // Copy the texture to the texture atlas' buffer
-    texture.size -= padding;
-    copyTexture(atlas->atlas, texture, node->origin);
+    copyTexture(atlas->atlas, texture, bestOrigin);
 
-    return node->origin;
+    atlas->stats.texturesPacked++;
+    atlas->stats.usedPixels += (int64_t)paddedSize.x * paddedSize.y;
+    return bestOrigin;
 }
 
-Texture packTextures(const int numTextures, const Texture* textures, int pixelSize, glm::ivec2* textureOrigins, glm::ivec2 padding, int startSize) {
+Texture packTextures(const int numTextures, const Texture* textures, int pixelSize, glm::ivec2* textureOrigins, glm::ivec2 padding, int startSize, TexturePackingStats* statsOut) {
     if (!textures || !numTextures) return {nullptr, {0,0}};
 
-    Atlas atlas;
-    atlas.nodesEmpty.reserve(2 * numTextures);
-    atlas.nodes = My::Vec<Node>::WithCapacity(500);
-    atlas.atlas = newUninitTexture(glm::ivec2(startSize), pixelSize);
-    fillTextureBlack(atlas.atlas);
+    // tallest first, then biggest. Keeps the skyline flat
+    int* order = Alloc<int>(numTextures);
+    int64_t totalArea = 0;
+    int maxSide = 0;
+    for (int i = 0; i < numTextures; i++) {
+        order[i] = i;
+        glm::ivec2 size = textures[i].size + padding;
+        totalArea += (int64_t)size.x * size.y;
+        maxSide = MAX(maxSide, MAX(size.x, size.y));
+    }
+    std::sort(order, order + numTextures, [textures](int lhs, int rhs){
+        glm::ivec2 a = textures[lhs].size;
+        glm::ivec2 b = textures[rhs].size;
+        if (a.y != b.y) return a.y > b.y;
+        return a.x * a.y > b.x * b.y;
+    });
+
+    // start at a size everything could possibly fit in, so the atlas usually doesn't need to grow at all
+    int size = MAX(startSize, 1);
+    while ((int64_t)size * size < totalArea || size < maxSide) {
+        size *= 2;
+    }
 
-    atlas.nodes.push(Node({0, 0}, {INT_MAX, INT_MAX}));
-    atlas.nodesEmpty.push_back(true);
+    Atlas atlas = makeTexturePackingAtlas(pixelSize, numTextures, size);
 
     for (int i = 0; i < numTextures; i++) {
-        auto origin = packTexture(&atlas, textures[i], padding);
+        int index = order[i];
+        auto origin = packTexture(&atlas, textures[index], padding);
         if (textureOrigins) {
-            textureOrigins[i] = origin;
+            textureOrigins[index] = origin;
         }
     }
+    Free(order);
+
+    if (statsOut) {
+        *statsOut = atlas.stats;
+    }
 
-    atlas.nodes.destroy();
-    return atlas.atlas;
-}
\ No newline at end of file
+    return doneTexturePackingAtlas(&atlas);
+}
@@ -1,4 +1,5 @@
 #include "rendering/drawing.hpp"
+#include "rendering/TextLayoutCache.hpp"
 #include "utils/Debug.hpp"
 #include "PlayerControls.hpp"
 
@@ -173,6 +174,32 @@ void Draw::drawFpsCounter(GuiRenderer& renderer, float fps, float tps, RenderOpt
     }
 }
 
+void Draw::drawRenderStats(GuiRenderer& renderer, const RenderStats& stats, glm::vec2 pos) {
+    const auto& counts = stats.lastFrame;
+    char text[512];
+    snprintf(text, sizeof(text),
+        "Draw calls: %d\n"
+        "State changes: %d (shaders: %d, vaos: %d, textures: %d, uniforms: %d)\n"
+        "Redundant uniforms skipped: %d\n"
+        "Queued commands: %d",
+        counts.drawCalls,
+        stats.stateChanges(), counts.shaderChanges, counts.vaoBinds, counts.textureBinds, counts.uniformUploads,
+        counts.uniformsSkipped,
+        counts.queuedCommands);
+
+    if (const TextLayoutCache* layouts = renderer.text->layoutCache) {
+        int length = strlen(text);
+        snprintf(text + length, sizeof(text) - length,
+            "\nText layouts: %d (%.1f KiB), hit rate: %.1f%%, evictions: %llu",
+            layouts->entryCount, layouts->memoryUsed / 1024.0, layouts->stats.hitRate() * 100.0,
+            (unsigned long long)layouts->stats.evictions);
+    }
+
+    renderer.text->render(text, pos,
+        TextFormattingSettings{.align = TextAlignment::TopLeft},
+        TextRenderingSettings{.color = {255, 255, 255, 255}, .scale = glm::vec2(1.0f)});
+}
+
 void renderFontComponents(const Font* font, glm::vec2 p, GuiRenderer& renderer) {
     if (!font) return;
     auto* face = font->face;
@@ -288,6 +315,11 @@ void Draw::drawGui(RenderContext& ren, const Camera& camera, const glm::mat4& sc
 
     //textRenderer.setFont(&ren.font);
     Draw::drawFpsCounter(guiRenderer, (float)Metadata->fps(), (float)Metadata->tps(), guiRenderer.options);
+    if (Debug->settings[DebugFlags::drawRenderStats]) {
+        // just below the fps counter
+        float lineHeight = Fonts->get("Debug")->linePixelSpacing();
+        Draw::drawRenderStats(guiRenderer, renderStats, {0, guiRenderer.options.size.y - lineHeight});
+    }
 
     //textRenderer.setFont(&ren.debugFont);
     //textRenderer.setFont(&ren.font);
@@ -297,3 +329,32 @@ void Draw::drawGui(RenderContext& ren, const Camera& camera, const glm::mat4& sc
     guiRenderer.flush(ren.shaders, screenTransform);
     
 }
+
+void Draw::drawBeltItems(GuiRenderer& renderer, const World::TransportLines& transportLines, const ItemManager& itemManager, Boxf bounds) {
+    constexpr float ItemSize = 0.4f;
+    // belts are a tile big, so count ones that are only partly in the bounds
+    Vec2 min = bounds[0] - Vec2(1.0f);
+    Vec2 max = bounds[1];
+    for (const auto& line : transportLines.lines) {
+        bool visible = false;
+        for (IVec2 tile : line.belts) {
+            if (tile.x >= min.x && tile.y >= min.y && tile.x <= max.x && tile.y <= max.y) {
+                visible = true;
+                break;
+            }
+        }
+        if (!visible) continue;
+
+        for (int l = 0; l < World::TransportLine::NumLanes; l++) {
+            const auto& lane = line.lanes[l];
+            Sint32 distance = 0;
+            for (int i = lane.first; i < lane.items.size; i++) {
+                distance += lane.items[i].gap;
+                auto* display = itemManager.getComponent<ITC::Display>(lane.items[i].item);
+                if (!display) continue;
+                Vec2 position = transportLines.itemPosition(line, l, distance);
+                renderer.sprite(display->inventoryIcon, FRect{position.x - ItemSize / 2, position.y - ItemSize / 2, ItemSize, ItemSize});
+            }
+        }
+    }
+}
@@ -8,17 +8,22 @@
 #include "llvm/ArrayRef.h"
 #include "global.hpp"
 #include "rendering/drawing.hpp"
+#include "rendering/TextureCache.hpp"
 #include "world/functions.hpp"
 
 void scaleAllFonts(FontManager& fontManager, float scale) {
-    for (auto font : fontManager.fonts) {
-        if (font.second) {
-            font.second->scale(font.second->currentScale * scale / fontManager.fontScale);
-        }
-    }
+    fontManager.forEach([&](Font* font){
+        font->scale(font->currentScale * scale / fontManager.fontScale);
+    });
     fontManager.fontScale = scale;
 }
 
+void compactFontGlyphs(FontManager& fontManager) {
+    fontManager.forEach([](Font* font){
+        font->compactGlyphs();
+    });
+}
+
 void renderWater(RenderContext& ren, const Camera& camera, Vec2 min, Vec2 max, float time) {
     auto shader = ren.shaders.use(Shaders::Water);
     shader.setFloat("iTime", time);
@@ -59,7 +64,7 @@ void renderWater(RenderContext& ren, const Camera& camera, Vec2 min, Vec2 max, f
     GlModel model = makeModel(buffer, format);
     model.bindAll();
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::drawArrays(GL_TRIANGLES, 0, 6);
 
     model.destroy();
 }
@@ -144,7 +149,7 @@ int renderTilemap(RenderContext& ren, const Camera& camera, ChunkMap* chunkmap)
     int numRenderedChunks = 0;
 
     auto& chunkModel = ren.chunkModel;
-    glBindVertexArray(chunkModel.vao);
+    GL::bindVertexArray(chunkModel.vao);
 
     glBindBuffer(GL_ARRAY_BUFFER, chunkModel.positionVbo);
     glm::vec2* vertexPositions = (glm::vec2*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
@@ -191,7 +196,7 @@ int renderTilemap(RenderContext& ren, const Camera& camera, ChunkMap* chunkmap)
             glBindBuffer(GL_ARRAY_BUFFER, chunkModel.texCoordVbo);
             glUnmapBuffer(GL_ARRAY_BUFFER);
 
-            glDrawArrays(GL_POINTS, 0, chunksBuffered * numChunkVerts);
+            GL::drawArrays(GL_POINTS, 0, chunksBuffered * numChunkVerts);
 
             glBindBuffer(GL_ARRAY_BUFFER, chunkModel.positionVbo);
             vertexPositions = (glm::vec2*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
@@ -218,7 +223,7 @@ int renderTilemap(RenderContext& ren, const Camera& camera, ChunkMap* chunkmap)
     glUnmapBuffer(GL_ARRAY_BUFFER);
     
     if (chunksBuffered > 0) {
-        glDrawArrays(GL_POINTS, 0, chunksBuffered * numChunkVerts);
+        GL::drawArrays(GL_POINTS, 0, chunksBuffered * numChunkVerts);
         chunksBuffered = 0;
     }
     
@@ -319,7 +324,6 @@ Font* makeFont(const char* name, const char* font_filename, FT_UInt height, bool
     };
     auto font = newFont(
         My::str_add(FileSystem.assets.get("fonts/"), font_filename), height, sdf, 
-        ASCII_FIRST_STANDARD_CHAR, ASCII_LAST_STANDARD_CHAR+1,
         1.0f, fontFormatting,
         texUnit, sdf ? shaders.get(Shaders::SDF) : shaders.get(Shaders::Text));
     fonts.add(name, font);
@@ -332,14 +336,10 @@ void initFonts(FontManager& fonts, const ShaderManager& shaders) {
         .tabSpaces = 5.0f
     };
 
-    constexpr char firstChar = ASCII_FIRST_STANDARD_CHAR;
-    constexpr char endChar = ASCII_LAST_STANDARD_CHAR+1;
-
     Font* defaultFont = newFont(
         FileSystem.assets.get("fonts/HelloGraduationSans.ttf"),
         32,
         false,
-        firstChar, endChar,
         1,
         fontFormatting,
         TextureUnit::Font0,
@@ -349,7 +349,6 @@ void initFonts(FontManager& fonts, const ShaderManager& shaders) {
         FileSystem.assets.get("fonts/Cascadia.ttf"),
         32, // size
         true, // use sdfs?
-        firstChar, endChar, // first char (space), last char
         1, // scale
         fontFormatting, // formatting settings
         TextureUnit::Font1,
@@ -359,7 +358,6 @@ void initFonts(FontManager& fonts, const ShaderManager& shaders) {
         FileSystem.assets.get("fonts/Papyrus.ttf"),
         32,
         true,
-        32, 127,
         1,
         fontFormatting,
         TextureUnit::Font2,
@@ -370,8 +368,6 @@ void initFonts(FontManager& fonts, const ShaderManager& shaders) {
         FileSystem.assets.get("fonts/factorio-fonts/TitilliumWeb-SemiBold.ttf"),
         12,
         false,
-        firstChar,
-        endChar,
         1,
         fontFormatting,
         TextureUnit::Font3,
@@ -394,8 +390,16 @@ void renderInit(RenderContext& ren) {
     /* Init textures */
     ren.textures = TextureManager(TextureIDs::NumTextureSlots);
     setTextureMetadata(&ren.textures);
-    ren.textureArray = makeTextureArray({256, 256}, &ren.textures, TextureTypes::World, FileSystem.assets.get(), TextureUnit::MyTextureArray);
-    ren.textureAtlas = makeTextureAtlas(&ren.textures, TextureTypes::World, FileSystem.assets.get(), GL_NEAREST, GL_NEAREST, TextureUnit::MyTextureAtlas);
+    Uint64 textureLoadStart = SDL_GetTicksNS();
+    // images are only decoded if the texture cache is out of date
+    auto textureCachePath = FileSystem.resources.get("texture-cache.bin");
+    TextureCache textureCache = TextureCache::open(&ren.textures, FileSystem.assets.get(), textureCachePath);
+    ren.textureArray = makeTextureArray({256, 256}, &ren.textures, TextureTypes::World, &textureCache, TextureUnit::MyTextureArray);
+    ren.textureAtlas = makeTextureAtlas(&ren.textures, TextureTypes::World, &textureCache, GL_NEAREST, GL_NEAREST, TextureUnit::MyTextureAtlas);
+    TextureAtlas guiAtlas = makeTextureAtlas(&ren.textures, TextureTypes::Gui | TextureTypes::World, &textureCache, GL_LINEAR, GL_LINEAR, TextureUnit::GuiAtlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    LogInfo("Loaded textures in %.2f ms%s", (SDL_GetTicksNS() - textureLoadStart) / 1.0e6, textureCache.valid() ? " from cache" : "");
+    textureCache.close(&ren.textures);
     
     /* Init text stuff */
     initFreetype();
@@ -405,14 +409,19 @@ void renderInit(RenderContext& ren) {
     ren.guiTextRenderer = TextRenderer::init(Fonts->get("Debug"), nullptr);
     ren.worldTextRenderer = TextRenderer::init(Fonts->get("World"), nullptr);
     ren.worldTextRenderer.defaultRendering.scale = Vec2(1/32.0f);
+    ren.textLayouts = TextLayoutCache::init();
+    ren.guiTextRenderer.layoutCache = &ren.textLayouts;
+    ren.worldTextRenderer.layoutCache = &ren.textLayouts;
+    // only laid out again when their font changes
+    ren.worldLabels[0] = ren.worldTextRenderer.retain("HI", ren.worldTextRenderer.defaultFormatting, ren.worldTextRenderer.defaultRendering);
+    ren.worldLabels[1] = ren.worldTextRenderer.retain("This is roboto", ren.worldTextRenderer.defaultFormatting,
+        TextRenderingSettings{.font = Fonts->get("tester")});
     GL::logErrors();
 
     /* Init misc. renderers */
     ren.guiQuadRenderer = QuadRenderer(0);
     ren.worldQuadRenderer = QuadRenderer(0);
 
-    TextureAtlas guiAtlas = makeTextureAtlas(&ren.textures, TextureTypes::Gui | TextureTypes::World, FileSystem.assets.get(), GL_LINEAR, GL_LINEAR, TextureUnit::GuiAtlas);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     int screenWidth,screenHeight;
     SDL_GetWindowSizeInPixels(ren.window, &screenWidth, &screenHeight);
     RenderOptions guiOptions = {
@@ -455,6 +464,8 @@ void renderInit(RenderContext& ren) {
     ren.screenModel = makeScreenModel();
     ren.framebuffer = makeRenderBuffer({screenWidth, screenHeight});
 
+    ren.worldQueue = RenderQueue::init();
+
     setConstantShaderUniforms(ren);
 }
 
@@ -466,6 +477,10 @@ void renderQuit(RenderContext& ren) {
     ren.worldQuadRenderer.destroy();
     ren.worldTextRenderer.destroy();
     ren.worldGuiRenderer.destroy();
+    for (TextLayoutHandle label : ren.worldLabels) {
+        ren.textLayouts.release(label);
+    }
+    ren.textLayouts.destroy();
 
     quitFreetype();
 
@@ -474,6 +489,8 @@ void renderQuit(RenderContext& ren) {
 
     /* Shaders quit */
     ren.shaders.destroy();
+    uniformCache.destroy();
+    ren.worldQueue.destroy();
 
     /* Textures quit */
     ren.textures.destroy();
@@ -489,7 +506,7 @@ void renderTexture(Shader textureShader, GLuint texture) {
     if (!texture) return;
 
     glActiveTexture(GL_TEXTURE0 + TextureUnit::Random);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GL::bindTexture(GL_TEXTURE_2D, texture);
 
     const auto p = glm::vec3{0, 0, 0.99f};
     const float w = 500;
@@ -531,24 +548,50 @@ void renderTexture(Shader textureShader, GLuint texture) {
     const void* attributeVertices[] = {vertexPositions, vertexTexCoords, vertexRotations}; // order needs to be same as attribute order
 
     auto model = makeModelSOA(numVertices, attributeVertices, GL_STREAM_DRAW, vertexFormat);
-    glBindVertexArray(model.model.vao);
+    GL::bindVertexArray(model.model.vao);
 
     textureShader.use();
 
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
+    GL::drawArrays(GL_TRIANGLES, 0, numVertices);
 
     model.destroy();
 }
 
-static void renderWorld(RenderContext& ren, Camera& camera, GameState* state, Vec2 playerTargetPos) {
-    renderTilemap(ren, camera, &state->chunkmap);
+struct WorldPass {
+    const Camera* camera;
+    GameState* state;
+    glm::mat4 transform;
+    float seconds;
+};
+
+static void drawTilemapCommand(RenderContext& ren, void* userdata) {
+    auto* pass = (WorldPass*)userdata;
+    ren.shaders.get(Shaders::Tilemap).setMat4("transform", pass->transform);
+    renderTilemap(ren, *pass->camera, &pass->state->chunkmap);
+}
+
+static void drawWaterCommand(RenderContext& ren, void* userdata) {
+    auto* pass = (WorldPass*)userdata;
+    ren.shaders.get(Shaders::Water).setMat4("transform", pass->transform);
+    auto maxBoundingArea = pass->camera->maxBoundingArea();
+    renderWater(ren, *pass->camera, maxBoundingArea[0], maxBoundingArea[1], pass->seconds);
+}
 
-    auto maxBoundingArea = camera.maxBoundingArea();
-    float seconds = Metadata->frame.timestamp / 1000.0f;
-    renderWater(ren, camera, maxBoundingArea[0], maxBoundingArea[1], seconds);
+static void renderWorld(RenderContext& ren, Camera& camera, GameState* state, Vec2 playerTargetPos) {
+    WorldPass pass = {
+        .camera = &camera,
+        .state = state,
+        .transform = camera.getTransformMatrix(),
+        .seconds = Metadata->frame.timestamp / 1000.0f
+    };
 
-    // do systems
+    // depth testing takes care of draw order in the world pass, so commands only need to be grouped by state
+    auto& queue = ren.worldQueue;
+    // entity render systems fill their batches and submit a command for each one
     ECS::System::executeSystems(*ren.ecsRenderSystems);
+    queue.submit(makeRenderSortKey(RenderLayer::Tilemap, Shaders::Tilemap, TextureUnit::MyTextureAtlas, 0.0f), 0, drawTilemapCommand, &pass);
+    queue.submit(makeRenderSortKey(RenderLayer::Water, Shaders::Water, TextureUnit::Null, 0.0f), 0, drawWaterCommand, &pass);
+    queue.execute(ren);
 }
 
 // Binds the newly made texture on the active texture unit
@@ -626,7 +669,7 @@ void destroyRenderBuffer(RenderBuffer renderBuffer) {
 }
 
 void renderWorldRenderBuffer(RenderContext& ren, const Camera& camera) {
-    glBindVertexArray(ren.screenModel.model.vao);
+    GL::bindVertexArray(ren.screenModel.model.vao);
     glBindBuffer(GL_ARRAY_BUFFER, ren.screenModel.model.vbo);
     auto screenShader = ren.shaders.use(Shaders::Screen);
 
@@ -657,13 +700,17 @@ void renderWorldRenderBuffer(RenderContext& ren, const Camera& camera) {
     size_t offset = ren.screenModel.attributeOffsets[2];
     glBufferSubData(GL_ARRAY_BUFFER, offset, sizeof(vertexVelocities), vertexVelocities);
     
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    GL::drawArrays(GL_TRIANGLES, 0, 6);
 }
 
 void render(RenderContext& ren, RenderOptions options, Gui* gui, GameState* state, Camera& camera, const PlayerControls& controls, Mode mode, bool doRenderWorld) {
     GL::logErrors();    
     auto& shaders = ren.shaders;
 
+    renderStats.newFrame();
+    // before any text is formatted this frame, glyphs may get moved around on the atlas
+    compactFontGlyphs(ren.fonts);
+
     assert(camera.worldScale() > 0.0f);
 
     const glm::mat4 screenTransform = glm::ortho(0.0f, (float)camera.pixelWidth, 0.0f, (float)camera.pixelHeight);
@@ -675,9 +722,6 @@ void render(RenderContext& ren, RenderOptions options, Gui* gui, GameState* stat
     const Vec2 cameraMax = camera.maxCorner();
     const Boxf maxBoundingArea = camera.maxBoundingArea();
 
-    ren.shaders.use(Shaders::Quad).setMat4("transform", screenTransform);
-    ren.shaders.use(Shaders::Tilemap).setMat4("transform", worldTransform);
-    ren.shaders.use(Shaders::Water).setMat4("transform", worldTransform);
     auto textureShader = ren.shaders.use(Shaders::Texture);
     textureShader.setMat4("transform", screenTransform);
 
@@ -717,7 +761,7 @@ void render(RenderContext& ren, RenderOptions options, Gui* gui, GameState* stat
 
     auto quadShader = shaders.use(Shaders::Quad);
     quadShader.setMat4("transform", worldTransform);
-    if (Debug->settings["drawChunkBorders"]) {
+    if (Debug->settings[DebugFlags::drawChunkBorders]) {
         Draw::chunkBorders(ren.guiQuadRenderer, camera, SDL_Color{255, 0, 255, 155}, 8.0f, 0.5f);
     }
 
@@ -739,10 +783,10 @@ void render(RenderContext& ren, RenderOptions options, Gui* gui, GameState* stat
     settings.font = ren.fonts.get("World");
 
 
+    Draw::drawBeltItems(ren.worldGuiRenderer, state->transportLines, state->itemManager, maxBoundingArea);
     ren.worldGuiRenderer.flush(ren.shaders, worldTransform);
-    ren.worldGuiRenderer.text->render("HI", {5, 5});
-    ren.worldGuiRenderer.text->render("This is roboto", {-5, -5},
-        TextRenderingSettings{.font = Fonts->get("tester"), .color = {255, 255, 0, 255}});
+    ren.worldGuiRenderer.text->render(ren.worldLabels[0], {5, 5}, ren.worldTextRenderer.defaultRendering.color);
+    ren.worldGuiRenderer.text->render(ren.worldLabels[1], {-5, -5}, {255, 255, 0, 255});
     
     //ren.worldTextRenderer.flush(ren.shaders.get(Shaders::Text), worldTransform);
 
@@ -1,5 +1,7 @@
 #include "rendering/text.hpp"
 #include "rendering/textures.hpp"
+#include "rendering/TextLayoutCache.hpp"
+#include "My/ScratchAllocator.hpp"
 
 FT_Library freetype;
 
@@ -30,7 +32,7 @@ const TextAlignment TextAlignment::BottomLeft   = {HoriAlignment::Left,   VertAl
 const TextAlignment TextAlignment::BottomCenter = {HoriAlignment::Center, VertAlignment::Bottom};
 const TextAlignment TextAlignment::BottomRight  = {HoriAlignment::Right,  VertAlignment::Bottom};
 
-Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, char _firstChar, char _lastChar, float scale, Font::FormattingSettings formatting, TextureUnit textureUnit, Shader shader) {
+Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, float scale, Font::FormattingSettings formatting, TextureUnit textureUnit, Shader shader) {
     Font* f = new Font();
     
     f->baseHeight = baseHeight;
@@ -41,17 +43,6 @@ Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, char _firs
     f->formatting = formatting;
     f->textureUnit = textureUnit;
 
-    if (_lastChar > 127 || _lastChar < 0 || _firstChar > 127 || _firstChar < 0) {
-        LogError("Can't load font characters higher than 127 or lower than 0!");
-        if (_lastChar > 127) _lastChar = 127;
-        if (_firstChar > 127) _firstChar = 127;
-        if (_lastChar < 0) _lastChar = 0;
-        if (_firstChar < 0) _firstChar = 0;
-    }
-    
-    f->firstChar = _firstChar;
-    f->lastChar = _lastChar;
-
     f->usingSDFs = useSDFs;
 
     FT_Error err = 0;
@@ -62,11 +53,7 @@ Font* newFont(const char* fontfile, FT_UInt baseHeight, bool useSDFs, char _firs
         return nullptr;
     }
 
-    char numChars = f->lastChar - f->firstChar;
-    if (numChars > 0) {
-        f->characters = Alloc<Font::AtlasCharacterData>();
-        f->load(_height, shader, useSDFs);
-    }
+    f->load(_height, shader, useSDFs);
 
     return f;
 }
@@ -80,85 +67,38 @@ void Font::load(FT_UInt pixelHeight, Shader shader, bool useSDFs) {
     FT_Error err = FT_Set_Pixel_Sizes(face, 0, pixelHeight);
 
     this->_height = pixelHeight;
+    this->generation++;
     
     if (err) {
         LogError("Failed to set font face pixel size. FT_Error: %s", FT_Error_String(err));
         return;
     }
 
-    int nChars = numChars();
-    if (nChars <= 0) return;
-
-    constexpr int pixelSize = 1; // Character glyphs use 1 byte pixels, black and white
-    glPixelStorei(GL_UNPACK_ALIGNMENT, pixelSize); // disable byte-alignment restriction
-
-    memset(characters, 0, sizeof(decltype(*characters)));
-
-    if (this->face) {
-        FT_GlyphSlot slot = face->glyph;
-
-        bool kerning = FT_HAS_KERNING(face);
-        if (kerning) LogInfo("kerning possible on %s", face->family_name);
-
-        FT_Error error;
-
-        auto textureAtlas = makeTexturePackingAtlas(pixelSize, nChars);
-    
-        for (size_t i = 0; i < nChars; i++) {
-            char c = firstChar + (char)i;
-            // load character glyph 
-            if ((error = FT_Load_Char(face, c, FT_LOAD_DEFAULT))) {
-                LogError("Failed to load glyph charcter \'%c\'. Error: %s", c, FT_Error_String(error));
-                continue;
-            }
-
-            if (c != ' ') {
-                auto mode = useSDFs ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL;
-                bool usingBSDFs = usingSDFs && 0;
-                if (usingBSDFs) {
-                    if ((error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL))) {
-                        LogError("Failed to load sdf glyph charcter \'%c\'. Error: %s", c, FT_Error_String(error));
-                    }
-                }
-                if ((error = FT_Render_Glyph(slot, mode))) {
-                    LogError("Failed to load sdf glyph charcter \'%c\'. Error: %s", c, FT_Error_String(error));
-                    continue;
-                }
-            }
+    // glyphs at the old size are useless now. The new ones get rasterized as they're used
+    if (glyphs) {
+        glyphs->destroy();
+        *glyphs = GlyphCache::init(face, useSDFs);
+    } else {
+        glyphs = new GlyphCache(GlyphCache::init(face, useSDFs));
+    }
+}
 
-            assert(slot->advance.x >= 0 && slot->advance.x >> 6 <= UINT16_MAX);
-            characters->advances[c]  = (uint16_t)(slot->advance.x >> 6);
-            characters->bearings[c]  = glm::vec<2,  int16_t>{slot->bitmap_left, slot->bitmap_top};
-            characters->sizes[c]     = glm::vec<2, uint16_t>{slot->bitmap.width, slot->bitmap.rows};
-            characters->positions[c] = packTexture(&textureAtlas, Texture{slot->bitmap.buffer, characters->sizes[c], pixelSize}, {1, 1});
-        }
+void Font::uploadGlyphs() const {
+    if (!glyphs) return;
+    constexpr GLint regularMinFilter = GL_LINEAR;
+    constexpr GLint regularMagFilter = GL_LINEAR;
+    constexpr GLint sdfMinFilter     = GL_LINEAR;
+    constexpr GLint sdfMagFilter     = GL_LINEAR;
+    GLint minFilter = usingSDFs ? sdfMinFilter : regularMinFilter;
+    GLint magFilter = usingSDFs ? sdfMagFilter : regularMagFilter;
+    glyphs->upload(textureUnit, minFilter, magFilter);
+}
 
-        characters->advances['\t'] = characters->advances[' '] * formatting.tabSpaces;
-
-        Texture packedTexture = doneTexturePackingAtlas(&textureAtlas);
-        this->atlasSize = packedTexture.size;
-
-        glActiveTexture(GL_TEXTURE0 + textureUnit);
-        constexpr GLint regularMinFilter = GL_LINEAR;
-        constexpr GLint regularMagFilter = GL_LINEAR;
-        constexpr GLint sdfMinFilter     = GL_LINEAR;
-        constexpr GLint sdfMagFilter     = GL_LINEAR;
-        GLint minFilter = usingSDFs ? sdfMinFilter : regularMinFilter;
-        GLint magFilter = usingSDFs ? sdfMagFilter : regularMagFilter;
-        if (this->atlasTexture) {
-            glDeleteTextures(1, &this->atlasTexture);
-            this->atlasTexture = 0;
-        }
-        this->atlasTexture = loadFontAtlasTexture(packedTexture, minFilter, magFilter);
-        freeTexture(packedTexture);
+void Font::compactGlyphs() {
+    if (glyphs && glyphs->compact()) {
+        // quads made before this point have the old atlas positions
+        generation++;
     }
-    GL::logErrors();
-    
-    if (!this->atlasTexture) {
-        LogError("Font atlas texture failed to generate!");
-    }
-
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // re enable default byte-alignment restriction
 }
 
 void Font::unload() {
@@ -166,8 +106,11 @@ void Font::unload() {
     if (!face || !face->family_name) return;
     LogInfo("Unloading font %s-%s", face->family_name, face->style_name);
     FT_Done_Face(face); face = nullptr;
-    Free(characters);
-    glDeleteTextures(1, &atlasTexture);
+    if (glyphs) {
+        glyphs->destroy();
+        delete glyphs;
+        glyphs = nullptr;
+    }
 }
 
 CharacterLayoutData formatText(const Font* font, const char* text, int textLength, TextFormattingSettings settings, glm::vec2 scale) {
@@ -193,8 +136,9 @@ CharacterLayoutData formatText(const Font* font, const char* text, int textLengt
     llvm::SmallVector<float> lineSizes;
     int lineBreakIndex = -1; // need to put a break before this character
 
-    for (int i = 0; i < textLength; i++) {
-        char c = text[i];
+    for (int byte = 0, i = 0; byte < textLength; i++) {
+        Codepoint c;
+        byte += decodeUTF8(&text[byte], textLength - byte, &c);
     
         // FT_Vector fractionalKerning = {0,0}; 
         // auto leftCharIndex = FT_Get_Char_Index(font->face, c);
@@ -205,11 +149,6 @@ CharacterLayoutData formatText(const Font* font, const char* text, int textLengt
         // cx += kerning.x;
 
         bool whitespaceChar = isWhitespace(c); // current character is whitespace (nothing to render, does nothing but shift formatting)
-        
-        if (!whitespaceChar && (c < font->firstChar || c > font->lastChar)) {
-            // turn unsupported characters into hashtags
-            c = '#';
-        }
 
         float charPixelsAdvance = (float)font->advance(c);
         
@@ -405,6 +344,34 @@ TextRenderer TextRenderer::init(const Font* defaultFont, My::Vec<TextRenderBatch
     return self;
 }
 
+void buildGlyphQuads(const Font* font, const CharacterLayoutData& layout, GlyphQuad* quadsOut) {
+    for (int i = 0; i < layout.characters.size(); i++) {
+        const Glyph glyph = font->glyph(layout.characters[i]);
+        glm::vec2 offset = layout.characterOffsets[i];
+        glm::vec2 bearing = glyph.bearing;
+        glm::vec2 size = glyph.size;
+        glm::vec2 atlasPos = glyph.position;
+
+        GlyphQuad& quad = quadsOut[i];
+        quad.min.x = offset.x + bearing.x;
+        quad.min.y = offset.y - (size.y - bearing.y);
+        quad.max = quad.min + size;
+        quad.texMin = atlasPos;
+        quad.texMax = atlasPos + size;
+    }
+}
+
+glm::vec2 TextRenderer::renderScale(const RenderingSettings& renderSettings) const {
+    glm::vec2 scale = renderSettings.scale;
+    if (scale.x < 0.0f || scale.y < 0.0f) {
+        scale = this->defaultRendering.scale;
+        if (scale.x < 0.0f || scale.y < 0.0f) {
+            scale = {1.0f, 1.0f};
+        }
+    }
+    return scale;
+}
+
 TextRenderer::RenderResult TextRenderer::render(const char* text, int textLength, glm::vec2 pos, const TextFormattingSettings& formatSettings, RenderingSettings renderSettings, glm::vec2* outCharPositions) {
     if (!buffer) return RenderResult::BadRender();
     
@@ -415,71 +382,90 @@ TextRenderer::RenderResult TextRenderer::render(const char* text, int textLength
         return RenderResult::BadRender(pos);
     }
 
-    glm::vec2 scale = renderSettings.scale;
-    if (scale.x < 0.0f || scale.y < 0.0f) {
-        scale = this->defaultRendering.scale;
-        if (scale.x < 0.0f || scale.y < 0.0f) {
-            scale = {1.0f, 1.0f};
-        }
-    }
+    glm::vec2 scale = renderScale(renderSettings);
     Vec2 minPos = {INFINITY, INFINITY};
     Vec2 maxSize = {-INFINITY, -INFINITY};
     int textParsed = 0;
 
     while (textParsed < textLength) {
-        int batchSize = MIN(maxBatchSize, textLength);
+        int batchSize = MIN(maxBatchSize, textLength - textParsed);
+        // don't split a batch in the middle of a utf-8 sequence
+        while (batchSize > 1 && textParsed + batchSize < textLength && isUTF8Continuation(text[textParsed + batchSize])) {
+            batchSize--;
+        }
+        const char* batchText = &text[textParsed];
+
+        glm::vec2 layoutSize, layoutOrigin, layoutOffset;
+        const GlyphQuad* quads = nullptr;
+        int quadCount = 0;
+
+        // character positions need the whitespace offsets too, which aren't cached
+        if (layoutCache && !outCharPositions) {
+            const CachedTextLayout* cached = layoutCache->get(font, batchText, batchSize, formatSettings, scale);
+            if (!cached) break;
+            layoutSize = cached->size;
+            layoutOrigin = cached->origin;
+            layoutOffset = cached->offset;
+            quads = cached->quads.data;
+            quadCount = cached->quads.size;
+        } else {
+            auto layout = formatText(font, batchText, batchSize, formatSettings, scale);
+            layoutSize = layout.size;
+            layoutOrigin = layout.origin;
+            layoutOffset = layout.offset;
+            quadCount = layout.characters.size();
+            if (quadCount > 0) {
+                // only needs to last until the batch is flushed at the end of the frame
+                GlyphQuad* newQuads = My::FrameAlloc<GlyphQuad>(quadCount);
+                buildGlyphQuads(font, layout, newQuads);
+                quads = newQuads;
+            }
+
+            if (outCharPositions) {
+                glm::vec2 origin = pos/scale + formatSettings.sizeOffsetScale * layoutSize * scale - layoutOrigin;
+                int regularCharIndex = 0;
+                int whitespaceCharIndex = 0;
+                for (int i = 0; i < batchSize;) {
+                    Codepoint c;
+                    int charBytes = decodeUTF8(&batchText[i], batchSize - i, &c);
+                    glm::vec2 offset;
+                    if (isWhitespace(c)) {
+                        if (whitespaceCharIndex >= layout.whitespaceCharacterOffsets.size()) break;
+                        offset = layout.whitespaceCharacterOffsets[whitespaceCharIndex++];
+                    } else {
+                        if (regularCharIndex >= layout.characterOffsets.size()) break;
+                        offset = layout.characterOffsets[regularCharIndex++];
+                    }
+                    // every byte of a multi byte character gets the position of the character
+                    for (int b = 0; b < charBytes; b++) {
+                        outCharPositions[textParsed + i + b] = (origin + offset) * scale;
+                    }
+                    i += charBytes;
+                }
+            }
+        }
 
-        auto layout = formatText(font, &text[textParsed], batchSize, formatSettings, scale);
         // format() does not account for scale so we do here.
         glm::vec2 unscaledPos = pos/scale;
-        glm::vec2 scaledSize = layout.size * scale;
-        glm::vec2 scaledOffset = layout.offset * scale;
+        glm::vec2 scaledSize = layoutSize * scale;
+        glm::vec2 scaledOffset = layoutOffset * scale;
 
         unscaledPos += formatSettings.sizeOffsetScale * scaledSize;
 
-        
         maxSize.x = MAX(maxSize.x, scaledSize.x);
         maxSize.y = MAX(maxSize.y, scaledSize.y);
         minPos.x  = MIN(minPos.x, scaledOffset.x);
         minPos.y  = MIN(minPos.y, scaledOffset.y);
 
-        layout.origin = unscaledPos - layout.origin;
-
-        if (outCharPositions) {
-            int regularCharIndex = 0;
-            int whitespaceCharIndex = 0;
-            for (int i = 0; i < batchSize; i++) {
-                glm::vec2 offset;
-                if (isWhitespace(text[i])) {
-                    offset = layout.whitespaceCharacterOffsets[whitespaceCharIndex++];
-                } else {
-                    offset = layout.characterOffsets[regularCharIndex++];
-                }
-                outCharPositions[i] = (layout.origin + offset) * scale;
-            }
-        }
-
-        if (layout.characters.size() > 0) {
-            TextRenderLayout batchLayout = {
-                .characterOffsets =  My::Vec<glm::vec2>(layout.characterOffsets.data(), layout.characterOffsets.size()),
-                .characters = My::Vec<char>(layout.characters.data(), layout.characters.size()),
-                .origin = layout.origin
-            };
-            auto dimensions = My::Vec<TextRenderBatch::CharacterDimensions>::WithCapacity(layout.characters.size());
-            for (int i = 0; i < batchLayout.characters.size; i++) {
-                dimensions.push({
-                    .size = {font->size(batchLayout.characters[i])},
-                    .bearing = {font->bearing(batchLayout.characters[i])}
-                });
-            }
+        if (quadCount > 0) {
             TextRenderBatch batch = {
                 .font = font,
-                .dimensions = dimensions,
-                .layout = batchLayout,
-                .colors = My::Vec<SDL_Color>::Filled(1, renderSettings.color),
-                .scales = My::Vec<glm::vec2>::Filled(1, scale)
+                .origin = unscaledPos - layoutOrigin,
+                .quads = quads,
+                .quadCount = quadCount,
+                .color = renderSettings.color,
+                .scale = scale
             };
-            
             buffer->push(batch);
         }
 
@@ -499,57 +485,71 @@ TextRenderer::RenderResult TextRenderer::render(const char* text, int textLength
     return RenderResult(outputSize);
 }
 
+TextLayoutHandle TextRenderer::retain(const char* text, const TextFormattingSettings& formatSettings, const RenderingSettings& renderSettings) {
+    if (!layoutCache || !text) return {};
+    const Font* font = renderSettings.font ? renderSettings.font : this->defaultFont;
+    if (!font || !font->face) return {};
+    return layoutCache->retain(font, text, strlen(text), formatSettings, renderScale(renderSettings));
+}
+
+TextRenderer::RenderResult TextRenderer::render(TextLayoutHandle handle, glm::vec2 pos, SDL_Color color) {
+    if (!buffer || !layoutCache) return RenderResult::BadRender(pos);
+
+    const CachedTextLayout* layout = layoutCache->lookup(handle);
+    if (!layout) return RenderResult::BadRender(pos);
+    const Font* font = layoutCache->font(handle);
+    const auto& key = layoutCache->entries[handle.index].key;
+    glm::vec2 scale = key.scale;
+
+    glm::vec2 unscaledPos = pos/scale;
+    glm::vec2 scaledSize = layout->size * scale;
+    glm::vec2 scaledOffset = layout->offset * scale;
+    unscaledPos += key.formatting.sizeOffsetScale * scaledSize;
+
+    if (layout->quads.size > 0) {
+        TextRenderBatch batch = {
+            .font = font,
+            .origin = unscaledPos - layout->origin,
+            .quads = layout->quads.data,
+            .quadCount = layout->quads.size,
+            .color = color,
+            .scale = scale
+        };
+        buffer->push(batch);
+    }
+
+    glm::vec2 min = pos + scaledOffset;
+    return RenderResult(FRect{
+        min.x,
+        min.y - scaledSize.y,
+        scaledSize.x,
+        scaledSize.y
+    });
+}
+
 void renderBatch(const TextRenderBatch* batch, GlyphVertex* verticesOut, int bufferSize) {
     if (!verticesOut) {
         return;
     }
 
-    const Font* font = batch->font;
-    if (!font) {
-        LogError("No font in batch!");
-    }
-    
-    const auto& layout = batch->layout;
-    const auto count = layout.characters.size;
+    const auto count = batch->quadCount;
     assert(count * 4 <= bufferSize && "Batch too large!");
-    for (size_t i = 0; i < count; i++) {
-        char c = layout.characters[i];
-        glm::vec2 offset = layout.characterOffsets[i];
-        auto bearing = batch->dimensions[i].bearing;
-        auto characterSize = batch->dimensions[i].size;
-
-        GLfloat x  = layout.origin.x + (offset.x + bearing.x);
-        GLfloat y  = layout.origin.y + (offset.y - (characterSize.y - bearing.y));
-        GLfloat x2 = x + characterSize.x;
-        GLfloat y2 = y + characterSize.y;
-
-        //auto* coords = getTexCoords(c)->data();
-
-        const glm::vec2 pos  = font->characters->positions[c];
-        const glm::vec2 size = font->characters->sizes[c];
-        const glm::vec2 texSize = font->atlasSize;
-
-        auto tx  = (pos.x) / texSize.x;
-        auto ty  = (pos.y) / texSize.y;
-        auto tx2 = (pos.x + size.x) / texSize.x;
-        auto ty2 = (pos.y + size.y) / texSize.y;
-
-
-        SDL_Color color;
-        if (batch->uniformColor()) {
-            color = batch->colors[0];
-        } else {
-            color = batch->colors[i];
-        }
-
-        glm::vec2 scale;
-        if (batch->uniformScale()) {
-            scale = batch->scales[0];
-        } else {
-            scale = batch->scales[i];
-        }
-
-        // scale *= font->currentScale;
+    const glm::vec2 origin = batch->origin;
+    const SDL_Color color = batch->color;
+    const glm::vec2 scale = batch->scale;
+    const glm::vec2 texSize = batch->font->atlasSize();
+    for (int i = 0; i < count; i++) {
+        const GlyphQuad& quad = batch->quads[i];
+
+        GLfloat x  = origin.x + quad.min.x;
+        GLfloat y  = origin.y + quad.min.y;
+        GLfloat x2 = origin.x + quad.max.x;
+        GLfloat y2 = origin.y + quad.max.y;
+
+        auto tx  = quad.texMin.x / texSize.x;
+        auto ty  = quad.texMin.y / texSize.y;
+        auto tx2 = quad.texMax.x / texSize.x;
+        auto ty2 = quad.texMax.y / texSize.y;
 
         const GlyphVertex vertices[] = {
             {{x,  y},  {tx, ty2}, color, scale},
@@ -563,12 +563,12 @@ void renderBatch(const TextRenderBatch* batch, GlyphVertex* verticesOut, int buf
 }
 
 void flushTextBatches(MutableArrayRef<TextRenderBatch> buffer, GlModel model, const glm::mat4& transform, int maxBatchSize) {
-    glBindVertexArray(model.vao);
+    GL::bindVertexArray(model.vao);
     glBindBuffer(GL_ARRAY_BUFFER, model.vbo);
 
     unsigned int maxCharacters = 0;
     for (auto& batch : buffer) {
-        int batchCharacters = batch.layout.characters.size;
+        int batchCharacters = batch.quadCount;
         assert(batchCharacters < maxBatchSize && "Character batch too large!");
         maxCharacters = MAX(batchCharacters, maxCharacters);
     }
@@ -592,6 +592,7 @@ void flushTextBatches(MutableArrayRef<TextRenderBatch> buffer, GlModel model, co
 
     for (int i = 0; i < buffer.size(); i++) {
         auto* batch = &buffer[i];
+        batch->font->uploadGlyphs();
         Shader textShader = batch->font->shader;
         textShader.use();
         textShader.setMat4("transform", transform);
@@ -601,12 +602,7 @@ void flushTextBatches(MutableArrayRef<TextRenderBatch> buffer, GlModel model, co
         renderBatch(batch, vertexBuffer, maxBatchSize);
         glUnmapBuffer(GL_ARRAY_BUFFER);
 
-        glDrawElements(GL_TRIANGLES, 6 * batch->layout.characters.size, GL_UNSIGNED_SHORT, NULL);
-        batch->dimensions.destroy();
-        batch->colors.destroy();
-        batch->scales.destroy();
-        batch->layout.characters.destroy();
-        batch->layout.characterOffsets.destroy();
+        GL::drawElements(GL_TRIANGLES, 6 * batch->quadCount, GL_UNSIGNED_SHORT, NULL);
     }
     GL::logErrors();
 }
\ No newline at end of file
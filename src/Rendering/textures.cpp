@@ -2,6 +2,7 @@
 #include "sdl_gl.hpp"
 #include "utils/Log.hpp"
 #include "rendering/context.hpp"
+#include "rendering/TextureCache.hpp"
 
 void copyTexture(Texture dst, Texture src, glm::ivec2 dstOffset) {
     assert(src.pixelSize == dst.pixelSize); // need same format to copy
@@ -134,7 +135,7 @@ SDL_Surface* loadTexture(TextureID id, TextureManager* textures, const char* bas
     return image;
 }
 
-GLuint GlLoadTextureArray(glm::ivec2 size, ArrayRef<SDL_Surface*> images, GLenum minFilter, GLenum magFilter) {
+GLuint GlLoadTextureArray(glm::ivec2 size, ArrayRef<Texture> layers, GLenum minFilter, GLenum magFilter) {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
@@ -146,67 +147,79 @@ GLuint GlLoadTextureArray(glm::ivec2 size, ArrayRef<SDL_Surface*> images, GLenum
     glTexImage3D(GL_TEXTURE_2D_ARRAY,
         0,                  // level
         GL_RGBA8,           // internal format
-        size.x, size.y, images.size(), // width,height,depth
+        size.x, size.y, layers.size(), // width,height,depth
         0,                  // border?
         GL_RGBA,            // format
         GL_UNSIGNED_BYTE,   // type
         nullptr             // pointer to data, left empty to be loaded with images
     );
     // load images one by one, each on a different layer (depth)
-    for (unsigned int i = 0; i < images.size(); i++) {
-        SDL_Surface* surface = images[i];
-        if (!surface) continue;
-        if (surface->w > size.x || surface->h > size.y) {
+    for (unsigned int i = 0; i < layers.size(); i++) {
+        const Texture& layer = layers[i];
+        if (!layer.buffer) continue;
+        if (layer.size.x > size.x || layer.size.y > size.y) {
             LogError("createTextureArray : Image passed is too large to fit in texture array! image dimensions: %d,%d;"
-                "texture array dimensions: %d,%d\n", surface->w, surface->h, size.x, size.y);
+                "texture array dimensions: %d,%d\n", layer.size.x, layer.size.y, size.x, size.y);
             continue;
         }
-        SDL_LockSurface(surface);
         glTexSubImage3D(GL_TEXTURE_2D_ARRAY, // target is texture array
             0,
             0, 0, i, // all images start at bottom left of texture array
-            surface->w, surface->h, 1, // image is only 1 thick in depth
+            layer.size.x, layer.size.y, 1, // image is only 1 thick in depth
             GL_RGBA,
             GL_UNSIGNED_BYTE,
-            surface->pixels
+            layer.buffer
         );
-        SDL_UnlockSurface(surface);
     }
 
     return texture;
 }
 
-TextureArray makeTextureArray(glm::ivec2 size, TextureManager* textures, TextureType typesIncluded, const char* assetsPath, TextureUnit textureUnit) {
-    llvm::SmallVector<SDL_Surface*> images;
+// texture pointing to the surface's pixels, not a copy
+static Texture surfaceTexture(SDL_Surface* surface) {
+    return Texture{(unsigned char*)surface->pixels, {surface->w, surface->h}, StandardPixelFormatBytes};
+}
+
+TextureArray makeTextureArray(glm::ivec2 size, TextureManager* textures, TextureType typesIncluded, TextureCache* cache, TextureUnit textureUnit) {
+    llvm::SmallVector<Texture> layers;
     llvm::SmallVector<TextureID> ids;
-    TextureMetaData* metadata = textures->metadata.data;
 
-    for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
-        if ((metadata[id].type & typesIncluded) || true) {
-            if (textures->animations.lookup(id)) continue; // dont include animations
-            auto image = loadTexture(id, textures, assetsPath);
-            if (image) {
-                images.push_back(image);
-                ids.push_back(id);
+    if (const auto* section = cache->find(TextureCache::ArraySection, typesIncluded, size)) {
+        const auto* entries = (const TextureCache::LayerEntry*)cache->entries(section);
+        const unsigned char* pixels = cache->pixels(section);
+        for (Uint32 i = 0; i < section->entryCount; i++) {
+            layers.push_back(Texture{(unsigned char*)pixels + entries[i].pixelsOffset, entries[i].size, StandardPixelFormatBytes});
+            ids.push_back(entries[i].id);
+        }
+    } else {
+        TextureMetaData* metadata = textures->metadata.data;
+        llvm::SmallVector<TextureCache::LayerEntry> entries;
+        Uint64 pixelsOffset = 0;
+        for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
+            if ((metadata[id].type & typesIncluded) || true) {
+                if (textures->animations.lookup(id)) continue; // dont include animations
+                auto image = cache->images[id];
+                if (image) {
+                    layers.push_back(surfaceTexture(image));
+                    ids.push_back(id);
+                    entries.push_back({id, {image->w, image->h}, pixelsOffset});
+                    pixelsOffset += (Uint64)image->w * image->h * StandardPixelFormatBytes;
+                }
             }
         }
+        cache->add(TextureCache::ArraySection, typesIncluded, size, entries.data(), entries.size(), sizeof(TextureCache::LayerEntry), layers);
     }
 
-    TextureArray texArray = TextureArray(size, images.size(), 0, textureUnit);
+    TextureArray texArray = TextureArray(size, layers.size(), 0, textureUnit);
     glActiveTexture(GL_TEXTURE0 + textureUnit);
-    GLuint texture = GlLoadTextureArray(size, images, GL_NEAREST, GL_NEAREST);
+    GLuint texture = GlLoadTextureArray(size, layers, GL_NEAREST, GL_NEAREST);
     texArray.texture = texture;
     
     if (!texArray.texture) {
         LogCritical("Failed to make texture array!");
     }
 
-    // images can be freed after being loaded into texture array
-    for (auto image : images) {
-        SDL_DestroySurface(image);
-    }
-
-    for (int i = 0; i < images.size(); i++) {
+    for (int i = 0; i < layers.size(); i++) {
         texArray.textureDepths.insert(ids[i], i);
     }
 
@@ -244,22 +257,21 @@ int updateTextureArray(TextureArray* textureArray, TextureManager* textures, Tex
     return 0;
 }
 
-GlSizedTexture GlLoadTextureAtlas(ArrayRef<SDL_Surface*> images, GLint minFilter, GLint magFilter, MutableArrayRef<glm::ivec2> texCoordsOut) {
+Texture packTextureAtlas(ArrayRef<SDL_Surface*> images, MutableArrayRef<glm::ivec2> texCoordsOut) {
     auto* textures = Alloc<Texture>(images.size());
     for (int i = 0; i < images.size(); i++) {
-        auto* image = images[i];
-        SDL_LockSurface(image);
-        textures[i] = newTexture({images[i]->w, images[i]->h}, StandardPixelFormatBytes, (unsigned char*)image->pixels);
-        SDL_UnlockSurface(image);
+        textures[i] = surfaceTexture(images[i]);
     }
     assert(texCoordsOut.size() >= images.size());
-    Texture packedTexture = packTextures(images.size(), textures, StandardPixelFormatBytes, texCoordsOut.data());
-
-    for (int i = 0; i < images.size(); i++) {
-        freeTexture(textures[i]);
-    }
+    TexturePackingStats packingStats;
+    Texture packedTexture = packTextures(images.size(), textures, StandardPixelFormatBytes, texCoordsOut.data(), {0, 0}, 128, &packingStats);
+    LogInfo("Packed %d textures into a %dx%d atlas, %.1f%% occupied", packingStats.texturesPacked,
+        packingStats.atlasSize.x, packingStats.atlasSize.y, packingStats.occupancy() * 100.0f);
     Free(textures);
+    return packedTexture;
+}
 
+GLuint GlLoadTextureAtlas(Texture atlas, GLint minFilter, GLint magFilter) {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
@@ -271,25 +283,38 @@ GlSizedTexture GlLoadTextureAtlas(ArrayRef<SDL_Surface*> images, GLint minFilter
     glTexImage2D(GL_TEXTURE_2D,
         0,
         GL_RGBA8,
-        packedTexture.size.x, packedTexture.size.y,
+        atlas.size.x, atlas.size.y,
         0, // no border i think
         GL_RGBA, GL_UNSIGNED_BYTE,
-        packedTexture.buffer
+        atlas.buffer
     );
 
-    freeTexture(packedTexture);
-
-    return {texture, packedTexture.size};
+    return texture;
 }
 
-TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesIncluded, const char* assetsPath, GLint minFilter, GLint magFilter, TextureUnit textureUnit) {
+TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesIncluded, TextureCache* cache, GLint minFilter, GLint magFilter, TextureUnit textureUnit) {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+
+    if (const auto* section = cache->find(TextureCache::AtlasSection, typesIncluded)) {
+        Texture pixels = {(unsigned char*)cache->pixels(section), section->size, StandardPixelFormatBytes};
+        GLuint texture = GlLoadTextureAtlas(pixels, minFilter, magFilter);
+        if (!texture) {
+            LogCritical("Failed to make texture atlas!");
+        }
+        TextureAtlas atlas = TextureAtlas(section->size, texture, textureUnit);
+        const auto* entries = (const TextureCache::AtlasEntry*)cache->entries(section);
+        for (Uint32 i = 0; i < section->entryCount; i++) {
+            atlas.textureSpaces.insert(entries[i].id, entries[i].space);
+        }
+        return atlas;
+    }
+
     llvm::SmallVector<SDL_Surface*> images;
     llvm::SmallVector<TextureID> ids;
-    TextureMetaData* metadata = textures->metadata.data;
 
     for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
         if (textures->metadata[id].type & typesIncluded) {
-            auto image = loadTexture(id, textures, assetsPath);
+            auto image = cache->images[id];
             if (image) {
                 images.push_back(image);
                 ids.push_back(id);
@@ -299,14 +324,15 @@ TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesInclude
 
     auto* textureOrigins = Alloc<glm::ivec2>(images.size());
 
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-    auto textureAndSize = GlLoadTextureAtlas(images, minFilter, magFilter, {textureOrigins, images.size()} /* to be filled in */);
-    if (!textureAndSize.texture) {
-        LogCritical("Failed to make texture array!");
+    Texture packedTexture = packTextureAtlas(images, {textureOrigins, images.size()} /* to be filled in */);
+    GLuint texture = GlLoadTextureAtlas(packedTexture, minFilter, magFilter);
+    if (!texture) {
+        LogCritical("Failed to make texture atlas!");
     }
-    TextureAtlas atlas = TextureAtlas(textureAndSize.size, textureAndSize.texture, textureUnit);
+    TextureAtlas atlas = TextureAtlas(packedTexture.size, texture, textureUnit);
 
     TextureAtlas::Space* textureSpaces = atlas.textureSpaces.insertList(ids);
+    llvm::SmallVector<TextureCache::AtlasEntry> entries;
     for (int i = 0; i < ids.size(); i++) {
         auto origin = TextureAtlas::TexCoord(textureOrigins[i]);
         auto size = TextureAtlas::TexCoord{images[i]->w, images[i]->h};
@@ -314,14 +340,13 @@ TextureAtlas makeTextureAtlas(TextureManager* textures, TextureType typesInclude
             origin,
             origin + size
         };
+        entries.push_back({ids[i], textureSpaces[i]});
     }
 
-    Free(textureOrigins);
+    cache->add(TextureCache::AtlasSection, typesIncluded, packedTexture.size, entries.data(), entries.size(), sizeof(TextureCache::AtlasEntry), {packedTexture});
 
-    // images can be freed after being loaded into texture array
-    for (auto image : images) {
-        SDL_DestroySurface(image);
-    }
+    Free(textureOrigins);
+    freeTexture(packedTexture);
 
     return atlas;
 }
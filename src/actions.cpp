@@ -7,26 +7,27 @@ namespace GUI {
 void selectHotbarSlot(Game* g, Element e) {
     int slot = g->gui->manager.getComponent<EC::Numbered>(e)->number;
     auto* playerInventory = g->state->player.inventory();
-    ItemStack* stack = &playerInventory->items[slot];
+    const ItemStack stack = playerInventory->get(slot);
     if (g->state->player.heldItemStack) {
         // set held stack down in slot only if actually holding stack and if slot is empty
-        if (stack->empty()) {
-            *stack = *g->state->player.heldItemStack.get();
+        if (stack.empty()) {
+            playerInventory->setSlot(slot, *g->state->player.heldItemStack.get());
             *g->state->player.heldItemStack.get() = ItemStack::None();
             g->state->player.heldItemStack = ItemHold();
             g->state->player.selectedHotbarSlot = -1;
-        } else {
-            bool combined = items::combineStacks(stack, g->state->player.heldItemStack.get(), g->state->itemManager);
+        } else if (g->state->player.heldItemStack.get() != playerInventory->items + slot) {
+            ItemStack combinedStack = stack;
+            bool combined = items::combineStacks(&combinedStack, g->state->player.heldItemStack.get(), g->state->itemManager);
             if (combined) {
-                
+                playerInventory->setSlot(slot, combinedStack);
             } else {
                 // stop holding item but dont move anything
             }
         }
     } else {
-        g->state->player.pickupItem(*stack);
+        g->state->player.pickupItem(stack);
         g->state->player.selectHotbarSlot(slot);
-        *stack = ItemStack::None();
+        playerInventory->setSlot(slot, ItemStack::None());
         g->playerControls->justGrabbedItem = true;
     }
 }
@@ -2,6 +2,9 @@
 #include "Game.hpp"
 #include "rendering/textures.hpp"
 #include "utils/FileSystem.hpp"
+#include "world/TransportLines.hpp"
+#include "GUI/ConsoleLog.hpp"
+#include <SDL3/SDL_clipboard.h>
 #include <sstream>
 
 namespace Commands {
@@ -10,100 +13,44 @@ namespace Commands {
     // not very useful tbh
     #define DEF_COMMAND(name, ...) Result name(const char* args, __VA_ARGS__)
     #define DESCRIBE(name, _description) getCommand(TOSTRING(name))->description = _description
+    // the arguments the command takes, see CommandSchema. Commands without them get what was typed, unchecked
+    #define ARGS(name, signature) getCommand(TOSTRING(name))->setArgs(signature)
 
     #define RES_ERROR(message) Result{Result::Error, message}
     #define RES_SUCCESS(message) Result{Result::Success, message}
 
-    class ArgsList {
-        char* buffer;
-        int bufferSize;
-        int charIndex;
-        int argc;
-    public:
-        explicit ArgsList(const char* rawArgs) {
-            charIndex = 0;
-            int objectDepth = 0;
-
-            int argsLen = strlen(rawArgs);
-            if (argsLen > 0) {
-                bufferSize = argsLen + 1;
-                buffer = Alloc<char>(argsLen + 1);
-                memcpy(buffer, rawArgs, argsLen + 1);
-
-                argc = 1;
-                for (int i = 0; i < argsLen; i++) {
-                    char& c = buffer[i];
-                    if (c == '{') {
-                        objectDepth++;
-                    } else if (c == '}') {
-                        objectDepth--;
-                        if (objectDepth < 0) objectDepth = 0;
-                    }
-                    else if (c == ' ' && (argsLen - i) > 1) {
-                        if (objectDepth == 0) {
-                            c = '\0';
-                            argc++;
-                        }
-                    }
-                }
-            } else {
-                bufferSize = 0;
-                buffer = nullptr;
-                argc = 0;
-            }
-        }
-
-        // get the next argument, and forward them so next time you'll get the one after that
-        std::string get() {
-            const char* arg;
-            size_t size = 0;
-            if (charIndex+1 < bufferSize) {
-                 arg = &buffer[charIndex];
-            } else {
-                return {};
-            }
+    using Args = CommandArgs;
 
-            // now, forward for next time
-            // cond: make sure there are atleast two more characters after nul - atleast one regular character and one terminator
-            for (; charIndex < bufferSize; charIndex++) {
-                if (buffer[charIndex] == '\0') {
-                    charIndex++; // right after the nul
-                    break;
-                }
-                size++;
-            }
-            
-            return std::string(arg, size);
-        }
-
-        Result require(int numArgs) {
-            if (argc < numArgs) {
-                return RES_ERROR("Too few arguments provided!");
-            } else if (argc > numArgs) {
-                return RES_ERROR("Too many arguments provided!");
-            }
-            return RES_SUCCESS("");
+    Result require(const Args& args, int numArgs) {
+        if (args.count() < numArgs) {
+            return RES_ERROR("Too few arguments provided!");
+        } else if (args.count() > numArgs) {
+            return RES_ERROR("Too many arguments provided!");
         }
+        return RES_SUCCESS("");
+    }
 
-    };
-
-    using Args = ArgsList;
-
-    #define REQUIRE(num_args) {auto result = args.require(num_args); if (result.type == Result::Error) return result;}
+    #define REQUIRE(num_args) {auto result = require(args, num_args); if (result.type == Result::Error) return result;}
 
     Result setDebugSetting(Args args, Game* game) {
         auto settingName = args.get();
-        auto value = args.get();
-
-        if (value == "1" || value == "true" || value == "y" || value == "True") {
-            game->debug->settings[settingName] = 1;
-        } else {
-            game->debug->settings[settingName] = 0;
+        bool on = args.getBool();
+        if (!game->debug->settings.set(settingName.c_str(), on)) {
+            return RES_ERROR(string_format("No debug setting named %s.", settingName.c_str()));
         }
 
         return RES_SUCCESS("Setting changed.");
     }
 
+    Result debugSettings(Args args, Game* game) {
+        std::string message;
+        for (int i = 0; i < DebugFlags::Count; i++) {
+            const auto& info = DebugFlags::Infos[i];
+            message += string_format("%s = %d - %s\n", info.name, (int)game->debug->settings[(DebugFlag)i], info.description);
+        }
+        return RES_SUCCESS(message);
+    }
+
     Result setMode(Args args, Game* game) {
         auto mode = args.get();
 
@@ -125,21 +72,19 @@ namespace Commands {
             return RES_ERROR("No new texture given!");
         }
 
-        for (TextureID id = TextureIDs::First; id <= TextureIDs::Last; id++) {
-            TextureMetaData metadata = textures->metadata[id];
-            if (My::streq(metadata.identifier, textureName.c_str())) {
-                auto filepath = FileSystem.assets.get(newTextureFilename.c_str());
-                SDL_Surface* surface = IMG_Load(filepath);
-                if (!surface) {
-                    snprintf(message, 512, "Couldn't load texture with path %s!", filepath.str);
-                    return RES_ERROR(std::string(message));
-                }
-                int code = updateTextureArray(textureArray, textures, id, surface);
-                if (code) {
-                    return RES_ERROR("Failed while setting texture!");
-                }
-                return RES_SUCCESS("Updated texture");
+        TextureID id = textures->getID(textureName.c_str());
+        if (id >= TextureIDs::First && id <= TextureIDs::Last) {
+            auto filepath = FileSystem.assets.get(newTextureFilename.c_str());
+            SDL_Surface* surface = IMG_Load(filepath);
+            if (!surface) {
+                snprintf(message, 512, "Couldn't load texture with path %s!", filepath.str);
+                return RES_ERROR(std::string(message));
             }
+            int code = updateTextureArray(textureArray, textures, id, surface);
+            if (code) {
+                return RES_ERROR("Failed while setting texture!");
+            }
+            return RES_SUCCESS("Updated texture");
         }
         
         snprintf(message, 512, "Couldn't find texture with name \"%s\"", textureName.c_str());
@@ -477,7 +422,7 @@ namespace Commands {
         std::string output = "";
         
         for (auto& command : gCommands) {
-            output += command.name;
+            output += command.schema.defined ? command.schema.usage(command.name) : std::string(command.name);
             if (!command.description.empty()) {
                 output += " - description: " + command.description;
             }
@@ -487,18 +432,188 @@ namespace Commands {
         return RES_SUCCESS(output);
     }
 
+    Result timings(Args args, const MetadataTracker* metadata) {
+        std::string message;
+        for (int i = 0; i < Timings::Count; i++) {
+            const auto& timing = *metadata->timing((Timing)i);
+            message += string_format("%s: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms over the last %llu\n",
+                timing.name, timing.percentile(0.5), timing.percentile(0.95), timing.percentile(0.99), timing.max(), (unsigned long long)timing.window.samples);
+        }
+        return RES_SUCCESS(message);
+    }
+
+    Result dumpTimings(Args args, const MetadataTracker* metadata) {
+        auto filename = args.get();
+        My::CString path = filename.empty() ? FileSystem.save.get("timings.bin") : My::CString(filename.c_str());
+        if (!metadata->dumpTimings(path)) {
+            return RES_ERROR(string_format("Failed to write timings to %s.", (const char*)path));
+        }
+        return RES_SUCCESS(string_format("Wrote timings to %s.", (const char*)path));
+    }
+
+    Result memory(Args args, int) {
+        if (!Mem::trackingAllocations()) {
+            return RES_ERROR("Allocations aren't tracked. Build with MEMORY_TRACKING=1 to track them.");
+        }
+        auto stats = Mem::memoryStats();
+        std::string message;
+        auto describe = [&](const char* name, const Mem::MemoryTagStats& tag){
+            message += string_format("%s: %zu bytes in %zu allocations, peak %zu bytes, %zu allocations made\n",
+                name, tag.liveBytes, tag.liveAllocations, tag.peakBytes, tag.allocations);
+        };
+        for (int i = 0; i < Mem::MemoryTags::Count; i++) {
+            describe(Mem::MemoryTags::Names[i], stats.tags[i]);
+        }
+        describe("Total", stats.total);
+        message += string_format("%zu allocations last frame, %.0f allocations and %.0f bytes a second",
+            stats.lastFrameAllocations, stats.allocationsPerSecond, stats.bytesPerSecond);
+        return RES_SUCCESS(message);
+    }
+
     Result clear(Args args, GUI::Console* console) {
         console->log.clear();
         return RES_SUCCESS("");
     }
+
+    Result filterConsole(Args args, GUI::Console* console) {
+        static const char* const priorityNames[] = {"verbose", "debug", "info", "warn", "error", "critical", "crash"};
+        static const char* const typeNames[] = {"default", "command", "result", "error"};
+        auto priorityStr = args.get();
+        auto search = args.get();
+        auto typesStr = args.get();
+
+        auto filter = GUI::ConsoleLog::Filter::All();
+        for (int i = 0; i < (int)(sizeof(priorityNames) / sizeof(priorityNames[0])); i++) {
+            if (priorityStr == priorityNames[i]) filter.minPriority = LogPriority::Verbose + i;
+        }
+        if (search != "*") {
+            if (search.size() > GUI::ConsoleLog::MaxSearchLength) {
+                return RES_ERROR("Search text is too long.");
+            }
+            strcpy(filter.search, search.c_str());
+        }
+        if (!typesStr.empty()) {
+            filter.categories = 0;
+            std::stringstream types(typesStr);
+            std::string type;
+            while (std::getline(types, type, ',')) {
+                bool found = false;
+                for (int i = 0; i < (int)GUI::Console::MessageType::NumTypes; i++) {
+                    if (type == typeNames[i]) {
+                        filter.categories |= 1u << i;
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    return RES_ERROR(string_format("No message type named %s.", type.c_str()));
+                }
+            }
+        }
+
+        console->log.setFilter(filter);
+        return RES_SUCCESS(string_format("Showing %d of %d lines.", console->log.viewSize(), console->log.size()));
+    }
+
+    Result copyConsole(Args args, GUI::Console* console) {
+        int first = args.getInt();
+        int count = args.getInt();
+        const auto& log = console->log;
+
+        std::string text = log.copyLines(first, count);
+        if (!SDL_SetClipboardText(text.c_str())) {
+            return RES_ERROR(string_format("Failed to copy to the clipboard: %s", SDL_GetError()));
+        }
+        int copied = MIN(count, log.viewSize() - first);
+        return RES_SUCCESS(string_format("Copied %d lines.", MAX(copied, 0)));
+    }
+
+    Result spawn(Args args, EntityWorld* ecs) {
+        auto type = args.get();
+        int count = args.getInt();
+        Vec2 center = {(float)args.getFloat(), (float)args.getFloat()};
+        float spread = (float)args.getFloat();
+        Uint32 random = (Uint32)args.getInt();
+
+        // same seed, same positions, so scenarios come out the same every time
+        auto next = [&]() -> float {
+            random = random * 1664525 + 1013904223;
+            return (float)(random >> 8) / (float)(1 << 24) * 2.0f - 1.0f;
+        };
+        for (int i = 0; i < count; i++) {
+            Vec2 position = center + Vec2{next(), next()} * spread;
+            if (type == "tree") {
+                World::Entities::Tree(ecs, position, {1.0f, 1.0f});
+            } else {
+                World::Entities::Grenade(ecs, position);
+            }
+        }
+        return RES_SUCCESS(string_format("Spawned %d %ss.", count, type.c_str()));
+    }
+
+    Result placeBelts(Args args, EntityWorld* ecs) {
+        int x = args.getInt();
+        int y = args.getInt();
+        int length = args.getInt();
+        auto dir = args.get();
+
+        float degrees = 0.0f;
+        if (dir == "left") degrees = 90.0f;
+        else if (dir == "down") degrees = 180.0f;
+        else if (dir == "right") degrees = 270.0f;
+        IVec2 facing = World::beltFacing(degrees);
+
+        for (int i = 0; i < length; i++) {
+            Vec2 position = {x + facing.x * i + 0.5f, y + facing.y * i + 0.5f};
+            Entity belt = World::Entities::TransportBelt(ecs, position);
+            // the belt gets added to its line when the add events are flushed, so this is in time
+            ecs->Get<World::EC::Rotation>(belt)->degrees = degrees;
+            ecs->Get<World::EC::Transporter>(belt)->facing = facing;
+        }
+        return RES_SUCCESS(string_format("Placed %d belts going %s.", length, dir.c_str()));
+    }
+
+    Result runScript(Args args, Game* game) {
+        auto filename = args.get();
+        size_t size = 0;
+        char* text = (char*)SDL_LoadFile(filename.c_str(), &size);
+        My::CString path = FileSystem.save.get(filename.c_str());
+        if (!text) {
+            text = (char*)SDL_LoadFile(path, &size);
+        }
+        if (!text) {
+            return RES_ERROR(string_format("Couldn't load script %s: %s", filename.c_str(), SDL_GetError()));
+        }
+
+        CommandScript script;
+        std::string error;
+        bool parsed = CommandScript::parse(text, &script, &error);
+        SDL_free(text);
+        if (!parsed || !script.check(gCommands, gCommandTable, &error)) {
+            return RES_ERROR(string_format("%s: %s", filename.c_str(), error.c_str()));
+        }
+
+        int steps = (int)script.steps.size();
+        Sint64 ticks = steps > 0 ? script.steps.back().tick : 0;
+        game->script.start(std::move(script), Metadata->getTick());
+        return RES_SUCCESS(string_format("Running %d commands over %lld ticks.", steps, (long long)ticks));
+    }
+
+    Result stopScript(Args args, Game* game) {
+        if (!game->script.running) {
+            return RES_ERROR("No script is running.");
+        }
+        game->script.stop();
+        return RES_SUCCESS(string_format("Stopped the script after %d of %d commands.", game->script.nextStep, (int)game->script.script.steps.size()));
+    }
 }
  
 std::vector<Command> gCommands;
+CommandTable gCommandTable;
 
 void setCommands(Game* game) {
     using namespace Commands;
 
-    #define REG_COMMAND(name, ...) gCommands.push_back(Command::make(TOSTRING(name), [=](const char* args)->Result{ return name(ArgsList(args), __VA_ARGS__); }))
+    #define REG_COMMAND(name, ...) gCommands.push_back(Command::make(TOSTRING(name), [=](CommandArgs args)->Result{ return name(args, __VA_ARGS__); }))
 
     auto* ren = game->renderContext;
     auto* state = game->state;
@@ -522,8 +637,46 @@ void setCommands(Game* game) {
     REG_COMMAND(getTick, 0);
     REG_COMMAND(commands, 0);
     REG_COMMAND(clear, &game->gui->console);
+    REG_COMMAND(filterConsole, &game->gui->console);
+    DESCRIBE(filterConsole, "Only show console lines of at least a priority, containing some text and of some message types. No arguments shows everything.\nArgument 1: Lowest priority, or * for any\n Argument 2: Text to search for, or * for any\n Argument 3: Message types separated by commas (default, command, result, error)");
+    REG_COMMAND(copyConsole, &game->gui->console);
+    DESCRIBE(copyConsole, "Copy the console lines being shown to the clipboard, oldest first.\nArgument 1: First line\n Argument 2: Line count, every line by default");
     REG_COMMAND(setDebugSetting, game);
+    DESCRIBE(setDebugSetting, "Turn a debug setting on or off.\nArgument 1: Setting name\n Argument 2: 1 or 0");
+    REG_COMMAND(debugSettings, game);
+    DESCRIBE(debugSettings, "List every debug setting with its value.");
     REG_COMMAND(setUniform, ren->shaders);
+    REG_COMMAND(timings, &game->metadata);
+    DESCRIBE(timings, "Show the 50th, 95th and 99th percentile and longest time of frames, ticks and systems over the last few seconds.");
+    REG_COMMAND(dumpTimings, &game->metadata);
+    DESCRIBE(dumpTimings, "Write every frame, tick and system time since the start to a file, for comparing builds.\nArgument 1: File name, save/timings.bin if not given");
+    REG_COMMAND(memory, 0);
+    DESCRIBE(memory, "Show live and peak memory for each subsystem, and how often memory is allocated. Needs a build with MEMORY_TRACKING=1.");
+    REG_COMMAND(spawn, ecs);
+    DESCRIBE(spawn, "Spawn entities scattered around a point, in the same places for the same seed.\nArgument 1: tree or grenade\n Argument 2: Count\n Argument 3: X\n Argument 4: Y\n Argument 5: Greatest distance from the point on each axis\n Argument 6: Seed");
+    REG_COMMAND(placeBelts, ecs);
+    DESCRIBE(placeBelts, "Place a straight line of belts.\nArgument 1: X of the first belt\n Argument 2: Y of the first belt\n Argument 3: Length\n Argument 4: up, down, left or right");
+    REG_COMMAND(runScript, game);
+    DESCRIBE(runScript, "Run a file of commands on a schedule of ticks, starting now. @N runs a command N ticks after the start, +N N ticks after the one before it, and # starts a comment.\nArgument 1: Script file, in the save folder if it isn't found as given");
+    REG_COMMAND(stopScript, game);
+    DESCRIBE(stopScript, "Stop the script that's running.");
+
+    ARGS(setDebugSetting, "name:string on:bool");
+    ARGS(debugSettings, "");
+    ARGS(getTick, "");
+    ARGS(commands, "");
+    ARGS(clear, "");
+    ARGS(timings, "");
+    ARGS(memory, "");
+    ARGS(stopScript, "");
+    ARGS(spawn, "type:{tree,grenade} count:int[1,1000000] x:float=0 y:float=0 spread:float[0,]=20 seed:int=1");
+    ARGS(placeBelts, "x:int y:int length:int[1,100000] dir:{up,down,left,right}=right");
+    ARGS(runScript, "file:string");
+    ARGS(filterConsole, "priority:{*,verbose,debug,info,warn,error,critical,crash}=* search:string=* types:string=");
+    ARGS(copyConsole, string_format("first:int[0,]=0 count:int[0,]=%d", GUI::Console::LogLineCapacity).c_str());
+
+    // every command is in by now
+    gCommandTable = CommandTable::build(gCommands);
 }
 
 CommandInput processMessage(std::string message, ArrayRef<Command> possibleCommands) {
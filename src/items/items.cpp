@@ -1,8 +1,71 @@
 #include "items/items.hpp"
 #include "items/prototypes/prototypes.hpp"
+#include <array>
+#include <type_traits>
 
 using namespace items;
 
+ItemStack* InventoryAllocator::allocate(SizeT size) {
+    if (size <= 0) return nullptr;
+    int sizeClass = InventoryAllocator::sizeClass(size);
+    if (sizeClass >= NumSizeClasses) {
+        return Alloc<ItemStack>(size);
+    }
+
+    if (!freeLists[sizeClass]) {
+        // carve a new slab into blocks of this class
+        size_t blockSize = sizeof(ItemStack) << (sizeClass + MinClassShift);
+        size_t headerSize = (sizeof(SlabHeader) + alignof(ItemStack) - 1) & ~(alignof(ItemStack) - 1);
+        size_t blockCount = MAX((SlabSize - headerSize) / blockSize, (size_t)1);
+        size_t slabSize = headerSize + blockCount * blockSize;
+
+        auto* slab = (SlabHeader*)Alloc(slabSize);
+        slab->next = slabs;
+        slab->size = slabSize;
+        slabs = slab;
+        slabCount++;
+
+        char* blocks = (char*)slab + headerSize;
+        for (size_t i = blockCount; i-- > 0;) {
+            auto* block = (FreeBlock*)(blocks + i * blockSize);
+            block->next = freeLists[sizeClass];
+            freeLists[sizeClass] = block;
+        }
+    }
+
+    FreeBlock* block = freeLists[sizeClass];
+    freeLists[sizeClass] = block->next;
+    blocksInUse++;
+    return (ItemStack*)block;
+}
+
+void InventoryAllocator::deallocate(ItemStack* stacks, SizeT size) {
+    if (!stacks) return;
+    int sizeClass = InventoryAllocator::sizeClass(size);
+    if (sizeClass >= NumSizeClasses) {
+        Free(stacks);
+        return;
+    }
+
+    auto* block = (FreeBlock*)stacks;
+    block->next = freeLists[sizeClass];
+    freeLists[sizeClass] = block;
+    blocksInUse--;
+}
+
+void InventoryAllocator::destroy() {
+    while (slabs) {
+        SlabHeader* next = slabs->next;
+        Free(slabs);
+        slabs = next;
+    }
+    for (auto& freeList : freeLists) {
+        freeList = nullptr;
+    }
+    blocksInUse = 0;
+    slabCount = 0;
+}
+
 ItemQuantity ItemStack::reduceQuantity(ItemQuantity reduction) {
     ItemQuantity oldQuantity = this->quantity;
     quantity = oldQuantity - reduction;
@@ -17,106 +80,234 @@ remove_whole_stack:
     }
 }
 
+InventoryIndex* InventoryIndex::make(const ItemStack* items, int size) {
+    auto* index = Alloc<InventoryIndex>();
+    index->words = (size + 63) / 64;
+    index->types = My::Vec<TypeSlots>::Empty();
+    index->typeIndices = My::HashMap<ItemType, int>::WithBuckets(8);
+    index->typeMasks = My::Vec<Uint64>::Empty();
+    index->emptyMask = My::Vec<Uint64>::WithCapacity(index->words);
+    index->emptyMask.resize(index->words, 0);
+    for (int i = 0; i < size; i++) {
+        index->update(i, ItemStack::None(), items[i]);
+    }
+    return index;
+}
+
+void InventoryIndex::destroy() {
+    types.destroy();
+    typeIndices.destroy();
+    typeMasks.destroy();
+    emptyMask.destroy();
+}
+
+int InventoryIndex::typeIndex(ItemType type) {
+    if (int* i = typeIndices.lookup(type)) return *i;
+    int i = types.size;
+    types.push({type, 0, 0});
+    typeMasks.resize(typeMasks.size + words, 0);
+    typeIndices.insert(type, i);
+    return i;
+}
+
+void InventoryIndex::update(int slot, const ItemStack& before, const ItemStack& after) {
+    const Uint64 bit = 1ULL << (slot % 64);
+    const int word = slot / 64;
+    if (!before.empty()) {
+        int i = typeIndex(before.item.type);
+        typeMasks[i * words + word] &= ~bit;
+        if (before.quantity == ItemQuantityInfinity) types[i].infiniteStacks--;
+        else types[i].count -= before.quantity;
+    }
+    if (!after.empty()) {
+        int i = typeIndex(after.item.type);
+        typeMasks[i * words + word] |= bit;
+        if (after.quantity == ItemQuantityInfinity) types[i].infiniteStacks++;
+        else types[i].count += after.quantity;
+        emptyMask[word] &= ~bit;
+    } else {
+        emptyMask[word] |= bit;
+    }
+}
+
+void Inventory::enableIndex() {
+    if (index || size <= 0) return;
+    index = InventoryIndex::make(items, size);
+}
+
+// go through the slots in either mask in order, until func returns true
+template<class F>
+static void forEachSlot(const Uint64* mask, const Uint64* otherMask, int words, const F& func) {
+    for (int w = 0; w < words; w++) {
+        Uint64 bits = (mask ? mask[w] : 0) | (otherMask ? otherMask[w] : 0);
+        while (bits) {
+            if (func(w * 64 + __builtin_ctzll(bits))) return;
+            bits &= bits - 1;
+        }
+    }
+}
+
 ItemStack Inventory::takeFirstItemStack() {
-    for (Uint32 i = 0; i < size; i++) {
-        auto* stack = &get(i);
-        if (!stack->empty()) {
-            auto ret = *stack;
-            *stack = ItemStack::None();
-            return ret;
+    int first = -1;
+    if (index) {
+        for (int w = 0; w < index->words && first == -1; w++) {
+            Uint64 full = ~index->emptyMask[w];
+            // bits past the last slot aren't slots
+            if (w == index->words - 1 && size % 64) full &= (1ULL << (size % 64)) - 1;
+            if (full) first = w * 64 + __builtin_ctzll(full);
+        }
+    } else {
+        for (int i = 0; i < size; i++) {
+            if (!get(i).empty()) {
+                first = i;
+                break;
+            }
         }
     }
-    return ItemStack::None();
+    if (first == -1) return ItemStack::None();
+
+    auto ret = get(first);
+    setSlot(first, ItemStack::None());
+    changed(false);
+    return ret;
 }
 
 ItemQuantity Inventory::addItemStack(ItemStack stack) {
-    ItemQuantity itemsLeft = stack.quantity;
-    const ItemQuantity stackSize = getStackSize(stack.item, *manager);
-    // find first unused slot or first slot of same type and add it to that slot
-    for (Uint32 i = 0; i < size && itemsLeft > 0; i++) {
-        auto& inventoryStack = get(i);
-        if (stack.quantity == ItemQuantityInfinity) {
-            if (!inventoryStack.item.type) {
-                inventoryStack = stack;
-                return ItemQuantityInfinity;
+    if (stack.empty()) return 0;
+
+    if (stack.quantity == ItemQuantityInfinity) {
+        // infinite stacks don't stack with anything, they just take the first empty slot
+        int slot = -1;
+        if (index) {
+            forEachSlot(index->emptyMask.data, nullptr, index->words, [&](int i){
+                slot = i;
+                return true;
+            });
+        } else {
+            for (int i = 0; i < size; i++) {
+                if (get(i).empty()) {
+                    slot = i;
+                    break;
+                }
             }
         }
-        // else need to use another slot
-        else if (inventoryStack.empty()) {
-            // add as many items as can fit based on the item's stack size and how many are in the stack
-            // if it weren't for the possibility of a stack of items having a quantity higher
-            // than the stack's stacksize it would work to just copy the stack straight into the inventory slot
-
+        if (slot == -1) return 0;
+        setSlot(slot, stack);
+        manager->retain(stack.item);
+        changed(true);
+        return ItemQuantityInfinity;
+    }
 
-            ItemQuantity itemsToAdd = (stackSize < itemsLeft) ? 
-                                stackSize : itemsLeft;
-            inventoryStack.quantity = itemsToAdd;
-            inventoryStack.item = stack.item;
+    ItemQuantity itemsLeft = stack.quantity;
+    bool modified = false;
+    const ItemQuantity stackSize = getStackSize(stack.item, *manager);
+    // put items in the first slot that's empty or has the same item, until they're all in
+    auto addToSlot = [&](int i){
+        const ItemStack& inventoryStack = get(i);
+        if (inventoryStack.empty()) {
+            // add as many items as can fit based on the item's stack size and how many are in the stack
+            ItemQuantity itemsToAdd = MIN(stackSize, itemsLeft);
+            if (itemsToAdd <= 0) return false;
+            setSlot(i, ItemStack(stack.item, itemsToAdd));
+            // each slot holds a reference to its item
+            manager->retain(stack.item);
             itemsLeft -= itemsToAdd;
+            modified = true;
         }
         else if (isSame(inventoryStack.item, stack.item)) {
             if (inventoryStack.quantity == ItemQuantityInfinity) {
-                return stack.quantity;
+                // there's always room in an infinite stack
+                itemsLeft = 0;
+                return true;
             }
 
-            int room = getStackSize(inventoryStack.item, *manager) - inventoryStack.quantity;
+            ItemQuantity room = stackSize - inventoryStack.quantity;
             // if the slot is entirely full this will be <= 0
-            // get the minimum of how much items the slot can fit and how many items are in the stack that needs to be added
             if (room > 0) {
-                Uint32 itemsToAdd = (itemsLeft < (Uint32)room) ? itemsLeft : (Uint32)room;
-                // move as many items as can fit from the stack to the inventory
-                inventoryStack.quantity += itemsToAdd;
+                ItemQuantity itemsToAdd = MIN(itemsLeft, room);
+                setSlot(i, ItemStack(inventoryStack.item, inventoryStack.quantity + itemsToAdd));
                 itemsLeft -= itemsToAdd;
+                modified = true;
             }
             // no room left in this slot, continue on
         }
+        return itemsLeft == 0;
+    };
+
+    if (index) {
+        // only the empty slots and slots with the same type could take any
+        forEachSlot(index->slotsOf(stack.item.type), index->emptyMask.data, index->words, addToSlot);
+    } else {
+        for (int i = 0; i < size; i++) {
+            if (addToSlot(i)) break;
+        }
+    }
+
+    if (modified) {
+        changed(true);
     }
-    // couldnt fit atleast some of the stack in the inventory
     return stack.quantity - itemsLeft;
 }
 
 ItemQuantity Inventory::removeItemType(ItemType type, ItemQuantity quantity) {
+    if (quantity == 0) return 0;
+
     ItemQuantity itemsLeft = quantity;
-    // go through slots of the same type as the stack and
-    // remove as many items as possible from that slot
-    if (quantity < 1) {
+    bool modified = false;
+    // go through slots of the type and remove as many items as possible from each
+    auto removeFromSlot = [&](int i){
+        const ItemStack slot = get(i);
+        if (slot.item.type != type || slot.empty()) return false;
+
         if (quantity == ItemQuantityInfinity) {
             // remove all items of the type
-            for (Uint32 i = 0; i < size; i++) {
-                auto& slot = get(i);
-                if (slot.item.type == type) {
-                    destroyItem(&slot.item, *manager);
-                }
-            }
+            freeItem(slot.item, *manager);
+            setSlot(i, ItemStack::None());
+            modified = true;
+            return false;
         }
-        return quantity;
-    }
-    // search through each inventory slot and 
-    for (Uint32 i = 0; i < size; i++) {
-        auto& slot = get(i);
-        if (slot.item.type == type) {
-            if (slot.quantity == ItemQuantityInfinity) return quantity;
-            // get the minimum of the two quanities, to not remove more than the stack said to,
-            // and not to remove more than are in the slot
-            Uint32 itemsToRemove = MIN(itemsLeft, slot.quantity);
-
-            if (slot.quantity > itemsLeft) {
-                slot.quantity -= itemsLeft;
-                return quantity;
-            } else if (slot.quantity <= itemsLeft) {
-                itemsLeft -= slot.quantity;
-                freeItem(slot.item, *manager);
-                slot = Item::None();
-                if (itemsLeft == 0) return quantity;
-            }
+        if (slot.quantity == ItemQuantityInfinity) {
+            // taking from an infinite stack never runs out
+            itemsLeft = 0;
+            return true;
         }
+
+        if (slot.quantity > itemsLeft) {
+            setSlot(i, ItemStack(slot.item, slot.quantity - itemsLeft));
+            itemsLeft = 0;
+        } else {
+            itemsLeft -= slot.quantity;
+            freeItem(slot.item, *manager);
+            setSlot(i, ItemStack::None());
+        }
+        modified = true;
+        return itemsLeft == 0;
+    };
+
+    if (index) {
+        forEachSlot(index->slotsOf(type), nullptr, index->words, removeFromSlot);
+    } else {
+        for (int i = 0; i < size; i++) {
+            if (removeFromSlot(i)) break;
+        }
+    }
+
+    if (modified) {
+        changed(false);
     }
+    if (quantity == ItemQuantityInfinity) return ItemQuantityInfinity;
     return quantity - itemsLeft;
 }
 
 ItemQuantity Inventory::itemCount(ItemType type) {
+    if (index) {
+        const auto* slots = index->find(type);
+        if (!slots) return 0;
+        return slots->infiniteStacks > 0 ? ItemQuantityInfinity : slots->count;
+    }
+
     ItemQuantity count = 0;
-    for (Uint32 i = 0; i < size; i++) {
+    for (int i = 0; i < size; i++) {
         auto& inventoryStack = get(i);
         if (inventoryStack.item.type == type) {
             if (inventoryStack.infinite()) return ItemQuantityInfinity;
@@ -129,4 +320,177 @@ ItemQuantity Inventory::itemCount(ItemType type) {
 void items::destroyItem(Item* item, ItemManager& manager) {
     freeItem(*item, manager);
     *item = Item::None();
-}
\ No newline at end of file
+}
+
+static Uint64 hashBytes(Uint64 hash, const void* data, size_t size) {
+    // fnv-1a
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+namespace items::ITC {
+    template<class... Components>
+    constexpr bool bytesComparable() {
+        return ((std::is_empty_v<Components> || std::has_unique_object_representations_v<Components>) && ...);
+    }
+
+    template<class... Components>
+    constexpr std::array<bool, sizeof...(Components)> emptyComponents() {
+        return {std::is_empty_v<Components>...};
+    }
+
+    /* Interning hashes and compares components byte by byte, which only works if equal components have equal bytes.
+     * Padding is garbage, so components with padding (or floats, since 0 == -0) would make equal items look different.
+     * Flag components have nothing in them but still take a byte, so they get skipped
+     */
+    static_assert(bytesComparable<ITEM_REGULAR_COMPONENTS_LIST>(), "Item components can't have padding or floats");
+    static constexpr auto EmptyComponents = emptyComponents<ITEM_COMPONENTS_LIST>();
+}
+
+static Uint64 hashItemContents(const ItemManager& manager, Item item) {
+    Uint64 hash = 14695981039346656037ULL;
+    hash = hashBytes(hash, &item.type, sizeof(item.type));
+    const auto& componentInfo = manager.components.componentInfo;
+    ComponentSignature signature = manager.components.getEntitySignature(item);
+    for (int id = 0; id < componentInfo.numComponents(); id++) {
+        if (!signature[id] || ITC::EmptyComponents[id]) continue;
+        hash = hashBytes(hash, &id, sizeof(id));
+        hash = hashBytes(hash, manager.getComponent(item, (ComponentID)id), componentInfo.size(id));
+    }
+    return hash;
+}
+
+static bool sameContents(const ItemManager& manager, Item lhs, Item rhs) {
+    if (lhs.type != rhs.type) return false;
+    ComponentSignature signature = manager.components.getEntitySignature(lhs);
+    if (signature != manager.components.getEntitySignature(rhs)) return false;
+
+    const auto& componentInfo = manager.components.componentInfo;
+    for (int id = 0; id < componentInfo.numComponents(); id++) {
+        if (!signature[id] || ITC::EmptyComponents[id]) continue;
+        if (memcmp(manager.getComponent(lhs, (ComponentID)id), manager.getComponent(rhs, (ComponentID)id), componentInfo.size(id)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ItemReferences* ItemManager::getReferences(Item item) {
+    if (item.type == ItemTypes::None || item.id >= (Uint32)references.size || !entityExists(item)) {
+        return nullptr;
+    }
+    return &references[item.id];
+}
+
+Item ItemManager::newItem(ItemType type) {
+    Entity entity = this->newEntity(type);
+    if (entity.id >= (Uint32)references.size) {
+        references.resize(entity.id + 1, ItemReferences{0, 0, false, Item::None()});
+    }
+    references[entity.id] = {0, 1, false, Item::None()};
+    return Item(type, entity);
+}
+
+Item ItemManager::intern(Item item) {
+    ItemReferences* refs = getReferences(item);
+    if (!refs || refs->interned) return item;
+
+    Uint64 hash = hashItemContents(*this, item);
+    Item* head = canonicalItems.lookup(hash);
+    // different items can hash the same, so look through every one with the hash
+    for (Item existing = head ? *head : Item::None(); existing.type != ItemTypes::None; existing = references[existing.id].nextSameHash) {
+        if (sameContents(*this, existing, item)) {
+            // the new item was only just made, so its references go to the canonical one instead
+            references[existing.id].refCount += refs->refCount;
+            *refs = {0, 0, false, Item::None()};
+            deleteEntity(item);
+            return existing;
+        }
+    }
+
+    refs->contentHash = hash;
+    refs->interned = true;
+    if (head) {
+        refs->nextSameHash = *head;
+        *head = item;
+    } else {
+        refs->nextSameHash = Item::None();
+        canonicalItems.insert(hash, item);
+    }
+    return item;
+}
+
+void ItemManager::removeCanonical(Item item) {
+    ItemReferences& refs = references[item.id];
+    Item* head = canonicalItems.lookup(refs.contentHash);
+    if (isSame(*head, item)) {
+        if (refs.nextSameHash.type != ItemTypes::None) {
+            *head = refs.nextSameHash;
+        } else {
+            canonicalItems.remove(refs.contentHash);
+        }
+    } else {
+        Item previous = *head;
+        while (!isSame(references[previous.id].nextSameHash, item)) {
+            previous = references[previous.id].nextSameHash;
+        }
+        references[previous.id].nextSameHash = refs.nextSameHash;
+    }
+    refs.interned = false;
+    refs.nextSameHash = Item::None();
+}
+
+void ItemManager::retain(Item item) {
+    if (ItemReferences* refs = getReferences(item)) {
+        refs->refCount++;
+    }
+}
+
+void ItemManager::release(Item item) {
+    ItemReferences* refs = getReferences(item);
+    if (!refs || --refs->refCount > 0) return;
+
+    if (refs->interned) {
+        removeCanonical(item);
+    }
+    *refs = {0, 0, false, Item::None()};
+    deleteEntity(item);
+}
+
+Item ItemManager::unshare(Item item) {
+    ItemReferences* refs = getReferences(item);
+    if (!refs) return item;
+
+    if (refs->refCount == 1) {
+        // nothing else has it, so it can be changed in place once it's out of the canonical items
+        if (refs->interned) {
+            removeCanonical(item);
+        }
+        return item;
+    }
+
+    Item copy = newItem(item.type);
+    ComponentSignature signature = components.getEntitySignature(item);
+    // the copy goes in the same pool as the item, so add every component first.
+    // Adding them one at a time could grow the pool out from under the item's components being copied
+    addSignature(copy, signature);
+    for (int id = 0; id < components.componentInfo.numComponents(); id++) {
+        if (signature[id]) {
+            memcpy(getComponent(copy, (ComponentID)id), getComponent(item, (ComponentID)id), components.componentInfo.size(id));
+        }
+    }
+    // newItem can move the references
+    references[item.id].refCount--;
+    return copy;
+}
+
+Sint32 ItemManager::refCount(Item item) const {
+    if (item.type == ItemTypes::None || item.id >= (Uint32)references.size || !entityExists(item)) {
+        return 0;
+    }
+    return references[item.id].refCount;
+}
@@ -14,7 +14,7 @@
 #include "global.hpp"
 
 #include "memory.hpp"
-#include "physics/physics.hpp"
+#include "utils/StringInterner.hpp"
 
 #ifdef DEBUG
     //#include "Testing.hpp"
@@ -22,8 +22,8 @@
 
 void initLogging() {
     SDL_SetLogOutputFunction(Logger::logOutputFunction, &gLogger);
-    SDL_SetLogPriorities(SDL_LOG_PRIORITY_ERROR);
-    SDL_SetLogPriority(LogCategory::Main, SDL_LOG_PRIORITY_INFO);
+    gLogger.setPriorities(LogPriority::Error);
+    gLogger.setPriority(LogCategory::Main, LogPriority::Info);
 }
 
 #define LOG LogInfo
@@ -53,7 +53,7 @@ void initPaths() {
 }
 
 void tests() {
-    physics_test();
+    
 }
 
 int main(int argc, char** argv) { 
@@ -110,6 +110,8 @@ int main(int argc, char** argv) {
     // runs after the game loop has ended
     game->quit();
     game->destroy();
+    freeInternedStrings();
+    Mem::quit();
 
     gLogger.destroy();
     FileSystem.destroy();
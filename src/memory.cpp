@@ -3,6 +3,14 @@
 #include <execinfo.h>
 #include <signal.h>
 #include <unistd.h>
+#if MEMORY_TRACKING
+#include <string.h>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#endif
 
 namespace Mem {
 
@@ -17,15 +25,267 @@ std::function<void()> memoryFailCallback;
 /* wrappers */
 
 void* _malloc(size_t size) {
-    return malloc(size);
+    void* ptr = malloc(size);
+#if MEMORY_TRACKING
+    if (ptr) trackAlloc(ptr, size);
+#endif
+    return ptr;
 }
 
 void _free(void* mem) {
+#if MEMORY_TRACKING
+    if (mem) trackFree(mem);
+#endif
     free(mem);
 }
 
 void* _realloc(void* ptr, size_t size) {
-    return realloc(ptr, size);
+    void* newPtr = realloc(ptr, size);
+#if MEMORY_TRACKING
+    // realloc of 0 bytes can free the memory and return null
+    if (newPtr || size == 0) {
+        if (ptr) trackFree(ptr);
+        if (newPtr) trackAlloc(newPtr, size);
+    }
+#endif
+    return newPtr;
+}
+
+/* tracking */
+
+#if MEMORY_TRACKING
+
+namespace {
+
+constexpr int SiteFrames = 8; // return addresses kept for each allocation, enough to get past the wrappers
+constexpr int SkippedFrames = 2; // frames in the tracking itself
+
+struct AllocationSite {
+    void* frames[SiteFrames];
+    int frameCount;
+    const char* file; // when the site was given instead of found from the stack
+    int line;
+};
+
+struct Allocation {
+    size_t size;
+    MemoryTag tag;
+    AllocationSite site;
+};
+
+struct AllocationTracker {
+    std::mutex mutex;
+    std::unordered_map<void*, Allocation> live;
+    MemoryTagStats tags[MemoryTags::Count] = {};
+    MemoryTagStats total = {};
+
+    size_t frameStartAllocations = 0;
+    size_t lastFrameAllocations = 0;
+
+    std::chrono::steady_clock::time_point rateStart = std::chrono::steady_clock::now();
+    size_t rateStartAllocations = 0;
+    size_t rateStartBytes = 0;
+    double allocationsPerSecond = 0.0;
+    double bytesPerSecond = 0.0;
+};
+
+// never destroyed, so memory freed by static destructors and atexit handlers can still be tracked
+AllocationTracker& tracker() {
+    static AllocationTracker* tracker = new AllocationTracker();
+    return *tracker;
+}
+
+thread_local MemoryTag tagOnThread = MemoryTags::General;
+
+void addToStats(MemoryTagStats& stats, size_t size) {
+    stats.liveBytes += size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.liveBytes);
+    stats.liveAllocations++;
+    stats.allocations++;
+    stats.allocatedBytes += size;
+}
+
+void removeFromStats(MemoryTagStats& stats, size_t size) {
+    stats.liveBytes -= size;
+    stats.liveAllocations--;
+}
+
+}
+
+void trackAlloc(void* ptr, size_t size, const char* file, int line) {
+    Allocation allocation;
+    allocation.size = size;
+    allocation.tag = tagOnThread;
+    allocation.site.file = file;
+    allocation.site.line = line;
+    allocation.site.frameCount = 0;
+    if (!file) {
+        void* frames[SiteFrames + SkippedFrames];
+        int count = backtrace(frames, SiteFrames + SkippedFrames);
+        allocation.site.frameCount = std::max(count - SkippedFrames, 0);
+        memcpy(allocation.site.frames, frames + SkippedFrames, allocation.site.frameCount * sizeof(void*));
+    }
+
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    auto [it, inserted] = t.live.insert({ptr, allocation});
+    if (!inserted) {
+        // freed somewhere we don't see, like by plain free
+        removeFromStats(t.tags[it->second.tag], it->second.size);
+        removeFromStats(t.total, it->second.size);
+        it->second = allocation;
+    }
+    addToStats(t.tags[allocation.tag], size);
+    addToStats(t.total, size);
+}
+
+void trackFree(void* ptr) {
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    auto it = t.live.find(ptr);
+    // memory from before tracking started or from plain malloc
+    if (it == t.live.end()) return;
+    removeFromStats(t.tags[it->second.tag], it->second.size);
+    removeFromStats(t.total, it->second.size);
+    t.live.erase(it);
+}
+
+void trackSite(void* ptr, const char* file, int line) {
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    auto it = t.live.find(ptr);
+    if (it == t.live.end()) return;
+    it->second.site.file = file;
+    it->second.site.line = line;
+    it->second.site.frameCount = 0;
+}
+
+MemoryTag currentMemoryTag() {
+    return tagOnThread;
+}
+
+MemoryTag setMemoryTag(MemoryTag tag) {
+    MemoryTag previous = tagOnThread;
+    tagOnThread = tag;
+    return previous;
+}
+
+#endif
+
+bool trackingAllocations() {
+    return MEMORY_TRACKING;
+}
+
+MemoryStats memoryStats() {
+    MemoryStats stats = {};
+#if MEMORY_TRACKING
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    for (int i = 0; i < MemoryTags::Count; i++) {
+        stats.tags[i] = t.tags[i];
+    }
+    stats.total = t.total;
+    stats.lastFrameAllocations = t.lastFrameAllocations;
+    stats.allocationsPerSecond = t.allocationsPerSecond;
+    stats.bytesPerSecond = t.bytesPerSecond;
+#endif
+    return stats;
+}
+
+size_t allocationCount() {
+#if MEMORY_TRACKING
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    return t.total.allocations;
+#else
+    return 0;
+#endif
+}
+
+void newFrame() {
+#if MEMORY_TRACKING
+    auto& t = tracker();
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.lastFrameAllocations = t.total.allocations - t.frameStartAllocations;
+    t.frameStartAllocations = t.total.allocations;
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - t.rateStart).count();
+    if (seconds >= 1.0) {
+        t.allocationsPerSecond = (t.total.allocations - t.rateStartAllocations) / seconds;
+        t.bytesPerSecond = (t.total.allocatedBytes - t.rateStartBytes) / seconds;
+        t.rateStart = now;
+        t.rateStartAllocations = t.total.allocations;
+        t.rateStartBytes = t.total.allocatedBytes;
+    }
+#endif
+}
+
+void leakReport(FILE* out, int maxSites) {
+#if MEMORY_TRACKING
+    struct SiteTotal {
+        AllocationSite site;
+        MemoryTag tag;
+        size_t bytes;
+        size_t allocations;
+    };
+    auto sameSite = [](const AllocationSite& a, const AllocationSite& b){
+        if (a.file || b.file) return a.file == b.file && a.line == b.line;
+        return a.frameCount == b.frameCount && memcmp(a.frames, b.frames, a.frameCount * sizeof(void*)) == 0;
+    };
+
+    std::vector<SiteTotal> sites;
+    size_t totalBytes = 0;
+    size_t totalAllocations = 0;
+    {
+        auto& t = tracker();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        // hash the sites by their first frame so grouping doesn't need to compare against every site
+        std::unordered_multimap<const void*, size_t> sitesByKey;
+        for (auto& [ptr, allocation] : t.live) {
+            const void* key = allocation.site.file ? (const void*)allocation.site.file : allocation.site.frameCount ? allocation.site.frames[0] : nullptr;
+            SiteTotal* found = nullptr;
+            auto range = sitesByKey.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                SiteTotal& site = sites[it->second];
+                if (site.tag == allocation.tag && sameSite(site.site, allocation.site)) {
+                    found = &site;
+                    break;
+                }
+            }
+            if (!found) {
+                sitesByKey.insert({key, sites.size()});
+                sites.push_back({allocation.site, allocation.tag, 0, 0});
+                found = &sites.back();
+            }
+            found->bytes += allocation.size;
+            found->allocations++;
+            totalBytes += allocation.size;
+            totalAllocations++;
+        }
+    }
+
+    std::sort(sites.begin(), sites.end(), [](const SiteTotal& a, const SiteTotal& b){
+        return a.bytes > b.bytes;
+    });
+
+    fprintf(out, "Leak report: %zu bytes still allocated in %zu allocations from %zu places\n", totalBytes, totalAllocations, sites.size());
+    for (int i = 0; i < (int)sites.size() && i < maxSites; i++) {
+        const SiteTotal& site = sites[i];
+        fprintf(out, "%zu bytes in %zu allocations, tagged %s, ", site.bytes, site.allocations, MemoryTags::Names[site.tag]);
+        if (site.site.file) {
+            fprintf(out, "from %s:%d\n", site.site.file, site.site.line);
+        } else {
+            fprintf(out, "from:\n");
+            fflush(out);
+            backtrace_symbols_fd(site.site.frames, site.site.frameCount, fileno(out));
+        }
+    }
+    fflush(out);
+#else
+    (void)out;
+    (void)maxSites;
+#endif
 }
 
 MemoryBlock failedToAlloc(bool required, AllocCallback callback) {
@@ -139,12 +399,20 @@ MemoryBlock aligned_min_realloc(void* mem, size_t min, size_t preferred, size_t
 /* debug */
 
 void* debug_malloc(size_t size, const char* file, int line) {
+#if MEMORY_TRACKING
+    void* ptr = safe_malloc(size);
+    if (ptr) trackSite(ptr, file, line);
+    return ptr;
+#else
     printf("Allocated %lu bytes at %s:%d\n", size, file, line);
     return safe_malloc(size);
+#endif
 }
 
 void debug_free(void* ptr, const char* file, int line) noexcept {
+#if !MEMORY_TRACKING
     printf("Freed %p at %s:%d\n", ptr, file, line);
+#endif
     _free(ptr);
 }
 
@@ -1,46 +1,485 @@
-#include "utils/vectors_and_rects.hpp"
+#include "physics/physics.hpp"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
 #include "utils/common-macros.hpp"
-#include <iostream>
-
-bool boxesOverlap(const Boxf* ba, const Boxf* bb) {
-    return (
-        (*ba)[1].x > (*bb)[0].x &&
-        (*ba)[1].y > (*bb)[0].y &&
-        (*ba)[0].x < (*bb)[1].x &&
-        (*ba)[0].y < (*bb)[1].y );
-}
-
-struct Rectangle {
-    int x1,y1,x2,y2;
-};
-
-// chatgpt
-Rectangle calculateOverlapRectangle(const Rectangle& rect1, const Rectangle& rect2) {
-    Rectangle overlapRect;
-
-   // Calculate the overlapping rectangle
-    overlapRect.x2 = rect1.x2 ^ ((rect1.x2 ^ rect2.x2) & -(rect1.x2 > rect2.x2));
-    overlapRect.y2 = rect1.y2 ^ ((rect1.y2 ^ rect2.y2) & -(rect1.y2 > rect2.y2));
-    overlapRect.x1 = rect1.x1 ^ ((rect1.x1 ^ rect2.x1) & -(rect1.x1 < rect2.x1));
-    overlapRect.y1 = rect1.y1 ^ ((rect1.y1 ^ rect2.y1) & -(rect1.y1 < rect2.y1));
-    //overlapRect.x1 = overlapRect.x1 & (overlapRect.x1 - overlapRect.x2);
-
-    // Ensure the rectangles actually overlap
-    if (UNLIKELY(overlapRect.x1 >= overlapRect.x2 || overlapRect.y1 >= overlapRect.y2)) {
-        // No overlap, return a default rectangle with zero area
-        overlapRect = {0, 0, 0, 0};
-    }
-
-    return overlapRect;
-}
-
-int physics_test() {
-    Rectangle rect1 = {16, -5, 40, 20};
-    Rectangle rect2 = {3, 7, 7, 3};
-    
-    Rectangle overlapRect = calculateOverlapRectangle(rect1, rect2);
-    
-    //std::cout << "Overlapping Rectangle: (" << overlapRect.x1 << ", " << overlapRect.y1 << ") to (" << overlapRect.x2 << ", " << overlapRect.y2 << ")" << std::endl;
-    
-    return 0;
-}
\ No newline at end of file
+#include "utils/Log.hpp"
+
+namespace Physics {
+
+static IVec2 cellOf(Vec2 point) {
+    return {(int)floorf(point.x / Space::CellSize), (int)floorf(point.y / Space::CellSize)};
+}
+
+// cells are offset to fit in 16 bits each, which is a lot further than anything goes
+static Uint64 cellKey(IVec2 cell) {
+    return (Uint64)(Uint16)(cell.y + 32768) << 16 | (Uint64)(Uint16)(cell.x + 32768);
+}
+
+/* Sort cell entries by their cell, a byte at a time, without changing the order of entries in the same cell.
+ * Entries are made in order of body, so they stay that way in each cell.
+ * Most bytes of the cell are the same for everything nearby, and those are skipped
+ */
+static void sortByCell(My::Vec<Uint64>& entries, My::Vec<Uint64>& scratch) {
+    if (entries.size < 2) return;
+    scratch.resize(entries.size);
+    Uint64* from = entries.data;
+    Uint64* to = scratch.data;
+    for (int shift = 32; shift < 64; shift += 8) {
+        int counts[256] = {0};
+        for (int i = 0; i < entries.size; i++) {
+            counts[(from[i] >> shift) & 0xFF]++;
+        }
+        if (counts[(from[0] >> shift) & 0xFF] == entries.size) continue;
+
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (int i = 0; i < entries.size; i++) {
+            to[counts[(from[i] >> shift) & 0xFF]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != entries.data) {
+        memcpy(entries.data, from, entries.size * sizeof(Uint64));
+    }
+}
+
+static float dot(Vec2 a, Vec2 b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+static bool boundsOverlap(const Body& a, const Body& b) {
+    return fabsf(b.position.x - a.position.x) < a.halfSize.x + b.halfSize.x
+        && fabsf(b.position.y - a.position.y) < a.halfSize.y + b.halfSize.y;
+}
+
+// d is b's position relative to a's. Normals point from a to b
+static bool boxBox(Vec2 d, Vec2 halfA, Vec2 halfB, Vec2* normal, float* depth) {
+    float overlapX = halfA.x + halfB.x - fabsf(d.x);
+    float overlapY = halfA.y + halfB.y - fabsf(d.y);
+    if (overlapX <= 0.0f || overlapY <= 0.0f) return false;
+    // push out along whichever axis is overlapping the least
+    if (overlapX < overlapY) {
+        *normal = Vec2(d.x < 0.0f ? -1.0f : 1.0f, 0.0f);
+        *depth = overlapX;
+    } else {
+        *normal = Vec2(0.0f, d.y < 0.0f ? -1.0f : 1.0f);
+        *depth = overlapY;
+    }
+    return true;
+}
+
+static bool circleCircle(Vec2 d, float radiusA, float radiusB, Vec2* normal, float* depth) {
+    float radii = radiusA + radiusB;
+    float distanceSqrd = dot(d, d);
+    if (distanceSqrd >= radii * radii) return false;
+    float distance = sqrtf(distanceSqrd);
+    // circles right on top of each other get pushed apart along x
+    *normal = distance > 0.0f ? d / distance : Vec2(1.0f, 0.0f);
+    *depth = radii - distance;
+    return true;
+}
+
+// d is the circle's position relative to the box's
+static bool boxCircle(Vec2 d, Vec2 half, float radius, Vec2* normal, float* depth) {
+    Vec2 closest = Vec2(MAX(-half.x, MIN(half.x, d.x)), MAX(-half.y, MIN(half.y, d.y)));
+    if (closest.x == d.x && closest.y == d.y) {
+        // the center is inside the box, so push it out through the nearest side
+        float toSideX = half.x - fabsf(d.x);
+        float toSideY = half.y - fabsf(d.y);
+        if (toSideX < toSideY) {
+            *normal = Vec2(d.x < 0.0f ? -1.0f : 1.0f, 0.0f);
+            *depth = radius + toSideX;
+        } else {
+            *normal = Vec2(0.0f, d.y < 0.0f ? -1.0f : 1.0f);
+            *depth = radius + toSideY;
+        }
+        return true;
+    }
+
+    Vec2 outside = d - closest;
+    float distanceSqrd = dot(outside, outside);
+    if (distanceSqrd >= radius * radius) return false;
+    float distance = sqrtf(distanceSqrd);
+    *normal = outside / distance;
+    *depth = radius - distance;
+    return true;
+}
+
+static bool collide(Shape shapeA, Vec2 halfA, Shape shapeB, Vec2 halfB, Vec2 d, Vec2* normal, float* depth) {
+    if (shapeA == Shape::Box) {
+        if (shapeB == Shape::Box) {
+            return boxBox(d, halfA, halfB, normal, depth);
+        }
+        return boxCircle(d, halfA, halfB.x, normal, depth);
+    }
+    if (shapeB == Shape::Circle) {
+        return circleCircle(d, halfA.x, halfB.x, normal, depth);
+    }
+    if (!boxCircle(-d, halfB, halfA.x, normal, depth)) return false;
+    *normal = -*normal;
+    return true;
+}
+
+Space Space::init() {
+    Space self;
+    self.bodies = My::Vec<Body>::Empty();
+    self.freeBodies = My::Vec<BodyID>::Empty();
+    self.byEntity = My::HashMap<Uint32, BodyID>::WithBuckets(64);
+    self.staticCells = My::HashMap<IVec2, int, IVec2Hash>::WithBuckets(64);
+    self.staticNodes = My::Vec<StaticCellNode>::Empty();
+    self.freeStaticNodes = My::Vec<int>::Empty();
+    self.queryCount = 0;
+    self.stats = {0, 0, 0, 0, 0};
+    self.solidTile = nullptr;
+    self.cellEntries = My::Vec<Uint64>::Empty();
+    self.sortScratch = My::Vec<Uint64>::Empty();
+    self.contacts = My::Vec<Contact>::Empty();
+    return self;
+}
+
+void Space::destroy() {
+    bodies.destroy();
+    freeBodies.destroy();
+    byEntity.destroy();
+    staticCells.destroy();
+    staticNodes.destroy();
+    freeStaticNodes.destroy();
+    cellEntries.destroy();
+    sortScratch.destroy();
+    contacts.destroy();
+}
+
+BodyID Space::addBody(Shape shape, Vec2 position, Vec2 halfSize, bool isStatic, Entity entity) {
+    BodyID id;
+    if (!freeBodies.empty()) {
+        id = freeBodies.popBack();
+    } else {
+        id = bodies.size;
+        bodies.push(Body{});
+    }
+
+    Body& body = bodies[id];
+    body.position = position;
+    body.velocity = Vec2(0.0f);
+    body.halfSize = shape == Shape::Circle ? Vec2(halfSize.x) : halfSize;
+    // heavier the bigger it is
+    float area = shape == Shape::Circle ? (float)M_PI * body.halfSize.x * body.halfSize.x : 4.0f * body.halfSize.x * body.halfSize.y;
+    body.inverseMass = isStatic ? 0.0f : (area > 0.0f ? 1.0f / area : 1.0f);
+    body.restitution = 0.0f;
+    body.entity = entity;
+    body.lastQuery = 0;
+    body.shape = shape;
+    body.isStatic = isStatic;
+    body.tileCollision = !isStatic;
+    body.alive = true;
+
+    stats.bodies++;
+    if (isStatic) {
+        linkStatic(id);
+        stats.staticBodies++;
+    }
+    if (entity.NotNull()) {
+        byEntity.insert(entity.id, id);
+    }
+    return id;
+}
+
+void Space::removeBody(BodyID id) {
+    if (id < 0 || id >= bodies.size || !bodies[id].alive) {
+        LogError("Physics::Space::removeBody : Body %d doesn't exist!", id);
+        return;
+    }
+    Body& body = bodies[id];
+    if (body.isStatic) {
+        unlinkStatic(id);
+        stats.staticBodies--;
+    }
+    if (body.entity.NotNull()) {
+        BodyID* entityBody = byEntity.lookup(body.entity.id);
+        if (entityBody && *entityBody == id) {
+            byEntity.remove(body.entity.id);
+        }
+    }
+    body.alive = false;
+    stats.bodies--;
+    freeBodies.push(id);
+}
+
+Body* Space::bodyOf(Entity entity) {
+    BodyID* id = byEntity.lookup(entity.id);
+    return id ? &bodies[*id] : nullptr;
+}
+
+void Space::moveStatic(BodyID id, Vec2 position) {
+    if (!bodies[id].isStatic) {
+        bodies[id].position = position;
+        return;
+    }
+    unlinkStatic(id);
+    bodies[id].position = position;
+    linkStatic(id);
+}
+
+void Space::linkStatic(BodyID id) {
+    IVec2 minCell = cellOf(bodies[id].min());
+    IVec2 maxCell = cellOf(bodies[id].max());
+    for (int y = minCell.y; y <= maxCell.y; y++) {
+        for (int x = minCell.x; x <= maxCell.x; x++) {
+            int node;
+            if (!freeStaticNodes.empty()) {
+                node = freeStaticNodes.popBack();
+            } else {
+                node = staticNodes.size;
+                staticNodes.push(StaticCellNode{});
+            }
+            int* head = staticCells.lookup({x, y});
+            if (!head) {
+                head = staticCells.insert({x, y}, -1);
+            }
+            staticNodes[node].body = id;
+            staticNodes[node].next = *head;
+            *head = node;
+        }
+    }
+}
+
+void Space::unlinkStatic(BodyID id) {
+    IVec2 minCell = cellOf(bodies[id].min());
+    IVec2 maxCell = cellOf(bodies[id].max());
+    for (int y = minCell.y; y <= maxCell.y; y++) {
+        for (int x = minCell.x; x <= maxCell.x; x++) {
+            int* link = staticCells.lookup({x, y});
+            if (!link) continue;
+            while (*link != -1) {
+                int node = *link;
+                if (staticNodes[node].body == id) {
+                    *link = staticNodes[node].next;
+                    freeStaticNodes.push(node);
+                    break;
+                }
+                link = &staticNodes[node].next;
+            }
+        }
+    }
+}
+
+void Space::findStaticContacts(BodyID id) {
+    if (++queryCount == 0) {
+        // wrapped around, so old queries could be mistaken for this one
+        for (Body& body : bodies) {
+            body.lastQuery = 0;
+        }
+        queryCount = 1;
+    }
+
+    const Body& body = bodies[id];
+    IVec2 minCell = cellOf(body.min());
+    IVec2 maxCell = cellOf(body.max());
+    for (int y = minCell.y; y <= maxCell.y; y++) {
+        for (int x = minCell.x; x <= maxCell.x; x++) {
+            const int* head = staticCells.lookup({x, y});
+            if (!head) continue;
+            for (int node = *head; node != -1; node = staticNodes[node].next) {
+                Body& other = bodies[staticNodes[node].body];
+                if (other.lastQuery == queryCount) continue;
+                other.lastQuery = queryCount;
+                if (!boundsOverlap(body, other)) continue;
+
+                stats.pairsTested++;
+                Vec2 d = other.position - body.position;
+                Contact contact;
+                if (collide(body.shape, body.halfSize, other.shape, other.halfSize, d, &contact.normal, &contact.depth)) {
+                    contact.a = id;
+                    contact.b = staticNodes[node].body;
+                    contact.offset = d;
+                    contact.tile = Vec2(0.0f);
+                    contacts.push(contact);
+                }
+            }
+        }
+    }
+}
+
+void Space::findTileContacts(BodyID id) {
+    const Body& body = bodies[id];
+    IVec2 minTile = vecFloori(body.min());
+    IVec2 maxTile = vecFloori(body.max());
+    for (int y = minTile.y; y <= maxTile.y; y++) {
+        for (int x = minTile.x; x <= maxTile.x; x++) {
+            const IVec2 tile = {x, y};
+            if (!solidTile(tile)) continue;
+
+            const Vec2 center = Vec2(x + 0.5f, y + 0.5f);
+            const Vec2 d = center - body.position;
+            Vec2 normal;
+            float depth;
+            // sides of a tile up against another solid tile aren't really there,
+            // so bodies sliding along a wall don't catch on the seams between its tiles
+            if (body.shape == Shape::Box) {
+                float overlapX = body.halfSize.x + 0.5f - fabsf(d.x);
+                float overlapY = body.halfSize.y + 0.5f - fabsf(d.y);
+                if (overlapX <= 0.0f || overlapY <= 0.0f) continue;
+                int signX = d.x < 0.0f ? -1 : 1;
+                int signY = d.y < 0.0f ? -1 : 1;
+                bool openX = !solidTile({x - signX, y});
+                bool openY = !solidTile({x, y - signY});
+                if (openX && (!openY || overlapX < overlapY)) {
+                    normal = Vec2((float)signX, 0.0f);
+                    depth = overlapX;
+                } else if (openY) {
+                    normal = Vec2(0.0f, (float)signY);
+                    depth = overlapY;
+                } else {
+                    // walled in on both sides, the tiles next to this one push it out instead
+                    continue;
+                }
+            } else {
+                if (!collide(body.shape, body.halfSize, Shape::Box, Vec2(0.5f), d, &normal, &depth)) continue;
+                if ((normal.x == 0.0f || normal.y == 0.0f) && solidTile({x - (int)normal.x, y - (int)normal.y})) continue;
+            }
+
+            Contact contact;
+            contact.a = id;
+            contact.b = NullBody;
+            contact.normal = normal;
+            contact.depth = depth;
+            contact.offset = d;
+            contact.tile = center;
+            contacts.push(contact);
+            stats.tileContacts++;
+        }
+    }
+}
+
+void Space::findContacts() {
+    contacts.size = 0;
+    cellEntries.size = 0;
+    stats.pairsTested = 0;
+    stats.tileContacts = 0;
+
+    for (BodyID id = 0; id < bodies.size; id++) {
+        const Body& body = bodies[id];
+        if (!body.alive || body.isStatic) continue;
+        IVec2 minCell = cellOf(body.min());
+        IVec2 maxCell = cellOf(body.max());
+        for (int y = minCell.y; y <= maxCell.y; y++) {
+            for (int x = minCell.x; x <= maxCell.x; x++) {
+                cellEntries.push(cellKey({x, y}) << 32 | (Uint32)id);
+            }
+        }
+    }
+    // bodies in the same cell end up next to each other, in order of id
+    sortByCell(cellEntries, sortScratch);
+
+    for (int start = 0; start < cellEntries.size;) {
+        const Uint64 cell = cellEntries[start] >> 32;
+        int end = start + 1;
+        while (end < cellEntries.size && (cellEntries[end] >> 32) == cell) {
+            end++;
+        }
+
+        for (int i = start; i < end; i++) {
+            const BodyID a = (BodyID)(Uint32)cellEntries[i];
+            const Body& bodyA = bodies[a];
+            for (int j = i + 1; j < end; j++) {
+                const BodyID b = (BodyID)(Uint32)cellEntries[j];
+                const Body& bodyB = bodies[b];
+                if (!boundsOverlap(bodyA, bodyB)) continue;
+                // bodies that share more than one cell are only tested in the cell with the corner of their overlap
+                Vec2 minA = bodyA.min();
+                Vec2 minB = bodyB.min();
+                if (cellKey(cellOf(Vec2(MAX(minA.x, minB.x), MAX(minA.y, minB.y)))) != cell) continue;
+
+                stats.pairsTested++;
+                Vec2 d = bodyB.position - bodyA.position;
+                Contact contact;
+                if (collide(bodyA.shape, bodyA.halfSize, bodyB.shape, bodyB.halfSize, d, &contact.normal, &contact.depth)) {
+                    contact.a = a;
+                    contact.b = b;
+                    contact.offset = d;
+                    contact.tile = Vec2(0.0f);
+                    contacts.push(contact);
+                }
+            }
+        }
+        start = end;
+    }
+
+    for (BodyID id = 0; id < bodies.size; id++) {
+        const Body& body = bodies[id];
+        if (!body.alive || body.isStatic) continue;
+        if (stats.staticBodies > 0) {
+            findStaticContacts(id);
+        }
+        if (body.tileCollision && solidTile) {
+            findTileContacts(id);
+        }
+    }
+    stats.contacts = contacts.size;
+}
+
+void Space::solveVelocities() {
+    for (int iteration = 0; iteration < VelocityIterations; iteration++) {
+        for (const Contact& contact : contacts) {
+            Body& a = bodies[contact.a];
+            Body* b = contact.b != NullBody ? &bodies[contact.b] : nullptr;
+            const float inverseMassB = b ? b->inverseMass : 0.0f;
+            const float totalInverseMass = a.inverseMass + inverseMassB;
+            if (totalInverseMass <= 0.0f) continue;
+
+            Vec2 relativeVelocity = (b ? b->velocity : Vec2(0.0f)) - a.velocity;
+            float approach = dot(relativeVelocity, contact.normal);
+            // already moving apart
+            if (approach >= 0.0f) continue;
+
+            float restitution = b ? MIN(a.restitution, b->restitution) : a.restitution;
+            float impulse = -(1.0f + restitution) * approach / totalInverseMass;
+            a.velocity -= contact.normal * (impulse * a.inverseMass);
+            if (b) {
+                b->velocity += contact.normal * (impulse * inverseMassB);
+            }
+        }
+    }
+}
+
+void Space::solvePositions() {
+    for (int iteration = 0; iteration < PositionIterations; iteration++) {
+        for (const Contact& contact : contacts) {
+            Body& a = bodies[contact.a];
+            Body* b = contact.b != NullBody ? &bodies[contact.b] : nullptr;
+            const float inverseMassB = b ? b->inverseMass : 0.0f;
+            const float totalInverseMass = a.inverseMass + inverseMassB;
+            if (totalInverseMass <= 0.0f) continue;
+
+            // take off however far the bodies have already been pushed apart since the contact was found
+            Vec2 positionB = b ? b->position : contact.tile;
+            float depth = contact.depth - dot((positionB - a.position) - contact.offset, contact.normal);
+            if (depth <= CorrectionSlop) continue;
+
+            Vec2 correction = contact.normal * ((depth - CorrectionSlop) * CorrectionPercent / totalInverseMass);
+            a.position -= correction * a.inverseMass;
+            if (b) {
+                b->position += correction * inverseMassB;
+            }
+        }
+    }
+}
+
+void Space::step() {
+    for (Body& body : bodies) {
+        if (body.alive && !body.isStatic) {
+            body.position += body.velocity;
+        }
+    }
+
+    findContacts();
+    solveVelocities();
+    solvePositions();
+}
+
+}
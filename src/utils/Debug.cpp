@@ -1,9 +1,78 @@
 #include "utils/Debug.hpp"
+#include "utils/Log.hpp"
+
+DebugFlag DebugFlags::fromName(const char* name) {
+    for (int i = 0; i < Count; i++) {
+        if (strcmp(Infos[i].name, name) == 0) {
+            return (DebugFlag)i;
+        }
+    }
+    return Null;
+}
+
+void DebugSettings::init() {
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        flags[i] = DebugFlags::Infos[i].defaultValue;
+    }
+}
+
+void DebugSettings::set(DebugFlag flag, bool value) {
+    if (flags[flag] == value) return;
+    flags[flag] = value;
+    for (auto& listener : listeners) {
+        listener(flag, value);
+    }
+}
+
+bool DebugSettings::set(const char* name, bool value) {
+    DebugFlag flag = DebugFlags::fromName(name);
+    if (flag == DebugFlags::Null) return false;
+    set(flag, value);
+    return true;
+}
+
+bool DebugSettings::save(const char* filepath) const {
+    FILE* file = fopen(filepath, "w");
+    if (!file) {
+        LogError("Failed to open debug settings file %s for writing", filepath);
+        return false;
+    }
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        if (flags[i] != DebugFlags::Infos[i].defaultValue) {
+            fprintf(file, "%s = %d\n", DebugFlags::Infos[i].name, (int)flags[i]);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+bool DebugSettings::load(const char* filepath) {
+    FILE* file = fopen(filepath, "r");
+    if (!file) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[128];
+        int value;
+        if (sscanf(line, " %127[^= \t] = %d", name, &value) != 2) continue;
+        if (!set(name, value != 0)) {
+            LogWarn("Unknown debug flag %s in %s", name, filepath);
+        }
+    }
+    fclose(file);
+    return true;
+}
 
 DebugClass::DebugClass() {
-    /* Initialize all settings to 0 */
+    /* Initialize all settings to their defaults */
     settings.init();
 }
 
+void DebugClass::resetSettings() {
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        settings.set((DebugFlag)i, DebugFlags::Infos[i].defaultValue);
+    }
+}
+
 
-const DebugClass* Debug = NULL;
\ No newline at end of file
+const DebugClass* Debug = NULL;
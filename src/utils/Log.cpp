@@ -2,7 +2,698 @@
 #include "utils/Debug.hpp"
 #include "GUI/Gui.hpp"
 
-void Logger::logOutputFunction(LogCategory category, LogPriority priority, const char *message) const {
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <signal.h>
+#include <SDL3/SDL_timer.h>
+
+/* Log records
+ * A record holds everything needed to format a message later: the format string, the call site and the arguments.
+ * Format strings and call site strings have to be string literals, or at least outlive the logger, since only pointers to them are kept.
+ * Arguments are read off the va_list using the conversions in the format string, with strings copied into the record's text.
+ * Formats that can't be captured (like %n or long doubles), or strings that don't fit in the record, get the message formatted
+ * right away into the record's text instead. Messages too long for that go on the heap for the writer to free.
+ * Anything still cut off, past MAX_LOG_MESSAGE_LENGTH, ends with a note saying how much is missing.
+ */
+
+namespace {
+
+constexpr int MaxLogArgs = 12;
+constexpr int LogRecordSize = 512;
+constexpr int LogQueueSize = 8192; // records, must be a power of two
+constexpr int LogSiteCount = 1024; // must be a power of two
+
+// how many messages a call site can log in a window before the rest are dropped
+constexpr Uint32 RateLimitPerWindow = 20;
+constexpr Uint32 RateLimitWindowMs = 1000;
+// how long the writer sleeps with nothing to write
+constexpr int WriterIdleMs = 20;
+// messages kept for the debug console until the main thread picks them up. More than that are left out of the console
+constexpr size_t MaxConsoleMessages = 1024;
+
+enum class LogLayout : Uint8 {
+    Prefixed, // PREFIX MESSAGE
+    TwoPrefixes, // PREFIX PREFIX2 MESSAGE
+    FileLine, // FILE:LINE - MESSAGE
+    FileLineFunction // FILE:LINE:FUNCTION - MESSAGE
+};
+
+enum class LogArgType : Uint8 {
+    Int,
+    Long,
+    LongLong,
+    Size,
+    IntMax,
+    PtrDiff,
+    Double,
+    Pointer,
+    String // offset and length into the record's text
+};
+
+union LogArg {
+    int i;
+    long l;
+    long long ll;
+    size_t z;
+    intmax_t j;
+    ptrdiff_t t;
+    double d;
+    const void* p;
+    struct {
+        Uint16 offset;
+        Uint16 length;
+    } s;
+};
+
+struct LogLocation {
+    LogLayout layout;
+    const char* prefix; // or file
+    const char* prefix2; // or function
+    int line;
+};
+
+struct LogRecordHeader {
+    std::atomic<Uint32> sequence;
+    Uint8 category;
+    Uint8 priority;
+    Uint8 argCount;
+    bool preformatted; // text holds the whole message, not just string arguments
+    Uint16 textSize;
+    char* spill; // the whole message when it was too long for text, on the heap. Freed once it's written
+    Uint32 cutBytes; // bytes of the message that didn't make it in at all
+    LogLocation location;
+    const char* fmt;
+    LogArgType argTypes[MaxLogArgs];
+    LogArg args[MaxLogArgs];
+};
+
+constexpr int LogRecordTextSize = LogRecordSize - (int)sizeof(LogRecordHeader);
+static_assert(LogRecordTextSize >= 256, "Not enough room in log records for text!");
+
+struct LogRecord : LogRecordHeader {
+    char text[LogRecordTextSize];
+};
+
+// rate limiting state for one call site
+struct LogSite {
+    std::atomic<const char*> fmt;
+    std::atomic<bool> ready; // location has been set
+    LogLocation location;
+    std::atomic<Uint32> windowStart;
+    std::atomic<Uint32> count; // messages logged in this window
+    std::atomic<Uint32> suppressed; // messages dropped and not reported yet
+};
+
+struct ConsoleMessage {
+    std::string text;
+    LogPriority priority;
+};
+
+}
+
+struct LogQueue {
+    LogRecord* records;
+
+    alignas(64) std::atomic<Uint32> enqueuePos;
+    alignas(64) Uint32 dequeuePos;
+    std::atomic<Uint32> dropped; // messages dropped since the last time it was reported because the queue was full
+
+    // set by whoever is writing records out. Not a mutex, so a crash can try to take it from any thread without waiting
+    std::atomic<bool> consuming;
+    std::atomic<bool> crashing; // flushing from a crash, so nothing should be locked
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> running;
+    std::thread writer;
+
+    // repeats of the last message written, waiting to be reported
+    char lastMessage[MAX_LOG_MESSAGE_LENGTH];
+    LogPriority lastPriority;
+    LogCategory lastCategory;
+    int repeats;
+    Uint32 lastSweep;
+
+    // messages for the debug console, which only the main thread can touch
+    std::mutex consoleMutex;
+    std::vector<ConsoleMessage> consoleMessages;
+
+    LogSite sites[LogSiteCount];
+};
+
+namespace {
+
+LogSite* findSite(LogQueue* queue, const char* fmt, const LogLocation& location) {
+    size_t hash = ((size_t)fmt >> 3) * 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < LogSiteCount; i++) {
+        LogSite* site = &queue->sites[(hash + i) & (LogSiteCount - 1)];
+        const char* siteFmt = site->fmt.load(std::memory_order_acquire);
+        if (siteFmt == fmt) return site;
+        if (siteFmt == nullptr) {
+            if (site->fmt.compare_exchange_strong(siteFmt, fmt, std::memory_order_acq_rel)) {
+                site->location = location;
+                site->ready.store(true, std::memory_order_release);
+                return site;
+            }
+            if (siteFmt == fmt) return site;
+        }
+    }
+    // out of sites, so this one goes without a limit
+    return nullptr;
+}
+
+// @return false if the message should be dropped
+bool rateLimit(LogQueue* queue, const char* fmt, const LogLocation& location) {
+    LogSite* site = findSite(queue, fmt, location);
+    if (!site) return true;
+
+    Uint32 now = (Uint32)SDL_GetTicks();
+    Uint32 windowStart = site->windowStart.load(std::memory_order_relaxed);
+    if (now - windowStart >= RateLimitWindowMs) {
+        if (site->windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+            site->count.store(0, std::memory_order_relaxed);
+        }
+    }
+    if (site->count.fetch_add(1, std::memory_order_relaxed) >= RateLimitPerWindow) {
+        site->suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// claim a record to fill in. @return null when the queue is full
+LogRecord* beginRecord(LogQueue* queue, Uint32* posOut) {
+    Uint32 pos = queue->enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        LogRecord* record = &queue->records[pos & (LogQueueSize - 1)];
+        Uint32 sequence = record->sequence.load(std::memory_order_acquire);
+        Sint32 difference = (Sint32)(sequence - pos);
+        if (difference == 0) {
+            if (queue->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *posOut = pos;
+                return record;
+            }
+        } else if (difference < 0) {
+            queue->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = queue->enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void commitRecord(LogRecord* record, Uint32 pos) {
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// @return false if the format has a conversion that can't be captured
+bool captureArgs(LogRecord* record, const char* fmt, va_list ap) {
+    int argCount = 0;
+    int textSize = 0;
+    auto pushArg = [&](LogArgType type) -> LogArg* {
+        if (argCount >= MaxLogArgs) return nullptr;
+        record->argTypes[argCount] = type;
+        return &record->args[argCount++];
+    };
+
+    const char* c = fmt;
+    while (*c) {
+        if (*c++ != '%') continue;
+        if (*c == '%') {
+            c++;
+            continue;
+        }
+        while (*c == '-' || *c == '+' || *c == ' ' || *c == '#' || *c == '0' || *c == '\'') c++;
+        if (*c == '*') {
+            LogArg* arg = pushArg(LogArgType::Int);
+            if (!arg) return false;
+            arg->i = va_arg(ap, int);
+            c++;
+        } else {
+            while (*c >= '0' && *c <= '9') c++;
+        }
+        int precision = -1;
+        if (*c == '.') {
+            c++;
+            if (*c == '*') {
+                LogArg* arg = pushArg(LogArgType::Int);
+                if (!arg) return false;
+                arg->i = va_arg(ap, int);
+                precision = arg->i;
+                c++;
+            } else {
+                precision = 0;
+                while (*c >= '0' && *c <= '9') precision = precision * 10 + (*c++ - '0');
+            }
+        }
+
+        LogArgType intType = LogArgType::Int;
+        switch (*c) {
+        case 'h': c++; if (*c == 'h') c++; break;
+        case 'l': c++; intType = LogArgType::Long; if (*c == 'l') { c++; intType = LogArgType::LongLong; } break;
+        case 'z': c++; intType = LogArgType::Size; break;
+        case 'j': c++; intType = LogArgType::IntMax; break;
+        case 't': c++; intType = LogArgType::PtrDiff; break;
+        case 'L': return false;
+        default: break;
+        }
+
+        char conversion = *c++;
+        switch (conversion) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c': {
+            LogArg* arg = pushArg(intType);
+            if (!arg) return false;
+            switch (intType) {
+            case LogArgType::Long: arg->l = va_arg(ap, long); break;
+            case LogArgType::LongLong: arg->ll = va_arg(ap, long long); break;
+            case LogArgType::Size: arg->z = va_arg(ap, size_t); break;
+            case LogArgType::IntMax: arg->j = va_arg(ap, intmax_t); break;
+            case LogArgType::PtrDiff: arg->t = va_arg(ap, ptrdiff_t); break;
+            default: arg->i = va_arg(ap, int); break;
+            }
+            break;
+        }
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+            LogArg* arg = pushArg(LogArgType::Double);
+            if (!arg) return false;
+            arg->d = va_arg(ap, double);
+            break;
+        }
+        case 'p': {
+            LogArg* arg = pushArg(LogArgType::Pointer);
+            if (!arg) return false;
+            arg->p = va_arg(ap, const void*);
+            break;
+        }
+        case 's': {
+            if (intType != LogArgType::Int) return false; // wide strings
+            LogArg* arg = pushArg(LogArgType::String);
+            if (!arg) return false;
+            const char* string = va_arg(ap, const char*);
+            if (!string) string = "(null)";
+            // strings with a precision don't have to be null terminated.
+            // Strings that don't fit get the whole message formatted now instead, so nothing is cut off
+            int room = LogRecordTextSize - textSize;
+            int length = (int)strnlen(string, precision >= 0 ? precision : room + 1);
+            if (length > room) return false;
+            memcpy(record->text + textSize, string, length);
+            arg->s.offset = (Uint16)textSize;
+            arg->s.length = (Uint16)length;
+            textSize += length;
+            break;
+        }
+        default:
+            // %n or something unknown
+            return false;
+        }
+    }
+
+    record->argCount = (Uint8)argCount;
+    record->textSize = (Uint16)textSize;
+    return true;
+}
+
+// write the part of the line that goes in front of the message. @return Its length
+int formatLocation(char* out, int size, const LogLocation& location) {
+    int length = 0;
+    switch (location.layout) {
+    case LogLayout::Prefixed: length = snprintf(out, size, "%s", location.prefix); break;
+    case LogLayout::TwoPrefixes: length = snprintf(out, size, "%s%s", location.prefix, location.prefix2); break;
+    case LogLayout::FileLine: length = snprintf(out, size, "%s:%d - ", location.prefix, location.line); break;
+    case LogLayout::FileLineFunction: length = snprintf(out, size, "%s:%d:%s - ", location.prefix, location.line, location.prefix2); break;
+    }
+    return MIN(MAX(length, 0), size - 1);
+}
+
+/* End text that was cut off with a note saying how much is missing, written over the end of the text if there's no room after it
+ * @param length How much of the text there is
+ * @param cutBytes How much of it didn't fit
+ */
+void markTruncated(char* text, int size, int length, int cutBytes) {
+    char note[48];
+    int noteLength = snprintf(note, sizeof(note), "...[truncated %d bytes]", cutBytes);
+    int at = MIN(length, size - 1 - noteLength);
+    if (at < 0) return;
+    if (at < length) {
+        noteLength = snprintf(note, sizeof(note), "...[truncated %d bytes]", cutBytes + length - at);
+        at = MAX(MIN(length, size - 1 - noteLength), 0);
+    }
+    memcpy(text + at, note, MIN(noteLength + 1, size - at));
+    text[size - 1] = '\0';
+}
+
+// format the message into text after the location, marking it if it doesn't all fit
+void formatNow(char* text, int size, const LogLocation& location, const char* fmt, va_list ap) {
+    int prefixLength = formatLocation(text, size, location);
+    int room = size - prefixLength;
+    int length = vsnprintf(text + prefixLength, room, fmt, ap);
+    if (length >= room) {
+        markTruncated(text + prefixLength, room, room - 1, length - (room - 1));
+    }
+}
+
+void queueMessage(Logger* logger, const LogLocation& location, LogCategory category, LogPriority priority, bool rateLimited, const char* fmt, va_list ap) {
+    LogQueue* queue = logger->queue;
+    if (!queue) {
+        // not running a writer thread, so write it now
+        char text[MAX_LOG_MESSAGE_LENGTH];
+        formatNow(text, MAX_LOG_MESSAGE_LENGTH, location, fmt, ap);
+        logger->writeMessage(category, priority, text);
+        return;
+    }
+
+    // crashes and critical errors always get through
+    if (rateLimited && logger->rateLimit && priority < LogPriority::Critical && !rateLimit(queue, fmt, location)) {
+        return;
+    }
+
+    Uint32 pos;
+    LogRecord* record = beginRecord(queue, &pos);
+    if (!record) return;
+    record->category = (Uint8)category;
+    record->priority = (Uint8)priority;
+    record->location = location;
+    record->fmt = fmt;
+
+    record->spill = nullptr;
+    record->cutBytes = 0;
+
+    va_list formatAp;
+    va_list spillAp;
+    va_copy(formatAp, ap);
+    va_copy(spillAp, ap);
+    record->preformatted = !captureArgs(record, fmt, ap);
+    if (record->preformatted) {
+        int size = vsnprintf(record->text, LogRecordTextSize, fmt, formatAp);
+        size = MAX(size, 0);
+        record->textSize = (Uint16)MIN(size, LogRecordTextSize - 1);
+        record->argCount = 0;
+        if (size >= LogRecordTextSize) {
+            // only as much as can be written out in the end. Plain malloc, since running out of memory through Alloc logs
+            int spillSize = MIN(size, MAX_LOG_MESSAGE_LENGTH - 1);
+            record->spill = (char*)malloc(spillSize + 1);
+            if (record->spill) {
+                vsnprintf(record->spill, spillSize + 1, fmt, spillAp);
+                record->cutBytes = (Uint32)(size - spillSize);
+            } else {
+                record->cutBytes = (Uint32)(size - record->textSize);
+            }
+        }
+    }
+    va_end(spillAp);
+    va_end(formatAp);
+    commitRecord(record, pos);
+
+    if (priority >= LogPriority::Error) {
+        queue->wake.notify_one();
+    }
+}
+
+void queueMessagef(Logger* logger, const LogLocation& location, LogCategory category, LogPriority priority, bool rateLimited, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    queueMessage(logger, location, category, priority, rateLimited, fmt, ap);
+    va_end(ap);
+}
+
+// format one conversion, giving snprintf the width and precision arguments it asks for before the value
+template<typename T>
+int formatConversion(char* out, size_t size, const char* spec, const int* stars, int starCount, T value) {
+    switch (starCount) {
+    case 0: return snprintf(out, size, spec, value);
+    case 1: return snprintf(out, size, spec, stars[0], value);
+    default: return snprintf(out, size, spec, stars[0], stars[1], value);
+    }
+}
+
+// format the message in the record, from its captured arguments
+void formatRecord(const LogRecord* record, char* out, int outSize) {
+    if (record->preformatted) {
+        const char* text = record->spill ? record->spill : record->text;
+        int size = record->spill ? (int)strlen(record->spill) : (int)record->textSize;
+        int length = MIN(size, outSize - 1);
+        memcpy(out, text, length);
+        out[length] = '\0';
+        int cutBytes = (int)record->cutBytes + size - length;
+        if (cutBytes > 0) {
+            markTruncated(out, outSize, length, cutBytes);
+        }
+        return;
+    }
+
+    int written = 0;
+    int argIndex = 0;
+    const char* c = record->fmt;
+    while (*c && written < outSize - 1) {
+        if (*c != '%') {
+            out[written++] = *c++;
+            continue;
+        }
+        if (c[1] == '%') {
+            out[written++] = '%';
+            c += 2;
+            continue;
+        }
+
+        // copy the conversion out on its own, counting how many stars it has
+        char spec[32];
+        int specLength = 0;
+        int stars[2];
+        int starCount = 0;
+        bool done = false;
+        while (*c && !done && specLength < (int)sizeof(spec) - 1) {
+            char ch = *c++;
+            spec[specLength++] = ch;
+            if (ch == '*') {
+                if (starCount < 2 && argIndex < record->argCount) {
+                    stars[starCount++] = record->args[argIndex++].i;
+                }
+            } else if (specLength > 1 && strchr("diuoxXcfFeEgGaAps", ch)) {
+                done = true;
+            }
+        }
+        spec[specLength] = '\0';
+        if (!done || argIndex >= record->argCount) break;
+
+        char* to = out + written;
+        size_t room = (size_t)(outSize - written);
+        const LogArg& arg = record->args[argIndex];
+        int length = 0;
+        switch (record->argTypes[argIndex]) {
+        case LogArgType::Int: length = formatConversion(to, room, spec, stars, starCount, arg.i); break;
+        case LogArgType::Long: length = formatConversion(to, room, spec, stars, starCount, arg.l); break;
+        case LogArgType::LongLong: length = formatConversion(to, room, spec, stars, starCount, arg.ll); break;
+        case LogArgType::Size: length = formatConversion(to, room, spec, stars, starCount, arg.z); break;
+        case LogArgType::IntMax: length = formatConversion(to, room, spec, stars, starCount, arg.j); break;
+        case LogArgType::PtrDiff: length = formatConversion(to, room, spec, stars, starCount, arg.t); break;
+        case LogArgType::Double: length = formatConversion(to, room, spec, stars, starCount, arg.d); break;
+        case LogArgType::Pointer: length = formatConversion(to, room, spec, stars, starCount, arg.p); break;
+        case LogArgType::String: {
+            // strings weren't null terminated when they were copied in, so format with the length as the precision
+            char string[LogRecordTextSize + 1];
+            memcpy(string, record->text + arg.s.offset, arg.s.length);
+            string[arg.s.length] = '\0';
+            length = formatConversion(to, room, spec, stars, starCount, (const char*)string);
+            break;
+        }
+        }
+        argIndex++;
+        written += MIN(MAX(length, 0), (int)room - 1);
+    }
+    out[written] = '\0';
+}
+
+void writeRepeats(Logger* logger, LogQueue* queue) {
+    if (queue->repeats > 0) {
+        char text[128];
+        snprintf(text, sizeof(text), "(last message repeated %d more times)", queue->repeats);
+        logger->writeMessage(queue->lastCategory, queue->lastPriority, text);
+        queue->repeats = 0;
+    }
+}
+
+void writeText(Logger* logger, LogQueue* queue, LogCategory category, LogPriority priority, const char* text) {
+    if (category == queue->lastCategory && priority == queue->lastPriority && strcmp(text, queue->lastMessage) == 0) {
+        queue->repeats++;
+        return;
+    }
+    writeRepeats(logger, queue);
+    logger->writeMessage(category, priority, text);
+    strncpy(queue->lastMessage, text, MAX_LOG_MESSAGE_LENGTH - 1);
+    queue->lastMessage[MAX_LOG_MESSAGE_LENGTH - 1] = '\0';
+    queue->lastCategory = category;
+    queue->lastPriority = priority;
+}
+
+// report messages that were dropped, from call sites that haven't logged in a full window. Everything if all is set
+void reportDropped(Logger* logger, LogQueue* queue, bool all) {
+    Uint32 now = (Uint32)SDL_GetTicks();
+    for (int i = 0; i < LogSiteCount; i++) {
+        LogSite* site = &queue->sites[i];
+        if (!site->ready.load(std::memory_order_acquire)) continue;
+        if (site->suppressed.load(std::memory_order_relaxed) == 0) continue;
+        if (!all && now - site->windowStart.load(std::memory_order_relaxed) < RateLimitWindowMs) continue;
+
+        Uint32 suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed == 0) continue;
+        char text[512];
+        const LogLocation& location = site->location;
+        if (location.layout == LogLayout::FileLine || location.layout == LogLayout::FileLineFunction) {
+            snprintf(text, sizeof(text), "%s:%d - message repeated %u more times (\"%s\")", location.prefix, location.line, suppressed, site->fmt.load());
+        } else {
+            snprintf(text, sizeof(text), "message repeated %u more times (\"%s\")", suppressed, site->fmt.load());
+        }
+        writeRepeats(logger, queue);
+        logger->writeMessage(logger->category, LogPriority::Warn, text);
+    }
+
+    Uint32 dropped = queue->dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        char text[128];
+        snprintf(text, sizeof(text), "%u log messages were dropped because the log queue was full", dropped);
+        writeRepeats(logger, queue);
+        logger->writeMessage(logger->category, LogPriority::Warn, text);
+    }
+}
+
+bool beginConsuming(LogQueue* queue) {
+    bool consuming = false;
+    return queue->consuming.compare_exchange_strong(consuming, true, std::memory_order_acquire);
+}
+
+void endConsuming(LogQueue* queue) {
+    queue->consuming.store(false, std::memory_order_release);
+}
+
+// write out every record that's ready. Caller has to be consuming
+// @return The number of records written
+int drain(Logger* logger, LogQueue* queue) {
+    int count = 0;
+    char text[MAX_LOG_MESSAGE_LENGTH];
+    for (;;) {
+        Uint32 pos = queue->dequeuePos;
+        LogRecord* record = &queue->records[pos & (LogQueueSize - 1)];
+        Uint32 sequence = record->sequence.load(std::memory_order_acquire);
+        if ((Sint32)(sequence - (pos + 1)) < 0) break;
+
+        int prefixLength = formatLocation(text, MAX_LOG_MESSAGE_LENGTH, record->location);
+        formatRecord(record, text + prefixLength, MAX_LOG_MESSAGE_LENGTH - prefixLength);
+        // the heap might be what crashed, so a crash leaves it be
+        if (record->spill && !queue->crashing.load(std::memory_order_relaxed)) {
+            free(record->spill);
+        }
+        record->spill = nullptr;
+        LogCategory category = (LogCategory)record->category;
+        LogPriority priority = (LogPriority)record->priority;
+
+        record->sequence.store(pos + LogQueueSize, std::memory_order_release);
+        queue->dequeuePos = pos + 1;
+
+        writeText(logger, queue, category, priority, text);
+        count++;
+    }
+    return count;
+}
+
+void writerLoop(Logger* logger, LogQueue* queue) {
+    while (queue->running.load(std::memory_order_acquire)) {
+        int written = 0;
+        if (beginConsuming(queue)) {
+            written = drain(logger, queue);
+            Uint32 now = (Uint32)SDL_GetTicks();
+            if (now - queue->lastSweep >= RateLimitWindowMs / 4) {
+                reportDropped(logger, queue, false);
+                queue->lastSweep = now;
+            }
+            if (written == 0) {
+                writeRepeats(logger, queue);
+                fflush(stdout);
+                if (logger->outputFile) fflush(logger->outputFile);
+            }
+            endConsuming(queue);
+        }
+        if (written == 0) {
+            std::unique_lock<std::mutex> lock(queue->wakeMutex);
+            queue->wake.wait_for(lock, std::chrono::milliseconds(WriterIdleMs));
+        }
+    }
+}
+
+LogQueue* newLogQueue() {
+    LogQueue* queue = new LogQueue();
+    queue->records = Alloc<LogRecord>(LogQueueSize);
+    for (Uint32 i = 0; i < LogQueueSize; i++) {
+        new (&queue->records[i].sequence) std::atomic<Uint32>(i);
+    }
+    queue->enqueuePos.store(0);
+    queue->dequeuePos = 0;
+    queue->dropped.store(0);
+    queue->consuming.store(false);
+    queue->crashing.store(false);
+    queue->lastMessage[0] = '\0';
+    queue->lastPriority = LogPriority::Info;
+    queue->lastCategory = LogCategory::Main;
+    queue->repeats = 0;
+    queue->lastSweep = 0;
+    for (int i = 0; i < LogSiteCount; i++) {
+        LogSite* site = &queue->sites[i];
+        site->fmt.store(nullptr);
+        site->ready.store(false);
+        site->windowStart.store(0);
+        site->count.store(0);
+        site->suppressed.store(0);
+    }
+    return queue;
+}
+
+void startWriter(Logger* logger) {
+    logger->queue->running.store(true);
+    logger->queue->writer = std::thread(writerLoop, logger, logger->queue);
+}
+
+// stop the writer thread and write out what it left behind, leaving logging synchronous
+void stopWriter(Logger* logger) {
+    LogQueue* queue = logger->queue;
+    if (!queue) return;
+    queue->running.store(false, std::memory_order_release);
+    queue->wake.notify_one();
+    if (queue->writer.joinable()) {
+        queue->writer.join();
+    }
+    logger->flush();
+    logger->queue = nullptr;
+    Free(queue->records);
+    delete queue;
+}
+
+// stop the writer while everything it uses is still around
+void flushAtExit() {
+    gLogger.destroy();
+}
+
+void flushOnCrash(int signal) {
+    // Writing isn't signal safe, but the process is going down anyway and losing the messages before a crash is worse.
+    // Nothing gets locked or waited on though: if the records are being written out right now, maybe by the thread that crashed, they're left
+    LogQueue* queue = gLogger.queue;
+    if (queue) {
+        queue->crashing.store(true, std::memory_order_relaxed);
+        if (beginConsuming(queue)) {
+            drain(&gLogger, queue);
+            reportDropped(&gLogger, queue, true);
+            writeRepeats(&gLogger, queue);
+        }
+    }
+    fflush(stdout);
+    if (gLogger.outputFile) fflush(gLogger.outputFile);
+    ::signal(signal, SIG_DFL);
+    raise(signal);
+}
+
+}
+
+void Logger::writeMessage(LogCategory category, LogPriority priority, const char *message) const {
     const char* fg = "";
     const char* prefix = "";
     char end = '\n';
@@ -32,46 +723,116 @@ void Logger::logOutputFunction(LogCategory category, LogPriority priority, const
         break;
     }
 
-    int messageLength = strlen(message);
+    if (logToConsole) {
+        switch (category) {
+        using namespace LogCategories;
+        case Test:
+            printf("test message\n");
+            break;
+        default:
+            if (useEscapeCodes)
+                printf("\033[%s;0;%sm%s%s\033[0m%c", effect, fg, prefix, message, end);
+            else
+                printf("%s%s%c", prefix, message, end);
+            break;
+        }
+    }
 
-    char* text = Alloc<char>(messageLength + 128);
-    snprintf(text, messageLength+128, "%s%s", prefix, message);
+    if (outputFile) {
+        fputs(message, outputFile);
+        fputc('\n', outputFile);
+    }
 
-    char* consoleMessage = Alloc<char>(messageLength + 128);
-    if (useEscapeCodes)
-        snprintf(consoleMessage, messageLength + 128, "\033[%s;0;%sm%s\033[0m%c", effect, fg, text, end);
-    else
-        snprintf(consoleMessage, messageLength + 128, "%s%c", text, end);
+    // the console might not exist or be going away, so it's left to forwardConsoleMessages on the main thread to check.
+    // Messages written without a writer thread, once it's stopped, don't go to the console
+    if (queue && !queue->crashing.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(queue->consoleMutex);
+        if (queue->consoleMessages.size() < MaxConsoleMessages) {
+            queue->consoleMessages.push_back({message, priority});
+        }
+    }
+}
 
-    switch (category) {
-    using namespace LogCategories;
-    case Main:
-        printf("%s", consoleMessage);
-        break;
-    case Test:
-        printf("test message\n");
-        break;
-    default:
-        printf("%s", consoleMessage);
-        break;
+void Logger::logOutputFunction(void* arg, int category, SDL_LogPriority priority, const char *message) {
+    Logger* logger = static_cast<Logger*>(arg);
+    // SDL already formatted and filtered it. Every message has the same format, so they can't be rate limited by it
+    queueMessagef(logger, {LogLayout::Prefixed, "", "", 0}, (LogCategory)category, (LogPriority)priority, false, "%s", message);
+}
+
+int Logger::init(const char* outputFilepath) {
+    initialized = true;
+    queue = newLogQueue();
+    startWriter(this);
+    static bool registeredFlushes = false;
+    if (!registeredFlushes) {
+        atexit(flushAtExit);
+        signal(SIGSEGV, flushOnCrash);
+        signal(SIGABRT, flushOnCrash);
+        signal(SIGBUS, flushOnCrash);
+        signal(SIGILL, flushOnCrash);
+        signal(SIGFPE, flushOnCrash);
+        registeredFlushes = true;
     }
 
+    if (!outputFilepath)
+        return -1;
+    strncpy(logOutputFilepath, outputFilepath, 512);
+    outputFile = fopen(logOutputFilepath, "w+");
+    if (!outputFile)
+        return -1;
+    return 0;
+}
+
+void Logger::destroy() {
+    stopWriter(this);
     if (outputFile) {
-        char* fileMessage = Alloc<char>(messageLength+1);
-        strncpy(fileMessage, message, messageLength);
-        fileMessage[messageLength] = '\n';
-        fwrite(fileMessage, messageLength+1, 1, outputFile);
+        fclose(outputFile);
+        outputFile = NULL;
     }
+}
 
-    if (Debug && Debug->console) {
-        if (true)
-            Debug->console->newMessage(message, GUI::Console::MessageType::Error);
+void Logger::flush() {
+    if (queue) {
+        // if the thread writing crashed while writing, it's never going to stop, so don't wait for it forever
+        for (int tries = 0; !beginConsuming(queue); tries++) {
+            if (tries >= 100) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        drain(this, queue);
+        reportDropped(this, queue, true);
+        writeRepeats(this, queue);
+        endConsuming(queue);
     }
+    fflush(stdout);
+    if (outputFile) fflush(outputFile);
 }
 
-void Logger::logOutputFunction(void* arg, int category, SDL_LogPriority priority, const char *message) {
-    Logger* logger = static_cast<Logger*>(arg);
-    logger->logOutputFunction((LogCategory)category, (LogPriority)priority, message);
+void Logger::setPriorities(LogPriority priority) {
+    SDL_SetLogPriorities((SDL_LogPriority)priority);
+    for (int i = 0; i < MaxCategories; i++) {
+        minimumPriorities[i] = priority;
+    }
+}
+
+void Logger::setPriority(LogCategory category, LogPriority priority) {
+    SDL_SetLogPriority((int)category, (SDL_LogPriority)priority);
+    if ((int)category < MaxCategories) {
+        minimumPriorities[(int)category] = priority;
+    }
+}
+
+void Logger::forwardConsoleMessages() {
+    if (!queue) return;
+    std::vector<ConsoleMessage> messages;
+    {
+        std::lock_guard<std::mutex> lock(queue->consoleMutex);
+        messages.swap(queue->consoleMessages);
+    }
+    // picked up either way, so they don't pile up while there's no console
+    if (!Debug || !Debug->console) return;
+    for (auto& message : messages) {
+        Debug->console->newMessage(message.text.c_str(), GUI::Console::MessageType::Error, message.priority);
+    }
 }
 
 Logger gLogger;
@@ -81,18 +842,11 @@ void logAt(const char* file, int line, LogCategory category, LogPriority priorit
         printf("Logger not initalized yet!");
         return;
     }
-    
-    va_list ap;
-    char message[MAX_LOG_MESSAGE_LENGTH];
+    if (!gLogger.enabled(category, priority)) return;
 
+    va_list ap;
     va_start(ap, fmt);
-    vsnprintf(message, MAX_LOG_MESSAGE_LENGTH, fmt, ap);
-    if (gLogger.lastMessage == message) {
-        // do nothing?
-    } else {
-        gLogger.lastMessage = message;
-    }
-    SDL_LogMessage((int)category, (SDL_LogPriority)priority, "%s:%d - %s", file, line, message);
+    queueMessage(&gLogger, {LogLayout::FileLine, file, "", line}, category, priority, true, fmt, ap);
     va_end(ap);
 }
 
@@ -101,13 +855,11 @@ void logInternal(LogCategory category, LogPriority priority, const char* prefix,
         printf("Logger not initalized yet!");
         return;
     }
-    
-    va_list ap;
-    char message[MAX_LOG_MESSAGE_LENGTH];
+    if (!gLogger.enabled(category, priority)) return;
 
+    va_list ap;
     va_start(ap, fmt);
-    vsnprintf(message, MAX_LOG_MESSAGE_LENGTH, fmt, ap);
-    SDL_LogMessage((int)category, (SDL_LogPriority)priority, "%s%s", prefix, message);
+    queueMessage(&gLogger, {LogLayout::Prefixed, prefix, "", 0}, category, priority, true, fmt, ap);
     va_end(ap);
 }
 
@@ -116,13 +868,11 @@ void logInternal2(LogCategory category, LogPriority priority, const char* prefix
         printf("Logger not initalized yet!");
         return;
     }
-    
-    va_list ap;
-    char message[MAX_LOG_MESSAGE_LENGTH];
+    if (!gLogger.enabled(category, priority)) return;
 
+    va_list ap;
     va_start(ap, fmt);
-    vsnprintf(message, MAX_LOG_MESSAGE_LENGTH, fmt, ap);
-    SDL_LogMessage((int)category, (SDL_LogPriority)priority, "%s%s%s", prefix1, prefix2, message);
+    queueMessage(&gLogger, {LogLayout::TwoPrefixes, prefix1, prefix2, 0}, category, priority, true, fmt, ap);
     va_end(ap);
 }
 
@@ -131,22 +881,12 @@ void logInternal3(LogCategory category, LogPriority priority, const char* file,
         printf("Logger not initalized yet!");
         return;
     }
-    
-    va_list ap;
-    char message[MAX_LOG_MESSAGE_LENGTH];
+    if (!gLogger.enabled(category, priority)) return;
 
+    va_list ap;
     va_start(ap, fmt);
-    vsnprintf(message, MAX_LOG_MESSAGE_LENGTH, fmt, ap);
-    if (gLogger.lastMessage == message) {
-        // do nothing?
-        
-    }
-    {
-        gLogger.lastMessage = message;
-        // Format: FILE:LINE:FUNCTION - MESSAGE
-        // The FILE:LINE format is useful because in VSCode you can command click on it to bring you to the file.
-        SDL_LogMessage((int)category, (SDL_LogPriority)priority, "%s:%d:%s - %s", file, line, function, message);
-    }
+    // Format: FILE:LINE:FUNCTION - MESSAGE
+    // The FILE:LINE format is useful because in VSCode you can command click on it to bring you to the file.
+    queueMessage(&gLogger, {LogLayout::FileLineFunction, file, function, line}, category, priority, true, fmt, ap);
     va_end(ap);
 }
-
@@ -5,6 +5,17 @@ MetadataTracker::MetadataTracker(Uint32 targetFps, Uint32 targetTps, bool vsync)
 : frame(targetFps), tick(targetTps) {
     startTicks = 0; // just in case start() is never called.
     vsyncEnabled = vsync;
+    for (int i = 0; i < Timings::Count; i++) {
+        // frames come at their own rate, everything else happens once a tick
+        Uint32 rate = i == Timings::Frame ? targetFps : targetTps;
+        timings[i] = TimingStats::init(Timings::Names[i], rate * TimingWindowSeconds);
+    }
+}
+
+void MetadataTracker::destroy() {
+    for (int i = 0; i < Timings::Count; i++) {
+        timings[i].destroy();
+    }
 }
 
 Uint64 MetadataTracker::start() {
@@ -17,7 +28,13 @@ double MetadataTracker::end() {
 }
 
 Uint32 MetadataTracker::newFrame() {
-    return frame.update();
+    Uint32 frameCount = frame.update();
+    // the first frame doesn't have a frame before it to time from
+    if (frameCount > 1) {
+        Uint64 ns = (Uint64)((frame.currentPerfCount - frame.lastPerfCount) * 1.0e9 / (double)GetPerformanceFrequency());
+        timings[Timings::Frame].record(ns);
+    }
+    return frameCount;
 }
 
 Tick MetadataTracker::newTick() {
@@ -37,4 +54,8 @@ Uint64 MetadataTracker::getStartTicks() const {
     return startTicks;
 }
 
+bool MetadataTracker::dumpTimings(const char* filename) const {
+    return dumpTimingStats(filename, timings, Timings::Count);
+}
+
 const MetadataTracker* Metadata = NULL;
\ No newline at end of file
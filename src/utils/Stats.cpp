@@ -0,0 +1,132 @@
+#include "utils/Stats.hpp"
+#include "utils/common-macros.hpp"
+#include "utils/Log.hpp"
+#include "memory.hpp"
+
+#include <string.h>
+#include <SDL3/SDL_timer.h>
+
+void TimeHistogram::clear() {
+    memset(counts, 0, BucketCount * sizeof(Uint32));
+    samples = 0;
+    max = 0;
+}
+
+void TimeHistogram::merge(const TimeHistogram& other, int sign) {
+    for (int i = 0; i < BucketCount; i++) {
+        counts[i] += sign * other.counts[i];
+    }
+    samples += sign * other.samples;
+    if (sign > 0 && other.max > max) max = other.max;
+}
+
+Uint64 TimeHistogram::percentile(double fraction) const {
+    if (samples == 0) return 0;
+    // the time with this rank in the times sorted, counting from 1
+    Uint64 rank = (Uint64)SDL_ceil(fraction * (double)samples);
+    rank = MAX(rank, (Uint64)1);
+    Uint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // the middle of the bucket the max is in can be bigger than the max
+            return MIN(bucketMiddle(i), max);
+        }
+    }
+    return max;
+}
+
+static bool writeLittleEndian(FILE* file, Uint64 value, int bytes) {
+    Uint8 out[8];
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (Uint8)(value >> (i * 8));
+    }
+    return fwrite(out, 1, bytes, file) == (size_t)bytes;
+}
+
+bool TimeHistogram::write(FILE* file) const {
+    Uint32 used = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        if (counts[i]) used++;
+    }
+    bool ok = writeLittleEndian(file, samples, 8)
+           && writeLittleEndian(file, max, 8)
+           && writeLittleEndian(file, used, 4);
+    for (int i = 0; i < BucketCount && ok; i++) {
+        if (counts[i]) {
+            ok = writeLittleEndian(file, (Uint64)i, 2) && writeLittleEndian(file, counts[i], 4);
+        }
+    }
+    return ok;
+}
+
+TimingStats TimingStats::init(const char* name, int windowSamples) {
+    TimingStats self;
+    self.name = name;
+    self.windowSamples = MAX(windowSamples, Slots);
+    self.currentSlot = 0;
+    // every histogram's buckets in one allocation
+    self.buckets = Alloc<Uint32>((Slots + 2) * TimeHistogram::BucketCount);
+    TimeHistogram* histograms[Slots + 2] = {&self.total, &self.window};
+    for (int i = 0; i < Slots; i++) {
+        histograms[2 + i] = &self.slots[i];
+    }
+    for (int i = 0; i < Slots + 2; i++) {
+        histograms[i]->counts = self.buckets + i * TimeHistogram::BucketCount;
+        histograms[i]->clear();
+    }
+    return self;
+}
+
+void TimingStats::record(Uint64 ns) {
+    if (slots[currentSlot].samples >= (Uint64)(windowSamples / Slots)) {
+        // the newest slot is full, so the oldest one leaves the window to make room
+        currentSlot = (currentSlot + 1) % Slots;
+        TimeHistogram& oldest = slots[currentSlot];
+        window.merge(oldest, -1);
+        oldest.clear();
+        window.max = 0;
+        for (int i = 0; i < Slots; i++) {
+            window.max = MAX(window.max, slots[i].max);
+        }
+    }
+    slots[currentSlot].add(ns);
+    window.add(ns);
+    total.add(ns);
+}
+
+void TimingStats::destroy() {
+    Free(buckets);
+    buckets = nullptr;
+}
+
+ScopedTiming::ScopedTiming(TimingStats* stats) : stats(stats), start(SDL_GetTicksNS()) {}
+
+ScopedTiming::~ScopedTiming() {
+    stats->record(SDL_GetTicksNS() - start);
+}
+
+bool dumpTimingStats(const char* filename, const TimingStats* stats, int count) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        LogError("Failed to open %s to write timing stats to", filename);
+        return false;
+    }
+    constexpr Uint32 Version = 1;
+    bool ok = fwrite("FKTS", 1, 4, file) == 4
+           && writeLittleEndian(file, Version, 4)
+           && writeLittleEndian(file, TimeHistogram::SubBucketBits, 4)
+           && writeLittleEndian(file, TimeHistogram::BucketCount, 4)
+           && writeLittleEndian(file, count, 4);
+    for (int i = 0; i < count && ok; i++) {
+        size_t nameLength = MIN(strlen(stats[i].name), (size_t)255);
+        ok = writeLittleEndian(file, nameLength, 1)
+          && fwrite(stats[i].name, 1, nameLength, file) == nameLength
+          && stats[i].total.write(file);
+    }
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        LogError("Failed to write timing stats to %s", filename);
+    }
+    return ok;
+}
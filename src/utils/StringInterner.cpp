@@ -0,0 +1,180 @@
+#include "utils/StringInterner.hpp"
+#include "utils/common-macros.hpp"
+#include "utils/Log.hpp"
+#include "memory.hpp"
+
+#include <string.h>
+#include <assert.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+struct Entry {
+    const char* str;
+    Uint32 length;
+};
+
+// ids index pages of entries, so the entries never move and reading one doesn't need the lock
+constexpr int PageBits = 10;
+constexpr Uint32 PageSize = 1 << PageBits;
+constexpr Uint32 MaxPages = 4096; // about 4 million strings
+constexpr size_t TextBlockSize = 64 * 1024;
+
+// the text of the strings, packed one after another
+struct TextBlock {
+    TextBlock* next;
+    size_t used;
+    size_t size;
+};
+
+struct Interner {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view, Uint32> ids; // views of the text in the blocks
+    std::atomic<Entry*> pages[MaxPages];
+    std::atomic<Uint32> count; // ids handed out, counting the null string
+    TextBlock* blocks;
+
+    Interner() {
+        for (auto& page : pages) {
+            page.store(nullptr, std::memory_order_relaxed);
+        }
+        blocks = nullptr;
+        addNullString();
+    }
+
+    // the first id, always there
+    void addNullString() {
+        Entry* first = Alloc<Entry>(PageSize);
+        first[0] = Entry{"", 0};
+        pages[0].store(first, std::memory_order_release);
+        count.store(1, std::memory_order_release);
+    }
+
+    const char* copyText(const char* str, size_t length) {
+        size_t needed = length + 1;
+        if (!blocks || blocks->used + needed > blocks->size) {
+            size_t size = MAX(TextBlockSize, needed);
+            auto* block = (TextBlock*)Alloc(sizeof(TextBlock) + size);
+            block->next = blocks;
+            block->used = 0;
+            block->size = size;
+            blocks = block;
+        }
+        char* text = (char*)(blocks + 1) + blocks->used;
+        memcpy(text, str, length);
+        text[length] = '\0';
+        blocks->used += needed;
+        return text;
+    }
+
+    // has to be called with the lock held exclusively
+    Uint32 add(const char* str, size_t length) {
+        Uint32 id = count.load(std::memory_order_relaxed);
+        Uint32 pageIndex = id >> PageBits;
+        if (pageIndex >= MaxPages) {
+            LogCritical("Interned too many strings! Failed to intern \"%.*s\"", (int)length, str);
+            return 0;
+        }
+        Entry* page = pages[pageIndex].load(std::memory_order_relaxed);
+        if (!page) {
+            page = Alloc<Entry>(PageSize);
+            pages[pageIndex].store(page, std::memory_order_release);
+        }
+        const char* text = copyText(str, length);
+        page[id & (PageSize - 1)] = Entry{text, (Uint32)length};
+        ids.emplace(std::string_view(text, length), id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    const Entry& entry(Uint32 id) const {
+        if (id >= count.load(std::memory_order_acquire)) {
+            // never handed out, or handed out before the strings were freed
+            LogError("String id %u isn't interned!", id);
+            assert(false && "Not an interned string!");
+            id = 0;
+        }
+        return pages[id >> PageBits].load(std::memory_order_acquire)[id & (PageSize - 1)];
+    }
+
+    void destroy() {
+        std::unique_lock lock(mutex);
+        ids.clear();
+        for (auto& page : pages) {
+            Free(page.exchange(nullptr, std::memory_order_relaxed));
+        }
+        for (TextBlock* block = blocks; block; ) {
+            TextBlock* next = block->next;
+            Free(block);
+            block = next;
+        }
+        blocks = nullptr;
+        // back to how it started, so the null string still works and strings can be interned again
+        addNullString();
+    }
+};
+
+// never destroyed, so strings can still be interned while other statics are being destroyed
+Interner& interner() {
+    static Interner* self = new Interner();
+    return *self;
+}
+
+}
+
+const char* InternedString::str() const {
+    return interner().entry(id).str;
+}
+
+Uint32 InternedString::length() const {
+    return interner().entry(id).length;
+}
+
+InternedString intern(const char* str) {
+    if (!str) return NullInternedString;
+    return intern(str, strlen(str));
+}
+
+InternedString intern(const char* str, size_t length) {
+    if (!str || length == 0) return NullInternedString;
+    Interner& self = interner();
+    std::string_view text(str, length);
+    {
+        std::shared_lock lock(self.mutex);
+        auto it = self.ids.find(text);
+        if (it != self.ids.end()) {
+            return InternedString{it->second};
+        }
+    }
+    std::unique_lock lock(self.mutex);
+    // another thread could have added it between the locks
+    auto it = self.ids.find(text);
+    if (it != self.ids.end()) {
+        return InternedString{it->second};
+    }
+    return InternedString{self.add(str, length)};
+}
+
+InternedString findInterned(const char* str) {
+    if (!str || str[0] == '\0') return NullInternedString;
+    Interner& self = interner();
+    std::shared_lock lock(self.mutex);
+    auto it = self.ids.find(std::string_view(str));
+    if (it != self.ids.end()) {
+        return InternedString{it->second};
+    }
+    return NullInternedString;
+}
+
+int internedStringCount() {
+    // not counting the null string
+    return (int)interner().count.load(std::memory_order_acquire) - 1;
+}
+
+void freeInternedStrings() {
+    interner().destroy();
+}
@@ -0,0 +1,437 @@
+#include "world/Inserters.hpp"
+#include "utils/common-macros.hpp"
+#include "utils/Log.hpp"
+
+namespace World {
+
+Inserters Inserters::init(TransportLines* belts) {
+    Inserters self;
+    self.inserters = My::Vec<SimulatedInserter>::Empty();
+    self.freeInserters = My::Vec<int>::Empty();
+    self.active = My::Vec<int>::Empty();
+    self.waitLists = My::HashMap<Uint64, int, InserterWaitKeyHash>::WithBuckets(64);
+    self.containerUsers = My::HashMap<Uint32, int>::WithBuckets(64);
+    self.byEntity = My::HashMap<Uint32, int>::WithBuckets(64);
+    self.dropped = My::Vec<DroppedInserterStack>::Empty();
+    self.stats = {0, 0};
+    self.tick = 0;
+    self.belts = belts;
+    self.itemManager = nullptr;
+    return self;
+}
+
+void Inserters::destroy() {
+    inserters.destroy();
+    freeInserters.destroy();
+    active.destroy();
+    waitLists.destroy();
+    containerUsers.destroy();
+    byEntity.destroy();
+    dropped.destroy();
+}
+
+void Inserters::add(Entity entity, IVec2 tile, IVec2 sourceTile, IVec2 targetTile, int swingTicks, int stackSize) {
+    int index;
+    if (!freeInserters.empty()) {
+        index = freeInserters.popBack();
+    } else {
+        index = inserters.size;
+        inserters.push(SimulatedInserter{});
+    }
+
+    SimulatedInserter& inserter = inserters[index];
+    inserter.entity = entity;
+    inserter.tile = tile;
+    inserter.sourceTile = sourceTile;
+    inserter.targetTile = targetTile;
+    inserter.source = InserterEndpoint();
+    inserter.target = InserterEndpoint();
+    inserter.hand = ItemStack::None();
+    inserter.stackSize = MAX(stackSize, 1);
+    inserter.swingTicks = MAX(swingTicks, 1);
+    inserter.swingDone = 0;
+    inserter.state = InserterState::PickingUp;
+    inserter.waitKey = 0;
+    inserter.prevWaiter = -1;
+    inserter.nextWaiter = -1;
+    inserter.activeIndex = -1;
+    inserter.alive = true;
+
+    byEntity.insert(entity.id, index);
+    stats.inserters++;
+    // starts awake so it can find its source and target
+    wakeInserter(index);
+}
+
+void Inserters::remove(Entity entity) {
+    int* indexPtr = byEntity.lookup(entity.id);
+    if (!indexPtr) {
+        LogError("Couldn't find inserter to remove. Entity: %s", entity.DebugStr());
+        return;
+    }
+    int index = *indexPtr;
+    byEntity.remove(entity.id);
+
+    SimulatedInserter& inserter = inserters[index];
+    if (inserter.waitKey) unlinkWaiter(index);
+    if (inserter.activeIndex != -1) removeActive(index);
+    if (inserter.source.kind == InserterEndpoint::Container) unlinkUser(userNode(index, false));
+    if (inserter.target.kind == InserterEndpoint::Container) unlinkUser(userNode(index, true));
+    if (!inserter.hand.empty()) {
+        dropped.push({Vec2(inserter.tile.x + 0.5f, inserter.tile.y + 0.5f), inserter.hand});
+    }
+    inserter.alive = false;
+    freeInserters.push(index);
+    stats.inserters--;
+}
+
+void Inserters::removeActive(int index) {
+    SimulatedInserter& inserter = inserters[index];
+    int activeIndex = inserter.activeIndex;
+    int last = active.back();
+    active[activeIndex] = last;
+    inserters[last].activeIndex = activeIndex;
+    active.popBack();
+    inserter.activeIndex = -1;
+}
+
+void Inserters::sleep(int index, Uint64 key) {
+    removeActive(index);
+
+    SimulatedInserter& inserter = inserters[index];
+    inserter.waitKey = key;
+    inserter.prevWaiter = -1;
+    int* head = waitLists.lookup(key);
+    if (head) {
+        inserter.nextWaiter = *head;
+        if (*head != -1) {
+            inserters[*head].prevWaiter = index;
+        }
+        *head = index;
+    } else {
+        inserter.nextWaiter = -1;
+        waitLists.insert(key, index);
+    }
+}
+
+void Inserters::unlinkWaiter(int index) {
+    SimulatedInserter& inserter = inserters[index];
+    if (inserter.nextWaiter != -1) {
+        inserters[inserter.nextWaiter].prevWaiter = inserter.prevWaiter;
+    }
+    if (inserter.prevWaiter != -1) {
+        inserters[inserter.prevWaiter].nextWaiter = inserter.nextWaiter;
+    } else {
+        *waitLists.lookup(inserter.waitKey) = inserter.nextWaiter;
+    }
+    inserter.waitKey = 0;
+    inserter.prevWaiter = -1;
+    inserter.nextWaiter = -1;
+}
+
+void Inserters::wakeInserter(int index) {
+    SimulatedInserter& inserter = inserters[index];
+    if (inserter.activeIndex != -1) return;
+    if (inserter.waitKey) unlinkWaiter(index);
+    inserter.activeIndex = active.size;
+    active.push(index);
+}
+
+void Inserters::wake(Uint64 key) {
+    int* head = waitLists.lookup(key);
+    if (!head) return;
+
+    int index = *head;
+    *head = -1;
+    while (index != -1) {
+        SimulatedInserter& inserter = inserters[index];
+        int next = inserter.nextWaiter;
+        inserter.waitKey = 0;
+        inserter.prevWaiter = -1;
+        inserter.nextWaiter = -1;
+        inserter.activeIndex = active.size;
+        active.push(index);
+        index = next;
+    }
+}
+
+void Inserters::inventoryChanged(const ItemStack* inventoryItems, bool added) {
+    if (inventoryItems) {
+        // pickers wait for items to be added, droppers for some to be taken out
+        Uint64 key = (Uint64)(uintptr_t)inventoryItems;
+        wake(added ? key : key | RoomWaitKeyBit);
+    }
+}
+
+void Inserters::linkUser(int node) {
+    InserterEndpoint& endpoint = endpointOf(node);
+    endpoint.prevUser = -1;
+    int* head = containerUsers.lookup(endpoint.container.id);
+    if (head) {
+        endpoint.nextUser = *head;
+        endpointOf(*head).prevUser = node;
+        *head = node;
+    } else {
+        endpoint.nextUser = -1;
+        containerUsers.insert(endpoint.container.id, node);
+    }
+}
+
+void Inserters::unlinkUser(int node) {
+    InserterEndpoint& endpoint = endpointOf(node);
+    if (endpoint.nextUser != -1) {
+        endpointOf(endpoint.nextUser).prevUser = endpoint.prevUser;
+    }
+    if (endpoint.prevUser != -1) {
+        endpointOf(endpoint.prevUser).nextUser = endpoint.nextUser;
+    } else {
+        if (endpoint.nextUser != -1) {
+            *containerUsers.lookup(endpoint.container.id) = endpoint.nextUser;
+        } else {
+            // unlike wait lists, a container only gets used by the inserters placed next to it, so don't keep the key around
+            containerUsers.remove(endpoint.container.id);
+        }
+    }
+    endpoint.prevUser = -1;
+    endpoint.nextUser = -1;
+}
+
+void Inserters::inventoryRemoved(Entity container, const Inventory& inventory) {
+    int* head = containerUsers.lookup(container.id);
+    int node = head ? *head : -1;
+    while (node != -1) {
+        InserterEndpoint& endpoint = endpointOf(node);
+        int next = endpoint.nextUser;
+        endpoint.kind = InserterEndpoint::None;
+        endpoint.container = NullEntity;
+        endpoint.prevUser = -1;
+        endpoint.nextUser = -1;
+        wakeInserter(node / 2);
+        node = next;
+    }
+    containerUsers.remove(container.id);
+    if (inventory.items) {
+        // nothing will wait on these items again
+        Uint64 key = (Uint64)(uintptr_t)inventory.items;
+        waitLists.remove(key);
+        waitLists.remove(key | RoomWaitKeyBit);
+    }
+}
+
+void Inserters::containersChanged() {
+    wake(UnconnectedWaitKey);
+}
+
+void Inserters::beltLineChanged(TransportLineID line) {
+    wake(BeltWaitKeyBit | (Uint32)line);
+}
+
+void Inserters::beltLineRebuilt(TransportLineID line) {
+    // the key stays, since the id gets reused by another line
+    wake(BeltWaitKeyBit | (Uint32)line);
+}
+
+void Inserters::wakeAll() {
+    for (int i = 0; i < inserters.size; i++) {
+        if (inserters[i].alive) {
+            wakeInserter(i);
+        }
+    }
+}
+
+Inventory* Inserters::inventoryOf(const InserterEndpoint& endpoint) const {
+    if (endpoint.kind != InserterEndpoint::Container || !containerInventory) return nullptr;
+    Inventory* inventory = containerInventory(endpoint.container);
+    return inventory && inventory->items ? inventory : nullptr;
+}
+
+bool Inserters::resolve(int index, bool target) {
+    IVec2 tile = target ? inserters[index].targetTile : inserters[index].sourceTile;
+    InserterEndpoint* endpoint = target ? &inserters[index].target : &inserters[index].source;
+    int node = userNode(index, target);
+    if (endpoint->kind == InserterEndpoint::Belt && !(belts && belts->belts.lookup(tile))) {
+        endpoint->kind = InserterEndpoint::None;
+    }
+    if (endpoint->kind == InserterEndpoint::Container && !inventoryOf(*endpoint)) {
+        // the container's gone, even if its id is being used by something else now
+        unlinkUser(node);
+        endpoint->kind = InserterEndpoint::None;
+        endpoint->container = NullEntity;
+    }
+    if (endpoint->kind != InserterEndpoint::None) return true;
+
+    if (belts && belts->belts.lookup(tile)) {
+        endpoint->kind = InserterEndpoint::Belt;
+        return true;
+    }
+    Entity container;
+    if (findContainer && findContainer(tile, &container)) {
+        endpoint->kind = InserterEndpoint::Container;
+        endpoint->container = container;
+        if (inventoryOf(*endpoint)) {
+            linkUser(node);
+            return true;
+        }
+        endpoint->kind = InserterEndpoint::None;
+        endpoint->container = NullEntity;
+    }
+    return false;
+}
+
+Uint64 Inserters::waitKey(IVec2 tile, const InserterEndpoint& endpoint, bool dropping) const {
+    switch (endpoint.kind) {
+    case InserterEndpoint::Container: {
+        const Inventory* inventory = inventoryOf(endpoint);
+        if (!inventory) return UnconnectedWaitKey;
+        Uint64 key = (Uint64)(uintptr_t)inventory->items;
+        return dropping ? key | RoomWaitKeyBit : key;
+    }
+    case InserterEndpoint::Belt: {
+        // drops go on the far lane in the middle of the belt, same as in drop()
+        int ticks = dropping ? belts->ticksUntilRoom(tile, 1, 0.5f) : belts->ticksUntilItem(tile);
+        if (ticks >= 0) {
+            return TimedWaitKeyBit | (tick + MAX(ticks, 1));
+        }
+        return BeltWaitKeyBit | (Uint32)belts->belts.lookup(tile)->line;
+    }
+    default:
+        return UnconnectedWaitKey;
+    }
+}
+
+bool Inserters::pickUp(SimulatedInserter& inserter) {
+    if (inserter.source.kind == InserterEndpoint::Belt) {
+        Item item;
+        for (int lane = 0; lane < TransportLine::NumLanes; lane++) {
+            if (belts->takeItem(inserter.sourceTile, lane, &item)) {
+                inserter.hand = ItemStack(item, 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Inventory* inventory = inventoryOf(inserter.source);
+    if (!inventory) return false;
+    for (int i = 0; i < inventory->size; i++) {
+        const ItemStack stack = inventory->get(i);
+        if (stack.empty()) continue;
+        if (stack.infinite()) {
+            inserter.hand = ItemStack(stack.item, inserter.stackSize);
+            if (itemManager) itemManager->retain(stack.item);
+            return true;
+        }
+
+        if (stack.quantity <= (ItemQuantity)inserter.stackSize) {
+            // the slot's reference moves to the hand along with the item
+            inserter.hand = stack;
+            inventory->setSlot(i, ItemStack::None());
+        } else {
+            inserter.hand = ItemStack(stack.item, inserter.stackSize);
+            inventory->setSlot(i, ItemStack(stack.item, stack.quantity - inserter.stackSize));
+            // both the slot and the hand have the item now
+            if (itemManager) itemManager->retain(stack.item);
+        }
+        inventory->changed(false);
+        return true;
+    }
+    return false;
+}
+
+bool Inserters::drop(SimulatedInserter& inserter) {
+    ItemStack& hand = inserter.hand;
+    if (inserter.target.kind == InserterEndpoint::Belt) {
+        // one at a time, since items on a belt need space between them
+        if (!belts->insertItem(inserter.targetTile, 1, 0.5f, hand.item)) {
+            return false;
+        }
+        // every item on a belt holds a reference. The last one takes the hand's
+        if (hand.quantity > 1 && itemManager) itemManager->retain(hand.item);
+        hand.quantity--;
+    } else {
+        Inventory* inventory = inventoryOf(inserter.target);
+        if (!inventory) return false;
+        // the inventory takes its own reference
+        ItemQuantity added = inventory->addItemStack(hand);
+        if (added == 0) return false;
+        hand.quantity -= added;
+        if (hand.quantity == 0 && itemManager) itemManager->release(hand.item);
+    }
+
+    if (hand.quantity == 0) {
+        hand = ItemStack::None();
+    }
+    return true;
+}
+
+bool Inserters::step(int index) {
+    SimulatedInserter& inserter = inserters[index];
+    switch (inserter.state) {
+    case InserterState::PickingUp:
+        if (!resolve(index, false)) {
+            sleep(index, UnconnectedWaitKey);
+            return false;
+        }
+        if (!pickUp(inserter)) {
+            sleep(index, waitKey(inserter.sourceTile, inserter.source, false));
+            return false;
+        }
+        inserter.state = InserterState::SwingingToTarget;
+        inserter.swingDone = tick + inserter.swingTicks;
+        // nothing to do until the swing is done
+        sleep(index, TimedWaitKeyBit | inserter.swingDone);
+        return false;
+    case InserterState::SwingingToTarget:
+        // might have been woken early by something else
+        if (tick < inserter.swingDone) {
+            sleep(index, TimedWaitKeyBit | inserter.swingDone);
+            return false;
+        }
+        inserter.state = InserterState::Dropping;
+        [[fallthrough]];
+    case InserterState::Dropping: {
+        if (!resolve(index, true)) {
+            sleep(index, UnconnectedWaitKey);
+            return false;
+        }
+        bool placed = drop(inserter);
+        if (inserter.hand.empty()) {
+            inserter.state = InserterState::SwingingBack;
+            inserter.swingDone = tick + inserter.swingTicks;
+            sleep(index, TimedWaitKeyBit | inserter.swingDone);
+            return false;
+        } else if (!placed) {
+            sleep(index, waitKey(inserter.targetTile, inserter.target, true));
+            return false;
+        }
+        break;
+    }
+    case InserterState::SwingingBack:
+        if (tick < inserter.swingDone) {
+            sleep(index, TimedWaitKeyBit | inserter.swingDone);
+            return false;
+        }
+        inserter.state = InserterState::PickingUp;
+        break;
+    }
+    return true;
+}
+
+void Inserters::update() {
+    // wake whatever was sleeping until now. Nothing sleeps until a tick that already went by, so the key can go
+    Uint64 timedKey = TimedWaitKeyBit | tick;
+    wake(timedKey);
+    waitLists.remove(timedKey);
+
+    stats.awake = active.size;
+    // inserters woken during the update get added to the end and still get updated this tick
+    for (int i = 0; i < active.size;) {
+        // going to sleep swaps the last active inserter into this spot
+        if (step(active[i])) {
+            i++;
+        }
+    }
+    tick++;
+}
+
+}
@@ -0,0 +1,527 @@
+#include "world/Pathfinding.hpp"
+#include <algorithm>
+#include "utils/common-macros.hpp"
+#include "utils/Log.hpp"
+
+namespace World {
+
+static_assert(CHUNKSIZE <= 64, "a row of a chunk's walkability has to fit in a Uint64");
+
+static constexpr int ChunkTiles = CHUNKSIZE * CHUNKSIZE;
+static constexpr Uint32 Unreachable = Pathfinding::Unreachable;
+
+static const IVec2 SideDirections[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+static int oppositeSide(int side) {
+    return side ^ 1;
+}
+
+static int localIndex(IVec2 tile, IVec2 chunk) {
+    return (tile.y - chunk.y * CHUNKSIZE) * CHUNKSIZE + (tile.x - chunk.x * CHUNKSIZE);
+}
+
+static bool walkableBit(const NavChunk& nav, int x, int y) {
+    return (nav.walkable[y] >> x) & 1;
+}
+
+// the walkability of the tiles along a side of the chunk, as bits
+static Uint64 edgeBits(const NavChunk& nav, int side) {
+    switch (side) {
+    case NavChunk::NegY: return nav.walkable[0];
+    case NavChunk::PosY: return nav.walkable[CHUNKSIZE - 1];
+    default: {
+        int x = side == NavChunk::NegX ? 0 : CHUNKSIZE - 1;
+        Uint64 bits = 0;
+        for (int y = 0; y < CHUNKSIZE; y++) {
+            bits |= ((nav.walkable[y] >> x) & 1) << y;
+        }
+        return bits;
+    }
+    }
+}
+
+// local position of the tile i along the side of a chunk
+static IVec2 edgeTile(int side, int i) {
+    switch (side) {
+    case NavChunk::NegX: return {0, i};
+    case NavChunk::PosX: return {CHUNKSIZE - 1, i};
+    case NavChunk::NegY: return {i, 0};
+    default: return {i, CHUNKSIZE - 1};
+    }
+}
+
+static void buildBitmap(NavChunk& nav, const ChunkData* chunkdata) {
+    for (int row = 0; row < CHUNKSIZE; row++) {
+        Uint64 bits = 0;
+        for (int col = 0; col < CHUNKSIZE; col++) {
+            TileType type = (*chunkdata->chunk)[row][col].type;
+            if (TileTypeData[type].flags & TileTypes::Walkable) {
+                bits |= 1ULL << col;
+            }
+        }
+        nav.walkable[row] = bits;
+    }
+}
+
+static void destroyField(FlowField& field) {
+    for (int i = 0; i < field.chunks.bucketCount; i++) {
+        if (field.chunks.buckets()[i].state == My::Map::Bucket_Filled) {
+            Free(field.chunks.values()[i].costs);
+        }
+    }
+    for (int i = 0; i < field.portalDistances.bucketCount; i++) {
+        if (field.portalDistances.buckets()[i].state == My::Map::Bucket_Filled) {
+            field.portalDistances.values()[i].destroy();
+        }
+    }
+    field.chunks.destroy();
+    field.portalDistances.destroy();
+}
+
+Pathfinding Pathfinding::init(const ChunkMap* chunkmap) {
+    Pathfinding pathfinding;
+    pathfinding.chunkmap = chunkmap;
+    pathfinding.chunks = My::HashMap<IVec2, NavChunk, IVec2Hash>::WithBuckets(64);
+    pathfinding.fields = My::HashMap<Uint32, FlowField>::WithBuckets(8);
+    pathfinding.graphVersion = 0;
+    pathfinding.tick = 0;
+    pathfinding.stats = {};
+    pathfinding.scratchCosts = My::Vec<Uint32>::WithCapacity(ChunkTiles);
+    pathfinding.scratchCosts.resize(ChunkTiles);
+    pathfinding.scratchQueue = My::Vec<Uint16>::WithCapacity(ChunkTiles);
+    pathfinding.scratchQueue.resize(ChunkTiles);
+    pathfinding.scratchSeeds = My::Vec<Uint64>::Empty();
+    pathfinding.open = My::Vec<PortalSearchNode>::Empty();
+    return pathfinding;
+}
+
+void Pathfinding::destroy() {
+    for (int i = 0; i < fields.bucketCount; i++) {
+        if (fields.buckets()[i].state == My::Map::Bucket_Filled) {
+            destroyField(fields.values()[i]);
+        }
+    }
+    for (int i = 0; i < chunks.bucketCount; i++) {
+        if (chunks.buckets()[i].state == My::Map::Bucket_Filled) {
+            NavChunk& nav = chunks.values()[i];
+            nav.portals.destroy();
+            nav.portalSides.destroy();
+            nav.portalCosts.destroy();
+        }
+    }
+    fields.destroy();
+    chunks.destroy();
+    scratchCosts.destroy();
+    scratchQueue.destroy();
+    scratchSeeds.destroy();
+    open.destroy();
+}
+
+NavChunk* Pathfinding::navChunk(IVec2 chunk) {
+    NavChunk* nav = chunks.lookup(chunk);
+    const ChunkData* chunkdata;
+    if (nav) {
+        if (nav->exists) return nav;
+        // chunks get generated as they're needed, so it might be there now
+        chunkdata = chunkmap->get(chunk);
+        if (!chunkdata) return nav;
+        // the portals of everything next to it were made without it
+        graphVersion++;
+    } else {
+        NavChunk newNav;
+        memset(newNav.walkable, 0, sizeof(newNav.walkable));
+        newNav.portals = My::Vec<IVec2>::Empty();
+        newNav.portalSides = My::Vec<Uint8>::Empty();
+        newNav.portalCosts = My::Vec<Uint32>::Empty();
+        newNav.version = 0;
+        newNav.neighbours = 0;
+        newNav.exists = false;
+        newNav.portalsBuilt = false;
+        nav = chunks.insert(chunk, newNav);
+        chunkdata = chunkmap->get(chunk);
+        if (!chunkdata) return nav;
+    }
+
+    buildBitmap(*nav, chunkdata);
+    nav->exists = true;
+    nav->version++;
+    nav->portalsBuilt = false;
+    return nav;
+}
+
+NavChunk* Pathfinding::navChunkWithPortals(IVec2 chunk) {
+    NavChunk* nav = navChunk(chunk);
+    Uint8 neighbours = 0;
+    for (int side = 0; side < 4; side++) {
+        if (chunkmap->existsAt(chunk + SideDirections[side])) {
+            neighbours |= 1 << side;
+        }
+    }
+    if (!nav->portalsBuilt || nav->neighbours != neighbours) {
+        buildPortals(chunk);
+        nav = chunks.lookup(chunk);
+    }
+    return nav;
+}
+
+void Pathfinding::buildPortals(IVec2 chunk) {
+    // get the neighbours first, since making them can move this chunk
+    Uint64 neighbourEdges[4];
+    Uint8 neighbours = 0;
+    for (int side = 0; side < 4; side++) {
+        const NavChunk* neighbour = navChunk(chunk + SideDirections[side]);
+        neighbourEdges[side] = edgeBits(*neighbour, oppositeSide(side));
+        if (neighbour->exists) {
+            neighbours |= 1 << side;
+        }
+    }
+
+    NavChunk* nav = navChunk(chunk);
+    nav->portals.size = 0;
+    nav->portalSides.size = 0;
+    const IVec2 origin = chunk * CHUNKSIZE;
+    for (int side = 0; side < 4; side++) {
+        // tiles that are open on both sides of the edge
+        Uint64 open = edgeBits(*nav, side) & neighbourEdges[side];
+        // each run of open tiles gets its own portals.
+        // The neighbour makes the same runs from the other side, so its portals line up with these
+        int i = 0;
+        while (i < CHUNKSIZE) {
+            if (!((open >> i) & 1)) {
+                i++;
+                continue;
+            }
+            int start = i;
+            while (i < CHUNKSIZE && ((open >> i) & 1)) {
+                i++;
+            }
+            int end = i - 1;
+            if (end - start + 1 >= WidePortal) {
+                nav->portals.push(origin + edgeTile(side, start));
+                nav->portalSides.push(side);
+                nav->portals.push(origin + edgeTile(side, end));
+                nav->portalSides.push(side);
+            } else {
+                nav->portals.push(origin + edgeTile(side, (start + end) / 2));
+                nav->portalSides.push(side);
+            }
+        }
+    }
+
+    const int count = nav->portals.size;
+    nav->portalCosts.resize(count * count);
+    for (int p = 0; p < count; p++) {
+        Uint64 seed = (Uint64)localIndex(nav->portals[p], chunk);
+        fillChunk(*nav, &seed, 1, scratchCosts.data);
+        for (int q = 0; q < count; q++) {
+            nav->portalCosts[p * count + q] = scratchCosts[localIndex(nav->portals[q], chunk)];
+        }
+    }
+
+    nav->neighbours = neighbours;
+    nav->portalsBuilt = true;
+    stats.chunkRebuilds++;
+}
+
+void Pathfinding::fillChunk(const NavChunk& nav, const Uint64* seeds, int seedCount, Uint32* costsOut) {
+    for (int i = 0; i < ChunkTiles; i++) {
+        costsOut[i] = Unreachable;
+    }
+
+    // breadth first, but seeds can start at any distance, so they get merged in as the queue reaches their distance.
+    // Everything in the queue is within one of the front, so the queue stays in order
+    Uint16* queue = scratchQueue.data;
+    int head = 0;
+    int tail = 0;
+    int nextSeed = 0;
+    while (nextSeed < seedCount || head < tail) {
+        int index;
+        if (nextSeed < seedCount && (head == tail || (Uint32)(seeds[nextSeed] >> 32) <= costsOut[queue[head]])) {
+            index = (int)(Uint32)seeds[nextSeed];
+            Uint32 distance = (Uint32)(seeds[nextSeed] >> 32);
+            nextSeed++;
+            // already reached from a closer seed
+            if (costsOut[index] != Unreachable) continue;
+            costsOut[index] = distance;
+        } else {
+            index = queue[head++];
+        }
+
+        const Uint32 next = costsOut[index] + 1;
+        const int x = index % CHUNKSIZE;
+        const int y = index / CHUNKSIZE;
+        auto visit = [&](int nx, int ny){
+            int neighbour = ny * CHUNKSIZE + nx;
+            if (costsOut[neighbour] == Unreachable && walkableBit(nav, nx, ny)) {
+                costsOut[neighbour] = next;
+                queue[tail++] = (Uint16)neighbour;
+            }
+        };
+        if (x > 0) visit(x - 1, y);
+        if (x < CHUNKSIZE - 1) visit(x + 1, y);
+        if (y > 0) visit(x, y - 1);
+        if (y < CHUNKSIZE - 1) visit(x, y + 1);
+    }
+}
+
+Uint32* Pathfinding::distancesOf(FlowField& field, IVec2 chunk, int portalCount) {
+    My::Vec<Uint32>* distances = field.portalDistances.lookup(chunk);
+    if (!distances) {
+        distances = field.portalDistances.insert(chunk, My::Vec<Uint32>::Empty());
+    }
+    // empty until the search first gets to the chunk
+    if (distances->size != portalCount) {
+        distances->size = 0;
+        distances->resize(portalCount, Unreachable);
+    }
+    return distances->data;
+}
+
+void Pathfinding::search(FlowField& field) {
+    stats.searches++;
+    field.searches++;
+    // keep the memory around, but forget every distance
+    for (int i = 0; i < field.portalDistances.bucketCount; i++) {
+        if (field.portalDistances.buckets()[i].state == My::Map::Bucket_Filled) {
+            field.portalDistances.values()[i].size = 0;
+        }
+    }
+
+    auto closer = [](const PortalSearchNode& lhs, const PortalSearchNode& rhs){
+        return lhs.distance > rhs.distance;
+    };
+    open.size = 0;
+
+    // start from the portals of the target's chunk, at their distance from the target
+    const IVec2 targetChunk = toChunkPosition(field.targetTile);
+    const NavChunk* nav = navChunkWithPortals(targetChunk);
+    Uint64 targetSeed = (Uint64)localIndex(field.targetTile, targetChunk);
+    fillChunk(*nav, &targetSeed, 1, scratchCosts.data);
+    Uint32* distances = distancesOf(field, targetChunk, nav->portals.size);
+    for (int i = 0; i < nav->portals.size; i++) {
+        Uint32 distance = scratchCosts[localIndex(nav->portals[i], targetChunk)];
+        if (distance == Unreachable) continue;
+        distances[i] = distance;
+        open.push({distance, targetChunk, i});
+        std::push_heap(open.begin(), open.end(), closer);
+    }
+
+    auto relax = [&](IVec2 chunk, int portal, int portalCount, Uint32 distance){
+        Uint32* distances = distancesOf(field, chunk, portalCount);
+        if (distance < distances[portal]) {
+            distances[portal] = distance;
+            open.push({distance, chunk, portal});
+            std::push_heap(open.begin(), open.end(), closer);
+        }
+    };
+
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), closer);
+        PortalSearchNode node = open.popBack();
+        nav = navChunkWithPortals(node.chunk);
+        const int count = nav->portals.size;
+        if (node.distance > distancesOf(field, node.chunk, count)[node.portal]) continue;
+
+        // other portals in the same chunk
+        for (int j = 0; j < count; j++) {
+            Uint32 cost = nav->portalCosts[node.portal * count + j];
+            if (j == node.portal || cost == Unreachable) continue;
+            relax(node.chunk, j, count, node.distance + cost);
+        }
+
+        // the portal on the other side of the edge
+        const int side = nav->portalSides[node.portal];
+        const IVec2 neighbourChunk = node.chunk + SideDirections[side];
+        if (abs(neighbourChunk.x - targetChunk.x) > SearchRadius || abs(neighbourChunk.y - targetChunk.y) > SearchRadius) continue;
+        const IVec2 across = nav->portals[node.portal] + SideDirections[side];
+        const NavChunk* neighbour = navChunkWithPortals(neighbourChunk);
+        for (int k = 0; k < neighbour->portals.size; k++) {
+            if (neighbour->portals[k] == across && neighbour->portalSides[k] == oppositeSide(side)) {
+                relax(neighbourChunk, k, neighbour->portals.size, node.distance + 1);
+                break;
+            }
+        }
+    }
+
+    field.graphVersion = graphVersion;
+    field.searched = true;
+}
+
+const Uint32* Pathfinding::chunkCosts(FlowField& field, IVec2 chunk) {
+    FlowFieldChunk* chunkField = field.chunks.lookup(chunk);
+    if (chunkField && chunkField->search == field.searches) {
+        return chunkField->costs;
+    }
+
+    const IVec2 targetChunk = toChunkPosition(field.targetTile);
+    const My::Vec<Uint32>* distances = field.portalDistances.lookup(chunk);
+    // the search never got here
+    if (chunk != targetChunk && (!distances || distances->size == 0)) return nullptr;
+
+    const NavChunk* nav = navChunkWithPortals(chunk);
+    scratchSeeds.size = 0;
+    if (chunk == targetChunk) {
+        scratchSeeds.push((Uint64)localIndex(field.targetTile, chunk));
+    }
+    if (distances && distances->size == nav->portals.size) {
+        for (int i = 0; i < distances->size; i++) {
+            if ((*distances)[i] == Unreachable) continue;
+            scratchSeeds.push(((Uint64)(*distances)[i] << 32) | (Uint64)localIndex(nav->portals[i], chunk));
+        }
+    }
+    std::sort(scratchSeeds.begin(), scratchSeeds.end());
+
+    Uint64 seedHash = 14695981039346656037ULL;
+    for (Uint64 seed : scratchSeeds) {
+        seedHash = (seedHash ^ seed) * 1099511628211ULL;
+    }
+
+    chunkField = field.chunks.lookup(chunk);
+    if (chunkField && chunkField->seedHash == seedHash && chunkField->navVersion == nav->version) {
+        // the target moved or some other chunk changed, but nothing that matters here
+        chunkField->search = field.searches;
+        return chunkField->costs;
+    }
+    if (!chunkField) {
+        chunkField = field.chunks.insert(chunk, {Alloc<Uint32>(ChunkTiles), 0, 0, 0});
+    }
+    fillChunk(*nav, scratchSeeds.data, scratchSeeds.size, chunkField->costs);
+    chunkField->seedHash = seedHash;
+    chunkField->navVersion = nav->version;
+    chunkField->search = field.searches;
+    stats.chunkFields++;
+    return chunkField->costs;
+}
+
+Uint32 Pathfinding::cost(FlowField& field, IVec2 tile) {
+    IVec2 chunk = toChunkPosition(tile);
+    const Uint32* costs = chunkCosts(field, chunk);
+    return costs ? costs[localIndex(tile, chunk)] : Unreachable;
+}
+
+FlowField* Pathfinding::getField(Entity target, IVec2 targetTile) {
+    FlowField* field = fields.lookup(target.id);
+    if (!field) {
+        FlowField newField;
+        newField.target = target;
+        newField.targetTile = targetTile;
+        newField.graphVersion = graphVersion;
+        newField.searched = false;
+        newField.searches = 0;
+        newField.portalDistances = My::HashMap<IVec2, My::Vec<Uint32>, IVec2Hash>::WithBuckets(16);
+        newField.chunks = My::HashMap<IVec2, FlowFieldChunk, IVec2Hash>::WithBuckets(16);
+        field = fields.insert(target.id, newField);
+        stats.fields = fields.size;
+    }
+
+    if (field->targetTile != targetTile || field->target.version != target.version || field->graphVersion != graphVersion) {
+        field->target = target;
+        field->targetTile = targetTile;
+        field->searched = false;
+    }
+    field->lastUsed = tick;
+    if (!field->searched) {
+        search(*field);
+    }
+    return field;
+}
+
+bool Pathfinding::nextTile(Entity target, IVec2 targetTile, IVec2 from, IVec2* nextOut) {
+    FlowField* field = getField(target, targetTile);
+    const Uint32 current = cost(*field, from);
+    if (current == Unreachable) return false;
+    if (current == 0) {
+        *nextOut = from;
+        return true;
+    }
+
+    Uint32 best = current;
+    IVec2 bestTile = from;
+    Uint32 sideCosts[4];
+    for (int side = 0; side < 4; side++) {
+        IVec2 tile = from + SideDirections[side];
+        sideCosts[side] = cost(*field, tile);
+        if (sideCosts[side] < best) {
+            best = sideCosts[side];
+            bestTile = tile;
+        }
+    }
+    // diagonals save a step, but only when both tiles next to them are open so walls don't get cut through
+    for (int xSide = NavChunk::NegX; xSide <= NavChunk::PosX; xSide++) {
+        for (int ySide = NavChunk::NegY; ySide <= NavChunk::PosY; ySide++) {
+            if (sideCosts[xSide] == Unreachable || sideCosts[ySide] == Unreachable) continue;
+            IVec2 tile = from + SideDirections[xSide] + SideDirections[ySide];
+            Uint32 diagonalCost = cost(*field, tile);
+            if (diagonalCost < best) {
+                best = diagonalCost;
+                bestTile = tile;
+            }
+        }
+    }
+
+    if (bestTile == from) return false;
+    *nextOut = bestTile;
+    return true;
+}
+
+Uint32 Pathfinding::distance(Entity target, IVec2 targetTile, IVec2 from) {
+    FlowField* field = getField(target, targetTile);
+    return cost(*field, from);
+}
+
+bool Pathfinding::walkable(IVec2 tile) {
+    IVec2 chunk = toChunkPosition(tile);
+    const NavChunk* nav = navChunk(chunk);
+    return walkableBit(*nav, tile.x - chunk.x * CHUNKSIZE, tile.y - chunk.y * CHUNKSIZE);
+}
+
+void Pathfinding::tileChanged(IVec2 tile) {
+    IVec2 chunk = toChunkPosition(tile);
+    NavChunk* nav = chunks.lookup(chunk);
+    // nothing depends on the chunk yet
+    if (!nav || !nav->exists) return;
+    const Tile* changed = getTileAtPosition(*chunkmap, tile);
+    if (!changed) return;
+
+    const bool walkable = TileTypeData[changed->type].flags & TileTypes::Walkable;
+    const int x = tile.x - chunk.x * CHUNKSIZE;
+    const int y = tile.y - chunk.y * CHUNKSIZE;
+    if (walkableBit(*nav, x, y) == walkable) return;
+
+    nav->walkable[y] ^= 1ULL << x;
+    nav->version++;
+    nav->portalsBuilt = false;
+    // the portals on the other side of an edge depend on the tiles on this side
+    auto edgeChanged = [&](IVec2 neighbourChunk){
+        if (NavChunk* neighbour = chunks.lookup(neighbourChunk)) {
+            neighbour->portalsBuilt = false;
+        }
+    };
+    if (x == 0) edgeChanged(chunk + SideDirections[NavChunk::NegX]);
+    if (x == CHUNKSIZE - 1) edgeChanged(chunk + SideDirections[NavChunk::PosX]);
+    if (y == 0) edgeChanged(chunk + SideDirections[NavChunk::NegY]);
+    if (y == CHUNKSIZE - 1) edgeChanged(chunk + SideDirections[NavChunk::PosY]);
+    // fields search again next time they're used, but only chunks that end up with different distances get filled in again
+    graphVersion++;
+}
+
+void Pathfinding::update() {
+    tick++;
+    if (tick % 60 != 0) return;
+
+    // find them first, since removing while going through the buckets could skip some
+    auto unused = My::Vec<Uint32>::Empty();
+    for (int i = 0; i < fields.bucketCount; i++) {
+        if (fields.buckets()[i].state == My::Map::Bucket_Filled && tick - fields.values()[i].lastUsed > UnusedFieldTicks) {
+            unused.push(fields.keys()[i]);
+        }
+    }
+    for (Uint32 id : unused) {
+        destroyField(*fields.lookup(id));
+        fields.remove(id);
+    }
+    unused.destroy();
+    stats.fields = fields.size;
+}
+
+}
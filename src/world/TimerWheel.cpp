@@ -0,0 +1,192 @@
+#include "world/TimerWheel.hpp"
+#include "utils/common-macros.hpp"
+
+namespace World {
+
+TimerWheel TimerWheel::init(Tick now) {
+    TimerWheel self;
+    self.timers = My::Vec<Timer>::Empty();
+    self.freeTimers = My::Vec<int>::Empty();
+    for (int i = 0; i <= OverflowSlot; i++) {
+        self.slots[i] = {-1, -1};
+    }
+    self.byEntity = My::HashMap<Uint32, int>::WithBuckets(64);
+    self.now = now;
+    self.pending = 0;
+    return self;
+}
+
+void TimerWheel::destroy() {
+    timers.destroy();
+    freeTimers.destroy();
+    byEntity.destroy();
+}
+
+void TimerWheel::append(int slot, int index) {
+    Timer& timer = timers[index];
+    timer.slot = slot;
+    timer.prev = slots[slot].tail;
+    timer.next = -1;
+    if (slots[slot].tail != -1) {
+        timers[slots[slot].tail].next = index;
+    } else {
+        slots[slot].head = index;
+    }
+    slots[slot].tail = index;
+}
+
+void TimerWheel::place(int index) {
+    const Tick tick = timers[index].tick;
+    // the lowest level where the tick and now are in the same turn of the wheel above
+    for (int level = 0; level < Levels; level++) {
+        const int shift = level * LevelBits;
+        if ((tick >> (shift + LevelBits)) == (now >> (shift + LevelBits))) {
+            append(level * SlotsPerLevel + (int)((tick >> shift) & (SlotsPerLevel - 1)), index);
+            return;
+        }
+    }
+    append(OverflowSlot, index);
+}
+
+void TimerWheel::unlink(int index) {
+    Timer& timer = timers[index];
+    if (timer.prev != -1) {
+        timers[timer.prev].next = timer.next;
+    } else {
+        slots[timer.slot].head = timer.next;
+    }
+    if (timer.next != -1) {
+        timers[timer.next].prev = timer.prev;
+    } else {
+        slots[timer.slot].tail = timer.prev;
+    }
+}
+
+void TimerWheel::release(int index) {
+    Timer& timer = timers[index];
+    if (timer.entity.NotNull()) {
+        if (timer.prevOfEntity != -1) {
+            timers[timer.prevOfEntity].nextOfEntity = timer.nextOfEntity;
+        } else if (timer.nextOfEntity != -1) {
+            *byEntity.lookup(timer.entity.id) = timer.nextOfEntity;
+        } else {
+            byEntity.remove(timer.entity.id);
+        }
+        if (timer.nextOfEntity != -1) {
+            timers[timer.nextOfEntity].prevOfEntity = timer.prevOfEntity;
+        }
+    }
+    timer.alive = false;
+    timer.generation++;
+    freeTimers.push(index);
+    pending--;
+}
+
+TimerID TimerWheel::schedule(Tick tick, Entity entity, TimerAction action, Sint16 argument) {
+    int index;
+    if (!freeTimers.empty()) {
+        index = freeTimers.popBack();
+    } else {
+        index = timers.size;
+        Timer timer;
+        timer.generation = 1;
+        timers.push(timer);
+    }
+
+    Timer& timer = timers[index];
+    timer.tick = MAX(tick, now + 1);
+    timer.entity = entity;
+    timer.argument = argument;
+    timer.action = action;
+    timer.prevOfEntity = -1;
+    timer.nextOfEntity = -1;
+    timer.alive = true;
+    if (entity.NotNull()) {
+        int* first = byEntity.lookup(entity.id);
+        if (first) {
+            timer.nextOfEntity = *first;
+            timers[*first].prevOfEntity = index;
+            *first = index;
+        } else {
+            byEntity.insert(entity.id, index);
+        }
+    }
+    place(index);
+    pending++;
+    return {index, timer.generation};
+}
+
+bool TimerWheel::isPending(TimerID id) const {
+    return id.index >= 0 && id.index < timers.size
+        && timers[id.index].alive && timers[id.index].generation == id.generation;
+}
+
+bool TimerWheel::cancel(TimerID id) {
+    if (!isPending(id)) return false;
+    unlink(id.index);
+    release(id.index);
+    return true;
+}
+
+int TimerWheel::cancelAll(Entity entity) {
+    int* first = byEntity.lookup(entity.id);
+    if (!first) return 0;
+    int cancelled = 0;
+    int index = *first;
+    while (index != -1) {
+        int nextIndex = timers[index].nextOfEntity;
+        // the entity list is going away all at once, so there's no need to keep it linked
+        timers[index].entity = NullEntity;
+        unlink(index);
+        release(index);
+        cancelled++;
+        index = nextIndex;
+    }
+    byEntity.remove(entity.id);
+    return cancelled;
+}
+
+void TimerWheel::cascade(int slot) {
+    int index = slots[slot].head;
+    slots[slot] = {-1, -1};
+    // in order, so timers due the same tick stay in the order they were scheduled
+    while (index != -1) {
+        int nextIndex = timers[index].next;
+        place(index);
+        index = nextIndex;
+    }
+}
+
+bool TimerWheel::next(Tick upTo, Timer* timerOut) {
+    while (true) {
+        TimerSlot& slot = slots[now & (SlotsPerLevel - 1)];
+        if (slot.head != -1) {
+            int index = slot.head;
+            *timerOut = timers[index];
+            unlink(index);
+            release(index);
+            return true;
+        }
+        if (now >= upTo) return false;
+        if (pending == 0) {
+            // nothing to move down the wheel, so time can jump straight there
+            now = upTo;
+            return false;
+        }
+
+        now++;
+        // when a lower ring comes back around, the next slot of the ring above gets moved down into it.
+        // Higher rings first, so their timers can go all the way down in one tick
+        if ((now & ((1LL << (Levels * LevelBits)) - 1)) == 0) {
+            cascade(OverflowSlot);
+        }
+        for (int level = Levels - 1; level > 0; level--) {
+            const int shift = level * LevelBits;
+            if ((now & ((1LL << shift) - 1)) == 0) {
+                cascade(level * SlotsPerLevel + (int)((now >> shift) & (SlotsPerLevel - 1)));
+            }
+        }
+    }
+}
+
+}
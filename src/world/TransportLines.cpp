@@ -0,0 +1,615 @@
+#include "world/TransportLines.hpp"
+#include <algorithm>
+#include <glm/trigonometric.hpp>
+#include "utils/common-macros.hpp"
+#include "utils/Log.hpp"
+
+namespace World {
+
+using Lane = TransportLane;
+using Line = TransportLine;
+
+static constexpr Sint32 TileLength = TransportLines::TileLength;
+static constexpr Sint32 ItemSpacing = TransportLines::ItemSpacing;
+
+IVec2 beltFacing(float degrees) {
+    float radians = glm::radians(degrees + 90.0f);
+    return {(int)roundf(cosf(radians)), (int)roundf(sinf(radians))};
+}
+
+static Lane makeLane() {
+    Lane lane;
+    lane.items = My::Vec<BeltItem>::Empty();
+    lane.first = 0;
+    lane.active = 0;
+    lane.distanceToBack = 0;
+    return lane;
+}
+
+static void destroyLine(Line& line) {
+    for (auto& lane : line.lanes) {
+        lane.items.destroy();
+    }
+    line.belts.destroy();
+}
+
+static const IVec2 Directions[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+TransportLines TransportLines::init() {
+    TransportLines self;
+    self.lines = My::Vec<TransportLine>::Empty();
+    self.freeLines = My::Vec<TransportLineID>::Empty();
+    self.belts = My::HashMap<IVec2, TransportBeltNode, IVec2Hash>::WithBuckets(256);
+    self.spilled = My::Vec<SpilledBeltItem>::Empty();
+    self.stats = {0, 0, 0, 0};
+    self.brokenLines = My::Vec<TransportLineID>::Empty();
+    self.newBelts = My::Vec<IVec2>::Empty();
+    return self;
+}
+
+void TransportLines::destroy() {
+    for (auto& line : lines) {
+        destroyLine(line);
+    }
+    lines.destroy();
+    freeLines.destroy();
+    belts.destroy();
+    spilled.destroy();
+    brokenLines.destroy();
+    newBelts.destroy();
+}
+
+static Sint32 minimumGap(const Lane& lane, int index) {
+    // the front item can go right up to the end, everything else has to keep its distance
+    return index == lane.first ? 0 : ItemSpacing;
+}
+
+// move the active item back past everything that's compressed
+static void findActiveItem(Lane& lane) {
+    lane.active = MAX(lane.active, lane.first);
+    while (lane.active < lane.items.size && lane.items[lane.active].gap <= minimumGap(lane, lane.active)) {
+        lane.active++;
+    }
+}
+
+// returns true if anything moved
+static bool moveLane(Lane& lane, Sint32 movement) {
+    bool moved = false;
+    while (movement > 0 && lane.active < lane.items.size) {
+        BeltItem& item = lane.items[lane.active];
+        Sint32 freeSpace = item.gap - minimumGap(lane, lane.active);
+        Sint32 step = MIN(freeSpace, movement);
+        item.gap -= step;
+        lane.distanceToBack -= step;
+        movement -= step;
+        moved |= step > 0;
+        if (step == freeSpace) {
+            // compressed now. The items behind already moved along with it, and get whatever movement is left
+            lane.active++;
+        }
+    }
+    return moved;
+}
+
+// get rid of the items that already left
+static void compactLane(Lane& lane) {
+    int count = lane.items.size - lane.first;
+    memmove(lane.items.data, lane.items.data + lane.first, count * sizeof(BeltItem));
+    lane.items.size = count;
+    lane.active -= lane.first;
+    lane.first = 0;
+}
+
+static Item popFront(Lane& lane) {
+    BeltItem front = lane.items[lane.first++];
+    if (lane.first < lane.items.size) {
+        // the new front item is just as far from the end as before
+        lane.items[lane.first].gap += front.gap;
+    } else {
+        lane.distanceToBack = 0;
+    }
+
+    // clear out the items that left once they take up most of the vec
+    if (lane.first > 32 && lane.first * 2 > lane.items.size) {
+        compactLane(lane);
+    }
+
+    // nothing is blocking the front anymore
+    lane.active = lane.first;
+    findActiveItem(lane);
+    return front.item;
+}
+
+static bool insertIntoLane(Lane& lane, Sint32 distance, Item item) {
+    int index;
+    Sint32 distanceInFront = 0; // distance of the item in front of the new one from the end
+    if (distance >= lane.distanceToBack) {
+        // going on the back, where items usually come in
+        index = lane.items.size;
+        distanceInFront = lane.distanceToBack;
+    } else {
+        index = lane.first;
+        while (index < lane.items.size && distanceInFront + lane.items[index].gap <= distance) {
+            distanceInFront += lane.items[index].gap;
+            index++;
+        }
+    }
+
+    Sint32 gap = distance - distanceInFront;
+    if (gap < 0) return false;
+    if (index > lane.first && gap < ItemSpacing) return false;
+    if (index < lane.items.size && lane.items[index].gap - gap < ItemSpacing) return false;
+
+    if (lane.items.size == lane.items.capacity && lane.first > 0) {
+        // make room instead of growing
+        index -= lane.first;
+        compactLane(lane);
+    }
+    lane.items.push(BeltItem{item, gap});
+    if (index < lane.items.size - 1) {
+        // the item behind keeps its distance, so the total doesn't change
+        memmove(&lane.items[index + 1], &lane.items[index], (lane.items.size - 1 - index) * sizeof(BeltItem));
+        lane.items[index] = BeltItem{item, gap};
+        lane.items[index + 1].gap -= gap;
+    } else {
+        lane.distanceToBack += gap;
+    }
+
+    lane.active = MIN(lane.active, index);
+    findActiveItem(lane);
+    return true;
+}
+
+static Item removeFromLane(Lane& lane, int index) {
+    if (index == lane.first) {
+        return popFront(lane);
+    }
+
+    BeltItem removed = lane.items[index];
+    if (index + 1 < lane.items.size) {
+        lane.items[index + 1].gap += removed.gap;
+    } else {
+        lane.distanceToBack -= removed.gap;
+    }
+    lane.items.remove(index);
+
+    // the item that was behind it has room to move now
+    lane.active = MIN(lane.active, index);
+    findActiveItem(lane);
+    return removed.item;
+}
+
+// which belt of the line something at the distance is on
+static int beltIndex(const Line& line, Sint32 distance) {
+    Sint32 fromStart = line.length - distance;
+    return MIN(fromStart / TileLength, line.belts.size - 1);
+}
+
+/* On a loop the back item is right behind the front item, across where the end of the line feeds into the start,
+ * so an item going on either end has to keep its distance from the item on the other end too.
+ * As long as that holds the front item can always go around to the back, and a full loop keeps moving
+ */
+static bool fitsAcrossLoop(const Line& line, const Lane& lane, Sint32 distance) {
+    if (!line.loops || lane.count() == 0) return true;
+    Sint32 front = lane.items[lane.first].gap;
+    if (distance >= lane.distanceToBack) {
+        return (line.length - distance) + front >= ItemSpacing;
+    }
+    if (distance < front) {
+        return (line.length - lane.distanceToBack) + distance >= ItemSpacing;
+    }
+    return true;
+}
+
+static void breakLine(TransportLines& self, IVec2 tile) {
+    const auto* node = self.belts.lookup(tile);
+    if (node && node->line != NullTransportLine) {
+        self.brokenLines.push(node->line);
+    }
+}
+
+/* Whether a belt continues a line only depends on it and the belts feeding it,
+ * so changing the belt at a tile can only change the lines of the belt, the belt it faces, and whatever feeds either of them
+ */
+static void breakLinesAround(TransportLines& self, IVec2 tile, IVec2 facing) {
+    IVec2 affected[2] = {tile, tile + facing};
+    for (IVec2 affectedTile : affected) {
+        breakLine(self, affectedTile);
+        for (IVec2 direction : Directions) {
+            const auto* feeder = self.belts.lookup(affectedTile - direction);
+            if (feeder && feeder->facing == direction) {
+                breakLine(self, affectedTile - direction);
+            }
+        }
+    }
+}
+
+void TransportLines::addBelt(Entity entity, IVec2 tile, IVec2 facing, float speed) {
+    if (belts.lookup(tile)) {
+        removeBelt(tile);
+    }
+
+    TransportBeltNode node;
+    node.entity = entity;
+    node.facing = facing;
+    node.speed = MAX((Sint32)roundf(speed * TileLength), 1);
+    node.line = NullTransportLine;
+    node.index = 0;
+    node.feederCount = 0;
+    node.feeder = {0, 0};
+    belts.insert(tile, node);
+    newBelts.push(tile);
+    breakLinesAround(*this, tile, facing);
+}
+
+void TransportLines::removeBelt(IVec2 tile) {
+    const auto* node = belts.lookup(tile);
+    if (!node) return;
+    // items on it get spilled when its line is taken apart
+    breakLinesAround(*this, tile, node->facing);
+    belts.remove(tile);
+}
+
+void TransportLines::rotateBelt(IVec2 tile, IVec2 facing) {
+    auto* node = belts.lookup(tile);
+    if (node && node->facing != facing) {
+        breakLinesAround(*this, tile, node->facing);
+        node->facing = facing;
+        breakLinesAround(*this, tile, facing);
+    }
+}
+
+bool TransportLines::insertItem(IVec2 tile, int lane, float position, Item item) {
+    if (needsRebuild()) rebuild();
+    const auto* node = belts.lookup(tile);
+    if (!node || lane < 0 || lane >= TransportLine::NumLanes) return false;
+
+    Line& line = lines[node->line];
+    Sint32 offset = (Sint32)(position * TileLength);
+    offset = MAX(MIN(offset, TileLength - 1), 0);
+    Sint32 distance = line.length - (node->index * TileLength + offset);
+    if (!fitsAcrossLoop(line, line.lanes[lane], distance)) return false;
+    if (!insertIntoLane(line.lanes[lane], distance, item)) return false;
+    if (onLineChanged) onLineChanged(node->line);
+    return true;
+}
+
+bool TransportLines::takeItem(IVec2 tile, int laneIndex, Item* itemOut) {
+    if (needsRebuild()) rebuild();
+    const auto* node = belts.lookup(tile);
+    if (!node || laneIndex < 0 || laneIndex >= TransportLine::NumLanes) return false;
+
+    Line& line = lines[node->line];
+    Lane& lane = line.lanes[laneIndex];
+    Sint32 distance = 0;
+    for (int i = lane.first; i < lane.items.size; i++) {
+        distance += lane.items[i].gap;
+        int index = beltIndex(line, distance);
+        if (index == node->index) {
+            *itemOut = removeFromLane(lane, i);
+            if (onLineChanged) onLineChanged(node->line);
+            return true;
+        }
+        if (index < node->index) break; // went past the belt
+    }
+    return false;
+}
+
+int TransportLines::ticksUntilItem(IVec2 tile) const {
+    const auto* node = belts.lookup(tile);
+    if (!node || node->line == NullTransportLine) return -1;
+
+    const Line& line = lines[node->line];
+    // items get to the belt once they're this close to the end
+    Sint32 beltEnd = line.length - node->index * TileLength;
+    int ticks = -1;
+    for (const Lane& lane : line.lanes) {
+        Sint32 distance = 0;
+        for (int i = lane.first; i < lane.items.size; i++) {
+            distance += lane.items[i].gap;
+            int index = beltIndex(line, distance);
+            if (index > node->index) continue; // already went past
+            if (index == node->index) return 0;
+            // the nearest item behind the belt. It only gets there if it's moving
+            if (i >= lane.active) {
+                int laneTicks = (distance - beltEnd + line.speed - 1) / line.speed;
+                ticks = ticks == -1 ? laneTicks : MIN(ticks, laneTicks);
+            }
+            break;
+        }
+    }
+    return ticks;
+}
+
+int TransportLines::ticksUntilRoom(IVec2 tile, int laneIndex, float position) const {
+    const auto* node = belts.lookup(tile);
+    if (!node || node->line == NullTransportLine || laneIndex < 0 || laneIndex >= TransportLine::NumLanes) return -1;
+
+    const Line& line = lines[node->line];
+    const Lane& lane = line.lanes[laneIndex];
+    if (lane.active >= lane.items.size) return -1;
+
+    Sint32 offset = MAX(MIN((Sint32)(position * TileLength), TileLength - 1), 0);
+    Sint32 distance = line.length - (node->index * TileLength + offset);
+    Sint32 activeDistance = 0;
+    for (int i = lane.first; i <= lane.active; i++) {
+        activeDistance += lane.items[i].gap;
+    }
+    // everything in front of the active item is stopped. If that's all that's around the position, nothing changes by waiting
+    if (activeDistance > distance + ItemSpacing) return -1;
+    // the items around it will have moved along by one spot
+    return (ItemSpacing + line.speed - 1) / line.speed;
+}
+
+void TransportLines::update() {
+    if (needsRebuild()) rebuild();
+
+    int movingLanes = 0;
+    int items = 0;
+    for (int i = 0; i < lines.size; i++) {
+        Line& line = lines[i];
+        if (line.belts.size == 0) continue; // free
+        bool changed = false;
+        for (int l = 0; l < TransportLine::NumLanes; l++) {
+            Lane& lane = line.lanes[l];
+            if (lane.active < lane.items.size && moveLane(lane, line.speed)) {
+                movingLanes++;
+            }
+
+            // hand the front item off to the next line once it reaches the end
+            if (line.output.line != NullTransportLine && lane.count() > 0 && lane.items[lane.first].gap == 0) {
+                if (line.loops) {
+                    // goes around to the back. fitsAcrossLoop keeps room for it there
+                    if (lane.count() == 1 || line.length - lane.distanceToBack >= ItemSpacing) {
+                        Item item = popFront(lane);
+                        insertIntoLane(lane, line.length, item);
+                        changed = true;
+                    }
+                } else {
+                    Line& outLine = lines[line.output.line];
+                    Lane& outLane = outLine.lanes[line.output.lane >= 0 ? line.output.lane : l];
+                    if (fitsAcrossLoop(outLine, outLane, line.output.distance)
+                     && insertIntoLane(outLane, line.output.distance, lane.items[lane.first].item)) {
+                        popFront(lane);
+                        changed = true;
+                        if (onLineChanged) onLineChanged(line.output.line);
+                    }
+                }
+            }
+            items += lane.count();
+        }
+        if (changed && onLineChanged) {
+            onLineChanged(i);
+        }
+    }
+
+    stats.lines = lines.size - freeLines.size;
+    stats.items = items;
+    stats.movingLanes = movingLanes;
+}
+
+Vec2 TransportLines::itemPosition(const TransportLine& line, int lane, Sint32 distance) const {
+    int index = MAX(beltIndex(line, distance), 0);
+    IVec2 tile = line.belts[index];
+    float along = (float)(line.length - distance - index * TileLength) / TileLength;
+
+    const auto* node = belts.lookup(tile);
+    Vec2 forward = node ? Vec2(node->facing) : Vec2(0, 1);
+    Vec2 left = {-forward.y, forward.x};
+    float side = lane == 0 ? 0.25f : -0.25f;
+    return Vec2(tile) + Vec2(0.5f) + forward * (along - 0.5f) + left * side;
+}
+
+struct LooseBeltItem {
+    IVec2 tile;
+    Sint32 offset; // distance from the back of its belt
+    int lane;
+    Item item;
+    // where it goes on the new lines
+    TransportLineID line;
+    Sint32 distance;
+};
+
+// point the end of the line at whatever belt it's facing
+static void connectOutput(TransportLines& self, TransportLineID id) {
+    Line& line = self.lines[id];
+    line.output = {};
+    line.loops = false;
+    const auto* last = self.belts.lookup(line.belts.back());
+    const auto* target = self.belts.lookup(line.belts.back() + last->facing);
+    if (!target || target->line == NullTransportLine || target->facing == -last->facing) return; // nothing there, or facing right back at it
+
+    const Line& targetLine = self.lines[target->line];
+    Sint32 targetStart = targetLine.length - target->index * TileLength;
+    if (target->facing == last->facing || (target->index == 0 && target->feederCount == 1)) {
+        line.output = {target->line, targetStart, -1};
+        line.loops = target->line == id && target->index == 0;
+    } else {
+        // side loading. Everything goes on the middle of the belt, on the lane closest to where it came from
+        IVec2 left = {-target->facing.y, target->facing.x};
+        IVec2 fromSide = -last->facing;
+        Sint8 lane = (left.x * fromSide.x + left.y * fromSide.y) > 0 ? 0 : 1;
+        line.output = {target->line, targetStart - TileLength / 2, lane};
+    }
+}
+
+void TransportLines::rebuild() {
+    auto loose = My::Vec<LooseBeltItem>::Empty();
+    auto orphans = My::Vec<IVec2>::Empty(); // belts without a line
+    auto rebuilt = My::Vec<TransportLineID>::Empty();
+
+    // take the broken lines apart, taking their items off and remembering which belt each was on
+    for (TransportLineID id : brokenLines) {
+        Line& line = lines[id];
+        if (line.belts.size == 0) continue; // already taken apart
+        for (int l = 0; l < TransportLine::NumLanes; l++) {
+            const Lane& lane = line.lanes[l];
+            Sint32 distance = 0;
+            for (int i = lane.first; i < lane.items.size; i++) {
+                distance += lane.items[i].gap;
+                int index = beltIndex(line, distance);
+                Sint32 offset = line.length - distance - index * TileLength;
+                loose.push(LooseBeltItem{line.belts[index], offset, l, lane.items[i].item, NullTransportLine, 0});
+            }
+        }
+        for (IVec2 tile : line.belts) {
+            auto* node = belts.lookup(tile);
+            if (node && node->line == id) {
+                node->line = NullTransportLine;
+                orphans.push(tile);
+            }
+        }
+        destroyLine(line);
+        freeLines.push(id);
+        rebuilt.push(id);
+    }
+    for (IVec2 tile : newBelts) {
+        const auto* node = belts.lookup(tile);
+        if (node && node->line == NullTransportLine) {
+            orphans.push(tile);
+        }
+    }
+    brokenLines.size = 0;
+    newBelts.size = 0;
+
+    for (IVec2 tile : orphans) {
+        auto* node = belts.lookup(tile);
+        node->index = 0;
+        node->feederCount = 0;
+        for (IVec2 direction : Directions) {
+            const auto* feeder = belts.lookup(tile - direction);
+            if (feeder && feeder->facing == direction) {
+                node->feederCount++;
+                node->feeder = tile - direction;
+            }
+        }
+    }
+
+    // a belt is part of the line of the belt feeding it, if that's the only one and it's not going a different speed
+    auto continuesLine = [&](const TransportBeltNode& node){
+        if (node.feederCount != 1) return false;
+        const auto* feeder = belts.lookup(node.feeder);
+        return feeder->speed == node.speed && feeder->facing != -node.facing;
+    };
+
+    auto made = My::Vec<TransportLineID>::Empty();
+    auto makeLine = [&](IVec2 startTile){
+        TransportLineID id;
+        if (!freeLines.empty()) {
+            id = freeLines.popBack();
+        } else {
+            id = lines.size;
+            lines.push(TransportLine{});
+        }
+        Line line;
+        for (auto& lane : line.lanes) {
+            lane = makeLane();
+        }
+        line.belts = My::Vec<IVec2>::Empty();
+        line.output = {};
+        line.loops = false;
+
+        IVec2 tile = startTile;
+        auto* node = belts.lookup(tile);
+        line.speed = node->speed;
+        while (true) {
+            node->line = id;
+            node->index = line.belts.size;
+            line.belts.push(tile);
+
+            IVec2 nextTile = tile + node->facing;
+            auto* next = belts.lookup(nextTile);
+            if (!next || next->line != NullTransportLine || !continuesLine(*next)) break;
+            tile = nextTile;
+            node = next;
+        }
+        line.length = line.belts.size * TileLength;
+        lines[id] = line;
+        made.push(id);
+    };
+
+    for (IVec2 tile : orphans) {
+        const auto* node = belts.lookup(tile);
+        if (node->line == NullTransportLine && !continuesLine(*node)) {
+            makeLine(tile);
+        }
+    }
+    // whatever is left is in a loop, which can start anywhere
+    for (IVec2 tile : orphans) {
+        if (belts.lookup(tile)->line == NullTransportLine) {
+            makeLine(tile);
+        }
+    }
+
+    // connect the new lines, and the lines that end at one of them
+    for (TransportLineID id : made) {
+        connectOutput(*this, id);
+    }
+    for (IVec2 tile : orphans) {
+        for (IVec2 direction : Directions) {
+            const auto* feeder = belts.lookup(tile - direction);
+            if (feeder && feeder->facing == direction && feeder->index == lines[feeder->line].belts.size - 1) {
+                connectOutput(*this, feeder->line);
+            }
+        }
+    }
+
+    // put the items back where they were
+    for (auto& item : loose) {
+        const auto* node = belts.lookup(item.tile);
+        if (!node) {
+            spilled.push(SpilledBeltItem{Vec2(item.tile) + Vec2(0.5f), item.item});
+            continue;
+        }
+        item.line = node->line;
+        item.distance = lines[node->line].length - (node->index * TileLength + item.offset);
+    }
+    std::sort(loose.begin(), loose.end(), [](const LooseBeltItem& lhs, const LooseBeltItem& rhs){
+        if (lhs.line != rhs.line) return lhs.line < rhs.line;
+        if (lhs.lane != rhs.lane) return lhs.lane < rhs.lane;
+        return lhs.distance < rhs.distance;
+    });
+    for (const auto& item : loose) {
+        if (item.line == NullTransportLine) continue;
+        Line& line = lines[item.line];
+        Lane& lane = line.lanes[item.lane];
+        Sint32 minGap = lane.count() > 0 ? ItemSpacing : 0;
+        Sint32 gap = item.distance - lane.distanceToBack;
+        gap = MAX(gap, minGap);
+        if (lane.distanceToBack + gap > line.length) {
+            // belts that got rotated can end up with more than fits
+            spilled.push(SpilledBeltItem{Vec2(item.tile) + Vec2(0.5f), item.item});
+            continue;
+        }
+        lane.items.push(BeltItem{item.item, gap});
+        lane.distanceToBack += gap;
+    }
+    loose.destroy();
+
+    for (TransportLineID id : made) {
+        Line& line = lines[id];
+        for (auto& lane : line.lanes) {
+            // a loop that got closed can have its back item too close to its front item
+            while (line.loops && lane.count() > 1 && (line.length - lane.distanceToBack) + lane.items[lane.first].gap < ItemSpacing) {
+                BeltItem back = lane.items.popBack();
+                IVec2 tile = line.belts[beltIndex(line, lane.distanceToBack)];
+                spilled.push(SpilledBeltItem{Vec2(tile) + Vec2(0.5f), back.item});
+                lane.distanceToBack -= back.gap;
+            }
+            findActiveItem(lane);
+        }
+    }
+
+    stats.lines = lines.size - freeLines.size;
+    stats.rebuilds++;
+    if (onLineRebuilt) {
+        for (TransportLineID id : rebuilt) {
+            onLineRebuilt(id);
+        }
+    }
+    orphans.destroy();
+    rebuilt.destroy();
+    made.destroy();
+}
+
+}
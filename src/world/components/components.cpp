@@ -9,12 +9,6 @@ radius(radius), damage(damage), life(life), particleCount(particleCount) {
     life = 0;
 }
 
-void Nametag::setName(const char* name) {
-    assert(strlen(name) < MAX_ENTITY_NAME_LENGTH && "entity name too long");
-    strcpy(this->name, name);
-}
-
-
 }
 
 }
\ No newline at end of file
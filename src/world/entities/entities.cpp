@@ -58,7 +58,6 @@ namespace Entities {
 
     Entity Enemy(EntityWorld* ecs, Vec2 position, Entity following) {
         Entity enemy = ecs->New(PrototypeIDs::Enemy);
-        ecs->StartDeferringEvents();
         ecs->Add<EC::Position>(enemy, position);
         ecs->Add<EC::Dynamic>(enemy, position);
         ecs->Add<EC::Health>(enemy, {100.0f});
@@ -68,7 +67,6 @@ namespace Entities {
         ecs->Add<EC::Render>(enemy, EC::Render(TextureIDs::Player, RenderLayers::Player));
         ecs->Add<EC::Rotatable>(enemy, EC::Rotatable(0.0f, 45.0f));
         ecs->Add<EC::Follow>(enemy, EC::Follow(following, 0.05));
-        ecs->StopDeferringEvents();
         return enemy;
     }
     */
@@ -15,20 +15,8 @@ namespace Entities {
     }
 
     Entity findNamedEntity(const char* name, const EntityWorld* ecs) {
-        Entity target = NullEntity;
-        ecs->ForEach_EarlyReturn([](ECS::Signature components){
-            return components[EC::Nametag::ID];
-        }, [&](Entity entity){
-            auto nametag = ecs->Get<const EC::Nametag>(entity);
-            // super inefficient btw
-            if (My::streq(name, nametag->name)) {
-                target = entity;
-                return true;
-            }
-            return false;
-        });
-
-        return target;
+        // a name that was never interned can't belong to anything
+        return ecs->FindNamed(findInterned(name));
     }
 
     void scaleGuy(GameState* state, Entity guy, float scale) {
@@ -117,6 +105,13 @@ void entityPositionChanged(GameState* state, Entity entity, Vec2 oldPos) {
         LogError("why here? no veiwbox or pos");
     }
     entityViewChanged(&state->chunkmap, entity, position->vec2(), oldPos, viewbox->box, viewbox->box, false);
+
+    // moving bodies are kept up to date every tick, static ones have to be told
+    auto* collision = state->ecs.Get<EC::CollisionBox>(entity);
+    Physics::BodyID* body = state->physics.byEntity.lookup(entity.id);
+    if (collision && body && state->physics.bodies[*body].isStatic) {
+        state->physics.moveStatic(*body, position->vec2() + collision->box.center());
+    }
 }
 
 void entityViewboxChanged(GameState* state, Entity entity, Box oldViewbox) {
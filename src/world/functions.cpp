@@ -1,6 +1,11 @@
+#include <algorithm>
 #include "world/functions.hpp"
 #include "Chunks.hpp"
 #include "GameState.hpp"
+#include "world/TransportLines.hpp"
+#include "world/Inserters.hpp"
+#include "physics/physics.hpp"
+#include "llvm/BitVector.h"
 
 namespace World {
 
@@ -13,70 +18,205 @@ Box getEntityViewBoxBounds(const EntityWorld* ecs, Entity entity) {
     };
 }
 
-void setEventCallbacks(EntityWorld& ecs, ChunkMap& chunkmap) {
-    ecs.SetOnAdd<EC::ViewBox>([&](EntityWorld* ecs, Entity entity) {
+void setEventCallbacks(EntityWorld& ecs, ChunkMap& chunkmap, TransportLines& transportLines, Inserters& inserters, Physics::Space& physics) {
+    ecs.SetOnAdd<EC::ViewBox>([&](EntityWorld* ecs, ArrayRef<Entity> entities) {
+        for (Entity entity : entities) {
+            auto* viewBox = ecs->Get<World::EC::ViewBox>(entity);
+            if (!viewBox) {
+                LogError("entity viewbox not found!");
+                continue;
+            }
+            auto* position = ecs->Get<World::EC::Position>(entity);
+            if (!position) {
+                LogError("Entity position not found. Make sure to add position before viewbox.");
+                continue;
+            }
 
-        auto* viewBox = ecs->Get<World::EC::ViewBox>(entity);
-        if (!viewBox) {
-            LogError("entity viewbox not found!");
-            return;
+            Vec2 pos = position->vec2();
+
+            IVec2 minChunkPosition = toChunkPosition(pos + viewBox->box.min);
+            IVec2 maxChunkPosition = toChunkPosition(pos + viewBox->box.max());
+            for (int col = minChunkPosition.x; col <= maxChunkPosition.x; col++) {
+                for (int row = minChunkPosition.y; row <= maxChunkPosition.y; row++) {
+                    IVec2 chunkPosition = {col, row};
+                    // add entity to new chunk
+                    ChunkData* newChunkdata = chunkmap.get(chunkPosition);
+                    if (newChunkdata) {
+                        newChunkdata->closeEntities.push(entity);
+                    }
+                }
+            }
         }
-        auto* position = ecs->Get<World::EC::Position>(entity);
-        if (!position) {
-            LogError("Entity position not found. Make sure to add position before viewbox.");
-            return;
+    });
+    // removing entities one at a time means searching and shifting the chunk's whole list for each one,
+    // so instead mark all of them and go through each chunk they were in once
+    ecs.SetBeforeRemove<EC::ViewBox>([&chunkmap, removing = llvm::BitVector(MAX_ENTITIES), chunks = std::vector<ChunkData*>()]
+    (EntityWorld* ecs, ArrayRef<Entity> entities) mutable {
+        chunks.clear();
+        for (Entity entity : entities) {
+            auto* viewbox = ecs->Get<EC::ViewBox>(entity);
+            if (!viewbox) {
+                LogError("entity viewbox not found!");
+                continue;
+            }
+            auto* position = ecs->Get<EC::Position>(entity);
+            if (!position) {
+                LogError("Entity position not found");
+                continue;
+            }
+            removing.set(entity.id);
+            forEachChunkContainingBounds(&chunkmap, {{position->vec2() + viewbox->box.min, position->vec2() + viewbox->box.max()}}, [&](ChunkData* chunkdata){
+                chunks.push_back(chunkdata);
+            });
         }
-
-        Vec2 pos = position->vec2();
-
-        IVec2 minChunkPosition = toChunkPosition(pos + viewBox->box.min);
-        IVec2 maxChunkPosition = toChunkPosition(pos + viewBox->box.max());
-        for (int col = minChunkPosition.x; col <= maxChunkPosition.x; col++) {
-            for (int row = minChunkPosition.y; row <= maxChunkPosition.y; row++) {
-                IVec2 chunkPosition = {col, row};
-                // add entity to new chunk
-                ChunkData* newChunkdata = chunkmap.get(chunkPosition);
-                if (newChunkdata) {
-                    newChunkdata->closeEntities.push(entity);
+        std::sort(chunks.begin(), chunks.end());
+        chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+
+        for (ChunkData* chunkdata : chunks) {
+            auto& closeEntities = chunkdata->closeEntities;
+            int kept = 0;
+            for (int e = 0; e < closeEntities.size; e++) {
+                if (!removing[closeEntities[e].id]) {
+                    closeEntities[kept++] = closeEntities[e];
                 }
             }
+            closeEntities.size = kept;
+        }
+        for (Entity entity : entities) {
+            removing.reset(entity.id);
         }
     });
-    ecs.SetBeforeRemove<EC::ViewBox>([&](EntityWorld* ecs, Entity entity){
-        auto* viewbox = ecs->Get<EC::ViewBox>(entity);
-        if (!viewbox) {
-            LogError("entity viewbox not found!");
-            return;
+
+    ecs.SetOnAdd<EC::Inventory>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            ecs->Get<EC::Inventory>(entity)->inventory.addRef();
         }
-        auto* position = ecs->Get<EC::Position>(entity);
-        if (!position) {
-            LogError("Entity position not found");
-            return;
+        inserters.containersChanged();
+    });
+    ecs.SetBeforeRemove<EC::Inventory>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            auto& inventory = ecs->Get<EC::Inventory>(entity)->inventory;
+            inserters.inventoryRemoved(entity, inventory);
+            inventory.removeRef();
         }
-        forEachChunkContainingBounds(&chunkmap, {{position->vec2() + viewbox->box.min, position->vec2() + viewbox->box.max()}}, [entity](ChunkData* chunkdata){
-            if (!chunkdata->removeCloseEntity(entity)) {
-                LogWarn("couldn't remove entity");
+    });
+
+    ecs.SetOnAdd<EC::Transporter>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            auto* transporter = ecs->Get<EC::Transporter>(entity);
+            auto* position = ecs->Get<EC::Position>(entity);
+            if (!position) {
+                LogError("Transporter position not found. Make sure to add position before transporter.");
+                continue;
             }
-        });
+            transportLines.addBelt(entity, vecFloori(position->vec2()), transporter->facing, transporter->speed);
+        }
+        inserters.containersChanged();
+    });
+    ecs.SetBeforeRemove<EC::Transporter>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            auto* position = ecs->Get<EC::Position>(entity);
+            if (!position) {
+                LogError("Transporter position not found");
+                continue;
+            }
+            IVec2 tile = vecFloori(position->vec2());
+            auto* belt = transportLines.belts.lookup(tile);
+            if (belt && belt->entity == entity) {
+                transportLines.removeBelt(tile);
+            }
+        }
     });
 
-    ecs.SetOnAdd<EC::Inventory>([](EntityWorld* ecs, Entity entity){
-        ecs->Get<EC::Inventory>(entity)->inventory.addRef();
+    ecs.SetOnAdd<EC::Inserter>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            auto* inserter = ecs->Get<EC::Inserter>(entity);
+            auto* position = ecs->Get<EC::Position>(entity);
+            if (!position) {
+                LogError("Inserter position not found. Make sure to add position before inserter.");
+                continue;
+            }
+            // half the cycle swinging each way
+            inserters.add(entity, vecFloori(position->vec2()), inserter->inputTile, inserter->outputTile, inserter->cycleLength / 2, inserter->stackSize);
+        }
     });
-    ecs.SetBeforeRemove<EC::Inventory>([](EntityWorld* ecs, Entity entity){
-        ecs->Get<EC::Inventory>(entity)->inventory.removeRef();
+    ecs.SetBeforeRemove<EC::Inserter>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            inserters.remove(entity);
+        }
     });
 
-    ecs.SetOnAdd<EC::TransportLineEC>([](EntityWorld* ecs, Entity entity){
-        auto* transportLineEc = ecs->Get<EC::TransportLineEC>(entity);
-        
+    ecs.SetOnAdd<EC::Dying>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            ecs->ScheduleDestroy(entity, tickDelay(ecs->Get<EC::Dying>(entity)->timeToRemoval));
+        }
     });
-    ecs.SetBeforeRemove<EC::TransportLineEC>([&](EntityWorld* ecs, Entity entity){
-        auto* transportLineEc = ecs->Get<EC::TransportLineEC>(entity);
-        transportLineEc->belts.destroy();
+
+    ecs.SetOnAdd<EC::Fresh>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            // only fresh until the end of the tick
+            ecs->ScheduleRemove<EC::Fresh>(entity, Metadata->getTick());
+        }
+    });
+
+    TimerCallbackID explode = ecs.NewTimerCallback([&](EntityWorld* ecs, Entity entity){
+        auto* explosive = ecs->Get<EC::Explosive>(entity);
+        auto* position = ecs->Get<EC::Position>(entity);
+        if (explosive && position) {
+            EC::Explosion explosion = explosive->explosion;
+            forEachEntityInRange(*ecs, &chunkmap, position->vec2(), explosion.radius, [&](Entity hit){
+                damageEntity(*ecs, hit, explosion.damage);
+                return 0;
+            });
+        }
+        ecs->Destroy(entity);
+    });
+    ecs.SetOnAdd<EC::Explosive>([explode](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            int fuse = ecs->Get<EC::Explosive>(entity)->fuse;
+            if (fuse > 0) {
+                ecs->ScheduleCallback(entity, tickDelay(fuse), explode);
+            }
+        }
+    });
+
+    ecs.SetOnAdd<EC::CollisionBox>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            auto* collision = ecs->Get<EC::CollisionBox>(entity);
+            auto* position = ecs->Get<EC::Position>(entity);
+            if (!position) {
+                LogError("Collision box position not found. Make sure to add position before collision box.");
+                continue;
+            }
+            // entities that never move get a static body, which stays in the same place in the grid
+            const bool isStatic = !ecs->EntityHas<EC::Dynamic>(entity);
+            Vec2 center = position->vec2() + collision->box.center();
+            physics.addBody(Physics::Shape::Box, center, collision->box.size / 2.0f, isStatic, entity);
+        }
+    });
+    ecs.SetBeforeRemove<EC::CollisionBox>([&](EntityWorld* ecs, ArrayRef<Entity> entities){
+        for (Entity entity : entities) {
+            Physics::BodyID* body = physics.byEntity.lookup(entity.id);
+            if (body) {
+                physics.removeBody(*body);
+            }
+        }
     });
 }
 
+void damageEntity(EntityWorld& ecs, Entity entity, float damage) {
+    if (!ecs.EntityHas<EC::Health>(entity)) return;
+    auto* health = ecs.Get<EC::Health>(entity);
+    if (!health->damage(damage)) return;
+
+    // Must do check like this instead of (*health <= 0.0f) to account for NaN values,
+    // which can occur when infinite damage is done to an entity with infinite health
+    // so in that situation the infinite damage wins out, rather than the infinte health
+    if (!(health->health > 0.0f) && !ecs.EntityHas<EC::Immortal>(entity)) {
+        ecs.ScheduleDestroy(entity, Metadata->getTick());
+    }
+}
+
 void forEachEntityInRange(const EntityWorld& ecs, const ChunkMap* chunkmap, Vec2 pos, float radius, const std::function<int(Entity)>& callback) {
     radius = abs(radius);
     float radiusSqrd = radius * radius;
@@ -228,7 +368,7 @@ Entity findPlayerFocusedEntity(const EntityWorld& ecs, const ChunkMap& chunkmap,
     return focusedEntity;
 }
 
-void rotateEntity(const EntityWorld& ecs, Entity entity, bool clockwise) {
+void rotateEntity(const EntityWorld& ecs, TransportLines& transportLines, Entity entity, bool clockwise) {
     float* rotation = &ecs.Get<EC::Rotation>(entity)->degrees;
     auto rotatable = ecs.Get<EC::Rotatable>(entity);
     // left shift switches direction
@@ -238,6 +378,12 @@ void rotateEntity(const EntityWorld& ecs, Entity entity, bool clockwise) {
         *rotation -= rotatable->increment;
     }
     rotatable->rotated = true;
+
+    if (auto* transporter = ecs.Get<EC::Transporter>(entity)) {
+        transporter->facing = beltFacing(*rotation);
+        Vec2 position = ecs.Get<EC::Position>(entity)->vec2();
+        transportLines.rotateBelt(vecFloori(position), transporter->facing);
+    }
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "bench.hpp"
+#include "world/TransportLines.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+/* Belts only, without any entities or rendering.
+ * Belts are laid out as loops of two rows, half of which are stopped at the end so their items compress.
+ * Also times placing and removing one belt in the middle of everything, which only rebuilds the lines next to it
+ */
+BENCHMARK(belts, "belts:int[1,1000000]=10000 items:int[0,8000000]=200000 ticks:int[1,100000]=600",
+    "Time the belt simulation on its own, and placing a belt among the others.") {
+    int beltCount = args.getInt();
+    int itemCount = args.getInt();
+    int ticks = args.getInt();
+
+    TransportLines transport = TransportLines::init();
+
+    // groups of two rows. Even groups loop around, odd groups are two straight lines that items pile up at the end of
+    constexpr int RowLength = 50;
+    const IVec2 right = {1, 0}, left = {-1, 0}, up = {0, 1}, down = {0, -1};
+    auto tiles = My::Vec<IVec2>::WithCapacity(beltCount);
+    for (int group = 0; tiles.size < beltCount; group++) {
+        int y = group * 3; // leave a row between groups so they don't feed into each other
+        bool loop = group % 2 == 0;
+        for (int x = 0; x < RowLength && tiles.size < beltCount; x++) {
+            transport.addBelt(NullEntity, {x, y}, (loop && x == RowLength - 1) ? up : right, 0.125f);
+            tiles.push({x, y});
+        }
+        for (int x = RowLength - 1; x >= 0 && tiles.size < beltCount; x--) {
+            transport.addBelt(NullEntity, {x, y + 1}, (loop && x == 0) ? down : left, 0.125f);
+            tiles.push({x, y + 1});
+        }
+    }
+    transport.rebuild();
+
+    // spread the items evenly over every spot on every lane, as far as they fit
+    constexpr int SpotsPerBelt = TransportLines::TileLength / TransportLines::ItemSpacing;
+    Sint64 spots = (Sint64)beltCount * TransportLine::NumLanes * SpotsPerBelt;
+    Sint64 step = MAX(spots / MAX(itemCount, 1), (Sint64)1);
+    int itemsPlaced = 0;
+    for (Sint64 spot = 0; spot < spots && itemsPlaced < itemCount; spot += step) {
+        IVec2 tile = tiles[spot / (TransportLine::NumLanes * SpotsPerBelt)];
+        int lane = (spot / SpotsPerBelt) % TransportLine::NumLanes;
+        float position = (float)(spot % SpotsPerBelt) / SpotsPerBelt;
+        if (transport.insertItem(tile, lane, position, Item(items::ItemTypes::Tile))) {
+            itemsPlaced++;
+        }
+    }
+
+    double worstTickMs = 0.0;
+    Uint64 start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        Uint64 tickStart = SDL_GetTicksNS();
+        transport.update();
+        double tickMs = (SDL_GetTicksNS() - tickStart) / 1.0e6;
+        worstTickMs = MAX(worstTickMs, tickMs);
+    }
+    double msPerTick = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+
+    // turn a belt in the middle of a line and back, each followed by a tick
+    IVec2 middle = tiles[tiles.size / 2];
+    IVec2 facing = transport.belts.lookup(middle)->facing;
+    start = SDL_GetTicksNS();
+    transport.rotateBelt(middle, {-facing.y, facing.x});
+    transport.update();
+    transport.rotateBelt(middle, facing);
+    transport.update();
+    double rotateMs = (SDL_GetTicksNS() - start) / 1.0e6 / 2;
+
+    int itemsLeft = 0;
+    for (const auto& line : transport.lines) {
+        for (const auto& lane : line.lanes) {
+            itemsLeft += lane.count();
+        }
+    }
+    itemsLeft += transport.spilled.size;
+
+    tiles.destroy();
+    transport.destroy();
+
+    auto message = string_format("%d belts, %d items, %d ticks: %.4f ms per tick, %.4f ms worst. %.4f ms to turn a belt and tick",
+        beltCount, itemsPlaced, ticks, msPerTick, worstTickMs, rotateMs);
+    if (itemsLeft != itemsPlaced) {
+        return BENCH_FAILED("Lost items! Started with %d, ended with %d. %s", itemsPlaced, itemsLeft, message.c_str());
+    }
+    return BENCH_RESULT("%s", message.c_str());
+}
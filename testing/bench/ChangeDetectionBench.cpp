@@ -0,0 +1,106 @@
+#include "bench.hpp"
+#include "world/EntityWorld.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+enum class MoverLayout {
+    None, // just check every entity
+    Scattered,
+    Clustered
+};
+
+static double moveAndUpdate(const ECS::Archetype& archetype, int entities, int movers, int ticks, MoverLayout layout, float* blocksVisitedOut) {
+    using ECS::ArchetypePool;
+    ArchetypePool pool(archetype);
+    ECS::ChangeVersion version = 1;
+    for (int i = 0; i < entities; i++) {
+        pool.addNew(Entity(i, 1), version);
+    }
+    int positionIndex = archetype.getIndex(EC::Position::ID);
+    int dynamicIndex = archetype.getIndex(EC::Dynamic::ID);
+    auto* positions = (EC::Position*)pool.getBuffer(positionIndex);
+    auto* dynamics = (EC::Dynamic*)pool.getBuffer(dynamicIndex);
+    for (int i = 0; i < entities; i++) {
+        positions[i] = EC::Position(0.0f, 0.0f);
+        dynamics[i] = EC::Dynamic(Vec2(0.0f, 0.0f));
+    }
+
+    My::Vec<int> moverRows = My::Vec<int>::WithCapacity(movers);
+    Uint32 random = 7;
+    int clusterStart = entities / 3;
+    for (int i = 0; i < movers; i++) {
+        random = random * 1664525 + 1013904223;
+        int row = (layout == MoverLayout::Clustered) ? (clusterStart + i) % entities : (int)((random >> 4) % entities);
+        moverRows.push(row);
+    }
+
+    ECS::ChangeVersion since = version++;
+    int blocksVisited = 0;
+    Uint64 elapsed = 0;
+    for (int tick = 0; tick < ticks; tick++) {
+        for (int row : moverRows) {
+            dynamics[row].pos.x += 1.0f;
+            pool.markChanged(dynamicIndex, row, version);
+        }
+
+        Uint64 start = SDL_GetTicksNS();
+        auto update = [&](int row){
+            Vec2 newPos = dynamics[row].pos;
+            if (positions[row].x != newPos.x || positions[row].y != newPos.y) {
+                positions[row] = EC::Position(newPos);
+            }
+        };
+        if (layout == MoverLayout::None) {
+            for (int row = 0; row < pool.size; row++) {
+                update(row);
+            }
+        } else {
+            const ECS::ChangeVersion* versions = pool.getChangeVersions(dynamicIndex);
+            int blocks = pool.numChangeBlocks();
+            for (int block = 0; block < blocks; block++) {
+                if (versions[block] <= since) continue;
+                blocksVisited++;
+                int end = MIN((block + 1) << ArchetypePool::ChangeBlockShift, pool.size);
+                for (int row = block << ArchetypePool::ChangeBlockShift; row < end; row++) {
+                    update(row);
+                }
+            }
+        }
+        elapsed += SDL_GetTicksNS() - start;
+        since = version++;
+    }
+
+    *blocksVisitedOut = (float)blocksVisited / ((float)pool.numChangeBlocks() * ticks);
+    moverRows.destroy();
+    pool.destroy();
+    return elapsed / 1.0e6;
+}
+
+/* Move a few entities out of a lot of standing entities every tick, and copy positions that changed
+ * from Dynamic to Position like updating chunk positions does, by checking every entity
+ * and by going through changed blocks only.
+ * The entity world can't have this many entities, so it uses an archetype pool directly
+ */
+BENCHMARK(changeDetection, "entities:int[1,10000000]=1000000 movers:int[0,10000000]=10000 ticks:int[1,100000]=100",
+    "Time updating the positions of the entities that moved, checking every entity and only the ones marked changed.") {
+    int entities = args.getInt();
+    int movers = MIN(args.getInt(), entities);
+    int ticks = args.getInt();
+
+    // only used for the component sizes
+    EntityWorld ecs;
+    ECS::Archetype archetype = ECS::makeArchetype(ECS::getSignature<EC::Position, EC::Dynamic>(), ecs.em.components.componentInfo);
+
+    float allBlocks, scatteredBlocks, clusteredBlocks;
+    double fullScanMs = moveAndUpdate(archetype, entities, movers, ticks, MoverLayout::None, &allBlocks);
+    double scatteredMs = moveAndUpdate(archetype, entities, movers, ticks, MoverLayout::Scattered, &scatteredBlocks);
+    double clusteredMs = moveAndUpdate(archetype, entities, movers, ticks, MoverLayout::Clustered, &clusteredBlocks);
+
+    Free(archetype.sizes);
+    Free(archetype.componentIDs);
+    ecs.destroy();
+
+    return BENCH_RESULT("%d entities, %d moving, %d ticks: %.3f ms checking every entity, %.3f ms checking changed blocks of scattered movers (%.1f%% of blocks), %.3f ms checking changed blocks of clustered movers (%.1f%% of blocks)",
+        entities, movers, ticks, fullScanMs, scatteredMs, scatteredBlocks * 100.0f, clusteredMs, clusteredBlocks * 100.0f);
+}
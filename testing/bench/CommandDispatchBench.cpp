@@ -0,0 +1,55 @@
+#include "bench.hpp"
+#include <SDL3/SDL_timer.h>
+
+// look up made up commands through the table and by going through all of them
+BENCHMARK(commandDispatch, "commands:int[1,10000]=200 lookups:int[1,100000000]=1000000",
+    "Time building the command table, and finding commands by name through it and by going through all of them.") {
+    int commandCount = args.getInt();
+    int lookups = args.getInt();
+
+    std::vector<Command> commands;
+    commands.reserve(commandCount);
+    for (int i = 0; i < commandCount; i++) {
+        auto name = string_format("benchmarkCommand%d", i);
+        commands.push_back(Command::make(name.c_str(), [](CommandArgs) { return Command::Result{Command::Result::Success, ""}; }));
+    }
+    Uint64 start = SDL_GetTicksNS();
+    CommandTable table = CommandTable::build(commands);
+    double buildMs = (double)(SDL_GetTicksNS() - start) / 1e6;
+
+    // typed the way a player would, some with different case and some that don't exist
+    std::vector<std::string> names;
+    Uint32 random = 5;
+    for (int i = 0; i < 256; i++) {
+        random = random * 1664525 + 1013904223;
+        int index = (random >> 8) % (commandCount + commandCount / 4 + 1);
+        names.push_back(string_format(i % 3 == 0 ? "BenchmarkCommand%d" : "benchmarkCommand%d", index));
+    }
+
+    int found = 0;
+    start = SDL_GetTicksNS();
+    for (int i = 0; i < lookups; i++) {
+        const std::string& name = names[i & 255];
+        found += table.find(commands, name.c_str(), (int)name.size()) >= 0;
+    }
+    double tableNs = (double)(SDL_GetTicksNS() - start) / lookups;
+
+    int foundLinear = 0;
+    start = SDL_GetTicksNS();
+    for (int i = 0; i < lookups; i++) {
+        const std::string& name = names[i & 255];
+        for (const auto& command : commands) {
+            if (My::streq_case(command.name, name.c_str(), command.nameLength, (int)name.size())) {
+                foundLinear++;
+                break;
+            }
+        }
+    }
+    double linearNs = (double)(SDL_GetTicksNS() - start) / lookups;
+
+    if (found != foundLinear) {
+        return BENCH_FAILED("The table found %d commands, going through all of them found %d", found, foundLinear);
+    }
+    return BENCH_RESULT("%d commands (%d slots, %d buckets), %d lookups: building %.3f ms, %.1f ns a lookup through the table, %.1f ns a lookup going through every command",
+        commandCount, (int)table.slots.size(), (int)table.displacements.size(), lookups, buildMs, tableNs, linearNs);
+}
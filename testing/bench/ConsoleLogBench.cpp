@@ -0,0 +1,121 @@
+#include "bench.hpp"
+#include "GUI/ConsoleLog.hpp"
+#include <SDL3/SDL_timer.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+using GUI::ConsoleLog;
+
+/* Push a lot of lines into a log that only keeps some of them, then filter it, scroll around it and check
+ * the filtered lines against going through every line by hand
+ */
+BENCHMARK(consoleLog, "lines:int[1,100000000]=1000000 capacity:int[1,1000000]=4096",
+    "Time pushing lots of lines into the console log, filtering it and finding the lines on screen, and check the filtered lines.") {
+    int lineCount = args.getInt();
+    int capacity = args.getInt();
+
+    static const char* const words[] = {"belt", "inserter", "chest", "furnace", "drill", "assembler", "pole", "pipe"};
+    constexpr int wordCount = sizeof(words) / sizeof(words[0]);
+    const SDL_Color colors[4] = {{230, 230, 230, 255}, {220, 220, 60, 255}, {200, 200, 50, 255}, {255, 0, 0, 255}};
+
+    ConsoleLog log = ConsoleLog::init(capacity, (Uint32)capacity * 64);
+    Uint32 random = 7;
+    auto next = [&]() -> Uint32 {
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    auto pushRandom = [&](int i) {
+        char line[96];
+        Uint32 r = next();
+        int category = r % 4;
+        LogPriority priority = (LogPriority)(LogPriorities::Verbose + (r >> 2) % 6);
+        // every so often the same message comes in a few times in a row
+        if (r % 16 == 0) i &= ~3;
+        snprintf(line, sizeof(line), "line %d: the %s at %u,%u", i, words[(r >> 5) % wordCount], (r >> 8) % 512, (r >> 12) % 512);
+        log.push(line, colors[category], category, priority, category == 0);
+    };
+
+    Uint64 start = SDL_GetTicksNS();
+    for (int i = 0; i < lineCount; i++) {
+        pushRandom(i);
+    }
+    double pushNs = (double)(SDL_GetTicksNS() - start) / lineCount;
+
+    ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+    filter.categories = (1u << 1) | (1u << 3);
+    filter.minPriority = LogPriorities::Info;
+    strcpy(filter.search, "belt");
+    start = SDL_GetTicksNS();
+    log.setFilter(filter);
+    double filterMs = (double)(SDL_GetTicksNS() - start) / 1e6;
+
+    // the index has to match going through every line, after building it and after adding to it
+    int mismatches = 0;
+    auto check = [&]() {
+        std::vector<ConsoleLog::Seq> expected;
+        for (int i = 0; i < log.size(); i++) {
+            const auto& kept = log.line(i);
+            if ((filter.categories & (1u << kept.category)) && kept.priority >= filter.minPriority
+                && strstr(log.rawText(kept), filter.search)) {
+                expected.push_back(kept.seq);
+            }
+        }
+        if ((int)expected.size() != log.viewSize()) {
+            mismatches += abs((int)expected.size() - log.viewSize());
+        }
+        int common = MIN((int)expected.size(), log.viewSize());
+        for (int i = 0; i < common; i++) {
+            if (log.viewLine(i).seq != expected[i]) mismatches++;
+        }
+    };
+    check();
+
+    // scrolled up, new lines shouldn't move what's on screen
+    log.scrollBy(10);
+    ConsoleLog::Seq topSeq = log.viewSize() > 0 ? log.viewLine(log.viewSize() - 1 - log.scroll).seq : 0;
+    for (int i = 0; i < capacity / 8; i++) {
+        pushRandom(lineCount + i);
+    }
+    if (log.viewSize() > 0 && log.scroll > 0 && log.viewLine(log.viewSize() - 1 - log.scroll).seq != topSeq
+        && topSeq >= log.firstSeq) {
+        mismatches++;
+    }
+    check();
+
+    constexpr int frames = 1000;
+    int shown = 0;
+    start = SDL_GetTicksNS();
+    for (int f = 0; f < frames; f++) {
+        log.scrollToNewest();
+        log.scrollBy((int)(next() % (Uint32)MAX(log.viewSize(), 1)));
+        int visible = log.visibleLines(600.0f, 2.0f, 12.0f);
+        for (int i = 0; i < visible; i++) {
+            log.viewLine(log.viewSize() - 1 - log.scroll - i).height = 12.0f;
+        }
+        shown += visible;
+    }
+    double visibleNs = (double)(SDL_GetTicksNS() - start) / frames;
+
+    // every kept line formatted every frame, like the console used to
+    constexpr int formatFrames = 5;
+    size_t formatted = 0;
+    start = SDL_GetTicksNS();
+    for (int f = 0; f < formatFrames; f++) {
+        for (int i = 0; i < log.size(); i++) {
+            const auto& kept = log.line(i);
+            formatted += string_format("(%d) %s", kept.copyNumber, log.rawText(kept)).size();
+        }
+    }
+    double formatAllMs = (double)(SDL_GetTicksNS() - start) / 1e6 / formatFrames;
+
+    volatile size_t sink = formatted + shown;
+    (void)sink;
+    log.destroy();
+
+    if (mismatches > 0) {
+        return BENCH_FAILED("%d filtered lines differ from going through every line", mismatches);
+    }
+    return BENCH_RESULT("%d lines into %d: %.1f ns a line, filtering %.3f ms, visible lines %.1f ns a frame, formatting every line %.3f ms a frame",
+        lineCount, capacity, pushNs, filterMs, visibleNs, formatAllMs);
+}
@@ -0,0 +1,103 @@
+#include "bench.hpp"
+#include "world/EntityWorld.hpp"
+#include "world/entities/entities.hpp"
+#include "world/functions.hpp"
+#include "world/TransportLines.hpp"
+#include "world/Inserters.hpp"
+#include "physics/physics.hpp"
+#include "Chunks.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+// entity ids run out at a thousand, so this many a tick for the lifetime of a tree is as much as there's room for
+static constexpr int MaxTreesPerTick = 100;
+static constexpr int TreeLifetime = 8;
+static constexpr int ChunksAcross = 2;
+// one in this many trees is destroyed the same tick it's spawned
+static constexpr int StillbornEvery = 4;
+
+static double spawnAndDestroyTrees(int entities, int perTick, bool oneAtATime, int* coalescedOut) {
+    EntityWorld ecs;
+    ChunkMap chunkmap;
+    chunkmap.init();
+    for (int x = 0; x < ChunksAcross; x++) {
+        for (int y = 0; y < ChunksAcross; y++) {
+            chunkmap.newChunkAt({x, y});
+        }
+    }
+    TransportLines transportLines = TransportLines::init();
+    Inserters inserters = Inserters::init(&transportLines);
+    Physics::Space physics = Physics::Space::init();
+    setEventCallbacks(ecs, chunkmap, transportLines, inserters, physics);
+
+    // trees by the tick they get destroyed, going around
+    std::vector<Entity> dying[TreeLifetime];
+    Uint32 random = 7;
+    auto nextPosition = [&](){
+        random = random * 1664525 + 1013904223;
+        return (float)((random >> 8) % (ChunksAcross * CHUNKSIZE - 1));
+    };
+    auto changed = [&](){
+        if (oneAtATime) ecs.FlushEvents();
+    };
+
+    Uint64 start = SDL_GetTicksNS();
+    int spawned = 0;
+    int living = 0;
+    for (int tick = 0; spawned < entities || living > 0; tick++) {
+        auto& dyingThisTick = dying[tick % TreeLifetime];
+        for (Entity tree : dyingThisTick) {
+            ecs.Destroy(tree);
+            changed();
+        }
+        living -= (int)dyingThisTick.size();
+        dyingThisTick.clear();
+
+        for (int i = 0; i < perTick && spawned < entities; i++) {
+            Vec2 position = {nextPosition(), nextPosition()};
+            Entity tree = Entities::Tree(&ecs, position, {1.0f, 1.0f});
+            changed();
+            spawned++;
+            if (spawned % StillbornEvery == 0) {
+                ecs.Destroy(tree);
+                changed();
+            } else {
+                dyingThisTick.push_back(tree);
+                living++;
+            }
+        }
+
+        ecs.FlushEvents();
+    }
+    double ms = (SDL_GetTicksNS() - start) / 1.0e6;
+    *coalescedOut = ecs.CoalescedEvents();
+
+    chunkmap.iterateChunkdata([](ChunkData* chunkdata){
+        chunkdata->closeEntities.destroy();
+        return false;
+    });
+    ecs.destroy();
+    physics.destroy();
+    inserters.destroy();
+    transportLines.destroy();
+    chunkmap.destroy();
+    return ms;
+}
+
+/* Spawn trees and destroy them a few ticks later, with the game's event handlers registered,
+ * once flushing events once a tick and once flushing after every change. Some of the trees are
+ * destroyed the same tick they're spawned, so their events cancel out when batched
+ */
+BENCHMARK(entityEvents, "trees:int[1,10000000]=100000 perTick:int[1,100]=100",
+    "Time spawning and destroying trees with their component events batched, and handled one at a time.") {
+    int entities = args.getInt();
+    int perTick = args.getInt();
+
+    int coalesced, unused;
+    double batchedMs = spawnAndDestroyTrees(entities, perTick, false, &coalesced);
+    double oneAtATimeMs = spawnAndDestroyTrees(entities, perTick, true, &unused);
+
+    return BENCH_RESULT("%d trees spawned and destroyed, %d per tick: %.3f ms batched (%d events coalesced), %.3f ms one at a time",
+        entities, perTick, batchedMs, coalesced, oneAtATimeMs);
+}
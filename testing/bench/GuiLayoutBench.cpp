@@ -0,0 +1,74 @@
+#include "bench.hpp"
+#include "GUI/Gui.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace GUI;
+
+/* Lay out a gui of a lot of elements from scratch, then update it again and again with nothing changed
+ * and with the hovered element changing every frame
+ */
+BENCHMARK(guiLayout, "elements:int[1,1000000]=10000 frames:int[1,10000]=100",
+    "Time laying out a big gui from scratch, and updating it with nothing changed and with the hovered element changing.") {
+    int elementCount = args.getInt();
+    int frames = args.getInt();
+
+    using namespace GUI::EC;
+    constexpr static auto componentInfoArray = ECS::getComponentInfoList<GUI_COMPONENTS_LIST>();
+    GuiManager gui = GuiManager(ArrayRef(componentInfoArray), ElementTypes::Count);
+    makeGuiPrototypes(gui);
+
+    // columns of rows stacked on top of each other, like inventory lists
+    const Box screen = {Vec2(0), Vec2(1920, 1080)};
+    constexpr int RowsPerColumn = 100;
+    Element column = NullElement;
+    Element firstRow = NullElement;
+    Element lastRow = NullElement;
+    for (int i = 0; i < elementCount; i++) {
+        if (i % RowsPerColumn == 0) {
+            int columnIndex = i / RowsPerColumn;
+            column = gui.newElement(ElementTypes::Normal, gui.screen);
+            gui.addComponent(column, EC::ViewBox{Box{Vec2((columnIndex % 10) * 190.0f, (columnIndex / 10) * 20.0f), Vec2(180, 1000)}});
+            gui.addComponent(column, EC::StackConstraint{.vertical = true});
+            gui.addComponent(column, EC::Background{{40, 40, 40, 255}});
+            continue;
+        }
+        Element row = gui.newElement(ElementTypes::Normal, column);
+        gui.addComponent(row, EC::ViewBox{Box{Vec2(0), Vec2(180, 10)}});
+        gui.addComponent(row, EC::Background{{80, 80, 80, 255}});
+        gui.addComponent(row, EC::Border{.color = {255, 255, 255, 255}, .strokeIn = Vec2(1.0f)});
+        gui.addComponent(row, EC::Hover{true, {200, 50, 50, 255}, nullptr});
+        if (firstRow.Null()) firstRow = row;
+        lastRow = row;
+    }
+
+    // everything laid out and made from scratch, what every frame used to do
+    Uint64 start = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; frame++) {
+        GuiLayout layout = GuiLayout::init();
+        layout.update(gui, screen, nullptr);
+        layout.destroy();
+    }
+    double rebuildMs = (SDL_GetTicksNS() - start) / 1.0e6 / frames;
+
+    GuiLayout layout = GuiLayout::init();
+    layout.update(gui, screen, nullptr);
+
+    start = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; frame++) {
+        layout.update(gui, screen, nullptr);
+    }
+    double idleMs = (SDL_GetTicksNS() - start) / 1.0e6 / frames;
+
+    start = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; frame++) {
+        layout.setHovered(gui, (frame % 2) ? firstRow : lastRow);
+        layout.update(gui, screen, nullptr);
+    }
+    double hoverMs = (SDL_GetTicksNS() - start) / 1.0e6 / frames;
+    int hoverRepainted = layout.elementsRepainted;
+
+    layout.destroy();
+    gui.destroy();
+    return BENCH_RESULT("%d elements: %.3f ms a frame laying out everything, %.4f ms a frame with nothing changed, %.4f ms a frame with the hovered element changing (%d elements repainted)",
+        elementCount, rebuildMs, idleMs, hoverMs, hoverRepainted);
+}
@@ -0,0 +1,89 @@
+#include "bench.hpp"
+#include "world/Inserters.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+/* Belts and inserters only, without any entities or rendering.
+ * Inserters sit between rows of source belts and rows of target belts. The sources start empty so every inserter ends up waiting,
+ * then items get fed onto the start of every source row, so the inserters along it have things coming at them
+ */
+BENCHMARK(inserters, "inserters:int[1,1000000]=50000 ticks:int[1,100000]=600",
+    "Time idle inserters against checking every inserter every tick, and count how many wake up with items going past.") {
+    int inserterCount = args.getInt();
+    int ticks = args.getInt();
+
+    constexpr int RowLength = 100;
+    const IVec2 right = {1, 0};
+
+    TransportLines transport = TransportLines::init();
+    Inserters inserters = Inserters::init(&transport);
+    transport.onLineChanged = [&](TransportLineID line){
+        inserters.beltLineChanged(line);
+    };
+    transport.onLineRebuilt = [&](TransportLineID line){
+        inserters.beltLineRebuilt(line);
+    };
+
+    // each group is a row of source belts, a row of inserters, and a row of target belts
+    int placed = 0;
+    int rows = 0;
+    for (int group = 0; placed < inserterCount; group++, rows++) {
+        int y = group * 3;
+        for (int x = 0; x < RowLength; x++) {
+            transport.addBelt(NullEntity, {x, y}, right, 0.125f);
+            transport.addBelt(NullEntity, {x, y + 2}, right, 0.125f);
+        }
+        for (int x = 0; x < RowLength && placed < inserterCount; x++, placed++) {
+            inserters.add(Entity(placed, 0), {x, y + 1}, {x, y}, {x, y + 2}, 15, 1);
+        }
+    }
+
+    // every source is empty, so everything should be asleep after the first tick
+    transport.update();
+    inserters.update();
+    if (inserters.active.size != 0) {
+        int awake = inserters.active.size;
+        inserters.destroy();
+        transport.destroy();
+        return BENCH_FAILED("%d inserters still awake with nothing to do", awake);
+    }
+
+    Uint64 start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        inserters.update();
+    }
+    double idleMs = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+
+    start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        inserters.wakeAll();
+        inserters.update();
+    }
+    double pollingMs = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+
+    // only the inserters along the belt the item was put on should wake up
+    transport.insertItem({0, 0}, 0, 0.5f, Item(items::ItemTypes::Tile));
+    int wakesAfterInsert = inserters.active.size;
+
+    // items moving along shouldn't wake anything, only getting to an inserter should
+    Sint64 awakeTotal = 0;
+    start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        for (int row = 0; row < rows; row++) {
+            transport.insertItem({0, row * 3}, t % 2, 0.0f, Item(items::ItemTypes::Tile));
+        }
+        transport.update();
+        inserters.update();
+        awakeTotal += inserters.stats.awake;
+    }
+    double flowingMs = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+    double awakePerTick = (double)awakeTotal / ticks;
+
+    inserters.destroy();
+    transport.destroy();
+
+    return BENCH_RESULT("%d inserters, %d ticks: %.4f ms per tick idle, %.4f ms per tick polling. %d woken by one belt item. "
+        "With items coming down every row: %.4f ms per tick, %.1f awake per tick",
+        placed, ticks, idleMs, pollingMs, wakesAfterInsert, flowingMs, awakePerTick);
+}
@@ -0,0 +1,84 @@
+#include "bench.hpp"
+#include "items/items.hpp"
+#include "items/prototypes/prototypes.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace items;
+
+// in GameState.cpp
+void makeItemPrototypes(ItemManager& im);
+
+static double timeInventoryOperations(My::Vec<Inventory>& inventories, Item grenade, Item sandGun, int operations) {
+    Uint32 random = 12345;
+    Uint64 start = SDL_GetTicksNS();
+    for (int op = 0; op < operations; op++) {
+        random = random * 1664525 + 1013904223;
+        Inventory& inventory = inventories[(random >> 8) % inventories.size];
+        switch (op % 3) {
+        case 0:
+            inventory.itemCount(ItemTypes::Grenade);
+            break;
+        case 1:
+            // the grenades are near the end of the chest
+            inventory.removeItemType(ItemTypes::Grenade, 1);
+            inventory.addItemStack(ItemStack(grenade, 1));
+            break;
+        case 2:
+            // has to go in the first empty slot, after all the tiles
+            inventory.addItemStack(ItemStack(sandGun, 1));
+            inventory.removeItemType(ItemTypes::SandGun, 1);
+            break;
+        }
+    }
+    return (SDL_GetTicksNS() - start) / 1.0e6;
+}
+
+/* Big, mostly full chests of tiles with a few grenades near the end.
+ * The same operations get timed on the same chests twice, once with an index and once scanning every slot
+ */
+BENCHMARK(inventories, "inventories:int[1,10000]=100 slots:int[1,100000]=1000 operations:int[1,100000000]=300000",
+    "Time finding, adding and removing items in big chests, with and without an index.") {
+    int inventoryCount = args.getInt();
+    int slots = args.getInt();
+    int operations = args.getInt();
+
+    using namespace ITC;
+    static constexpr auto itemComponentInfo = ECS::getComponentInfoList<ITEM_COMPONENTS_LIST>();
+    ItemManager manager = ItemManager(ArrayRef(itemComponentInfo), ItemTypes::Count);
+    makeItemPrototypes(manager);
+
+    Item tile = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item grenade = Prototypes::Grenade::make(manager);
+    Item sandGun = Prototypes::SandGun::make(manager);
+    const ItemQuantity stackSize = getStackSize(tile, manager);
+
+    auto inventories = My::Vec<Inventory>::WithCapacity(inventoryCount);
+    for (int i = 0; i < inventoryCount; i++) {
+        Inventory inventory(&manager, slots);
+        inventory.enableIndex();
+        // mostly full stacks of tiles, then a few grenades, with the last tenth empty
+        int filled = slots - slots / 10;
+        int grenadeSlots = MAX(filled / 100, 1);
+        for (int slot = 0; slot < filled - grenadeSlots; slot++) {
+            inventory.addItemStack(ItemStack(tile, stackSize));
+        }
+        inventory.addItemStack(ItemStack(tile, stackSize / 2));
+        inventory.addItemStack(ItemStack(grenade, grenadeSlots * getStackSize(grenade, manager) / 2));
+        inventories.push(inventory);
+    }
+
+    double indexedMs = timeInventoryOperations(inventories, grenade, sandGun, operations);
+    for (auto& inventory : inventories) {
+        inventory.disableIndex();
+    }
+    double unindexedMs = timeInventoryOperations(inventories, grenade, sandGun, operations);
+
+    for (auto& inventory : inventories) {
+        inventory.destroy();
+    }
+    inventories.destroy();
+    manager.destroy();
+
+    return BENCH_RESULT("%d inventories of %d slots, %d operations: %.3f ms indexed, %.3f ms scanning",
+        inventoryCount, slots, operations, indexedMs, unindexedMs);
+}
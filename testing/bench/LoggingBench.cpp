@@ -0,0 +1,46 @@
+#include "bench.hpp"
+#include <SDL3/SDL_timer.h>
+
+/* Log a lot of messages through the game's logger, writing nowhere, and time the calls on the logging thread.
+ * The writer thread is stopped afterwards, so anything logged later in the run is written right away
+ */
+BENCHMARK(logging, "messages:int[1,10000000]=1000000",
+    "Time logging calls that are rate limited, queued for the writer thread, and formatted and written right away.") {
+    int messages = args.getInt();
+
+    const bool wasInitialized = gLogger.initialized;
+    gLogger.logToConsole = false;
+    gLogger.init(nullptr);
+
+    // the same call site over and over, like an error in a hot loop
+    Uint64 start = SDL_GetTicksNS();
+    for (int i = 0; i < messages; i++) {
+        LogError("Entity %d doesn't have a %s component!", i, "Position");
+    }
+    double rateLimitedNs = (double)(SDL_GetTicksNS() - start) / messages;
+
+    // messages that all get queued, unless the queue fills up
+    gLogger.rateLimit = false;
+    start = SDL_GetTicksNS();
+    for (int i = 0; i < messages; i++) {
+        LogError("Queued message %d at %.2f for %s", i, i * 0.5, "benchmark");
+    }
+    double queuedNs = (double)(SDL_GetTicksNS() - start) / messages;
+    gLogger.destroy();
+
+    // like logging used to be, formatting and writing right away
+    gLogger.outputFile = fopen("/dev/null", "w");
+    start = SDL_GetTicksNS();
+    for (int i = 0; i < messages; i++) {
+        LogError("Queued message %d at %.2f for %s", i, i * 0.5, "benchmark");
+    }
+    double synchronousNs = (double)(SDL_GetTicksNS() - start) / messages;
+    if (gLogger.outputFile) fclose(gLogger.outputFile);
+    gLogger.outputFile = NULL;
+
+    gLogger.logToConsole = true;
+    gLogger.rateLimit = true;
+    gLogger.initialized = wasInitialized;
+    return BENCH_RESULT("%d messages: %.1f ns a call from one call site (rate limited), %.1f ns a call queued, %.1f ns a call formatted and written right away",
+        messages, rateLimitedNs, queuedNs, synchronousNs);
+}
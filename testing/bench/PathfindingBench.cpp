@@ -0,0 +1,169 @@
+#include "bench.hpp"
+#include "world/Pathfinding.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+static constexpr int ChunkTiles = CHUNKSIZE * CHUNKSIZE;
+static const IVec2 SideDirections[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+static void setTile(ChunkMap& chunkmap, IVec2 position, TileType type) {
+    if (Tile* tile = getTileAtPosition(chunkmap, position)) {
+        tile->type = type;
+    }
+}
+
+/* Followers in a maze, without any entities or rendering.
+ * The target moves every so often, so the field has to be updated while the followers find their way through
+ */
+BENCHMARK(pathfinding, "followers:int[1,1000000]=1000 ticks:int[1,100000]=600",
+    "Time followers finding their way through a maze.") {
+    int followerCount = args.getInt();
+    int ticks = args.getInt();
+
+    static constexpr int MazeChunks = 8; // chunks along each side
+    static constexpr int CellSize = 4; // corridors 3 tiles wide with walls of 1 between them
+    static constexpr int Cells = MazeChunks * CHUNKSIZE / CellSize;
+    static constexpr float FollowerSpeed = 0.25f;
+    static constexpr int TargetMoveTicks = 60;
+
+    // the tile data isn't loaded without textures, and only walkability matters here anyway
+    TileTypeData[TileTypes::Wall].flags = 0;
+    TileTypeData[TileTypes::GreyFloor].flags = TileTypes::Walkable;
+
+    ChunkMap chunkmap;
+    chunkmap.init();
+    for (int y = 0; y < MazeChunks; y++) {
+        for (int x = 0; x < MazeChunks; x++) {
+            ChunkData* chunkdata = chunkmap.newChunkAt({x, y});
+            for (int i = 0; i < ChunkTiles; i++) {
+                CHUNK_TILE_INDEX(chunkdata->chunk, i) = Tile(TileTypes::Wall);
+            }
+        }
+    }
+
+    // carve a maze out of the walls with a random depth first search, then knock down some extra walls so there are loops
+    Uint32 random = 7;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    auto carveCell = [&](IVec2 cell){
+        for (int y = 0; y < CellSize - 1; y++) {
+            for (int x = 0; x < CellSize - 1; x++) {
+                setTile(chunkmap, cell * CellSize + IVec2(x, y), TileTypes::GreyFloor);
+            }
+        }
+    };
+    auto carveWall = [&](IVec2 cell, IVec2 direction){
+        // the wall between the cell and the next one in the direction
+        for (int i = 0; i < CellSize - 1; i++) {
+            IVec2 tile = cell * CellSize + (direction.x != 0 ? IVec2(direction.x > 0 ? CellSize - 1 : -1, i) : IVec2(i, direction.y > 0 ? CellSize - 1 : -1));
+            setTile(chunkmap, tile, TileTypes::GreyFloor);
+        }
+    };
+    auto visited = My::Vec<bool>::WithCapacity(Cells * Cells);
+    visited.resize(Cells * Cells, false);
+    auto stack = My::Vec<IVec2>::Empty();
+    stack.push(IVec2(0, 0));
+    visited[0] = true;
+    carveCell({0, 0});
+    while (!stack.empty()) {
+        IVec2 cell = stack.back();
+        IVec2 options[4];
+        int optionCount = 0;
+        for (IVec2 direction : SideDirections) {
+            IVec2 next = cell + direction;
+            if (next.x >= 0 && next.y >= 0 && next.x < Cells && next.y < Cells && !visited[next.y * Cells + next.x]) {
+                options[optionCount++] = direction;
+            }
+        }
+        if (optionCount == 0) {
+            stack.popBack();
+            continue;
+        }
+        IVec2 direction = options[nextRandom() % optionCount];
+        IVec2 next = cell + direction;
+        visited[next.y * Cells + next.x] = true;
+        carveCell(next);
+        carveWall(cell, direction);
+        stack.push(next);
+    }
+    for (int i = 0; i < Cells * Cells / 10; i++) {
+        IVec2 cell = {(int)(nextRandom() % (Cells - 1)), (int)(nextRandom() % (Cells - 1))};
+        carveWall(cell, nextRandom() % 2 ? IVec2(1, 0) : IVec2(0, 1));
+    }
+    visited.destroy();
+    stack.destroy();
+
+    Pathfinding pathfinding = Pathfinding::init(&chunkmap);
+    auto cellCenter = [](IVec2 cell){
+        return cell * CellSize + IVec2(CellSize / 2 - 1, CellSize / 2 - 1);
+    };
+
+    auto followers = My::Vec<Vec2>::WithCapacity(followerCount);
+    for (int i = 0; i < followerCount; i++) {
+        IVec2 tile = cellCenter({(int)(nextRandom() % Cells), (int)(nextRandom() % Cells)});
+        followers.push(Vec2(tile.x + 0.5f, tile.y + 0.5f));
+    }
+
+    const Entity target = Entity(0, 0);
+    IVec2 targetCell = {Cells / 2, Cells / 2};
+
+    double firstTickMs = 0.0; // including making every chunk's portals
+    double worstTickMs = 0.0;
+    int offPath = 0;
+
+    Uint64 start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        Uint64 tickStart = SDL_GetTicksNS();
+        if (t > 0 && t % TargetMoveTicks == 0) {
+            // wander to a nearby cell
+            targetCell.x = MAX(0, MIN(Cells - 1, targetCell.x + (int)(nextRandom() % 5) - 2));
+            targetCell.y = MAX(0, MIN(Cells - 1, targetCell.y + (int)(nextRandom() % 5) - 2));
+        }
+        const IVec2 targetTile = cellCenter(targetCell);
+
+        pathfinding.update();
+        for (Vec2& follower : followers) {
+            IVec2 tile = vecFloori(follower);
+            IVec2 next;
+            if (!pathfinding.nextTile(target, targetTile, tile, &next) || next == tile) continue;
+            // head for the middle of the next tile, which keeps followers off the walls
+            Vec2 delta = Vec2(next.x + 0.5f, next.y + 0.5f) - follower;
+            float length = sqrtf(delta.x * delta.x + delta.y * delta.y);
+            follower += delta * (MIN(FollowerSpeed, length) / length);
+            if (!pathfinding.walkable(vecFloori(follower))) {
+                offPath++;
+            }
+        }
+
+        double tickMs = (SDL_GetTicksNS() - tickStart) / 1.0e6;
+        if (t == 0) {
+            firstTickMs = tickMs;
+        } else {
+            worstTickMs = MAX(worstTickMs, tickMs);
+        }
+    }
+    double msPerTick = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+
+    const IVec2 targetTile = cellCenter(targetCell);
+    int arrived = 0; // followers that made it to the target
+    for (Vec2 follower : followers) {
+        IVec2 tile = vecFloori(follower);
+        if (abs(tile.x - targetTile.x) <= 1 && abs(tile.y - targetTile.y) <= 1) {
+            arrived++;
+        }
+    }
+    int searches = pathfinding.stats.searches;
+
+    followers.destroy();
+    pathfinding.destroy();
+    chunkmap.destroy();
+
+    if (offPath > 0) {
+        return BENCH_FAILED("followers stepped onto walls %d times", offPath);
+    }
+    return BENCH_RESULT("%d followers, %d ticks: %.4f ms per tick, %.4f ms worst, %.4f ms first. %d searches, %d arrived",
+        followerCount, ticks, msPerTick, worstTickMs, firstTickMs, searches, arrived);
+}
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+#include "physics/physics.hpp"
+#include <SDL3/SDL_timer.h>
+#include <math.h>
+
+using namespace Physics;
+
+/* Boxes and circles bouncing around a walled arena full of pillars, without any entities or rendering
+ */
+BENCHMARK(physics, "bodies:int[1,1000000]=20000 ticks:int[1,100000]=300",
+    "Time boxes and circles colliding with each other, pillars and walls.") {
+    int bodyCount = args.getInt();
+    int ticks = args.getInt();
+
+    static constexpr int PillarSpacing = 8;
+    static constexpr float MaxSpeed = 0.1f;
+    // about four tiles of room for each body
+    const int arenaSize = MAX(16, (int)sqrtf(bodyCount * 4.0f));
+
+    Space space = Space::init();
+    space.solidTile = [arenaSize](IVec2 tile){
+        return tile.x < 0 || tile.y < 0 || tile.x >= arenaSize || tile.y >= arenaSize;
+    };
+    for (int y = PillarSpacing / 2; y < arenaSize; y += PillarSpacing) {
+        for (int x = PillarSpacing / 2; x < arenaSize; x += PillarSpacing) {
+            space.addBody(Shape::Box, Vec2(x + 0.5f, y + 0.5f), Vec2(0.5f), true);
+        }
+    }
+
+    Uint32 random = 7;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return (random >> 8) / (float)(1 << 24);
+    };
+    for (int i = 0; i < bodyCount; i++) {
+        Shape shape = i % 2 ? Shape::Circle : Shape::Box;
+        Vec2 position = Vec2(1.0f + nextRandom() * (arenaSize - 2), 1.0f + nextRandom() * (arenaSize - 2));
+        Vec2 halfSize = Vec2(0.2f + nextRandom() * 0.2f, 0.2f + nextRandom() * 0.2f);
+        BodyID id = space.addBody(shape, position, halfSize, false);
+        space.bodies[id].velocity = Vec2(nextRandom() * 2.0f - 1.0f, nextRandom() * 2.0f - 1.0f) * MaxSpeed;
+        space.bodies[id].restitution = 0.9f;
+    }
+
+    int staticBodies = space.stats.staticBodies;
+    double worstTickMs = 0.0;
+    Uint64 contacts = 0;
+
+    Uint64 start = SDL_GetTicksNS();
+    for (int t = 0; t < ticks; t++) {
+        Uint64 tickStart = SDL_GetTicksNS();
+        space.step();
+        contacts += space.stats.contacts;
+        worstTickMs = MAX(worstTickMs, (SDL_GetTicksNS() - tickStart) / 1.0e6);
+    }
+    double msPerTick = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+    double contactsPerTick = (double)contacts / ticks;
+
+    space.destroy();
+    return BENCH_RESULT("%d bodies, %d static, %d ticks: %.4f ms per tick, %.4f ms worst. %.1f contacts per tick",
+        bodyCount, staticBodies, ticks, msPerTick, worstTickMs, contactsPerTick);
+}
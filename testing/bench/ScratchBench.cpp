@@ -0,0 +1,98 @@
+#include "bench.hpp"
+#include "My/ScratchAllocator.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace My;
+
+namespace {
+
+// its own arena, so the benchmark doesn't throw away the scratch memory of the frame it's run in
+ScratchArena* benchmarkArena = nullptr;
+int heapAllocations = 0;
+
+struct BenchmarkScratchAllocator : IAllocator<BenchmarkScratchAllocator> {
+    using size_type = size_t;
+
+    void* allocate(size_t size) const {
+        return benchmarkArena->allocate(size);
+    }
+    void deallocate(void* ptr) const {
+        benchmarkArena->deallocate(ptr);
+    }
+    void* reallocate(void* ptr, size_t size) const {
+        return benchmarkArena->reallocate(ptr, size);
+    }
+};
+
+struct CountingHeapAllocator : IAllocator<CountingHeapAllocator> {
+    using size_type = size_t;
+
+    void* allocate(size_t size) const {
+        heapAllocations++;
+        return Mem::Alloc(size);
+    }
+    void deallocate(void* ptr) const {
+        Mem::Free(ptr);
+    }
+    void* reallocate(void* ptr, size_t size) const {
+        heapAllocations++;
+        return Mem::Realloc(ptr, size);
+    }
+};
+
+struct Character {
+    float x, y;
+    Uint32 codepoint;
+};
+
+// fill buffers like laying out lines of text, a different number of characters every time
+template<class VecT>
+Uint32 buildBuffers(int buffers, Uint32 random, bool destroy) {
+    for (int i = 0; i < buffers; i++) {
+        random = random * 1664525 + 1013904223;
+        int characters = 8 + (random >> 8) % 248;
+        VecT vec = VecT::Empty();
+        for (int c = 0; c < characters; c++) {
+            vec.push(Character{(float)c, (float)i, random + c});
+        }
+        random += vec[characters / 2].codepoint;
+        if (destroy) vec.destroy();
+    }
+    return random;
+}
+
+}
+
+/* Build a bunch of temporary vectors every frame, like the text and gui code does,
+ * once from the heap and once from a frame arena, and count the heap allocations each one made
+ */
+BENCHMARK(scratch, "frames:int[1,1000000]=1000 buffers:int[1,100000]=200",
+    "Time building temporary buffers every frame from the heap and from a frame arena, and count the heap allocations.") {
+    int frames = args.getInt();
+    int buffersPerFrame = args.getInt();
+    volatile Uint32 sink = 0;
+
+    heapAllocations = 0;
+    Uint64 start = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; frame++) {
+        sink = buildBuffers< Vec<Character, CountingHeapAllocator> >(buffersPerFrame, frame, true);
+    }
+    double heapMsPerFrame = (SDL_GetTicksNS() - start) / 1.0e6 / frames;
+    double heapAllocationsPerFrame = (double)heapAllocations / frames;
+
+    ScratchArena arena = ScratchArena::init(ScratchLifetimes::Frame);
+    benchmarkArena = &arena;
+    start = SDL_GetTicksNS();
+    for (int frame = 0; frame < frames; frame++) {
+        arena.reset(frame + 1);
+        sink = buildBuffers< Vec<Character, BenchmarkScratchAllocator> >(buffersPerFrame, frame, false);
+    }
+    double scratchMsPerFrame = (SDL_GetTicksNS() - start) / 1.0e6 / frames;
+    double scratchAllocationsPerFrame = (double)arena.blockAllocations / frames;
+    arena.destroy();
+    benchmarkArena = nullptr;
+
+    (void)sink;
+    return BENCH_RESULT("%d frames of %d buffers: %.3f ms and %.1f heap allocations a frame from the heap, %.3f ms and %.3f heap allocations a frame from the frame arena",
+        frames, buffersPerFrame, heapMsPerFrame, heapAllocationsPerFrame, scratchMsPerFrame, scratchAllocationsPerFrame);
+}
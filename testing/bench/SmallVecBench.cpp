@@ -0,0 +1,107 @@
+#include "bench.hpp"
+#include "My/SmallVec.hpp"
+#include "My/Vec.hpp"
+#include <vector>
+#include <SDL3/SDL_timer.h>
+
+using namespace My;
+
+namespace {
+
+int heapAllocations = 0;
+
+struct CountingHeapAllocator : IAllocator<CountingHeapAllocator> {
+    using size_type = size_t;
+
+    void* allocate(size_t size) const {
+        heapAllocations++;
+        return Mem::Alloc(size);
+    }
+    void deallocate(void* ptr) const {
+        Mem::Free(ptr);
+    }
+    void* reallocate(void* ptr, size_t size) const {
+        heapAllocations++;
+        return Mem::Realloc(ptr, size);
+    }
+};
+
+// the size of an entity
+struct Element {
+    Uint32 id;
+    Uint32 version;
+};
+
+constexpr int InlineCapacity = 8;
+
+// how long the next list is. Most fit inline, like the entities close to a chunk
+int listLength(Uint32& random) {
+    random = random * 1664525 + 1013904223;
+    if ((random >> 4) % 16 == 0) return InlineCapacity + (random >> 8) % 24;
+    return (random >> 8) % (InlineCapacity + 1);
+}
+
+template<class VecT>
+Uint32 buildLists(int lists) {
+    Uint32 random = 11;
+    Uint32 sum = 0;
+    for (int i = 0; i < lists; i++) {
+        int length = listLength(random);
+        VecT vec = VecT::Empty();
+        for (int e = 0; e < length; e++) {
+            vec.push(Element{(Uint32)e, random});
+        }
+        for (const Element& element : vec) {
+            sum += element.id ^ element.version;
+        }
+        vec.destroy();
+    }
+    return sum;
+}
+
+Uint32 buildStdLists(int lists) {
+    Uint32 random = 11;
+    Uint32 sum = 0;
+    for (int i = 0; i < lists; i++) {
+        int length = listLength(random);
+        std::vector<Element> vec;
+        for (int e = 0; e < length; e++) {
+            vec.push_back(Element{(Uint32)e, random});
+        }
+        for (const Element& element : vec) {
+            sum += element.id ^ element.version;
+        }
+    }
+    return sum;
+}
+
+}
+
+/* Build lots of short lists of entity sized elements, mostly short enough to stay inline and now and then longer,
+ * with My::SmallVec, My::Vec and std::vector, and count the heap allocations the My ones make
+ */
+BENCHMARK(smallVec, "lists:int[1,100000000]=1000000",
+    "Time building lots of short lists with SmallVec, Vec and std::vector, and count the heap allocations.") {
+    int lists = args.getInt();
+    volatile Uint32 sink = 0;
+
+    heapAllocations = 0;
+    Uint64 start = SDL_GetTicksNS();
+    sink = buildLists< SmallVec<Element, InlineCapacity, CountingHeapAllocator> >(lists);
+    double smallVecNs = (double)(SDL_GetTicksNS() - start) / lists;
+    double smallVecAllocations = (double)heapAllocations / lists;
+
+    heapAllocations = 0;
+    start = SDL_GetTicksNS();
+    sink = buildLists< Vec<Element, CountingHeapAllocator> >(lists);
+    double vecNs = (double)(SDL_GetTicksNS() - start) / lists;
+    double vecAllocations = (double)heapAllocations / lists;
+
+    start = SDL_GetTicksNS();
+    sink = buildStdLists(lists);
+    double stdVectorNs = (double)(SDL_GetTicksNS() - start) / lists;
+
+    (void)sink;
+    return BENCH_RESULT("%d lists, %d inline: SmallVec %.1f ns and %.3f allocations a list, Vec %.1f ns and %.3f allocations a list, std::vector %.1f ns a list",
+        lists, InlineCapacity, smallVecNs, smallVecAllocations, vecNs, vecAllocations, stdVectorNs);
+}
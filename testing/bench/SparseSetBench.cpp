@@ -0,0 +1,81 @@
+#include "bench.hpp"
+#include "My/SparseSets.hpp"
+#include "utils/common-macros.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace My;
+
+// big enough that a flat sparse side is a lot more than a few pages
+static constexpr Uint32 BenchmarkMaxKey = (1 << 22) - 1;
+
+using FlatSet = GenericDenseSparseSet<Uint32, BenchmarkMaxKey>;
+using PagedSet = DenseSparseSet<Uint32, Uint32, Uint32, BenchmarkMaxKey>;
+
+namespace {
+
+struct Random {
+    Uint32 state;
+
+    Uint32 next(Uint32 below) {
+        state = state * 1664525 + 1013904223;
+        return (Uint32)(((Uint64)(state >> 4) * below) >> 28);
+    }
+};
+
+}
+
+/* Fill a flat and a paged sparse set with randomly spread keys, at a range of densities,
+ * and compare the memory their sparse sides use and how long looking up random keys takes
+ */
+BENCHMARK(sparseSets, "maxKey:int[1,4194303]=4194303 lookups:int[1,100000000]=1000000",
+    "Compare the memory and lookup time of sparse sets with flat and paged sparse sides, from 0.01% to 100% of keys used.") {
+    int maxKey = args.getInt();
+    int lookups = args.getInt();
+
+    static const double densities[] = {0.0001, 0.001, 0.01, 0.1, 1.0};
+    Uint32 keyRange = (Uint32)MIN((Uint32)maxKey, BenchmarkMaxKey) + 1;
+
+    std::string message;
+    for (double density : densities) {
+        FlatSet flat = FlatSet(sizeof(Uint32), 0);
+        PagedSet paged = PagedSet::Empty();
+        // take each key with the chance of the density
+        Random random = {12345};
+        for (Uint32 key = 0; key < keyRange; key++) {
+            if (density < 1.0 && random.next(1 << 24) >= (Uint32)(density * (1 << 24))) continue;
+            flat.insert(key, &key);
+            paged.insert(key, key);
+        }
+        size_t flatBytes = (size_t)keyRange * sizeof(Uint32);
+        size_t pagedBytes = paged.sparseBytes();
+
+        // look up random keys, hit or miss, summing what's found so the lookups can't be skipped
+        Uint64 flatSum = 0;
+        Uint64 pagedSum = 0;
+        random = {678};
+        Uint64 start = SDL_GetTicksNS();
+        for (int i = 0; i < lookups; i++) {
+            auto* value = (Uint32*)flat.lookup(random.next(keyRange));
+            if (value) flatSum += *value;
+        }
+        Uint64 flatNs = SDL_GetTicksNS() - start;
+
+        random = {678};
+        start = SDL_GetTicksNS();
+        for (int i = 0; i < lookups; i++) {
+            auto* value = paged.lookup(random.next(keyRange));
+            if (value) pagedSum += *value;
+        }
+        Uint64 pagedNs = SDL_GetTicksNS() - start;
+
+        int keys = paged.getSize();
+        flat.destroy();
+        paged.destroy();
+        if (flatSum != pagedSum) {
+            return BENCH_FAILED("Flat and paged sparse sets disagree! %llu vs %llu", (unsigned long long)flatSum, (unsigned long long)pagedSum);
+        }
+        message += string_format("%.2f%% (%d keys): flat %zu KiB, %.2f ns a lookup. paged %zu KiB, %.2f ns a lookup\n",
+            density * 100.0, keys, flatBytes / 1024, (double)flatNs / lookups, pagedBytes / 1024, (double)pagedNs / lookups);
+    }
+    return BENCH_RESULT("%s", message.c_str());
+}
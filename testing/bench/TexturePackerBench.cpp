@@ -0,0 +1,224 @@
+#include "bench.hpp"
+#include "rendering/TexturePacker.hpp"
+#include <vector>
+#include <SDL3/SDL_timer.h>
+
+/* The binary tree packer the skyline packer replaced, kept here to compare against.
+ * Based on this article "https://straypixels.net/texture-packing-for-fonts/" by Edward Lu
+ */
+namespace BinaryTreePacker {
+
+constexpr int NullNode = -1;
+
+struct Node {
+    glm::ivec2 origin;
+    glm::ivec2 size;
+    int left;
+    int right;
+
+    Node(glm::ivec2 origin, glm::ivec2 size)
+    : origin(origin), size(size), left(NullNode), right(NullNode) {}
+};
+
+struct Atlas {
+    static constexpr int root = 0;
+
+    Texture atlas;
+    std::vector<Node> nodes;
+    std::vector<bool> nodesEmpty;
+};
+
+static int packNode(Atlas* atlas, int nodeIndex, glm::ivec2 size) {
+    auto& nodes = atlas->nodes;
+    auto& nodesEmpty = atlas->nodesEmpty;
+    if (!nodesEmpty[nodeIndex]) {
+        return NullNode;
+    } else if (nodes[nodeIndex].left != NullNode && nodes[nodeIndex].right != NullNode) {
+        int retval = packNode(atlas, nodes[nodeIndex].left, size);
+        if (retval != NullNode) {
+            return retval;
+        }
+        return packNode(atlas, nodes[nodeIndex].right, size);
+    }
+
+    glm::ivec2 realSize = nodes[nodeIndex].size;
+    auto origin = nodes[nodeIndex].origin;
+    if (origin.x + nodes[nodeIndex].size.x == INT_MAX) {
+        realSize.x = atlas->atlas.size.x - origin.x;
+    }
+    if (origin.y + nodes[nodeIndex].size.y == INT_MAX) {
+        realSize.y = atlas->atlas.size.y - origin.y;
+    }
+
+    if (nodes[nodeIndex].size.x == size.x && nodes[nodeIndex].size.y == size.y) {
+        nodesEmpty[nodeIndex] = false;
+        return nodeIndex;
+    }
+    if (size.x > realSize.x || size.y > realSize.y) {
+        return NullNode;
+    }
+
+    int left = (int)nodes.size();
+    int right = left + 1;
+    auto nodeSize = nodes[nodeIndex].size;
+    int remainX = realSize.x - size.x;
+    int remainY = realSize.y - size.y;
+    bool verticalSplit = remainX < remainY;
+    if (remainX == 0 && remainY == 0) {
+        verticalSplit = !(nodeSize.x > nodeSize.y);
+    }
+    if (verticalSplit) {
+        nodes.push_back(Node(origin, glm::ivec2(nodeSize.x, size.y)));
+        nodes.push_back(Node(glm::ivec2(origin.x, origin.y + size.y), glm::ivec2(nodeSize.x, nodeSize.y - size.y)));
+    } else {
+        nodes.push_back(Node(origin, glm::ivec2(size.x, nodeSize.y)));
+        nodes.push_back(Node(glm::ivec2(origin.x + size.x, origin.y), glm::ivec2(nodeSize.x - size.x, nodeSize.y)));
+    }
+    nodesEmpty.resize(nodesEmpty.size() + 2, true);
+    nodes[nodeIndex].left = left;
+    nodes[nodeIndex].right = right;
+    return packNode(atlas, left, size);
+}
+
+static glm::ivec2 packTexture(Atlas* atlas, Texture texture, glm::ivec2 padding) {
+    texture.size += padding;
+    int nodeIndex = packNode(atlas, Atlas::root, texture.size);
+    while (nodeIndex == NullNode) {
+        int newSize = MAX(MAX(atlas->atlas.size.x*2, texture.size.x*2), MAX(atlas->atlas.size.y*2, texture.size.y*2));
+        resizeTexture(&atlas->atlas, glm::ivec2(newSize));
+        nodeIndex = packNode(atlas, Atlas::root, texture.size);
+    }
+    texture.size -= padding;
+    glm::ivec2 origin = atlas->nodes[nodeIndex].origin;
+    copyTexture(atlas->atlas, texture, origin);
+    return origin;
+}
+
+static Texture packTextures(int numTextures, const Texture* textures, int pixelSize, glm::ivec2* origins, glm::ivec2 padding, int startSize) {
+    Atlas atlas;
+    atlas.atlas = newUninitTexture(glm::ivec2(startSize), pixelSize);
+    fillTextureBlack(atlas.atlas);
+    atlas.nodes.push_back(Node({0, 0}, {INT_MAX, INT_MAX}));
+    atlas.nodesEmpty.push_back(true);
+    for (int i = 0; i < numTextures; i++) {
+        origins[i] = packTexture(&atlas, textures[i], padding);
+    }
+    return atlas.atlas;
+}
+
+}
+
+namespace {
+
+std::vector<Texture> makeTextures(int count, glm::ivec2 minSize, glm::ivec2 maxSize, int pixelSize, Uint32 seed) {
+    std::vector<Texture> textures;
+    Uint32 random = seed;
+    auto next = [&](int min, int max) -> int {
+        random = random * 1664525 + 1013904223;
+        return min + (int)((random >> 8) % (Uint32)(max - min + 1));
+    };
+    for (int i = 0; i < count; i++) {
+        glm::ivec2 size = {next(minSize.x, maxSize.x), next(minSize.y, maxSize.y)};
+        Texture texture = newUninitTexture(size, pixelSize);
+        memset(texture.buffer, (i % 255) + 1, (size_t)size.x * size.y * pixelSize);
+        textures.push_back(texture);
+    }
+    return textures;
+}
+
+// how many packed textures overlap one another or go past the edge of the atlas
+int countOverlaps(const std::vector<Texture>& textures, const std::vector<glm::ivec2>& origins, glm::ivec2 padding, glm::ivec2 atlasSize) {
+    std::vector<bool> used((size_t)atlasSize.x * atlasSize.y, false);
+    int overlaps = 0;
+    for (size_t i = 0; i < textures.size(); i++) {
+        glm::ivec2 origin = origins[i];
+        glm::ivec2 size = textures[i].size + padding;
+        if (origin.x < 0 || origin.y < 0 || origin.x + size.x > atlasSize.x || origin.y + size.y > atlasSize.y) {
+            overlaps++;
+            continue;
+        }
+        bool overlapped = false;
+        for (int y = origin.y; y < origin.y + size.y; y++) {
+            for (int x = origin.x; x < origin.x + size.x; x++) {
+                size_t pixel = (size_t)y * atlasSize.x + x;
+                overlapped |= used[pixel];
+                used[pixel] = true;
+            }
+        }
+        overlaps += overlapped;
+    }
+    return overlaps;
+}
+
+struct PackResult {
+    glm::ivec2 size;
+    float occupancy;
+    double ms;
+    int overlaps;
+};
+
+PackResult packWithTree(const std::vector<Texture>& textures, int pixelSize, glm::ivec2 padding) {
+    std::vector<glm::ivec2> origins(textures.size());
+    Uint64 start = SDL_GetTicksNS();
+    Texture atlas = BinaryTreePacker::packTextures((int)textures.size(), textures.data(), pixelSize, origins.data(), padding, 128);
+    double ms = (double)(SDL_GetTicksNS() - start) / 1e6;
+
+    int64_t used = 0;
+    for (const auto& texture : textures) {
+        used += (int64_t)(texture.size.x + padding.x) * (texture.size.y + padding.y);
+    }
+    PackResult result = {atlas.size, (float)((double)used / ((double)atlas.size.x * atlas.size.y)), ms,
+        countOverlaps(textures, origins, padding, atlas.size)};
+    freeTexture(atlas);
+    return result;
+}
+
+PackResult packWithSkyline(const std::vector<Texture>& textures, int pixelSize, glm::ivec2 padding) {
+    std::vector<glm::ivec2> origins(textures.size());
+    TexturePackingStats stats;
+    Uint64 start = SDL_GetTicksNS();
+    Texture atlas = packTextures((int)textures.size(), textures.data(), pixelSize, origins.data(), padding, 128, &stats);
+    double ms = (double)(SDL_GetTicksNS() - start) / 1e6;
+
+    PackResult result = {atlas.size, stats.occupancy(), ms, countOverlaps(textures, origins, padding, atlas.size)};
+    freeTexture(atlas);
+    return result;
+}
+
+}
+
+BENCHMARK(texturePacker, "glyphs:int[1,100000]=10000 sprites:int[1,10000]=200",
+    "Pack a set of glyph sized and a set of sprite sized textures with the old binary tree packer and the skyline packer, and check nothing overlaps.") {
+    int glyphCount = args.getInt();
+    int spriteCount = args.getInt();
+
+    struct Set {
+        const char* name;
+        std::vector<Texture> textures;
+        int pixelSize;
+        glm::ivec2 padding;
+    } sets[] = {
+        {"sprites", makeTextures(spriteCount, {16, 16}, {128, 128}, 4, 1), 4, {0, 0}},
+        {"glyphs", makeTextures(glyphCount, {4, 6}, {28, 34}, 1, 2), 1, {1, 1}}
+    };
+
+    std::string message;
+    int overlaps = 0;
+    for (auto& set : sets) {
+        auto tree = packWithTree(set.textures, set.pixelSize, set.padding);
+        auto skyline = packWithSkyline(set.textures, set.pixelSize, set.padding);
+        overlaps += tree.overlaps + skyline.overlaps;
+        message += string_format("\n%d %s: tree %dx%d %.0f%% %.3f ms, skyline %dx%d %.0f%% %.3f ms",
+            (int)set.textures.size(), set.name,
+            tree.size.x, tree.size.y, tree.occupancy * 100.0f, tree.ms,
+            skyline.size.x, skyline.size.y, skyline.occupancy * 100.0f, skyline.ms);
+        for (auto texture : set.textures) {
+            freeTexture(texture);
+        }
+    }
+
+    if (overlaps > 0) {
+        return BENCH_FAILED("%d textures overlapped or went off the atlas%s", overlaps, message.c_str());
+    }
+    return BENCH_RESULT("%s", message.c_str());
+}
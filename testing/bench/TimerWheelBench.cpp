@@ -0,0 +1,58 @@
+#include "bench.hpp"
+#include "world/TimerWheel.hpp"
+#include <SDL3/SDL_timer.h>
+
+using namespace World;
+
+// fire and reschedule the same number of short timers every tick, with some number of timers waiting far in the future
+static double timeTicks(int pending, int firedPerTick, int ticks, int* firedOut) {
+    // far enough out that none of the pending timers go off during the benchmark
+    static constexpr Tick PendingRange = 1 << 20;
+    static constexpr int ShortTimerTicks = 30;
+
+    TimerWheel wheel = TimerWheel::init(0);
+    Uint32 random = 7;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    for (int i = 0; i < pending; i++) {
+        wheel.schedule(ticks + 1 + nextRandom() % PendingRange, Entity(i % MAX_ENTITIES, 1), TimerAction::Destroy, 0);
+    }
+    // get the short timers going so every tick fires about the same number
+    for (int i = 0; i < firedPerTick * ShortTimerTicks; i++) {
+        wheel.schedule(1 + i % ShortTimerTicks, NullEntity, TimerAction::Call, 0);
+    }
+
+    int fired = 0;
+    Uint64 start = SDL_GetTicksNS();
+    Timer timer;
+    for (Tick t = 1; t <= ticks; t++) {
+        while (wheel.next(t, &timer)) {
+            wheel.schedule(t + ShortTimerTicks, NullEntity, TimerAction::Call, 0);
+            fired++;
+        }
+    }
+    double msPerTick = (SDL_GetTicksNS() - start) / 1.0e6 / ticks;
+
+    wheel.destroy();
+    *firedOut = fired / ticks;
+    return msPerTick;
+}
+
+/* The same short timers fired with nothing else in the wheel, then with a lot of timers waiting,
+ * to see what the waiting ones add to the cost of a tick
+ */
+BENCHMARK(timers, "waiting:int[0,10000000]=1000000 ticks:int[1,1000000]=10000",
+    "Time firing timers with and without lots of other timers waiting.") {
+    int pending = args.getInt();
+    int ticks = args.getInt();
+
+    static constexpr int FiredPerTick = 1000;
+    int fired;
+    double emptyMs = timeTicks(0, FiredPerTick, ticks, &fired);
+    double fullMs = timeTicks(pending, FiredPerTick, ticks, &fired);
+
+    return BENCH_RESULT("%d fired per tick, %d ticks: %.5f ms per tick with nothing else waiting, %.5f ms per tick with %d waiting",
+        fired, ticks, emptyMs, fullMs, pending);
+}
@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "utils/Stats.hpp"
+#include "utils/common-macros.hpp"
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <vector>
+
+/* Record made up frame times with a few big hitches mixed in, then check the window's percentiles
+ * against the exact ones from the same times sorted
+ */
+BENCHMARK(timingStats, "samples:int[1,100000000]=1000000",
+    "Time recording frame times in histograms and reading percentiles from them, and check the percentiles against the exact ones.") {
+    int samples = args.getInt();
+
+    // frames around 16ms with a bit of noise, and every so often one that takes a lot longer
+    std::vector<Uint64> times(samples);
+    Uint32 random = 7;
+    for (int i = 0; i < samples; i++) {
+        random = random * 1664525 + 1013904223;
+        Uint64 ns = 15000000 + (random >> 8) % 3000000;
+        if ((random >> 4) % 100 == 0) ns *= 2 + (random >> 12) % 8;
+        times[i] = ns;
+    }
+
+    // slots big enough for every sample, so the window's percentiles can be checked against the sorted samples
+    TimingStats stats = TimingStats::init("benchmark", samples * TimingStats::Slots);
+    Uint64 start = SDL_GetTicksNS();
+    for (int i = 0; i < samples; i++) {
+        stats.record(times[i]);
+    }
+    double recordNs = (double)(SDL_GetTicksNS() - start) / samples;
+
+    constexpr int Lookups = 1000;
+    const double fractions[] = {0.5, 0.95, 0.99};
+    volatile Uint64 sink = 0;
+    start = SDL_GetTicksNS();
+    for (int i = 0; i < Lookups; i++) {
+        sink = sink + stats.window.percentile(fractions[i % 3]);
+    }
+    double percentileUs = (double)(SDL_GetTicksNS() - start) / Lookups / 1000.0;
+
+    std::sort(times.begin(), times.end());
+    double worstError = 0.0;
+    for (double fraction : fractions) {
+        Uint64 rank = MAX((Uint64)SDL_ceil(fraction * samples), (Uint64)1);
+        double exact = (double)times[rank - 1];
+        double error = SDL_fabs((double)stats.window.percentile(fraction) - exact) / exact;
+        worstError = MAX(worstError, error);
+    }
+    stats.destroy();
+
+    if (worstError > TimeHistogram::MaxRelativeError) {
+        return BENCH_FAILED("Timing stats percentile off by %.3f%%, more than the %.3f%% it should ever be", worstError * 100.0, TimeHistogram::MaxRelativeError * 100.0);
+    }
+    return BENCH_RESULT("%d times: %.1f ns a time recorded, %.2f us a percentile, p50/p95/p99 off by at most %.3f%% (up to %.3f%% allowed)",
+        samples, recordNs, percentileUs, worstError * 100.0, TimeHistogram::MaxRelativeError * 100.0);
+}
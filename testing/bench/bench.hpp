@@ -0,0 +1,26 @@
+#ifndef TESTING_BENCH_INCLUDED
+#define TESTING_BENCH_INCLUDED
+
+#include "CommandRegistry.hpp"
+#include "utils/Log.hpp"
+#include "My/String.hpp"
+
+/* Benchmarks register themselves before main runs, as commands with the arguments they take.
+ * Their arguments are checked and defaulted the same way the console's are, so
+ * `bench belts 10000 200000 600` and `bench belts` both work, and `bench belts -5` says what's wrong.
+ */
+
+std::vector<Command>& benchmarks();
+
+int registerBenchmark(const char* name, const char* signature, const char* description, const Command::FunctionType& function);
+
+#define BENCHMARK(name, signature, description) \
+    static Command::Result name(CommandArgs args); \
+    static const int name##Registered = registerBenchmark(#name, signature, description, name); \
+    static Command::Result name(CommandArgs args)
+
+#define BENCH_RESULT(...) Command::Result{Command::Result::Success, string_format(__VA_ARGS__)}
+// for benchmarks that check their results along the way
+#define BENCH_FAILED(...) Command::Result{Command::Result::Error, string_format(__VA_ARGS__)}
+
+#endif
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+#include <stdio.h>
+#include <string.h>
+
+std::vector<Command>& benchmarks() {
+    static std::vector<Command> list;
+    return list;
+}
+
+int registerBenchmark(const char* name, const char* signature, const char* description, const Command::FunctionType& function) {
+    Command command = Command::make(name, function);
+    command.description = description;
+    command.setArgs(signature);
+    benchmarks().push_back(command);
+    return 0;
+}
+
+static void printUsage() {
+    printf("bench <name> [arguments...] to run one benchmark, bench all to run every one with the default arguments.\n\n");
+    for (const auto& command : benchmarks()) {
+        printf("%s\n    %s\n", command.schema.usage(command.name).c_str(), command.description.c_str());
+    }
+}
+
+static bool run(const Command& command, const char* arguments) {
+    auto result = command.run(arguments);
+    printf("%s: %s\n", command.name, result.message.c_str());
+    return result.type != Command::Result::Error;
+}
+
+int main(int argc, char** argv) {
+    gLogger.useEscapeCodes = false;
+
+    if (argc < 2) {
+        printUsage();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "all") == 0) {
+        int failed = 0;
+        for (const auto& command : benchmarks()) {
+            failed += !run(command, "");
+        }
+        return failed > 0;
+    }
+
+    CommandTable table = CommandTable::build(benchmarks());
+    int index = table.find(benchmarks(), argv[1], (int)strlen(argv[1]));
+    if (index < 0) {
+        printf("No benchmark named %s.\n\n", argv[1]);
+        printUsage();
+        return 1;
+    }
+
+    std::string arguments;
+    for (int i = 2; i < argc; i++) {
+        if (i > 2) arguments += ' ';
+        arguments += argv[i];
+    }
+    return !run(benchmarks()[index], arguments.c_str());
+}
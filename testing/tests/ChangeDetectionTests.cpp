@@ -0,0 +1,104 @@
+#include "test.hpp"
+#include "itemTesting.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace items;
+
+// any entity manager will do, so this uses the item components
+struct ChangeTest {
+    ItemManager manager;
+    std::vector<Entity> entities;
+
+    static ChangeTest make(int count) {
+        ChangeTest test;
+        test.manager = makeItemManager();
+        for (int i = 0; i < count; i++) {
+            Entity entity = test.manager.newEntity(ItemTypes::SandGun);
+            test.manager.addComponent<ITC::Durability>(entity, {i});
+            test.manager.addComponent<ITC::Wetness>(entity, {0});
+            test.entities.push_back(entity);
+        }
+        return test;
+    }
+
+    std::vector<Entity> changed(ECS::ComponentID component, ECS::ChangeVersion since) const {
+        std::vector<Entity> found;
+        manager.forEachChangedEntity([](ECS::Signature){ return true; }, component, since, [&](Entity entity){
+            found.push_back(entity);
+        });
+        return found;
+    }
+
+    void destroy() {
+        manager.destroy();
+    }
+};
+
+static bool contains(const std::vector<Entity>& entities, Entity entity) {
+    return std::find(entities.begin(), entities.end(), entity) != entities.end();
+}
+
+TEST(changeDetectionWritesMarkTheirBlock) {
+    ChangeTest test = ChangeTest::make(1000);
+    // just added, so everything is new
+    CHECK_EQ(test.changed(ITC::Durability::ID, 0).size(), 1000u);
+
+    ECS::ChangeVersion since = test.manager.components.advanceChangeVersion();
+    CHECK_EQ(test.changed(ITC::Durability::ID, since).size(), 0u);
+
+    // reading doesn't count
+    const ITC::Durability* read = test.manager.getComponent<const ITC::Durability>(test.entities[500]);
+    CHECK(read && read->level == 500);
+    CHECK_EQ(test.changed(ITC::Durability::ID, since).size(), 0u);
+
+    // writing does, for the block of the entity and the component written only
+    test.manager.getComponent<ITC::Durability>(test.entities[500])->level = 1;
+    std::vector<Entity> changed = test.changed(ITC::Durability::ID, since);
+    CHECK(contains(changed, test.entities[500]));
+    CHECK(changed.size() <= (size_t)ECS::ArchetypePool::ChangeBlockSize);
+    CHECK_EQ(test.changed(ITC::Wetness::ID, since).size(), 0u);
+
+    // the next version doesn't see it any more, but does see what's written after
+    since = test.manager.components.advanceChangeVersion();
+    CHECK_EQ(test.changed(ITC::Durability::ID, since).size(), 0u);
+    test.manager.setComponent<ITC::Wetness>(test.entities[3], {1});
+    test.manager.setComponent<ITC::Wetness>(test.entities[999], {1});
+    changed = test.changed(ITC::Wetness::ID, since);
+    CHECK(contains(changed, test.entities[3]));
+    CHECK(contains(changed, test.entities[999]));
+    CHECK(changed.size() <= 2 * (size_t)ECS::ArchetypePool::ChangeBlockSize);
+
+    test.destroy();
+}
+
+TEST(changeDetectionMovedRowsCount) {
+    ChangeTest test = ChangeTest::make(300);
+    ECS::ChangeVersion since = test.manager.components.advanceChangeVersion();
+
+    // the last entity gets swapped into the deleted one's row, so it shows up as changed even though it wasn't written
+    test.manager.deleteEntity(test.entities[10]);
+    std::vector<Entity> changed = test.changed(ITC::Durability::ID, since);
+    CHECK(contains(changed, test.entities[299]));
+    CHECK(!contains(changed, test.entities[10]));
+    CHECK_EQ(test.manager.getComponent<const ITC::Durability>(test.entities[299])->level, 299);
+
+    // so does an entity moving to a different archetype
+    since = test.manager.components.advanceChangeVersion();
+    test.manager.removeComponent<ITC::Wetness>(test.entities[150]);
+    changed = test.changed(ITC::Durability::ID, since);
+    CHECK(contains(changed, test.entities[150]));
+    CHECK(changed.size() <= 2 * (size_t)ECS::ArchetypePool::ChangeBlockSize + 1);
+
+    // systems with write access mark the whole column, so every entity in the pool comes up
+    since = test.manager.components.advanceChangeVersion();
+    ECS::ArchetypePool& pool = test.manager.components.pools[test.manager.components.entityData.lookup(test.entities[0].id)->archetype];
+    pool.markAllChanged(pool.archetype.getIndex(ITC::Durability::ID), test.manager.components.changeVersion);
+    int inPool = 0;
+    for (Entity entity : test.changed(ITC::Durability::ID, since)) {
+        inPool += test.manager.entityHas<ITC::Wetness>(entity);
+    }
+    CHECK_EQ(inPool, pool.size);
+
+    test.destroy();
+}
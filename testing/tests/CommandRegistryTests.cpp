@@ -0,0 +1,214 @@
+#include "test.hpp"
+#include "CommandRegistry.hpp"
+#include "My/String.hpp"
+#include <vector>
+#include <string>
+
+static Command::Result succeed(CommandArgs) {
+    return Command::Result{Command::Result::Success, ""};
+}
+
+static bool tokensAre(const char* text, std::vector<std::string> expected) {
+    std::vector<CommandToken> tokens;
+    std::string error;
+    if (!tokenizeCommandArgs(text, &tokens, &error) || tokens.size() != expected.size()) return false;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].value != expected[i]) return false;
+    }
+    return true;
+}
+
+static bool tokenError(const char* text) {
+    std::vector<CommandToken> tokens;
+    std::string error;
+    return !tokenizeCommandArgs(text, &tokens, &error) && !error.empty();
+}
+
+static bool bindsTo(const Command& command, const char* arguments, std::vector<std::string> expected) {
+    CommandArgs args;
+    std::string error;
+    return command.bind(arguments, &args, &error) && args.values == expected;
+}
+
+static bool bindError(const Command& command, const char* arguments) {
+    CommandArgs args;
+    std::string error;
+    return !command.bind(arguments, &args, &error) && !error.empty();
+}
+
+static bool schemaError(const char* signature) {
+    CommandSchema schema;
+    std::string error;
+    return !CommandSchema::parse(signature, &schema, &error) && !error.empty();
+}
+
+TEST(commandTokenizing) {
+    CHECK(tokensAre("", {}));
+    CHECK(tokensAre("   \t ", {}));
+    CHECK(tokensAre("a b  c", {"a", "b", "c"}));
+    CHECK(tokensAre("a\tb\r\n", {"a", "b"}));
+    CHECK(tokensAre("\"a b\" c", {"a b", "c"}));
+    CHECK(tokensAre("\"\"", {""}));
+    CHECK(tokensAre("\"say \\\"hi\\\" \\\\ bye\"", {"say \"hi\" \\ bye"}));
+    CHECK(tokensAre("\"a\\nb\"", {"a\\nb"}));
+    CHECK(tokensAre("a\"b", {"a\"b"}));
+    CHECK(tokensAre("{x: 1, y: {2}} z", {"{x: 1, y: {2}}", "z"}));
+    CHECK(tokensAre("pos{1, 2}", {"pos{1, 2}"}));
+    CHECK(tokenError("\"never closed"));
+    CHECK(tokenError("\"a\"b"));
+    CHECK(tokenError("{x: 1"));
+    CHECK(tokenError("x}"));
+}
+
+TEST(commandArgsBinding) {
+    Command command = Command::make("test", succeed);
+    command.setArgs("count:int[1,100] dir:{up,down}=down flag:bool=off scale:float[0,]=1.5");
+    CHECK(command.schema.defined);
+    CHECK_EQ(command.schema.args.size(), 4u);
+    CHECK(bindsTo(command, "5", {"5", "down", "0", "1.5"}));
+    CHECK(bindsTo(command, "5 UP yes 2", {"5", "up", "1", "2"}));
+    CHECK(bindsTo(command, " 100  down  0 ", {"100", "down", "0", "1.5"}));
+    CHECK(bindError(command, ""));
+    CHECK(bindError(command, "abc"));
+    CHECK(bindError(command, "5.5"));
+    CHECK(bindError(command, "0"));
+    CHECK(bindError(command, "101"));
+    CHECK(bindError(command, "99999999999"));
+    CHECK(bindError(command, "5 left"));
+    CHECK(bindError(command, "5 up maybe"));
+    CHECK(bindError(command, "5 up on -1"));
+    CHECK(bindError(command, "5 up on 1 extra"));
+    CHECK(bindError(command, "\"5"));
+
+    Command say = Command::make("say", succeed);
+    say.setArgs("who:string message:text=");
+    CHECK(bindsTo(say, "bob  hello   world  ", {"bob", "hello   world"}));
+    CHECK(bindsTo(say, "\"bob smith\" hi", {"bob smith", "hi"}));
+    CHECK(bindsTo(say, "bob", {"bob", ""}));
+
+    Command none = Command::make("none", succeed);
+    none.setArgs("");
+    CHECK(bindsTo(none, "", {}));
+    CHECK(bindError(none, "x"));
+
+    // without a schema, arguments are passed on as they were typed
+    Command unchecked = Command::make("unchecked", succeed);
+    CHECK(bindsTo(unchecked, "anything goes 3", {"anything", "goes", "3"}));
+}
+
+TEST(commandSchemaErrors) {
+    CHECK(schemaError("count"));
+    CHECK(schemaError(":int"));
+    CHECK(schemaError("count:wat"));
+    CHECK(schemaError("a:int=1 b:int"));
+    CHECK(schemaError("name:string[1,2]"));
+    CHECK(schemaError("rest:text b:int"));
+    CHECK(schemaError("a:int=x"));
+    CHECK(schemaError("a:int[1,10]=20"));
+    CHECK(schemaError("a:{}"));
+    CHECK(schemaError("a:{up,,down}"));
+    CHECK(schemaError("a:int[1"));
+}
+
+TEST(commandScriptParsing) {
+    CommandScript script;
+    std::string error;
+    bool parsed = CommandScript::parse("# setup\n\n@10 spawn tree 5\r\n+5 /setDebugSetting x 1\n  clear  \n@20 getTick\n", &script, &error);
+    CHECK(parsed);
+    CHECK_EQ(script.steps.size(), 4u);
+    if (script.steps.size() == 4) {
+        CHECK(script.steps[0].tick == 10 && script.steps[0].line == 3 && script.steps[0].command == "spawn" && script.steps[0].arguments == "tree 5");
+        CHECK(script.steps[1].tick == 15 && script.steps[1].command == "setDebugSetting" && script.steps[1].arguments == "x 1");
+        CHECK(script.steps[2].tick == 15 && script.steps[2].command == "clear" && script.steps[2].arguments.empty());
+        CHECK(script.steps[3].tick == 20 && script.steps[3].line == 6);
+    }
+    // going back in time, ticks that aren't a number, no command, negative ticks, and a tick run into the command
+    CHECK(!CommandScript::parse("@10 a\n@5 b", &script, &error));
+    CHECK(!CommandScript::parse("@x a", &script, &error));
+    CHECK(!CommandScript::parse("@5", &script, &error));
+    CHECK(!CommandScript::parse("+-1 a", &script, &error));
+    CHECK(!CommandScript::parse("@5a b", &script, &error));
+}
+
+TEST(commandScriptRunner) {
+    int ran[2] = {0, 0};
+    std::vector<Command> commands;
+    commands.push_back(Command::make("first", [&](CommandArgs args) {
+        ran[0] += args.getInt();
+        return Command::Result{Command::Result::Success, ""};
+    }));
+    commands.back().setArgs("amount:int=1");
+    commands.push_back(Command::make("fail", [&](CommandArgs) {
+        ran[1]++;
+        return Command::Result{Command::Result::Error, "failed"};
+    }));
+    CommandTable table = CommandTable::build(commands);
+
+    CommandScript script;
+    std::string error;
+    CHECK(CommandScript::parse("first 2\n@3 FIRST\n+2 fail\n+1 first 100", &script, &error));
+    CHECK(script.check(commands, table, &error));
+    CommandScriptRunner runner;
+    runner.start(script, 100);
+    CHECK_EQ(runner.update(99, commands, table, nullptr), 0);
+    CHECK_EQ(ran[0], 0);
+    CHECK_EQ(runner.update(100, commands, table, nullptr), 1);
+    CHECK_EQ(ran[0], 2);
+    CHECK_EQ(runner.update(104, commands, table, nullptr), 1);
+    CHECK_EQ(ran[0], 3);
+    CHECK(runner.running);
+    // stops at the command that fails, without running the one after it
+    CHECK_EQ(runner.update(200, commands, table, nullptr), 1);
+    CHECK_EQ(ran[1], 1);
+    CHECK_EQ(ran[0], 3);
+    CHECK(!runner.running);
+
+    CHECK(CommandScript::parse("first x", &script, &error) && !script.check(commands, table, &error));
+    CHECK(CommandScript::parse("nope", &script, &error) && !script.check(commands, table, &error));
+}
+
+TEST(commandTableFindsEveryName) {
+    for (int count : {0, 1, 2, 7, 100, 5000}) {
+        std::vector<Command> commands;
+        for (int i = 0; i < count; i++) {
+            commands.push_back(Command::make(string_format("command%d", i).c_str(), succeed));
+        }
+        CommandTable table = CommandTable::build(commands);
+        CHECK_EQ(table.commandCount, count);
+        // the slots are a power of two with room to spare, and never more than a few times the names
+        CHECK(table.slots.size() >= (size_t)count);
+        CHECK(table.slots.size() <= (size_t)MAX(count * 3, 4));
+
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) {
+            std::string name = string_format(i % 2 ? "command%d" : "COMMAND%d", i);
+            if (table.find(commands, name.c_str(), (int)name.size()) != i) mismatches++;
+            // names that aren't commands, including ones that start the same, aren't found
+            std::string missing = string_format("command%dx", i);
+            if (table.find(commands, missing.c_str(), (int)missing.size()) != -1) mismatches++;
+            if (table.find(commands, name.c_str(), (int)name.size() - 1) == i) mismatches++;
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK_EQ(table.find(commands, "", 0), -1);
+    }
+}
+
+TEST(commandTableDuplicateNames) {
+    std::vector<Command> commands;
+    commands.push_back(Command::make("spawn", succeed));
+    commands.push_back(Command::make("clear", succeed));
+    commands.push_back(Command::make("SPAWN", succeed));
+    commands.push_back(Command::make("", succeed));
+    commands.push_back(Command::make("clear", succeed));
+    commands.push_back(Command::make("timings", succeed));
+    CommandTable table = CommandTable::build(commands);
+    // the first one registered is the one found
+    CHECK_EQ(table.find(commands, "spawn", 5), 0);
+    CHECK_EQ(table.find(commands, "Clear", 5), 1);
+    CHECK_EQ(table.find(commands, "timings", 7), 5);
+    CHECK_EQ(table.find(commands, "", 0), -1);
+
+    // an empty table finds nothing
+    CommandTable empty;
+    CHECK_EQ(empty.find(commands, "spawn", 5), -1);
+}
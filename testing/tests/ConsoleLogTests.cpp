@@ -0,0 +1,280 @@
+#include "test.hpp"
+#include "GUI/ConsoleLog.hpp"
+#include <string.h>
+#include <limits.h>
+#include <string>
+#include <vector>
+
+using GUI::ConsoleLog;
+
+static const SDL_Color White = {255, 255, 255, 255};
+static const SDL_Color Red = {255, 0, 0, 255};
+
+// what a kept line should be, worked out without the ring buffers
+struct ExpectedLine {
+    std::string text;
+    int copyNumber;
+    SDL_Color color;
+    int category;
+    int priority;
+};
+
+static std::string drawnText(const ExpectedLine& line) {
+    if (line.copyNumber == 0) return line.text;
+    return "(" + std::to_string(line.copyNumber) + ") " + line.text;
+}
+
+/* The kept lines are the newest of everything pushed, with their text whole, in parts of the text buffer
+ * that don't overlap. The counts and the filter index match going through the kept lines by hand
+ */
+static int mismatches(const ConsoleLog& log, const std::vector<ExpectedLine>& pushed) {
+    int wrong = 0;
+    if (log.size() > (int)pushed.size() || log.size() > log.lineCapacity) return 1;
+    if (!pushed.empty() && log.size() == 0) wrong++;
+
+    int counts[ConsoleLog::MaxCategories][LogPriorities::NumPriorities] = {};
+    size_t firstKept = pushed.size() - log.size();
+    for (int i = 0; i < log.size(); i++) {
+        const ConsoleLog::Line& line = log.line(i);
+        const ExpectedLine& expected = pushed[firstKept + i];
+        if (line.seq != log.firstSeq + i) wrong++;
+        if (line.textStart + line.textLength >= log.textCapacity) {
+            wrong++;
+            continue;
+        }
+        if (log.lineText(line) != drawnText(expected) || line.textLength != strlen(log.lineText(line))) wrong++;
+        if (log.rawText(line) != expected.text || line.copyNumber != expected.copyNumber) wrong++;
+        if (line.category != expected.category || line.priority != expected.priority || line.color.r != expected.color.r) wrong++;
+        counts[line.category][line.priority]++;
+
+        // the text of the newer lines goes after it, or wrapped around to the start before it
+        for (int j = i + 1; j < log.size(); j++) {
+            const ConsoleLog::Line& other = log.line(j);
+            bool overlaps = other.textStart < line.textStart + line.textLength + 1 && line.textStart < other.textStart + other.textLength + 1;
+            if (overlaps) wrong++;
+        }
+    }
+    if (memcmp(counts, log.counts, sizeof(counts)) != 0) wrong++;
+
+    std::vector<ConsoleLog::Seq> passing;
+    for (int i = 0; i < log.size(); i++) {
+        if (log.passes(log.line(i))) passing.push_back(log.line(i).seq);
+    }
+    if ((int)passing.size() != log.viewSize()) return wrong + 1;
+    for (int i = 0; i < log.viewSize(); i++) {
+        if (log.viewLine(i).seq != passing[i]) wrong++;
+    }
+    if (log.scroll < 0 || log.scroll > MAX(log.viewSize() - 1, 0)) wrong++;
+    return wrong;
+}
+
+TEST(consoleLogKeepsNewestLines) {
+    ConsoleLog log = ConsoleLog::init(4, 4096);
+    std::vector<ExpectedLine> pushed;
+    for (int i = 0; i < 6; i++) {
+        std::string text = "line " + std::to_string(i);
+        log.push(text.c_str(), White, i % 2, LogPriorities::Info, false);
+        pushed.push_back({text, 0, White, i % 2, LogPriorities::Info});
+    }
+    CHECK_EQ(log.size(), 4);
+    CHECK_EQ(log.firstSeq, 2u);
+    CHECK(std::string(log.rawText(log.line(0))) == std::string("line 2"));
+    CHECK_EQ(log.count(1u << 0, 0), 2);
+    CHECK_EQ(log.count(~0u, LogPriorities::Warn), 0);
+    CHECK_EQ(mismatches(log, pushed), 0);
+
+    // long lines are cut down to a quarter of the text, without cutting a character in half
+    ConsoleLog small = ConsoleLog::init(4, 64);
+    small.push("0123456789abcdefghijklmnopqrstuvwxyz", White, 0, LogPriorities::Info, false);
+    CHECK(std::string(small.rawText(small.line(0))) == std::string("0123456789abcde"));
+    small.push("0123456789abcd\xC3\xA9xyz", White, 0, LogPriorities::Info, false);
+    CHECK(std::string(small.rawText(small.line(1))) == std::string("0123456789abcd"));
+    small.destroy();
+
+    // clearing keeps the filter but nothing else
+    ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+    filter.minPriority = LogPriorities::Warn;
+    log.setFilter(filter);
+    log.clear();
+    CHECK_EQ(log.size(), 0);
+    CHECK_EQ(log.viewSize(), 0);
+    CHECK_EQ(log.count(~0u, 0), 0);
+    log.push("after", White, 0, LogPriorities::Error, false);
+    CHECK_EQ(log.viewSize(), 1);
+    CHECK_EQ(log.filter.minPriority, (int)LogPriorities::Warn);
+    log.destroy();
+}
+
+TEST(consoleLogCopiesCountUp) {
+    ConsoleLog log = ConsoleLog::init(8, 4096);
+    log.push("same", White, 0, LogPriorities::Info, false);
+    log.push("same", White, 0, LogPriorities::Warn, false);
+    log.push("same", White, 0, LogPriorities::Info, false);
+    CHECK_EQ(log.size(), 1);
+    CHECK_EQ(log.line(0).copyNumber, 2);
+    CHECK(std::string(log.lineText(log.line(0))) == std::string("(2) same"));
+    CHECK(std::string(log.rawText(log.line(0))) == std::string("same"));
+    // the count moves to the latest copy's priority
+    CHECK_EQ(log.count(~0u, 0), 1);
+    CHECK_EQ(log.counts[0][LogPriorities::Info], 1);
+
+    // anything different is a new line: the color, the category, or who entered it
+    log.push("same", Red, 0, LogPriorities::Info, false);
+    log.push("same", Red, 1, LogPriorities::Info, false);
+    log.push("same", Red, 1, LogPriorities::Info, true);
+    CHECK_EQ(log.size(), 4);
+    CHECK_EQ(log.line(3).copyNumber, 0);
+
+    // a copy that drops out of the filter leaves the index
+    ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+    filter.minPriority = LogPriorities::Warn;
+    log.setFilter(filter);
+    log.push("loud", White, 0, LogPriorities::Error, false);
+    CHECK_EQ(log.viewSize(), 1);
+    log.push("loud", White, 0, LogPriorities::Info, false);
+    CHECK_EQ(log.viewSize(), 0);
+    CHECK_EQ(log.line(log.size() - 1).copyNumber, 1);
+    log.destroy();
+}
+
+TEST(consoleLogTextWrapsAround) {
+    // random lines of random lengths, with lots of copies, into little text so it wraps all the time,
+    // including while a copy is written again with its longer count in front
+    for (Uint32 textCapacity : {64u, 100u, 257u}) {
+        ConsoleLog log = ConsoleLog::init(16, textCapacity);
+        ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+        filter.categories = 1u << 1;
+        strcpy(filter.search, "b");
+        log.setFilter(filter);
+
+        std::vector<ExpectedLine> pushed;
+        Uint32 random = textCapacity;
+        auto nextRandom = [&](){
+            random = random * 1664525 + 1013904223;
+            return random >> 8;
+        };
+        int wrong = 0;
+        const Uint32 maxLength = textCapacity / 4 - 1;
+        for (int i = 0; i < 5000; i++) {
+            std::string text;
+            int length = 1 + nextRandom() % (textCapacity / 4 + 4);
+            char letter = (char)('a' + nextRandom() % 3);
+            for (int c = 0; c < length; c++) {
+                text.push_back(letter);
+            }
+            int category = nextRandom() % 2;
+            LogPriority priority = (LogPriority)(nextRandom() % LogPriorities::NumPriorities);
+            log.push(text.c_str(), White, category, priority, false);
+
+            if (!pushed.empty() && pushed.back().text == text && pushed.back().category == category) {
+                pushed.back().copyNumber++;
+                pushed.back().priority = priority;
+                // the longer prefix takes room from the text
+                std::string prefix = "(" + std::to_string(pushed.back().copyNumber) + ") ";
+                pushed.back().text = text.substr(0, MIN(text.size(), maxLength - prefix.size()));
+            } else {
+                pushed.push_back({text.substr(0, MIN((Uint32)text.size(), maxLength)), 0, White, category, priority});
+            }
+            if (nextRandom() % 8 == 0) log.scrollBy((int)(nextRandom() % 10) - 3);
+            wrong += mismatches(log, pushed);
+        }
+        CHECK_EQ(wrong, 0);
+        log.destroy();
+    }
+}
+
+TEST(consoleLogFilterAndScroll) {
+    ConsoleLog log = ConsoleLog::init(32, 4096);
+    for (int i = 0; i < 20; i++) {
+        std::string text = (i % 2 ? "odd " : "even ") + std::to_string(i);
+        log.push(text.c_str(), White, i % 3, (LogPriority)(i % LogPriorities::NumPriorities), false);
+    }
+
+    ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+    strcpy(filter.search, "odd");
+    filter.categories = (1u << 0) | (1u << 1);
+    log.setFilter(filter);
+    int expected = 0;
+    for (int i = 0; i < 20; i++) {
+        if (i % 2 && i % 3 != 2) expected++;
+    }
+    CHECK_EQ(log.viewSize(), expected);
+    CHECK(strstr(log.rawText(log.viewLine(0)), "odd 1") != nullptr);
+
+    // scrolling stops at the oldest line passing the filter and at the newest one
+    log.scrollBy(1000);
+    CHECK_EQ(log.scroll, expected - 1);
+    log.scrollBy(-1000);
+    CHECK_EQ(log.scroll, 0);
+    log.scrollBy(INT_MIN + 1);
+    CHECK_EQ(log.scroll, 0);
+
+    // scrolled up, what's on screen stays put when new lines come in, passing or not
+    log.scrollBy(2);
+    ConsoleLog::Seq top = log.viewLine(log.viewSize() - 1 - log.scroll).seq;
+    log.push("odd new", White, 0, LogPriorities::Info, false);
+    log.push("even new", White, 0, LogPriorities::Info, false);
+    CHECK_EQ(log.scroll, 3);
+    CHECK_EQ(log.viewLine(log.viewSize() - 1 - log.scroll).seq, top);
+
+    // changing the filter goes back to the newest line, and everything passes an empty filter
+    log.setFilter(ConsoleLog::Filter::All());
+    CHECK_EQ(log.scroll, 0);
+    CHECK_EQ(log.viewSize(), log.size());
+    CHECK_EQ(log.count(1u << 0, 0), 9);
+
+    // lines going off the end while scrolled all the way up pull the scroll back in
+    filter = ConsoleLog::Filter::All();
+    strcpy(filter.search, "new");
+    log.setFilter(filter);
+    log.scrollBy(1);
+    CHECK_EQ(log.scroll, 1);
+    for (int i = 0; i < 40; i++) {
+        log.push(std::to_string(i).c_str(), White, 0, LogPriorities::Info, false);
+    }
+    CHECK_EQ(log.viewSize(), 0);
+    CHECK_EQ(log.scroll, 0);
+    log.destroy();
+}
+
+TEST(consoleLogVisibleLines) {
+    ConsoleLog log = ConsoleLog::init(16, 4096);
+    CHECK_EQ(log.visibleLines(100.0f, 2.0f, 10.0f), 0);
+    for (int i = 0; i < 10; i++) {
+        log.push(std::to_string(i).c_str(), White, 0, LogPriorities::Info, false);
+    }
+    // 12 a line with the spacing, not counting the spacing after the last one
+    CHECK_EQ(log.visibleLines(50.0f, 2.0f, 10.0f), 4);
+    log.line(8).height = 30.0f;
+    CHECK_EQ(log.visibleLines(50.0f, 2.0f, 10.0f), 2);
+    // a line taller than the view still shows
+    log.line(9).height = 500.0f;
+    CHECK_EQ(log.visibleLines(50.0f, 2.0f, 10.0f), 1);
+    log.scrollBy(8);
+    CHECK_EQ(log.visibleLines(1000.0f, 2.0f, 10.0f), 2);
+    log.destroy();
+}
+
+TEST(consoleLogCopyLines) {
+    ConsoleLog log = ConsoleLog::init(16, 4096);
+    log.push("first", White, 0, LogPriorities::Info, false);
+    log.push("second", White, 1, LogPriorities::Info, false);
+    log.push("second", White, 1, LogPriorities::Info, false);
+    log.push("third", White, 0, LogPriorities::Info, false);
+
+    CHECK(log.copyLines(0, 3) == std::string("first\n(1) second\nthird"));
+    CHECK(log.copyLines(1, 1) == std::string("(1) second"));
+    // ranges going past either end are cut down to the lines there are
+    CHECK(log.copyLines(-5, 2) == std::string("first\n(1) second"));
+    CHECK(log.copyLines(2, INT_MAX) == std::string("third"));
+    CHECK(log.copyLines(INT_MAX, INT_MAX) == std::string(""));
+    CHECK(log.copyLines(0, -1) == std::string(""));
+    CHECK(log.copyLines(3, 1) == std::string(""));
+
+    // only lines passing the filter are copied
+    ConsoleLog::Filter filter = ConsoleLog::Filter::All();
+    filter.categories = 1u << 0;
+    log.setFilter(filter);
+    CHECK(log.copyLines(0, INT_MAX) == std::string("first\nthird"));
+    log.destroy();
+}
@@ -0,0 +1,66 @@
+#include "test.hpp"
+#include "utils/Debug.hpp"
+#include <stdio.h>
+#include <vector>
+
+TEST(debugFlagNames) {
+    // every flag is found by its own name, and nothing else is
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        CHECK_EQ(DebugFlags::fromName(DebugFlags::Infos[i].name), i);
+    }
+    CHECK(DebugFlags::fromName("notAFlag") == DebugFlags::Null);
+    CHECK(DebugFlags::fromName("") == DebugFlags::Null);
+    CHECK(DebugFlags::fromName("drawChunkBorder") == DebugFlags::Null);
+}
+
+TEST(debugSettingsListeners) {
+    DebugSettings settings;
+    settings.init();
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        CHECK_EQ(settings[(DebugFlag)i], DebugFlags::Infos[i].defaultValue);
+    }
+
+    std::vector<std::pair<DebugFlag, bool>> changes;
+    settings.addListener([&](DebugFlag flag, bool value){
+        changes.push_back({flag, value});
+    });
+
+    CHECK(settings.set("drawChunkBorders", true));
+    CHECK(settings[DebugFlags::drawChunkBorders]);
+    // setting it to what it already is doesn't count as a change
+    settings.set(DebugFlags::drawChunkBorders, true);
+    settings.toggle(DebugFlags::drawEntityIDs);
+    CHECK(!settings.set("notAFlag", true));
+
+    CHECK_EQ(changes.size(), 2u);
+    CHECK(changes[0].first == DebugFlags::drawChunkBorders && changes[0].second);
+    CHECK(changes[1].first == DebugFlags::drawEntityIDs && changes[1].second);
+}
+
+TEST(debugSettingsSaveAndLoad) {
+    const char* path = "debugSettingsTest.txt";
+    DebugSettings saved;
+    saved.init();
+    saved.set(DebugFlags::drawEntityViewBoxes, true);
+    saved.set(DebugFlags::warnTickAllocations, true);
+    CHECK(saved.save(path));
+
+    // flags that aren't in the file keep what they have, and names that aren't flags anymore are skipped
+    FILE* file = fopen(path, "a");
+    CHECK(file != nullptr);
+    if (file) {
+        fprintf(file, "removedFlag = 1\n");
+        fclose(file);
+    }
+    DebugSettings loaded;
+    loaded.init();
+    loaded.set(DebugFlags::drawRenderStats, true);
+    CHECK(loaded.load(path));
+    for (int i = 0; i < DebugFlags::Count; i++) {
+        bool expected = saved[(DebugFlag)i] || i == DebugFlags::drawRenderStats;
+        CHECK_EQ(loaded[(DebugFlag)i], expected);
+    }
+    remove(path);
+
+    CHECK(!loaded.load("debugSettingsThatDontExist.txt"));
+}
@@ -0,0 +1,109 @@
+#include "test.hpp"
+#include "itemTesting.hpp"
+#include <vector>
+
+using namespace items;
+using ECS::ArchetypalComponentManager;
+
+// any components will do, so this uses the item ones
+static ArchetypalComponentManager makeComponents() {
+    using namespace items::ITC;
+    static constexpr auto componentInfo = ECS::getComponentInfoList<ITEM_COMPONENTS_LIST>();
+    return ArchetypalComponentManager(ArrayRef(componentInfo));
+}
+
+static Entity newDurable(ArchetypalComponentManager& components, int level) {
+    Entity entity = components.newEntity(0);
+    ITC::Durability durability = {level};
+    components.addComponent(entity, ITC::Durability::ID, &durability);
+    return entity;
+}
+
+static int durabilityOf(const ArchetypalComponentManager& components, Entity entity) {
+    auto* durability = (const ITC::Durability*)components.getComponent(entity, ITC::Durability::ID);
+    return durability ? durability->level : -1;
+}
+
+TEST(entityIdsGrowPastPreallocated) {
+    ArchetypalComponentManager components = makeComponents();
+    // only the first 1000 ids are there to start with
+    const int count = 2500;
+    std::vector<Entity> entities;
+    for (int i = 0; i < count; i++) {
+        entities.push_back(newDurable(components, i));
+    }
+    CHECK_EQ(components.highestEntityID, (ECS::EntityID)count);
+
+    // every id handed out once, and every entity still has its own component
+    std::vector<bool> seen(count + 1, false);
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        Entity entity = entities[i];
+        if (entity.Null() || entity.id == 0 || entity.id > (ECS::EntityID)count || seen[entity.id]) {
+            mismatches++;
+            continue;
+        }
+        seen[entity.id] = true;
+        if (durabilityOf(components, entity) != i) mismatches++;
+    }
+    CHECK_EQ(mismatches, 0);
+    components.destroy();
+}
+
+TEST(entityIdsRunOut) {
+    ArchetypalComponentManager components = makeComponents();
+    const int count = (int)ArchetypalComponentManager::MaxEntityID;
+    std::vector<Entity> entities;
+    int nullEntities = 0;
+    for (int i = 0; i < count; i++) {
+        Entity entity = components.newEntity(0);
+        if (entity.Null()) nullEntities++;
+        entities.push_back(entity);
+    }
+    CHECK_EQ(nullEntities, 0);
+    CHECK_EQ(components.highestEntityID, (ECS::EntityID)ArchetypalComponentManager::MaxEntityID);
+    CHECK(components.getEntityData(ArchetypalComponentManager::MaxEntityID) != nullptr);
+
+    // every id is in use, so there's nothing left to give out
+    CHECK(components.newEntity(0).Null());
+    CHECK(components.newEntity(0).Null());
+
+    // until one is freed up
+    Entity freed = entities[count / 2];
+    components.deleteEntity(freed);
+    Entity entity = components.newEntity(0);
+    CHECK_EQ(entity.id, freed.id);
+    CHECK_EQ(entity.version, freed.version + 1);
+    CHECK(components.newEntity(0).Null());
+    components.destroy();
+}
+
+TEST(entityIdsReusedAfterDestroy) {
+    ArchetypalComponentManager components = makeComponents();
+    std::vector<Entity> entities;
+    for (int i = 0; i < 1200; i++) {
+        entities.push_back(newDurable(components, i));
+    }
+
+    // ids that were freed get used again before new ones, including ones past the first 1000
+    Entity early = entities[10];
+    Entity late = entities[1100];
+    components.deleteEntity(early);
+    components.deleteEntity(late);
+    Entity first = newDurable(components, -2);
+    Entity second = newDurable(components, -3);
+    CHECK_EQ(components.highestEntityID, 1200u);
+    CHECK(first.id == late.id && second.id == early.id);
+    CHECK_EQ(first.version, late.version + 1);
+    CHECK_EQ(second.version, early.version + 1);
+
+    // the old handles don't get the new entities
+    CHECK(components.getComponent(late, ITC::Durability::ID) == nullptr);
+    CHECK(components.getComponent(early, ITC::Durability::ID) == nullptr);
+    CHECK_EQ(durabilityOf(components, first), -2);
+    CHECK_EQ(durabilityOf(components, second), -3);
+    // and the ones left alone are still there
+    CHECK_EQ(durabilityOf(components, entities[11]), 11);
+    CHECK_EQ(durabilityOf(components, entities[1199]), 1199);
+    components.destroy();
+}
@@ -0,0 +1,260 @@
+#include "test.hpp"
+#include "GUI/Gui.hpp"
+#include <string.h>
+#include <vector>
+
+using namespace GUI;
+using Quad = GuiLayout::Quad;
+
+static const Box Screen = {Vec2(0), Vec2(1920, 1080)};
+
+static GuiManager makeGui() {
+    using namespace GUI::EC;
+    constexpr static auto componentInfoArray = ECS::getComponentInfoList<GUI_COMPONENTS_LIST>();
+    GuiManager gui = GuiManager(ArrayRef(componentInfoArray), ElementTypes::Count);
+    makeGuiPrototypes(gui);
+    return gui;
+}
+
+static Element addColumn(GuiManager& gui, Vec2 min, Vec2 size) {
+    Element column = gui.newElement(ElementTypes::Normal, gui.screen);
+    gui.addComponent(column, EC::ViewBox{Box{min, size}});
+    gui.addComponent(column, EC::StackConstraint{.vertical = true});
+    gui.addComponent(column, EC::Background{{40, 40, 40, 255}});
+    return column;
+}
+
+static Element addRow(GuiManager& gui, Element column, float height) {
+    Element row = gui.newElement(ElementTypes::Normal, column);
+    gui.addComponent(row, EC::ViewBox{Box{Vec2(0), Vec2(100, height)}});
+    gui.addComponent(row, EC::Background{{80, 80, 80, 255}});
+    gui.addComponent(row, EC::Border{.color = {255, 255, 255, 255}, .strokeIn = Vec2(1.0f)});
+    gui.addComponent(row, EC::Hover{true, {200, 50, 50, 255}, nullptr});
+    return row;
+}
+
+static ArrayRef<Quad> elementQuads(const GuiLayout& layout, Element element, QuadLayer layer) {
+    if ((int)element.id >= layout.elements.size) return ArrayRef<Quad>();
+    const GuiLayout::QuadRange& range = layout.elements[element.id].ranges[layer];
+    if (range.level < 0) return ArrayRef<Quad>();
+    return layout.quads(range.level, layer).slice(range.start, range.count);
+}
+
+static bool isZero(const Quad& quad) {
+    static const Quad zero = {};
+    return memcmp(&quad, &zero, sizeof(Quad)) == 0;
+}
+
+static bool sameQuads(ArrayRef<Quad> lhs, ArrayRef<Quad> rhs) {
+    return lhs.size() == rhs.size() && (lhs.empty() || memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(Quad)) == 0);
+}
+
+/* The quads kept from frame to frame are the same as the quads from laying out and painting everything from scratch,
+ * element by element, and quads nobody owns are zeroed so they draw nothing
+ */
+static int mismatchesWithRebuild(GuiManager& gui, const GuiLayout& layout) {
+    GuiLayout rebuilt = GuiLayout::init();
+    rebuilt.update(gui, Screen, nullptr);
+
+    int mismatches = 0;
+    int elementCount = MAX(layout.elements.size, rebuilt.elements.size);
+    for (int id = 0; id < elementCount; id++) {
+        for (int layer = 0; layer < QuadLayers::Count; layer++) {
+            // only the id matters for finding the quads
+            Element element = Element(id, 0);
+            if (!sameQuads(elementQuads(layout, element, (QuadLayer)layer), elementQuads(rebuilt, element, (QuadLayer)layer))) {
+                mismatches++;
+            }
+        }
+    }
+    for (int level = 0; level < layout.levels.size; level++) {
+        for (int layer = 0; layer < QuadLayers::Count; layer++) {
+            const GuiLayout::LayerQuads& buffer = layout.levels[level].layers[layer];
+            for (int i = 0; i < buffer.quads.size; i++) {
+                if (buffer.owners[i] == NullElement.id && !isZero(buffer.quads[i])) mismatches++;
+            }
+        }
+    }
+    rebuilt.destroy();
+    return mismatches;
+}
+
+TEST(guiLayoutStackedColumn) {
+    GuiManager gui = makeGui();
+    Element column = addColumn(gui, Vec2(10, 20), Vec2(100, 300));
+    Element rows[3];
+    for (int i = 0; i < 3; i++) {
+        rows[i] = addRow(gui, column, 10);
+    }
+
+    GuiLayout layout = GuiLayout::init();
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(layout.elementsLaidOut, 4);
+
+    // the column is the first child of the screen, so it's on level 1, and its children go on the levels after it
+    ArrayRef<Quad> columnQuads = layout.quads(1, QuadLayers::Backgrounds);
+    CHECK_EQ(columnQuads.size(), 1u);
+    CHECK(columnQuads[0][0].pos == glm::vec3(10, 20, 0));
+    CHECK(columnQuads[0][2].pos == glm::vec3(110, 320, 0));
+    CHECK_EQ(layout.quads(1, QuadLayers::Borders).size(), 0u);
+
+    for (int i = 0; i < 3; i++) {
+        int level = 2 + i;
+        CHECK_EQ(gui.getComponent<const EC::ViewBox>(rows[i])->level, level);
+        ArrayRef<Quad> background = layout.quads(level, QuadLayers::Backgrounds);
+        CHECK_EQ(background.size(), 1u);
+        if (background.size() != 1) continue;
+        // stacked one under the other
+        CHECK(background[0][0].pos == glm::vec3(10, 20 + i * 10, 0));
+        CHECK(background[0][2].pos == glm::vec3(110, 30 + i * 10, 0));
+        CHECK_EQ(background[0][0].color.r, 80);
+        CHECK_EQ(layout.quads(level, QuadLayers::Borders).size(), 4u);
+        CHECK_EQ(layout.quads(level, QuadLayers::Textures).size(), 0u);
+    }
+    CHECK_EQ(layout.quads(5, QuadLayers::Backgrounds).size(), 0u);
+    CHECK_EQ(layout.quads(-1, QuadLayers::Backgrounds).size(), 0u);
+
+    // with nothing changed, nothing is done again
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(layout.elementsLaidOut, 0);
+    CHECK_EQ(layout.elementsRepainted, 0);
+    CHECK_EQ(mismatchesWithRebuild(gui, layout), 0);
+
+    layout.destroy();
+    gui.destroy();
+}
+
+TEST(guiLayoutHoverRepaintsTwo) {
+    GuiManager gui = makeGui();
+    Element column = addColumn(gui, Vec2(0), Vec2(100, 500));
+    std::vector<Element> rows;
+    for (int i = 0; i < 20; i++) {
+        rows.push_back(addRow(gui, column, 10));
+    }
+    GuiLayout layout = GuiLayout::init();
+    layout.update(gui, Screen, nullptr);
+
+    layout.setHovered(gui, rows[3]);
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(layout.elementsLaidOut, 0);
+    CHECK_EQ(layout.elementsRepainted, 1);
+    CHECK_EQ(elementQuads(layout, rows[3], QuadLayers::Backgrounds)[0][0].color.r, 200);
+
+    // the old one goes back to its own color
+    layout.setHovered(gui, rows[10]);
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(layout.elementsRepainted, 2);
+    CHECK_EQ(elementQuads(layout, rows[3], QuadLayers::Backgrounds)[0][0].color.r, 80);
+    CHECK_EQ(elementQuads(layout, rows[10], QuadLayers::Backgrounds)[0][0].color.r, 200);
+    CHECK_EQ(mismatchesWithRebuild(gui, layout), 0);
+
+    // hovering over the same one again is nothing new
+    layout.setHovered(gui, rows[10]);
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(layout.elementsRepainted, 0);
+
+    layout.destroy();
+    gui.destroy();
+}
+
+TEST(guiLayoutHideAndShow) {
+    GuiManager gui = makeGui();
+    Element column = addColumn(gui, Vec2(0), Vec2(100, 500));
+    Element rows[3];
+    for (int i = 0; i < 3; i++) {
+        rows[i] = addRow(gui, column, 10);
+    }
+    GuiLayout layout = GuiLayout::init();
+    layout.update(gui, Screen, nullptr);
+
+    // a hidden element has no quads, what it had is zeroed, and the rows after it move up into its place
+    gui.hideElement(rows[1]);
+    layout.update(gui, Screen, nullptr);
+    for (int layer = 0; layer < QuadLayers::Count; layer++) {
+        CHECK_EQ(elementQuads(layout, rows[1], (QuadLayer)layer).size(), 0u);
+    }
+    for (const Quad& quad : layout.quads(3, QuadLayers::Borders)) {
+        CHECK(isZero(quad));
+    }
+    CHECK_EQ(elementQuads(layout, rows[2], QuadLayers::Backgrounds)[0][0].pos.y, 10.0f);
+    CHECK_EQ(mismatchesWithRebuild(gui, layout), 0);
+
+    gui.unhideElement(rows[1]);
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(elementQuads(layout, rows[1], QuadLayers::Backgrounds).size(), 1u);
+    CHECK_EQ(elementQuads(layout, rows[2], QuadLayers::Backgrounds)[0][0].pos.y, 20.0f);
+    CHECK_EQ(mismatchesWithRebuild(gui, layout), 0);
+
+    layout.destroy();
+    gui.destroy();
+}
+
+TEST(guiLayoutMatchesRebuild) {
+    // random changes of every kind the layout looks for, checked against laying out everything from scratch after each update
+    GuiManager gui = makeGui();
+    std::vector<Element> columns;
+    std::vector<Element> rows;
+    for (int c = 0; c < 8; c++) {
+        columns.push_back(addColumn(gui, Vec2(c * 110.0f, 0), Vec2(100, 1000)));
+        for (int r = 0; r < 30; r++) {
+            rows.push_back(addRow(gui, columns.back(), 10));
+        }
+    }
+    GuiLayout layout = GuiLayout::init();
+    layout.update(gui, Screen, nullptr);
+    CHECK_EQ(mismatchesWithRebuild(gui, layout), 0);
+
+    Uint32 random = 17;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    int mismatches = 0;
+    int badCompaction = 0;
+    for (int step = 0; step < 300; step++) {
+        for (int change = 0; change < 4; change++) {
+            Element row = rows[nextRandom() % rows.size()];
+            switch (nextRandom() % 6) {
+            case 0:
+                // to another column, so onto other levels and leaving its old quads behind
+                gui.adopt(columns[nextRandom() % columns.size()], row);
+                break;
+            case 1:
+                gui.getComponent<EC::ViewBox>(row)->box.size.y = 5.0f + nextRandom() % 20;
+                break;
+            case 2:
+                gui.getComponent<EC::ViewBox>(columns[nextRandom() % columns.size()])->box.min.y = (float)(nextRandom() % 50);
+                break;
+            case 3:
+                gui.setComponent(row, EC::Background{{(Uint8)nextRandom(), 0, 0, 255}});
+                break;
+            case 4:
+                if (gui.entityHas<EC::Hidden>(row)) {
+                    gui.unhideElement(row);
+                } else {
+                    gui.hideElement(row);
+                }
+                break;
+            case 5:
+                layout.setHovered(gui, row);
+                break;
+            }
+        }
+        layout.update(gui, Screen, nullptr);
+        if (step % 10 == 0 || step == 299) {
+            mismatches += mismatchesWithRebuild(gui, layout);
+        }
+
+        // levels with a lot of unused quads get compacted
+        for (int level = 0; level < layout.levels.size; level++) {
+            for (const auto& buffer : layout.levels[level].layers) {
+                if (buffer.unused > 64 && buffer.unused * 2 > buffer.quads.size) badCompaction++;
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(badCompaction, 0);
+
+    layout.destroy();
+    gui.destroy();
+}
@@ -0,0 +1,224 @@
+#include "test.hpp"
+#include "itemTesting.hpp"
+#include "world/Inserters.hpp"
+#include <vector>
+
+using namespace World;
+using namespace items;
+
+// stands in for container entities in the ecs. Destroying one keeps its id, so a new one there gets the next version
+struct TestContainer {
+    IVec2 tile;
+    Entity entity;
+    Inventory inventory;
+    bool alive;
+};
+
+struct InserterWorld {
+    ItemManager manager;
+    TransportLines belts;
+    Inserters inserters;
+    std::vector<TestContainer> containers;
+    Item tile;
+    Item grenade;
+
+    static constexpr int SwingTicks = 5;
+
+    InserterWorld() {
+        manager = makeItemManager();
+        tile = Prototypes::Tile::make(manager, TileTypes::Sand);
+        grenade = Prototypes::Grenade::make(manager);
+        belts = TransportLines::init();
+        inserters = Inserters::init(&belts);
+        // room for every container up front, since the inserters hold pointers to the inventories while they use them
+        containers.reserve(16);
+        belts.onLineChanged = [this](TransportLineID line){
+            inserters.beltLineChanged(line);
+        };
+        belts.onLineRebuilt = [this](TransportLineID line){
+            inserters.beltLineRebuilt(line);
+        };
+        manager.onInventoryChanged = [this](const ItemStack* inventoryItems, bool added){
+            inserters.inventoryChanged(inventoryItems, added);
+        };
+        inserters.findContainer = [this](IVec2 tile, Entity* containerOut){
+            for (const TestContainer& container : containers) {
+                if (container.alive && container.tile == tile) {
+                    *containerOut = container.entity;
+                    return true;
+                }
+            }
+            return false;
+        };
+        inserters.containerInventory = [this](Entity entity) -> Inventory* {
+            for (TestContainer& container : containers) {
+                if (container.alive && container.entity == entity) return &container.inventory;
+            }
+            return nullptr;
+        };
+    }
+
+    ~InserterWorld() {
+        for (TestContainer& container : containers) {
+            if (container.inventory.items) container.inventory.destroy();
+        }
+        inserters.destroy();
+        belts.destroy();
+        manager.destroy();
+    }
+
+    Inventory& addContainer(IVec2 tile, ECS::EntityID id, int slots) {
+        ECS::EntityVersion version = 0;
+        for (const TestContainer& container : containers) {
+            if (container.entity.id == id) version = MAX(version, container.entity.version + 1);
+        }
+        containers.push_back({tile, Entity(id, version), Inventory(&manager, slots), true});
+        inserters.containersChanged();
+        return containers.back().inventory;
+    }
+
+    SimulatedInserter& inserter() {
+        return inserters.inserters[0];
+    }
+
+    void update(int ticks = 1) {
+        for (int i = 0; i < ticks; i++) {
+            belts.update();
+            inserters.update();
+        }
+    }
+};
+
+static int countOf(const Inventory& inventory, ItemType type) {
+    int count = 0;
+    for (int i = 0; i < inventory.size; i++) {
+        if (inventory.get(i).item.type == type) count += inventory.get(i).quantity;
+    }
+    return count;
+}
+
+TEST(inserterBeltToContainer) {
+    InserterWorld world;
+    world.belts.addBelt(ECS::NullEntity, {0, 0}, {1, 0}, 0.125f);
+    Inventory& chest = world.addContainer({0, 2}, 1, 4);
+    world.inserters.add(Entity(0, 0), {0, 1}, {0, 0}, {0, 2}, InserterWorld::SwingTicks, 1);
+
+    // nothing on the belt, so it waits on the belt line
+    world.update();
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK(world.inserter().source.kind == InserterEndpoint::Belt);
+    CHECK(world.inserter().state == InserterState::PickingUp);
+
+    // putting an item on the line wakes it, and it takes the item the same tick
+    CHECK(world.belts.insertItem({0, 0}, 0, 0.5f, world.tile));
+    CHECK_EQ(world.inserters.active.size, 1);
+    world.update();
+    CHECK(world.inserter().state == InserterState::SwingingToTarget);
+    CHECK_EQ(world.inserter().hand.quantity, 1);
+    CHECK_EQ(world.inserters.active.size, 0);
+
+    // asleep the whole swing, then drops into the chest
+    world.update(InserterWorld::SwingTicks - 1);
+    CHECK_EQ(countOf(chest, ItemTypes::Tile), 0);
+    world.update();
+    CHECK(world.inserter().state == InserterState::SwingingBack);
+    CHECK(world.inserter().target.kind == InserterEndpoint::Container);
+    CHECK(world.inserter().target.container == world.containers[0].entity);
+    CHECK(world.inserter().hand.empty());
+    CHECK_EQ(countOf(chest, ItemTypes::Tile), 1);
+
+    // back to picking up after swinging back, which it tries the next tick, then waits on the empty belt again
+    world.update(InserterWorld::SwingTicks);
+    CHECK(world.inserter().state == InserterState::PickingUp);
+    CHECK_EQ(world.inserters.active.size, 1);
+    world.update();
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK_EQ(world.inserter().waitKey, Inserters::BeltWaitKeyBit | (Uint32)world.belts.belts.lookup({0, 0})->line);
+}
+
+TEST(inserterSleepsUntilItsInventoryChanges) {
+    InserterWorld world;
+    Inventory& source = world.addContainer({0, 0}, 1, 1);
+    Inventory& target = world.addContainer({0, 2}, 2, 1);
+    Inventory& other = world.addContainer({5, 5}, 3, 1);
+    world.inserters.add(Entity(0, 0), {0, 1}, {0, 0}, {0, 2}, InserterWorld::SwingTicks, 1);
+
+    // an empty source is waited on for items being put in
+    world.update();
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK_EQ(world.inserter().waitKey, (Uint64)(uintptr_t)source.items);
+
+    // other inventories don't wake it, and neither does taking out of its source
+    other.addItemStack(ItemStack(world.tile, 1));
+    source.removeItemType(ItemTypes::Tile, 1);
+    world.update(3);
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK(world.inserter().hand.empty());
+
+    // the target is full of something else
+    CHECK_EQ(target.addItemStack(ItemStack(world.grenade, 1)), 1);
+    CHECK_EQ(source.addItemStack(ItemStack(world.tile, 1)), 1);
+    CHECK_EQ(world.inserters.active.size, 1);
+    world.update();
+    CHECK_EQ(world.inserter().hand.quantity, 1);
+    CHECK_EQ(countOf(source, ItemTypes::Tile), 0);
+
+    // with no room in the target, it waits for items to be taken out of it
+    world.update(InserterWorld::SwingTicks);
+    CHECK(world.inserter().state == InserterState::Dropping);
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK_EQ(world.inserter().waitKey, (Uint64)(uintptr_t)target.items | Inserters::RoomWaitKeyBit);
+    other.removeItemType(ItemTypes::Tile, 1);
+    source.addItemStack(ItemStack(world.tile, 1));
+    world.update(3);
+    CHECK_EQ(world.inserters.active.size, 0);
+    CHECK_EQ(countOf(target, ItemTypes::Tile), 0);
+
+    // making room wakes it, and it drops what it's holding
+    CHECK_EQ(target.removeItemType(ItemTypes::Grenade, 1), 1);
+    CHECK_EQ(world.inserters.active.size, 1);
+    world.update();
+    CHECK_EQ(countOf(target, ItemTypes::Tile), 1);
+    CHECK(world.inserter().hand.empty());
+}
+
+TEST(inserterContainerReplaced) {
+    InserterWorld world;
+    world.addContainer({0, 0}, 1, 1);
+    Inventory& target = world.addContainer({0, 2}, 2, 4);
+    world.inserters.add(Entity(0, 0), {0, 1}, {0, 0}, {0, 2}, InserterWorld::SwingTicks, 1);
+    world.update();
+    CHECK(world.inserter().source.container == world.containers[0].entity);
+    CHECK(world.inserters.containerUsers.lookup(1) != nullptr);
+
+    // removing the source wakes the inserter, which finds nothing there and waits for a container to be placed
+    world.containers[0].alive = false;
+    world.inserters.inventoryRemoved(world.containers[0].entity, world.containers[0].inventory);
+    CHECK_EQ(world.inserters.active.size, 1);
+    CHECK(world.inserter().source.kind == InserterEndpoint::None);
+    CHECK(world.inserters.containerUsers.lookup(1) == nullptr);
+    world.update();
+    CHECK_EQ(world.inserter().waitKey, Inserters::UnconnectedWaitKey);
+
+    // a new container in the same place, reusing the id, gets used from then on
+    Inventory& source = world.addContainer({0, 0}, 1, 1);
+    source.addItemStack(ItemStack(world.tile, 1));
+    world.update();
+    CHECK(world.inserter().source.container == world.containers[2].entity);
+    CHECK_EQ(world.inserter().source.container.version, 1);
+    CHECK_EQ(world.inserter().hand.quantity, 1);
+    world.update(InserterWorld::SwingTicks);
+    CHECK_EQ(countOf(target, ItemTypes::Tile), 1);
+
+    // replaced without being told, the version doesn't match anymore, so the endpoint gets found again when it's next used
+    world.containers[2].alive = false;
+    Inventory& replacement = world.addContainer({0, 0}, 1, 1);
+    replacement.addItemStack(ItemStack(world.tile, 1));
+    world.inserters.wakeAll();
+    world.update(InserterWorld::SwingTicks + 1);
+    CHECK(world.inserter().source.container == world.containers[3].entity);
+    CHECK_EQ(countOf(replacement, ItemTypes::Tile), 0);
+    CHECK_EQ(world.inserter().hand.quantity, 1);
+    const int* user = world.inserters.containerUsers.lookup(1);
+    CHECK(user != nullptr && *user == 0);
+}
@@ -0,0 +1,143 @@
+#include "test.hpp"
+#include "itemTesting.hpp"
+
+using namespace items;
+
+static bool sameSlots(const Inventory& lhs, const Inventory& rhs) {
+    for (int i = 0; i < lhs.size; i++) {
+        if (!isSame(lhs.get(i).item, rhs.get(i).item) || lhs.get(i).quantity != rhs.get(i).quantity) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(inventoryIndexMatchesScanning) {
+    ItemManager manager = makeItemManager();
+    // big enough to get an index, and the same inventory without one to check it against
+    Inventory indexed(&manager, 200);
+    Inventory scanned(&manager, 200);
+    scanned.disableIndex();
+    CHECK(indexed.index != nullptr);
+
+    Item tile = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item grenade = Prototypes::Grenade::make(manager);
+    Item sandGun = Prototypes::SandGun::make(manager);
+    const Item items[] = {tile, grenade, sandGun};
+    const ItemType types[] = {ItemTypes::Tile, ItemTypes::Grenade, ItemTypes::SandGun};
+
+    Uint32 random = 12345;
+    for (int op = 0; op < 20000; op++) {
+        random = random * 1664525 + 1013904223;
+        int which = (random >> 8) % 3;
+        ItemQuantity quantity = (random >> 12) % 100 + 1;
+        switch ((random >> 20) % 4) {
+        case 0:
+        case 1:
+            CHECK_EQ(indexed.addItemStack(ItemStack(items[which], quantity)), scanned.addItemStack(ItemStack(items[which], quantity)));
+            break;
+        case 2:
+            CHECK_EQ(indexed.removeItemType(types[which], quantity), scanned.removeItemType(types[which], quantity));
+            break;
+        case 3: {
+            ItemStack fromIndexed = indexed.takeFirstItemStack();
+            ItemStack fromScanned = scanned.takeFirstItemStack();
+            CHECK(isSame(fromIndexed.item, fromScanned.item));
+            CHECK_EQ(fromIndexed.quantity, fromScanned.quantity);
+            // the taken stacks' references are ours now
+            if (!fromIndexed.empty()) manager.release(fromIndexed.item);
+            if (!fromScanned.empty()) manager.release(fromScanned.item);
+            break;
+        }
+        }
+        for (ItemType type : types) {
+            CHECK_EQ(indexed.itemCount(type), scanned.itemCount(type));
+        }
+        if (!sameSlots(indexed, scanned)) {
+            CHECK(sameSlots(indexed, scanned));
+            break;
+        }
+    }
+
+    // a fresh index over the same slots agrees with the one kept up to date along the way
+    for (ItemType type : types) {
+        ItemQuantity count = indexed.itemCount(type);
+        indexed.disableIndex();
+        indexed.enableIndex();
+        CHECK_EQ(indexed.itemCount(type), count);
+    }
+
+    indexed.removeItemType(ItemTypes::Tile, ItemQuantityInfinity);
+    indexed.removeItemType(ItemTypes::Grenade, ItemQuantityInfinity);
+    indexed.removeItemType(ItemTypes::SandGun, ItemQuantityInfinity);
+    scanned.removeItemType(ItemTypes::Tile, ItemQuantityInfinity);
+    scanned.removeItemType(ItemTypes::Grenade, ItemQuantityInfinity);
+    scanned.removeItemType(ItemTypes::SandGun, ItemQuantityInfinity);
+    manager.release(tile);
+    manager.release(grenade);
+    manager.release(sandGun);
+    CHECK_EQ(liveItems(manager), 0);
+
+    indexed.destroy();
+    scanned.destroy();
+    manager.destroy();
+}
+
+TEST(inventorySetSlotUpdatesIndex) {
+    ItemManager manager = makeItemManager();
+    Inventory inventory(&manager, 100);
+    Item tile = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item grenade = Prototypes::Grenade::make(manager);
+
+    inventory.setSlot(70, ItemStack(tile, 5));
+    CHECK_EQ(inventory.itemCount(ItemTypes::Tile), 5);
+    CHECK_EQ(inventory.index->slotsOf(ItemTypes::Tile)[1], 1ULL << (70 - 64));
+
+    // changing what's in the slot moves it from one type to the other
+    inventory.setSlot(70, ItemStack(grenade, 3));
+    CHECK_EQ(inventory.itemCount(ItemTypes::Tile), 0);
+    CHECK_EQ(inventory.itemCount(ItemTypes::Grenade), 3);
+    CHECK_EQ(inventory.index->slotsOf(ItemTypes::Tile)[1], 0ULL);
+
+    // the first empty slot is still the first one, so that's where new stacks go
+    CHECK_EQ(inventory.addItemStack(ItemStack(tile, 1)), 1);
+    CHECK_EQ(inventory.get(0).quantity, 1);
+
+    // the read only accessors see the same thing
+    CHECK(inventory.type(70) == ItemTypes::Grenade);
+    CHECK_EQ(inventory.quantity(70), 3);
+    CHECK_EQ(inventory.entity(70).id, grenade.id);
+
+    inventory.setSlot(70, ItemStack::None());
+    inventory.removeItemType(ItemTypes::Tile, ItemQuantityInfinity);
+    manager.release(tile);
+    manager.release(grenade);
+    inventory.destroy();
+    manager.destroy();
+}
+
+TEST(inventoryInfiniteStacks) {
+    ItemManager manager = makeItemManager();
+    Inventory inventory(&manager, 100);
+    Item grenade = Prototypes::Grenade::make(manager);
+
+    CHECK_EQ(inventory.addItemStack(ItemStack(grenade, ItemQuantityInfinity)), ItemQuantityInfinity);
+    CHECK_EQ(inventory.itemCount(ItemTypes::Grenade), ItemQuantityInfinity);
+    // taking some out never runs it dry, and putting some in always fits
+    CHECK_EQ(inventory.removeItemType(ItemTypes::Grenade, 1000), 1000);
+    CHECK_EQ(inventory.itemCount(ItemTypes::Grenade), ItemQuantityInfinity);
+    CHECK_EQ(inventory.addItemStack(ItemStack(grenade, 1000)), 1000);
+    CHECK(inventory.get(1).empty());
+
+    // the same without the index
+    inventory.disableIndex();
+    CHECK_EQ(inventory.itemCount(ItemTypes::Grenade), ItemQuantityInfinity);
+    CHECK_EQ(inventory.removeItemType(ItemTypes::Grenade, 1000), 1000);
+
+    inventory.removeItemType(ItemTypes::Grenade, ItemQuantityInfinity);
+    CHECK_EQ(inventory.itemCount(ItemTypes::Grenade), 0);
+    manager.release(grenade);
+    CHECK_EQ(liveItems(manager), 0);
+    inventory.destroy();
+    manager.destroy();
+}
@@ -0,0 +1,135 @@
+#include "test.hpp"
+#include "itemTesting.hpp"
+
+using namespace items;
+
+TEST(itemsSameContentsShareHandle) {
+    ItemManager manager = makeItemManager();
+
+    Item sand = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item sandAgain = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item grass = Prototypes::Tile::make(manager, TileTypes::Grass);
+    CHECK(isSame(sand, sandAgain));
+    CHECK(!isSame(sand, grass));
+    CHECK_EQ(manager.refCount(sand), 2);
+    CHECK_EQ(liveItems(manager), 2);
+
+    manager.release(sand);
+    manager.release(sandAgain);
+    CHECK_EQ(manager.refCount(sand), 0);
+    CHECK(!manager.entityExists(sand));
+
+    // gone from the canonical items too, so making it again makes a new one that gets shared from then on
+    Item newSand = Prototypes::Tile::make(manager, TileTypes::Sand);
+    CHECK(manager.entityExists(newSand));
+    Item newSandAgain = Prototypes::Tile::make(manager, TileTypes::Sand);
+    CHECK(isSame(newSand, newSandAgain));
+
+    manager.release(newSand);
+    manager.release(newSandAgain);
+    manager.release(grass);
+    CHECK_EQ(liveItems(manager), 0);
+    manager.destroy();
+}
+
+TEST(itemsStackInInventory) {
+    ItemManager manager = makeItemManager();
+    Inventory inventory(&manager, 8);
+
+    Item sand = Prototypes::Tile::make(manager, TileTypes::Sand);
+    Item sandAgain = Prototypes::Tile::make(manager, TileTypes::Sand);
+    CHECK_EQ(inventory.addItemStack(ItemStack(sand, 10)), 10);
+    // made separately, but the same item, so they go in the same slot
+    CHECK_EQ(inventory.addItemStack(ItemStack(sandAgain, 20)), 20);
+    CHECK_EQ(inventory.get(0).quantity, 30);
+    CHECK(inventory.get(1).empty());
+
+    // one for the slot, on top of the two being held
+    CHECK_EQ(manager.refCount(sand), 3);
+    manager.release(sand);
+    manager.release(sandAgain);
+    CHECK_EQ(manager.refCount(sand), 1);
+
+    // past the stack size of 64 it goes in another slot, which takes another reference
+    Item moreSand = Prototypes::Tile::make(manager, TileTypes::Sand);
+    CHECK_EQ(inventory.addItemStack(ItemStack(moreSand, 50)), 50);
+    manager.release(moreSand);
+    CHECK_EQ(inventory.get(0).quantity, 64);
+    CHECK_EQ(inventory.get(1).quantity, 16);
+    CHECK_EQ(manager.refCount(sand), 2);
+
+    // emptying the slots lets go of the item
+    CHECK_EQ(inventory.removeItemType(ItemTypes::Tile, 80), 80);
+    CHECK(!manager.entityExists(sand));
+    CHECK_EQ(liveItems(manager), 0);
+
+    inventory.destroy();
+    manager.destroy();
+}
+
+TEST(itemsChangedItemSplitsOff) {
+    ItemManager manager = makeItemManager();
+
+    Item gun = Prototypes::SandGun::make(manager);
+    manager.retain(gun); // a second holder, so the gun is shared
+    CHECK_EQ(manager.refCount(gun), 2);
+
+    // one holder's gun wears down. The other holder's doesn't change
+    Item worn = manager.unshare(gun);
+    CHECK(!isSame(worn, gun));
+    manager.addComponent<ITC::Durability>(worn, {50});
+    worn = manager.intern(worn);
+    CHECK(!isSame(worn, gun));
+    CHECK(!manager.entityHas<ITC::Durability>(gun));
+    CHECK_EQ(manager.refCount(gun), 1);
+    CHECK_EQ(manager.refCount(worn), 1);
+
+    // wearing down the same way gets the same item
+    Item alsoWorn = manager.unshare(Prototypes::SandGun::make(manager));
+    manager.addComponent<ITC::Durability>(alsoWorn, {50});
+    alsoWorn = manager.intern(alsoWorn);
+    CHECK(isSame(alsoWorn, worn));
+    CHECK_EQ(manager.refCount(worn), 2);
+
+    // with nothing else holding it, unsharing changes it in place, then it merges back into the plain gun once fixed
+    manager.release(alsoWorn);
+    Item fixed = manager.unshare(worn);
+    CHECK(isSame(fixed, worn));
+    manager.removeComponent<ITC::Durability>(fixed);
+    fixed = manager.intern(fixed);
+    CHECK(isSame(fixed, gun));
+    CHECK_EQ(manager.refCount(gun), 2);
+
+    manager.release(fixed);
+    manager.release(gun);
+    CHECK_EQ(liveItems(manager), 0);
+    manager.destroy();
+}
+
+TEST(itemsMillionStackedItems) {
+    ItemManager manager = makeItemManager();
+    constexpr int Count = 1000000;
+
+    Inventory inventory(&manager, 1);
+    Item first = Prototypes::Grenade::make(manager);
+    inventory.addItemStack(ItemStack(first, 1));
+    int referencesSize = manager.references.size;
+    for (int i = 1; i < Count; i++) {
+        Item grenade = Prototypes::Grenade::make(manager);
+        if (!isSame(grenade, first)) {
+            CHECK(isSame(grenade, first));
+            break;
+        }
+        manager.release(grenade);
+    }
+    // a million makes, and still just the one item, with one reference from the slot and one from first
+    CHECK_EQ(liveItems(manager), 1);
+    CHECK_EQ(manager.refCount(first), 2);
+    CHECK_EQ(manager.references.size, referencesSize);
+
+    manager.release(first);
+    inventory.removeItemType(ItemTypes::Grenade, ItemQuantityInfinity);
+    CHECK_EQ(liveItems(manager), 0);
+    inventory.destroy();
+    manager.destroy();
+}
@@ -0,0 +1,67 @@
+#include "test.hpp"
+#include <stdio.h>
+#include <string>
+
+static const char* LogTestFilepath = "logTest.txt";
+
+// log through the writer thread into a file, then read back what was written
+template<typename Log>
+static std::string logToFile(Log log) {
+    bool initialized = gLogger.initialized;
+    bool logToConsole = gLogger.logToConsole;
+    bool rateLimit = gLogger.rateLimit;
+    gLogger.logToConsole = false;
+    gLogger.rateLimit = false;
+    gLogger.init(LogTestFilepath);
+    log();
+    gLogger.destroy();
+    gLogger.logToConsole = logToConsole;
+    gLogger.rateLimit = rateLimit;
+    gLogger.initialized = initialized;
+
+    std::string text;
+    FILE* file = fopen(LogTestFilepath, "rb");
+    if (file) {
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, read);
+        }
+        fclose(file);
+    }
+    remove(LogTestFilepath);
+    return text;
+}
+
+TEST(loggingLongStrings) {
+    // longer than a record holds, like a shader's info log
+    std::string longText;
+    for (int i = 0; longText.size() < 1000; i++) {
+        longText += std::to_string(i) + " ";
+    }
+    std::string written = logToFile([&]() {
+        LogInfo("%s", longText.c_str());
+        LogInfo("compile error: %s (%d, %d)", longText.c_str(), 12, 34);
+        LogInfo("short %s %d", "string", 5);
+    });
+    CHECK(written.find(longText + "\n") != std::string::npos);
+    CHECK(written.find("compile error: " + longText + " (12, 34)\n") != std::string::npos);
+    CHECK(written.find("short string 5\n") != std::string::npos);
+    CHECK(written.find("[truncated") == std::string::npos);
+}
+
+TEST(loggingTooLongIsMarked) {
+    // too long for even a whole line, so the end goes missing, but it says so
+    std::string tooLong(MAX_LOG_MESSAGE_LENGTH + 500, 'x');
+    std::string written = logToFile([&]() {
+        LogInfo("%s", tooLong.c_str());
+    });
+    size_t mark = written.find("...[truncated ");
+    CHECK(mark != std::string::npos);
+    CHECK(written.size() <= (size_t)MAX_LOG_MESSAGE_LENGTH);
+    if (mark != std::string::npos) {
+        // what's left plus what it says is missing adds up to the whole message
+        int cutBytes = atoi(written.c_str() + mark + 14);
+        CHECK_EQ((int)mark + cutBytes, (int)tooLong.size());
+    }
+}
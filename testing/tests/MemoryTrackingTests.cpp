@@ -0,0 +1,144 @@
+#include "test.hpp"
+#include "memory.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+using namespace Mem;
+
+#if MEMORY_TRACKING
+
+TEST(memoryTrackingCounts) {
+    CHECK(trackingAllocations());
+    MemoryStats before = memoryStats();
+    const MemoryTagStats& physicsBefore = before.tags[MemoryTags::Physics];
+
+    char* memory;
+    MemoryStats stats;
+    {
+        MEMORY_TAG(Physics);
+        memory = Alloc<char>(100);
+        stats = memoryStats();
+        const MemoryTagStats& physics = stats.tags[MemoryTags::Physics];
+        CHECK_EQ(physics.liveBytes, physicsBefore.liveBytes + 100);
+        CHECK_EQ(physics.liveAllocations, physicsBefore.liveAllocations + 1);
+        CHECK_EQ(stats.total.liveBytes, before.total.liveBytes + 100);
+        CHECK_EQ(allocationCount(), before.total.allocations + 1);
+
+        // reallocating counts as another allocation, and replaces the old size
+        memory = Realloc(memory, 300);
+        stats = memoryStats();
+        CHECK_EQ(stats.tags[MemoryTags::Physics].liveBytes, physicsBefore.liveBytes + 300);
+        CHECK_EQ(stats.tags[MemoryTags::Physics].liveAllocations, physicsBefore.liveAllocations + 1);
+        CHECK_EQ(stats.tags[MemoryTags::Physics].allocations, physicsBefore.allocations + 2);
+        CHECK(stats.tags[MemoryTags::Physics].peakBytes >= physicsBefore.liveBytes + 300);
+    }
+
+    // freeing takes it away from the tag it was made with, whatever tag is set now
+    {
+        MEMORY_TAG(Gui);
+        Free(memory);
+    }
+    void* aligned = AllocAligned(256, 64);
+    CHECK_EQ(memoryStats().total.liveBytes, before.total.liveBytes + 256);
+    FreeAligned(aligned);
+    stats = memoryStats();
+    CHECK_EQ(stats.tags[MemoryTags::Physics].liveBytes, physicsBefore.liveBytes);
+    CHECK_EQ(stats.tags[MemoryTags::Physics].liveAllocations, physicsBefore.liveAllocations);
+    CHECK_EQ(stats.total.liveBytes, before.total.liveBytes);
+    CHECK_EQ(stats.total.allocatedBytes, before.total.allocatedBytes + 100 + 300 + 256);
+
+    // memory from plain malloc isn't known about, so freeing it through the wrappers changes nothing
+    _free(malloc(50));
+    CHECK_EQ(memoryStats().total.liveBytes, before.total.liveBytes);
+}
+
+TEST(memoryTagsPerThread) {
+    CHECK(currentMemoryTag() == MemoryTags::General);
+    MemoryTag onOtherThread = MemoryTags::Count;
+    size_t renderingBefore = memoryStats().tags[MemoryTags::Rendering].liveBytes;
+    void* fromOtherThread = nullptr;
+    {
+        MEMORY_TAG(Rendering);
+        {
+            MEMORY_TAG(World);
+            CHECK(currentMemoryTag() == MemoryTags::World);
+        }
+        CHECK(currentMemoryTag() == MemoryTags::Rendering);
+        // a tag only applies to the thread that set it
+        std::thread thread([&](){
+            onOtherThread = currentMemoryTag();
+            fromOtherThread = Alloc(64);
+        });
+        thread.join();
+    }
+    CHECK(currentMemoryTag() == MemoryTags::General);
+    CHECK(onOtherThread == MemoryTags::General);
+    CHECK_EQ(memoryStats().tags[MemoryTags::Rendering].liveBytes, renderingBefore);
+    Free(fromOtherThread);
+}
+
+TEST(memoryTrackingFrames) {
+    newFrame();
+    void* allocations[3];
+    for (void*& allocation : allocations) {
+        allocation = Alloc(16);
+    }
+    newFrame();
+    CHECK_EQ(memoryStats().lastFrameAllocations, 3u);
+    newFrame();
+    CHECK_EQ(memoryStats().lastFrameAllocations, 0u);
+    for (void* allocation : allocations) {
+        Free(allocation);
+    }
+}
+
+static std::string readLeakReport() {
+    FILE* file = tmpfile();
+    if (!file) return "";
+    leakReport(file);
+    std::string report;
+    rewind(file);
+    char buffer[512];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        report.append(buffer, read);
+    }
+    fclose(file);
+    return report;
+}
+
+TEST(memoryLeakReport) {
+    // allocations with a file and line are grouped by them
+    const int line = __LINE__;
+    void* leaks[2];
+    for (void*& leak : leaks) {
+        leak = debug_malloc(12345, __FILE__, line);
+    }
+    std::string report = readLeakReport();
+    std::string site = std::string("24690 bytes in 2 allocations, tagged General, from ") + __FILE__ + ":" + std::to_string(line);
+    CHECK(report.find(site) != std::string::npos);
+
+    for (void* leak : leaks) {
+        debug_free(leak, __FILE__, __LINE__);
+    }
+    CHECK(readLeakReport().find(__FILE__) == std::string::npos);
+}
+
+#else
+
+TEST(memoryTrackingOff) {
+    // nothing is kept track of, so everything reads as zero
+    CHECK(!trackingAllocations());
+    void* memory = Alloc(100);
+    newFrame();
+    MemoryStats stats = memoryStats();
+    CHECK_EQ(stats.total.liveBytes, 0u);
+    CHECK_EQ(stats.total.allocations, 0u);
+    CHECK_EQ(stats.lastFrameAllocations, 0u);
+    CHECK_EQ(allocationCount(), 0u);
+    Free(memory);
+}
+
+#endif
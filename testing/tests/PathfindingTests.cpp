@@ -0,0 +1,223 @@
+#include "test.hpp"
+#include "world/Pathfinding.hpp"
+
+using namespace World;
+
+static const IVec2 Sides[4] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+static void setTile(ChunkMap& chunkmap, IVec2 position, TileType type) {
+    if (Tile* tile = getTileAtPosition(chunkmap, position)) {
+        tile->type = type;
+    }
+}
+
+static bool walkableTile(const ChunkMap& chunkmap, IVec2 position) {
+    const Tile* tile = getTileAtPosition(chunkmap, position);
+    return tile && (TileTypeData[tile->type].flags & TileTypes::Walkable);
+}
+
+// chunks x chunks of walls
+struct TestWorld {
+    ChunkMap chunkmap;
+    int size; // in tiles
+
+    static TestWorld make(int chunks) {
+        TestWorld world;
+        // only walkability matters here. Loading the rest of the tile data needs textures
+        TileTypeData[TileTypes::Wall].flags = 0;
+        TileTypeData[TileTypes::GreyFloor].flags = TileTypes::Walkable;
+        world.chunkmap.init();
+        world.size = chunks * CHUNKSIZE;
+        for (int y = 0; y < chunks; y++) {
+            for (int x = 0; x < chunks; x++) {
+                ChunkData* chunkdata = world.chunkmap.newChunkAt({x, y});
+                for (int i = 0; i < CHUNKSIZE * CHUNKSIZE; i++) {
+                    CHUNK_TILE_INDEX(chunkdata->chunk, i) = Tile(TileTypes::Wall);
+                }
+            }
+        }
+        return world;
+    }
+
+    void destroy() {
+        chunkmap.destroy();
+    }
+};
+
+// carve a maze of corridors 3 wide with a random depth first search, with a few extra walls knocked down so there are loops
+static void carveMaze(TestWorld& world, Uint32 seed) {
+    constexpr int CellSize = 4;
+    const int cells = world.size / CellSize;
+    Uint32 random = seed;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    auto carve = [&](IVec2 cell, IVec2 direction){
+        for (int y = 0; y < CellSize - 1; y++) {
+            for (int x = 0; x < CellSize - 1; x++) {
+                setTile(world.chunkmap, cell * CellSize + IVec2(x, y) + direction * 2, TileTypes::GreyFloor);
+            }
+        }
+    };
+    auto visited = My::Vec<bool>::WithCapacity(cells * cells);
+    visited.resize(cells * cells, false);
+    auto stack = My::Vec<IVec2>::Empty();
+    stack.push(IVec2(0, 0));
+    visited[0] = true;
+    carve({0, 0}, {0, 0});
+    while (!stack.empty()) {
+        IVec2 cell = stack.back();
+        IVec2 options[4];
+        int optionCount = 0;
+        for (IVec2 direction : Sides) {
+            IVec2 next = cell + direction;
+            if (next.x >= 0 && next.y >= 0 && next.x < cells && next.y < cells && !visited[next.y * cells + next.x]) {
+                options[optionCount++] = direction;
+            }
+        }
+        if (optionCount == 0) {
+            stack.popBack();
+            continue;
+        }
+        IVec2 direction = options[nextRandom() % optionCount];
+        IVec2 next = cell + direction;
+        visited[next.y * cells + next.x] = true;
+        carve(next, {0, 0});
+        // halfway between the two cells opens up the wall between them
+        carve(cell, direction);
+        stack.push(next);
+    }
+    for (int i = 0; i < cells * cells / 10; i++) {
+        IVec2 cell = {(int)(nextRandom() % (cells - 1)), (int)(nextRandom() % (cells - 1))};
+        carve(cell, nextRandom() % 2 ? IVec2(1, 0) : IVec2(0, 1));
+    }
+    visited.destroy();
+    stack.destroy();
+}
+
+// plain breadth first search over the tiles, for what the pathfinding should agree with
+static My::Vec<int> tileDistances(const TestWorld& world, IVec2 target) {
+    auto distances = My::Vec<int>::WithCapacity(world.size * world.size);
+    distances.resize(world.size * world.size, -1);
+    auto queue = My::Vec<IVec2>::WithCapacity(world.size * world.size);
+    distances[target.y * world.size + target.x] = 0;
+    queue.push(target);
+    for (int i = 0; i < queue.size; i++) {
+        IVec2 tile = queue[i];
+        for (IVec2 side : Sides) {
+            IVec2 next = tile + side;
+            if (next.x < 0 || next.y < 0 || next.x >= world.size || next.y >= world.size) continue;
+            int& distance = distances[next.y * world.size + next.x];
+            if (distance != -1 || !walkableTile(world.chunkmap, next)) continue;
+            distance = distances[tile.y * world.size + tile.x] + 1;
+            queue.push(next);
+        }
+    }
+    queue.destroy();
+    return distances;
+}
+
+TEST(pathfindingMaze) {
+    TestWorld world = TestWorld::make(2);
+    carveMaze(world, 7);
+    Pathfinding pathfinding = Pathfinding::init(&world.chunkmap);
+    const Entity target = Entity(0, 0);
+    const IVec2 targetTile = {61, 65};
+    CHECK(walkableTile(world.chunkmap, targetTile));
+    My::Vec<int> expected = tileDistances(world, targetTile);
+
+    int checked = 0;
+    int wrongReachability = 0;
+    int tooShort = 0;
+    int lost = 0;
+    Sint64 foundTotal = 0, expectedTotal = 0;
+    for (int y = 0; y < world.size; y += 3) {
+        for (int x = 0; x < world.size; x += 5) {
+            IVec2 from = {x, y};
+            if (!walkableTile(world.chunkmap, from)) continue;
+            checked++;
+            int shortest = expected[y * world.size + x];
+            Uint32 distance = pathfinding.distance(target, targetTile, from);
+            if ((distance == Pathfinding::Unreachable) != (shortest == -1)) {
+                wrongReachability++;
+                continue;
+            }
+            if (shortest == -1) continue;
+            // distances count straight steps, so nothing can be closer than the shortest path
+            if ((int)distance < shortest) tooShort++;
+            foundTotal += distance;
+            expectedTotal += shortest;
+
+            // following the field gets to the target without going through walls, getting closer every step
+            IVec2 tile = from;
+            Uint32 cost = distance;
+            int steps = 0;
+            while (tile != targetTile && steps <= (int)distance) {
+                IVec2 next;
+                if (!pathfinding.nextTile(target, targetTile, tile, &next) || !walkableTile(world.chunkmap, next)) break;
+                Uint32 nextCost = pathfinding.distance(target, targetTile, next);
+                if (nextCost >= cost) break;
+                cost = nextCost;
+                tile = next;
+                steps++;
+            }
+            if (tile != targetTile) lost++;
+        }
+    }
+    CHECK(checked > 500);
+    CHECK_EQ(wrongReachability, 0);
+    CHECK_EQ(tooShort, 0);
+    CHECK_EQ(lost, 0);
+    // going through portals can take a longer way around than the shortest path, but not by much
+    CHECK(foundTotal * 100 <= expectedTotal * 105);
+
+    expected.destroy();
+    pathfinding.destroy();
+    world.destroy();
+}
+
+TEST(pathfindingTileChanged) {
+    TestWorld world = TestWorld::make(2);
+    // an open floor with a walled in room straddling the chunk border, with the target inside it
+    for (int y = 1; y < world.size - 1; y++) {
+        for (int x = 1; x < world.size - 1; x++) {
+            setTile(world.chunkmap, {x, y}, TileTypes::GreyFloor);
+        }
+    }
+    const IVec2 roomMin = {50, 50}, roomMax = {80, 80};
+    for (int i = roomMin.x; i <= roomMax.x; i++) {
+        setTile(world.chunkmap, {i, roomMin.y}, TileTypes::Wall);
+        setTile(world.chunkmap, {i, roomMax.y}, TileTypes::Wall);
+        setTile(world.chunkmap, {roomMin.x, i}, TileTypes::Wall);
+        setTile(world.chunkmap, {roomMax.x, i}, TileTypes::Wall);
+    }
+
+    Pathfinding pathfinding = Pathfinding::init(&world.chunkmap);
+    const Entity target = Entity(0, 0);
+    const IVec2 targetTile = {60, 70};
+    const IVec2 outside = {10, 100};
+    CHECK_EQ(pathfinding.distance(target, targetTile, outside), Pathfinding::Unreachable);
+    CHECK_EQ(pathfinding.distance(target, targetTile, {70, 60}), 20u);
+
+    // a door in the room's wall lets the outside in
+    const IVec2 door = {roomMax.x, 70};
+    setTile(world.chunkmap, door, TileTypes::GreyFloor);
+    pathfinding.tileChanged(door);
+    My::Vec<int> expected = tileDistances(world, targetTile);
+    Uint32 throughDoor = pathfinding.distance(target, targetTile, outside);
+    CHECK(throughDoor != Pathfinding::Unreachable);
+    CHECK((int)throughDoor >= expected[outside.y * world.size + outside.x]);
+    IVec2 next;
+    CHECK(pathfinding.nextTile(target, targetTile, door, &next));
+    CHECK(next.x < door.x);
+
+    // and closing it shuts it out again
+    setTile(world.chunkmap, door, TileTypes::Wall);
+    pathfinding.tileChanged(door);
+    CHECK_EQ(pathfinding.distance(target, targetTile, outside), Pathfinding::Unreachable);
+
+    expected.destroy();
+    pathfinding.destroy();
+    world.destroy();
+}
@@ -0,0 +1,193 @@
+#include "test.hpp"
+#include "physics/physics.hpp"
+#include <math.h>
+
+using namespace Physics;
+
+static bool near(float a, float b, float tolerance = 0.001f) {
+    return fabsf(a - b) <= tolerance;
+}
+
+// a walled arena with a pillar every few tiles and a crowd of boxes and circles moving around in it
+static Space makeArena(int bodyCount, int arenaSize) {
+    Space space = Space::init();
+    space.solidTile = [arenaSize](IVec2 tile){
+        return tile.x < 0 || tile.y < 0 || tile.x >= arenaSize || tile.y >= arenaSize;
+    };
+    for (int y = 4; y < arenaSize; y += 8) {
+        for (int x = 4; x < arenaSize; x += 8) {
+            space.addBody(Shape::Box, Vec2(x + 0.5f, y + 0.5f), Vec2(0.5f), true);
+        }
+    }
+    Uint32 random = 7;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return (random >> 8) / (float)(1 << 24);
+    };
+    for (int i = 0; i < bodyCount; i++) {
+        Shape shape = i % 2 ? Shape::Circle : Shape::Box;
+        Vec2 position = Vec2(1.0f + nextRandom() * (arenaSize - 2), 1.0f + nextRandom() * (arenaSize - 2));
+        Vec2 halfSize = Vec2(0.2f + nextRandom() * 0.2f, 0.2f + nextRandom() * 0.2f);
+        BodyID id = space.addBody(shape, position, halfSize, false);
+        space.bodies[id].velocity = Vec2(nextRandom() * 2.0f - 1.0f, nextRandom() * 2.0f - 1.0f) * 0.1f;
+        space.bodies[id].restitution = 0.9f;
+    }
+    return space;
+}
+
+TEST(physicsHeadOnBounce) {
+    Space space = Space::init();
+    BodyID a = space.addBody(Shape::Box, Vec2(0.0f, 0.0f), Vec2(0.5f), false);
+    BodyID b = space.addBody(Shape::Box, Vec2(1.05f, 0.0f), Vec2(0.5f), false);
+    space.bodies[a].velocity = Vec2(0.1f, 0.0f);
+    space.bodies[b].velocity = Vec2(-0.1f, 0.0f);
+    space.bodies[a].restitution = 1.0f;
+    space.bodies[b].restitution = 1.0f;
+
+    space.step();
+    CHECK_EQ(space.stats.contacts, 1);
+    // the same mass and perfectly bouncy, so they trade velocities
+    CHECK(near(space.bodies[a].velocity.x, -0.1f));
+    CHECK(near(space.bodies[b].velocity.x, 0.1f));
+    // and don't stay inside each other, apart from the slop and the little the position iterations leave over
+    CHECK(space.bodies[b].position.x - space.bodies[a].position.x >= 1.0f - 2.0f * Space::CorrectionSlop);
+
+    // a heavy circle hit by a light one keeps going the same way, with the momentum of both kept
+    Space other = Space::init();
+    BodyID heavy = other.addBody(Shape::Circle, Vec2(0.0f, 0.0f), Vec2(1.0f), false);
+    BodyID light = other.addBody(Shape::Circle, Vec2(1.3f, 0.0f), Vec2(0.25f), false);
+    other.bodies[heavy].velocity = Vec2(0.05f, 0.0f);
+    other.bodies[light].velocity = Vec2(-0.1f, 0.0f);
+    auto momentum = [&](){
+        return other.bodies[heavy].velocity.x / other.bodies[heavy].inverseMass + other.bodies[light].velocity.x / other.bodies[light].inverseMass;
+    };
+    float before = momentum();
+    other.step();
+    CHECK_EQ(other.stats.contacts, 1);
+    CHECK(near(momentum(), before));
+    CHECK(other.bodies[heavy].velocity.x > 0.0f);
+
+    space.destroy();
+    other.destroy();
+}
+
+TEST(physicsFindsEveryOverlap) {
+    // boxes only, standing still, so every overlap of their bounds is a contact
+    Space space = Space::init();
+    Uint32 random = 3;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return (random >> 8) / (float)(1 << 24);
+    };
+    for (int i = 0; i < 2000; i++) {
+        Vec2 position = Vec2(nextRandom() * 60.0f - 30.0f, nextRandom() * 60.0f - 30.0f);
+        // some bigger than a cell, so they cover several
+        Vec2 halfSize = i % 50 == 0 ? Vec2(2.5f, 1.5f) : Vec2(0.1f + nextRandom() * 0.4f, 0.1f + nextRandom() * 0.4f);
+        space.addBody(Shape::Box, position, halfSize, false);
+    }
+
+    int expected = 0;
+    for (int i = 0; i < space.bodies.size; i++) {
+        for (int j = i + 1; j < space.bodies.size; j++) {
+            const Body& a = space.bodies[i];
+            const Body& b = space.bodies[j];
+            if (fabsf(b.position.x - a.position.x) < a.halfSize.x + b.halfSize.x
+             && fabsf(b.position.y - a.position.y) < a.halfSize.y + b.halfSize.y) {
+                expected++;
+            }
+        }
+    }
+    space.step();
+    // each pair once, however many cells they share
+    CHECK(expected > 100);
+    CHECK_EQ(space.stats.contacts, expected);
+
+    space.destroy();
+}
+
+TEST(physicsStaysInArena) {
+    constexpr int ArenaSize = 48;
+    Space space = makeArena(500, ArenaSize);
+    for (int t = 0; t < 600; t++) {
+        space.step();
+    }
+
+    int escaped = 0;
+    int inPillars = 0;
+    for (const Body& body : space.bodies) {
+        if (body.isStatic) continue;
+        if (body.position.x < 0.0f || body.position.y < 0.0f || body.position.x > ArenaSize || body.position.y > ArenaSize) {
+            escaped++;
+        }
+        for (const Body& pillar : space.bodies) {
+            if (!pillar.isStatic) continue;
+            // nothing's center should end up inside a pillar
+            if (fabsf(body.position.x - pillar.position.x) < pillar.halfSize.x
+             && fabsf(body.position.y - pillar.position.y) < pillar.halfSize.y) {
+                inPillars++;
+            }
+        }
+    }
+    CHECK_EQ(escaped, 0);
+    CHECK_EQ(inPillars, 0);
+    // pillars don't get pushed around
+    CHECK(near(space.bodies[0].position.x, 4.5f, 0.0f));
+    CHECK(near(space.bodies[0].position.y, 4.5f, 0.0f));
+
+    space.destroy();
+}
+
+TEST(physicsDeterministic) {
+    // the same bodies moved the same way end up in exactly the same place
+    Space first = makeArena(300, 32);
+    Space second = makeArena(300, 32);
+    for (int t = 0; t < 300; t++) {
+        first.step();
+        second.step();
+    }
+    int different = 0;
+    for (int i = 0; i < first.bodies.size; i++) {
+        if (memcmp(&first.bodies[i].position, &second.bodies[i].position, sizeof(Vec2)) != 0
+         || memcmp(&first.bodies[i].velocity, &second.bodies[i].velocity, sizeof(Vec2)) != 0) {
+            different++;
+        }
+    }
+    CHECK_EQ(different, 0);
+    first.destroy();
+    second.destroy();
+}
+
+TEST(physicsStaticBodies) {
+    Space space = Space::init();
+    const Entity tree = Entity(5, 1);
+    BodyID pillar = space.addBody(Shape::Box, Vec2(0.0f, 0.0f), Vec2(1.0f), true, tree);
+    CHECK(space.bodyOf(tree) == &space.bodies[pillar]);
+
+    // a body dropped partly inside gets pushed out, and the static one stays put
+    BodyID box = space.addBody(Shape::Box, Vec2(1.3f, 0.0f), Vec2(0.5f), false);
+    for (int t = 0; t < 20; t++) {
+        space.step();
+    }
+    CHECK(space.bodies[box].position.x >= 1.5f - Space::CorrectionSlop);
+    CHECK(near(space.bodies[pillar].position.x, 0.0f, 0.0f));
+
+    // moved away, it stops touching anything
+    space.moveStatic(pillar, Vec2(20.0f, 20.0f));
+    space.bodies[box].position = Vec2(0.0f, 0.0f);
+    space.step();
+    CHECK_EQ(space.stats.contacts, 0);
+    space.bodies[box].position = Vec2(20.5f, 20.0f);
+    space.step();
+    CHECK_EQ(space.stats.contacts, 1);
+
+    // removed bodies are gone from the grid and the entity lookup, and their ids get used again
+    space.removeBody(pillar);
+    CHECK(space.bodyOf(tree) == nullptr);
+    CHECK_EQ(space.stats.staticBodies, 0);
+    space.bodies[box].position = Vec2(20.0f, 20.0f);
+    space.step();
+    CHECK_EQ(space.stats.contacts, 0);
+    CHECK_EQ(space.addBody(Shape::Circle, Vec2(50.0f, 50.0f), Vec2(0.5f), true), pillar);
+
+    space.destroy();
+}
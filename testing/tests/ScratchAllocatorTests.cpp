@@ -0,0 +1,121 @@
+#include "test.hpp"
+#include "My/ScratchAllocator.hpp"
+#include <string.h>
+#include <thread>
+
+using namespace My;
+
+TEST(scratchArenaAllocates) {
+    ScratchArena arena = ScratchArena::init(ScratchLifetimes::Frame);
+    arena.reset(1);
+    char* a = (char*)arena.allocate(3);
+    char* b = (char*)arena.allocate(100);
+    char* c = (char*)arena.allocate(0);
+    CHECK_EQ((uintptr_t)a % ScratchArena::Alignment, 0u);
+    CHECK_EQ((uintptr_t)b % ScratchArena::Alignment, 0u);
+    CHECK_EQ((uintptr_t)c % ScratchArena::Alignment, 0u);
+    CHECK(b >= a + 3);
+    CHECK(c >= b + 100);
+    memset(a, 1, 3);
+    memset(b, 2, 100);
+    CHECK(a[2] == 1 && b[0] == 2 && b[99] == 2);
+    CHECK_EQ(arena.blockAllocations, 1u);
+
+    // bigger than a block gets a block of its own
+    char* big = (char*)arena.allocate(ScratchArena::StartBlockSize * 3);
+    big[ScratchArena::StartBlockSize * 3 - 1] = 5;
+    CHECK_EQ(arena.blockAllocations, 2u);
+    CHECK(a[2] == 1 && b[99] == 2);
+    arena.destroy();
+}
+
+TEST(scratchArenaReallocates) {
+    ScratchArena arena = ScratchArena::init(ScratchLifetimes::Frame);
+    arena.reset(1);
+    char* first = (char*)arena.allocate(10);
+    memcpy(first, "scratching", 10);
+    char* last = (char*)arena.allocate(20);
+    memcpy(last, "last allocation made", 20);
+
+    // the last one grows and shrinks where it is
+    CHECK(arena.reallocate(last, 1000) == last);
+    CHECK(arena.reallocate(last, 30) == last);
+    CHECK(memcmp(last, "last allocation made", 20) == 0);
+
+    // any other one gets copied to somewhere new
+    char* moved = (char*)arena.reallocate(first, 500);
+    CHECK(moved != first);
+    CHECK(memcmp(moved, "scratching", 10) == 0);
+    CHECK(arena.reallocate(nullptr, 8) != nullptr);
+    arena.destroy();
+}
+
+TEST(scratchArenaResets) {
+    ScratchArena arena = ScratchArena::init(ScratchLifetimes::Tick);
+    arena.reset(1);
+    void* before = arena.allocate(64);
+    CHECK(!arena.expired(before));
+
+    arena.reset(2);
+    CHECK(arena.expired(before));
+    // one block is just started over
+    CHECK(arena.allocate(64) == before);
+    CHECK_EQ(arena.blockAllocations, 1u);
+
+    // a frame that needed a few blocks leaves one block big enough for all of it,
+    // so the same frame again doesn't allocate at all
+    for (int frame = 3; frame < 6; frame++) {
+        arena.reset(frame);
+        for (int i = 0; i < 100; i++) {
+            arena.allocate(4000);
+        }
+    }
+    CHECK(arena.block->next == nullptr);
+    Uint32 allocations = arena.blockAllocations;
+    for (int frame = 6; frame < 10; frame++) {
+        arena.reset(frame);
+        for (int i = 0; i < 100; i++) {
+            arena.allocate(4000);
+        }
+    }
+    CHECK_EQ(arena.blockAllocations, allocations);
+    arena.destroy();
+}
+
+TEST(scratchFramesAndTicks) {
+    FrameVec<int> numbers = FrameVec<int>::Empty();
+    for (int i = 0; i < 1000; i++) {
+        numbers.push(i);
+    }
+    CHECK_EQ(numbers[999], 999);
+    int* tickNumbers = TickAlloc<int>(10);
+    tickNumbers[9] = 9;
+
+    // a new frame throws away frame memory, but not tick memory
+    Uint32 frame = scratchEpoch(ScratchLifetimes::Frame);
+    newScratchFrame();
+    CHECK_EQ(scratchEpoch(ScratchLifetimes::Frame), frame + 1);
+    CHECK(scratchArena(ScratchLifetimes::Frame).expired(numbers.data));
+    CHECK(!scratchArena(ScratchLifetimes::Tick).expired(tickNumbers));
+    CHECK_EQ(tickNumbers[9], 9);
+
+    newScratchTick();
+    CHECK(scratchArena(ScratchLifetimes::Tick).expired(tickNumbers));
+}
+
+TEST(scratchArenasPerThread) {
+    int* mine = FrameAlloc<int>(4);
+    mine[0] = 1;
+    ScratchArena* other = nullptr;
+    bool otherExpired = true;
+    std::thread thread([&](){
+        other = &scratchArena(ScratchLifetimes::Frame);
+        int* theirs = FrameAlloc<int>(4);
+        theirs[0] = 2;
+        otherExpired = other->expired(theirs);
+    });
+    thread.join();
+    CHECK(other != &scratchArena(ScratchLifetimes::Frame));
+    CHECK(!otherExpired);
+    CHECK_EQ(mine[0], 1);
+}
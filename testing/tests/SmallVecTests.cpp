@@ -0,0 +1,248 @@
+#include "test.hpp"
+#include "My/SmallVec.hpp"
+#include <string.h>
+#include <memory>
+#include <string>
+
+using namespace My;
+
+namespace {
+
+int allocations = 0;
+int frees = 0;
+
+struct CountingAllocator : IAllocator<CountingAllocator> {
+    using size_type = size_t;
+
+    void* allocate(size_t size) const {
+        allocations++;
+        return Mem::Alloc(size);
+    }
+    void deallocate(void* ptr) const {
+        if (ptr) frees++;
+        Mem::Free(ptr);
+    }
+    void* reallocate(void* ptr, size_t size) const {
+        allocations++;
+        if (ptr) frees++;
+        return Mem::Realloc(ptr, size);
+    }
+};
+
+// counts the ones alive, to catch elements that are never destroyed or destroyed twice
+struct Tracked {
+    static int alive;
+    int value;
+
+    Tracked(int value = -1) : value(value) { alive++; }
+    Tracked(const Tracked& other) : value(other.value) { alive++; }
+    Tracked(Tracked&& other) : value(other.value) { other.value = -2; alive++; }
+    Tracked& operator=(const Tracked& other) = default;
+    Tracked& operator=(Tracked&& other) {
+        value = other.value;
+        other.value = -2;
+        return *this;
+    }
+    ~Tracked() { alive--; }
+};
+
+int Tracked::alive = 0;
+
+struct Position {
+    float x, y;
+};
+
+// the same pushes, pops, removes and resizes for any element type, checked against the numbers they were made from
+template<class VecT, class MakeT, class ValueT>
+bool matchesAfterChanges(MakeT make, ValueT value) {
+    VecT vec = VecT::Empty();
+    std::vector<int> expected;
+    for (int i = 0; i < 40; i++) {
+        vec.push(make(i));
+        expected.push_back(i);
+    }
+    vec.remove(0);
+    expected.erase(expected.begin());
+    vec.remove(17);
+    expected.erase(expected.begin() + 17);
+    vec.pop();
+    expected.pop_back();
+    int back = value(vec.popBack());
+    if (back != expected.back()) return false;
+    expected.pop_back();
+    vec.resize(10);
+    expected.resize(10);
+    bool ok = vec.size == (int)expected.size();
+    for (int i = 0; ok && i < vec.size; i++) {
+        ok = value(vec[i]) == expected[i] && value(*vec.get(i)) == expected[i];
+    }
+    ok = ok && vec.get(10) == nullptr && vec.get(-1) == nullptr;
+    vec.destroy();
+    return ok && vec.size == 0 && vec.isInline();
+}
+
+}
+
+TEST(smallVecInlineThenHeap) {
+    allocations = frees = 0;
+    using Vec4 = SmallVec<int, 4, CountingAllocator>;
+    Vec4 vec = Vec4::Empty();
+    for (int i = 0; i < 4; i++) {
+        vec.push(i);
+    }
+    CHECK(vec.isInline());
+    CHECK_EQ(allocations, 0);
+    CHECK((char*)vec.data() >= (char*)&vec && (char*)vec.data() < (char*)(&vec + 1));
+
+    vec.push(4);
+    CHECK(!vec.isInline());
+    CHECK_EQ(allocations, 1);
+    CHECK_EQ(vec.capacity, 8);
+    for (int i = 0; i < 5; i++) {
+        CHECK_EQ(vec[i], i);
+    }
+    vec.destroy();
+    CHECK_EQ(frees, 1);
+    CHECK(vec.isInline());
+    CHECK_EQ(vec.capacity, 4);
+}
+
+TEST(smallVecClearKeepsMemory) {
+    // unlike Vec::clear, clearing keeps the memory, so filling it again doesn't allocate
+    allocations = frees = 0;
+    using Vec2 = SmallVec<int, 2, CountingAllocator>;
+    Vec2 vec = Vec2::Empty();
+    for (int i = 0; i < 100; i++) {
+        vec.push(i);
+    }
+    int capacity = vec.capacity;
+    const int* heap = vec.data();
+    int allocated = allocations;
+    frees = 0;
+    vec.clear();
+    CHECK_EQ(vec.size, 0);
+    CHECK_EQ(vec.capacity, capacity);
+    CHECK(vec.data() == heap);
+    CHECK_EQ(frees, 0);
+    for (int i = 0; i < 100; i++) {
+        vec.push(i);
+    }
+    CHECK_EQ(allocations, allocated);
+    vec.destroy();
+    CHECK_EQ(frees, 1);
+
+    // elements that need destroying are destroyed by clear, and destroy after it doesn't do it again
+    Tracked::alive = 0;
+    {
+        SmallVec<Tracked, 2> tracked;
+        for (int i = 0; i < 10; i++) {
+            tracked.emplace(i);
+        }
+        CHECK_EQ(Tracked::alive, 10);
+        tracked.clear();
+        CHECK_EQ(Tracked::alive, 0);
+        tracked.emplace(5);
+        CHECK_EQ(tracked[0].value, 5);
+    }
+    CHECK_EQ(Tracked::alive, 0);
+}
+
+TEST(smallVecAcrossTypes) {
+    auto number = [](int i){ return i; };
+    auto same = [](int i){ return i; };
+    CHECK((matchesAfterChanges< SmallVec<int, 1> >(number, same)));
+    CHECK((matchesAfterChanges< SmallVec<int, 64> >(number, same)));
+    CHECK((matchesAfterChanges< SmallVec<Uint8, 3> >([](int i){ return (Uint8)i; }, [](Uint8 i){ return (int)i; })));
+    CHECK((matchesAfterChanges< SmallVec<Position, 8, DefaultAllocator, ExactGrowth> >(
+        [](int i){ return Position{(float)i, -1.0f}; }, [](const Position& p){ return (int)p.x; })));
+    CHECK((matchesAfterChanges< SmallVec<std::string, 4, DefaultAllocator, HalfGrowth> >(
+        // long enough not to fit in std::string's own small buffer
+        [](int i){ return std::to_string(i) + " is a string that has to be on the heap"; }, [](const std::string& s){ return atoi(s.c_str()); })));
+    CHECK((matchesAfterChanges< SmallVec<std::unique_ptr<int>, 2> >(
+        [](int i){ return std::make_unique<int>(i); }, [](const std::unique_ptr<int>& p){ return *p; })));
+
+    Tracked::alive = 0;
+    CHECK((matchesAfterChanges< SmallVec<Tracked, 5> >([](int i){ return Tracked(i); }, [](const Tracked& t){ return t.value; })));
+    CHECK_EQ(Tracked::alive, 0);
+}
+
+TEST(smallVecGrowthPolicies) {
+    CHECK_EQ(DoubleGrowth::grow(8, 9), 16);
+    CHECK_EQ(HalfGrowth::grow(8, 9), 12);
+    CHECK_EQ(ExactGrowth::grow(8, 9), 9);
+    CHECK_EQ(HalfGrowth::grow(8, 20), 20);
+
+    // pushing one at a time, the policies that grow less reallocate more
+    auto reallocationsFor = [](auto vec){
+        allocations = 0;
+        for (int i = 0; i < 1000; i++) {
+            vec.push(i);
+        }
+        bool ok = vec.size == 1000 && vec[999] == 999;
+        vec.destroy();
+        return ok ? allocations : -1;
+    };
+    int doubling = reallocationsFor(SmallVec<int, 4, CountingAllocator, DoubleGrowth>());
+    int half = reallocationsFor(SmallVec<int, 4, CountingAllocator, HalfGrowth>());
+    int exact = reallocationsFor(SmallVec<int, 4, CountingAllocator, ExactGrowth>());
+    CHECK_EQ(doubling, 8);
+    CHECK(half > doubling && half < exact);
+    CHECK_EQ(exact, 1000 - 4);
+
+    // reserving up front means no growing after
+    auto reserved = SmallVec<int, 4, CountingAllocator, ExactGrowth>::WithCapacity(1000);
+    CHECK_EQ(reallocationsFor(reserved), 0);
+}
+
+TEST(smallVecPushFromItself) {
+    // an element of the vector pushed when it's full has to be copied before the elements move
+    SmallVec<std::string, 2> strings;
+    strings.push(std::string("the first string, too long to be kept inline by std::string"));
+    strings.push(std::string("the second string"));
+    strings.push(strings[0]);
+    strings.resize(8, strings[1]);
+    CHECK(strings[2] == strings[0]);
+    CHECK(strings[7] == "the second string");
+
+    SmallVec<int, 2> numbers = SmallVec<int, 2>::Empty();
+    numbers.push(7);
+    numbers.push(8);
+    numbers.push(numbers[0]);
+    numbers.push(numbers.ref());
+    CHECK_EQ(numbers.size, 6);
+    CHECK_EQ(numbers[2], 7);
+    CHECK_EQ(numbers[5], 7);
+    numbers.destroy();
+}
+
+TEST(smallVecMovesWithMemcpy) {
+    // like a HashMap moving its values around: inline elements move with the bytes, heap ones stay where they are
+    using Vec4 = SmallVec<int, 4>;
+    const int numbers[] = {1, 2, 3};
+    Vec4 small = Vec4::From(ArrayRef<int>(numbers, 3));
+    alignas(Vec4) unsigned char moved[sizeof(Vec4)];
+    memcpy(moved, &small, sizeof(Vec4));
+    memset((void*)&small, 0xCD, sizeof(Vec4));
+    Vec4& inlineMoved = *(Vec4*)moved;
+    CHECK_EQ(inlineMoved.size, 3);
+    CHECK_EQ(inlineMoved[2], 3);
+    CHECK((unsigned char*)inlineMoved.data() == moved + ((unsigned char*)inlineMoved.data() - moved));
+    CHECK((unsigned char*)inlineMoved.begin() >= moved && (unsigned char*)inlineMoved.end() <= moved + sizeof(Vec4));
+
+    Vec4 big = Vec4::Empty();
+    for (int i = 0; i < 20; i++) {
+        big.push(i);
+    }
+    const int* heap = big.data();
+    Vec4 copy = big;
+    CHECK(copy.data() == heap);
+    CHECK_EQ(copy[19], 19);
+    copy.destroy();
+
+    // types that aren't trivially copyable are moved by their move constructors instead
+    SmallVec<std::string, 2> strings;
+    strings.push(std::string("a"));
+    SmallVec<std::string, 2> movedStrings = std::move(strings);
+    CHECK_EQ(strings.size, 0);
+    CHECK(movedStrings[0] == "a");
+}
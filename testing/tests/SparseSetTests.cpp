@@ -0,0 +1,121 @@
+#include "test.hpp"
+#include "My/SparseSets.hpp"
+#include <map>
+
+using namespace My;
+
+static constexpr Uint32 MaxKey = (1 << 20) - 1;
+using Set = DenseSparseSet<Uint32, Uint32, Uint32, MaxKey>;
+
+// every key maps to its value, and the dense keys and values line up
+static bool matches(const Set& set, const std::map<Uint32, Uint32>& expected) {
+    if (set.getSize() != (int)expected.size()) return false;
+    for (auto [key, value] : expected) {
+        const Uint32* found = set.lookup(key);
+        if (!found || *found != value || !set.contains(key)) return false;
+    }
+    ArrayRef<Uint32> keys = set.getKeys();
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto it = expected.find(keys[i]);
+        if (it == expected.end() || it->second != set.getValues()[i]) return false;
+    }
+    return true;
+}
+
+TEST(sparseSetMatchesMap) {
+    Set set = Set::Empty();
+    std::map<Uint32, Uint32> expected;
+    Uint32 random = 5;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    int mismatches = 0;
+    for (int op = 0; op < 100000; op++) {
+        // keys bunched up in a few places, and some spread all over
+        Uint32 key = nextRandom() % 4 ? (nextRandom() % 4) * 100000 + nextRandom() % 3000 : nextRandom() % (MaxKey + 1);
+        if (expected.count(key)) {
+            if (nextRandom() % 2) {
+                set.remove(key);
+                expected.erase(key);
+            } else {
+                *set.lookup(key) = op;
+                expected[key] = op;
+            }
+        } else {
+            set.insert(key, (Uint32)op);
+            expected[key] = op;
+        }
+        // keys that aren't in it aren't found
+        Uint32 missing = nextRandom() % (MaxKey + 1);
+        if (!expected.count(missing) && (set.lookup(missing) || set.contains(missing))) mismatches++;
+        if (op % 1000 == 0 && !matches(set, expected)) mismatches++;
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK(matches(set, expected));
+    CHECK(!set.contains(MaxKey + 1));
+
+    // removing everything leaves it empty, down to the last key swapping with itself
+    for (auto [key, value] : expected) {
+        set.remove(key);
+    }
+    CHECK_EQ(set.getSize(), 0);
+    CHECK(set.lookup(expected.begin()->first) == nullptr);
+    set.destroy();
+}
+
+TEST(sparseSetPagesOnlyWhereUsed) {
+    Set set = Set::Empty();
+    CHECK_EQ(set.sparseBytes(), 0u);
+    CHECK(set.lookup(12345) == nullptr);
+
+    // two keys far apart only take a page of 1024 keys each, and a pointer for every page up to the last key
+    set.insert(3, 30);
+    set.insert(MaxKey, 40);
+    const size_t directory = ((MaxKey >> 10) + 1) * sizeof(Uint32*);
+    CHECK_EQ(set.sparseBytes(), directory + 2 * 4096u);
+    CHECK(set.lookup(MaxKey - 1) == nullptr);
+    CHECK(set.lookup(MaxKey / 2) == nullptr);
+    CHECK_EQ(*set.lookup(MaxKey), 40u);
+
+    // filling a page doesn't take any more than one
+    set.insertRange(4, 1000);
+    CHECK_EQ(set.sparseBytes(), directory + 2 * 4096u);
+    set.destroy();
+}
+
+TEST(sparseSetBulkChanges) {
+    Set set = Set::Empty();
+    set.insert(7, 70);
+
+    // the range's values come back in key order, right after what was there
+    Uint32* range = set.insertRange(100, 200);
+    CHECK(range == set.getValues() + 1);
+    for (Uint32 i = 0; i < 100; i++) {
+        range[i] = i;
+    }
+    CHECK_EQ(*set.lookup(150), 50u);
+    CHECK_EQ(set.getKeys()[1], 100u);
+    CHECK(!set.contains(200));
+
+    const Uint32 listed[] = {5000, 3, 90000};
+    Uint32* values = set.insertList(ArrayRef<Uint32>(listed, 3));
+    values[0] = 1;
+    values[1] = 2;
+    values[2] = 3;
+    CHECK_EQ(*set.lookup(3), 2u);
+    CHECK_EQ(*set.lookup(90000), 3u);
+    CHECK_EQ(set.getSize(), 104);
+
+    // removing keys from the middle moves the last ones into their places, and only the removed ones go
+    const Uint32 removed[] = {7, 150, 90000};
+    set.removeList(ArrayRef<Uint32>(removed, 3));
+    CHECK_EQ(set.getSize(), 101);
+    CHECK(!set.contains(7));
+    CHECK(!set.contains(150));
+    CHECK(!set.contains(90000));
+    CHECK_EQ(*set.lookup(5000), 1u);
+    CHECK_EQ(*set.lookup(3), 2u);
+    CHECK_EQ(*set.lookup(151), 51u);
+    set.destroy();
+}
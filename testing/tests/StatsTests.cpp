@@ -0,0 +1,135 @@
+#include "test.hpp"
+#include "utils/Stats.hpp"
+#include "utils/common-macros.hpp"
+#include <vector>
+#include <algorithm>
+
+// the exact percentile from the times sorted, ranked the same way TimeHistogram::percentile ranks them
+static Uint64 exactPercentile(const std::vector<Uint64>& sorted, double fraction) {
+    Uint64 rank = MAX((Uint64)SDL_ceil(fraction * (double)sorted.size()), (Uint64)1);
+    return sorted[rank - 1];
+}
+
+// the furthest any of a spread of percentiles is from the exact one, relative to it
+static double worstPercentileError(std::vector<Uint64> times) {
+    Uint32 counts[TimeHistogram::BucketCount];
+    TimeHistogram histogram = {counts, 0, 0};
+    histogram.clear();
+    for (Uint64 ns : times) {
+        histogram.add(ns);
+    }
+    std::sort(times.begin(), times.end());
+    const double fractions[] = {0.0, 0.01, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1.0};
+    double worst = 0.0;
+    for (double fraction : fractions) {
+        double exact = (double)exactPercentile(times, fraction);
+        double error = SDL_fabs((double)histogram.percentile(fraction) - exact) / exact;
+        worst = MAX(worst, error);
+    }
+    return worst;
+}
+
+TEST(histogramBuckets) {
+    // every time is inside the bucket it goes in, and reads back close enough
+    int outside = 0;
+    int tooFar = 0;
+    for (Uint64 ns = 1; ns < ((Uint64)1 << TimeHistogram::MaxBits); ns += 1 + ns / 7) {
+        int bucket = TimeHistogram::bucket(ns);
+        if (ns < TimeHistogram::bucketStart(bucket) || ns >= TimeHistogram::bucketStart(bucket + 1)) outside++;
+        double error = SDL_fabs((double)TimeHistogram::bucketMiddle(bucket) - (double)ns) / (double)ns;
+        if (error > TimeHistogram::MaxRelativeError) tooFar++;
+    }
+    CHECK_EQ(outside, 0);
+    CHECK_EQ(tooFar, 0);
+
+    // small times each get their own bucket, and huge ones all go in the last
+    for (Uint64 ns = 0; ns < (Uint64)TimeHistogram::SubBuckets * 2; ns++) {
+        CHECK_EQ(TimeHistogram::bucketMiddle(TimeHistogram::bucket(ns)), ns);
+    }
+    CHECK_EQ(TimeHistogram::bucket((Uint64)1 << TimeHistogram::MaxBits), TimeHistogram::BucketCount - 1);
+    CHECK_EQ(TimeHistogram::bucket(~(Uint64)0), TimeHistogram::BucketCount - 1);
+}
+
+TEST(histogramPercentileAccuracy) {
+    Uint32 random = 7;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    constexpr int Samples = 100000;
+
+    // frames around 16ms with a bit of noise
+    std::vector<Uint64> times(Samples);
+    for (Uint64& ns : times) ns = 15000000 + nextRandom() % 3000000;
+    CHECK(worstPercentileError(times) <= TimeHistogram::MaxRelativeError);
+
+    // the same with a hitch of up to 10 frames every so often, so the tail is a long way from the median
+    for (Uint64& ns : times) {
+        if (nextRandom() % 100 == 0) ns *= 2 + nextRandom() % 8;
+    }
+    CHECK(worstPercentileError(times) <= TimeHistogram::MaxRelativeError);
+
+    // spread over many powers of two, from a few nanoseconds to a few seconds
+    for (Uint64& ns : times) ns = ((Uint64)1 << (nextRandom() % 32)) + nextRandom() % 1024;
+    CHECK(worstPercentileError(times) <= TimeHistogram::MaxRelativeError);
+
+    // two far apart groups, with the percentiles right on the edge between them
+    for (int i = 0; i < Samples; i++) times[i] = i < Samples * 95 / 100 ? 1000 + i % 7 : 50000000 + i;
+    CHECK(worstPercentileError(times) <= TimeHistogram::MaxRelativeError);
+
+    // every time the same, and just one time
+    CHECK(worstPercentileError(std::vector<Uint64>(1000, 16666667)) <= TimeHistogram::MaxRelativeError);
+    CHECK(worstPercentileError(std::vector<Uint64>(1, 123456789)) <= TimeHistogram::MaxRelativeError);
+
+    Uint32 counts[TimeHistogram::BucketCount];
+    TimeHistogram empty = {counts, 0, 0};
+    empty.clear();
+    CHECK_EQ(empty.percentile(0.5), 0u);
+}
+
+TEST(histogramMerge) {
+    Uint32 countsA[TimeHistogram::BucketCount], countsB[TimeHistogram::BucketCount];
+    TimeHistogram a = {countsA, 0, 0};
+    TimeHistogram b = {countsB, 0, 0};
+    a.clear();
+    b.clear();
+    for (Uint64 i = 1; i <= 1000; i++) {
+        a.add(i * 1000);
+        b.add(i * 1000 + 5000000);
+    }
+    Uint64 median = a.percentile(0.5);
+    a.merge(b);
+    CHECK_EQ(a.samples, 2000u);
+    CHECK_EQ(a.max, 6000000u);
+    CHECK(a.percentile(0.75) >= 5000000u);
+    // taking it back out leaves what was there, other than the max
+    a.merge(b, -1);
+    CHECK_EQ(a.samples, 1000u);
+    CHECK_EQ(a.percentile(0.5), median);
+}
+
+TEST(timingStatsWindow) {
+    constexpr int Window = 400;
+    TimingStats stats = TimingStats::init("test", Window);
+    for (int i = 0; i < Window; i++) {
+        stats.record(1000000);
+    }
+    stats.record(50000000);
+    CHECK_EQ(stats.max(), 50.0);
+    CHECK(SDL_fabs(stats.percentile(0.5) - 1.0) <= TimeHistogram::MaxRelativeError);
+
+    // once there have been a window's worth of slower times, the fast ones and the hitch are out of it
+    for (int i = 0; i < Window; i++) {
+        stats.record(4000000);
+    }
+    CHECK(SDL_fabs(stats.percentile(0.01) - 4.0) <= 4.0 * TimeHistogram::MaxRelativeError);
+    CHECK_EQ(stats.max(), 4.0);
+    CHECK(stats.window.samples <= (Uint64)Window);
+    CHECK(stats.window.samples >= (Uint64)(Window - Window / TimingStats::Slots));
+
+    // but not out of the total
+    CHECK_EQ(stats.total.samples, (Uint64)(2 * Window + 1));
+    CHECK_EQ(stats.total.max, 50000000u);
+    CHECK(stats.total.percentile(0.25) < 2000000u);
+    stats.destroy();
+}
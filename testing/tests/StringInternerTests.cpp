@@ -0,0 +1,175 @@
+#include "test.hpp"
+#include "utils/StringInterner.hpp"
+#include "ECS/NameIndex.hpp"
+#include "world/EntityWorld.hpp"
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <set>
+
+TEST(internSameTextSameId) {
+    InternedString tree = intern("internTestTree");
+    CHECK(tree);
+    CHECK(tree == intern("internTestTree"));
+    CHECK(tree == intern(std::string("internTestTree").c_str()));
+    CHECK(tree != intern("internTestRock"));
+    CHECK(strcmp(tree.str(), "internTestTree") == 0);
+    CHECK_EQ(tree.length(), 14u);
+
+    // part of a string, and text with the same start
+    InternedString part = intern("internTestTreeHouse", 14);
+    CHECK(part == tree);
+    CHECK(intern("internTestTreeHouse") != tree);
+
+    CHECK(intern(nullptr).null());
+    CHECK(intern("").null());
+    CHECK(intern("abc", 0).null());
+    CHECK(strcmp(NullInternedString.str(), "") == 0);
+    CHECK_EQ(NullInternedString.length(), 0u);
+
+    // finding doesn't add
+    int count = internedStringCount();
+    CHECK(findInterned("internTestNeverInterned").null());
+    CHECK_EQ(internedStringCount(), count);
+    CHECK(findInterned("internTestTree") == tree);
+}
+
+TEST(internFromManyThreads) {
+    // every thread interns the same strings in a different order, plus some only it has
+    constexpr int Threads = 8;
+    constexpr int Shared = 3000;
+    constexpr int Own = 500;
+    int countBefore = internedStringCount();
+    std::vector<std::vector<Uint32>> sharedIds(Threads, std::vector<Uint32>(Shared));
+    std::vector<std::vector<Uint32>> ownIds(Threads, std::vector<Uint32>(Own));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; t++) {
+        threads.emplace_back([&, t](){
+            char text[64];
+            for (int i = 0; i < Shared; i++) {
+                int s = (i * 7 + t * 1013) % Shared;
+                snprintf(text, sizeof(text), "internTestShared%d", s);
+                sharedIds[t][s] = intern(text).id;
+                if (i < Own) {
+                    snprintf(text, sizeof(text), "internTestThread%dString%d", t, i);
+                    ownIds[t][i] = intern(text).id;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int mismatches = 0;
+    std::set<Uint32> distinct;
+    for (int t = 0; t < Threads; t++) {
+        for (int s = 0; s < Shared; s++) {
+            if (sharedIds[t][s] != sharedIds[0][s] || sharedIds[t][s] == 0) mismatches++;
+            distinct.insert(sharedIds[t][s]);
+        }
+        for (int i = 0; i < Own; i++) {
+            distinct.insert(ownIds[t][i]);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+    // one id for each different string, and nothing else was added
+    CHECK_EQ(distinct.size(), (size_t)(Shared + Threads * Own));
+    CHECK_EQ(internedStringCount(), countBefore + Shared + Threads * Own);
+
+    // the text for every id is what was interned
+    int wrongText = 0;
+    char text[64];
+    for (int s = 0; s < Shared; s++) {
+        snprintf(text, sizeof(text), "internTestShared%d", s);
+        if (strcmp(InternedString{sharedIds[0][s]}.str(), text) != 0) wrongText++;
+    }
+    for (int t = 0; t < Threads; t++) {
+        snprintf(text, sizeof(text), "internTestThread%dString%d", t, Own - 1);
+        if (strcmp(InternedString{ownIds[t][Own - 1]}.str(), text) != 0) wrongText++;
+    }
+    CHECK_EQ(wrongText, 0);
+}
+
+TEST(internNameIndex) {
+    using namespace ECS;
+    NameIndex index = NameIndex::init();
+    InternedString tree = intern("internTestIndexTree");
+    InternedString rock = intern("internTestIndexRock");
+    const Entity a = Entity(1, 1), b = Entity(2, 1), c = Entity(3, 4);
+
+    index.add(tree, a);
+    index.add(tree, b);
+    index.add(rock, c);
+    index.add(NullInternedString, c);
+    CHECK(index.find(tree) == a);
+    CHECK_EQ(index.findAll(tree).size(), 2u);
+    CHECK(index.find(rock) == c);
+    CHECK(index.find(NullInternedString) == NullEntity);
+    CHECK(index.find(intern("internTestIndexNothing")) == NullEntity);
+
+    // the oldest one goes, so the next oldest is found
+    CHECK(index.remove(tree, a));
+    CHECK(!index.remove(tree, a));
+    CHECK(!index.remove(rock, b));
+    CHECK(index.find(tree) == b);
+    CHECK(index.remove(tree, b));
+    CHECK(index.find(tree) == NullEntity);
+    CHECK_EQ(index.findAll(tree).size(), 0u);
+    index.destroy();
+}
+
+TEST(internEntityNamesStayIndexed) {
+    // the index follows nametags being added, changed, removed and destroyed with their entities
+    EntityWorld ecs;
+    InternedString tree = intern("internTestWorldTree");
+    InternedString rock = intern("internTestWorldRock");
+    Entity first = ecs.New(World::Entities::PrototypeIDs::Default);
+    Entity second = ecs.New(World::Entities::PrototypeIDs::Default);
+    ecs.Add<World::EC::Nametag>(first, World::EC::Nametag(tree));
+    ecs.Add<World::EC::Nametag>(second, World::EC::Nametag("internTestWorldTree"));
+    ecs.FlushEvents();
+    CHECK(ecs.FindNamed(tree) == first);
+    CHECK_EQ(ecs.FindAllNamed(tree).size(), 2u);
+
+    ecs.Set<World::EC::Nametag>(first, World::EC::Nametag(rock));
+    CHECK(ecs.FindNamed(rock) == first);
+    CHECK(ecs.FindNamed(tree) == second);
+
+    // adding it again replaces the old name
+    ecs.Add<World::EC::Nametag>(second, World::EC::Nametag(rock));
+    CHECK(ecs.FindNamed(tree) == NullEntity);
+    CHECK_EQ(ecs.FindAllNamed(rock).size(), 2u);
+
+    // with nothing to tell before it goes, a removed nametag goes right away,
+    // but a destroyed entity is still found until the flush
+    ecs.Remove<World::EC::Nametag>(first);
+    CHECK(ecs.FindNamed(rock) == second);
+    ecs.Destroy(second);
+    CHECK(ecs.FindNamed(rock) == second);
+    ecs.FlushEvents();
+    CHECK_EQ(ecs.FindAllNamed(rock).size(), 0u);
+    CHECK(ecs.EntityExists(first));
+
+    // a new entity in the destroyed one's place is found with its own version
+    Entity third = ecs.New(World::Entities::PrototypeIDs::Default);
+    ecs.Add<World::EC::Nametag>(third, World::EC::Nametag(tree));
+    ecs.FlushEvents();
+    CHECK(ecs.FindNamed(tree) == third);
+    ecs.destroy();
+}
+
+TEST(internFreeStartsOver) {
+    // only ids made here are used after this, since freeing makes every id from before invalid
+    intern("internTestBeforeFree");
+    freeInternedStrings();
+    CHECK_EQ(internedStringCount(), 0);
+    CHECK(strcmp(NullInternedString.str(), "") == 0);
+    CHECK(findInterned("internTestBeforeFree").null());
+
+    InternedString after = intern("internTestAfterFree");
+    CHECK_EQ(after.id, 1u);
+    CHECK(strcmp(after.str(), "internTestAfterFree") == 0);
+    CHECK(intern("internTestAfterFree") == after);
+}
@@ -0,0 +1,62 @@
+#include "test.hpp"
+#include "rendering/TextLayoutCache.hpp"
+#include <string.h>
+#include <string>
+
+// straight from the assets folder, so freetype has a real face to lay text out with
+static std::string assetFontPath(const char* name) {
+    std::string path = __FILE__;
+    path = path.substr(0, path.rfind("testing/"));
+    return path + "assets/fonts/" + name;
+}
+
+TEST(textLayoutHandleSurvivesFontChanges) {
+    initFreetype();
+    Font* font = newFont(assetFontPath("FreeSans.ttf").c_str(), 24, false, 1.0f, Font::FormattingSettings{}, TextureUnit::Null, Shader());
+    CHECK(font != nullptr);
+    if (!font) {
+        quitFreetype();
+        return;
+    }
+
+    TextLayoutCache cache = TextLayoutCache::init();
+    TextFormattingSettings formatting;
+    const char* text = "Retained label";
+    int textLength = (int)strlen(text);
+    TextLayoutHandle handle = cache.retain(font, text, textLength, formatting, glm::vec2(1.0f));
+    CHECK(handle);
+    const CachedTextLayout* layout = cache.lookup(handle);
+    CHECK(layout != nullptr && layout->quads.size > 0);
+    if (!layout) return;
+    glm::vec2 size = layout->size;
+    int quadCount = layout->quads.size;
+
+    // reloaded at twice the size, like scaling all the fonts does
+    font->load(48, Shader());
+    layout = cache.lookup(handle);
+    CHECK(layout != nullptr);
+    if (layout) {
+        CHECK_EQ(layout->quads.size, quadCount);
+        CHECK(layout->size.x > size.x * 1.5f);
+    }
+    CHECK_EQ(cache.stats.relayouts, 1u);
+    CHECK_EQ(cache.entryCount, 1);
+
+    // getting the same text finds the entry that was laid out again instead of making another one
+    Uint64 misses = cache.stats.misses;
+    CHECK(cache.get(font, text, textLength, formatting, glm::vec2(1.0f)) == layout);
+    CHECK_EQ(cache.stats.misses, misses);
+
+    // compacting glyphs bumps the generation too. Laid out again once, not on every lookup after
+    font->generation++;
+    CHECK(cache.lookup(handle) != nullptr);
+    CHECK(cache.lookup(handle) != nullptr);
+    CHECK_EQ(cache.stats.relayouts, 2u);
+    CHECK_EQ(cache.entryCount, 1);
+
+    cache.release(handle);
+    cache.destroy();
+    font->unload();
+    delete font;
+    quitFreetype();
+}
@@ -0,0 +1,182 @@
+#include "test.hpp"
+#include "world/TimerWheel.hpp"
+#include "utils/common-macros.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace World;
+
+TEST(timersFireOnTheirTick) {
+    TimerWheel wheel = TimerWheel::init(0);
+    // one in every ring, on the edges of their slots, and past all of them
+    const Tick ticks[] = {1, 2, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300000, (1 << 24) - 1, 1 << 24, (1 << 24) + 5, 40000000};
+    constexpr int Count = sizeof(ticks) / sizeof(ticks[0]);
+    // scheduled backwards, so the order they fire in has to come from the wheel
+    for (int i = Count - 1; i >= 0; i--) {
+        wheel.schedule(ticks[i], NullEntity, TimerAction::Call, (Sint16)i);
+    }
+    CHECK_EQ(wheel.pending, Count);
+
+    int fired = 0;
+    Timer timer;
+    while (wheel.next(ticks[Count - 1], &timer)) {
+        CHECK_EQ(timer.argument, fired);
+        CHECK_EQ(timer.tick, ticks[fired]);
+        CHECK_EQ(wheel.now, ticks[fired]);
+        fired++;
+    }
+    CHECK_EQ(fired, Count);
+    CHECK_EQ(wheel.pending, 0);
+    CHECK_EQ(wheel.now, ticks[Count - 1]);
+
+    // anything for a tick that's been and gone goes off on the next one
+    wheel.schedule(5, NullEntity, TimerAction::Call, 0);
+    CHECK(!wheel.next(wheel.now, &timer));
+    CHECK(wheel.next(wheel.now + 1, &timer));
+    CHECK_EQ(timer.tick, ticks[Count - 1] + 1);
+
+    wheel.destroy();
+}
+
+TEST(timersSameTickInScheduledOrder) {
+    TimerWheel wheel = TimerWheel::init(0);
+    // due the same tick, but coming down from different rings
+    for (int i = 0; i < 300; i++) {
+        wheel.schedule(5000, NullEntity, TimerAction::Call, (Sint16)i);
+        if (i % 3 == 0) {
+            // push time along so the rest get placed lower down
+            Timer timer;
+            CHECK(!wheel.next(wheel.now + 10, &timer));
+        }
+    }
+    int expected = 0;
+    Timer timer;
+    while (wheel.next(5000, &timer)) {
+        if (timer.argument != expected) {
+            CHECK_EQ(timer.argument, expected);
+            break;
+        }
+        expected++;
+    }
+    CHECK_EQ(expected, 300);
+    wheel.destroy();
+}
+
+TEST(timersCancel) {
+    TimerWheel wheel = TimerWheel::init(0);
+    TimerID soon = wheel.schedule(10, NullEntity, TimerAction::Call, 0);
+    TimerID later = wheel.schedule(100000, NullEntity, TimerAction::Call, 1);
+    CHECK(wheel.isPending(soon));
+    CHECK(wheel.cancel(later));
+    CHECK(!wheel.isPending(later));
+    CHECK(!wheel.cancel(later));
+
+    Timer timer;
+    CHECK(wheel.next(200000, &timer));
+    CHECK_EQ(timer.argument, 0);
+    CHECK(!wheel.next(200000, &timer));
+    // gone off, so there's nothing to cancel
+    CHECK(!wheel.cancel(soon));
+
+    // a reused timer gets a new generation, so the old id doesn't touch it
+    TimerID reused = wheel.schedule(wheel.now + 5, NullEntity, TimerAction::Call, 2);
+    CHECK(reused.index == soon.index || reused.index == later.index);
+    CHECK(!wheel.cancel(soon));
+    CHECK(!wheel.cancel(later));
+    CHECK(wheel.isPending(reused));
+
+    // cancelling while firing: the first timer of a tick cancels the second
+    TimerID second = wheel.schedule(wheel.now + 5, NullEntity, TimerAction::Call, 3);
+    CHECK(wheel.next(wheel.now + 5, &timer));
+    CHECK_EQ(timer.argument, 2);
+    CHECK(wheel.cancel(second));
+    CHECK(!wheel.next(wheel.now, &timer));
+    CHECK_EQ(wheel.pending, 0);
+
+    wheel.destroy();
+}
+
+TEST(timersCancelAllForEntity) {
+    TimerWheel wheel = TimerWheel::init(0);
+    const Entity tree = Entity(3, 1);
+    const Entity rock = Entity(4, 1);
+    wheel.schedule(20, tree, TimerAction::Destroy, 0);
+    TimerID rockTimer = wheel.schedule(30, rock, TimerAction::Destroy, 0);
+    wheel.schedule(5000, tree, TimerAction::RemoveComponent, 7);
+    wheel.schedule(40, tree, TimerAction::Call, 1);
+
+    CHECK_EQ(wheel.cancelAll(tree), 3);
+    CHECK_EQ(wheel.cancelAll(tree), 0);
+    CHECK_EQ(wheel.pending, 1);
+    CHECK(wheel.isPending(rockTimer));
+
+    // the entity can get timers again afterwards, and only those go off
+    wheel.schedule(50, tree, TimerAction::Call, 2);
+    Timer timer;
+    CHECK(wheel.next(10000, &timer));
+    CHECK(timer.entity == rock);
+    CHECK(wheel.next(10000, &timer));
+    CHECK(timer.entity == tree);
+    CHECK_EQ(timer.argument, 2);
+    CHECK(!wheel.next(10000, &timer));
+    CHECK(wheel.byEntity.lookup(tree.id) == nullptr);
+
+    wheel.destroy();
+}
+
+TEST(timersMatchModel) {
+    // random scheduling, cancelling and firing, checked against a plain sorted list of what should be pending
+    struct Expected {
+        Tick tick;
+        int order;
+        Sint16 argument;
+        TimerID id;
+    };
+    TimerWheel wheel = TimerWheel::init(0);
+    std::vector<Expected> pending;
+    Uint32 random = 99;
+    auto nextRandom = [&](){
+        random = random * 1664525 + 1013904223;
+        return random >> 8;
+    };
+    int order = 0;
+    int mismatches = 0;
+    int fired = 0;
+    for (int op = 0; op < 200000; op++) {
+        Uint32 choice = nextRandom() % 10;
+        if (choice < 6) {
+            // mostly soon, sometimes far away
+            Tick delay = nextRandom() % 8 == 0 ? nextRandom() % 1000000 : nextRandom() % 200;
+            Sint16 argument = (Sint16)(order & 0x7FFF);
+            TimerID id = wheel.schedule(wheel.now + delay, NullEntity, TimerAction::Call, argument);
+            pending.push_back({MAX(wheel.now + delay, wheel.now + 1), order++, argument, id});
+        } else if (choice < 7 && !pending.empty()) {
+            int which = nextRandom() % pending.size();
+            if (!wheel.cancel(pending[which].id)) mismatches++;
+            pending.erase(pending.begin() + which);
+        } else {
+            Tick upTo = wheel.now + nextRandom() % 50;
+            std::sort(pending.begin(), pending.end(), [](const Expected& a, const Expected& b){
+                return a.tick != b.tick ? a.tick < b.tick : a.order < b.order;
+            });
+            size_t due = 0;
+            Timer timer;
+            while (wheel.next(upTo, &timer)) {
+                if (due >= pending.size() || pending[due].tick != timer.tick || pending[due].argument != timer.argument) {
+                    mismatches++;
+                }
+                due++;
+                fired++;
+            }
+            if (due < pending.size() && pending[due].tick <= upTo) mismatches++;
+            pending.erase(pending.begin(), pending.begin() + MIN(due, pending.size()));
+        }
+        if (wheel.pending != (int)pending.size()) {
+            mismatches++;
+            break;
+        }
+    }
+    CHECK(fired > 10000);
+    CHECK_EQ(mismatches, 0);
+    wheel.destroy();
+}
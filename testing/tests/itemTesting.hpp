@@ -0,0 +1,27 @@
+#ifndef TESTING_ITEM_TESTING_INCLUDED
+#define TESTING_ITEM_TESTING_INCLUDED
+
+#include "items/items.hpp"
+#include "items/prototypes/prototypes.hpp"
+
+// in GameState.cpp
+void makeItemPrototypes(items::ItemManager& im);
+
+// an item manager with the game's item prototypes, to make items with. Destroy it when done
+inline items::ItemManager makeItemManager() {
+    using namespace items::ITC;
+    static constexpr auto itemComponentInfo = ECS::getComponentInfoList<ITEM_COMPONENTS_LIST>();
+    items::ItemManager manager = items::ItemManager(ArrayRef(itemComponentInfo), items::ItemTypes::Count);
+    makeItemPrototypes(manager);
+    return manager;
+}
+
+inline int liveItems(const items::ItemManager& manager) {
+    int count = 0;
+    manager.forEachEntity([&](Entity){
+        count++;
+    });
+    return count;
+}
+
+#endif
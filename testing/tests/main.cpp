@@ -0,0 +1,44 @@
+#include "test.hpp"
+#include <stdio.h>
+#include <string.h>
+
+std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> list;
+    return list;
+}
+
+int registerTest(const char* name, void (*function)()) {
+    testCases().push_back({name, function});
+    return 0;
+}
+
+static int failedChecks = 0;
+
+void checkFailed(const char* file, int line, const char* check, const std::string& values) {
+    printf("    %s:%d: CHECK(%s) failed%s%s\n", file, line, check, values.empty() ? "" : ": ", values.c_str());
+    failedChecks++;
+}
+
+int main(int argc, char** argv) {
+    gLogger.useEscapeCodes = false;
+
+    const char* prefix = argc > 1 ? argv[1] : "";
+    int ran = 0;
+    int failed = 0;
+    for (const auto& test : testCases()) {
+        if (strncmp(test.name, prefix, strlen(prefix)) != 0) continue;
+        int failedBefore = failedChecks;
+        test.function();
+        bool passed = failedChecks == failedBefore;
+        printf("%s: %s\n", test.name, passed ? "ok" : "FAILED");
+        ran++;
+        failed += !passed;
+    }
+
+    if (ran == 0) {
+        printf("No tests starting with \"%s\".\n", prefix);
+        return 1;
+    }
+    printf("\n%d of %d passed.\n", ran - failed, ran);
+    return failed > 0;
+}
@@ -0,0 +1,39 @@
+#ifndef TESTING_TEST_INCLUDED
+#define TESTING_TEST_INCLUDED
+
+#include <vector>
+#include <string>
+#include "utils/Log.hpp"
+
+/* Tests register themselves before main runs, the same way benchmarks do.
+ * `tests` runs every test, and `tests items` runs the ones whose names start with "items".
+ * A failed check says where it was and fails the test, but the test keeps going so one run shows every failure
+ */
+
+struct TestCase {
+    const char* name;
+    void (*function)();
+};
+
+std::vector<TestCase>& testCases();
+
+int registerTest(const char* name, void (*function)());
+
+void checkFailed(const char* file, int line, const char* check, const std::string& values = "");
+
+#define TEST(name) \
+    static void name(); \
+    static const int name##Registered = registerTest(#name, name); \
+    static void name()
+
+#define CHECK(condition) do { \
+    if (!(condition)) checkFailed(__FILE__, __LINE__, #condition); \
+} while (0)
+
+// for numbers, so a failure can say what they were
+#define CHECK_EQ(a, b) do { \
+    auto checkA = (a); auto checkB = (b); \
+    if (!(checkA == checkB)) checkFailed(__FILE__, __LINE__, #a " == " #b, std::to_string(checkA) + " != " + std::to_string(checkB)); \
+} while (0)
+
+#endif